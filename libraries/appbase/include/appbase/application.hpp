@@ -5,6 +5,7 @@
 #include <appbase/execution_priority_queue.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/core/demangle.hpp>
+#include <chrono>
 #include <typeindex>
 
 namespace appbase {
@@ -217,6 +218,15 @@ namespace appbase {
             return pri_queue;
          }
 
+         struct plugin_timing {
+            std::string               name;
+            std::chrono::microseconds initialize{0}; ///< its plugin_initialize alone, not those of its dependencies
+            std::chrono::microseconds startup{0};    ///< its plugin_startup alone
+         };
+
+         /// @return how long each plugin took to initialize and start, in the order they were initialized
+         const vector<plugin_timing>& get_plugin_timings()const { return plugin_timings; }
+
       protected:
          template<typename Impl>
          friend class plugin;
@@ -231,11 +241,20 @@ namespace appbase {
          void plugin_started(abstract_plugin& plug){ running_plugins.push_back(&plug); }
          ///@}
 
+         plugin_timing& timing_of( const string& name ) {
+            auto itr = std::find_if( plugin_timings.begin(), plugin_timings.end(), [&]( const auto& t ) { return t.name == name; } );
+            if( itr != plugin_timings.end() )
+               return *itr;
+            plugin_timings.push_back( plugin_timing{name} );
+            return plugin_timings.back();
+         }
+
       private:
          application(); ///< private because application is a singleton that should be accessed via instance()
          map<string, std::unique_ptr<abstract_plugin>> plugins; ///< all registered plugins
          vector<abstract_plugin*>                  initialized_plugins; ///< stored in the order they were started running
          vector<abstract_plugin*>                  running_plugins; ///< stored in the order they were started running
+         vector<plugin_timing>                     plugin_timings;
 
          std::function<void()>                     sighup_callback;
          map<std::type_index, erased_method_ptr>   methods;
@@ -276,7 +295,9 @@ namespace appbase {
             if(_state == registered) {
                _state = initialized;
                static_cast<Impl*>(this)->plugin_requires([&](auto& plug){ plug.initialize(options); });
+               const auto start = std::chrono::steady_clock::now();
                static_cast<Impl*>(this)->plugin_initialize(options);
+               app().timing_of(name()).initialize = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start );
                //ilog( "initializing plugin ${name}", ("name",name()) );
                app().plugin_initialized(*this);
             }
@@ -290,7 +311,9 @@ namespace appbase {
             if(_state == initialized) {
                _state = started;
                static_cast<Impl*>(this)->plugin_requires([&](auto& plug){ plug.startup(); });
+               const auto start = std::chrono::steady_clock::now();
                static_cast<Impl*>(this)->plugin_startup();
+               app().timing_of(name()).startup = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start );
                app().plugin_started(*this);
             }
             assert(_state == started); // if initial state was not initialized, final state cannot be started
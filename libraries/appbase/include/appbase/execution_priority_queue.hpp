@@ -1,7 +1,16 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <boost/core/demangle.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
 #include <queue>
+#include <typeindex>
+#include <unordered_map>
 
 namespace appbase {
 // adapted from: https://www.boost.org/doc/libs/1_69_0/doc/html/boost_asio/example/cpp11/invocation/prioritised_handlers.cpp
@@ -12,6 +21,47 @@ struct priority {
    static constexpr int low = 10;
 };
 
+/// What execution_priority_queue recorded since its stats were enabled
+struct execution_stats {
+   /// buckets are for up to 1us, 2us, 4us ... 2^(bucket_count-2)us and the rest
+   static constexpr size_t bucket_count = 23;
+
+   struct histogram {
+      std::array<uint64_t, bucket_count> counts{}; ///< not cumulative
+      uint64_t                           sum_us = 0;
+      uint64_t                           count = 0;
+
+      static uint64_t bound_us( size_t bucket ) { return uint64_t(1) << bucket; }
+
+      void observe( uint64_t us ) {
+         size_t bucket = 0;
+         while( bucket < bucket_count - 1 && us > bound_us( bucket ) )
+            ++bucket;
+         ++counts[bucket];
+         sum_us += us;
+         ++count;
+      }
+   };
+
+   struct level {
+      size_t    queued = 0;
+      histogram wait_us;  ///< from being queued until starting to execute
+      histogram run_us;
+   };
+
+   /// handlers are told apart by their type, the demangled name of a lambda includes the function it was written in
+   struct site {
+      std::string name;
+      uint64_t    executed = 0;
+      uint64_t    run_us = 0;
+      uint64_t    max_run_us = 0;
+      uint64_t    wait_us = 0;
+   };
+
+   std::map<int, level> levels; ///< by priority
+   std::vector<site>    sites;  ///< most run time first
+};
+
 class execution_priority_queue : public boost::asio::execution_context
 {
 public:
@@ -21,13 +71,19 @@ public:
    {
       std::unique_ptr<queued_handler_base> handler(new queued_handler<Function>(priority, --order_, std::move(function)));
 
+      if( stats_enabled_.load( std::memory_order_relaxed ) ) {
+         handler->queued_at_ = std::chrono::steady_clock::now();
+         handler->site_ = &typeid(Function);
+         std::lock_guard<std::mutex> g( stats_mtx_ );
+         ++levels_[priority].queued;
+      }
       handlers_.push(std::move(handler));
    }
 
    void execute_all()
    {
       while (!handlers_.empty()) {
-         handlers_.top()->execute();
+         execute_top();
          handlers_.pop();
       }
    }
@@ -35,7 +91,7 @@ public:
    bool execute_highest()
    {
       if( !handlers_.empty() ) {
-         handlers_.top()->execute();
+         execute_top();
          handlers_.pop();
       }
 
@@ -44,6 +100,31 @@ public:
 
    size_t size() { return handlers_.size(); }
 
+   /// Handlers queued while enabled are timed, which takes two clock reads and a lock per handler
+   void enable_stats( bool on ) { stats_enabled_ = on; }
+   bool stats_enabled() const { return stats_enabled_; }
+
+   /// Safe to call from any thread
+   execution_stats get_stats( size_t max_sites = 20 ) const
+   {
+      execution_stats result;
+      std::lock_guard<std::mutex> g( stats_mtx_ );
+      result.levels = levels_;
+      result.sites.reserve( sites_.size() );
+      for( const auto& s : sites_ ) {
+         result.sites.push_back( s.second );
+         result.sites.back().name = boost::core::demangle( s.first.name() );
+      }
+      auto by_run_us = []( const execution_stats::site& a, const execution_stats::site& b ) { return a.run_us > b.run_us; };
+      if( result.sites.size() > max_sites ) {
+         std::partial_sort( result.sites.begin(), result.sites.begin() + max_sites, result.sites.end(), by_run_us );
+         result.sites.resize( max_sites );
+      } else {
+         std::sort( result.sites.begin(), result.sites.end(), by_run_us );
+      }
+      return result;
+   }
+
    class executor
    {
    public:
@@ -104,6 +185,9 @@ private:
    class queued_handler_base
    {
    public:
+      std::chrono::steady_clock::time_point queued_at_; ///< only set while stats are enabled
+      const std::type_info*                 site_ = nullptr;
+
       queued_handler_base( int p, size_t order )
             : priority_( p )
             , order_( order )
@@ -146,7 +230,47 @@ private:
       Function function_;
    };
 
+   void execute_top()
+   {
+      auto& handler = *handlers_.top();
+      if( !handler.site_ ) {
+         handler.execute();
+         return;
+      }
+      const auto start = std::chrono::steady_clock::now();
+      try {
+         handler.execute();
+      } catch( ... ) {
+         record( handler, start );
+         throw;
+      }
+      record( handler, start );
+   }
+
+   void record( const queued_handler_base& handler, std::chrono::steady_clock::time_point start )
+   {
+      using std::chrono::duration_cast;
+      using std::chrono::microseconds;
+      const auto end = std::chrono::steady_clock::now();
+      const uint64_t wait_us = duration_cast<microseconds>( start - handler.queued_at_ ).count();
+      const uint64_t run_us = duration_cast<microseconds>( end - start ).count();
+      std::lock_guard<std::mutex> g( stats_mtx_ );
+      auto& level = levels_[handler.priority()];
+      --level.queued;
+      level.wait_us.observe( wait_us );
+      level.run_us.observe( run_us );
+      auto& site = sites_[std::type_index( *handler.site_ )];
+      ++site.executed;
+      site.run_us += run_us;
+      site.max_run_us = std::max( site.max_run_us, run_us );
+      site.wait_us += wait_us;
+   }
+
    std::priority_queue<std::unique_ptr<queued_handler_base>, std::deque<std::unique_ptr<queued_handler_base>>> handlers_;
+   std::atomic<bool>                                                     stats_enabled_{false};
+   mutable std::mutex                                                    stats_mtx_;
+   std::map<int, execution_stats::level>                                 levels_;
+   std::unordered_map<std::type_index, execution_stats::site>            sites_;
    std::size_t order_ = std::numeric_limits<size_t>::max(); // to maintain FIFO ordering in queue within priority
 };
 
@@ -18,6 +18,115 @@ using namespace boost;
 namespace roxe { namespace chain {
 
    const size_t abi_serializer::max_recursion_depth;
+   const uint32_t abi_serializer::max_decode_plan_depth;
+
+   namespace impl {
+      /// decodes one value of a resolved type, see abi_serializer::compile_decode_plans
+      struct decode_plan {
+         enum class kind_type : uint8_t {
+            built_in,
+            array,
+            optional,
+            structure
+         };
+
+         struct field {
+            string                              name;
+            bool                                extension = false;
+            std::shared_ptr<const decode_plan>  plan;
+         };
+
+         kind_type                           kind = kind_type::built_in;
+         bool                                built_in_array = false;
+         bool                                built_in_optional = false;
+         abi_serializer::unpack_function     unpack;    ///< built_in
+         std::shared_ptr<const decode_plan>  element;   ///< array and optional
+         vector<field>                       fields;    ///< structure, the fields of its bases first
+         uint32_t                            depth = 1; ///< plans nested in this one, including itself
+
+         fc::variant run( fc::datastream<const char*>& stream, const abi_traverse_context& ctx )const {
+            switch( kind ) {
+               case kind_type::built_in:
+                  return unpack( stream, built_in_array, built_in_optional );
+               case kind_type::array: {
+                  fc::unsigned_int size;
+                  fc::raw::unpack( stream, size );
+                  vector<fc::variant> vars;
+                  vars.reserve( std::min<size_t>( size.value, stream.remaining() ) );
+                  for( decltype(size.value) i = 0; i < size; ++i ) {
+                     vars.emplace_back( element->run( stream, ctx ) );
+                     ROXE_ASSERT( !vars.back().is_null(), unpack_exception, "Invalid packed array" );
+                  }
+                  return fc::variant( std::move(vars) );
+               }
+               case kind_type::optional: {
+                  char flag;
+                  fc::raw::unpack( stream, flag );
+                  return flag ? element->run( stream, ctx ) : fc::variant();
+               }
+               case kind_type::structure:
+                  break;
+            }
+            ctx.check_deadline();
+            fc::mutable_variant_object mvo;
+            mvo.reserve( fields.size() );
+            for( const auto& f : fields ) {
+               if( !stream.remaining() ) {
+                  if( f.extension ) continue;
+                  ROXE_THROW( unpack_exception, "Stream unexpectedly ended" );
+               }
+               mvo( f.name, f.plan->run( stream, ctx ) );
+            }
+            ROXE_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack empty struct" );
+            return fc::variant( std::move(mvo) );
+         }
+
+         /// writes what run() would return as JSON, @return false if that was null
+         bool write( fc::datastream<const char*>& stream, const abi_traverse_context& ctx, fc::json_writer& writer )const {
+            switch( kind ) {
+               case kind_type::built_in: {
+                  const auto v = unpack( stream, built_in_array, built_in_optional );
+                  writer.value( v );
+                  return !v.is_null();
+               }
+               case kind_type::array: {
+                  fc::unsigned_int size;
+                  fc::raw::unpack( stream, size );
+                  writer.begin_array();
+                  for( decltype(size.value) i = 0; i < size; ++i ) {
+                     ROXE_ASSERT( element->write( stream, ctx, writer ), unpack_exception, "Invalid packed array" );
+                  }
+                  writer.end_array();
+                  return true;
+               }
+               case kind_type::optional: {
+                  char flag;
+                  fc::raw::unpack( stream, flag );
+                  if( flag ) return element->write( stream, ctx, writer );
+                  writer.null_value();
+                  return false;
+               }
+               case kind_type::structure:
+                  break;
+            }
+            ctx.check_deadline();
+            writer.begin_object();
+            size_t written = 0;
+            for( const auto& f : fields ) {
+               if( !stream.remaining() ) {
+                  if( f.extension ) continue;
+                  ROXE_THROW( unpack_exception, "Stream unexpectedly ended" );
+               }
+               writer.key( f.name );
+               f.plan->write( stream, ctx, writer );
+               ++written;
+            }
+            ROXE_ASSERT( written > 0, unpack_exception, "Unable to unpack empty struct" );
+            writer.end_object();
+            return true;
+         }
+      };
+   }
 
    using boost::algorithm::ends_with;
    using std::string;
@@ -136,6 +245,8 @@ namespace roxe { namespace chain {
       for( const auto& v : abi.variants.value )
          variants[v.name] = v;
 
+      decode_plans.clear();
+
       /**
        *  The ABI vector may contain duplicates which would make it
        *  an invalid ABI
@@ -381,6 +492,9 @@ namespace roxe { namespace chain {
    {
       auto h = ctx.enter_scope();
       fc::datastream<const char*> ds( binary.data(), binary.size() );
+      fc::variant result;
+      if( _decode_with_plan( type, ds, result, ctx ) )
+         return result;
       return _binary_to_variant(type, ds, ctx);
    }
 
@@ -393,9 +507,117 @@ namespace roxe { namespace chain {
    fc::variant abi_serializer::binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, const fc::microseconds& max_serialization_time, bool short_path )const {
       impl::binary_to_variant_context ctx(*this, max_serialization_time, type);
       ctx.short_path = short_path;
+      fc::variant result;
+      if( _decode_with_plan( type, binary, result, ctx ) )
+         return result;
       return _binary_to_variant(type, binary, ctx);
    }
 
+   void abi_serializer::binary_to_json( const type_name& type, const bytes& binary, fc::json_writer& writer,
+                                        const fc::microseconds& max_serialization_time, bool short_path )const {
+      impl::binary_to_variant_context ctx(*this, max_serialization_time, type);
+      ctx.short_path = short_path;
+      auto h = ctx.enter_scope();
+      auto itr = decode_plans.find( type );
+      if( itr != decode_plans.end() && ctx.get_recursion_depth() + 2 * itr->second->depth + 2 < max_recursion_depth ) {
+         fc::datastream<const char*> ds( binary.data(), binary.size() );
+         const auto m = writer.get_mark();
+         try {
+            itr->second->write( ds, ctx, writer );
+            return;
+         } catch( const abi_serialization_deadline_exception& ) {
+            writer.rollback( m );
+            throw;
+         } catch( const fc::exception& ) {
+         } catch( const std::exception& ) {
+         }
+         writer.rollback( m );
+      }
+      fc::datastream<const char*> ds( binary.data(), binary.size() );
+      writer.value( _binary_to_variant( type, ds, ctx ) );
+   }
+
+   void abi_serializer::compile_decode_plans() {
+      map<type_name, std::shared_ptr<const impl::decode_plan>> compiled;
+      decode_plans.clear();
+      auto add = [&]( const type_name& type ) {
+         if( decode_plans.count( type ) ) return;
+         auto plan = _compile_decode_plan( type, 1, compiled );
+         if( plan && plan->kind == impl::decode_plan::kind_type::structure )
+            decode_plans.emplace( type, std::move(plan) );
+      };
+      for( const auto& a : actions )
+         add( a.second );
+      for( const auto& t : tables )
+         add( t.second );
+   }
+
+   std::shared_ptr<const impl::decode_plan> abi_serializer::_compile_decode_plan( const type_name& type, uint32_t depth,
+                                                                                  map<type_name, std::shared_ptr<const impl::decode_plan>>& compiled )const {
+      using impl::decode_plan;
+      if( depth > max_decode_plan_depth ) return nullptr;
+      const type_name rtype = resolve_type( type );
+      auto itr = compiled.find( rtype );
+      if( itr != compiled.end() && itr->second->depth + depth - 1 <= max_decode_plan_depth ) return itr->second;
+
+      auto plan = std::make_shared<decode_plan>();
+      const auto ftype = fundamental_type( rtype );
+      auto btype = built_in_types.find( ftype );
+      if( btype != built_in_types.end() ) {
+         plan->kind = decode_plan::kind_type::built_in;
+         plan->built_in_array = is_array( rtype );
+         plan->built_in_optional = is_optional( rtype );
+         plan->unpack = btype->second.first;
+      } else if( is_array( rtype ) || is_optional( rtype ) ) {
+         plan->kind = is_array( rtype ) ? decode_plan::kind_type::array : decode_plan::kind_type::optional;
+         plan->element = _compile_decode_plan( ftype, depth + 1, compiled );
+         if( !plan->element ) return nullptr;
+         plan->depth = plan->element->depth + 1;
+      } else {
+         if( variants.count( rtype ) ) return nullptr;
+         plan->kind = decode_plan::kind_type::structure;
+         vector<const struct_def*> chain_of_bases;
+         for( auto s_itr = structs.find( rtype ); ; s_itr = structs.find( resolve_type( s_itr->second.base ) ) ) {
+            if( s_itr == structs.end() || chain_of_bases.size() > max_decode_plan_depth ) return nullptr;
+            chain_of_bases.push_back( &s_itr->second );
+            if( s_itr->second.base == type_name() ) break;
+         }
+         for( auto st = chain_of_bases.rbegin(); st != chain_of_bases.rend(); ++st ) {
+            for( const auto& field : (*st)->fields ) {
+               decode_plan::field f;
+               f.name = field.name;
+               f.extension = ends_with( field.type, "$" );
+               f.plan = _compile_decode_plan( f.extension ? _remove_bin_extension( field.type ) : field.type, depth + 1, compiled );
+               if( !f.plan ) return nullptr;
+               plan->depth = std::max( plan->depth, f.plan->depth + 1 );
+               plan->fields.emplace_back( std::move(f) );
+            }
+         }
+      }
+      compiled[rtype] = plan;
+      return plan;
+   }
+
+   bool abi_serializer::_decode_with_plan( const type_name& type, fc::datastream<const char*>& stream, fc::variant& result,
+                                           impl::binary_to_variant_context& ctx )const {
+      if( decode_plans.empty() ) return false;
+      auto itr = decode_plans.find( type );
+      if( itr == decode_plans.end() ) return false;
+      // the interpreter enters about two scopes per nested plan, what it would reject is left to it
+      if( ctx.get_recursion_depth() + 2 * itr->second->depth + 2 >= max_recursion_depth ) return false;
+      const auto start = stream;
+      try {
+         result = itr->second->run( stream, ctx );
+         return true;
+      } catch( const abi_serialization_deadline_exception& ) {
+         throw;
+      } catch( const fc::exception& ) {
+      } catch( const std::exception& ) {
+      }
+      stream = start;
+      return false;
+   }
+
    void abi_serializer::_variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char *>& ds, impl::variant_to_binary_context& ctx )const
    { try {
       auto h = ctx.enter_scope();
@@ -0,0 +1,82 @@
+#include <roxe/chain/abi_serializer_cache.hpp>
+#include <roxe/chain/account_object.hpp>
+
+namespace roxe { namespace chain {
+
+   abi_serializer_cache::cached_abi_ptr abi_serializer_cache::get( const chainbase::database& db, account_name n,
+                                                                  const fc::microseconds& max_serialization_time ) {
+      const auto* meta = db.find<account_metadata_object, by_name>( n );
+      if( !meta ) return cached_abi_ptr();
+      const uint64_t abi_sequence = meta->abi_sequence;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         auto itr = entries.find( n );
+         if( itr != entries.end() ) {
+            if( itr->second.abi_sequence == abi_sequence ) {
+               lru.splice( lru.begin(), lru, itr->second.lru_position );
+               return itr->second.abi;
+            }
+            lru.erase( itr->second.lru_position );
+            entries.erase( itr );
+         }
+      }
+
+      const auto* a = db.find<account_object, by_name>( n );
+      if( !a ) return cached_abi_ptr();
+      auto result = std::make_shared<cached_abi>();
+      if( !abi_serializer::to_abi( a->abi, result->abi ) ) return cached_abi_ptr();
+      result->serializer.set_abi( result->abi, max_serialization_time );
+      result->serializer.compile_decode_plans();
+
+      std::lock_guard<std::mutex> g( mtx );
+      if( max_size == 0 || entries.count( n ) ) return result;
+      while( entries.size() >= max_size ) {
+         entries.erase( lru.back() );
+         lru.pop_back();
+      }
+      lru.push_front( n );
+      entries[n] = entry{ abi_sequence, result, lru.begin() };
+      return result;
+   }
+
+   optional<abi_serializer> abi_serializer_cache::get_serializer( const chainbase::database& db, account_name n,
+                                                                  const fc::microseconds& max_serialization_time ) {
+      if( n.good() ) {
+         try {
+            auto cached = get( db, n, max_serialization_time );
+            if( cached )
+               return cached->serializer;
+         } FC_CAPTURE_AND_LOG((n))
+      }
+      return optional<abi_serializer>();
+   }
+
+   void abi_serializer_cache::invalidate( account_name n ) {
+      std::lock_guard<std::mutex> g( mtx );
+      auto itr = entries.find( n );
+      if( itr == entries.end() ) return;
+      lru.erase( itr->second.lru_position );
+      entries.erase( itr );
+   }
+
+   void abi_serializer_cache::clear() {
+      std::lock_guard<std::mutex> g( mtx );
+      entries.clear();
+      lru.clear();
+   }
+
+   void abi_serializer_cache::set_max_size( size_t s ) {
+      std::lock_guard<std::mutex> g( mtx );
+      max_size = s;
+      while( entries.size() > max_size ) {
+         entries.erase( lru.back() );
+         lru.pop_back();
+      }
+   }
+
+   size_t abi_serializer_cache::size()const {
+      std::lock_guard<std::mutex> g( mtx );
+      return entries.size();
+   }
+
+} } // roxe::chain
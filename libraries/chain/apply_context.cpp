@@ -17,7 +17,7 @@ using boost::container::flat_set;
 namespace roxe { namespace chain {
 
 static inline void print_debug(account_name receiver, const action_trace& ar) {
-   if (!ar.console.empty()) {
+   if (!ar.console.empty() && fc::logger::get(DEFAULT_LOGGER).is_enabled(fc::log_level::debug)) {
       auto prefix = fc::format_string(
                                       "\n[(${a},${n})->${r}]",
                                       fc::mutable_variant_object()
@@ -37,11 +37,17 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
 ,recurse_depth(depth)
 ,first_receiver_action_ordinal(action_ordinal)
 ,action_ordinal(action_ordinal)
-,idx64(*this)
-,idx128(*this)
-,idx256(*this)
-,idx_double(*this)
-,idx_long_double(*this)
+,_scratch(acquire_scratch())
+,idx64(*this, _scratch->idx64_cache)
+,idx128(*this, _scratch->idx128_cache)
+,idx256(*this, _scratch->idx256_cache)
+,idx_double(*this, _scratch->idx_double_cache)
+,idx_long_double(*this, _scratch->idx_long_double_cache)
+,keyval_cache(_scratch->keyval_cache)
+,_table_lookup_cache(_scratch->table_lookup_cache)
+,_notified(_scratch->notified)
+,_inline_actions(_scratch->inline_actions)
+,_cfa_inline_actions(_scratch->cfa_inline_actions)
 {
    action_trace& trace = trx_ctx.get_action_trace(action_ordinal);
    act = &trace.act;
@@ -49,9 +55,47 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
    context_free = trace.context_free;
 }
 
+void apply_context::scratch::clear() {
+   keyval_cache.clear();
+   idx64_cache.clear();
+   idx128_cache.clear();
+   idx256_cache.clear();
+   idx_double_cache.clear();
+   idx_long_double_cache.clear();
+   table_lookup_cache.clear();
+   notified.clear();
+   inline_actions.clear();
+   cfa_inline_actions.clear();
+}
+
+vector<std::unique_ptr<apply_context::scratch>>& apply_context::scratch_pool() {
+   thread_local vector<std::unique_ptr<scratch>> pool;
+   return pool;
+}
+
+apply_context::scratch_ptr apply_context::acquire_scratch() {
+   auto& pool = scratch_pool();
+   if( pool.empty() )
+      return scratch_ptr( new scratch() );
+   scratch_ptr s( pool.back().release() );
+   pool.pop_back();
+   return s;
+}
+
+void apply_context::scratch_deleter::operator()( scratch* s )const {
+   // contexts only nest as deep as inline actions and notifications recurse
+   constexpr size_t max_pooled = 16;
+   std::unique_ptr<scratch> owned( s );
+   auto& pool = scratch_pool();
+   if( pool.size() >= max_pooled )
+      return;
+   owned->clear();
+   pool.push_back( std::move(owned) );
+}
+
 void apply_context::exec_one()
 {
-   auto start = fc::time_point::now();
+   auto start = trx_context.detailed_traces ? fc::time_point::now() : fc::time_point();
 
    action_receipt r;
    r.receiver         = receiver;
@@ -61,14 +105,16 @@ void apply_context::exec_one()
    const account_metadata_object* receiver_account = nullptr;
    try {
       try {
-         receiver_account = &db.get<account_metadata_object,by_name>( receiver );
+         const auto dispatch = control.get_receiver_dispatch( receiver );
+         receiver_account = dispatch.account;
          privileged = receiver_account->is_privileged();
-         auto native = control.find_apply_handler( receiver, act->account, act->name );
+         auto native = dispatch.has_native_handlers ? control.find_apply_handler( receiver, act->account, act->name ) : nullptr;
          if( native ) {
             if( trx_context.enforce_whiteblacklist && control.is_producing_block() ) {
                control.check_contract_list( receiver );
                control.check_action_list( act->account, act->name );
             }
+            if( trx_context.table_access ) trx_context.table_access->native_writes = true;
             (*native)( *this );
          }
 
@@ -83,9 +129,16 @@ void apply_context::exec_one()
                control.check_contract_list( receiver );
                control.check_action_list( act->account, act->name );
             }
-            try {
-               control.get_wasm_interface().apply( receiver_account->code_hash, receiver_account->vm_type, receiver_account->vm_version, *this );
-            } catch( const wasm_exit& ) {}
+            const auto* native_code = dispatch.has_native_handlers
+                                    ? control.find_native_contract_action( receiver, receiver_account->code_hash, act->account, act->name )
+                                    : nullptr;
+            if( native_code ) {
+               (*native_code)( *this );
+            } else {
+               try {
+                  control.get_wasm_interface().apply( receiver_account->code_hash, receiver_account->vm_type, receiver_account->vm_version, *this );
+               } catch( const wasm_exit& ) {}
+            }
          }
 
          if( !privileged && control.is_builtin_activated( builtin_protocol_feature_t::ram_restrictions ) ) {
@@ -131,7 +184,7 @@ void apply_context::exec_one()
    if( act->account == receiver ) {
       first_receiver_account = receiver_account;
    } else {
-      first_receiver_account = &db.get<account_metadata_object, by_name>(act->account);
+      first_receiver_account = control.get_receiver_dispatch( act->account ).account;
    }
 
    r.code_sequence    = first_receiver_account->code_sequence; // could be modified by action execution above
@@ -153,8 +206,38 @@ void apply_context::exec_one()
    }
 }
 
+bool apply_context::console_enabled()const {
+   return trx_context.detailed_traces && control.console_output_enabled();
+}
+
+void apply_context::console_append( const char* data, size_t len ) {
+   static const char truncated_marker[] = "\n<console output truncated>";
+   static constexpr size_t initial_reserve = 1024;
+
+   auto& left = trx_context.console_bytes_left;
+   if( _pending_console_output.capacity() == 0 )
+      _pending_console_output.reserve( std::min<size_t>( left, initial_reserve ) + sizeof(truncated_marker) );
+   if( len <= left ) {
+      _pending_console_output.append( data, len );
+      left -= len;
+      return;
+   }
+   if( trx_context.console_truncated )
+      return;
+   _pending_console_output.append( data, left );
+   _pending_console_output.append( truncated_marker, sizeof(truncated_marker) - 1 );
+   left = 0;
+   trx_context.console_truncated = true;
+}
+
 void apply_context::finalize_trace( action_trace& trace, const fc::time_point& start )
 {
+   if( !trx_context.detailed_traces ) {
+      _account_ram_deltas.clear();
+      _pending_console_output.clear();
+      return;
+   }
+
    trace.account_ram_deltas = std::move( _account_ram_deltas );
    _account_ram_deltas.clear();
 
@@ -462,7 +545,11 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
       }
    }
 
+   // packed once, for the generated_transaction_object and for the controller to run it from when it is retired
+   const auto ptrx = std::make_shared<packed_transaction>( signed_transaction( std::move(trx), {}, vector<bytes>() ) );
+
    uint32_t trx_size = 0;
+   transaction_id_type gto_trx_id;
    if ( auto ptr = db.find<generated_transaction_object,by_sender_id>(boost::make_tuple(receiver, sender_id)) ) {
       ROXE_ASSERT( replace_existing, deferred_tx_duplicate, "deferred transaction with the same sender_id and payer already exists" );
 
@@ -482,7 +569,7 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
 
       transaction_id_type trx_id_for_new_obj;
       if( replace_deferred_activated ) {
-         trx_id_for_new_obj = trx.id();
+         trx_id_for_new_obj = ptrx->id();
       } else {
          trx_id_for_new_obj = ptr->trx_id;
       }
@@ -498,11 +585,12 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
          gtx.delay_until = gtx.published + delay;
          gtx.expiration  = gtx.delay_until + fc::seconds(control.get_global_properties().configuration.deferred_trx_expiration_window);
 
-         trx_size = gtx.set( trx );
+         trx_size = gtx.set( *ptrx );
       } );
+      gto_trx_id = trx_id_for_new_obj;
    } else {
       db.create<generated_transaction_object>( [&]( auto& gtx ) {
-         gtx.trx_id      = trx.id();
+         gtx.trx_id      = ptrx->id();
          gtx.sender      = receiver;
          gtx.sender_id   = sender_id;
          gtx.payer       = payer;
@@ -510,9 +598,11 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
          gtx.delay_until = gtx.published + delay;
          gtx.expiration  = gtx.delay_until + fc::seconds(control.get_global_properties().configuration.deferred_trx_expiration_window);
 
-         trx_size = gtx.set( trx );
+         trx_size = gtx.set( *ptrx );
       } );
+      gto_trx_id = ptrx->id();
    }
+   control.cache_scheduled_transaction( gto_trx_id, ptrx );
 
    ROXE_ASSERT( ram_restrictions_activated
                || control.is_ram_billing_in_notify_allowed()
@@ -553,28 +643,49 @@ uint32_t apply_context::schedule_action( action&& act_to_schedule, account_name
    return scheduled_action_ordinal;
 }
 
+void apply_context::record_table_write( const table_id_object& tid ) {
+   if( trx_context.table_access ) trx_context.table_access->record_write( tid.code, tid.scope, tid.table );
+   control.record_table_change( tid.code, tid.scope, tid.table );
+}
+
 const table_id_object* apply_context::find_table( name code, name scope, name table ) {
-   return db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   if( trx_context.table_access ) trx_context.table_access->record_read( code, scope, table );
+
+   const auto key = std::make_tuple( code, scope, table );
+   auto itr = _table_lookup_cache.find( key );
+   if( itr != _table_lookup_cache.end() ) return itr->second;
+
+   const auto* tid = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   if( tid ) _table_lookup_cache.emplace( key, tid );
+   return tid;
 }
 
 const table_id_object& apply_context::find_or_create_table( name code, name scope, name table, const account_name &payer ) {
+   const auto key = std::make_tuple( code, scope, table );
+   auto itr = _table_lookup_cache.find( key );
+   if( itr != _table_lookup_cache.end() ) return *itr->second;
+
    const auto* existing_tid =  db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
    if (existing_tid != nullptr) {
+      _table_lookup_cache.emplace( key, existing_tid );
       return *existing_tid;
    }
 
    update_db_usage(payer, config::billable_size_v<table_id_object>);
 
-   return db.create<table_id_object>([&](table_id_object &t_id){
+   const auto& tid = db.create<table_id_object>([&](table_id_object &t_id){
       t_id.code = code;
       t_id.scope = scope;
       t_id.table = table;
       t_id.payer = payer;
    });
+   _table_lookup_cache.emplace( key, &tid );
+   return tid;
 }
 
 void apply_context::remove_table( const table_id_object& tid ) {
    update_db_usage(tid.payer, - config::billable_size_v<table_id_object>);
+   _table_lookup_cache.erase( std::make_tuple( tid.code, tid.scope, tid.table ) );
    db.remove(tid);
 }
 
@@ -655,6 +766,7 @@ int apply_context::db_store_i64( uint64_t scope, uint64_t table, const account_n
 int apply_context::db_store_i64( uint64_t code, uint64_t scope, uint64_t table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size ) {
 //   require_write_lock( scope );
    const auto& tab = find_or_create_table( code, scope, table, payer );
+   record_table_write( tab );
    auto tableid = tab.id;
 
    ROXE_ASSERT( payer != account_name(), invalid_table_payer, "must specify a valid account to pay for new record" );
@@ -682,6 +794,7 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
 
    const auto& table_obj = keyval_cache.get_table( obj.t_id );
    ROXE_ASSERT( table_obj.code == receiver, table_access_violation, "db access violation" );
+   record_table_write( table_obj );
 
 //   require_write_lock( table_obj.scope );
 
@@ -712,6 +825,7 @@ void apply_context::db_remove_i64( int iterator ) {
 
    const auto& table_obj = keyval_cache.get_table( obj.t_id );
    ROXE_ASSERT( table_obj.code == receiver, table_access_violation, "db access violation" );
+   record_table_write( table_obj );
 
 //   require_write_lock( table_obj.scope );
 
@@ -796,7 +910,7 @@ int apply_context::db_find_i64( uint64_t code, uint64_t scope, uint64_t table, u
 
    auto table_end_itr = keyval_cache.cache_table( *tab );
 
-   const key_value_object* obj = db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab->id, id ) );
+   const key_value_object* obj = db.find<key_value_object, by_scope_primary_hash>( boost::make_tuple( tab->id, id ) );
    if( !obj ) return table_end_itr;
 
    return keyval_cache.add( *obj );
@@ -858,7 +972,7 @@ uint64_t apply_context::next_recv_sequence( const account_metadata_object& recei
    return receiver_account.recv_sequence;
 }
 uint64_t apply_context::next_auth_sequence( account_name actor ) {
-   const auto& amo = db.get<account_metadata_object,by_name>( actor );
+   const auto& amo = *control.get_receiver_dispatch( actor ).account;
    db.modify( amo, [&](auto& am ){
       ++am.auth_sequence;
    });
@@ -5,6 +5,8 @@
 #include <roxe/chain/asset.hpp>
 #include <boost/rational.hpp>
 #include <fc/reflect/variant.hpp>
+#include <algorithm>
+#include <cctype>
 
 namespace roxe { namespace chain {
 
@@ -21,53 +23,70 @@ int64_t asset::precision()const {
 }
 
 string asset::to_string()const {
-   string sign = amount < 0 ? "-" : "";
-   int64_t abs_amount = std::abs(amount);
-   string result = fc::to_string( static_cast<int64_t>(abs_amount) / precision());
-   if( decimals() )
-   {
-      auto fract = static_cast<int64_t>(abs_amount) % precision();
-      result += "." + fc::to_string(precision() + fract).erase(0,1);
+   // sign, 19 integer digits, 18 decimals, the separators and a 7 character symbol name
+   char buffer[48];
+   char* pos = buffer + 20;
+   const uint64_t abs_amount = amount < 0 ? 0 - uint64_t(amount) : uint64_t(amount);
+   const uint64_t p = precision();
+
+   // integer part is written backwards ending at buffer + 20
+   uint64_t int_part = abs_amount / p;
+   do {
+      *--pos = '0' + int_part % 10;
+      int_part /= 10;
+   } while( int_part );
+   if( amount < 0 )
+      *--pos = '-';
+   char* begin = pos;
+
+   pos = buffer + 20;
+   if( uint8_t d = decimals() ) {
+      *pos++ = '.';
+      uint64_t fract = abs_amount % p;
+      for( char* digit = pos + d - 1; digit >= pos; --digit ) {
+         *digit = '0' + fract % 10;
+         fract /= 10;
+      }
+      pos += d;
    }
-   return sign + result + " " + symbol_name();
+   *pos++ = ' ';
+   return string( begin, sym.write_name( pos ) );
 }
 
 asset asset::from_string(const string& from)
 {
    try {
-      string s = fc::trim(from);
+      // trim and split in place rather than copying each part of the string
+      auto is_space = []( char c ) { return std::isspace( static_cast<unsigned char>(c) ) != 0; };
+      const char* begin = from.data();
+      const char* end = begin + from.size();
+      while( begin != end && is_space(*begin) ) ++begin;
+      while( begin != end && is_space(*(end - 1)) ) --end;
 
       // Find space in order to split amount and symbol
-      auto space_pos = s.find(' ');
-      ROXE_ASSERT((space_pos != string::npos), asset_type_exception, "Asset's amount and symbol should be separated with space");
-      auto symbol_str = fc::trim(s.substr(space_pos + 1));
-      auto amount_str = s.substr(0, space_pos);
+      const char* space = std::find(begin, end, ' ');
+      ROXE_ASSERT((space != end), asset_type_exception, "Asset's amount and symbol should be separated with space");
+      const char* symbol_begin = std::find_if_not(space + 1, end, is_space);
 
       // Ensure that if decimal point is used (.), decimal fraction is specified
-      auto dot_pos = amount_str.find('.');
-      if (dot_pos != string::npos) {
-         ROXE_ASSERT((dot_pos != amount_str.size() - 1), asset_type_exception, "Missing decimal fraction after decimal point");
+      const char* dot = std::find(begin, space, '.');
+      if (dot != space) {
+         ROXE_ASSERT((dot != space - 1), asset_type_exception, "Missing decimal fraction after decimal point");
       }
 
       // Parse symbol
-      string precision_digit_str;
-      if (dot_pos != string::npos) {
-         precision_digit_str = roxe::chain::to_string(amount_str.size() - dot_pos - 1);
-      } else {
-         precision_digit_str = "0";
-      }
-
-      string symbol_part = precision_digit_str + ',' + symbol_str;
-      symbol sym = symbol::from_string(symbol_part);
+      const size_t precision_digits = dot != space ? space - dot - 1 : 0;
+      ROXE_ASSERT( precision_digits <= symbol::max_precision, symbol_type_exception, "precision ${p} should be <= 18", ("p", precision_digits));
+      symbol sym(string_to_symbol(precision_digits, string(symbol_begin, end).c_str()));
 
       // Parse amount
       safe<int64_t> int_part, fract_part;
-      if (dot_pos != string::npos) {
-         int_part = fc::to_int64(amount_str.substr(0, dot_pos));
-         fract_part = fc::to_int64(amount_str.substr(dot_pos + 1));
-         if (amount_str[0] == '-') fract_part *= -1;
+      if (dot != space) {
+         int_part = fc::to_int64(begin, dot - begin);
+         fract_part = fc::to_int64(dot + 1, space - dot - 1);
+         if (*begin == '-') fract_part *= -1;
       } else {
-         int_part = fc::to_int64(amount_str);
+         int_part = fc::to_int64(begin, space - begin);
       }
 
       safe<int64_t> amount = int_part;
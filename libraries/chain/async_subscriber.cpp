@@ -0,0 +1,76 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/chain/async_subscriber.hpp>
+#include <roxe/chain/exceptions.hpp>
+#include <fc/log/logger_config.hpp>
+
+namespace roxe { namespace chain {
+
+   async_subscriber::async_subscriber( std::string n, size_t max_size )
+   : name( std::move( n ) )
+   , max_queue_size( std::max<size_t>( max_size, 1 ) )
+   , queued_gauge( fc::metrics::registry::instance().add_gauge( "roxe_async_subscriber_queued",
+                   "Controller signals queued for the subscriber's thread", {{"subscriber", name}} ) )
+   , waits( fc::metrics::registry::instance().add_counter( "roxe_async_subscriber_full_waits_total",
+            "Signals which waited for room in the subscriber's full queue", {{"subscriber", name}} ) )
+   , thread( [this]() { run(); } )
+   {}
+
+   async_subscriber::~async_subscriber() {
+      stop();
+   }
+
+   void async_subscriber::post( std::function<void()> f ) {
+      std::unique_lock<std::mutex> g( mtx );
+      if( stopping )
+         return;
+      if( queue.size() >= max_queue_size ) {
+         waits.inc();
+         not_full.wait( g, [this]() { return queue.size() < max_queue_size || stopping; } );
+         if( stopping )
+            return;
+      }
+      queue.emplace_back( std::move( f ) );
+      queued_gauge.set( queue.size() );
+      not_empty.notify_one();
+   }
+
+   void async_subscriber::run() {
+      fc::set_os_thread_name( name );
+      std::unique_lock<std::mutex> g( mtx );
+      while( true ) {
+         not_empty.wait( g, [this]() { return stopping || !queue.empty(); } );
+         if( queue.empty() )
+            return;
+         auto f = std::move( queue.front() );
+         queue.pop_front();
+         queued_gauge.set( queue.size() );
+         not_full.notify_one();
+         g.unlock();
+         try {
+            f();
+         } FC_LOG_AND_DROP( (name) )
+         g.lock();
+      }
+   }
+
+   void async_subscriber::stop() {
+      if( !thread.joinable() )
+         return;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         stopping = true;
+      }
+      not_empty.notify_one();
+      not_full.notify_all();
+      thread.join();
+   }
+
+   size_t async_subscriber::queued()const {
+      std::lock_guard<std::mutex> g( mtx );
+      return queue.size();
+   }
+
+} } // roxe::chain
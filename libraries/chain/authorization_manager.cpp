@@ -157,6 +157,7 @@ namespace roxe { namespace chain {
          p.last_updated = creation_time;
          p.auth         = auth;
       });
+      on_permission_change( account );
       return perm;
    }
 
@@ -184,6 +185,7 @@ namespace roxe { namespace chain {
          p.last_updated = creation_time;
          p.auth         = std::move(auth);
       });
+      on_permission_change( account );
       return perm;
    }
 
@@ -192,6 +194,7 @@ namespace roxe { namespace chain {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
       });
+      on_permission_change( permission.owner );
    }
 
    void authorization_manager::remove_permission( const permission_object& permission ) {
@@ -200,8 +203,10 @@ namespace roxe { namespace chain {
       ROXE_ASSERT( range.first == range.second, action_validate_exception,
                   "Cannot remove a permission which has children. Remove the children first.");
 
+      const auto owner = permission.owner;
       _db.get_mutable_index<permission_usage_index>().remove_object( permission.usage_id._id );
       _db.remove( permission );
+      on_permission_change( owner );
    }
 
    void authorization_manager::update_permission_usage( const permission_object& permission ) {
@@ -211,6 +216,47 @@ namespace roxe { namespace chain {
       });
    }
 
+   void authorization_manager::invalidate_resolution_cache() {
+      // an undo restores the epoch the cache was filled at but not the removed objects it points to
+      {
+         std::lock_guard<std::mutex> g( _resolution_cache_mtx );
+         _resolution_cache.links.clear();
+         _resolution_cache.permissions.clear();
+      }
+
+      // genesis creates permissions before the dynamic global properties exist
+      const auto* dgpo = _db.find<dynamic_global_property_object>();
+      if( dgpo == nullptr ) return;
+
+      // a fresh epoch, also above those left in the database by an earlier run
+      _last_epoch = std::max( _last_epoch, dgpo->authorization_epoch ) + 1;
+      _db.modify( *dgpo, [&]( auto& p ) {
+         p.authorization_epoch = _last_epoch;
+      });
+   }
+
+   void authorization_manager::on_permission_change( account_name owner ) {
+      if( owner == config::producers_account_name )
+         ++_producers_permission_changes;
+      invalidate_resolution_cache();
+   }
+
+   bool authorization_manager::use_resolution_cache()const {
+      // another process changes the state of a replica, its permission changes never empty this cache
+      return !_control.is_state_replica();
+   }
+
+   authorization_manager::resolution_cache& authorization_manager::current_resolution_cache()const {
+      const auto epoch = _db.get<dynamic_global_property_object>().authorization_epoch;
+      if( _resolution_cache.epoch != epoch ||
+          _resolution_cache.links.size() + _resolution_cache.permissions.size() > resolution_cache::max_entries ) {
+         _resolution_cache.links.clear();
+         _resolution_cache.permissions.clear();
+         _resolution_cache.epoch = epoch;
+      }
+      return _resolution_cache;
+   }
+
    fc::time_point authorization_manager::get_permission_last_used( const permission_object& permission )const {
       return _db.get<permission_usage_object, by_id>( permission.usage_id ).last_used;
    }
@@ -224,7 +270,20 @@ namespace roxe { namespace chain {
    const permission_object&  authorization_manager::get_permission( const permission_level& level )const
    { try {
       ROXE_ASSERT( !level.actor.empty() && !level.permission.empty(), invalid_permission, "Invalid permission" );
-      return _db.get<permission_object, by_owner>( boost::make_tuple(level.actor,level.permission) );
+      const bool cached = use_resolution_cache();
+      if( cached ) {
+         std::lock_guard<std::mutex> g( _resolution_cache_mtx );
+         auto& cache = current_resolution_cache();
+         auto itr = cache.permissions.find( level );
+         if( itr != cache.permissions.end() )
+            return *itr->second;
+      }
+      const auto& perm = _db.get<permission_object, by_owner>( boost::make_tuple(level.actor,level.permission) );
+      if( cached ) {
+         std::lock_guard<std::mutex> g( _resolution_cache_mtx );
+         current_resolution_cache().permissions.emplace( level, &perm );
+      }
+      return perm;
    } ROXE_RETHROW_EXCEPTIONS( chain::permission_query_exception, "Failed to retrieve permission: ${level}", ("level", level) ) }
 
    optional<permission_name> authorization_manager::lookup_linked_permission( account_name authorizer_account,
@@ -233,6 +292,16 @@ namespace roxe { namespace chain {
                                                                             )const
    {
       try {
+         const resolution_cache::link_key cache_key{ authorizer_account, scope, act_name };
+         const bool cached = use_resolution_cache();
+         if( cached ) {
+            std::lock_guard<std::mutex> g( _resolution_cache_mtx );
+            auto& cache = current_resolution_cache();
+            auto itr = cache.links.find( cache_key );
+            if( itr != cache.links.end() )
+               return itr->second;
+         }
+
          // First look up a specific link for this message act_name
          auto key = boost::make_tuple(authorizer_account, scope, act_name);
          auto link = _db.find<permission_link_object, by_action_name>(key);
@@ -243,10 +312,15 @@ namespace roxe { namespace chain {
          }
 
          // If no specific or default link found, use active permission
+         optional<permission_name> linked_permission;
          if (link != nullptr) {
-            return link->required_permission;
+            linked_permission = link->required_permission;
          }
-         return optional<permission_name>();
+         if( cached ) {
+            std::lock_guard<std::mutex> g( _resolution_cache_mtx );
+            current_resolution_cache().links.emplace( cache_key, linked_permission );
+         }
+         return linked_permission;
 
        //  return optional<permission_name>();
       } FC_CAPTURE_AND_RETHROW((authorizer_account)(scope)(act_name))
@@ -445,7 +519,7 @@ namespace roxe { namespace chain {
 
       auto effective_provided_delay =  (provided_delay >= delay_max_limit) ? fc::microseconds::maximum() : provided_delay;
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      auto checker = make_auth_checker( [&](const permission_level& p) -> const shared_authority& { return get_permission(p).auth; },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
@@ -546,7 +620,7 @@ namespace roxe { namespace chain {
 
       auto delay_max_limit = fc::seconds( _control.get_global_properties().configuration.max_transaction_delay );
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      auto checker = make_auth_checker( [&](const permission_level& p) -> const shared_authority& { return get_permission(p).auth; },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
@@ -577,7 +651,7 @@ namespace roxe { namespace chain {
                                                                        fc::microseconds provided_delay
                                                                      )const
    {
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      auto checker = make_auth_checker( [&](const permission_level& p) -> const shared_authority& { return get_permission(p).auth; },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         candidate_keys,
                                         {},
@@ -0,0 +1,88 @@
+#include <roxe/chain/billing_clock.hpp>
+
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ROXE_BILLING_CLOCK_TSC
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace roxe { namespace chain {
+
+#ifdef ROXE_BILLING_CLOCK_TSC
+   namespace {
+      struct tsc_calibration {
+         tsc_calibration() {
+            unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+            if( !__get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx ) || !( edx & (1u << 8) ) )
+               return; // without an invariant TSC the tick rate follows frequency scaling
+
+            using namespace std::chrono;
+            const auto begin = steady_clock::now();
+            const uint64_t begin_tsc = __rdtsc();
+            std::this_thread::sleep_for( milliseconds(10) );
+            const uint64_t end_tsc = __rdtsc();
+            const auto elapsed_us = duration_cast<microseconds>( steady_clock::now() - begin ).count();
+            if( elapsed_us <= 0 || end_tsc <= begin_tsc )
+               return;
+
+            const uint64_t ticks_per_us = (end_tsc - begin_tsc) / elapsed_us;
+            if( ticks_per_us == 0 )
+               return;
+            reanchor_ticks = ticks_per_us * 1000;
+            // 32.32 fixed point; ticks within an anchor period times this fit comfortably in 64 bits
+            us_per_tick = ( uint64_t(elapsed_us) << 32 ) / (end_tsc - begin_tsc);
+            use_tsc = true;
+         }
+
+         bool     use_tsc = false;
+         uint64_t reanchor_ticks = 0;
+         uint64_t us_per_tick = 0;
+      };
+
+      const tsc_calibration calibration;
+
+      struct tsc_anchor {
+         uint64_t tsc = 0;
+         int64_t  us = 0;
+         int64_t  last = 0;
+      };
+
+      thread_local tsc_anchor anchor;
+   }
+
+   fc::time_point billing_clock::now() {
+      if( !calibration.use_tsc )
+         return fc::time_point::now();
+
+      const uint64_t ticks = __rdtsc() - anchor.tsc;
+      int64_t us;
+      if( anchor.tsc == 0 || ticks >= calibration.reanchor_ticks ) {
+         anchor.us = fc::time_point::now().time_since_epoch().count();
+         anchor.tsc = __rdtsc();
+         us = anchor.us;
+      } else {
+         us = anchor.us + int64_t( (ticks * calibration.us_per_tick) >> 32 );
+      }
+      if( us < anchor.last )
+         us = anchor.last;
+      anchor.last = us;
+      return fc::time_point( fc::microseconds(us) );
+   }
+
+   bool billing_clock::uses_tsc() {
+      return calibration.use_tsc;
+   }
+#else
+   fc::time_point billing_clock::now() {
+      return fc::time_point::now();
+   }
+
+   bool billing_clock::uses_tsc() {
+      return false;
+   }
+#endif
+
+} } /// roxe::chain
@@ -4,8 +4,17 @@
  */
 #include <roxe/chain/block_log.hpp>
 #include <roxe/chain/exceptions.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
 #include <fstream>
+#include <mutex>
+#include <thread>
+#include <fc/log/logger_config.hpp>
 #include <fc/io/raw.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
@@ -13,6 +22,8 @@
 
 namespace roxe { namespace chain {
 
+   namespace bip = boost::interprocess;
+
    const uint32_t block_log::min_supported_version = 1;
 
    /**
@@ -24,6 +35,13 @@ namespace roxe { namespace chain {
    const uint32_t block_log::max_supported_version = 2;
 
    namespace detail {
+      struct retained_block_file {
+         uint32_t first_block_num = 0;
+         uint32_t last_block_num = 0;
+         fc::path block_file;
+         fc::path index_file;
+      };
+
       class block_log_impl {
          public:
             signed_block_ptr         head;
@@ -37,14 +55,79 @@ namespace roxe { namespace chain {
             uint32_t                 version = 0;
             uint32_t                 first_block_num = 0;
 
+            /// read only mapping of the index file, covering index_mapped_entries positions
+            std::unique_ptr<bip::mapped_region> index_region;
+            uint64_t                 index_mapped_entries = 0;
+
+            fc::path                 data_dir;
+            fc::path                 archive_dir;
+            uint32_t                 stride = 0;
+            uint32_t                 max_retained_files = 0;
+            vector<retained_block_file> retained;   ///< ordered by block number
+            std::fstream             retained_block_stream;
+            std::fstream             retained_index_stream;
+            size_t                   open_retained = std::numeric_limits<size_t>::max();
+
+            /// guards the streams and the index mapping, public methods may nest
+            std::recursive_mutex     mtx;
+
+            /// an append waiting for the writer thread: the packed block followed by its position
+            struct pending_write {
+               uint32_t     block_num = 0;
+               uint64_t     pos = 0;
+               vector<char> data;
+            };
+
+            /// with async writes appends are queued for the writer thread, which has its own streams to the files
+            bool                      async_writes = false;
+            std::thread               writer;
+            std::mutex                write_mtx;         ///< guards the queue, taken after mtx
+            std::condition_variable   write_cv;          ///< work was queued or the writer is to stop
+            std::condition_variable   written_cv;        ///< a queued append was written
+            std::deque<pending_write> write_queue;       ///< the front is removed once written
+            bool                      stop_writer = false;
+            std::string               write_error;       ///< once set the log no longer appends
+            std::fstream              writer_block_stream;
+            std::fstream              writer_index_stream;
+            /// size of the files including queued appends, found again after the files were reopened
+            bool                      write_end_known = false;
+            uint64_t                  write_end_pos = 0;
+            uint64_t                  write_index_entries = 0;
+
+            void run_writer();
+            void stop();
+            /// waits until the queue is empty, closing the writer streams if asked, so the files may be changed
+            void wait_for_writes( bool close_writer_streams = false );
+            /// waits until block_num and the blocks before it are in the files
+            void wait_for_block( uint32_t block_num );
+            /// waits until the block at pos is in the files
+            void wait_for_pos( uint64_t pos );
+            void check_write_error()const {
+               ROXE_ASSERT( write_error.empty(), block_log_append_fail, "Writing to the block log failed: ${e}", ("e", write_error) );
+            }
+
+            void scan_retained_files();
+            void close_retained();
+            /// @return the index of the retained file holding block_num, retained.size() if there is none
+            size_t find_retained( uint32_t block_num )const;
+            void open_retained_file( size_t i );
+            signed_block_ptr read_retained_block( uint32_t block_num );
+            vector<char> read_retained_serialized_block( uint32_t block_num );
+            void prune_retained_files();
+
             inline void check_open_files() {
                if( !open_files ) {
                   reopen();
                }
             }
             void reopen();
+            uint64_t read_index( uint64_t entry );
 
             void close() {
+               wait_for_writes( true );
+               write_end_known = false;
+               index_region.reset();
+               index_mapped_entries = 0;
                if( block_stream.is_open() )
                   block_stream.close();
                if( index_stream.is_open() )
@@ -68,13 +151,245 @@ namespace roxe { namespace chain {
 
          open_files = true;
       }
+
+      void block_log_impl::run_writer() {
+         fc::set_os_thread_name( "blocklog-write" );
+         std::unique_lock<std::mutex> g( write_mtx );
+         while( true ) {
+            write_cv.wait( g, [this]() { return stop_writer || !write_queue.empty(); } );
+            if( write_queue.empty() )
+               return;
+            // appends only push to the back, so the front stays put while it is written unlocked
+            const pending_write& w = write_queue.front();
+            g.unlock();
+            std::string error;
+            try {
+               if( !writer_block_stream.is_open() ) {
+                  writer_block_stream.open( block_file.generic_string().c_str(), LOG_WRITE );
+                  writer_index_stream.open( index_file.generic_string().c_str(), LOG_WRITE );
+               }
+               writer_block_stream.write( w.data.data(), w.data.size() );
+               writer_index_stream.write( (const char*)&w.pos, sizeof(w.pos) );
+               writer_block_stream.flush();
+               writer_index_stream.flush();
+            } catch( const std::exception& e ) {
+               error = e.what();
+            }
+            g.lock();
+            if( !error.empty() ) {
+               elog( "Writing block ${n} to the block log failed: ${e}", ("n", w.block_num)("e", error) );
+               write_error = error;
+               write_queue.clear();
+            } else {
+               write_queue.pop_front();
+            }
+            written_cv.notify_all();
+         }
+      }
+
+      void block_log_impl::stop() {
+         if( !writer.joinable() )
+            return;
+         {
+            std::lock_guard<std::mutex> g( write_mtx );
+            stop_writer = true;
+         }
+         write_cv.notify_one();
+         writer.join();
+         if( writer_block_stream.is_open() )
+            writer_block_stream.close();
+         if( writer_index_stream.is_open() )
+            writer_index_stream.close();
+      }
+
+      void block_log_impl::wait_for_writes( bool close_writer_streams ) {
+         if( !async_writes )
+            return;
+         std::unique_lock<std::mutex> g( write_mtx );
+         written_cv.wait( g, [this]() { return write_queue.empty(); } );
+         // the writer is idle until more is queued, which needs mtx held by the caller
+         if( close_writer_streams ) {
+            if( writer_block_stream.is_open() )
+               writer_block_stream.close();
+            if( writer_index_stream.is_open() )
+               writer_index_stream.close();
+         }
+      }
+
+      void block_log_impl::wait_for_block( uint32_t block_num ) {
+         if( !async_writes )
+            return;
+         std::unique_lock<std::mutex> g( write_mtx );
+         written_cv.wait( g, [this, block_num]() { return write_queue.empty() || write_queue.front().block_num > block_num; } );
+      }
+
+      void block_log_impl::wait_for_pos( uint64_t pos ) {
+         if( !async_writes )
+            return;
+         std::unique_lock<std::mutex> g( write_mtx );
+         written_cv.wait( g, [this, pos]() { return write_queue.empty() || write_queue.front().pos > pos; } );
+      }
+
+      uint64_t block_log_impl::read_index( uint64_t entry ) {
+         if( entry >= index_mapped_entries ) {
+            // the index has grown since it was mapped; appends are written through index_stream
+            index_stream.flush();
+            index_region.reset();
+            index_mapped_entries = 0;
+            const auto size = fc::file_size( index_file );
+            if( size >= sizeof(uint64_t) ) {
+               bip::file_mapping fm( index_file.generic_string().c_str(), bip::read_only );
+               index_region = std::make_unique<bip::mapped_region>( fm, bip::read_only, 0, size );
+               index_mapped_entries = size / sizeof(uint64_t);
+            }
+            ROXE_ASSERT( entry < index_mapped_entries, block_log_exception,
+                         "Block log index does not contain entry ${e}", ("e", entry) );
+         }
+         uint64_t pos;
+         memcpy( &pos, static_cast<const char*>( index_region->get_address() ) + entry * sizeof(uint64_t), sizeof(pos) );
+         return pos;
+      }
+
+      void block_log_impl::scan_retained_files() {
+         close_retained();
+         retained.clear();
+         for( fc::directory_iterator itr( data_dir ), end; itr != end; ++itr ) {
+            const auto name = itr->filename().generic_string();
+            uint32_t first = 0, last = 0;
+            if( sscanf( name.c_str(), "blocks-%u-%u.log", &first, &last ) != 2 ||
+                name != "blocks-" + std::to_string(first) + "-" + std::to_string(last) + ".log" || first == 0 || last < first )
+               continue;
+            retained_block_file f;
+            f.first_block_num = first;
+            f.last_block_num = last;
+            f.block_file = *itr;
+            f.index_file = data_dir / ("blocks-" + std::to_string(first) + "-" + std::to_string(last) + ".index");
+            if( !fc::is_regular_file( f.index_file ) ) {
+               wlog( "Ignoring split block log file ${f} without an index", ("f", f.block_file.generic_string()) );
+               continue;
+            }
+            retained.push_back( f );
+         }
+         std::sort( retained.begin(), retained.end(), []( const retained_block_file& a, const retained_block_file& b ) {
+            return a.first_block_num < b.first_block_num;
+         } );
+      }
+
+      void block_log_impl::close_retained() {
+         if( retained_block_stream.is_open() )
+            retained_block_stream.close();
+         if( retained_index_stream.is_open() )
+            retained_index_stream.close();
+         open_retained = std::numeric_limits<size_t>::max();
+      }
+
+      size_t block_log_impl::find_retained( uint32_t block_num )const {
+         auto itr = std::upper_bound( retained.begin(), retained.end(), block_num,
+                                      []( uint32_t n, const retained_block_file& f ) { return n < f.first_block_num; } );
+         if( itr == retained.begin() )
+            return retained.size();
+         --itr;
+         if( block_num > itr->last_block_num )
+            return retained.size();
+         return itr - retained.begin();
+      }
+
+      void block_log_impl::open_retained_file( size_t i ) {
+         if( open_retained != i ) {
+            close_retained();
+            retained_block_stream.open( retained[i].block_file.generic_string().c_str(), LOG_READ );
+            retained_index_stream.open( retained[i].index_file.generic_string().c_str(), LOG_READ );
+            open_retained = i;
+         }
+      }
+
+      signed_block_ptr block_log_impl::read_retained_block( uint32_t block_num ) {
+         const size_t i = find_retained( block_num );
+         if( i == retained.size() )
+            return {};
+         open_retained_file( i );
+         auto itr = retained.begin() + i;
+
+         uint64_t pos;
+         retained_index_stream.seekg( sizeof(uint64_t) * (block_num - itr->first_block_num) );
+         retained_index_stream.read( (char*)&pos, sizeof(pos) );
+         retained_block_stream.seekg( pos );
+         auto b = std::make_shared<signed_block>();
+         fc::raw::unpack( retained_block_stream, *b );
+         ROXE_ASSERT( b->block_num() == block_num, block_log_exception,
+                      "Wrong block was read from ${f}.", ("f", itr->block_file.generic_string())("returned", b->block_num())("expected", block_num) );
+         return b;
+      }
+
+      vector<char> read_serialized( std::fstream& s, uint64_t pos, uint64_t end ) {
+         ROXE_ASSERT( pos < end, block_log_exception, "Invalid block position ${pos}", ("pos", pos) );
+         vector<char> data( end - pos );
+         s.seekg( pos );
+         s.read( data.data(), data.size() );
+         return data;
+      }
+
+      vector<char> block_log_impl::read_retained_serialized_block( uint32_t block_num ) {
+         const size_t i = find_retained( block_num );
+         if( i == retained.size() )
+            return {};
+         open_retained_file( i );
+         const auto& f = retained[i];
+
+         uint64_t pos;
+         uint64_t end;
+         retained_index_stream.seekg( sizeof(uint64_t) * (block_num - f.first_block_num) );
+         retained_index_stream.read( (char*)&pos, sizeof(pos) );
+         if( block_num < f.last_block_num ) {
+            retained_index_stream.read( (char*)&end, sizeof(end) );
+         } else {
+            retained_block_stream.seekg( 0, std::ios::end );
+            end = retained_block_stream.tellg();
+         }
+         // every block is followed by its position
+         return read_serialized( retained_block_stream, pos, end - sizeof(uint64_t) );
+      }
+
+      void block_log_impl::prune_retained_files() {
+         if( !max_retained_files )
+            return;
+         while( retained.size() > max_retained_files ) {
+            close_retained();
+            const auto f = retained.front();
+            retained.erase( retained.begin() );
+            if( archive_dir.string().empty() ) {
+               ilog( "Removing split block log file ${f}", ("f", f.block_file.generic_string()) );
+               fc::remove_all( f.block_file );
+               fc::remove_all( f.index_file );
+            } else {
+               if( !fc::is_directory( archive_dir ) )
+                  fc::create_directories( archive_dir );
+               ilog( "Archiving split block log file ${f} to ${d}", ("f", f.block_file.generic_string())("d", archive_dir.generic_string()) );
+               fc::rename( f.block_file, archive_dir / f.block_file.filename() );
+               fc::rename( f.index_file, archive_dir / f.index_file.filename() );
+            }
+         }
+      }
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, uint32_t stride, uint32_t max_retained_files, const fc::path& archive_dir,
+                        bool async_writes)
    :my(new detail::block_log_impl()) {
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->retained_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->retained_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->writer_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->writer_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->stride = stride;
+      my->max_retained_files = max_retained_files;
+      my->archive_dir = archive_dir;
+      my->async_writes = async_writes;
       open(data_dir);
+      if( async_writes ) {
+         auto impl = my.get();
+         my->writer = std::thread( [impl]() { impl->run_writer(); } );
+      }
    }
 
    block_log::block_log(block_log&& other) {
@@ -83,8 +398,12 @@ namespace roxe { namespace chain {
 
    block_log::~block_log() {
       if (my) {
-         flush();
+         try {
+            flush();
+         } FC_LOG_AND_DROP()
+         my->stop();
          my->close();
+         my->close_retained();
          my.reset();
       }
    }
@@ -95,10 +414,12 @@ namespace roxe { namespace chain {
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
 
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
 
       my->reopen();
+      my->scan_retained_files();
 
       /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to each other.
@@ -181,31 +502,77 @@ namespace roxe { namespace chain {
       try {
          ROXE_ASSERT( my->genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written" );
 
+         std::lock_guard<std::recursive_mutex> g( my->mtx );
+
          my->check_open_files();
 
-         my->block_stream.seekp(0, std::ios::end);
-         my->index_stream.seekp(0, std::ios::end);
-         uint64_t pos = my->block_stream.tellp();
-         ROXE_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
-                   block_log_append_fail,
-                   "Append to index file occuring at wrong position.",
-                   ("position", (uint64_t) my->index_stream.tellp())
-                   ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
-         auto data = fc::raw::pack(*b);
-         my->block_stream.write(data.data(), data.size());
-         my->block_stream.write((char*)&pos, sizeof(pos));
-         my->index_stream.write((char*)&pos, sizeof(pos));
-         my->head = b;
-         my->head_id = b->id();
-
-         flush();
+         if( my->stride && my->head && b->block_num() > my->first_block_num && (b->block_num() - 1) % my->stride == 0 )
+            split();
 
-         return pos;
+         return my->async_writes ? append_async( b ) : write_block( b );
       }
       FC_LOG_AND_RETHROW()
    }
 
+   uint64_t block_log::write_block(const signed_block_ptr& b) {
+      my->block_stream.seekp(0, std::ios::end);
+      my->index_stream.seekp(0, std::ios::end);
+      uint64_t pos = my->block_stream.tellp();
+      ROXE_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
+                block_log_append_fail,
+                "Append to index file occuring at wrong position.",
+                ("position", (uint64_t) my->index_stream.tellp())
+                ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
+      auto data = fc::raw::pack(*b);
+      my->block_stream.write(data.data(), data.size());
+      my->block_stream.write((char*)&pos, sizeof(pos));
+      my->index_stream.write((char*)&pos, sizeof(pos));
+      my->head = b;
+      my->head_id = b->id();
+
+      flush();
+
+      return pos;
+   }
+
+   uint64_t block_log::append_async(const signed_block_ptr& b) {
+      my->check_write_error();
+      if( !my->write_end_known ) {
+         my->block_stream.seekp(0, std::ios::end);
+         my->index_stream.seekp(0, std::ios::end);
+         my->write_end_pos = my->block_stream.tellp();
+         my->write_index_entries = uint64_t(my->index_stream.tellp()) / sizeof(uint64_t);
+         my->write_end_known = true;
+      }
+      ROXE_ASSERT(my->write_index_entries == b->block_num() - my->first_block_num,
+                block_log_append_fail,
+                "Append to index file occuring at wrong position.",
+                ("position", my->write_index_entries * sizeof(uint64_t))
+                ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
+
+      detail::block_log_impl::pending_write w;
+      w.block_num = b->block_num();
+      w.pos = my->write_end_pos;
+      w.data = fc::raw::pack(*b);
+      w.data.insert( w.data.end(), (const char*)&w.pos, (const char*)&w.pos + sizeof(w.pos) );
+      my->write_end_pos += w.data.size();
+      ++my->write_index_entries;
+      const uint64_t pos = w.pos;
+      {
+         std::lock_guard<std::mutex> g( my->write_mtx );
+         my->write_queue.push_back( std::move(w) );
+      }
+      my->write_cv.notify_one();
+
+      my->head = b;
+      my->head_id = b->id();
+      return pos;
+   }
+
    void block_log::flush() {
+      std::lock_guard<std::recursive_mutex> g( my->mtx );
+      my->wait_for_writes();
+      my->check_write_error();
       my->block_stream.flush();
       my->index_stream.flush();
    }
@@ -218,6 +585,14 @@ namespace roxe { namespace chain {
 
       my->reopen();
 
+      // split off files that overlap the new log can no longer be served
+      while( !my->retained.empty() && my->retained.back().last_block_num >= first_block_num ) {
+         wlog( "Ignoring split block log file ${f} which overlaps the reset block log",
+               ("f", my->retained.back().block_file.generic_string()) );
+         my->close_retained();
+         my->retained.pop_back();
+      }
+
       auto data = fc::raw::pack(gs);
       my->version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
       my->first_block_num = first_block_num;
@@ -232,7 +607,8 @@ namespace roxe { namespace chain {
       my->block_stream.write((char*)&totem, sizeof(totem));
 
       if (first_block) {
-         append(first_block);
+         // written right away, the version below is only set once the block is in
+         write_block(first_block);
       } else {
          my->head.reset();
          my->head_id = {};
@@ -249,7 +625,9 @@ namespace roxe { namespace chain {
    }
 
    std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
+      std::lock_guard<std::recursive_mutex> g( my->mtx );
       my->check_open_files();
+      my->wait_for_pos(pos);
 
       my->block_stream.seekg(pos);
       std::pair<signed_block_ptr,uint64_t> result;
@@ -261,6 +639,10 @@ namespace roxe { namespace chain {
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
+         std::lock_guard<std::recursive_mutex> g( my->mtx );
+         if( block_num < my->first_block_num && !my->retained.empty() )
+            return my->read_retained_block( block_num );
+
          signed_block_ptr b;
          uint64_t pos = get_block_pos(block_num);
          if (pos != npos) {
@@ -272,19 +654,45 @@ namespace roxe { namespace chain {
       } FC_LOG_AND_RETHROW()
    }
 
+   vector<char> block_log::read_serialized_block_by_num(uint32_t block_num)const {
+      try {
+         std::lock_guard<std::recursive_mutex> g( my->mtx );
+         if( block_num < my->first_block_num && !my->retained.empty() )
+            return my->read_retained_serialized_block( block_num );
+
+         uint64_t pos = get_block_pos(block_num);
+         if( pos == npos )
+            return {};
+
+         uint64_t end;
+         if( block_num < block_header::num_from_id(my->head_id) ) {
+            my->wait_for_block(block_num + 1);
+            end = my->read_index(block_num + 1 - my->first_block_num);
+         } else {
+            my->wait_for_writes();
+            my->block_stream.seekg(0, std::ios::end);
+            end = my->block_stream.tellg();
+         }
+         // every block is followed by its position
+         return detail::read_serialized(my->block_stream, pos, end - sizeof(uint64_t));
+      } FC_LOG_AND_RETHROW()
+   }
+
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
+      std::lock_guard<std::recursive_mutex> g( my->mtx );
       my->check_open_files();
       if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
          return npos;
-      my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
-      uint64_t pos;
-      my->index_stream.read((char*)&pos, sizeof(pos));
-      return pos;
+      my->wait_for_block(block_num);
+      return my->read_index(block_num - my->first_block_num);
    }
 
    signed_block_ptr block_log::read_head()const {
+      std::lock_guard<std::recursive_mutex> g( my->mtx );
       my->check_open_files();
 
+      my->wait_for_writes();
+
       uint64_t pos;
 
       // Check that the file is not empty
@@ -309,6 +717,27 @@ namespace roxe { namespace chain {
       return my->first_block_num;
    }
 
+   void block_log::split() {
+      const auto gs = extract_genesis_state( my->data_dir );
+      detail::retained_block_file f;
+      f.first_block_num = my->first_block_num;
+      f.last_block_num = my->head->block_num();
+      const auto base = "blocks-" + std::to_string(f.first_block_num) + "-" + std::to_string(f.last_block_num);
+      f.block_file = my->data_dir / (base + ".log");
+      f.index_file = my->data_dir / (base + ".index");
+
+      ilog( "Splitting off blocks ${first} through ${last} of the block log into ${f}",
+            ("first", f.first_block_num)("last", f.last_block_num)("f", f.block_file.generic_string()) );
+      flush();
+      my->close();
+      fc::rename( my->block_file, f.block_file );
+      fc::rename( my->index_file, f.index_file );
+      my->retained.push_back( f );
+
+      reset( gs, signed_block_ptr(), f.last_block_num + 1 );
+      my->prune_retained_files();
+   }
+
    void block_log::construct_index() {
       ilog("Reconstructing Block Log Index...");
       my->close();
@@ -322,38 +751,54 @@ namespace roxe { namespace chain {
       my->block_stream.seekg(-sizeof( uint64_t), std::ios::end);
       my->block_stream.read((char*)&end_pos, sizeof(end_pos));
 
-      if( end_pos == npos ) {
+      if( end_pos == npos || !my->head ) {
          ilog( "Block log contains no blocks. No need to construct index." );
          return;
       }
 
-      signed_block tmp;
-
-      uint64_t pos = 0;
-      if (my->version == 1) {
-         pos = 4; // Skip version which should have already been checked.
-      } else {
-         pos = 8; // Skip version and first block offset which should have already been checked
-      }
-      my->block_stream.seekg(pos);
-
-      genesis_state gs;
-      fc::raw::unpack(my->block_stream, gs);
+      /* Every block is followed by its own position, so the log can be walked from the head block back to
+       * the first block reading only those trailing positions instead of unpacking every block. Both files
+       * are mapped; the index is sized up front and filled from the back.
+       */
+      const auto start = fc::time_point::now();
+      const uint32_t head_num = my->head->block_num();
+      ROXE_ASSERT( head_num >= my->first_block_num, block_log_exception,
+                   "Head block ${h} of block log precedes its first block ${f}", ("h", head_num)("f", my->first_block_num) );
+      const uint64_t count = head_num - my->first_block_num + 1;
+      const uint64_t log_size = fc::file_size(my->block_file);
 
-      // skip the totem
-      if (my->version > 1) {
-         uint64_t totem;
-         my->block_stream.read((char*) &totem, sizeof(totem));
+      my->close();
+      fc::resize_file(my->index_file, count * sizeof(uint64_t));
+      {
+         bip::file_mapping log_fm( my->block_file.generic_string().c_str(), bip::read_only );
+         bip::mapped_region log_region( log_fm, bip::read_only, 0, log_size );
+         bip::file_mapping index_fm( my->index_file.generic_string().c_str(), bip::read_write );
+         bip::mapped_region index_region( index_fm, bip::read_write, 0, count * sizeof(uint64_t) );
+
+         const char* log_data = static_cast<const char*>( log_region.get_address() );
+         char* index_data = static_cast<char*>( index_region.get_address() );
+
+         uint64_t pos = end_pos;
+         for( uint64_t i = count; i > 0; --i ) {
+            memcpy( index_data + (i - 1) * sizeof(uint64_t), &pos, sizeof(pos) );
+            if( i == 1 ) break;
+            ROXE_ASSERT( pos >= sizeof(uint64_t) && pos <= log_size, block_log_exception,
+                         "Block log is malformed, position ${p} of block ${n} is out of range",
+                         ("p", pos)("n", my->first_block_num + i - 1) );
+            uint64_t prev_pos;
+            memcpy( &prev_pos, log_data + pos - sizeof(uint64_t), sizeof(prev_pos) );
+            ROXE_ASSERT( prev_pos < pos, block_log_exception,
+                         "Block log is malformed, block ${n} does not link back to an earlier position",
+                         ("n", my->first_block_num + i - 1) );
+            pos = prev_pos;
+            if( (i - 1) % 1000000 == 0 )
+               ilog( "Block log index reconstructed for block ${n}", ("n", my->first_block_num + i - 2) );
+         }
+         index_region.flush();
       }
+      my->reopen();
 
-      my->index_stream.seekp(0, std::ios::end);
-      while( pos < end_pos ) {
-         fc::raw::unpack(my->block_stream, tmp);
-         my->block_stream.read((char*)&pos, sizeof(pos));
-         if(tmp.block_num() % 1000 == 0)
-            ilog( "Block log index reconstructed for block ${n}", ("n", tmp.block_num()));
-         my->index_stream.write((char*)&pos, sizeof(pos));
-      }
+      ilog( "Block log index for ${n} blocks reconstructed in ${t} ms", ("n", count)("t", (fc::time_point::now() - start).count() / 1000) );
    } // construct_index
 
    fc::path block_log::repair_log( const fc::path& data_dir, uint32_t truncate_at_block ) {
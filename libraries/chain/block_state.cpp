@@ -41,4 +41,24 @@ namespace roxe { namespace chain {
    ,trxs( std::move(trx_metas) )
    {}
 
+   size_t block_state::release_trxs() {
+      size_t bytes = 0;
+      recovered_keys.clear();
+      recovered_keys.reserve( trxs.size() );
+      for( const auto& mtrx : trxs ) {
+         bytes += sizeof(transaction_metadata);
+         // metadata created for a received block refers to the packed transaction inside the block
+         const auto& ptrx = mtrx->packed_trx;
+         if( ptrx && (ptrx.owner_before( block ) || block.owner_before( ptrx )) )
+            bytes += sizeof(packed_transaction) + ptrx->get_unprunable_size() + ptrx->get_prunable_size();
+         const auto& keys = mtrx->signing_keys_future;
+         if( keys.valid() && keys.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+            recovered_keys.emplace_back( keys );
+         else
+            recovered_keys.emplace_back();
+      }
+      vector<transaction_metadata_ptr>().swap( trxs );
+      return bytes;
+   }
+
 } } /// roxe::chain
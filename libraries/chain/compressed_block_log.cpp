@@ -0,0 +1,391 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/chain/compressed_block_log.hpp>
+#include <roxe/chain/exceptions.hpp>
+#include <fc/io/raw.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <algorithm>
+#include <fstream>
+
+#define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
+#define LOG_RW ( std::ios::in | std::ios::out | std::ios::binary )
+
+namespace roxe { namespace chain {
+
+   namespace bio = boost::iostreams;
+
+   const uint32_t compressed_block_log::magic_number = 0xB10CC0DE;
+
+   /**
+    * History:
+    * Version 1: initial version; zlib compressed chunks with a block offset table
+    */
+   const uint32_t compressed_block_log::version = 1;
+
+   namespace detail {
+      struct chunk_entry {
+         uint64_t pos = 0;
+         uint32_t first_block = 0;
+         uint32_t block_count = 0;
+      };
+      static_assert( sizeof(chunk_entry) == 16, "index entries are written as is" );
+
+      /// first block number, block count and compressed size
+      static constexpr uint64_t chunk_header_size = 3 * sizeof(uint32_t);
+
+      class compressed_block_log_impl {
+         public:
+            fc::path                 log_file;
+            fc::path                 index_file;
+            std::fstream             log_stream;
+            std::fstream             index_stream;
+            uint32_t                 blocks_per_chunk = 0;
+            bool                     initialized = false;
+            uint32_t                 first_block_num = 0;
+            uint64_t                 header_size = 0;
+            genesis_state            gs;
+            vector<chunk_entry>      chunks;
+            vector<bytes>            pending;      ///< packed blocks not yet written out in a chunk
+            uint32_t                 pending_first = 0;
+
+            uint32_t                 cached_chunk = std::numeric_limits<uint32_t>::max();
+            vector<char>             cached_data;
+
+            void reopen();
+            void close();
+            void read_header();
+            void load_index();
+            void rebuild_index();
+            void write_chunk();
+            const vector<char>& read_chunk( uint32_t chunk );
+
+            uint32_t next_block_num()const {
+               if( !pending.empty() ) return pending_first + pending.size();
+               if( !chunks.empty() ) return chunks.back().first_block + chunks.back().block_count;
+               return first_block_num;
+            }
+      };
+
+      void compressed_block_log_impl::close() {
+         if( log_stream.is_open() )
+            log_stream.close();
+         if( index_stream.is_open() )
+            index_stream.close();
+      }
+
+      void compressed_block_log_impl::reopen() {
+         close();
+
+         // open to create files if they don't exist
+         log_stream.open( log_file.generic_string().c_str(), LOG_WRITE );
+         index_stream.open( index_file.generic_string().c_str(), LOG_WRITE );
+
+         close();
+
+         log_stream.open( log_file.generic_string().c_str(), LOG_RW );
+         index_stream.open( index_file.generic_string().c_str(), LOG_RW );
+      }
+
+      void compressed_block_log_impl::read_header() {
+         log_stream.seekg( 0 );
+         uint32_t totem = 0, v = 0;
+         log_stream.read( (char*)&totem, sizeof(totem) );
+         log_stream.read( (char*)&v, sizeof(v) );
+         ROXE_ASSERT( totem == compressed_block_log::magic_number, block_log_exception,
+                      "'${f}' is not a compressed block log", ("f", log_file.generic_string()) );
+         ROXE_ASSERT( v == compressed_block_log::version, block_log_unsupported_version,
+                      "Unsupported version of compressed block log. Version is ${version} while code supports version ${supported}",
+                      ("version", v)("supported", compressed_block_log::version) );
+         log_stream.read( (char*)&first_block_num, sizeof(first_block_num) );
+         ROXE_ASSERT( first_block_num > 0, block_log_exception, "Compressed block log is malformed, first block number is 0" );
+         fc::raw::unpack( log_stream, gs );
+         header_size = log_stream.tellg();
+         initialized = true;
+      }
+
+      void compressed_block_log_impl::load_index() {
+         const auto log_size = fc::file_size( log_file );
+         const auto index_size = fc::file_size( index_file );
+
+         if( index_size % sizeof(chunk_entry) == 0 ) {
+            chunks.resize( index_size / sizeof(chunk_entry) );
+            index_stream.seekg( 0 );
+            if( index_size )
+               index_stream.read( (char*)chunks.data(), index_size );
+
+            uint64_t end = header_size;
+            if( !chunks.empty() && chunks.back().pos + chunk_header_size > log_size ) {
+               end = 0;
+            } else if( !chunks.empty() ) {
+               uint32_t compressed_size = 0;
+               log_stream.seekg( chunks.back().pos + 2 * sizeof(uint32_t) );
+               log_stream.read( (char*)&compressed_size, sizeof(compressed_size) );
+               end = chunks.back().pos + chunk_header_size + compressed_size;
+            }
+            if( end == log_size )
+               return;
+         }
+
+         ilog( "Compressed block log index is inconsistent with the log" );
+         rebuild_index();
+      }
+
+      void compressed_block_log_impl::rebuild_index() {
+         ilog( "Reconstructing compressed block log index..." );
+         const auto log_size = fc::file_size( log_file );
+
+         chunks.clear();
+         uint64_t pos = header_size;
+         while( pos + chunk_header_size <= log_size ) {
+            chunk_entry e;
+            uint32_t compressed_size = 0;
+            log_stream.seekg( pos );
+            log_stream.read( (char*)&e.first_block, sizeof(e.first_block) );
+            log_stream.read( (char*)&e.block_count, sizeof(e.block_count) );
+            log_stream.read( (char*)&compressed_size, sizeof(compressed_size) );
+            if( pos + chunk_header_size + compressed_size > log_size )
+               break;
+            e.pos = pos;
+            chunks.push_back( e );
+            pos += chunk_header_size + compressed_size;
+         }
+
+         close();
+         if( pos != log_size ) {
+            wlog( "Dropping ${n} bytes of incomplete chunk at the end of the compressed block log", ("n", log_size - pos) );
+            fc::resize_file( log_file, pos );
+         }
+         fc::remove_all( index_file );
+         reopen();
+
+         if( !chunks.empty() )
+            index_stream.write( (const char*)chunks.data(), chunks.size() * sizeof(chunk_entry) );
+         index_stream.flush();
+      }
+
+      void compressed_block_log_impl::write_chunk() {
+         if( pending.empty() ) return;
+
+         // offset table followed by the packed blocks
+         vector<char> raw( pending.size() * sizeof(uint32_t) );
+         for( size_t i = 0; i < pending.size(); ++i ) {
+            const uint32_t offset = raw.size();
+            memcpy( raw.data() + i * sizeof(uint32_t), &offset, sizeof(offset) );
+            raw.insert( raw.end(), pending[i].begin(), pending[i].end() );
+         }
+
+         bytes compressed;
+         {
+            bio::filtering_ostream comp;
+            comp.push( bio::zlib_compressor( bio::zlib::best_compression ) );
+            comp.push( bio::back_inserter( compressed ) );
+            bio::write( comp, raw.data(), raw.size() );
+            bio::close( comp );
+         }
+
+         chunk_entry e;
+         e.first_block = pending_first;
+         e.block_count = pending.size();
+         const uint32_t compressed_size = compressed.size();
+
+         log_stream.seekp( 0, std::ios::end );
+         e.pos = log_stream.tellp();
+         log_stream.write( (const char*)&e.first_block, sizeof(e.first_block) );
+         log_stream.write( (const char*)&e.block_count, sizeof(e.block_count) );
+         log_stream.write( (const char*)&compressed_size, sizeof(compressed_size) );
+         log_stream.write( compressed.data(), compressed.size() );
+         log_stream.flush();
+
+         // the index is only written after the chunk itself, so an interrupted write leaves a rebuildable log
+         index_stream.seekp( 0, std::ios::end );
+         index_stream.write( (const char*)&e, sizeof(e) );
+         index_stream.flush();
+
+         chunks.push_back( e );
+         pending.clear();
+      }
+
+      const vector<char>& compressed_block_log_impl::read_chunk( uint32_t chunk ) {
+         if( cached_chunk == chunk )
+            return cached_data;
+
+         const auto& e = chunks[chunk];
+         auto& stream = log_stream;
+         uint32_t first_block = 0, block_count = 0, compressed_size = 0;
+         stream.seekg( e.pos );
+         stream.read( (char*)&first_block, sizeof(first_block) );
+         stream.read( (char*)&block_count, sizeof(block_count) );
+         stream.read( (char*)&compressed_size, sizeof(compressed_size) );
+         ROXE_ASSERT( first_block == e.first_block && block_count == e.block_count, block_log_exception,
+                      "Compressed block log index does not match chunk at position ${pos}", ("pos", e.pos) );
+
+         bytes compressed( compressed_size );
+         stream.read( compressed.data(), compressed.size() );
+
+         cached_chunk = std::numeric_limits<uint32_t>::max();
+         cached_data.clear();
+         {
+            bio::filtering_ostream decomp;
+            decomp.push( bio::zlib_decompressor() );
+            decomp.push( bio::back_inserter( cached_data ) );
+            bio::write( decomp, compressed.data(), compressed.size() );
+            bio::close( decomp );
+         }
+         ROXE_ASSERT( cached_data.size() >= block_count * sizeof(uint32_t), block_log_exception,
+                      "Compressed block log chunk at position ${pos} is malformed", ("pos", e.pos) );
+         cached_chunk = chunk;
+         return cached_data;
+      }
+   }
+
+   compressed_block_log::compressed_block_log( const fc::path& data_dir, uint32_t blocks_per_chunk )
+   :my(new detail::compressed_block_log_impl()) {
+      ROXE_ASSERT( blocks_per_chunk > 0, block_log_exception, "A chunk must hold at least one block" );
+      my->log_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+      my->index_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+      my->blocks_per_chunk = blocks_per_chunk;
+
+      if( !fc::is_directory( data_dir ) )
+         fc::create_directories( data_dir );
+
+      my->log_file = data_dir / "blocks.zlog";
+      my->index_file = data_dir / "blocks.zindex";
+      my->reopen();
+
+      if( fc::file_size( my->log_file ) ) {
+         my->read_header();
+         my->load_index();
+      } else if( fc::file_size( my->index_file ) ) {
+         ilog( "Compressed block log is empty, removing its index" );
+         my->close();
+         fc::remove_all( my->index_file );
+         my->reopen();
+      }
+   }
+
+   compressed_block_log::compressed_block_log( compressed_block_log&& other ) {
+      my = std::move( other.my );
+   }
+
+   compressed_block_log::~compressed_block_log() {
+      if( my ) {
+         try {
+            flush();
+         } FC_LOG_AND_DROP()
+         my->close();
+      }
+   }
+
+   bool compressed_block_log::exists( const fc::path& data_dir ) {
+      return fc::is_regular_file( data_dir / "blocks.zlog" );
+   }
+
+   void compressed_block_log::reset( const genesis_state& gs, uint32_t first_block_num ) {
+      ROXE_ASSERT( first_block_num > 0, block_log_exception, "First block number must be greater than or equal to 1" );
+      my->close();
+      fc::remove_all( my->log_file );
+      fc::remove_all( my->index_file );
+      my->reopen();
+
+      my->chunks.clear();
+      my->pending.clear();
+      my->cached_chunk = std::numeric_limits<uint32_t>::max();
+      my->cached_data.clear();
+
+      const auto data = fc::raw::pack( gs );
+      my->log_stream.seekp( 0, std::ios::end );
+      my->log_stream.write( (const char*)&magic_number, sizeof(magic_number) );
+      my->log_stream.write( (const char*)&version, sizeof(version) );
+      my->log_stream.write( (const char*)&first_block_num, sizeof(first_block_num) );
+      my->log_stream.write( data.data(), data.size() );
+      my->log_stream.flush();
+
+      my->gs = gs;
+      my->first_block_num = first_block_num;
+      my->header_size = my->log_stream.tellp();
+      my->initialized = true;
+   }
+
+   void compressed_block_log::append( const signed_block_ptr& b ) {
+      try {
+         ROXE_ASSERT( my->initialized, block_log_append_fail, "Cannot append to compressed block log until it has been reset" );
+         const auto expected = my->next_block_num();
+         ROXE_ASSERT( b->block_num() == expected, block_log_append_fail,
+                      "Append to compressed block log occurring out of order.",
+                      ("block_num", b->block_num())("expected", expected) );
+
+         if( my->pending.empty() )
+            my->pending_first = expected;
+         my->pending.emplace_back( fc::raw::pack( *b ) );
+         if( my->pending.size() >= my->blocks_per_chunk )
+            my->write_chunk();
+      } FC_LOG_AND_RETHROW()
+   }
+
+   void compressed_block_log::flush() {
+      my->write_chunk();
+   }
+
+   signed_block_ptr compressed_block_log::read_block_by_num( uint32_t block_num )const {
+      try {
+         if( !my->initialized || block_num < my->first_block_num || block_num >= my->next_block_num() )
+            return {};
+
+         auto b = std::make_shared<signed_block>();
+         if( !my->pending.empty() && block_num >= my->pending_first ) {
+            const auto& packed = my->pending[block_num - my->pending_first];
+            fc::datastream<const char*> ds( packed.data(), packed.size() );
+            fc::raw::unpack( ds, *b );
+            return b;
+         }
+
+         auto itr = std::upper_bound( my->chunks.begin(), my->chunks.end(), block_num,
+                                      []( uint32_t n, const detail::chunk_entry& e ) { return n < e.first_block; } );
+         ROXE_ASSERT( itr != my->chunks.begin(), block_log_exception, "Block ${n} precedes the first chunk", ("n", block_num) );
+         --itr;
+         const uint32_t i = block_num - itr->first_block;
+         const auto& data = my->read_chunk( itr - my->chunks.begin() );
+
+         uint32_t begin = 0, end = data.size();
+         memcpy( &begin, data.data() + i * sizeof(uint32_t), sizeof(begin) );
+         if( i + 1 < itr->block_count )
+            memcpy( &end, data.data() + (i + 1) * sizeof(uint32_t), sizeof(end) );
+         ROXE_ASSERT( begin <= end && end <= data.size(), block_log_exception,
+                      "Compressed block log chunk holding block ${n} is malformed", ("n", block_num) );
+
+         fc::datastream<const char*> ds( data.data() + begin, end - begin );
+         fc::raw::unpack( ds, *b );
+         ROXE_ASSERT( b->block_num() == block_num, block_log_exception,
+                      "Wrong block was read from compressed block log.", ("returned", b->block_num())("expected", block_num) );
+         return b;
+      } FC_LOG_AND_RETHROW()
+   }
+
+   signed_block_ptr compressed_block_log::read_head()const {
+      const auto head = head_block_num();
+      return head ? read_block_by_num( head ) : signed_block_ptr();
+   }
+
+   uint32_t compressed_block_log::head_block_num()const {
+      const auto next = my->next_block_num();
+      if( !my->initialized || next == my->first_block_num ) return 0;
+      return next - 1;
+   }
+
+   uint32_t compressed_block_log::first_block_num()const {
+      return my->first_block_num;
+   }
+
+   const genesis_state& compressed_block_log::get_genesis_state()const {
+      return my->gs;
+   }
+
+   uint32_t compressed_block_log::chunk_count()const {
+      return my->chunks.size();
+   }
+
+} } /// roxe::chain
@@ -2,6 +2,7 @@
 #include <roxe/chain/transaction_context.hpp>
 
 #include <roxe/chain/block_log.hpp>
+#include <roxe/chain/reversible_block_log.hpp>
 #include <roxe/chain/fork_database.hpp>
 #include <roxe/chain/exceptions.hpp>
 
@@ -21,15 +22,27 @@
 #include <roxe/chain/protocol_feature_manager.hpp>
 #include <roxe/chain/authorization_manager.hpp>
 #include <roxe/chain/resource_limits.hpp>
+#include <roxe/chain/startup_profile.hpp>
 #include <roxe/chain/chain_snapshot.hpp>
 #include <roxe/chain/thread_utils.hpp>
 
 #include <chainbase/chainbase.hpp>
+#include <chainbase/shared_revision.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
 #include <fc/log/logger_config.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/tracing.hpp>
 #include <fc/variant_object.hpp>
 
+#include <condition_variable>
+#include <deque>
+#include <numeric>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace roxe { namespace chain {
 
 using resource_limits::resource_limits_manager;
@@ -118,6 +131,7 @@ struct building_block {
    vector<transaction_metadata_ptr>   _pending_trx_metas;
    vector<transaction_receipt>        _pending_trx_receipts;
    vector<action_receipt>             _actions;
+   vector<table_access_set>           _trx_access_sets; ///< applied transactions in block order, only when recording access sets
 };
 
 struct assembled_block {
@@ -129,6 +143,7 @@ struct assembled_block {
 
 struct completed_block {
    block_state_ptr                   _block_state;
+   bool                              _signed = true; ///< false until complete_block for finalize_unsigned_block
 };
 
 using block_stage_type = fc::static_variant<building_block, assembled_block, completed_block>;
@@ -206,10 +221,17 @@ struct pending_state {
    }
 };
 
+/// what a node publishing its state tells the read replicas along with the revision
+struct published_head {
+   fc::sha256                     chain_id;
+   block_header_state             head;
+   uint32_t                       lib_num = 0;
+};
+
 struct controller_impl {
    controller&                    self;
    chainbase::database            db;
-   chainbase::database            reversible_blocks; ///< a special database to persist blocks that have successfully been applied but are still reversible
+   reversible_block_log           reversible_blocks; ///< persists blocks that have successfully been applied but are still reversible
    block_log                      blog;
    optional<pending_state>        pending;
    block_state_ptr                head;
@@ -223,13 +245,73 @@ struct controller_impl {
    optional<fc::time_point>       replay_head_time;
    db_read_mode                   read_mode = db_read_mode::SPECULATIVE;
    bool                           in_trx_requiring_checks = false; ///< if true, checks that are normally skipped on replay (e.g. auth checks) cannot be skipped
+   bool                           applying_irreversible = false; ///< applying an irreversible block in irreversible mode, without undo sessions
+   bool                           irreversible_apply_failed = false; ///< the state holds part of a block which failed to apply and can not be rolled back
    optional<fc::microseconds>     subjective_cpu_leeway;
    bool                           trusted_producer_light_validation = false;
+   bool                           detailed_traces_required = false; ///< set by consumers of applied_transaction that read more than the receipts
+   bool                           console_output_required = false; ///< set by consumers of applied_transaction that read console output
+   optional<uint64_t>             producers_authority_checked; ///< producers permission changes counted when last found matching, see update_producers_authority()
    uint32_t                       snapshot_head_block = 0;
    named_thread_pool              thread_pool;
+   controller::apply_timing       apply_times;
+   controller::released_trx_metas released_metas;
+   /// written with conf.publish_state_revision, read with conf.state_replica
+   optional<chainbase::shared_revision> published_state;
+   uint64_t                       replica_spans = 0;      ///< the spans the writer had published when the replica head was taken
+   uint32_t                       replica_lib_num = 0;
+   bool                           standby = false;        ///< conf.state_delta_standby until promoted
+
+   /// adds the time until the returned guard goes out of scope to `t`, only when conf.profile_apply is set
+   auto time_phase( fc::microseconds& t ) {
+      const auto start = conf.profile_apply ? fc::time_point::now() : fc::time_point();
+      return fc::make_scoped_exit( [this, &t, start]() {
+         if( conf.profile_apply )
+            t += fc::time_point::now() - start;
+      } );
+   }
+
+   /// contract tables written since the snapshot at base_block_id, only when conf.differential_snapshots
+   struct table_change_journal {
+      block_id_type                          base_block_id;
+      uint32_t                               base_block_num = 0;
+      table_id_object::id_type               base_next_table_id;
+      std::set<table_access_set::table_key>  changed;
+   };
+   optional<table_change_journal>            table_journal;
+
+   /// when the contract tables were last written, by sequence number of the executed transaction, for table_access_stale
+   struct table_write_journal {
+      static constexpr size_t max_entries = 1024 * 1024;
+
+      uint64_t                                              seq = 0;
+      uint64_t                                              stale_before = 0; ///< last_write was cleared at this seq
+      uint64_t                                              last_native_write = 0;
+      std::map<table_access_set::table_key, uint64_t>       last_write;
+   };
+   table_write_journal                       table_writes;
 
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
+   typedef std::tuple<digest_type,scope_name,action_name> native_contract_key;
+   map< account_name, map<native_contract_key, apply_handler> > native_contract_actions;
+
+   struct receiver_dispatch_cache {
+      static constexpr size_t max_entries = 64 * 1024;
+
+      uint64_t                                                         epoch = 0;
+      std::unordered_map<account_name, controller::receiver_dispatch>  receivers;
+   };
+   mutable receiver_dispatch_cache  receiver_dispatches;
+   uint64_t                         last_dispatch_epoch = 0;
+
+   /// deferred transactions scheduled by contracts, decoded, by the trx_id of their generated_transaction_object
+   struct scheduled_trx_cache {
+      static constexpr size_t max_entries = 16 * 1024;
+
+      std::unordered_map<transaction_id_type, packed_transaction_ptr>  trxs;
+   };
+   scheduled_trx_cache              scheduled_trxs;
    unordered_map< builtin_protocol_feature_t, std::function<void(controller_impl&)>, enum_hash<builtin_protocol_feature_t> > protocol_feature_activation_handlers;
 
    /**
@@ -247,19 +329,25 @@ struct controller_impl {
          prev = fork_db.root();
       }
 
-      if( const auto* b = reversible_blocks.find<reversible_block_object,by_num>(head->block_num) )
-      {
-         reversible_blocks.remove( *b );
-      }
+      reversible_blocks.truncate( head->block_num );
 
       if ( read_mode == db_read_mode::SPECULATIVE ) {
          ROXE_ASSERT( head->block, block_validate_exception, "attempting to pop a block that was sparsely loaded from a snapshot");
-         for( const auto& t : head->trxs )
+         for( const auto& t : head->trxs.empty() ? create_block_trx_metas( *head ) : head->trxs )
             unapplied_transactions[t->signed_id] = t;
       }
 
+      if( table_journal && head->block_num <= table_journal->base_block_num ) {
+         // undo does not go through apply_context, so changes back past the base are not in the journal
+         wlog( "popped block ${n} at or below the differential snapshot base, a full snapshot is required before the next differential one",
+               ("n", head->block_num) );
+         table_journal.reset();
+      }
+
       head = prev;
       db.undo();
+      // the popped to block may have ended with a change to the producers account made by one of its transactions
+      producers_authority_checked.reset();
 
       protocol_features.popped_blocks_to( prev->block_num );
    }
@@ -281,37 +369,48 @@ struct controller_impl {
 
    void set_apply_handler( account_name receiver, account_name contract, action_name action, apply_handler v ) {
       apply_handlers[receiver][make_pair(contract,action)] = v;
+      receiver_dispatches.receivers.clear();
    }
 
    controller_impl( const controller::config& cfg, controller& s, protocol_feature_set&& pfs  )
    :self(s),
     db( cfg.state_dir,
-        cfg.read_only ? database::read_only : database::read_write,
-        cfg.state_size, false, cfg.db_map_mode, cfg.db_hugepage_paths ),
-    reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
-        cfg.read_only ? database::read_only : database::read_write,
-        cfg.reversible_cache_size, false, cfg.db_map_mode, cfg.db_hugepage_paths ),
-    blog( cfg.blocks_dir ),
+        cfg.read_only || cfg.state_replica ? database::read_only : database::read_write,
+        cfg.state_size, cfg.state_replica, cfg.state_replica ? pinnable_mapped_file::mapped : cfg.db_map_mode, cfg.db_hugepage_paths ),
+    reversible_blocks( import_reversible_block_database( cfg.blocks_dir/config::reversible_blocks_dir_name, cfg.read_only || cfg.state_replica ) ),
+    blog( cfg.blocks_dir, cfg.blocks_log_stride, cfg.max_retained_block_files, cfg.blocks_archive_dir, cfg.block_log_async_writes ),
     fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime, db ),
+    wasmif( cfg.wasm_runtime, db, cfg.prepared_wasm_cache_dir, cfg.wasm_instantiation_cache_size ),
     resource_limits( db ),
     authorization( s, db ),
     protocol_features( std::move(pfs) ),
     conf( cfg ),
     chain_id( cfg.genesis.compute_chain_id() ),
     read_mode( cfg.read_mode ),
-    thread_pool( "chain", cfg.thread_pool_size )
+    thread_pool( "chain", cfg.thread_pool_size ),
+    standby( cfg.state_delta_standby )
    {
 
-      fork_db.open( [this]( block_timestamp_type timestamp,
-                            const flat_set<digest_type>& cur_features,
-                            const vector<digest_type>& new_features )
-                           { check_protocol_features( timestamp, cur_features, new_features ); }
-      );
+      // the fork database of a replica only holds the published head, its files belong to the writer
+      if( !cfg.state_replica ) {
+         auto phase = startup_profile::instance().phase( "fork_db_load" );
+         fork_db.open( [this]( block_timestamp_type timestamp,
+                               const flat_set<digest_type>& cur_features,
+                               const vector<digest_type>& new_features )
+                              { check_protocol_features( timestamp, cur_features, new_features ); }
+         );
+         if( fork_db.head() )
+            phase.add( "reversible_blocks", fork_db.pending_head()->block_num - fork_db.root()->block_num );
+      }
+
+      transaction::set_recovery_cache_capacity( cfg.sig_recovery_cache_size );
+      wasmif.get_profiler().enable( cfg.profile_wasm );
+      wasmif.get_profiler().enable_sampling( cfg.wasm_sample_interval_us );
 
       set_activation_handler<builtin_protocol_feature_t::preactivate_feature>();
       set_activation_handler<builtin_protocol_feature_t::replace_deferred>();
       set_activation_handler<builtin_protocol_feature_t::get_sender>();
+      set_activation_handler<builtin_protocol_feature_t::batched_index_reads>();
 
       self.irreversible_block.connect([this](const block_state_ptr& bsp) {
          wasmif.current_lib(bsp->block_num);
@@ -387,29 +486,63 @@ struct controller_impl {
       if( fork_head->dpos_irreversible_blocknum <= lib_num )
          return;
 
+      // In irreversible mode the blocks are applied once they can no longer be undone, so unless replay optimizations
+      // are disabled they are applied without undo sessions, as on replay, but still fully validated.
+      const bool skip_sessions = read_mode == db_read_mode::IRREVERSIBLE && !conf.disable_replay_opts;
+
       const auto branch = fork_db.fetch_branch( fork_head->id, fork_head->dpos_irreversible_blocknum );
       try {
-         const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
-
          for( auto bitr = branch.rbegin(); bitr != branch.rend(); ++bitr ) {
             if( read_mode == db_read_mode::IRREVERSIBLE ) {
-               apply_block( *bitr, controller::block_status::complete );
+               if( skip_sessions ) {
+                  auto reset_applying_irreversible = fc::make_scoped_exit( [this]() {
+                     applying_irreversible = false;
+                  } );
+                  applying_irreversible = true;
+                  try {
+                     apply_block( *bitr, controller::block_status::complete );
+                  } catch( ... ) {
+                     // nothing rolls the part already applied back; refuse further blocks and, by leaving the state
+                     // behind its head, refuse to start from it again
+                     irreversible_apply_failed = true;
+                     db.set_revision( head->block_num - 1 );
+                     elog( "irreversible block ${n} failed to apply without an undo session, the state is unusable",
+                           ("n", (*bitr)->block_num) );
+                     throw;
+                  }
+               } else {
+                  apply_block( *bitr, controller::block_status::complete );
+               }
                head = (*bitr);
                fork_db.mark_valid( head );
             }
 
             emit( self.irreversible_block, *bitr );
 
-            db.commit( (*bitr)->block_num );
+            {
+               auto commit_timer = time_phase( apply_times.chainbase );
+               if( skip_sessions )
+                  db.set_revision( (*bitr)->block_num );
+               else
+                  db.commit( (*bitr)->block_num );
+            }
             root_id = (*bitr)->id;
 
-            blog.append( (*bitr)->block );
+            if( conf.db_checkpoint_interval && (*bitr)->block_num % conf.db_checkpoint_interval == 0 ) {
+               checkpoint_state( **bitr );
+            }
 
-            auto rbitr = rbi.begin();
-            while( rbitr != rbi.end() && rbitr->blocknum <= (*bitr)->block_num ) {
-               reversible_blocks.remove( *rbitr );
-               rbitr = rbi.begin();
+            if( conf.db_cold_page_interval && (*bitr)->block_num % conf.db_cold_page_interval == 0 ) {
+               db.mark_pages_cold();
             }
+
+            if( conf.db_hot_page_profile_interval && (*bitr)->block_num % conf.db_hot_page_profile_interval == 0 ) {
+               db.save_resident_pages();
+            }
+
+            blog.append( (*bitr)->block );
+
+            reversible_blocks.remove_up_to( (*bitr)->block_num );
          }
       } catch( fc::exception& ) {
          if( root_id != fork_db.root()->id ) {
@@ -449,6 +582,106 @@ struct controller_impl {
       initialize_database();
    }
 
+   /// irreversible blocks read and unpacked ahead of the replay
+   static const uint32_t replay_read_ahead_blocks = 256;
+
+   struct replay_block {
+      signed_block_ptr                   block;
+      vector<transaction_metadata_ptr>   trx_metas;
+   };
+
+   /**
+    * Staged replay of the block log: a dedicated thread reads the packed blocks sequentially, the thread pool
+    * unpacks them and creates their transaction metadata (computing the transaction ids), and the main thread
+    * only applies them. At most max_ahead blocks are in flight; blocks are returned in block log order.
+    */
+   class replay_pipeline {
+      public:
+         replay_pipeline( const block_log& blog, boost::asio::io_context& pool, uint32_t first, uint32_t last, size_t max_ahead )
+         :max_ahead( max_ahead )
+         {
+            reader = std::thread( [this, &blog, &pool, first, last]() {
+               fc::set_os_thread_name( "replay-read" );
+               for( uint32_t num = first; num <= last; ++num ) {
+                  {
+                     std::unique_lock<std::mutex> g( mtx );
+                     cv.wait( g, [this]() { return stop || queue.size() < this->max_ahead; } );
+                     if( stop ) break;
+                  }
+
+                  std::future<replay_block> f;
+                  try {
+                     auto data = blog.read_serialized_block_by_num( num );
+                     if( data.empty() ) break;
+                     f = async_thread_pool( pool, [num, data{std::move( data )}]() {
+                        replay_block r;
+                        r.block = std::make_shared<signed_block>();
+                        fc::datastream<const char*> ds( data.data(), data.size() );
+                        fc::raw::unpack( ds, *r.block );
+                        ROXE_ASSERT( r.block->block_num() == num, block_log_exception,
+                                     "Wrong block was read from block log.", ("returned", r.block->block_num())("expected", num) );
+                        r.trx_metas = create_block_trx_metas( r.block );
+                        return r;
+                     } );
+                  } catch( ... ) {
+                     // surface the error to the main thread in block order
+                     std::promise<replay_block> p;
+                     p.set_exception( std::current_exception() );
+                     f = p.get_future();
+                     num = last;
+                  }
+
+                  std::lock_guard<std::mutex> g( mtx );
+                  queue.emplace_back( std::move( f ) );
+                  cv.notify_all();
+               }
+               std::lock_guard<std::mutex> g( mtx );
+               done = true;
+               cv.notify_all();
+            } );
+         }
+
+         ~replay_pipeline() {
+            {
+               std::lock_guard<std::mutex> g( mtx );
+               stop = true;
+               cv.notify_all();
+            }
+            reader.join();
+         }
+
+         /// @return the next block, an empty block once all blocks were returned; rethrows read and unpack errors
+         replay_block next() {
+            std::future<replay_block> f;
+            {
+               std::unique_lock<std::mutex> g( mtx );
+               if( queue.empty() && !done ) {
+                  auto start = fc::time_point::now();
+                  cv.wait( g, [this]() { return done || !queue.empty(); } );
+                  waited += fc::time_point::now() - start;
+               }
+               if( queue.empty() ) return {};
+               f = std::move( queue.front() );
+               queue.pop_front();
+               cv.notify_all();
+            }
+            return f.get();
+         }
+
+         /// time the main thread spent waiting for the read and unpack stages
+         fc::microseconds wait_time()const { return waited; }
+
+      private:
+         const size_t                             max_ahead;
+         std::mutex                               mtx;
+         std::condition_variable                  cv;
+         std::deque<std::future<replay_block>>    queue;
+         bool                                     stop = false;
+         bool                                     done = false;
+         fc::microseconds                         waited;
+         std::thread                              reader;
+   };
+
    void replay(std::function<bool()> shutdown) {
       auto blog_head = blog.head();
       auto blog_head_time = blog_head->timestamp.to_time_point();
@@ -461,18 +694,26 @@ struct controller_impl {
       if( start_block_num <= blog_head->block_num() ) {
          ilog( "existing block log, attempting to replay from ${s} to ${n} blocks",
                ("s", start_block_num)("n", blog_head->block_num()) );
+         auto phase = startup_profile::instance().phase( "replay_irreversible" );
+         replay_pipeline pipeline( blog, thread_pool.get_executor(), start_block_num, blog_head->block_num(),
+                                   replay_read_ahead_blocks );
          try {
-            while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
-               replay_push_block( next, controller::block_status::irreversible );
-               if( next->block_num() % 500 == 0 ) {
-                  ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
+            while( true ) {
+               auto next = pipeline.next();
+               if( !next.block ) break;
+               replay_push_block( next.block, controller::block_status::irreversible, std::move( next.trx_metas ) );
+               if( next.block->block_num() % 500 == 0 ) {
+                  ilog( "${n} of ${head}", ("n", next.block->block_num())("head", blog_head->block_num()) );
                   if( shutdown() ) break;
                }
             }
          } catch(  const database_guard_exception& e ) {
             except_ptr = std::current_exception();
          }
-         ilog( "${n} irreversible blocks replayed", ("n", 1 + head->block_num - start_block_num) );
+         ilog( "${n} irreversible blocks replayed, ${w} ms spent waiting for blocks to be read",
+               ("n", 1 + head->block_num - start_block_num)("w", pipeline.wait_time().count() / 1000) );
+         phase.add( "blocks", 1 + head->block_num - start_block_num );
+         phase.add( "read_wait_us", pipeline.wait_time().count() );
 
          auto pending_head = fork_db.pending_head();
          if( pending_head->block_num < head->block_num || head->block_num < fork_db.root()->block_num ) {
@@ -497,12 +738,14 @@ struct controller_impl {
       }
 
       if( !except_ptr && !shutdown() ) {
+         auto phase = startup_profile::instance().phase( "replay_reversible" );
          int rev = 0;
-         while( auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1) ) {
+         while( auto b = reversible_blocks.read_block_by_num( head->block_num + 1 ) ) {
             ++rev;
-            replay_push_block( obj->get_block(), controller::block_status::validated );
+            replay_push_block( b, controller::block_status::validated );
          }
          ilog( "${n} reversible blocks replayed", ("n",rev) );
+         phase.add( "blocks", rev );
       }
 
       auto end = fc::time_point::now();
@@ -516,16 +759,94 @@ struct controller_impl {
       }
    }
 
-   void init(std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot) {
+   /**
+    * Starts reading the state pages recorded by db.save_resident_pages() before the node stopped, in chunks spread
+    * over the thread pool, so that the first blocks after a restart do not fault them in one at a time. Does not
+    * wait for the reads, pages accessed before their chunk is read are faulted in as usual.
+    */
+   void prefetch_resident_pages() {
+      const auto ranges = db.load_resident_pages();
+      if( ranges.empty() )
+         return;
+
+      const size_t chunk_size = 64*1024*1024;
+      size_t total = 0;
+      auto post_chunk = [this]( vector<std::pair<size_t, size_t>> chunk ) {
+         boost::asio::post( thread_pool.get_executor(), [this, chunk{std::move( chunk )}]() {
+            for( const auto& r : chunk )
+               db.prefetch( r.first, r.second );
+         } );
+      };
+      vector<std::pair<size_t, size_t>> chunk;
+      size_t chunk_bytes = 0;
+      for( const auto& r : ranges ) {
+         chunk.push_back( r );
+         chunk_bytes += r.second;
+         total += r.second;
+         if( chunk_bytes >= chunk_size ) {
+            post_chunk( std::move( chunk ) );
+            chunk.clear();
+            chunk_bytes = 0;
+         }
+      }
+      if( !chunk.empty() )
+         post_chunk( std::move( chunk ) );
+
+      ilog( "prefetching ${mb} MiB of state in ${n} ranges recorded before shutdown", ("mb", total / (1024*1024))("n", ranges.size()) );
+   }
+
+   /**
+    * Starts writing the state back to its file as of `lib`, the irreversible block just committed, see
+    * chainbase::database::checkpoint. The header state of `lib` is written next to it, so that after a crash init()
+    * can undo the state to `lib` and replay the blocks after it.
+    */
+   void checkpoint_state( const block_state& lib ) {
+      if( db.checkpoint_running() ) {
+         wlog( "state checkpoint at block ${n} skipped, the previous one is still being written", ("n", lib.block_num) );
+         return;
+      }
+      const auto packed = fc::raw::pack( static_cast<const block_header_state&>( lib ) );
+      const auto path = (conf.state_dir / config::state_checkpoint_filename).generic_string();
+      const auto temp_path = path + ".tmp";
+      // in heap mode this runs in a forked child, which must not log or take locks
+      auto write_header_state = [&]() {
+         int fd = ::open( temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+         if( fd < 0 )
+            return false;
+         bool ok = ::write( fd, packed.data(), packed.size() ) == (ssize_t)packed.size() && ::fsync( fd ) == 0;
+         ok = ::close( fd ) == 0 && ok;
+         return ok && ::rename( temp_path.c_str(), path.c_str() ) == 0;
+      };
+      if( db.checkpoint( write_header_state ) )
+         ilog( "state checkpoint at block ${n} started", ("n", lib.block_num) );
+   }
+
+   /// reads and removes the header state written by the last checkpoint_state(), left behind if the node crashed
+   optional<block_header_state> take_state_checkpoint() {
+      const auto path = conf.state_dir / config::state_checkpoint_filename;
+      if( conf.read_only || conf.state_replica || !fc::exists( path ) )
+         return {};
+      string content;
+      fc::read_file_contents( path, content );
+      fc::remove( path );
+      return fc::raw::unpack<block_header_state>( content.data(), content.size() );
+   }
+
+   void init(std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot, const vector<snapshot_reader_ptr>& diffs) {
       // Setup state if necessary (or in the default case stay with already loaded state):
       uint32_t lib_num = 1u;
+      const auto checkpoint = take_state_checkpoint();
+      if( conf.db_hot_page_profile_interval && !snapshot )
+         prefetch_resident_pages();
       if( snapshot ) {
          snapshot->validate();
+         for( const auto& d : diffs )
+            d->validate();
          if( blog.head() ) {
             lib_num = blog.head()->block_num();
-            read_from_snapshot( snapshot, blog.first_block_num(), lib_num );
+            read_from_snapshot( snapshot, diffs, blog.first_block_num(), lib_num );
          } else {
-            read_from_snapshot( snapshot, 0, std::numeric_limits<uint32_t>::max() );
+            read_from_snapshot( snapshot, diffs, 0, std::numeric_limits<uint32_t>::max() );
             lib_num = head->block_num;
             blog.reset( conf.genesis, signed_block_ptr(), lib_num + 1 );
          }
@@ -556,6 +877,17 @@ struct controller_impl {
                blog.reset( conf.genesis, head->block );
             }
          } else {
+            if( checkpoint ) {
+               // the node did not shut down cleanly and the state is as of the last checkpoint: take it back to the
+               // block of the checkpoint, then replay the irreversible and reversible blocks after it
+               auto b = blog.head() && blog.first_block_num() <= checkpoint->block_num && checkpoint->block_num <= blog.head()->block_num()
+                        ? blog.read_block_by_num( checkpoint->block_num ) : signed_block_ptr();
+               ROXE_ASSERT( b && b->id() == checkpoint->id, block_log_exception,
+                           "block log does not contain block ${n} of the state checkpoint. Replay required.",
+                           ("n", checkpoint->block_num) );
+               wlog( "resuming from the state checkpoint at block ${n}", ("n", checkpoint->block_num) );
+               fork_db.reset( *checkpoint );
+            }
             lib_num = fork_db.root()->block_num;
             auto first_block_num = blog.first_block_num();
             if( blog.head() ) {
@@ -599,31 +931,24 @@ struct controller_impl {
 
       protocol_features.init( db );
 
-      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
       auto last_block_num = lib_num;
 
       if( read_mode == db_read_mode::IRREVERSIBLE ) {
          // ensure there are no reversible blocks
-         auto itr = rbi.begin();
-         if( itr != rbi.end() ) {
+         if( !reversible_blocks.empty() ) {
             wlog( "read_mode has changed to irreversible: erasing reversible blocks" );
          }
-         for( ; itr != rbi.end(); itr = rbi.begin() )
-            reversible_blocks.remove( *itr );
+         reversible_blocks.clear();
       } else {
-         auto itr = rbi.begin();
-         for( ; itr != rbi.end() && itr->blocknum <= lib_num; itr = rbi.begin() )
-            reversible_blocks.remove( *itr );
+         reversible_blocks.remove_up_to( lib_num );
 
-         ROXE_ASSERT( itr == rbi.end() || itr->blocknum == lib_num + 1, reversible_blocks_exception,
+         ROXE_ASSERT( reversible_blocks.empty() || reversible_blocks.first_block_num() == lib_num + 1, reversible_blocks_exception,
                      "gap exists between last irreversible block and first reversible block",
-                     ("lib", lib_num)("first_reversible_block_num", itr->blocknum)
+                     ("lib", lib_num)("first_reversible_block_num", reversible_blocks.first_block_num())
          );
 
-         auto ritr = rbi.rbegin();
-
-         if( ritr != rbi.rend() ) {
-            last_block_num = ritr->blocknum;
+         if( !reversible_blocks.empty() ) {
+            last_block_num = reversible_blocks.last_block_num();
          }
 
          ROXE_ASSERT( head->block_num <= last_block_num, reversible_blocks_exception,
@@ -633,23 +958,22 @@ struct controller_impl {
 
          auto pending_head = fork_db.pending_head();
 
-         if( ritr != rbi.rend()
+         if( !reversible_blocks.empty()
              && lib_num < pending_head->block_num
              && pending_head->block_num <= last_block_num
          ) {
-            auto rbitr = rbi.find( pending_head->block_num );
-            ROXE_ASSERT( rbitr != rbi.end(), reversible_blocks_exception, "pending head block not found in reversible blocks");
-            auto rev_id = rbitr->get_block_id();
-            ROXE_ASSERT( rev_id == pending_head->id,
+            auto rev_id = reversible_blocks.block_id_for_num( pending_head->block_num );
+            ROXE_ASSERT( rev_id, reversible_blocks_exception, "pending head block not found in reversible blocks");
+            ROXE_ASSERT( *rev_id == pending_head->id,
                         reversible_blocks_exception,
                         "mismatch in block id of pending head block ${num} in reversible blocks database: "
                         "expected: ${expected}, actual: ${actual}",
-                        ("num", pending_head->block_num)("expected", pending_head->id)("actual", rev_id)
+                        ("num", pending_head->block_num)("expected", pending_head->id)("actual", *rev_id)
             );
-         } else if( ritr != rbi.rend() && last_block_num < pending_head->block_num ) {
+         } else if( !reversible_blocks.empty() && last_block_num < pending_head->block_num ) {
             const auto b = fork_db.search_on_branch( pending_head->id, last_block_num );
             FC_ASSERT( b, "unexpected violation of invariants" );
-            auto rev_id = ritr->get_block_id();
+            auto rev_id = *reversible_blocks.block_id_for_num( last_block_num );
             ROXE_ASSERT( rev_id == b->id,
                         reversible_blocks_exception,
                         "mismatch in block id of last block (${num}) in reversible blocks database: "
@@ -684,6 +1008,7 @@ struct controller_impl {
       }
 
       if( report_integrity_hash ) {
+         auto phase = startup_profile::instance().phase( "integrity_hash" );
          const auto hash = calculate_integrity_hash();
          ilog( "database initialized with hash: ${hash}", ("hash", hash) );
       }
@@ -692,11 +1017,124 @@ struct controller_impl {
    ~controller_impl() {
       thread_pool.stop();
       pending.reset();
+      if( conf.db_checkpoint_interval && !conf.read_only && !conf.state_replica ) {
+         // the state written on shutdown replaces the checkpoint
+         while( db.checkpoint_running() )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+         try {
+            fc::remove( conf.state_dir / config::state_checkpoint_filename );
+         } FC_LOG_AND_DROP()
+      }
    }
 
-   void add_indices() {
-      reversible_blocks.add_index<reversible_block_index>();
+   /// ends the span of changes begun by published_state->begin_write(), the replicas see the state again
+   void publish_state() {
+      if( !published_state || conf.state_replica )
+         return;
+      vector<char> payload;
+      try {
+         published_head p;
+         p.chain_id = chain_id;
+         p.head = *head;
+         p.lib_num = fork_db.root()->block_num;
+         payload = fc::raw::pack( p );
+      } FC_LOG_AND_DROP()
+      // the span ends regardless, the replicas wait for it
+      published_state->end_write( db.revision(), payload.data(), payload.size() );
+   }
+
+   /// begins a span of changes, the replicas wait until publish_state()
+   void begin_publish_state() {
+      if( !published_state || conf.state_replica )
+         return;
+      if( !published_state->begin_write() )
+         wlog( "a state replica held the published state for too long and was assumed dead, its lock was set up again" );
+   }
 
+   void init_replica() {
+      try {
+         published_state.emplace( conf.state_dir, false );
+      } catch( const std::exception& e ) {
+         ROXE_THROW( database_exception, "cannot open the state published in ${dir}: ${e}",
+                     ("dir", conf.state_dir.generic_string())("e", e.what()) );
+      }
+      ROXE_ASSERT( published_state->writer_attached(), database_exception,
+                   "no node is publishing the state in ${dir}", ("dir", conf.state_dir.generic_string()) );
+      refresh_replica_head();
+      {
+         begin_replica_read();
+         auto end = fc::make_scoped_exit( [this]() { published_state->end_read(); } );
+         protocol_features.init( db );
+      }
+      ilog( "state replica of ${dir} at block ${n}", ("dir", conf.state_dir.generic_string())("n", head->block_num) );
+   }
+
+   /// takes the head the writer published last, @return whether it changed
+   bool refresh_replica_head() {
+      vector<char> payload;
+      uint64_t spans = 0;
+      {
+         begin_replica_read();
+         auto end = fc::make_scoped_exit( [this]() { published_state->end_read(); } );
+         spans = published_state->spans();
+         if( spans == replica_spans )
+            return false;
+         payload = published_state->payload();
+      }
+      ROXE_ASSERT( !payload.empty(), database_exception, "the node publishing the state did not publish its head" );
+      auto p = fc::raw::unpack<published_head>( payload );
+      auto bsp = std::make_shared<block_state>();
+      static_cast<block_header_state&>( *bsp ) = std::move( p.head );
+      bsp->block = std::make_shared<signed_block>( bsp->header );
+      fork_db.reset( *bsp );
+      head = bsp;
+      chain_id = chain_id_type( p.chain_id );
+      replica_lib_num = p.lib_num;
+      replica_spans = spans;
+      return true;
+   }
+
+   void begin_replica_read()const {
+      try {
+         published_state->begin_read();
+      } catch( const std::exception& e ) {
+         ROXE_THROW( database_exception, "${e}", ("e", e.what()) );
+      }
+   }
+
+   /// opens the reversible block log in dir, importing the reversible block database left there by earlier versions
+   static reversible_block_log import_reversible_block_database( const fc::path& dir, bool read_only ) {
+      auto phase = startup_profile::instance().phase( "reversible_blocks_open" );
+      reversible_block_log log( dir, read_only );
+      if( !log.empty() )
+         phase.add( "blocks", log.last_block_num() - log.first_block_num() + 1 );
+      const auto legacy_db = dir / "shared_memory.bin";
+      if( read_only || !fc::exists( legacy_db ) )
+         return log;
+
+      ilog( "importing reversible block database '${dir}' into ${f}", ("dir", dir.generic_string())("f", reversible_block_log::filename) );
+      {
+         chainbase::database old_reversible( dir, database::read_only, 0, true );
+         old_reversible.add_index<reversible_block_index>();
+         const auto& ubi = old_reversible.get_index<reversible_block_index,by_num>();
+         log.clear();
+         uint32_t num = 0;
+         try {
+            for( const auto& obj : ubi ) {
+               log.append( obj.get_block() );
+               ++num;
+            }
+         } catch( const gap_in_reversible_blocks_db& e ) {
+            wlog( "${details}", ("details", e.to_detail_string()) );
+         }
+         ilog( "imported ${n} reversible blocks", ("n", num) );
+         phase.add( "imported_blocks", num );
+      }
+      fc::remove( legacy_db );
+      return log;
+   }
+
+   void add_indices() {
       controller_index_set::add_indices(db);
       contract_database_index_set::add_indices(db);
 
@@ -714,36 +1152,205 @@ struct controller_impl {
                   */
    }
 
-   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
-      snapshot->write_section("contract_tables", [this]( auto& section ) {
-         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
-            // add a row for the table
-            section.add_row(table_row, db);
+   template<typename Section>
+   void add_contract_table_rows( Section& section, const table_id_object& table_row ) const {
+      // add a row for the table
+      section.add_row(table_row, db);
 
-            // followed by a size row and then N data rows for each type of table
-            contract_database_index_set::walk_indices([this, &section, &table_row]( auto utils ) {
-               using utils_t = decltype(utils);
-               using value_t = typename decltype(utils)::index_t::value_type;
-               using by_table_id = object_to_table_id_tag_t<value_t>;
+      // followed by a size row and then N data rows for each type of table
+      contract_database_index_set::walk_indices([this, &section, &table_row]( auto utils ) {
+         using utils_t = decltype(utils);
+         using value_t = typename decltype(utils)::index_t::value_type;
+         using by_table_id = object_to_table_id_tag_t<value_t>;
+
+         auto tid_key = boost::make_tuple(table_row.id);
+         auto next_tid_key = boost::make_tuple(table_id_object::id_type(table_row.id._id + 1));
+
+         unsigned_int size = utils_t::template size_range<by_table_id>(db, tid_key, next_tid_key);
+         section.add_row(size, db);
+
+         utils_t::template walk_range<by_table_id>(db, tid_key, next_tid_key, [this, &section]( const auto &row ) {
+            section.add_row(row, db);
+         });
+      });
+   }
+
+   void start_table_journal() {
+      if( !conf.differential_snapshots ) return;
+      const auto& idx = db.get_index<table_id_multi_index>().indices();
+      table_journal.emplace();
+      table_journal->base_block_id = head->id;
+      table_journal->base_block_num = head->block_num;
+      table_journal->base_next_table_id = table_id_object::id_type( idx.empty() ? 0 : idx.rbegin()->id._id + 1 );
+   }
+
+   void add_contract_table_changes_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
+      vector<const table_id_object*> tables;
+      vector<snapshot_table_key> removed;
+      for( const auto& key : table_journal->changed ) {
+         const auto* t = db.find<table_id_object, by_code_scope_table>( boost::make_tuple( std::get<0>(key), std::get<1>(key), std::get<2>(key) ) );
+         if( t )
+            tables.push_back( t );
+         else
+            removed.push_back( snapshot_table_key{ std::get<0>(key), std::get<1>(key), std::get<2>(key) } );
+      }
+      // tables created since the base follow all older ones; written in id order the loader can keep that order
+      std::sort( tables.begin(), tables.end(), []( const table_id_object* a, const table_id_object* b ) { return a->id < b->id; } );
 
-               auto tid_key = boost::make_tuple(table_row.id);
-               auto next_tid_key = boost::make_tuple(table_id_object::id_type(table_row.id._id + 1));
+      snapshot->write_section("removed_contract_tables", [this, &removed]( auto& section ) {
+         for( const auto& key : removed )
+            section.add_row( key, db );
+      });
 
-               unsigned_int size = utils_t::template size_range<by_table_id>(db, tid_key, next_tid_key);
-               section.add_row(size, db);
+      snapshot->write_section("contract_table_changes", [this, &tables]( auto& section ) {
+         for( const auto* t : tables ) {
+            section.add_row( snapshot_table_change{ !(t->id < table_journal->base_next_table_id) }, db );
+            add_contract_table_rows( section, *t );
+         }
+      });
+   }
 
-               utils_t::template walk_range<by_table_id>(db, tid_key, next_tid_key, [this, &section]( const auto &row ) {
-                  section.add_row(row, db);
+   void remove_contract_table( const table_id_object& table, bool keep_table ) {
+      contract_database_index_set::walk_indices([this, &table]( auto utils ) {
+         using index_t = typename decltype(utils)::index_t;
+         using by_table_id = object_to_table_id_tag_t<typename index_t::value_type>;
+
+         const auto& idx = db.get_index<index_t, by_table_id>();
+         auto itr = idx.lower_bound( boost::make_tuple( table.id ) );
+         while( itr != idx.end() && itr->t_id == table.id ) {
+            const auto& row = *itr;
+            ++itr;
+            db.remove( row );
+         }
+      });
+      if( !keep_table )
+         db.remove( table );
+   }
+
+   void apply_contract_table_changes_from_snapshot( const snapshot_reader_ptr& snapshot ) {
+      snapshot->read_section("removed_contract_tables", [this]( auto& section ) {
+         bool more = !section.empty();
+         while( more ) {
+            snapshot_table_key key;
+            more = section.read_row( key, db );
+            if( const auto* t = db.find<table_id_object, by_code_scope_table>( boost::make_tuple( key.code, key.scope, key.table ) ) )
+               remove_contract_table( *t, false );
+         }
+      });
+
+      snapshot->read_section("contract_table_changes", [this]( auto& section ) {
+         bool more = !section.empty();
+         while( more ) {
+            snapshot_table_change change;
+            section.read_row( change, db );
+            snapshot_table_id_row row;
+            section.read_row( row, db );
+
+            const auto* existing = db.find<table_id_object, by_code_scope_table>( boost::make_tuple( row.code, row.scope, row.table ) );
+            if( existing && change.created ) {
+               remove_contract_table( *existing, false );
+               existing = nullptr;
+            }
+
+            table_id_object::id_type t_id;
+            if( existing ) {
+               // keep the position of the table so that it is walked in the same order as on the writing node
+               remove_contract_table( *existing, true );
+               db.modify( *existing, [&row]( auto& t ) {
+                  t.payer = row.payer;
+                  t.count = row.count;
                });
+               t_id = existing->id;
+            } else {
+               t_id = db.create<table_id_object>( [&row]( auto& t ) {
+                  t.code = row.code;
+                  t.scope = row.scope;
+                  t.table = row.table;
+                  t.payer = row.payer;
+                  t.count = row.count;
+               }).id;
+            }
+
+            contract_database_index_set::walk_indices([this, &section, &t_id, &more](auto utils) {
+               using utils_t = decltype(utils);
+
+               unsigned_int size;
+               more = section.read_row(size, db);
+
+               for (size_t idx = 0; idx < size.value; idx++) {
+                  utils_t::create(db, [this, &section, &more, &t_id](auto& row) {
+                     row.t_id = t_id;
+                     more = section.read_row(row, db);
+                  });
+               }
+            });
+         }
+      });
+   }
+
+   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
+      if( !snapshot->accepts_packed_rows() || conf.thread_pool_size < 2 ) {
+         snapshot->write_section("contract_tables", [this]( auto& section ) {
+            index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
+               add_contract_table_rows(section, table_row);
             });
          });
+         return;
+      }
+
+      /* Batches of tables are packed on the thread pool while the main thread, which is blocked here so the
+       * state cannot change, splices the finished batches into the section in table order. The number of
+       * batches in flight is bounded to bound the memory held by packed rows.
+       */
+      vector<const table_id_object*> tables;
+      index_utils<table_id_multi_index>::walk(db, [&tables]( const table_id_object& table_row ){
+         tables.push_back(&table_row);
+      });
+
+      const size_t tables_per_batch = 64;
+      const size_t max_in_flight = conf.thread_pool_size * 2;
+      auto& pool = self.get_thread_pool();
+
+      snapshot->write_section("contract_tables", [&]( auto& section ) {
+         std::deque<std::future<packed_snapshot_rows>> in_flight;
+         size_t next = 0;
+         auto submit = [&]() {
+            const size_t begin = next;
+            const size_t end = std::min(tables.size(), begin + tables_per_batch);
+            next = end;
+            in_flight.emplace_back( async_thread_pool( pool, [this, &tables, begin, end]() {
+               packed_snapshot_rows rows;
+               for( size_t i = begin; i < end; ++i )
+                  add_contract_table_rows(rows, *tables[i]);
+               return rows;
+            } ) );
+         };
+
+         try {
+            while( next < tables.size() || !in_flight.empty() ) {
+               while( next < tables.size() && in_flight.size() < max_in_flight )
+                  submit();
+               auto rows = in_flight.front().get();
+               in_flight.pop_front();
+               section.add_packed_rows(rows);
+            }
+         } catch( ... ) {
+            // workers reference tables, wait for them before unwinding
+            for( auto& f : in_flight )
+               f.wait();
+            throw;
+         }
       });
    }
 
    void read_contract_tables_from_snapshot( const snapshot_reader_ptr& snapshot ) {
       snapshot->read_section("contract_tables", [this]( auto& section ) {
          bool more = !section.empty();
+         uint64_t tables = 0;
          while (more) {
+            if( ++tables % 100000 == 0 )
+               ilog( "Loaded ${n} contract tables from snapshot", ("n", tables) );
+
             // read the row for the table
             table_id_object::id_type t_id;
             index_utils<table_id_multi_index>::create(db, [this, &section, &t_id](auto& row) {
@@ -769,11 +1376,17 @@ struct controller_impl {
       });
    }
 
-   void add_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
+   void add_to_snapshot( const snapshot_writer_ptr& snapshot, bool differential = false ) const {
       snapshot->write_section<chain_snapshot_header>([this]( auto &section ){
          section.add_row(chain_snapshot_header(), db);
       });
 
+      if( differential ) {
+         snapshot->write_section<differential_snapshot_header>([this]( auto &section ){
+            section.add_row(differential_snapshot_header{table_journal->base_block_id}, db);
+         });
+      }
+
       snapshot->write_section<genesis_state>([this]( auto &section ){
          section.add_row(conf.genesis, db);
       });
@@ -797,18 +1410,57 @@ struct controller_impl {
          });
       });
 
-      add_contract_tables_to_snapshot(snapshot);
+      if( differential )
+         add_contract_table_changes_to_snapshot(snapshot);
+      else
+         add_contract_tables_to_snapshot(snapshot);
 
       authorization.add_to_snapshot(snapshot);
       resource_limits.add_to_snapshot(snapshot);
    }
 
-   void read_from_snapshot( const snapshot_reader_ptr& snapshot, uint32_t blog_start, uint32_t blog_end ) {
-      snapshot->read_section<chain_snapshot_header>([this]( auto &section ){
-         chain_snapshot_header header;
-         section.read_row(header, db);
-         header.validate();
+   block_id_type read_snapshot_head_id( const snapshot_reader_ptr& snapshot ) {
+      block_id_type id;
+      snapshot->read_section<block_state>([this, &id]( auto &section ){
+         block_header_state head_header_state;
+         section.read_row(head_header_state, db);
+         id = head_header_state.id;
       });
+      return id;
+   }
+
+   void read_from_snapshot( const snapshot_reader_ptr& base, const vector<snapshot_reader_ptr>& diffs, uint32_t blog_start, uint32_t blog_end ) {
+      const auto start = fc::time_point::now();
+      auto phase = startup_profile::instance().phase( "snapshot_load" );
+
+      auto validate_header = [this]( const snapshot_reader_ptr& s ) {
+         s->read_section<chain_snapshot_header>([this]( auto &section ){
+            chain_snapshot_header header;
+            section.read_row(header, db);
+            header.validate();
+         });
+      };
+
+      validate_header( base );
+      ROXE_ASSERT( !base->has_section<differential_snapshot_header>(), snapshot_validation_exception,
+                   "A differential snapshot can only be loaded on top of a full snapshot" );
+      block_id_type previous = read_snapshot_head_id( base );
+      for( const auto& d : diffs ) {
+         validate_header( d );
+         ROXE_ASSERT( d->has_section<differential_snapshot_header>(), snapshot_validation_exception,
+                      "Only differential snapshots can be applied on top of a snapshot" );
+         d->read_section<differential_snapshot_header>([this, &previous]( auto &section ){
+            differential_snapshot_header header;
+            section.read_row(header, db);
+            ROXE_ASSERT( header.base_block_id == previous, snapshot_validation_exception,
+                         "Differential snapshot is based on block ${b} instead of block ${p}",
+                         ("b", header.base_block_id)("p", previous) );
+         });
+         previous = read_snapshot_head_id( d );
+      }
+
+      // the chain state sections of the newest snapshot replace those of the ones it is based on
+      const auto& snapshot = diffs.empty() ? base : diffs.back();
 
 
       snapshot->read_section<block_state>([this, blog_start, blog_end]( auto &section ){
@@ -846,13 +1498,21 @@ struct controller_impl {
             }
          });
       });
+      ilog( "Loaded chain state sections from snapshot in ${t} ms", ("t", (fc::time_point::now() - start).count() / 1000) );
 
-      read_contract_tables_from_snapshot(snapshot);
+      read_contract_tables_from_snapshot(base);
+      for( const auto& d : diffs )
+         apply_contract_table_changes_from_snapshot(d);
+      ilog( "Loaded contract tables from snapshot in ${t} ms", ("t", (fc::time_point::now() - start).count() / 1000) );
 
       authorization.read_from_snapshot(snapshot);
       resource_limits.read_from_snapshot(snapshot);
 
       db.set_revision( head->block_num );
+      ilog( "Loaded snapshot at block ${n} in ${t} ms", ("n", head->block_num)("t", (fc::time_point::now() - start).count() / 1000) );
+      phase.add( "block_num", head->block_num );
+      phase.add( "differential_snapshots", diffs.size() );
+      phase.add( "state_used_bytes", db.get_segment_manager()->get_size() - db.get_free_memory() );
    }
 
    sha256 calculate_integrity_hash() const {
@@ -877,6 +1537,7 @@ struct controller_impl {
          a.name = name;
          a.set_privileged( is_privileged );
       });
+      self.invalidate_receiver_dispatch();
 
       const auto& owner_permission  = authorization.create_permission(name, config::owner_name, 0,
                                                                       owner, conf.genesis.initial_timestamp );
@@ -991,6 +1652,7 @@ struct controller_impl {
       trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
       trx_context.billed_cpu_time_us = billed_cpu_time_us;
       trx_context.enforce_whiteblacklist = enforce_whiteblacklist;
+      trx_context.detailed_traces = detailed_traces();
       transaction_trace_ptr trace = trx_context.trace;
       try {
          trx_context.init_for_implicit_trx();
@@ -1019,6 +1681,28 @@ struct controller_impl {
       return trace;
    }
 
+   void cache_scheduled_transaction( const transaction_id_type& id, const packed_transaction_ptr& trx ) {
+      auto& cache = scheduled_trxs.trxs;
+      if( cache.size() >= scheduled_trx_cache::max_entries )
+         cache.clear();
+      cache[id] = trx;
+   }
+
+   /// the cached transaction if it is still the one gto holds, an undo or a replacement may have changed gto since
+   packed_transaction_ptr take_scheduled_transaction( const generated_transaction_object& gto ) {
+      auto& cache = scheduled_trxs.trxs;
+      auto itr = cache.find( gto.trx_id );
+      if( itr == cache.end() )
+         return {};
+      packed_transaction_ptr trx = std::move( itr->second );
+      cache.erase( itr );
+
+      const auto& packed = trx->get_packed_transaction();
+      if( packed.size() != gto.packed_trx.size() || memcmp( packed.data(), gto.packed_trx.data(), packed.size() ) != 0 )
+         return {};
+      return trx;
+   }
+
    int64_t remove_scheduled_transaction( const generated_transaction_object& gto ) {
       int64_t ram_delta = -(config::billable_size_v<generated_transaction_object> + gto.packed_trx.size());
       resource_limits.add_pending_ram_usage( gto.payer, ram_delta );
@@ -1072,16 +1756,22 @@ struct controller_impl {
       //
       // IF the transaction FAILs in a subjective way, `undo_session` should expire without being squashed
       // resulting in the GTO being restored and available for a future block to retire.
+      auto cached = take_scheduled_transaction( gto );
       int64_t trx_removal_ram_delta = remove_scheduled_transaction(gto);
 
-      fc::datastream<const char*> ds( gtrx.packed_trx.data(), gtrx.packed_trx.size() );
-
       ROXE_ASSERT( gtrx.delay_until <= self.pending_block_time(), transaction_exception, "this transaction isn't ready",
                  ("gtrx.delay_until",gtrx.delay_until)("pbt",self.pending_block_time())          );
 
-      signed_transaction dtrx;
-      fc::raw::unpack(ds,static_cast<transaction&>(dtrx) );
-      transaction_metadata_ptr trx = std::make_shared<transaction_metadata>( dtrx );
+      transaction_metadata_ptr trx;
+      if( cached ) {
+         trx = std::make_shared<transaction_metadata>( cached );
+      } else {
+         fc::datastream<const char*> ds( gtrx.packed_trx.data(), gtrx.packed_trx.size() );
+         signed_transaction unpacked;
+         fc::raw::unpack( ds, static_cast<transaction&>(unpacked) );
+         trx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( std::move(unpacked) ) );
+      }
+      const signed_transaction& dtrx = trx->packed_trx->get_signed_transaction();
       trx->accepted = true;
       trx->scheduled = true;
 
@@ -1114,6 +1804,7 @@ struct controller_impl {
       trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
       trx_context.billed_cpu_time_us = billed_cpu_time_us;
       trx_context.enforce_whiteblacklist = gtrx.sender.empty() ? true : !sender_avoids_whitelist_blacklist_enforcement( gtrx.sender );
+      trx_context.detailed_traces = detailed_traces();
       trace = trx_context.trace;
       try {
          trx_context.init_for_deferred_trx( gtrx.published );
@@ -1139,6 +1830,7 @@ struct controller_impl {
                                         trace->net_usage );
 
          fc::move_append( pending->_block_stage.get<building_block>()._actions, move(trx_context.executed) );
+         record_access_set( trx_context, trx );
 
          trace->account_ram_delta = account_delta( gtrx.payer, trx_removal_ram_delta );
 
@@ -1227,6 +1919,49 @@ struct controller_impl {
    } FC_CAPTURE_AND_RETHROW() } /// push_scheduled_transaction
 
 
+   void record_access_set( transaction_context& trx_context, const transaction_metadata_ptr& trx ) {
+      if( !trx_context.table_access ) return;
+      auto& access = *trx_context.table_access;
+
+      const uint64_t seq = ++table_writes.seq;
+      if( table_writes.last_write.size() + access.writes.size() > table_write_journal::max_entries ) {
+         table_writes.last_write.clear();
+         table_writes.stale_before = seq;
+      }
+      for( const auto& k : access.writes )
+         table_writes.last_write[k] = seq;
+      if( access.native_writes )
+         table_writes.last_native_write = seq;
+
+      if( trx->implicit ) return;
+      trx->table_access = std::make_shared<const table_access_set>( access );
+      trx->table_access_seq = seq;
+      pending->_block_stage.get<building_block>()._trx_access_sets.emplace_back( std::move( access ) );
+   }
+
+   bool table_access_stale( const transaction_metadata& trx )const {
+      if( !trx.table_access || trx.table_access_seq < table_writes.stale_before || trx.table_access_seq < table_writes.last_native_write )
+         return true;
+      auto written_since = [&]( const flat_set<table_access_set::table_key>& keys ) {
+         for( const auto& k : keys ) {
+            auto itr = table_writes.last_write.find( k );
+            if( itr != table_writes.last_write.end() && itr->second > trx.table_access_seq )
+               return true;
+         }
+         return false;
+      };
+      return written_since( trx.table_access->reads ) || written_since( trx.table_access->writes );
+   }
+
+   void report_execution_waves( const building_block& bb ) {
+      if( bb._trx_access_sets.empty() ) return;
+
+      auto waves = compute_execution_waves( bb._trx_access_sets );
+      uint32_t num_waves = *std::max_element( waves.begin(), waves.end() ) + 1;
+      ilog( "block ${n}: ${t} transactions could execute in ${w} conflict-free waves",
+            ("n", bb._pending_block_header_state.block_num)("t", waves.size())("w", num_waves) );
+   }
+
    /**
     *  Adds the transaction receipt to the pending block and returns it.
     */
@@ -1263,6 +1998,8 @@ struct controller_impl {
          // call recover keys so that trx->sig_cpu_usage is set correctly
          const fc::microseconds sig_cpu_usage = check_auth ? std::get<0>( trx->recover_keys( chain_id ) ) : fc::microseconds();
          const flat_set<public_key_type>& recovered_keys = check_auth ? std::get<1>( trx->recover_keys( chain_id ) ) : flat_set<public_key_type>();
+         if( conf.profile_apply && check_auth )
+            apply_times.auth += fc::time_point::now() - start;
          if( !explicit_billed_cpu_time ) {
             fc::microseconds already_consumed_time( ROXE_PERCENT(sig_cpu_usage.count(), conf.sig_cpu_bill_pct) );
 
@@ -1281,6 +2018,7 @@ struct controller_impl {
          trx_context.deadline = deadline;
          trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
          trx_context.billed_cpu_time_us = billed_cpu_time_us;
+         trx_context.detailed_traces = detailed_traces();
          trace = trx_context.trace;
          try {
             if( trx->implicit ) {
@@ -1296,6 +2034,7 @@ struct controller_impl {
             trx_context.delay = fc::seconds(trn.delay_sec);
 
             if( check_auth ) {
+               auto auth_timer = time_phase( apply_times.auth );
                authorization.check_authorization(
                        trn.actions,
                        recovered_keys,
@@ -1308,6 +2047,16 @@ struct controller_impl {
             trx_context.exec();
             trx_context.finalize(); // Automatically rounds up network and CPU usage in trace and bills payers if successful
 
+            if( trx->dry_run ) {
+               transaction_receipt_header r;
+               r.status = transaction_receipt::executed;
+               r.cpu_usage_us = trx_context.billed_cpu_time_us;
+               r.net_usage_words = trace->net_usage / 8;
+               trace->receipt = r;
+               trx_context.undo();
+               return trace;
+            }
+
             auto restore = make_block_restore_point();
 
             if (!trx->implicit) {
@@ -1323,6 +2072,7 @@ struct controller_impl {
                r.net_usage_words = trace->net_usage / 8;
                trace->receipt = r;
             }
+            record_access_set( trx_context, trx );
 
             fc::move_append(pending->_block_stage.get<building_block>()._actions, move(trx_context.executed));
 
@@ -1357,6 +2107,9 @@ struct controller_impl {
             trace->except_ptr = std::current_exception();
          }
 
+         if( trx->dry_run )
+            return trace;
+
          if (!failure_is_subjective(*trace->except)) {
             unapplied_transactions.erase( trx->signed_id );
          }
@@ -1385,6 +2138,7 @@ struct controller_impl {
          ROXE_ASSERT( db.revision() == head->block_num, database_exception, "db revision is not on par with head block",
                      ("db.revision()", db.revision())("controller_head_block", head->block_num)("fork_db_head_block", fork_db.head()->block_num) );
 
+         auto session_timer = time_phase( apply_times.chainbase );
          pending.emplace( maybe_session(db), *head, when, confirm_block_count, new_protocol_feature_activations );
       } else {
          pending.emplace( maybe_session(), *head, when, confirm_block_count, new_protocol_feature_activations );
@@ -1469,7 +2223,7 @@ struct controller_impl {
 
          if( gpo.proposed_schedule_block_num.valid() && // if there is a proposed schedule that was proposed in a block ...
              ( *gpo.proposed_schedule_block_num <= pbhs.dpos_irreversible_blocknum ) && // ... that has now become irreversible ...
-             pbhs.prev_pending_schedule.schedule.producers.size() == 0 // ... and there was room for a new pending schedule prior to any possible promotion
+             pbhs.prev_pending_schedule.schedule->producers.size() == 0 // ... and there was room for a new pending schedule prior to any possible promotion
          )
          {
             // Promote proposed schedule to pending schedule.
@@ -1522,10 +2276,12 @@ struct controller_impl {
    {
       ROXE_ASSERT( pending, block_validate_exception, "it is not valid to finalize when there is no pending block");
       ROXE_ASSERT( pending->_block_stage.contains<building_block>(), block_validate_exception, "already called finalize_block");
+      auto finalize_timer = time_phase( apply_times.finalize );
 
       try {
 
       auto& pbhs = pending->get_pending_block_header_state();
+      fc::tracing::scoped_span span( "finalize_block", pbhs.block_num );
 
       // Update resource limits:
       resource_limits.process_account_limit_updates();
@@ -1539,6 +2295,10 @@ struct controller_impl {
 
       auto& bb = pending->_block_stage.get<building_block>();
 
+      if( conf.record_table_access_sets ) {
+         report_execution_waves( bb );
+      }
+
       // Create (unsigned) block:
       auto block_ptr = std::make_shared<signed_block>( pbhs.make_block_header(
          calculate_trx_merkle(),
@@ -1580,6 +2340,8 @@ struct controller_impl {
     * @post regardless of the success of commit block there is no active pending block
     */
    void commit_block( bool add_to_fork_db ) {
+      auto finalize_timer = time_phase( apply_times.finalize );
+      fc::tracing::scoped_span span( "commit_block" );
       auto reset_pending_on_exit = fc::make_scoped_exit([this]{
          pending.reset();
       });
@@ -1587,8 +2349,11 @@ struct controller_impl {
       try {
          ROXE_ASSERT( pending->_block_stage.contains<completed_block>(), block_validate_exception,
                      "cannot call commit_block until pending block is completed" );
+         ROXE_ASSERT( pending->_block_stage.get<completed_block>()._signed, block_validate_exception,
+                     "cannot call commit_block until pending block is signed" );
 
          auto bsp = pending->_block_stage.get<completed_block>()._block_state;
+         span.set_arg( bsp->block_num );
 
          if( add_to_fork_db ) {
             fork_db.add( bsp );
@@ -1599,17 +2364,18 @@ struct controller_impl {
          }
 
          if( !replay_head_time && read_mode != db_read_mode::IRREVERSIBLE ) {
-            reversible_blocks.create<reversible_block_object>( [&]( auto& ubo ) {
-               ubo.blocknum = bsp->block_num;
-               ubo.set_block( bsp->block );
-            });
+            reversible_blocks.append( bsp->block );
          }
 
          if( add_to_fork_db ) {
             log_irreversible();
          }
 
-         emit( self.accepted_block, bsp );
+         {
+            fc::tracing::scoped_span signal_span( "accepted_block_signal", bsp->block_num );
+            emit( self.accepted_block, bsp );
+         }
+         release_trx_metas( *bsp );
       } catch (...) {
          // dont bother resetting pending, instead abort the block
          reset_pending_on_exit.cancel();
@@ -1684,24 +2450,23 @@ struct controller_impl {
 
    void apply_block( const block_state_ptr& bsp, controller::block_status s )
    { try {
+      auto apply_timer = time_phase( apply_times.apply );
       try {
          const signed_block_ptr& b = bsp->block;
          const auto& new_protocol_feature_activations = bsp->get_new_protocol_feature_activations();
+         const uint32_t block_num = b->block_num();
+         fc::tracing::scoped_span span( "apply_block", block_num );
 
          ROXE_ASSERT( b->block_extensions.size() == 0, block_validate_exception, "no supported block extensions" );
          auto producer_block_id = b->id();
          start_block( b->timestamp, b->confirmed, new_protocol_feature_activations, s, producer_block_id);
 
-         std::vector<transaction_metadata_ptr> packed_transactions;
-         packed_transactions.reserve( b->transactions.size() );
-         for( const auto& receipt : b->transactions ) {
-            if( receipt.trx.contains<packed_transaction>()) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
-               if( !self.skip_auth_check() ) {
-                  transaction_metadata::start_recover_keys( mtrx, thread_pool.get_executor(), chain_id, microseconds::maximum() );
-               }
-               packed_transactions.emplace_back( std::move( mtrx ) );
+         // reuse the metadata created when the block was received, key recovery is likely already done
+         std::vector<transaction_metadata_ptr> packed_transactions =
+               block_trxs_match( *bsp ) ? bsp->trxs : create_block_trx_metas( *bsp );
+         if( !self.skip_auth_check() ) {
+            for( const auto& mtrx : packed_transactions ) {
+               transaction_metadata::start_recover_keys( mtrx, thread_pool.get_executor(), chain_id, microseconds::maximum() );
             }
          }
 
@@ -1711,6 +2476,7 @@ struct controller_impl {
          for( const auto& receipt : b->transactions ) {
             const auto& trx_receipts = pending->_block_stage.get<building_block>()._pending_trx_receipts;
             auto num_pending_receipts = trx_receipts.size();
+            fc::tracing::scoped_span trx_span( "apply_transaction", block_num );
             if( receipt.trx.contains<packed_transaction>() ) {
                trace = push_transaction( packed_transactions.at(packed_idx++), fc::time_point::maximum(), receipt.cpu_usage_us, true );
             } else if( receipt.trx.contains<transaction_id_type>() ) {
@@ -1770,6 +2536,55 @@ struct controller_impl {
       }
    } FC_CAPTURE_AND_RETHROW() } /// apply_block
 
+   /// the packed transactions are not copied, each metadata shares ownership of the block holding its transaction
+   /// a block kept in the fork database for fork switching does not need its transaction metadata once applied
+   void release_trx_metas( block_state& bs ) {
+      if( bs.trxs.empty() ) return;
+      released_metas.trxs += bs.trxs.size();
+      released_metas.bytes += bs.release_trxs();
+      ++released_metas.blocks;
+   }
+
+   static vector<transaction_metadata_ptr> create_block_trx_metas( const signed_block_ptr& b ) {
+      vector<transaction_metadata_ptr> trx_metas;
+      trx_metas.reserve( b->transactions.size() );
+      for( auto& receipt : b->transactions ) {
+         if( receipt.trx.contains<packed_transaction>() ) {
+            trx_metas.emplace_back( std::make_shared<transaction_metadata>(
+                  packed_transaction_ptr( b, &receipt.trx.get<packed_transaction>() ) ) );
+         }
+      }
+      return trx_metas;
+   }
+
+   /// for a block applied before, typically one reapplied after a fork switch, the metadata starts out with the keys
+   /// recovered the first time, so their signatures are not recovered again
+   static vector<transaction_metadata_ptr> create_block_trx_metas( const block_state& bs ) {
+      auto trx_metas = create_block_trx_metas( bs.block );
+      if( bs.recovered_keys.size() == trx_metas.size() ) {
+         for( size_t i = 0; i < trx_metas.size(); ++i )
+            trx_metas[i]->signing_keys_future = bs.recovered_keys[i];
+      }
+      return trx_metas;
+   }
+
+   /// @return true if bs.trxs holds, in order, the metadata of every packed transaction of bs.block
+   static bool block_trxs_match( const block_state& bs ) {
+      if( !bs.block || bs.trxs.empty() ) return false;
+      auto itr = bs.trxs.begin();
+      for( const auto& receipt : bs.block->transactions ) {
+         if( !receipt.trx.contains<packed_transaction>() ) continue;
+         if( itr == bs.trxs.end() ) return false;
+         const auto& pt = receipt.trx.get<packed_transaction>();
+         const auto& mpt = *(*itr)->packed_trx;
+         if( &mpt != &pt &&
+             (mpt.get_signatures() != pt.get_signatures() || mpt.get_packed_transaction() != pt.get_packed_transaction()) )
+            return false;
+         ++itr;
+      }
+      return itr == bs.trxs.end();
+   }
+
    std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b ) {
       ROXE_ASSERT( b, block_validate_exception, "null block" );
 
@@ -1783,9 +2598,21 @@ struct controller_impl {
       ROXE_ASSERT( prev, unlinkable_block_exception,
                   "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
-      return async_thread_pool( thread_pool.get_executor(), [b, prev, control=this]() {
+      // Start recovering transaction keys now so it runs alongside header and producer signature validation
+      // below and, in irreversible mode or on a fork switch, alongside application of the blocks before this one.
+      auto trx_metas = create_block_trx_metas( b );
+      const bool may_skip_auth = !conf.force_all_checks &&
+            (conf.block_validation_mode == validation_mode::LIGHT || conf.trusted_producers.count( b->producer ));
+      if( !may_skip_auth ) {
+         for( const auto& mtrx : trx_metas ) {
+            transaction_metadata::start_recover_keys( mtrx, thread_pool.get_executor(), chain_id, microseconds::maximum() );
+         }
+      }
+
+      return async_thread_pool( thread_pool.get_executor(), [b, prev, trx_metas{std::move( trx_metas )}, control=this]() mutable {
+         fc::tracing::scoped_span span( "create_block_state", b->block_num() );
          const bool skip_validate_signee = false;
-         return std::make_shared<block_state>(
+         auto bsp = std::make_shared<block_state>(
                         *prev,
                         move( b ),
                         [control]( block_timestamp_type timestamp,
@@ -1794,19 +2621,32 @@ struct controller_impl {
                         { control->check_protocol_features( timestamp, cur_features, new_features ); },
                         skip_validate_signee
          );
+         bsp->trxs = std::move( trx_metas );
+         return bsp;
       } );
    }
 
    void push_block( std::future<block_state_ptr>& block_state_future ) {
       controller::block_status s = controller::block_status::complete;
       ROXE_ASSERT(!pending, block_validate_exception, "it is not valid to push a block when there is a pending block");
+      ROXE_ASSERT(!conf.state_replica, block_validate_exception, "a state replica does not apply blocks");
+      ROXE_ASSERT(!standby, block_validate_exception, "a standby applies the state deltas of its primary until it is promoted");
+      ROXE_ASSERT(!irreversible_apply_failed, database_exception,
+                  "the state holds part of an irreversible block which failed to apply, restore it from a snapshot or replay");
+
+      begin_publish_state();
+      auto publish = fc::make_scoped_exit( [this]() {
+         publish_state();
+      } );
 
       auto reset_prod_light_validation = fc::make_scoped_exit([old_value=trusted_producer_light_validation, this]() {
          trusted_producer_light_validation = old_value;
       });
+      fc::tracing::scoped_span span( "push_block" );
       try {
          block_state_ptr bsp = block_state_future.get();
          const auto& b = bsp->block;
+         span.set_arg( bsp->block_num );
 
          emit( self.pre_accepted_block, b );
 
@@ -1827,9 +2667,9 @@ struct controller_impl {
       } FC_LOG_AND_RETHROW( )
    }
 
-   void replay_push_block( const signed_block_ptr& b, controller::block_status s ) {
+   void replay_push_block( const signed_block_ptr& b, controller::block_status s,
+                           vector<transaction_metadata_ptr> trx_metas = vector<transaction_metadata_ptr>() ) {
       self.validate_db_available_size();
-      self.validate_reversible_available_size();
 
       ROXE_ASSERT(!pending, block_validate_exception, "it is not valid to push a block when there is a pending block");
 
@@ -1849,6 +2689,8 @@ struct controller_impl {
                         { check_protocol_features( timestamp, cur_features, new_features ); },
                         skip_validate_signee
          );
+         // metadata created ahead of time is reused by apply_block
+         bsp->trxs = std::move( trx_metas );
 
          if( s != controller::block_status::irreversible ) {
             fork_db.add( bsp, true );
@@ -1865,6 +2707,7 @@ struct controller_impl {
             emit( self.irreversible_block, bsp );
 
             if (!self.skip_db_sessions(s)) {
+               auto commit_timer = time_phase( apply_times.chainbase );
                db.commit(bsp->block_num);
             }
 
@@ -1877,6 +2720,87 @@ struct controller_impl {
       } FC_LOG_AND_RETHROW( )
    }
 
+   bool push_state_delta( const signed_block_ptr& b, const state_delta& delta ) {
+      ROXE_ASSERT( standby, block_validate_exception, "only a standby applies state deltas" );
+      ROXE_ASSERT( !pending, block_validate_exception, "it is not valid to push a state delta when there is a pending block" );
+      ROXE_ASSERT( b && b->id() == delta.block_id, block_validate_exception, "state delta of block ${d} comes with another block",
+                   ("d", delta.block_id) );
+      self.validate_db_available_size();
+
+      const auto& id = delta.block_id;
+      const uint32_t block_num = b->block_num();
+      fc::tracing::scoped_span span( "push_state_delta", block_num );
+
+      // entries are replayed from the start of the stream on restart, and a fork switch of the primary repeats blocks
+      if( block_num <= fork_db.root()->block_num )
+         return false;
+      if( block_num <= head->block_num ) {
+         const auto applied = fork_db.search_on_branch( head->id, block_num );
+         if( applied && applied->id == id )
+            return false;
+      }
+
+      const uint32_t prev_num = block_header::num_from_id( b->previous );
+      block_id_type on_branch;
+      if( prev_num == fork_db.root()->block_num ) {
+         on_branch = fork_db.root()->id;
+      } else if( prev_num > fork_db.root()->block_num && prev_num <= head->block_num ) {
+         if( const auto prev = fork_db.search_on_branch( head->id, prev_num ) )
+            on_branch = prev->id;
+      }
+      ROXE_ASSERT( on_branch == b->previous, unlinkable_block_exception, "state delta of block ${id} does not link to the head ${h} or one of its reversible blocks",
+                   ("id", id)("h", head->id) );
+
+      // the primary switched forks, the blocks it left are dropped rather than kept for a switch back
+      while( head->id != b->previous ) {
+         const auto popped = head->id;
+         pop_block();
+         fork_db.remove( popped );
+      }
+
+      emit( self.pre_accepted_block, b );
+      const bool skip_validate_signee = false;
+      auto bsp = std::make_shared<block_state>(
+                     *head,
+                     b,
+                     [this]( block_timestamp_type timestamp,
+                             const flat_set<digest_type>& cur_features,
+                             const vector<digest_type>& new_features )
+                     { check_protocol_features( timestamp, cur_features, new_features ); },
+                     skip_validate_signee
+      );
+      fork_db.add( bsp );
+      emit( self.accepted_block_header, bsp );
+
+      try {
+         ROXE_ASSERT( db.revision() == head->block_num, database_exception, "db revision is not on par with head block",
+                      ("db.revision()", db.revision())("controller_head_block", head->block_num) );
+         auto session = db.start_undo_session( true );
+         for( const auto& f : bsp->get_new_protocol_feature_activations() )
+            protocol_features.activate_feature( f, block_num );
+         apply_state_delta( db, delta );
+         session.push();
+      } catch( ... ) {
+         protocol_features.popped_blocks_to( head->block_num );
+         fork_db.remove( id );
+         throw;
+      }
+
+      fork_db.mark_valid( bsp );
+      head = bsp;
+      if( read_mode != db_read_mode::IRREVERSIBLE )
+         reversible_blocks.append( b );
+      if( table_journal ) {
+         // the delta does not go through apply_context, so the journal misses the tables it changes
+         wlog( "applied the state delta of block ${n}, a full snapshot is required before the next differential one", ("n", block_num) );
+         table_journal.reset();
+      }
+
+      emit( self.accepted_block, bsp );
+      log_irreversible();
+      return true;
+   }
+
    void maybe_switch_forks( const block_state_ptr& new_head, controller::block_status s ) {
       bool head_changed = true;
       if( new_head->header.previous == head->id ) {
@@ -1884,6 +2808,7 @@ struct controller_impl {
             apply_block( new_head, s );
             fork_db.mark_valid( new_head );
             head = new_head;
+            release_trx_metas( *new_head );
          } catch ( const fc::exception& e ) {
             fork_db.remove( new_head->id );
             throw;
@@ -1909,6 +2834,7 @@ struct controller_impl {
                                                        : controller::block_status::complete );
                fork_db.mark_valid( *ritr );
                head = *ritr;
+               release_trx_metas( **ritr );
             } catch (const fc::exception& e) {
                except = e;
             }
@@ -1963,13 +2889,25 @@ struct controller_impl {
    }
 
    checksum256_type calculate_action_merkle() {
-      vector<digest_type> action_digests;
       const auto& actions = pending->_block_stage.get<building_block>()._actions;
-      action_digests.reserve( actions.size() );
+      // same digests as action_receipt::digest(), the packed receipts are hashed as one batch
+      vector<uint32_t> sizes;
+      sizes.reserve( actions.size() );
       for( const auto& a : actions )
-         action_digests.emplace_back( a.digest() );
+         sizes.push_back( fc::raw::pack_size( a ) );
+      vector<char> packed( std::accumulate( sizes.begin(), sizes.end(), size_t(0) ) );
+      vector<const char*> data;
+      data.reserve( actions.size() );
+      fc::datastream<char*> ds( packed.data(), packed.size() );
+      for( const auto& a : actions ) {
+         data.push_back( packed.data() + ds.tellp() );
+         fc::raw::pack( ds, a );
+      }
 
-      return merkle( move(action_digests) );
+      vector<digest_type> action_digests( actions.size() );
+      digest_type::hash_many( data.data(), sizes.data(), actions.size(), action_digests.data() );
+
+      return merkle( move(action_digests), thread_pool.get_executor(), conf.thread_pool_size );
    }
 
    checksum256_type calculate_trx_merkle() {
@@ -1979,12 +2917,24 @@ struct controller_impl {
       for( const auto& a : trxs )
          trx_digests.emplace_back( a.digest() );
 
-      return merkle( move(trx_digests) );
+      return merkle( move(trx_digests), thread_pool.get_executor(), conf.thread_pool_size );
    }
 
+   /**
+    * The authorities of the producers account are rebuilt from the active schedule at the start of every block, so
+    * a block starts with them matching its schedule. Transactions may change them with updateauth, which the next
+    * block reverts. Once they were found matching, they can therefore only differ when the active schedule changed,
+    * when a permission of the producers account was changed through the authorization manager since, or after a
+    * block was popped.
+    */
    void update_producers_authority() {
-      const auto& producers = pending->get_pending_block_header_state().active_schedule.producers;
+      const producer_schedule_type& active_schedule = pending->get_pending_block_header_state().active_schedule;
+      if( producers_authority_checked && *producers_authority_checked == authorization.producers_permission_changes() &&
+          active_schedule.version == head->active_schedule->version )
+         return;
+      const auto& producers = active_schedule.producers;
 
+      bool modified = false;
       auto update_permission = [&]( auto& permission, auto threshold ) {
          auto auth = authority( threshold, {}, {});
          for( auto& p : producers ) {
@@ -1995,6 +2945,7 @@ struct controller_impl {
             db.modify(permission, [&]( auto& po ) {
                po.auth = auth;
             });
+            modified = true;
          }
       };
 
@@ -2015,7 +2966,9 @@ struct controller_impl {
                                                        config::minority_producers_permission_name}),
                          calculate_threshold( 1, 3 ) /* more than one-third */                       );
 
-      //TODO: Add tests
+      // a modification is undone with the pending block, only authorities found matching are known to persist
+      if( !modified )
+         producers_authority_checked = authorization.producers_permission_changes();
    }
 
    void create_block_summary(const block_id_type& id) {
@@ -2031,10 +2984,18 @@ struct controller_impl {
       //Look for expired transactions in the deduplication list, and remove them.
       auto& transaction_idx = db.get_mutable_index<transaction_multi_index>();
       const auto& dedupe_index = transaction_idx.indices().get<by_expiration>();
-      auto now = self.pending_block_time();
-      while( (!dedupe_index.empty()) && ( now > fc::time_point(dedupe_index.begin()->expiration) ) ) {
-         transaction_idx.remove(*dedupe_index.begin());
-      }
+      const auto now = self.pending_block_time();
+      // expired means now is past the expiration, which includes the second now falls in unless now starts it
+      const fc::time_point_sec cutoff( now );
+      const auto last = fc::time_point( cutoff ) == now ? dedupe_index.lower_bound( cutoff ) : dedupe_index.upper_bound( cutoff );
+      transaction_idx.remove_range( dedupe_index.begin(), last );
+   }
+
+   /// traces of transactions pushed while building a block are returned to the caller, those of blocks being
+   /// validated or replayed only reach the applied_transaction subscribers
+   bool detailed_traces()const {
+      return detailed_traces_required || conf.contracts_console || !pending
+             || pending->_block_status == controller::block_status::incomplete;
    }
 
    bool sender_avoids_whitelist_blacklist_enforcement( account_name sender )const {
@@ -2256,12 +3217,22 @@ void controller::add_indices() {
    my->add_indices();
 }
 
-void controller::startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot ) {
+void controller::startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot,
+                          const vector<snapshot_reader_ptr>& differential_snapshots ) {
+   ROXE_ASSERT( snapshot || differential_snapshots.empty(), snapshot_validation_exception,
+                "Differential snapshots require the snapshot they are based on" );
    if( snapshot ) {
       ilog( "Starting initialization from snapshot, this may take a significant amount of time" );
    }
+   auto phase = startup_profile::instance().phase( "controller_startup" );
+   if( my->conf.state_replica ) {
+      ROXE_ASSERT( !snapshot, snapshot_validation_exception, "A state replica does not start from a snapshot" );
+      my->init_replica();
+      phase.add( "head_block_num", my->head->block_num );
+      return;
+   }
    try {
-      my->init(shutdown, snapshot);
+      my->init(shutdown, snapshot, differential_snapshots);
    } catch (boost::interprocess::bad_alloc& e) {
       if ( snapshot )
          elog( "db storage not configured to have enough storage for the provided snapshot, please increase and retry snapshot" );
@@ -2270,6 +3241,55 @@ void controller::startup( std::function<bool()> shutdown, const snapshot_reader_
    if( snapshot ) {
       ilog( "Finished initialization from snapshot" );
    }
+   my->start_table_journal();
+   if( my->conf.publish_state_revision ) {
+      my->published_state.emplace( my->conf.state_dir, true );
+      my->publish_state();
+   }
+   phase.add( "head_block_num", my->head->block_num );
+}
+
+bool controller::is_state_replica()const {
+   return my->conf.state_replica;
+}
+
+bool controller::refresh_replica_head() {
+   ROXE_ASSERT( my->conf.state_replica, misc_exception, "not a state replica" );
+   return my->refresh_replica_head();
+}
+
+void controller::begin_replica_read()const {
+   my->begin_replica_read();
+}
+
+void controller::end_replica_read()const {
+   my->published_state->end_read();
+}
+
+bool controller::replica_writer_attached()const {
+   return my->published_state && my->published_state->writer_attached();
+}
+
+bool controller::is_standby()const {
+   return my->standby;
+}
+
+void controller::promote_standby() {
+   ROXE_ASSERT( my->standby, misc_exception, "not a standby" );
+   my->standby = false;
+   ilog( "promoted standby at block ${n}, blocks are validated in full from now on", ("n", my->head->block_num) );
+}
+
+optional<state_delta> controller::get_state_delta( const block_state_ptr& bsp )const {
+   // the undo state of the block is the head of the stack unless undo sessions were skipped
+   const auto range = my->db.undo_stack_revision_range();
+   if( my->db.revision() != bsp->block_num || range.first >= range.second )
+      return optional<state_delta>();
+   return make_state_delta( my->db, bsp->id );
+}
+
+bool controller::push_state_delta( const signed_block_ptr& b, const state_delta& delta ) {
+   return my->push_state_delta( b, delta );
 }
 
 const chainbase::database& controller::db()const { return my->db; }
@@ -2460,9 +3480,47 @@ block_state_ptr controller::finalize_block( const std::function<signature_type(
    return bsp;
 }
 
+digest_type controller::finalize_unsigned_block() {
+   validate_db_available_size();
+
+   my->finalize_block();
+
+   auto& ab = my->pending->_block_stage.get<assembled_block>();
+
+   auto bsp = std::make_shared<block_state>(
+                  std::move( ab._pending_block_header_state ),
+                  ab._unsigned_block,
+                  std::move( ab._trx_metas ),
+                  []( block_timestamp_type timestamp,
+                      const flat_set<digest_type>& cur_features,
+                      const vector<digest_type>& new_features )
+                  {},
+                  true // not signed yet
+              );
+
+   my->pending->_block_stage = completed_block{ bsp, false };
+
+   return bsp->sig_digest();
+}
+
+block_state_ptr controller::complete_block( const signature_type& producer_signature ) {
+   ROXE_ASSERT( my->pending && my->pending->_block_stage.contains<completed_block>() &&
+                !my->pending->_block_stage.get<completed_block>()._signed,
+                block_validate_exception, "there is no unsigned pending block to complete" );
+
+   auto& cb = my->pending->_block_stage.get<completed_block>();
+   auto& bsp = cb._block_state;
+   ROXE_ASSERT( bsp->block_signing_key == fc::crypto::public_key( producer_signature, bsp->sig_digest() ),
+                wrong_signing_key, "block is signed with unexpected key" );
+   bsp->header.producer_signature = producer_signature;
+   bsp->block->producer_signature = producer_signature;
+   cb._signed = true;
+
+   return bsp;
+}
+
 void controller::commit_block() {
    validate_db_available_size();
-   validate_reversible_available_size();
    my->commit_block(true);
 }
 
@@ -2480,7 +3538,6 @@ std::future<block_state_ptr> controller::create_block_state_future( const signed
 
 void controller::push_block( std::future<block_state_ptr>& block_state_future ) {
    validate_db_available_size();
-   validate_reversible_available_size();
    my->push_block( block_state_future );
 }
 
@@ -2628,6 +3685,8 @@ const vector<transaction_receipt>& controller::get_pending_trx_receipts()const {
 }
 
 uint32_t controller::last_irreversible_block_num() const {
+   if( my->conf.state_replica )
+      return my->replica_lib_num;
    return my->fork_db.root()->block_num;
 }
 
@@ -2670,16 +3729,24 @@ signed_block_ptr controller::fetch_block_by_number( uint32_t block_num )const  {
    return my->blog.read_block_by_num(block_num);
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+vector<char> controller::fetch_serialized_block_by_number( uint32_t block_num )const  { try {
+   auto blk_state = fetch_block_state_by_number( block_num );
+   if( blk_state ) {
+      return fc::raw::pack( *blk_state->block );
+   }
+
+   return my->blog.read_serialized_block_by_num(block_num);
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
 block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
    auto state = my->fork_db.get_block(id);
    return state;
 }
 
 block_state_ptr controller::fetch_block_state_by_number( uint32_t block_num )const  { try {
-   const auto& rev_blocks = my->reversible_blocks.get_index<reversible_block_index,by_num>();
-   auto objitr = rev_blocks.find(block_num);
+   auto id = my->reversible_blocks.block_id_for_num( block_num );
 
-   if( objitr == rev_blocks.end() ) {
+   if( !id ) {
       if( my->read_mode == db_read_mode::IRREVERSIBLE ) {
          return my->fork_db.search_on_branch( my->fork_db.pending_head()->id, block_num );
       } else {
@@ -2687,7 +3754,7 @@ block_state_ptr controller::fetch_block_state_by_number( uint32_t block_num )con
       }
    }
 
-   return my->fork_db.get_block( objitr->get_block_id() );
+   return my->fork_db.get_block( *id );
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
 block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try {
@@ -2697,10 +3764,8 @@ block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try
 
    if( !find_in_blog ) {
       if( my->read_mode != db_read_mode::IRREVERSIBLE ) {
-         const auto& rev_blocks = my->reversible_blocks.get_index<reversible_block_index,by_num>();
-         auto objitr = rev_blocks.find(block_num);
-         if( objitr != rev_blocks.end() ) {
-            return objitr->get_block_id();
+         if( auto id = my->reversible_blocks.block_id_for_num( block_num ) ) {
+            return *id;
          }
       } else {
          auto bsp = my->fork_db.search_on_branch( my->fork_db.pending_head()->id, block_num );
@@ -2723,7 +3788,30 @@ sha256 controller::calculate_integrity_hash()const { try {
 
 void controller::write_snapshot( const snapshot_writer_ptr& snapshot ) const {
    ROXE_ASSERT( !my->pending, block_validate_exception, "cannot take a consistent snapshot with a pending block" );
-   return my->add_to_snapshot(snapshot);
+   my->add_to_snapshot(snapshot);
+   my->start_table_journal();
+}
+
+void controller::write_differential_snapshot( const snapshot_writer_ptr& snapshot ) const {
+   ROXE_ASSERT( !my->pending, block_validate_exception, "cannot take a consistent snapshot with a pending block" );
+   ROXE_ASSERT( my->table_journal, snapshot_exception,
+                "no base for a differential snapshot, differential snapshots must be enabled and a full snapshot written first" );
+   my->add_to_snapshot(snapshot, true);
+   my->start_table_journal();
+}
+
+optional<block_id_type> controller::differential_snapshot_base()const {
+   if( my->table_journal ) return my->table_journal->base_block_id;
+   return {};
+}
+
+void controller::start_differential_snapshot_base() {
+   ROXE_ASSERT( !my->pending, block_validate_exception, "cannot take a consistent snapshot with a pending block" );
+   my->start_table_journal();
+}
+
+void controller::record_table_change( name code, name scope, name table ) {
+   if( my->table_journal ) my->table_journal->changed.emplace( code, scope, table );
 }
 
 void controller::pop_block() {
@@ -2843,7 +3931,7 @@ bool controller::skip_auth_check() const {
 }
 
 bool controller::skip_db_sessions( block_status bs ) const {
-   bool consider_skipping = bs == block_status::irreversible;
+   bool consider_skipping = bs == block_status::irreversible || my->applying_irreversible;
    return consider_skipping
       && !my->conf.disable_replay_opts
       && !my->in_trx_requiring_checks;
@@ -2865,6 +3953,31 @@ bool controller::contracts_console()const {
    return my->conf.contracts_console;
 }
 
+void controller::require_detailed_traces() {
+   my->detailed_traces_required = true;
+}
+
+void controller::require_console_output() {
+   my->detailed_traces_required = true;
+   my->console_output_required = true;
+}
+
+bool controller::console_output_enabled()const {
+   return my->conf.contracts_console || my->console_output_required;
+}
+
+uint32_t controller::max_console_output_bytes()const {
+   return my->conf.max_console_output_bytes;
+}
+
+bool controller::record_table_access_sets()const {
+   return my->conf.record_table_access_sets;
+}
+
+bool controller::table_access_stale( const transaction_metadata& trx )const {
+   return my->table_access_stale( trx );
+}
+
 chain_id_type controller::get_chain_id()const {
    return my->chain_id;
 }
@@ -2887,10 +4000,75 @@ const apply_handler* controller::find_apply_handler( account_name receiver, acco
    }
    return nullptr;
 }
+void controller::register_native_contract_action( account_name receiver, const digest_type& code_hash,
+                                                  account_name contract, action_name act, apply_handler handler ) {
+   ROXE_ASSERT( code_hash != digest_type(), misc_exception, "native contract actions replace deployed code" );
+   my->native_contract_actions[receiver][std::make_tuple( code_hash, contract, act )] = std::move( handler );
+   my->receiver_dispatches.receivers.clear();
+}
+
+const apply_handler* controller::find_native_contract_action( account_name receiver, const digest_type& code_hash,
+                                                              account_name contract, action_name act )const {
+   auto receiver_actions = my->native_contract_actions.find( receiver );
+   if( receiver_actions == my->native_contract_actions.end() )
+      return nullptr;
+   auto handler = receiver_actions->second.find( std::make_tuple( code_hash, contract, act ) );
+   if( handler == receiver_actions->second.end() )
+      return nullptr;
+   return &handler->second;
+}
+
+controller::receiver_dispatch controller::get_receiver_dispatch( account_name receiver )const {
+   auto& cache = my->receiver_dispatches;
+   const auto epoch = my->db.get<dynamic_global_property_object>().dispatch_epoch;
+   if( cache.epoch != epoch || cache.receivers.size() >= controller_impl::receiver_dispatch_cache::max_entries ) {
+      cache.receivers.clear();
+      cache.epoch = epoch;
+   }
+
+   auto itr = cache.receivers.find( receiver );
+   if( itr != cache.receivers.end() )
+      return itr->second;
+
+   receiver_dispatch dispatch;
+   dispatch.account = &my->db.get<account_metadata_object,by_name>( receiver );
+   dispatch.has_native_handlers = my->apply_handlers.count( receiver ) || my->native_contract_actions.count( receiver );
+   cache.receivers.emplace( receiver, dispatch );
+   return dispatch;
+}
+
+void controller::cache_scheduled_transaction( const transaction_id_type& id, const packed_transaction_ptr& trx ) {
+   my->cache_scheduled_transaction( id, trx );
+}
+
+void controller::invalidate_receiver_dispatch() {
+   // genesis creates accounts before the dynamic global properties exist
+   const auto* dgpo = my->db.find<dynamic_global_property_object>();
+   if( dgpo == nullptr ) return;
+
+   // a fresh epoch, also above those left in the database by an earlier run
+   my->last_dispatch_epoch = std::max( my->last_dispatch_epoch, dgpo->dispatch_epoch ) + 1;
+   my->db.modify( *dgpo, [&]( auto& p ) {
+      p.dispatch_epoch = my->last_dispatch_epoch;
+   });
+}
+
 wasm_interface& controller::get_wasm_interface() {
    return my->wasmif;
 }
 
+const controller::apply_timing& controller::get_apply_timing()const {
+   return my->apply_times;
+}
+
+void controller::clear_apply_timing() {
+   my->apply_times = apply_timing();
+}
+
+const controller::released_trx_metas& controller::get_released_trx_metas()const {
+   return my->released_metas;
+}
+
 const account_object& controller::get_account( account_name name )const
 { try {
    return my->db.get<account_object, by_name>(name);
@@ -2969,10 +4147,8 @@ void controller::validate_db_available_size() const {
    ROXE_ASSERT(free >= guard, database_guard_exception, "database free: ${f}, guard size: ${g}", ("f", free)("g",guard));
 }
 
-void controller::validate_reversible_available_size() const {
-   const auto free = my->reversible_blocks.get_segment_manager()->get_free_memory();
-   const auto guard = my->conf.reversible_guard_size;
-   ROXE_ASSERT(free >= guard, reversible_guard_exception, "reversible free: ${f}, guard size: ${g}", ("f", free)("g",guard));
+uint64_t controller::state_guard_size() const {
+   return my->conf.state_guard_size;
 }
 
 bool controller::is_protocol_feature_activated( const digest_type& feature_digest )const {
@@ -3076,6 +4252,14 @@ void controller_impl::on_activation<builtin_protocol_feature_t::get_sender>() {
    } );
 }
 
+template<>
+void controller_impl::on_activation<builtin_protocol_feature_t::batched_index_reads>() {
+   db.modify( db.get<protocol_state_object>(), [&]( auto& ps ) {
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "db_idx64_range" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "db_idx128_range" );
+   } );
+}
+
 template<>
 void controller_impl::on_activation<builtin_protocol_feature_t::replace_deferred>() {
    const auto& indx = db.get_index<account_ram_correction_index, by_id>();
@@ -3096,3 +4280,5 @@ void controller_impl::on_activation<builtin_protocol_feature_t::replace_deferred
 /// End of protocol feature activation handlers
 
 } } /// roxe::chain
+
+FC_REFLECT( roxe::chain::published_head, (chain_id)(head)(lib_num) )
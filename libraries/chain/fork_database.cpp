@@ -18,11 +18,27 @@ namespace roxe { namespace chain {
    const uint32_t fork_database::min_supported_version = 1;
    const uint32_t fork_database::max_supported_version = 1;
 
+   const uint32_t fork_database::journal_version = 1;
+
    /**
     * History:
     * Version 1: initial version of the new refactored fork database portable format
     */
 
+   /**
+    * The journal starts with the magic number and the journal version, followed by records of
+    * a one byte type, a four byte payload size and the packed payload.
+    */
+   enum class journal_record : uint8_t {
+      reset        = 1, ///< block_header_state of the new root
+      add          = 2, ///< block_state
+      mark_valid   = 3, ///< block id
+      rollback     = 4, ///< no payload
+      advance_root = 5, ///< block id of the new root
+      remove       = 6, ///< block id
+      head         = 7  ///< block id of the head when the fork database was closed
+   };
+
    struct by_block_id;
    struct by_block_num;
    struct by_lib_block_num;
@@ -31,7 +47,7 @@ namespace roxe { namespace chain {
       block_state_ptr,
       indexed_by<
          hashed_unique< tag<by_block_id>, member<block_header_state, block_id_type, &block_header_state::id>, std::hash<block_id_type>>,
-         ordered_non_unique< tag<by_prev>, const_mem_fun<block_header_state, const block_id_type&, &block_header_state::prev> >,
+         hashed_non_unique< tag<by_prev>, const_mem_fun<block_header_state, const block_id_type&, &block_header_state::prev>, std::hash<block_id_type>>,
          ordered_unique< tag<by_lib_block_num>,
             composite_key< block_state,
                member<block_state,                        bool,          &block_state::validated>,
@@ -66,13 +82,185 @@ namespace roxe { namespace chain {
       block_state_ptr       head;
       fc::path              datadir;
 
+      std::ofstream         journal;
+      uint64_t              journal_records = 0;
+
       void add( const block_state_ptr& n,
                 bool ignore_duplicate, bool validate,
                 const std::function<void( block_timestamp_type,
                                           const flat_set<digest_type>&,
                                           const vector<digest_type>& )>& validator );
+
+      void log( journal_record r, const vector<char>& payload ) {
+         if( !journal.is_open() ) return;
+         fc::raw::pack( journal, static_cast<uint8_t>(r) );
+         fc::raw::pack( journal, static_cast<uint32_t>(payload.size()) );
+         journal.write( payload.data(), payload.size() );
+         journal.flush();
+         ++journal_records;
+      }
+
+      template<typename T>
+      void log( journal_record r, const T& payload ) {
+         if( journal.is_open() )
+            log( r, fc::raw::pack( payload ) );
+      }
+
+      void replay_journal( const fc::path& journal_path,
+                           const std::function<void( block_timestamp_type,
+                                                     const flat_set<digest_type>&,
+                                                     const vector<digest_type>& )>& validator );
+
+      /// rewrites the journal as the current root followed by the blocks in the fork database
+      void compact_journal();
+
+      /// removes the block and its descendants without journaling the removal
+      void remove( const block_id_type& id );
    };
 
+   namespace {
+      /// recreates the members of a deserialized block state which are not serialized, but for trxs which the
+      /// controller recreates from the block when it needs them
+      block_state_ptr restore_block_state( block_state&& s ) {
+         s.header_exts = s.block->validate_and_extract_header_extensions();
+         return std::make_shared<block_state>( std::move( s ) );
+      }
+   }
+
+   void fork_database_impl::replay_journal( const fc::path& journal_path,
+                                            const std::function<void( block_timestamp_type,
+                                                                      const flat_set<digest_type>&,
+                                                                      const vector<digest_type>& )>& validator )
+   {
+      string content;
+      fc::read_file_contents( journal_path, content );
+      fc::datastream<const char*> ds( content.data(), content.size() );
+
+      uint32_t totem = 0;
+      uint32_t version = 0;
+      fc::raw::unpack( ds, totem );
+      fc::raw::unpack( ds, version );
+      ROXE_ASSERT( totem == fork_database::magic_number, fork_database_exception,
+                  "Fork database journal '${filename}' has unexpected magic number: ${actual_totem}. Expected ${expected_totem}",
+                  ("filename", journal_path.generic_string())
+                  ("actual_totem", totem)
+                  ("expected_totem", fork_database::magic_number) );
+      ROXE_ASSERT( version == fork_database::journal_version, fork_database_exception,
+                  "Unsupported version ${version} of fork database journal '${filename}'",
+                  ("filename", journal_path.generic_string())
+                  ("version", version) );
+
+      optional<block_id_type> closed_head;
+      uint64_t records = 0;
+      while( ds.remaining() > 0 ) {
+         uint8_t type = 0;
+         uint32_t size = 0;
+         if( ds.remaining() < sizeof(type) + sizeof(size) ) {
+            wlog( "ignoring truncated record at the end of fork database journal '${filename}'", ("filename", journal_path.generic_string()) );
+            break;
+         }
+         fc::raw::unpack( ds, type );
+         fc::raw::unpack( ds, size );
+         if( ds.remaining() < size ) {
+            wlog( "ignoring truncated record at the end of fork database journal '${filename}'", ("filename", journal_path.generic_string()) );
+            break;
+         }
+         fc::datastream<const char*> payload( ds.pos(), size );
+         ds.skip( size );
+         ++records;
+
+         closed_head.reset();
+         switch( static_cast<journal_record>(type) ) {
+            case journal_record::reset: {
+               block_header_state bhs;
+               fc::raw::unpack( payload, bhs );
+               self.reset( bhs );
+               break;
+            }
+            case journal_record::add: {
+               block_state s;
+               fc::raw::unpack( payload, s );
+               add( restore_block_state( std::move( s ) ), false, true, validator );
+               break;
+            }
+            case journal_record::mark_valid: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               auto b = self.get_block( id );
+               ROXE_ASSERT( b, fork_database_exception, "fork database journal marks unknown block ${id} as valid", ("id", id) );
+               self.mark_valid( b );
+               break;
+            }
+            case journal_record::rollback:
+               self.rollback_head_to_root();
+               break;
+            case journal_record::advance_root: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               self.advance_root( id );
+               break;
+            }
+            case journal_record::remove: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               self.remove( id );
+               break;
+            }
+            case journal_record::head: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               closed_head = id;
+               break;
+            }
+            default:
+               ROXE_THROW( fork_database_exception, "unknown record type ${t} in fork database journal '${filename}'",
+                           ("t", type)("filename", journal_path.generic_string()) );
+         }
+      }
+
+      if( !root ) return;
+      if( closed_head ) {
+         ROXE_ASSERT( head && head->id == *closed_head, fork_database_exception,
+                     "head reconstructed from fork database journal does not match the head it was closed with; '${filename}' is likely corrupted",
+                     ("filename", journal_path.generic_string()) );
+      } else {
+         wlog( "fork database was not closed cleanly, recovered ${n} blocks from ${r} journal records",
+               ("n", index.size())("r", records) );
+      }
+   }
+
+   void fork_database_impl::compact_journal() {
+      const auto journal_path = datadir / config::forkdb_journal_filename;
+      const auto temp_path = datadir / (string(config::forkdb_journal_filename) + ".tmp");
+
+      if( journal.is_open() )
+         journal.close();
+      journal_records = 0;
+
+      {
+         std::ofstream out( temp_path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+         fc::raw::pack( out, fork_database::magic_number );
+         fc::raw::pack( out, fork_database::journal_version );
+         journal.swap( out );
+      }
+
+      if( root ) {
+         log( journal_record::reset, *static_cast<block_header_state*>(&*root) );
+
+         // a block always has a higher number than the block it links to
+         vector<block_state_ptr> blocks( index.begin(), index.end() );
+         std::sort( blocks.begin(), blocks.end(), []( const block_state_ptr& a, const block_state_ptr& b ) {
+            return a->block_num < b->block_num;
+         } );
+         for( const auto& b : blocks )
+            log( journal_record::add, *b );
+      }
+
+      journal.close();
+      fc::rename( temp_path, journal_path );
+      journal.open( journal_path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+   }
+
 
    fork_database::fork_database( const fc::path& data_dir )
    :my( new fork_database_impl( *this, data_dir ) )
@@ -87,6 +275,7 @@ namespace roxe { namespace chain {
          fc::create_directories(my->datadir);
 
       auto fork_db_dat = my->datadir / config::forkdb_filename;
+      auto journal_path = my->datadir / config::forkdb_journal_filename;
       if( fc::exists( fork_db_dat ) ) {
          try {
             string content;
@@ -125,14 +314,7 @@ namespace roxe { namespace chain {
             for( uint32_t i = 0, n = size.value; i < n; ++i ) {
                block_state s;
                fc::raw::unpack( ds, s );
-               for( const auto& receipt : s.block->transactions ) {
-                  if( receipt.trx.contains<packed_transaction>() ) {
-                     const auto& pt = receipt.trx.get<packed_transaction>();
-                     s.trxs.push_back( std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>(pt) ) );
-                  }
-               }
-               s.header_exts = s.block->validate_and_extract_header_extensions();
-               my->add( std::make_shared<block_state>( move( s ) ), false, true, validator );
+               my->add( restore_block_state( std::move( s ) ), false, true, validator );
             }
             block_id_type head_id;
             fc::raw::unpack( ds, head_id );
@@ -159,69 +341,31 @@ namespace roxe { namespace chain {
          } FC_CAPTURE_AND_RETHROW( (fork_db_dat) )
 
          fc::remove( fork_db_dat );
+      } else if( fc::exists( journal_path ) ) {
+         try {
+            my->replay_journal( journal_path, validator );
+         } FC_CAPTURE_AND_RETHROW( (journal_path) )
       }
+
+      my->compact_journal();
    }
 
    void fork_database::close() {
-      auto fork_db_dat = my->datadir / config::forkdb_filename;
+      if( !my->journal.is_open() ) return;
 
       if( !my->root ) {
          if( my->index.size() > 0 ) {
             elog( "fork_database is in a bad state when closing; not writing out '${filename}'",
-                  ("filename", fork_db_dat.generic_string()) );
+                  ("filename", (my->datadir / config::forkdb_journal_filename).generic_string()) );
          }
-         return;
-      }
-
-      std::ofstream out( fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
-      fc::raw::pack( out, magic_number );
-      fc::raw::pack( out, max_supported_version ); // write out current version which is always max_supported_version
-      fc::raw::pack( out, *static_cast<block_header_state*>(&*my->root) );
-      uint32_t num_blocks_in_fork_db = my->index.size();
-      fc::raw::pack( out, unsigned_int{num_blocks_in_fork_db} );
-
-      const auto& indx = my->index.get<by_lib_block_num>();
-
-      auto unvalidated_itr = indx.rbegin();
-      auto unvalidated_end = boost::make_reverse_iterator( indx.lower_bound( false ) );
-
-      auto validated_itr = unvalidated_end;
-      auto validated_end = indx.rend();
-
-      for(  bool unvalidated_remaining = (unvalidated_itr != unvalidated_end),
-                 validated_remaining   = (validated_itr != validated_end);
-
-            unvalidated_remaining || validated_remaining;
-
-            unvalidated_remaining = (unvalidated_itr != unvalidated_end),
-            validated_remaining   = (validated_itr != validated_end)
-         )
-      {
-         auto itr = (validated_remaining ? validated_itr : unvalidated_itr);
-
-         if( unvalidated_remaining && validated_remaining ) {
-            if( first_preferred( **validated_itr, **unvalidated_itr ) ) {
-               itr = unvalidated_itr;
-               ++unvalidated_itr;
-            } else {
-               ++validated_itr;
-            }
-         } else if( unvalidated_remaining ) {
-            ++unvalidated_itr;
-         } else {
-            ++validated_itr;
-         }
-
-         fc::raw::pack( out, *(*itr) );
-      }
-
-      if( my->head ) {
-         fc::raw::pack( out, my->head->id );
+      } else if( my->head ) {
+         my->log( journal_record::head, my->head->id );
       } else {
          elog( "head not set in fork database; '${filename}' will be corrupted",
-               ("filename", fork_db_dat.generic_string()) );
+               ("filename", (my->datadir / config::forkdb_journal_filename).generic_string()) );
       }
 
+      my->journal.close();
       my->index.clear();
    }
 
@@ -235,6 +379,7 @@ namespace roxe { namespace chain {
       static_cast<block_header_state&>(*my->root) = root_bhs;
       my->root->validated = true;
       my->head = my->root;
+      my->log( journal_record::reset, root_bhs );
    }
 
    void fork_database::rollback_head_to_root() {
@@ -247,6 +392,7 @@ namespace roxe { namespace chain {
          ++itr;
       }
       my->head = my->root;
+      my->log( journal_record::rollback, vector<char>() );
    }
 
    void fork_database::advance_root( const block_id_type& id ) {
@@ -272,7 +418,7 @@ namespace roxe { namespace chain {
 
       // The other blocks to be removed are removed using the remove method so that orphaned branches do not remain in the fork database.
       for( const auto& block_id : blocks_to_remove ) {
-         remove( block_id );
+         my->remove( block_id );
       }
 
       // Even though fork database no longer needs block or trxs when a block state becomes a root of the tree,
@@ -280,6 +426,11 @@ namespace roxe { namespace chain {
       // parts of the code which run asynchronously (e.g. mongo_db_plugin) may later expect it remain unmodified.
 
       my->root = new_root;
+
+      my->log( journal_record::advance_root, id );
+      // blocks leaving the fork database are never removed from the journal, rewrite it once they dominate
+      if( my->journal_records > 8 * my->index.size() + 1024 )
+         my->compact_journal();
    }
 
    block_header_state_ptr fork_database::get_block_header( const block_id_type& id )const {
@@ -326,6 +477,7 @@ namespace roxe { namespace chain {
          if( ignore_duplicate ) return;
          ROXE_THROW( fork_database_exception, "duplicate block added", ("id", n->id) );
       }
+      log( journal_record::add, *n );
 
       auto candidate = index.get<by_lib_block_num>().begin();
       if( (*candidate)->is_valid() ) {
@@ -442,25 +594,29 @@ namespace roxe { namespace chain {
 
    /// remove all of the invalid forks built off of this id including this id
    void fork_database::remove( const block_id_type& id ) {
+      my->remove( id );
+      my->log( journal_record::remove, id );
+   }
+
+   void fork_database_impl::remove( const block_id_type& id ) {
       vector<block_id_type> remove_queue{id};
-      const auto& previdx = my->index.get<by_prev>();
-      const auto head_id = my->head->id;
+      const auto& previdx = index.get<by_prev>();
+      const auto head_id = head->id;
 
       for( uint32_t i = 0; i < remove_queue.size(); ++i ) {
          ROXE_ASSERT( remove_queue[i] != head_id, fork_database_exception,
                      "removing the block and its descendants would remove the current head block" );
 
-         auto previtr = previdx.lower_bound( remove_queue[i] );
-         while( previtr != previdx.end() && (*previtr)->header.previous == remove_queue[i] ) {
+         auto children = previdx.equal_range( remove_queue[i] );
+         for( auto previtr = children.first; previtr != children.second; ++previtr ) {
             remove_queue.push_back( (*previtr)->id );
-            ++previtr;
          }
       }
 
       for( const auto& block_id : remove_queue ) {
-         auto itr = my->index.find( block_id );
-         if( itr != my->index.end() )
-            my->index.erase(itr);
+         auto itr = index.find( block_id );
+         if( itr != index.end() )
+            index.erase(itr);
       }
    }
 
@@ -477,6 +633,7 @@ namespace roxe { namespace chain {
       by_id_idx.modify( itr, []( block_state_ptr& bsp ) {
          bsp->validated = true;
       } );
+      my->log( journal_record::mark_valid, h->id );
 
       auto candidate = my->index.get<by_lib_block_num>().begin();
       if( first_preferred( **candidate, *my->head ) ) {
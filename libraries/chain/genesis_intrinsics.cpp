@@ -5,9 +5,16 @@
 
 #include <roxe/chain/genesis_intrinsics.hpp>
 
+#include <array>
+#include <functional>
+#include <iterator>
+#include <string>
+
 namespace roxe { namespace chain {
 
-const std::vector<const char*> genesis_intrinsics = {
+namespace {
+
+constexpr const char* genesis_intrinsic_names[] = {
    "__ashrti3",
    "__lshlti3",
    "__lshrti3",
@@ -178,4 +185,74 @@ const std::vector<const char*> genesis_intrinsics = {
    "memset"
 };
 
+constexpr size_t genesis_intrinsic_count = std::size( genesis_intrinsic_names );
+
+/**
+ * Perfect hash over genesis_intrinsic_names, searched for at compile time: the seed is bumped until every name
+ * lands in its own slot, so a lookup is one hash, one probe and one string compare.
+ */
+struct genesis_intrinsic_table {
+   static constexpr uint32_t slot_bits = 12;
+   static constexpr uint8_t  empty     = 0xff;
+
+   static constexpr uint64_t hash( uint64_t seed, std::string_view name ) {
+      uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+      for( char c : name ) {
+         h ^= static_cast<uint8_t>( c );
+         h *= 0x100000001b3ULL;
+      }
+      return h;
+   }
+
+   static constexpr uint32_t slot( uint64_t h ) {
+      return static_cast<uint32_t>( (h * 0x9e3779b97f4a7c15ULL) >> (64 - slot_bits) );
+   }
+
+   uint64_t                                  seed = 0;
+   std::array<uint8_t, (1u << slot_bits)>    slots{};
+};
+
+static_assert( genesis_intrinsic_count < genesis_intrinsic_table::empty, "slot index no longer fits in a byte" );
+
+constexpr genesis_intrinsic_table build_genesis_intrinsic_table() {
+   genesis_intrinsic_table t;
+   for( uint64_t seed = 0;; ++seed ) {
+      for( auto& s : t.slots ) s = genesis_intrinsic_table::empty;
+      bool collision = false;
+      for( size_t i = 0; i < genesis_intrinsic_count && !collision; ++i ) {
+         auto& s = t.slots[genesis_intrinsic_table::slot( genesis_intrinsic_table::hash( seed, genesis_intrinsic_names[i] ) )];
+         collision = (s != genesis_intrinsic_table::empty);
+         s = static_cast<uint8_t>( i );
+      }
+      if( !collision ) {
+         t.seed = seed;
+         return t;
+      }
+   }
+}
+
+constexpr genesis_intrinsic_table genesis_intrinsic_lookup = build_genesis_intrinsic_table();
+
+} // anonymous namespace
+
+const std::vector<const char*> genesis_intrinsics( std::begin( genesis_intrinsic_names ), std::end( genesis_intrinsic_names ) );
+
+int32_t find_genesis_intrinsic( std::string_view name ) {
+   const auto& t = genesis_intrinsic_lookup;
+   uint8_t i = t.slots[genesis_intrinsic_table::slot( genesis_intrinsic_table::hash( t.seed, name ) )];
+   if( i == genesis_intrinsic_table::empty || name != genesis_intrinsic_names[i] ) return -1;
+   return i;
+}
+
+uint64_t genesis_intrinsic_whitelist_hash( uint32_t index ) {
+   // whitelisted_intrinsics_type is keyed by std::hash, which is not constexpr; compute it once per name
+   static const auto hashes = [] {
+      std::array<uint64_t, genesis_intrinsic_count> r{};
+      for( size_t i = 0; i < genesis_intrinsic_count; ++i )
+         r[i] = static_cast<uint64_t>( std::hash<std::string>{}( genesis_intrinsic_names[i] ) );
+      return r;
+   }();
+   return hashes.at( index );
+}
+
 } } // namespace roxe::chain
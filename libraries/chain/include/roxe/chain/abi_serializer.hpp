@@ -8,6 +8,7 @@
 #include <roxe/chain/exceptions.hpp>
 #include <fc/variant_object.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/io/json_writer.hpp>
 
 namespace roxe { namespace chain {
 
@@ -25,6 +26,7 @@ namespace impl {
    struct abi_traverse_context_with_path;
    struct binary_to_variant_context;
    struct variant_to_binary_context;
+   struct decode_plan;
 }
 
 /**
@@ -56,6 +58,14 @@ struct abi_serializer {
    fc::variant binary_to_variant( const type_name& type, const bytes& binary, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    fc::variant binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, const fc::microseconds& max_serialization_time, bool short_path = false )const;
 
+   /**
+    * Writes the JSON text of binary_to_variant's result to writer. Types with a decode plan are written while
+    * they are decoded, without building the variant; any other type, or data the plan fails on, is converted
+    * through binary_to_variant.
+    */
+   void        binary_to_json( const type_name& type, const bytes& binary, fc::json_writer& writer,
+                               const fc::microseconds& max_serialization_time, bool short_path = false )const;
+
    bytes       variant_to_binary( const type_name& type, const fc::variant& var, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    void        variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char*>& ds, const fc::microseconds& max_serialization_time, bool short_path = false )const;
 
@@ -87,7 +97,18 @@ struct abi_serializer {
 
    void add_specialized_unpack_pack( const string& name, std::pair<abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack );
 
+   /**
+    * Precompiles the types of the actions and tables into decode plans: the typedefs, bases and field types of
+    * their structs are resolved once, and binary_to_variant of such a type then runs the plan without map
+    * lookups, checking the deadline once per struct. Types using variants, or nested deeper than
+    * max_decode_plan_depth, are left to the interpreter; so is any data the plan fails on, which is decoded
+    * again by the interpreter to raise its usual error. set_abi drops the plans.
+    */
+   void compile_decode_plans();
+   size_t decode_plan_count()const { return decode_plans.size(); }
+
    static const size_t max_recursion_depth = 32; // arbitrary depth to prevent infinite recursion
+   static const uint32_t max_decode_plan_depth = 8;
 
 private:
 
@@ -101,6 +122,13 @@ private:
    map<type_name, pair<unpack_function, pack_function>> built_in_types;
    void configure_built_in_types();
 
+   map<type_name, std::shared_ptr<const impl::decode_plan>> decode_plans;
+   std::shared_ptr<const impl::decode_plan> _compile_decode_plan( const type_name& type, uint32_t depth,
+                                                                  map<type_name, std::shared_ptr<const impl::decode_plan>>& compiled )const;
+   /// @return false if type has no plan or the plan failed, in which case stream is left where it was
+   bool _decode_with_plan( const type_name& type, fc::datastream<const char*>& stream, fc::variant& result,
+                           impl::binary_to_variant_context& ctx )const;
+
    fc::variant _binary_to_variant( const type_name& type, const bytes& binary, impl::binary_to_variant_context& ctx )const;
    fc::variant _binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, impl::binary_to_variant_context& ctx )const;
    void        _binary_to_variant( const type_name& type, fc::datastream<const char*>& stream,
@@ -143,6 +171,8 @@ namespace impl {
 
       fc::scoped_exit<std::function<void()>> enter_scope();
 
+      size_t get_recursion_depth()const { return recursion_depth; }
+
    protected:
       fc::microseconds max_serialization_time;
       fc::time_point   deadline;
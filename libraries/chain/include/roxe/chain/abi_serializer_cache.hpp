@@ -0,0 +1,56 @@
+#pragma once
+#include <roxe/chain/abi_serializer.hpp>
+#include <chainbase/chainbase.hpp>
+#include <list>
+#include <mutex>
+
+namespace roxe { namespace chain {
+
+   /**
+    * @class abi_serializer_cache
+    * @brief bounded cache of the constructed abi_serializer of accounts, shared by the API plugins
+    *
+    * An entry is keyed by (account, abi_sequence), so a setabi makes the cached serializer stale for the
+    * state it is applied to while a fork switch back to the previous ABI finds a sequence mismatch as well.
+    * invalidate() drops an account right away when setabi is seen. The least recently used entry is evicted
+    * when the cache is full, a max_size of 0 disables caching. Cached serializers have their decode plans
+    * compiled. All methods are thread safe.
+    */
+   class abi_serializer_cache {
+      public:
+         struct cached_abi {
+            abi_def         abi;
+            abi_serializer  serializer;
+         };
+         using cached_abi_ptr = std::shared_ptr<const cached_abi>;
+
+         static constexpr size_t default_max_size = 1024;
+
+         explicit abi_serializer_cache( size_t max_size = default_max_size ) : max_size( max_size ) {}
+
+         /// @return the ABI of account n in the state of db, nullptr if n does not exist or has no ABI
+         cached_abi_ptr get( const chainbase::database& db, account_name n, const fc::microseconds& max_serialization_time );
+
+         /// resolver result for abi_serializer::to_variant and from_variant
+         optional<abi_serializer> get_serializer( const chainbase::database& db, account_name n, const fc::microseconds& max_serialization_time );
+
+         void invalidate( account_name n );
+         void clear();
+
+         void set_max_size( size_t s );
+         size_t size()const;
+
+      private:
+         struct entry {
+            uint64_t                                abi_sequence = 0;
+            cached_abi_ptr                          abi;
+            std::list<account_name>::iterator       lru_position;
+         };
+
+         mutable std::mutex                         mtx;
+         size_t                                     max_size;
+         std::map<account_name, entry>              entries;
+         std::list<account_name>                    lru; ///< most recently used first
+   };
+
+} } // roxe::chain
@@ -100,4 +100,10 @@ namespace roxe { namespace chain {
 } } /// namespace roxe::chain
 
 FC_REFLECT( roxe::chain::permission_level, (actor)(permission) )
+
+namespace fc { namespace raw {
+   template<> struct is_bulk_copyable<roxe::chain::permission_level> : std::true_type {};
+   static_assert( sizeof(roxe::chain::permission_level) == 2 * sizeof(roxe::chain::name),
+                  "permission_level packs as its actor followed by its permission" );
+} }
 FC_REFLECT( roxe::chain::action, (account)(name)(authorization)(data) )
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 
 namespace chainbase { class database; }
 
@@ -18,16 +19,134 @@ namespace roxe { namespace chain {
 class controller;
 class transaction_context;
 
+/**
+ * Maps the objects an action has handed out iterators for to those iterators. Open addressing over an array whose
+ * size is a power of two; a slot only counts as taken when it is stamped with the current generation, so clear()
+ * starts a new generation in O(1) and keeps the array for the next action, without freeing or allocating anything.
+ */
+template<typename T>
+class object_iterator_map {
+   public:
+      object_iterator_map() { reset( initial_slots ); }
+
+      /// @return the iterator of obj, -1 if it has none
+      int find( const T* obj )const {
+         for( size_t i = slot_of( obj ); ; i = (i + 1) & (_slots.size() - 1) ) {
+            const slot& s = _slots[i];
+            if( s.generation != _generation ) return -1;
+            if( s.object == obj ) return s.iterator;
+         }
+      }
+
+      void set( const T* obj, int iterator ) {
+         if( 2 * (_used + 1) > _slots.size() )
+            rehash( 2 * _slots.size() );
+         insert( obj, iterator );
+      }
+
+      /// the slot stays taken, so that the probing of other objects does not stop short at it
+      void erase( const T* obj ) {
+         for( size_t i = slot_of( obj ); ; i = (i + 1) & (_slots.size() - 1) ) {
+            slot& s = _slots[i];
+            if( s.generation != _generation ) return;
+            if( s.object == obj ) {
+               s.iterator = -1;
+               return;
+            }
+         }
+      }
+
+      /// forgets all objects; keeps the array unless an earlier action grew it large
+      void clear() {
+         if( _slots.size() > max_retained_slots ) {
+            reset( initial_slots );
+            return;
+         }
+         _used = 0;
+         if( ++_generation == 0 ) {
+            for( auto& s : _slots ) s.generation = 0;
+            _generation = 1;
+         }
+      }
+
+      size_t capacity()const { return _slots.size(); }
+
+   private:
+      static constexpr size_t initial_slots      = 64;
+      static constexpr size_t max_retained_slots = 4096;
+
+      struct slot {
+         const T* object     = nullptr;
+         int      iterator   = -1;
+         uint32_t generation = 0;
+      };
+
+      size_t slot_of( const T* obj )const {
+         // objects are at least 16 bytes apart, the multiplication spreads the remaining bits over the high ones
+         return ((reinterpret_cast<uintptr_t>( obj ) >> 4) * 0x9E3779B97F4A7C15ull >> 32) & (_slots.size() - 1);
+      }
+
+      void insert( const T* obj, int iterator ) {
+         for( size_t i = slot_of( obj ); ; i = (i + 1) & (_slots.size() - 1) ) {
+            slot& s = _slots[i];
+            if( s.generation != _generation ) {
+               s = slot{ obj, iterator, _generation };
+               ++_used;
+               return;
+            }
+            if( s.object == obj ) {
+               s.iterator = iterator;
+               return;
+            }
+         }
+      }
+
+      void rehash( size_t n ) {
+         vector<slot> old( n );
+         old.swap( _slots );
+         const uint32_t old_generation = _generation;
+         _generation = 1;
+         _used = 0;
+         for( const auto& s : old )
+            if( s.generation == old_generation && s.iterator >= 0 )
+               insert( s.object, s.iterator );
+      }
+
+      void reset( size_t n ) {
+         vector<slot>( n ).swap( _slots );
+         _generation = 1;
+         _used = 0;
+      }
+
+      vector<slot> _slots;
+      uint32_t     _generation = 1;
+      size_t       _used = 0; ///< slots taken in the current generation, including erased objects
+};
+
 class apply_context {
    private:
       template<typename T>
       class iterator_cache {
          public:
             iterator_cache(){
+               _table_cache.reserve(8);
                _end_iterator_to_table.reserve(8);
                _iterator_to_object.reserve(32);
             }
 
+            /// Forgets all tables and objects; keeps the allocations unless an earlier action grew them large
+            void clear() {
+               _table_cache.clear();
+               _end_iterator_to_table.clear();
+               if( _iterator_to_object.capacity() > max_retained_iterators ) {
+                  vector<const T*>().swap( _iterator_to_object );
+                  _iterator_to_object.reserve(32);
+               } else {
+                  _iterator_to_object.clear();
+               }
+               _object_to_iterator.clear();
+            }
+
             /// Returns end iterator of the table.
             int cache_table( const table_id_object& tobj ) {
                auto itr = _table_cache.find(tobj.id);
@@ -81,20 +200,22 @@ class apply_context {
 
             int add( const T& obj ) {
                auto itr = _object_to_iterator.find( &obj );
-               if( itr != _object_to_iterator.end() )
-                    return itr->second;
+               if( itr >= 0 )
+                    return itr;
 
                _iterator_to_object.push_back( &obj );
-               _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
+               _object_to_iterator.set( &obj, _iterator_to_object.size() - 1 );
 
                return _iterator_to_object.size() - 1;
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
+            static constexpr size_t max_retained_iterators = 1024;
+
+            flat_map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
             vector<const table_id_object*>                  _end_iterator_to_table;
             vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            object_iterator_map<T>                          _object_to_iterator;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
@@ -175,7 +296,7 @@ class apply_context {
 
             using secondary_key_helper_t = secondary_key_helper<secondary_key_type, secondary_key_proxy_type, secondary_key_proxy_const_type>;
 
-            generic_index( apply_context& c ):context(c){}
+            generic_index( apply_context& c, iterator_cache<ObjectType>& cache ):context(c),itr_cache(cache){}
 
             int store( uint64_t scope, uint64_t table, const account_name& payer,
                        uint64_t id, secondary_key_proxy_const_type value )
@@ -185,6 +306,7 @@ class apply_context {
 //               context.require_write_lock( scope );
 
                const auto& tab = context.find_or_create_table( context.receiver, scope, table, payer );
+               context.record_table_write( tab );
 
                const auto& obj = context.db.create<ObjectType>( [&]( auto& o ){
                   o.t_id          = tab.id;
@@ -209,6 +331,7 @@ class apply_context {
 
                const auto& table_obj = itr_cache.get_table( obj.t_id );
                ROXE_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
+               context.record_table_write( table_obj );
 
 //               context.require_write_lock( table_obj.scope );
 
@@ -229,6 +352,7 @@ class apply_context {
 
                const auto& table_obj = itr_cache.get_table( obj.t_id );
                ROXE_ASSERT( table_obj.code == context.receiver, table_access_violation, "db access violation" );
+               context.record_table_write( table_obj );
 
 //               context.require_write_lock( table_obj.scope );
 
@@ -295,6 +419,47 @@ class apply_context {
                return itr_cache.add( *itr );
             }
 
+            /**
+             * Copies up to max_rows rows starting at the first (secondary, primary) not less than the given pair
+             * into buffer, each laid out as secondary key, primary key (uint64_t), row size (uint32_t) and the row
+             * from primary_table, without creating iterators.
+             *
+             * @return the number of rows copied, or minus the size of the first row if not even that one fits
+             */
+            int range_secondary( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary_table,
+                                 secondary_key_proxy_const_type secondary, uint64_t primary,
+                                 uint32_t max_rows, char* buffer, size_t buffer_size ) {
+               auto tab = context.find_table( code, scope, table );
+               if( !tab || max_rows == 0 ) return 0;
+               auto primary_tab = context.find_table( code, scope, primary_table );
+
+               const auto& idx = context.db.get_index< typename chainbase::get_index_type<ObjectType>::type, by_secondary >();
+               auto lower = secondary_key_helper_t::create_tuple( *tab, secondary );
+               auto itr = idx.lower_bound( boost::make_tuple( lower.template get<0>(), lower.template get<1>(), primary ) );
+
+               constexpr size_t header_size = sizeof(secondary_key_type) + sizeof(uint64_t) + sizeof(uint32_t);
+               size_t   offset = 0;
+               uint32_t rows   = 0;
+               for( ; rows < max_rows && itr != idx.end() && itr->t_id == tab->id; ++itr, ++rows ) {
+                  const key_value_object* row = primary_tab
+                     ? context.db.find<key_value_object, by_scope_primary_hash>( boost::make_tuple( primary_tab->id, itr->primary_key ) )
+                     : nullptr;
+                  const uint32_t row_size = row ? row->value.size() : 0;
+
+                  if( buffer_size - offset < header_size + row_size ) {
+                     if( rows == 0 ) return -static_cast<int>(header_size + row_size);
+                     break;
+                  }
+                  memcpy( buffer + offset, &itr->secondary_key, sizeof(secondary_key_type) );
+                  memcpy( buffer + offset + sizeof(secondary_key_type), &itr->primary_key, sizeof(uint64_t) );
+                  memcpy( buffer + offset + sizeof(secondary_key_type) + sizeof(uint64_t), &row_size, sizeof(uint32_t) );
+                  if( row_size )
+                     memcpy( buffer + offset + header_size, row->value.data(), row_size );
+                  offset += header_size + row_size;
+               }
+               return rows;
+            }
+
             int end_secondary( uint64_t code, uint64_t scope, uint64_t table ) {
                auto tab = context.find_table( code, scope, table );
                if( !tab ) return -1;
@@ -355,7 +520,7 @@ class apply_context {
 
                auto table_end_itr = itr_cache.cache_table( *tab );
 
-               const auto* obj = context.db.find<ObjectType, by_primary>( boost::make_tuple( tab->id, primary ) );
+               const auto* obj = context.db.find<ObjectType, by_primary_hash>( boost::make_tuple( tab->id, primary ) );
                if( !obj ) return table_end_itr;
                secondary_key_helper_t::get(secondary, obj->secondary_key);
 
@@ -446,9 +611,35 @@ class apply_context {
 
          private:
             apply_context&              context;
-            iterator_cache<ObjectType>  itr_cache;
+            iterator_cache<ObjectType>& itr_cache;
       }; /// class generic_index
 
+      /// Containers used only while an action runs. Recycled across the contexts of a thread so that their
+      /// allocations are reused by the next action instead of being made again for every action.
+      struct scratch {
+         iterator_cache<key_value_object>                                 keyval_cache;
+         iterator_cache<index64_object>                                   idx64_cache;
+         iterator_cache<index128_object>                                  idx128_cache;
+         iterator_cache<index256_object>                                  idx256_cache;
+         iterator_cache<index_double_object>                              idx_double_cache;
+         iterator_cache<index_long_double_object>                         idx_long_double_cache;
+         flat_map<std::tuple<name, name, name>, const table_id_object*>   table_lookup_cache;
+         vector< std::pair<account_name, uint32_t> >                      notified;
+         vector<uint32_t>                                                 inline_actions;
+         vector<uint32_t>                                                 cfa_inline_actions;
+
+         void clear();
+      };
+
+      /// returns the scratch to the pool of the thread
+      struct scratch_deleter {
+         void operator()( scratch* s )const;
+      };
+      using scratch_ptr = std::unique_ptr<scratch, scratch_deleter>;
+
+      static scratch_ptr acquire_scratch();
+      static vector<std::unique_ptr<scratch>>& scratch_pool();
+
 
    /// Constructor
    public:
@@ -505,8 +696,12 @@ class apply_context {
    /// Console methods:
    public:
 
+      /// @return whether console output is kept, it only ends up in detailed traces
+      bool console_enabled()const;
+      /// appends to the console output of the action as long as the transaction has console_bytes_left, then cuts off
+      void console_append( const char* data, size_t len );
       void console_append( const string& val ) {
-         _pending_console_output += val;
+         console_append( val.data(), val.size() );
       }
 
    /// Database methods:
@@ -531,6 +726,8 @@ class apply_context {
       const table_id_object& find_or_create_table( name code, name scope, name table, const account_name &payer );
       void                   remove_table( const table_id_object& tid );
 
+      void record_table_write( const table_id_object& tid );
+
       int  db_store_i64( uint64_t code, uint64_t scope, uint64_t table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size );
 
 
@@ -572,6 +769,7 @@ class apply_context {
       uint32_t                      action_ordinal = 0;
       bool                          privileged   = false;
       bool                          context_free = false;
+      scratch_ptr                   _scratch;
 
    public:
       generic_index<index64_object>                                  idx64;
@@ -582,10 +780,12 @@ class apply_context {
 
    private:
 
-      iterator_cache<key_value_object>    keyval_cache;
-      vector< std::pair<account_name, uint32_t> > _notified; ///< keeps track of new accounts to be notifed of current message
-      vector<uint32_t>                    _inline_actions; ///< action_ordinals of queued inline actions
-      vector<uint32_t>                    _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
+      iterator_cache<key_value_object>&   keyval_cache;
+      /// tables looked up by this context, saves a chainbase index descent on every db_*_i64 call; kept in sync by remove_table
+      flat_map<std::tuple<name, name, name>, const table_id_object*>& _table_lookup_cache;
+      vector< std::pair<account_name, uint32_t> >& _notified; ///< keeps track of new accounts to be notifed of current message
+      vector<uint32_t>&                   _inline_actions; ///< action_ordinals of queued inline actions
+      vector<uint32_t>&                   _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
       std::string                         _pending_console_output;
       flat_set<account_delta>             _account_ram_deltas; ///< flat_set of account_delta so json is an array of objects
 
@@ -0,0 +1,77 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+
+#include <roxe/chain/trace.hpp>
+#include <roxe/chain/transaction.hpp>
+#include <fc/metrics.hpp>
+
+#include <boost/signals2/signal.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace roxe { namespace chain {
+
+   /**
+    * Delivers controller signals to a subscriber on a thread of its own, off the path of block application.
+    *
+    * Only subscribers which neither read the chain state nor have to finish before the controller continues may use
+    * it: the block states, transaction metadata and traces the signals carry are not changed once emitted, and are
+    * kept alive by the queue, while the state database moves on. All the signals connected through one subscriber
+    * are delivered in the order they were emitted. The queue is bounded, a signal emitted while it is full waits for
+    * the subscriber's thread rather than being dropped.
+    */
+   class async_subscriber {
+      public:
+         /// name is the thread name and the label of the subscriber's metrics
+         async_subscriber( std::string name, size_t max_queue_size );
+         /// calls stop()
+         ~async_subscriber();
+
+         /// f( const std::shared_ptr<T>& ) is called on the subscriber's thread for every signal of s
+         template<typename T, typename F>
+         boost::signals2::connection connect( boost::signals2::signal<void(const std::shared_ptr<T>&)>& s, F&& f ) {
+            // queued signals keep the handler alive when s is disconnected before they ran
+            return s.connect( [this, h = std::make_shared<std::decay_t<F>>( std::forward<F>( f ) )]( const std::shared_ptr<T>& p ) {
+               post( [h, p]() { (*h)( p ); } );
+            } );
+         }
+
+         /// f( const transaction_trace_ptr& ) is called for every applied transaction, the transaction is not delivered
+         template<typename F>
+         boost::signals2::connection connect( boost::signals2::signal<void(std::tuple<const transaction_trace_ptr&, const signed_transaction&>)>& s,
+                                              F&& f ) {
+            return s.connect( [this, h = std::make_shared<std::decay_t<F>>( std::forward<F>( f ) )]
+                              ( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
+               post( [h, trace = std::get<0>( t )]() { (*h)( trace ); } );
+            } );
+         }
+
+         /// runs the signals still queued and joins the thread; disconnect the signals first, later ones are dropped
+         void stop();
+
+         size_t queued()const;
+
+      private:
+         void post( std::function<void()> f );
+         void run();
+
+         const std::string                    name;
+         const size_t                         max_queue_size;
+         fc::metrics::gauge&                  queued_gauge;
+         fc::metrics::counter&                waits;
+         mutable std::mutex                   mtx;
+         std::condition_variable              not_empty;
+         std::condition_variable              not_full;
+         std::deque<std::function<void()>>    queue;
+         bool                                 stopping = false;
+         std::thread                          thread;
+   };
+
+} } // roxe::chain
@@ -45,6 +45,18 @@ namespace detail {
 
    using meta_permission_set = boost::container::flat_multiset<meta_permission, meta_permission_comparator>;
 
+   // Authorities made only of keys that all carry the same weight, e.g. the usual single key with weight 1 and
+   // threshold 1. The meta_permission ordering of such an authority is its declaration order.
+   template<typename AuthorityType>
+   bool is_uniform_key_authority( const AuthorityType& authority ) {
+      if( authority.keys.empty() || !authority.accounts.empty() || !authority.waits.empty() )
+         return false;
+      const auto weight = authority.keys.front().weight;
+      for( const auto& k : authority.keys )
+         if( k.weight != weight ) return false;
+      return true;
+   }
+
 } /// namespace detail
 
    /**
@@ -178,8 +190,36 @@ namespace detail {
             return &cached_permissions;
          }
 
+         /**
+          * Same result and used keys as the general check below for authorities accepted by
+          * detail::is_uniform_key_authority, without sorting meta_permissions or saving the used keys
+          */
+         template<typename AuthorityType>
+         bool satisfied_by_keys( const AuthorityType& authority ) {
+            uint32_t total_weight = 0;
+            auto last = authority.keys.begin();
+            for( ; last != authority.keys.end(); ++last ) {
+               if( std::find( provided_keys.begin(), provided_keys.end(), last->key ) != provided_keys.end() )
+                  total_weight += last->weight;
+               if( total_weight >= authority.threshold ) break;
+            }
+            if( last == authority.keys.end() )
+               return false;
+
+            // only the keys counted up to the satisfying one are used, as in the general check
+            for( auto itr = authority.keys.begin(); itr != last + 1; ++itr ) {
+               auto key = std::find( provided_keys.begin(), provided_keys.end(), itr->key );
+               if( key != provided_keys.end() )
+                  _used_keys[key - provided_keys.begin()] = true;
+            }
+            return true;
+         }
+
          template<typename AuthorityType>
          bool satisfied( const AuthorityType& authority, permission_cache_type& cached_permissions, uint16_t depth ) {
+            if( detail::is_uniform_key_authority( authority ) )
+               return satisfied_by_keys( authority );
+
             // Save the current used keys; if we do not satisfy this authority, the newly used keys aren't actually used
             auto KeyReverter = fc::make_scoped_exit([this, keys = _used_keys] () mutable {
                _used_keys = keys;
@@ -10,6 +10,8 @@
 
 #include <utility>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 
 namespace roxe { namespace chain {
 
@@ -51,6 +53,21 @@ namespace roxe { namespace chain {
 
          void update_permission_usage( const permission_object& permission );
 
+         /**
+          * @brief Discard resolved permissions and links cached from the current state
+          *
+          * Permission changes made through this class already do this; it must be called whenever
+          * permission_link_objects are created, modified or removed.
+          */
+         void invalidate_resolution_cache();
+
+         /**
+          * @brief Number of permissions of the producers account created, modified or removed since startup
+          *
+          * Changes which were undone afterwards are counted as well.
+          */
+         uint64_t producers_permission_changes()const { return _producers_permission_changes; }
+
          fc::time_point get_permission_last_used( const permission_object& permission )const;
 
          const permission_object*  find_permission( const permission_level& level )const;
@@ -132,6 +149,57 @@ namespace roxe { namespace chain {
                                                              scope_name code_account,
                                                              action_name type
                                                            )const;
+
+         /**
+          * Links and permissions resolved from the database, reused across transactions and blocks.
+          *
+          * Changes to permissions and links empty the cache and store a new epoch in the dynamic global
+          * properties. Undoing a change restores the previous epoch along with the objects, so the cache is
+          * only used while the epoch it was filled at is still the current one. Epochs are never reused. The
+          * cache is emptied on the change itself as well: an undo brings removed objects back at a new
+          * address, and restores the epoch of a cache which was not used since the change.
+          */
+         struct resolution_cache {
+            struct link_key {
+               account_name account;
+               scope_name   code;
+               action_name  type;
+
+               friend bool operator == ( const link_key& a, const link_key& b ) {
+                  return a.account == b.account && a.code == b.code && a.type == b.type;
+               }
+            };
+
+            struct key_hash {
+               size_t operator()( const link_key& k )const {
+                  return mix( mix( k.account.value, k.code.value ), k.type.value );
+               }
+               size_t operator()( const permission_level& l )const {
+                  return mix( l.actor.value, l.permission.value );
+               }
+               static size_t mix( uint64_t a, uint64_t b ) {
+                  return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+               }
+            };
+
+            static constexpr size_t max_entries = 64 * 1024;
+
+            uint64_t                                                             epoch = 0;
+            std::unordered_map<link_key, optional<permission_name>, key_hash>    links;
+            std::unordered_map<permission_level, const permission_object*, key_hash> permissions;
+         };
+
+         mutable resolution_cache _resolution_cache;
+         /// read-only API calls resolve permissions from several threads at once, see http_plugin read-only windows
+         mutable std::mutex       _resolution_cache_mtx;
+         uint64_t                 _last_epoch = 0;
+         uint64_t                 _producers_permission_changes = 0;
+
+         void on_permission_change( account_name owner );
+
+         bool use_resolution_cache()const;
+         /// _resolution_cache_mtx must be held
+         resolution_cache& current_resolution_cache()const;
    };
 
 } } /// namespace roxe::chain
@@ -0,0 +1,21 @@
+#pragma once
+#include <fc/time.hpp>
+
+namespace roxe { namespace chain {
+
+   /**
+    * Clock read by transaction billing and deadline checks, which read it far more often than anything else.
+    *
+    * On CPUs with an invariant TSC it scales the TSC by a rate calibrated at startup and re-anchors to
+    * fc::time_point::now() every millisecond, so it never drifts more than a fraction of a microsecond from the
+    * system clock that transaction start times and deadlines are taken from. Elsewhere it is fc::time_point::now().
+    * The values returned to a thread never decrease.
+    */
+   struct billing_clock {
+      static fc::time_point now();
+
+      /// true when now() reads the TSC
+      static bool uses_tsc();
+   };
+
+} } /// roxe::chain
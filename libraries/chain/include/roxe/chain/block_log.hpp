@@ -32,13 +32,35 @@ namespace roxe { namespace chain {
     * Blocks can be accessed at random via block number through the index file. Seek to 8 * (block_num - 1)
     * to find the position of the block in the main file.
     *
-    * The main file is the only file that needs to persist. The index file can be reconstructed during a
-    * linear scan of the main file.
+    * The main file is the only file that needs to persist. The index file can be reconstructed by following
+    * the positions back from the head block, without deserializing any block. Lookups read the index through
+    * a memory mapping.
+    *
+    * Reads and appends are serialized internally, so blocks may be read from another thread, e.g. the
+    * read-ahead thread of a replay, while the log is in use.
+    *
+    * With a stride configured the log is split: when the head block number is a multiple of the stride the
+    * next append moves blocks.log and blocks.index to blocks-<first>-<last>.log and .index and starts a new
+    * partial (version 2) log. Blocks in those retained files are still found by read_block_by_num. Once there
+    * are more retained files than configured, the oldest are moved to the archive directory, or deleted if
+    * there is none.
+    *
+    * With async writes an append only packs the block and queues it for a writer thread, so the caller does not
+    * wait on the disk. Blocks are written in order, a read of a queued block waits until it is written, and
+    * flush() waits for the queue. A crash may lose the queued blocks from the end of the log, which stays
+    * well formed.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         /**
+          * @param stride              number of blocks per file, 0 keeps everything in blocks.log
+          * @param max_retained_files  number of split off files kept in data_dir, 0 keeps them all
+          * @param archive_dir         where files beyond max_retained_files are moved, empty to delete them
+          * @param async_writes        append through a writer thread
+          */
+         block_log(const fc::path& data_dir, uint32_t stride = 0, uint32_t max_retained_files = 0,
+                   const fc::path& archive_dir = fc::path(), bool async_writes = false);
          block_log(block_log&& other);
          ~block_log();
 
@@ -48,6 +70,8 @@ namespace roxe { namespace chain {
 
          std::pair<signed_block_ptr, uint64_t> read_block(uint64_t file_pos)const;
          signed_block_ptr read_block_by_num(uint32_t block_num)const;
+         /// @return the packed block without deserializing it, empty if the block is not in the log
+         vector<char> read_serialized_block_by_num(uint32_t block_num)const;
          signed_block_ptr read_block_by_id(const block_id_type& id)const {
             return read_block_by_num(block_header::num_from_id(id));
          }
@@ -72,6 +96,9 @@ namespace roxe { namespace chain {
       private:
          void open(const fc::path& data_dir);
          void construct_index();
+         void split();
+         uint64_t write_block(const signed_block_ptr& b);
+         uint64_t append_async(const signed_block_ptr& b);
 
          std::unique_ptr<detail::block_log_impl> my;
    };
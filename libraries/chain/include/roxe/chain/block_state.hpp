@@ -42,13 +42,24 @@ namespace roxe { namespace chain {
 
       bool is_valid()const { return validated; }
 
+      /**
+       * Drops the transaction metadata once the block is applied and its signals have fired, popping the block
+       * recreates it from the block. The keys recovered from the signatures are kept in recovered_keys.
+       * @return approximate bytes freed: the metadata and the packed transactions not shared with the block
+       */
+      size_t release_trxs();
 
       signed_block_ptr                                    block;
       bool                                                validated = false;
 
       /// this data is redundant with the data stored in block, but facilitates
-      /// recapturing transactions when we pop a block
+      /// recapturing transactions when we pop a block. It is only held until the block is applied, so handlers of
+      /// the controller signals must not keep reading it afterwards.
       vector<transaction_metadata_ptr>                    trxs;
+
+      /// signing keys of the packed transactions of block in order, as recovered for the released trxs; invalid where
+      /// the recovery had not completed. Metadata recreated after a fork switch starts out with them.
+      vector<signing_keys_future_type>                    recovered_keys;
    };
 
    using block_state_ptr = std::shared_ptr<block_state>;
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <roxe/chain/exceptions.hpp>
+#include <roxe/chain/types.hpp>
 
 namespace roxe { namespace chain {
 
@@ -32,6 +33,40 @@ struct chain_snapshot_header {
    }
 };
 
+/**
+ * Present in differential snapshots only. A differential snapshot holds the complete chain state sections but only
+ * the contract tables changed since the snapshot of base_block_id, and can only be loaded on top of that snapshot
+ * (and the differential snapshots in between).
+ */
+struct differential_snapshot_header {
+   block_id_type base_block_id;
+};
+
+/// identifies a contract table in a differential snapshot
+struct snapshot_table_key {
+   account_name   code;
+   scope_name     scope;
+   table_name     table;
+};
+
+/// precedes every table of a differential snapshot
+struct snapshot_table_change {
+   bool           created = false; ///< created after the base, replacing any table of the same name the base had
+};
+
+/// the packed form of a table_id_object row, read where the object cannot be created in place
+struct snapshot_table_id_row {
+   account_name   code;
+   scope_name     scope;
+   table_name     table;
+   account_name   payer;
+   uint32_t       count = 0;
+};
+
 } }
 
 FC_REFLECT(roxe::chain::chain_snapshot_header,(version))
+FC_REFLECT(roxe::chain::differential_snapshot_header,(base_block_id))
+FC_REFLECT(roxe::chain::snapshot_table_key,(code)(scope)(table))
+FC_REFLECT(roxe::chain::snapshot_table_change,(created))
+FC_REFLECT(roxe::chain::snapshot_table_id_row,(code)(scope)(table)(payer)(count))
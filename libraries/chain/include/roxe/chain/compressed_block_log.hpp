@@ -0,0 +1,64 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <fc/filesystem.hpp>
+#include <roxe/chain/block.hpp>
+#include <roxe/chain/genesis_state.hpp>
+
+namespace roxe { namespace chain {
+
+   namespace detail { class compressed_block_log_impl; }
+
+   /* The compressed block log is an append only archive of irreversible blocks which stores the blocks
+    * in zlib compressed chunks of consecutive blocks. It is an alternative to blocks.log for nodes that
+    * keep the full history on disk and rarely read it.
+    *
+    * +--------+------------------------------------------------+---------+-----+---------+
+    * | Header | Chunk 1 = chunk header | compressed chunk data | Chunk 2 | ... | Chunk N |
+    * +--------+------------------------------------------------+---------+-----+---------+
+    *
+    * The header holds the magic number, the version, the first block number and the packed genesis state.
+    * A chunk header holds the number of its first block, its number of blocks and the size of the compressed
+    * data. The decompressed data starts with the offset of every block in the chunk followed by the packed
+    * blocks themselves.
+    *
+    * The index file holds one entry (position, first block number, block count) per chunk, so reading a
+    * block only requires decompressing the chunk it is in. The most recently decompressed chunk is kept,
+    * reading consecutive blocks therefore decompresses every chunk once. The index file can be reconstructed
+    * by walking the chunk headers of the main file.
+    *
+    * Appended blocks are buffered until a chunk is full. flush() writes out a partially filled chunk, which
+    * is done on destruction as well; the next appended block then starts a new chunk.
+    */
+   class compressed_block_log {
+      public:
+         static const uint32_t magic_number;
+         static const uint32_t version;
+         static const uint32_t default_blocks_per_chunk = 256;
+
+         compressed_block_log( const fc::path& data_dir, uint32_t blocks_per_chunk = default_blocks_per_chunk );
+         compressed_block_log( compressed_block_log&& other );
+         ~compressed_block_log();
+
+         void reset( const genesis_state& gs, uint32_t first_block_num = 1 );
+         void append( const signed_block_ptr& b );
+         void flush();
+
+         signed_block_ptr read_block_by_num( uint32_t block_num )const;
+         signed_block_ptr read_head()const;
+
+         /// @return 0 if the log contains no blocks
+         uint32_t head_block_num()const;
+         uint32_t first_block_num()const;
+         const genesis_state& get_genesis_state()const;
+         uint32_t chunk_count()const;
+
+         static bool exists( const fc::path& data_dir );
+
+      private:
+         std::unique_ptr<detail::compressed_block_log_impl> my;
+   };
+
+} }
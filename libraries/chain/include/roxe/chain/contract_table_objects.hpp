@@ -8,6 +8,9 @@
 #include <roxe/chain/contract_types.hpp>
 #include <roxe/chain/multi_index_includes.hpp>
 
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/functional/hash.hpp>
+
 #include <array>
 #include <type_traits>
 
@@ -48,6 +51,7 @@ namespace roxe { namespace chain {
    using table_id = table_id_object::id_type;
 
    struct by_scope_primary;
+   struct by_scope_primary_hash;
    struct by_scope_secondary;
    struct by_scope_tertiary;
 
@@ -65,6 +69,15 @@ namespace roxe { namespace chain {
       shared_blob           value;
    };
 
+   struct table_id_hash {
+      size_t operator()( const table_id& id )const { return boost::hash<int64_t>()( id._id ); }
+   };
+
+   /**
+    * by_scope_primary_hash holds the same (t_id, primary_key) key as by_scope_primary and is used for exact match
+    * lookups, which are the bulk of contract row accesses. Anything that depends on key order has to go through
+    * by_scope_primary.
+    */
    using key_value_index = chainbase::shared_multi_index_container<
       key_value_object,
       indexed_by<
@@ -75,13 +88,26 @@ namespace roxe { namespace chain {
                member<key_value_object, uint64_t, &key_value_object::primary_key>
             >,
             composite_key_compare< std::less<table_id>, std::less<uint64_t> >
+         >,
+         bmi::hashed_unique<tag<by_scope_primary_hash>,
+            composite_key< key_value_object,
+               member<key_value_object, table_id, &key_value_object::t_id>,
+               member<key_value_object, uint64_t, &key_value_object::primary_key>
+            >,
+            bmi::composite_key_hash< table_id_hash, boost::hash<uint64_t> >,
+            bmi::composite_key_equal_to< std::equal_to<table_id>, std::equal_to<uint64_t> >
          >
       >
    >;
 
    struct by_primary;
+   struct by_primary_hash;
    struct by_secondary;
 
+   /**
+    * As with key_value_index, by_primary_hash serves exact (t_id, primary_key) lookups and by_primary everything
+    * that depends on primary key order.
+    */
    template<typename SecondaryKey, uint64_t ObjectTypeId, typename SecondaryKeyLess = std::less<SecondaryKey> >
    struct secondary_index
    {
@@ -108,6 +134,14 @@ namespace roxe { namespace chain {
                >,
                composite_key_compare< std::less<table_id>, std::less<uint64_t> >
             >,
+            bmi::hashed_unique<tag<by_primary_hash>,
+               composite_key< index_object,
+                  member<index_object, table_id, &index_object::t_id>,
+                  member<index_object, uint64_t, &index_object::primary_key>
+               >,
+               bmi::composite_key_hash< table_id_hash, boost::hash<uint64_t> >,
+               bmi::composite_key_equal_to< std::equal_to<table_id>, std::equal_to<uint64_t> >
+            >,
             ordered_unique<tag<by_secondary>,
                composite_key< index_object,
                   member<index_object, table_id, &index_object::t_id>,
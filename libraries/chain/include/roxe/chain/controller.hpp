@@ -8,6 +8,7 @@
 #include <roxe/chain/abi_serializer.hpp>
 #include <roxe/chain/account_object.hpp>
 #include <roxe/chain/snapshot.hpp>
+#include <roxe/chain/state_delta.hpp>
 #include <roxe/chain/protocol_feature_manager.hpp>
 
 namespace chainbase {
@@ -34,6 +35,7 @@ namespace roxe { namespace chain {
    class global_property_object;
    class permission_object;
    class account_object;
+   class account_metadata_object;
    using resource_limits::resource_limits_manager;
    using apply_handler = std::function<void(apply_context&)>;
    using unapplied_transactions_type = map<transaction_id_type, transaction_metadata_ptr, sha256_less>;
@@ -64,19 +66,33 @@ namespace roxe { namespace chain {
             flat_set< pair<account_name, action_name> > action_blacklist;
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
+            path                     blocks_archive_dir; ///< where split block log files beyond max_retained_block_files go, empty deletes them
+            uint32_t                 blocks_log_stride      =  0; ///< split the block log every N blocks, 0 disables
+            uint32_t                 max_retained_block_files = 0; ///< split block log files kept in blocks_dir, 0 keeps all
+            bool                     block_log_async_writes = false; ///< append irreversible blocks from a writer thread
             path                     state_dir              =  chain::config::default_state_dir_name;
+            path                     prepared_wasm_cache_dir; ///< empty disables the persistent prepared wasm cache
+            uint64_t                 wasm_instantiation_cache_size = chain::config::default_wasm_instantiation_cache_size; ///< bytes, 0 is unbounded
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
-            uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
-            uint64_t                 reversible_guard_size  =  chain::config::default_reversible_guard_size;
             uint32_t                 sig_cpu_bill_pct       =  chain::config::default_sig_cpu_bill_pct;
             uint16_t                 thread_pool_size       =  chain::config::default_controller_thread_pool_size;
+            uint32_t                 sig_recovery_cache_size = chain::config::default_sig_recovery_cache_size;
             bool                     read_only              =  false;
+            bool                     publish_state_revision =  false; ///< publish the revision and head of the state after every block for state replicas, requires mapped mode
+            bool                     state_replica          =  false; ///< map the state of a node on this host publishing it read-only and apply no blocks
+            bool                     state_delta_standby    =  false; ///< apply the state deltas of a primary instead of executing blocks until promoted
             bool                     force_all_checks       =  false;
             bool                     disable_replay_opts    =  false;
             bool                     contracts_console      =  false;
+            uint32_t                 max_console_output_bytes = chain::config::default_max_console_output_bytes; ///< per transaction, the rest is cut off
             bool                     allow_ram_billing_in_notify = false;
             bool                     disable_all_subjective_mitigations = false; //< for testing purposes only
+            bool                     record_table_access_sets = false; ///< track tables read/written per transaction to measure available parallelism
+            bool                     profile_wasm           =  false; ///< aggregate contract execution time and intrinsic calls per receiver and action
+            uint32_t                 wasm_sample_interval_us = 0;     ///< sample the running contract function this often, 0 disables sampling
+            bool                     profile_apply          =  false; ///< accumulate the time spent in each phase of applying blocks, see get_apply_timing
+            bool                     differential_snapshots =  false; ///< track contract tables changed since the last snapshot so that differential snapshots can be written
 
             genesis_state            genesis;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
@@ -86,6 +102,9 @@ namespace roxe { namespace chain {
 
             pinnable_mapped_file::map_mode db_map_mode      = pinnable_mapped_file::map_mode::mapped;
             vector<string>           db_hugepage_paths;
+            uint32_t                 db_checkpoint_interval = 0; ///< in heap/locked mode checkpoint the state to its file every N irreversible blocks so that a crash does not need a replay, 0 disables
+            uint32_t                 db_cold_page_interval  = 0; ///< in mapped mode let state pages untouched for N irreversible blocks be paged out first, 0 disables
+            uint32_t                 db_hot_page_profile_interval = 0; ///< in mapped mode record the state pages in memory every N irreversible blocks and prefetch them at startup, 0 disables
 
             flat_set<account_name>   resource_greylist;
             flat_set<account_name>   trusted_producers;
@@ -99,12 +118,63 @@ namespace roxe { namespace chain {
             incomplete  = 3, ///< this is an incomplete block (either being produced by a producer or speculatively produced by a node)
          };
 
+         /// wall clock time spent applying blocks and transactions, accumulated while config::profile_apply is set
+         struct apply_timing {
+            fc::microseconds  apply;      ///< apply_block, which contains auth and finalize but not chainbase commits
+            fc::microseconds  auth;       ///< waiting for key recovery and checking authorization
+            fc::microseconds  chainbase;  ///< starting undo sessions and committing irreversible revisions
+            fc::microseconds  finalize;   ///< finalize_block and commit_block
+         };
+
+         /// transaction metadata block states dropped once their block was applied, see block_state::release_trxs
+         struct released_trx_metas {
+            uint64_t  blocks = 0;
+            uint64_t  trxs   = 0;
+            uint64_t  bytes  = 0;   ///< approximate
+         };
+
          explicit controller( const config& cfg );
          controller( const config& cfg, protocol_feature_set&& pfs );
          ~controller();
 
          void add_indices();
-         void startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot = nullptr );
+         /**
+          * @param differential_snapshots applied in order on top of snapshot, each one must be based on the previous
+          */
+         void startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot = nullptr,
+                       const vector<snapshot_reader_ptr>& differential_snapshots = vector<snapshot_reader_ptr>() );
+
+         /**
+          * A state replica maps the state of a node on this host which publishes it (config::publish_state_revision)
+          * read-only. Its head is the one published last, taken by refresh_replica_head(). Queries of the state run
+          * between begin_replica_read() and end_replica_read(), the node publishing the state does not change it
+          * meanwhile.
+          */
+         bool     is_state_replica()const;
+         /// @return whether the head changed
+         bool     refresh_replica_head();
+         /// waits while the writer changes the state, then holds it shared until end_replica_read()
+         void     begin_replica_read()const;
+         void     end_replica_read()const;
+         bool     replica_writer_attached()const;
+
+         /**
+          * A standby follows a primary by applying the state delta of each of its blocks (see state_delta.hpp) on
+          * top of the validated block header instead of executing the transactions. It refuses blocks until it is
+          * promoted, from then on it validates blocks in full like any other node.
+          */
+         bool     is_standby()const;
+         void     promote_standby();
+         /**
+          * @pre called from accepted_block, before the next block starts
+          * @return the changes bsp made to the state, empty if they were not recorded, e.g. in an irreversible replay
+          */
+         optional<state_delta> get_state_delta( const block_state_ptr& bsp )const;
+         /**
+          * applies the delta of block b on a standby, undoing the blocks of a branch the primary switched away from
+          * @return false if the standby has applied b already
+          */
+         bool     push_state_delta( const signed_block_ptr& b, const state_delta& delta );
 
          void preactivate_feature( const digest_type& feature_digest );
 
@@ -153,6 +223,13 @@ namespace roxe { namespace chain {
          transaction_trace_ptr push_scheduled_transaction( const transaction_id_type& scheduled, fc::time_point deadline, uint32_t billed_cpu_time_us = 0 );
 
          block_state_ptr finalize_block( const std::function<signature_type( const digest_type& )>& signer_callback );
+
+         /**
+          * Finalizes the pending block as finalize_block does but leaves it unsigned, so that it can be signed elsewhere
+          * meanwhile. The signature over the returned digest must be passed to complete_block before commit_block.
+          */
+         digest_type finalize_unsigned_block();
+         block_state_ptr complete_block( const signature_type& producer_signature );
          void sign_block( const std::function<signature_type( const digest_type& )>& signer_callback );
          void commit_block();
          void pop_block();
@@ -222,6 +299,8 @@ namespace roxe { namespace chain {
 
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
+         /// @return the packed block, irreversible blocks are read from the block log without unpacking; empty if unknown
+         vector<char>     fetch_serialized_block_by_number( uint32_t block_num )const;
 
          block_state_ptr fetch_block_state_by_number( uint32_t block_num )const;
          block_state_ptr fetch_block_state_by_id( block_id_type id )const;
@@ -231,6 +310,23 @@ namespace roxe { namespace chain {
          sha256 calculate_integrity_hash()const;
          void write_snapshot( const snapshot_writer_ptr& snapshot )const;
 
+         /**
+          * Writes only the contract tables changed since the last snapshot written by or loaded into this node; requires
+          * config::differential_snapshots and a base that is still in the chain
+          */
+         void write_differential_snapshot( const snapshot_writer_ptr& snapshot )const;
+
+         /// @return the head block of the snapshot the next differential snapshot is based on, if there is one
+         optional<block_id_type> differential_snapshot_base()const;
+
+         /**
+          * Makes the head the base of the next differential snapshot as write_snapshot does, for full snapshots of the
+          * head written by a forked child process
+          */
+         void start_differential_snapshot_base();
+
+         void record_table_change( name code, name scope, name table );
+
          bool sender_avoids_whitelist_blacklist_enforcement( account_name sender )const;
          void check_actor_list( const flat_set<account_name>& actors )const;
          void check_contract_list( account_name code )const;
@@ -249,7 +345,8 @@ namespace roxe { namespace chain {
          void validate_expiration( const transaction& t )const;
          void validate_tapos( const transaction& t )const;
          void validate_db_available_size() const;
-         void validate_reversible_available_size() const;
+         /// free state memory below which validate_db_available_size() throws database_guard_exception
+         uint64_t state_guard_size() const;
 
          bool is_protocol_feature_activated( const digest_type& feature_digest )const;
          bool is_builtin_activated( builtin_protocol_feature_t f )const;
@@ -265,6 +362,22 @@ namespace roxe { namespace chain {
          bool skip_trx_checks()const;
 
          bool contracts_console()const;
+         /// Called by applied_transaction subscribers that read console output, ram deltas or action timings, which
+         /// are otherwise left out of the traces of transactions in blocks being validated or replayed
+         void require_detailed_traces();
+         /// Called by applied_transaction subscribers that read console output, which is only captured for them or
+         /// with contracts-console; implies require_detailed_traces
+         void require_console_output();
+         /// @return whether contract console output is captured into detailed action traces
+         bool console_output_enabled()const;
+         uint32_t max_console_output_bytes()const;
+         bool record_table_access_sets()const;
+         /**
+          * Whether trx has to execute again to tell if it still applies: true unless its last successful execution recorded
+          * its table accesses and no transaction executed since, in any block or in the pending one, wrote a table it
+          * read or wrote or ran a native action. Writes undone since count as well.
+          */
+         bool table_access_stale( const transaction_metadata& trx )const;
 
          chain_id_type get_chain_id()const;
 
@@ -299,8 +412,41 @@ namespace roxe { namespace chain {
          */
 
          const apply_handler* find_apply_handler( account_name contract, scope_name scope, action_name act )const;
+
+         /// What dispatching an action to a receiver needs, cached per receiver until an account is created
+         struct receiver_dispatch {
+            const account_metadata_object*  account = nullptr;
+            bool                            has_native_handlers = false; ///< find_apply_handler or find_native_contract_action may match
+         };
+
+         /// throws like get<account_metadata_object,by_name> when the receiver does not exist
+         receiver_dispatch get_receiver_dispatch( account_name receiver )const;
+         /// called when an account_metadata_object is created, undoing the creation restores the previous epoch
+         void invalidate_receiver_dispatch();
+
+         /**
+          * Keeps trx, the transaction a contract has just stored in the generated_transaction_object with trx_id id, until
+          * it is retired, so that it is not unpacked again. Only used while it still matches the packed transaction in
+          * the object.
+          */
+         void cache_scheduled_transaction( const transaction_id_type& id, const packed_transaction_ptr& trx );
+
+         /**
+          * Runs `handler` in place of the wasm deployed to `receiver` for action `act` of `contract`, but only while
+          * the deployed code hashes to `code_hash`. The handler must leave state, receipts and traces exactly as the
+          * wasm would, since other nodes keep running the wasm; deploying any other code to `receiver` switches
+          * back to the wasm. Nothing is registered unless a plugin or embedding application opts in.
+          */
+         void register_native_contract_action( account_name receiver, const digest_type& code_hash,
+                                               account_name contract, action_name act, apply_handler handler );
+         const apply_handler* find_native_contract_action( account_name receiver, const digest_type& code_hash,
+                                                           account_name contract, action_name act )const;
          wasm_interface& get_wasm_interface();
 
+         const apply_timing& get_apply_timing()const;
+         void clear_apply_timing();
+         const released_trx_metas& get_released_trx_metas()const;
+
 
          optional<abi_serializer> get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
             if( n.good() ) {
@@ -520,6 +520,10 @@ namespace roxe { namespace chain {
                                     3170009, "Snapshot Finalization Exception" )
       FC_DECLARE_DERIVED_EXCEPTION( invalid_protocol_features_to_activate,  producer_exception,
                                     3170010, "The protocol features to be activated were not valid" )
+      FC_DECLARE_DERIVED_EXCEPTION( pending_transactions_full_exception,  producer_exception,
+                                    3170011, "Too many transactions are waiting to be processed" )
+      FC_DECLARE_DERIVED_EXCEPTION( expected_cpu_exceeded_exception,  producer_exception,
+                                    3170012, "Transaction is expected to exceed the maximum transaction time" )
 
    FC_DECLARE_DERIVED_EXCEPTION( reversible_blocks_exception,           chain_exception,
                                  3180000, "Reversible Blocks exception" )
@@ -18,6 +18,11 @@ namespace roxe { namespace chain {
     * database tracks the longest chain and the last irreversible block number. All
     * blocks older than the last irreversible block are freed after emitting the
     * irreversible signal.
+    *
+    * Every change is appended to a journal in the data directory as it happens, so closing the fork
+    * database only writes the head and reopening it replays the journal. The journal is compacted on
+    * open and whenever it grows well beyond the blocks still in the fork database. A fork_db.dat file
+    * written by previous versions is still read on open.
     */
    class fork_database {
       public:
@@ -89,6 +94,7 @@ namespace roxe { namespace chain {
          void mark_valid( const block_state_ptr& h );
 
          static const uint32_t magic_number;
+         static const uint32_t journal_version;
 
          static const uint32_t min_supported_version;
          static const uint32_t max_supported_version;
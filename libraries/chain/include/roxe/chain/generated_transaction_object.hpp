@@ -44,6 +44,13 @@ namespace roxe { namespace chain {
             fc::raw::pack( ds, trx );
             return trxsize;
          }
+
+         /// stores the uncompressed transaction of ptrx as it is packed already
+         uint32_t set( const packed_transaction& ptrx ) {
+            const auto& packed = ptrx.get_packed_transaction();
+            packed_trx.assign( packed.data(), packed.size() );
+            return packed.size();
+         }
    };
 
    struct by_trx_id;
@@ -5,10 +5,18 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <string_view>
 #include <vector>
 
 namespace roxe { namespace chain {
 
 extern const std::vector<const char*> genesis_intrinsics;
 
+/// index of @p name in genesis_intrinsics, or -1 if it is not one; a single perfect-hash probe
+int32_t find_genesis_intrinsic( std::string_view name );
+
+/// key under which genesis_intrinsics[index] is stored in whitelisted_intrinsics_type
+uint64_t genesis_intrinsic_whitelist_hash( uint32_t index );
+
 } } // namespace roxe::chain
@@ -55,6 +55,11 @@ namespace roxe { namespace chain {
 
         id_type    id;
         uint64_t   global_action_sequence = 0;
+
+        /// changes with every permission or link change, see authorization_manager; not part of snapshots
+        uint64_t   authorization_epoch = 0;
+        /// changes with every account creation, see controller::get_receiver_dispatch; not part of snapshots
+        uint64_t   dispatch_epoch = 0;
    };
 
    using dynamic_global_property_multi_index = chainbase::shared_multi_index_container<
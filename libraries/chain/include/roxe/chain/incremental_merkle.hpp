@@ -64,6 +64,16 @@ constexpr int calcluate_max_depth(uint64_t node_count) {
    return clz_power_2(implied_count) + 1;
 }
 
+/**
+ * hash of make_canonical_pair(l, r) without building the pair and streaming it through an encoder
+ */
+template<typename DigestType>
+inline DigestType hash_canonical_pair(const DigestType& l, const DigestType& r) {
+   static_assert(sizeof(DigestType) == sizeof(l._hash), "digests are expected to be stored without padding");
+   DigestType pair[2] = { make_canonical_left(l), make_canonical_right(r) };
+   return DigestType::hash(pair[0].data(), sizeof(pair));
+}
+
 template<typename ContainerA, typename ContainerB>
 inline void move_nodes(ContainerA& to, const ContainerB& from) {
    to.clear();
@@ -172,7 +182,9 @@ class incremental_merkle_impl {
          auto index = _node_count;
          auto top = digest;
          auto active_iter = _active_nodes.begin();
-         auto updated_active_nodes = vector<DigestType>();
+         // reused between appends so that building the new active nodes does not allocate
+         static thread_local vector<DigestType> updated_active_nodes;
+         updated_active_nodes.clear();
          updated_active_nodes.reserve(max_depth);
 
          while (current_depth > 0) {
@@ -188,7 +200,7 @@ class incremental_merkle_impl {
 
                // calculate the partially realized node value by implying the "right" value is identical
                // to the "left" value
-               top = DigestType::hash(make_canonical_pair(top, top));
+               top = detail::hash_canonical_pair(top, top);
                partial = true;
             } else {
                // we are collapsing from a "right" value and an fully-realized "left"
@@ -204,7 +216,7 @@ class incremental_merkle_impl {
                }
 
                // calculate the node
-               top = DigestType::hash(make_canonical_pair(left_value, top));
+               top = detail::hash_canonical_pair(left_value, top);
             }
 
             // move up a level in the tree
@@ -215,8 +227,8 @@ class incremental_merkle_impl {
          // append the top of the collapsed tree (aka the root of the merkle)
          updated_active_nodes.emplace_back(top);
 
-         // store the new active_nodes
-         detail::move_nodes(_active_nodes, std::move(updated_active_nodes));
+         // store the new active_nodes, copied into the existing storage of _active_nodes
+         detail::move_nodes(_active_nodes, updated_active_nodes);
 
          // update the node count
          _node_count++;
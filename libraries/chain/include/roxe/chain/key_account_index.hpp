@@ -0,0 +1,55 @@
+#pragma once
+#include <roxe/chain/types.hpp>
+#include <chainbase/chainbase.hpp>
+#include <fc/filesystem.hpp>
+#include <mutex>
+#include <set>
+
+namespace roxe { namespace chain {
+
+   /**
+    * @class key_account_index
+    * @brief the permissions each public key was added to, to find the accounts of a key without history_plugin
+    *
+    * Entries are only ever added: when an account is created or changes a permission, the keys its permissions hold
+    * then are added. A key a permission no longer holds, after updateauth, deleteauth or a fork switch, is left in
+    * and filtered out by lookup(), which checks every candidate against the state. save() writes only the entries
+    * still valid and load() accepts a file only if it was written at the current head block. All methods are thread
+    * safe.
+    */
+   class key_account_index {
+      public:
+         struct entry {
+            public_key_type  key;
+            account_name     account;
+            permission_name  permission;
+
+            friend bool operator<( const entry& a, const entry& b ) {
+               return std::tie( a.key, a.account, a.permission ) < std::tie( b.key, b.account, b.permission );
+            }
+         };
+
+         /// replaces the index with the keys of all permissions in db
+         void build( const chainbase::database& db );
+         /// adds the keys the permissions of account hold in db
+         void update( const chainbase::database& db, account_name account );
+
+         /// @return the accounts with a permission holding key in db, sorted
+         vector<account_name> lookup( const chainbase::database& db, const public_key_type& key )const;
+
+         void save( const fc::path& p, const chainbase::database& db, const block_id_type& head_id )const;
+         /// @return false if the file does not exist or was not written at head_id
+         bool load( const fc::path& p, const block_id_type& head_id );
+
+         size_t size()const;
+
+      private:
+         static bool holds( const chainbase::database& db, const entry& e );
+
+         mutable std::mutex   mtx;
+         std::set<entry>      entries;
+   };
+
+} } // roxe::chain
+
+FC_REFLECT( roxe::chain::key_account_index::entry, (key)(account)(permission) )
@@ -1,6 +1,8 @@
 #pragma once
 #include <roxe/chain/types.hpp>
 
+namespace boost { namespace asio { class io_context; } }
+
 namespace roxe { namespace chain {
 
    digest_type make_canonical_left(const digest_type& val);
@@ -19,4 +21,13 @@ namespace roxe { namespace chain {
     */
    digest_type merkle( vector<digest_type> ids );
 
+   /// levels with at least this many pairs are split over the threads of the pool
+   const static size_t parallel_merkle_threshold = 2048;
+
+   /**
+    *  Same root as merkle( ids ). The levels with at least parallel_merkle_threshold pairs are hashed in up to
+    *  thread_count parts, all but one of them on thread_pool and the last one on the calling thread.
+    */
+   digest_type merkle( vector<digest_type> ids, boost::asio::io_context& thread_pool, size_t thread_count );
+
 } } /// roxe::chain
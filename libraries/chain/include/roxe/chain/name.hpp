@@ -1,17 +1,37 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <fc/reflect/reflect.hpp>
+#include <fc/io/raw_fwd.hpp>
 #include <iosfwd>
 
 namespace roxe { namespace chain {
    using std::string;
 
+   namespace detail {
+      // Maps every byte to its 5-bit name symbol; bytes outside ".12345a-z" are
+      // flagged with invalid_name_char and otherwise decode as '.'
+      struct name_char_table {
+         static constexpr uint8_t invalid_name_char = 0x80;
+         uint8_t symbols[256] = {};
+
+         constexpr name_char_table() {
+            for( int c = 0; c < 256; ++c )
+               symbols[c] = invalid_name_char;
+            symbols[uint8_t('.')] = 0;
+            for( char c = '1'; c <= '5'; ++c )
+               symbols[uint8_t(c)] = (c - '1') + 1;
+            for( char c = 'a'; c <= 'z'; ++c )
+               symbols[uint8_t(c)] = (c - 'a') + 6;
+         }
+      };
+
+      inline constexpr name_char_table name_chars{};
+      inline constexpr char name_charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+   }
+
    static constexpr uint64_t char_to_symbol( char c ) {
-      if( c >= 'a' && c <= 'z' )
-         return (c - 'a') + 6;
-      if( c >= '1' && c <= '5' )
-         return (c - '1') + 1;
-      return 0;
+      return detail::name_chars.symbols[uint8_t(c)] & 0x1f;
    }
 
    // Each char of the string is encoded into 5-bit chunk and left-shifted
@@ -39,6 +59,9 @@ namespace roxe { namespace chain {
 
 #define N(X) roxe::chain::string_to_name(#X)
 
+   static_assert( string_to_name("1") == 1ull << 59, "name encoding" );
+   static_assert( string_to_name("zzzzzzzzzzzzj") == 0xffffffffffffffffull, "name encoding" );
+
    struct name {
       uint64_t value = 0;
       bool empty()const { return 0 == value; }
@@ -50,11 +73,18 @@ namespace roxe { namespace chain {
       void set( const char* str );
 
       template<typename T>
-      name( T v ):value(v){}
-      name(){}
+      constexpr name( T v ):value(v){}
+      constexpr name(){}
 
       explicit operator string()const;
 
+      /**
+       * Writes the name's characters, without trailing dots, to [begin, end) and
+       * returns one past the last character written. Writes nothing if the range
+       * is shorter than the name (13 characters at most).
+       */
+      char* write_as_string( char* begin, char* end )const;
+
       string to_string() const { return string(*this); }
 
       name& operator=( uint64_t v ) {
@@ -72,7 +102,8 @@ namespace roxe { namespace chain {
       }
 
       friend std::ostream& operator << ( std::ostream& out, const name& n ) {
-         return out << string(n);
+         char buffer[13];
+         return out << std::string_view( buffer, n.write_as_string( buffer, buffer + sizeof(buffer) ) - buffer );
       }
 
       friend bool operator < ( const name& a, const name& b ) { return a.value < b.value; }
@@ -112,3 +143,8 @@ namespace fc {
 
 
 FC_REFLECT( roxe::chain::name, (value) )
+
+namespace fc { namespace raw {
+   template<> struct is_bulk_copyable<roxe::chain::name> : std::true_type {};
+   static_assert( sizeof(roxe::chain::name) == sizeof(uint64_t), "name packs as its value" );
+} }
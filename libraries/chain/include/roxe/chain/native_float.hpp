@@ -0,0 +1,150 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+
+#include <cstring>
+#include <softfloat.hpp>
+
+#include <cfloat>
+
+#if defined(__x86_64__) && defined(__SSE2_MATH__) && FLT_EVAL_METHOD == 0
+   #include <immintrin.h>
+   #define ROXE_NATIVE_FLOAT 1
+#else
+   #define ROXE_NATIVE_FLOAT 0
+#endif
+
+namespace roxe { namespace chain { namespace native_float {
+
+   /**
+    * The basic IEEE-754 operations, add, sub, mul, div and sqrt, are correctly rounded, so SSE computes the same
+    * bits as softfloat as long as
+    *  - the rounding mode is round to nearest even and denormals are neither flushed nor treated as zero, which
+    *    the MXCSR of the calling thread is checked for on every call
+    *  - no operand and no result is a NaN, NaN payloads and which operand a NaN propagates from depend on the
+    *    operand order the compiler picks, softfloat decides those
+    * Anything else is computed by softfloat, as are all the other float operations.
+    */
+#if ROXE_NATIVE_FLOAT
+   /// rounding control (bits 13-14), flush to zero (bit 15) and denormals are zero (bit 6)
+   constexpr unsigned int mxcsr_mode_mask = 0xE040;
+
+   inline bool enabled() { return (_mm_getcsr() & mxcsr_mode_mask) == 0; }
+
+   inline bool is_nan( float f )  { return f != f; }
+   inline bool is_nan( double d ) { return d != d; }
+
+   template<typename T, typename Native, typename Soft>
+   inline T binop( T a, T b, Native&& native, Soft&& soft ) {
+      if( enabled() && !is_nan( a ) && !is_nan( b ) ) {
+         const T r = native( a, b );
+         if( !is_nan( r ) )
+            return r;
+      }
+      return soft( a, b );
+   }
+
+   template<typename T, typename Native, typename Soft>
+   inline T unop( T a, Native&& native, Soft&& soft ) {
+      if( enabled() && !is_nan( a ) ) {
+         const T r = native( a );
+         if( !is_nan( r ) )
+            return r;
+      }
+      return soft( a );
+   }
+#endif
+
+   inline float f32_add( float a, float b ) {
+      auto soft = []( float a, float b ) { return from_softfloat32( ::f32_add( to_softfloat32( a ), to_softfloat32( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( float a, float b ) { return _mm_cvtss_f32( _mm_add_ss( _mm_set_ss( a ), _mm_set_ss( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline float f32_sub( float a, float b ) {
+      auto soft = []( float a, float b ) { return from_softfloat32( ::f32_sub( to_softfloat32( a ), to_softfloat32( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( float a, float b ) { return _mm_cvtss_f32( _mm_sub_ss( _mm_set_ss( a ), _mm_set_ss( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline float f32_mul( float a, float b ) {
+      auto soft = []( float a, float b ) { return from_softfloat32( ::f32_mul( to_softfloat32( a ), to_softfloat32( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( float a, float b ) { return _mm_cvtss_f32( _mm_mul_ss( _mm_set_ss( a ), _mm_set_ss( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline float f32_div( float a, float b ) {
+      auto soft = []( float a, float b ) { return from_softfloat32( ::f32_div( to_softfloat32( a ), to_softfloat32( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( float a, float b ) { return _mm_cvtss_f32( _mm_div_ss( _mm_set_ss( a ), _mm_set_ss( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline float f32_sqrt( float a ) {
+      auto soft = []( float a ) { return from_softfloat32( ::f32_sqrt( to_softfloat32( a ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return unop( a, []( float a ) { return _mm_cvtss_f32( _mm_sqrt_ss( _mm_set_ss( a ) ) ); }, soft );
+#else
+      return soft( a );
+#endif
+   }
+
+   inline double f64_add( double a, double b ) {
+      auto soft = []( double a, double b ) { return from_softfloat64( ::f64_add( to_softfloat64( a ), to_softfloat64( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( double a, double b ) { return _mm_cvtsd_f64( _mm_add_sd( _mm_set_sd( a ), _mm_set_sd( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline double f64_sub( double a, double b ) {
+      auto soft = []( double a, double b ) { return from_softfloat64( ::f64_sub( to_softfloat64( a ), to_softfloat64( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( double a, double b ) { return _mm_cvtsd_f64( _mm_sub_sd( _mm_set_sd( a ), _mm_set_sd( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline double f64_mul( double a, double b ) {
+      auto soft = []( double a, double b ) { return from_softfloat64( ::f64_mul( to_softfloat64( a ), to_softfloat64( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( double a, double b ) { return _mm_cvtsd_f64( _mm_mul_sd( _mm_set_sd( a ), _mm_set_sd( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline double f64_div( double a, double b ) {
+      auto soft = []( double a, double b ) { return from_softfloat64( ::f64_div( to_softfloat64( a ), to_softfloat64( b ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return binop( a, b, []( double a, double b ) { return _mm_cvtsd_f64( _mm_div_sd( _mm_set_sd( a ), _mm_set_sd( b ) ) ); }, soft );
+#else
+      return soft( a, b );
+#endif
+   }
+
+   inline double f64_sqrt( double a ) {
+      auto soft = []( double a ) { return from_softfloat64( ::f64_sqrt( to_softfloat64( a ) ) ); };
+#if ROXE_NATIVE_FLOAT
+      return unop( a, []( double a ) { return _mm_cvtsd_f64( _mm_sqrt_sd( _mm_set_sd( a ), _mm_set_sd( a ) ) ); }, soft );
+#else
+      return soft( a );
+#endif
+   }
+
+} } } // roxe::chain::native_float
@@ -0,0 +1,53 @@
+#pragma once
+#include <roxe/chain/types.hpp>
+#include <fc/filesystem.hpp>
+
+namespace roxe { namespace chain {
+
+   /**
+    * @class prepared_wasm_cache
+    * @brief file backed store of contract code that has already been prepared for instantiation
+    *
+    * Preparing contract code (deserialization, injection and re-serialization) is done once per
+    * (code_hash, vm_type, vm_version) and the result is persisted in its own file under the cache
+    * directory so that a restart or replay does not need to redo it. Entries are only read from disk
+    * the first time they are requested. A default constructed (empty) path disables the cache.
+    *
+    * Only the prepared wasm is stored, not native code: WAVM's compiled output embeds addresses of
+    * the instance it was compiled for and cannot be relocated into another process, so the runtime
+    * still compiles each contract on first use after a restart.
+    */
+   class prepared_wasm_cache {
+      public:
+         struct entry {
+            digest_type       code_hash;
+            uint8_t           vm_type = 0;
+            uint8_t           vm_version = 0;
+            vector<uint8_t>   code;            ///< injected and re-serialized wasm
+            vector<uint8_t>   initial_memory;  ///< initial linear memory image built from the data segments
+         };
+
+         static const uint32_t magic_number;
+         static const uint32_t version;
+
+         explicit prepared_wasm_cache( const fc::path& cache_dir );
+
+         bool enabled()const { return !dir.string().empty(); }
+         const fc::path& cache_dir()const { return dir; }
+
+         /// @return true if the entry was found on disk and passed validation
+         bool get( const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version, entry& result )const;
+
+         void set( const entry& e );
+
+         void erase( const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version );
+
+      private:
+         fc::path entry_path( const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version )const;
+
+         fc::path dir;
+   };
+
+} } // roxe::chain
+
+FC_REFLECT( roxe::chain::prepared_wasm_cache::entry, (code_hash)(vm_type)(vm_version)(code)(initial_memory) )
@@ -79,9 +79,67 @@ namespace roxe { namespace chain {
       return !(a==b);
    }
 
+   /**
+    * A producer_schedule_type which is never modified, shared by all the block header states it is active or pending
+    * in instead of copied into each of them. Packed and converted to a variant as the schedule itself.
+    */
+   class immutable_producer_schedule {
+      public:
+         immutable_producer_schedule()
+         :sched( empty() ) {}
+
+         immutable_producer_schedule( producer_schedule_type s )
+         :sched( std::make_shared<const producer_schedule_type>( std::move( s ) ) ) {}
+
+         const producer_schedule_type& operator*()const  { return *sched; }
+         const producer_schedule_type* operator->()const { return sched.get(); }
+         operator const producer_schedule_type&()const   { return *sched; }
+
+         friend bool operator == ( const immutable_producer_schedule& a, const immutable_producer_schedule& b ) {
+            return a.sched == b.sched || *a.sched == *b.sched;
+         }
+         friend bool operator != ( const immutable_producer_schedule& a, const immutable_producer_schedule& b ) {
+            return !(a == b);
+         }
+
+         template<typename DataStream>
+         friend DataStream& operator << ( DataStream& ds, const immutable_producer_schedule& s ) {
+            fc::raw::pack( ds, *s.sched );
+            return ds;
+         }
+
+         template<typename DataStream>
+         friend DataStream& operator >> ( DataStream& ds, immutable_producer_schedule& s ) {
+            producer_schedule_type unpacked;
+            fc::raw::unpack( ds, unpacked );
+            s = std::move( unpacked );
+            return ds;
+         }
+
+      private:
+         static const std::shared_ptr<const producer_schedule_type>& empty() {
+            static const auto e = std::make_shared<const producer_schedule_type>();
+            return e;
+         }
+
+         std::shared_ptr<const producer_schedule_type> sched;
+   };
+
 
 } } /// roxe::chain
 
 FC_REFLECT( roxe::chain::producer_key, (producer_name)(block_signing_key) )
 FC_REFLECT( roxe::chain::producer_schedule_type, (version)(producers) )
 FC_REFLECT( roxe::chain::shared_producer_schedule_type, (version)(producers) )
+
+namespace fc {
+   inline void to_variant( const roxe::chain::immutable_producer_schedule& s, fc::variant& v ) {
+      to_variant( *s, v );
+   }
+
+   inline void from_variant( const fc::variant& v, roxe::chain::immutable_producer_schedule& s ) {
+      roxe::chain::producer_schedule_type schedule;
+      from_variant( v, schedule );
+      s = std::move( schedule );
+   }
+}
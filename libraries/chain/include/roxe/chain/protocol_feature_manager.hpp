@@ -24,7 +24,8 @@ enum class builtin_protocol_feature_t : uint32_t {
    only_bill_first_authorizer,
    forward_setcode,
    get_sender,
-   ram_restrictions
+   ram_restrictions,
+   batched_index_reads
 };
 
 struct protocol_feature_subjective_restrictions {
@@ -340,7 +341,14 @@ public:
    const_iterator upper_bound( uint32_t block_num )const;
 
 
-   bool is_builtin_activated( builtin_protocol_feature_t feature_codename, uint32_t current_block_num )const;
+   /// consulted by every intrinsic and many chain rules, so answered from a bitset of the builtins active at the block
+   bool is_builtin_activated( builtin_protocol_feature_t feature_codename, uint32_t current_block_num )const {
+      uint32_t indx = static_cast<uint32_t>( feature_codename );
+      if( indx >= max_builtin_features ) return false;
+      if( current_block_num != _active_builtins_block_num )
+         refresh_active_builtins( current_block_num );
+      return (_active_builtins >> indx) & 1;
+   }
 
    void activate_feature( const digest_type& feature_digest, uint32_t current_block_num );
    void popped_blocks_to( uint32_t block_num );
@@ -360,12 +368,18 @@ protected:
       uint32_t                             activation_block_num = not_active;
    };
 
+   static constexpr uint32_t max_builtin_features = 64;
+
+   void refresh_active_builtins( uint32_t current_block_num )const;
+
 protected:
    protocol_feature_set                   _protocol_feature_set;
    vector<protocol_feature_entry>         _activated_protocol_features;
    vector<builtin_protocol_feature_entry> _builtin_protocol_features;
    size_t                                 _head_of_builtin_activation_list = builtin_protocol_feature_entry::no_previous;
    bool                                   _initialized = false;
+   mutable uint64_t                       _active_builtins = 0; ///< bit per builtin_protocol_feature_t
+   mutable uint32_t                       _active_builtins_block_num = builtin_protocol_feature_entry::not_active;
 };
 
 } } // namespace roxe::chain
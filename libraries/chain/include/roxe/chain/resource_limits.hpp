@@ -55,10 +55,8 @@ namespace roxe { namespace chain { namespace resource_limits {
 
    class resource_limits_manager {
       public:
-         explicit resource_limits_manager(chainbase::database& db)
-         :_db(db)
-         {
-         }
+         explicit resource_limits_manager(chainbase::database& db);
+         ~resource_limits_manager();
 
          void add_indices();
          void initialize_database();
@@ -97,7 +95,14 @@ namespace roxe { namespace chain { namespace resource_limits {
          int64_t get_account_ram_usage( const account_name& name ) const;
 
       private:
-         chainbase::database& _db;
+         /**
+          * Net and cpu usage of the accounts billed in the current block, written to their resource_usage_objects
+          * once by process_block_usage instead of once per transaction. Follows the database's undo sessions.
+          */
+         struct pending_usage;
+
+         chainbase::database&           _db;
+         std::unique_ptr<pending_usage> _pending_usage;
    };
 } } } /// roxe::chain
 
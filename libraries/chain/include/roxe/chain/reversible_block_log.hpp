@@ -0,0 +1,61 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <fc/filesystem.hpp>
+#include <roxe/chain/block.hpp>
+
+namespace roxe { namespace chain {
+
+   namespace detail { class reversible_block_log_impl; }
+
+   /* The reversible block log persists the blocks that have been applied but are not yet irreversible, so that
+    * they can be replayed on restart. It holds consecutive blocks in a single append only file:
+    *
+    * +--------+----------------------------+----------+-----+----------+
+    * | Header | Record 1 = size | block    | Record 2 | ... | Record N |
+    * +--------+----------------------------+----------+-----+----------+
+    *
+    * The header holds the magic number and the version, each record the size of the packed block followed by the
+    * packed block. The position and the id of every block are kept in memory.
+    *
+    * Appending a block at or below the last block number first truncates the file, which is how a fork switch
+    * replaces the popped blocks. Blocks becoming irreversible are only dropped from memory; the file is rewritten
+    * without them once they take up most of it. A partially written record left by a crash is cut off on open.
+    */
+   class reversible_block_log {
+      public:
+         static const uint32_t magic_number;
+         static const uint32_t version;
+         static const char*    filename;
+
+         explicit reversible_block_log( const fc::path& data_dir, bool read_only = false );
+         reversible_block_log( reversible_block_log&& other );
+         ~reversible_block_log();
+
+         /// appends b, first removing the blocks numbered b->block_num() and above
+         void append( const signed_block_ptr& b );
+         /// removes block_num and all blocks after it
+         void truncate( uint32_t block_num );
+         /// removes all blocks up to and including block_num
+         void remove_up_to( uint32_t block_num );
+         void clear();
+
+         /// @return nullptr if the block is not in the log
+         signed_block_ptr         read_block_by_num( uint32_t block_num )const;
+         optional<block_id_type>  block_id_for_num( uint32_t block_num )const;
+
+         bool     empty()const;
+         /// @return 0 if the log is empty
+         uint32_t first_block_num()const;
+         /// @return 0 if the log is empty
+         uint32_t last_block_num()const;
+
+         static bool exists( const fc::path& data_dir );
+
+      private:
+         std::unique_ptr<detail::reversible_block_log_impl> my;
+   };
+
+} }
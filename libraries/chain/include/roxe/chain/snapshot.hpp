@@ -7,7 +7,10 @@
 #include <roxe/chain/database_utils.hpp>
 #include <roxe/chain/exceptions.hpp>
 #include <fc/variant_object.hpp>
+#include <fc/filesystem.hpp>
 #include <boost/core/demangle.hpp>
+#include <fstream>
+#include <future>
 #include <ostream>
 
 namespace roxe { namespace chain {
@@ -114,8 +117,38 @@ namespace roxe { namespace chain {
       snapshot_row_writer<T> make_row_writer( const T& data) {
          return snapshot_row_writer<T>(data);
       }
+
+      struct vector_ostream {
+         auto& write( const char* d, size_t s ) {
+            out.insert( out.end(), d, d + s );
+            return *this;
+         }
+
+         auto& put( char c ) {
+            out.push_back( c );
+            return *this;
+         }
+
+         std::vector<char>& out;
+      };
    }
 
+   /**
+    * Rows serialized ahead of time, possibly on another thread, in the binary form that both the ostream and
+    * the integrity hash writers produce. Writers that accept them splice the bytes into the current section.
+    */
+   struct packed_snapshot_rows {
+      template<typename T>
+      void add_row( const T& row, const chainbase::database& db ) {
+         detail::vector_ostream out{data};
+         fc::raw::pack( out, detail::snapshot_row_traits<T>::to_snapshot_row(row, db) );
+         ++row_count;
+      }
+
+      std::vector<char> data;
+      uint64_t          row_count = 0;
+   };
+
    class snapshot_writer {
       public:
          class section_writer {
@@ -125,6 +158,11 @@ namespace roxe { namespace chain {
                   _writer.write_row(detail::make_row_writer(detail::snapshot_row_traits<T>::to_snapshot_row(row, db)));
                }
 
+               /// only valid if the writer accepts_packed_rows()
+               void add_packed_rows( const packed_snapshot_rows& rows ) {
+                  _writer.write_packed_rows(rows);
+               }
+
             private:
                friend class snapshot_writer;
                section_writer(snapshot_writer& writer)
@@ -148,11 +186,14 @@ namespace roxe { namespace chain {
             write_section(detail::snapshot_section_traits<T>::section_name(), f);
          }
 
+         virtual bool accepts_packed_rows()const { return false; }
+
       virtual ~snapshot_writer(){};
 
       protected:
          virtual void write_start_section( const std::string& section_name ) = 0;
          virtual void write_row( const detail::abstract_snapshot_row_writer& row_writer ) = 0;
+         virtual void write_packed_rows( const packed_snapshot_rows& rows );
          virtual void write_end_section() = 0;
    };
 
@@ -333,9 +374,12 @@ namespace roxe { namespace chain {
 
          void write_start_section( const std::string& section_name ) override;
          void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_packed_rows( const packed_snapshot_rows& rows ) override;
          void write_end_section( ) override;
          void finalize();
 
+         bool accepts_packed_rows()const override { return true; }
+
          static const uint32_t magic_number = 0x30510550;
 
       private:
@@ -366,15 +410,50 @@ namespace roxe { namespace chain {
          uint64_t       cur_row;
    };
 
+   /**
+    * Input stream buffer over a file that reads the next chunk on a background thread while the current chunk is
+    * consumed. An istream_snapshot_reader on top of it decodes rows from memory with large sequential reads in
+    * the background instead of issuing a read for every few fields.
+    */
+   class read_ahead_file_streambuf : public std::streambuf {
+      public:
+         explicit read_ahead_file_streambuf( const fc::path& file, size_t chunk_size = 8*1024*1024 );
+         ~read_ahead_file_streambuf();
+
+         uint64_t size()const { return file_size; }
+
+      protected:
+         int_type underflow() override;
+         pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which ) override;
+         pos_type seekpos( pos_type pos, std::ios_base::openmode which ) override;
+
+      private:
+         size_t read_at( uint64_t pos, std::vector<char>& buf );
+         void   start_prefetch( uint64_t pos );
+         void   cancel_prefetch();
+
+         std::ifstream        file;
+         uint64_t             file_size = 0;
+         size_t               chunk_size;
+         std::vector<char>    current;
+         uint64_t             current_pos = 0; ///< file offset of the first byte of current
+         std::vector<char>    next;
+         uint64_t             next_pos = 0;
+         std::future<size_t>  prefetch;
+   };
+
    class integrity_hash_snapshot_writer : public snapshot_writer {
       public:
          explicit integrity_hash_snapshot_writer(fc::sha256::encoder&  enc);
 
          void write_start_section( const std::string& section_name ) override;
          void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_packed_rows( const packed_snapshot_rows& rows ) override;
          void write_end_section( ) override;
          void finalize();
 
+         bool accepts_packed_rows()const override { return true; }
+
       private:
          fc::sha256::encoder&  enc;
 
@@ -0,0 +1,70 @@
+#pragma once
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace roxe { namespace chain {
+
+   /// A timed step of starting the node, with counters of what it got through
+   struct startup_phase {
+      std::string                                   name;
+      fc::time_point                                start;
+      fc::microseconds                              duration;
+      std::vector<std::pair<std::string, uint64_t>> counters;  ///< e.g. blocks replayed or bytes loaded
+   };
+
+   /**
+    * The phases of starting this process, recorded as they end. A process starts once, so the phases record into
+    * instance() from wherever they run, and phases may nest: the replay is a part of the controller startup.
+    */
+   class startup_profile {
+      public:
+         class scoped_phase {
+            public:
+               scoped_phase( startup_profile& profile, std::string name );
+               ~scoped_phase();
+
+               void add( std::string counter, uint64_t value ) { _phase.counters.emplace_back( std::move( counter ), value ); }
+
+               scoped_phase( const scoped_phase& ) = delete;
+               scoped_phase& operator=( const scoped_phase& ) = delete;
+
+            private:
+               startup_profile& _profile;
+               startup_phase    _phase;
+         };
+
+         static startup_profile& instance();
+
+         /// times the phase until the returned guard goes out of scope
+         scoped_phase phase( std::string name ) { return scoped_phase( *this, std::move( name ) ); }
+
+         void record( startup_phase p );
+
+         /// the node is up, the main loop runs
+         void set_ready();
+
+         /// @return the phases ordered by start, the enclosing phase before the ones within it
+         std::vector<startup_phase> phases()const;
+
+         /// when static initialization of the process reached this library
+         fc::time_point process_start()const { return _process_start; }
+         /// when set_ready() was called, fc::time_point() before
+         fc::time_point ready()const;
+
+      private:
+         startup_profile();
+
+         mutable std::mutex         _mtx;
+         std::vector<startup_phase> _phases;
+         fc::time_point             _process_start;
+         fc::time_point             _ready;
+   };
+
+} } /// roxe::chain
+
+FC_REFLECT( roxe::chain::startup_phase, (name)(start)(duration)(counters) )
@@ -0,0 +1,59 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+
+#include <roxe/chain/block.hpp>
+#include <roxe/chain/types.hpp>
+
+namespace chainbase { class database; }
+
+namespace roxe { namespace chain {
+
+   /// a row of a state delta, the object packed along with the ids linking it to other objects
+   struct state_delta_row {
+      int64_t       id = 0;
+      vector<char>  data;
+   };
+
+   /// what one block changed in one chainbase index
+   struct state_delta_table {
+      string                   name;       ///< type of the objects in the index
+      int64_t                  next_id = 0; ///< next id of the index after the block, ids of removed new objects are skipped
+      vector<int64_t>          removed;    ///< ids of the objects which existed before the block and were removed
+      vector<state_delta_row>  rows;       ///< objects modified or created by the block, in id order
+   };
+
+   /**
+    * The changes a block made to the chain state, taken from the undo state chainbase keeps for the revision of
+    * the block. Applying it on top of the state before the block yields the state after the block, rows keep
+    * their ids so that objects referring to others by id stay valid.
+    */
+   struct state_delta {
+      block_id_type              block_id;
+      vector<state_delta_table>  tables;
+   };
+
+   /// the record of one applied block in a state delta stream
+   struct state_delta_entry {
+      signed_block_ptr  block;
+      state_delta       delta;
+   };
+
+   /**
+    * @pre the revision of db is the one of the block and its undo state has not been squashed or committed
+    */
+   state_delta make_state_delta( const chainbase::database& db, const block_id_type& block_id );
+
+   /**
+    * removes, modifies and creates the objects of delta in db, within the undo session of the caller
+    */
+   void apply_state_delta( chainbase::database& db, const state_delta& delta );
+
+} } /// roxe::chain
+
+FC_REFLECT( roxe::chain::state_delta_row, (id)(data) )
+FC_REFLECT( roxe::chain::state_delta_table, (name)(next_id)(removed)(rows) )
+FC_REFLECT( roxe::chain::state_delta, (block_id)(tables) )
+FC_REFLECT( roxe::chain::state_delta_entry, (block)(delta) )
@@ -8,6 +8,8 @@
 #include <roxe/chain/core_symbol.hpp>
 #include <string>
 #include <functional>
+#include <algorithm>
+#include <cctype>
 
 namespace roxe {
    namespace chain {
@@ -72,62 +74,76 @@ namespace roxe {
             static symbol from_string(const string& from)
             {
                try {
-                  string s = fc::trim(from);
-                  ROXE_ASSERT(!s.empty(), symbol_type_exception, "creating symbol from empty string");
-                  auto comma_pos = s.find(',');
-                  ROXE_ASSERT(comma_pos != string::npos, symbol_type_exception, "missing comma in symbol");
-                  auto prec_part = s.substr(0, comma_pos);
-                  uint8_t p = fc::to_int64(prec_part);
-                  string name_part = s.substr(comma_pos + 1);
+                  // trim and split "4,ROXE" in place instead of copying each part
+                  const char* begin = from.data();
+                  const char* end = begin + from.size();
+                  while( begin != end && std::isspace( static_cast<unsigned char>(*begin) ) ) ++begin;
+                  while( begin != end && std::isspace( static_cast<unsigned char>(*(end - 1)) ) ) --end;
+                  ROXE_ASSERT(begin != end, symbol_type_exception, "creating symbol from empty string");
+                  const char* comma = std::find(begin, end, ',');
+                  ROXE_ASSERT(comma != end, symbol_type_exception, "missing comma in symbol");
+                  uint8_t p = fc::to_int64(begin, comma - begin);
                   ROXE_ASSERT( p <= max_precision, symbol_type_exception, "precision ${p} should be <= 18", ("p", p));
-                  return symbol(string_to_symbol(p, name_part.c_str()));
+                  return symbol(string_to_symbol(p, string(comma + 1, end).c_str()));
                } FC_CAPTURE_LOG_AND_RETHROW((from))
             }
             uint64_t value() const { return m_value; }
             bool valid() const
             {
-               const auto& s = name();
-               return decimals() <= max_precision && valid_name(s);
+               return decimals() <= max_precision && valid_name(m_value >> 8);
             }
             static bool valid_name(const string& name)
             {
                return all_of(name.begin(), name.end(), [](char c)->bool { return (c >= 'A' && c <= 'Z'); });
             }
+            /// same as valid_name(name()) for a symbol code, without building the name
+            static bool valid_name(uint64_t code)
+            {
+               for( ; code > 0; code >>= 8 ) {
+                  char c = code & 0xFF;
+                  if( c < 'A' || c > 'Z' ) return false;
+               }
+               return true;
+            }
 
             uint8_t decimals() const { return m_value & 0xFF; }
             uint64_t precision() const
             {
+               static constexpr uint64_t powers_of_10[max_precision + 1] = {
+                  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+                  1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+                  100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+                  1000000000000000000ull
+               };
                ROXE_ASSERT( decimals() <= max_precision, symbol_type_exception, "precision ${p} should be <= 18", ("p", decimals()) );
-               uint64_t p10 = 1;
-               uint64_t p = decimals();
-               while( p > 0  ) {
-                  p10 *= 10; --p;
-               }
-               return p10;
+               return powers_of_10[decimals()];
+            }
+            /// writes the name to [begin, begin + 7) and returns one past its last character
+            char* write_name( char* begin ) const
+            {
+               for( uint64_t v = m_value >> 8; v > 0; v >>= 8 )
+                  *begin++ = v & 0xFF;
+               return begin;
             }
             string name() const
             {
-               uint64_t v = m_value;
-               v >>= 8;
-               string result;
-               while (v > 0) {
-                  char c = v & 0xFF;
-                  result += c;
-                  v >>= 8;
-               }
-               return result;
+               char buffer[7];
+               return string( buffer, write_name( buffer ) );
             }
 
             symbol_code to_symbol_code()const { return {m_value >> 8}; }
 
             explicit operator string() const
             {
-               uint64_t v = m_value;
-               uint8_t p = v & 0xFF;
-               string ret = roxe::chain::to_string(p);
-               ret += ',';
-               ret += name();
-               return ret;
+               // "255," and a 7 character name
+               char buffer[11];
+               char* pos = buffer;
+               uint8_t p = m_value & 0xFF;
+               if( p >= 100 ) *pos++ = '0' + p / 100;
+               if( p >= 10 )  *pos++ = '0' + p / 10 % 10;
+               *pos++ = '0' + p % 10;
+               *pos++ = ',';
+               return string( buffer, write_name( pos ) );
             }
 
             string to_string() const { return string(*this); }
@@ -139,7 +155,7 @@ namespace roxe {
 
             void reflector_init()const {
                ROXE_ASSERT( decimals() <= max_precision, symbol_type_exception, "precision ${p} should be <= 18", ("p", decimals()) );
-               ROXE_ASSERT( valid_name(name()), symbol_type_exception, "invalid symbol: ${name}", ("name",name()));
+               ROXE_ASSERT( valid_name(m_value >> 8), symbol_type_exception, "invalid symbol: ${name}", ("name",name()));
             }
 
          private:
@@ -0,0 +1,42 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <roxe/chain/types.hpp>
+
+namespace roxe { namespace chain {
+
+   /**
+    * @brief contract tables a transaction read from and wrote to
+    *
+    * Tables are identified by (code, scope, table). Primary and secondary index rows of a table are tracked
+    * together. Chain bookkeeping that every transaction touches (global sequences, resource usage) is not
+    * recorded since it can be reconciled in block order after the fact.
+    */
+   struct table_access_set {
+      using table_key = std::tuple<name, name, name>;
+
+      flat_set<table_key>   reads;
+      flat_set<table_key>   writes;
+      bool                  native_writes = false; ///< native actions changed accounts, permissions or code, which no table covers
+
+      void record_read( name code, name scope, name table ) { reads.emplace( code, scope, table ); }
+      void record_write( name code, name scope, name table ) { writes.emplace( code, scope, table ); }
+
+      bool empty()const { return reads.empty() && writes.empty(); }
+
+      /// true if executing the two transactions in a different order could change the result
+      bool conflicts_with( const table_access_set& other )const;
+   };
+
+   /**
+    * Assigns each transaction, in block order, to the earliest execution wave that follows every earlier
+    * transaction it conflicts with. Transactions in the same wave could be applied concurrently with identical
+    * results to serial execution.
+    *
+    * @return the wave of each transaction; the number of waves is one more than the largest element
+    */
+   vector<uint32_t> compute_execution_waves( const vector<table_access_set>& access_sets );
+
+} } // roxe::chain
@@ -5,14 +5,52 @@
 #pragma once
 
 #include <fc/optional.hpp>
+#include <fc/metrics.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
+#include <chrono>
 #include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace roxe { namespace chain {
 
+   /**
+    * Metrics of a named_thread_pool, labeled with its name prefix. Its threads count every handler its io_context
+    * runs and report their CPU time, which tells how busy each is; tasks posted through async_thread_pool are also
+    * timed while queued and while running.
+    */
+   struct thread_pool_metrics {
+      std::string             pool;
+      fc::metrics::gauge&     threads;
+      fc::metrics::gauge&     queued;   ///< async_thread_pool tasks not started yet
+      fc::metrics::histogram& wait;     ///< seconds from async_thread_pool until the task started
+      fc::metrics::histogram& run;      ///< seconds the task ran
+      fc::metrics::counter&   handlers; ///< tasks, timers and socket completions run by the pool's threads
+
+      explicit thread_pool_metrics( std::string pool );
+
+      /// @return the metrics of the named_thread_pool running ioc, nullptr for any other io_context
+      static thread_pool_metrics* of( const boost::asio::io_context& ioc );
+   };
+
+   /**
+    * CPUs the threads of each named_thread_pool run on, by the pool's name prefix, and of the main thread, by "main".
+    * Threads of pools without an entry run on any CPU. Configured at startup before the pools are created, the
+    * threads of a pool pin themselves as they start.
+    */
+   struct thread_affinity {
+      static void set( const std::string& pool, std::vector<uint32_t> cpus );
+
+      /// pins the calling thread to the CPUs of pool, @return false if pool has none or pinning is not supported
+      static bool pin_current_thread( const std::string& pool );
+
+      /// the configured pools as "<pool>: cpus <list> (numa nodes <list>)", one per line
+      static std::string describe();
+   };
+
    /**
     * Wrapper class for boost asio thread pool and io_context run.
     * Also names threads so that tools like htop can see thread name.
@@ -37,6 +75,8 @@ namespace roxe { namespace chain {
       boost::asio::thread_pool       _thread_pool;
       boost::asio::io_context        _ioc;
       fc::optional<ioc_work_t>       _ioc_work;
+      thread_pool_metrics            _metrics;
+      size_t                         _num_threads;
    };
 
 
@@ -44,7 +84,19 @@ namespace roxe { namespace chain {
    template<typename F>
    auto async_thread_pool( boost::asio::io_context& thread_pool, F&& f ) {
       auto task = std::make_shared<std::packaged_task<decltype( f() )()>>( std::forward<F>( f ) );
-      boost::asio::post( thread_pool, [task]() { (*task)(); } );
+      auto* m = thread_pool_metrics::of( thread_pool );
+      if( !m ) {
+         boost::asio::post( thread_pool, [task]() { (*task)(); } );
+         return task->get_future();
+      }
+      m->queued.add( 1 );
+      boost::asio::post( thread_pool, [task, m, posted = std::chrono::steady_clock::now()]() {
+         const auto start = std::chrono::steady_clock::now();
+         m->queued.add( -1 );
+         m->wait.observe( std::chrono::duration<double>( start - posted ).count() );
+         (*task)(); // a packaged_task keeps exceptions for the future
+         m->run.observe( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+      } );
       return task->get_future();
    }
 
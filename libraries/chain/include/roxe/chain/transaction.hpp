@@ -97,6 +97,44 @@ namespace roxe { namespace chain {
                                                            flat_set<public_key_type>& recovered_pub_keys,
                                                            bool allow_duplicate_keys = false) const;
 
+            /**
+             * Recovers the key of a single signature over a signing digest, consulting the process wide recovery
+             * cache first. The digest covers the chain id, so entries are never shared across chains. Thread safe.
+             *
+             * @param cpu_usage set to the time spent recovering, or to the time originally spent if cached
+             */
+            static public_key_type     recover_signature_key( const signature_type& sig,
+                                                              const digest_type& digest,
+                                                              fc::microseconds& cpu_usage );
+
+            /**
+             * Same as recover_signature_key for each of sigs, with one cache lookup and one cache update for all of
+             * them. The signatures missing from the cache are recovered in one batch, whose time is split evenly
+             * between them.
+             */
+            static void                recover_signature_keys( const vector<signature_type>& sigs,
+                                                               const digest_type& digest,
+                                                               vector<public_key_type>& keys,
+                                                               vector<fc::microseconds>& cpu_usage );
+
+            /// get_signature_keys for signatures over an already computed sig_digest, without the time to compute it
+            static fc::microseconds    get_signature_keys( const vector<signature_type>& signatures,
+                                                           const digest_type& digest,
+                                                           fc::time_point deadline,
+                                                           flat_set<public_key_type>& recovered_pub_keys,
+                                                           bool allow_duplicate_keys = false );
+
+            struct recovery_cache_stats {
+               uint64_t size = 0;
+               uint64_t capacity = 0;
+               uint64_t hits = 0;
+               uint64_t misses = 0;
+            };
+
+            /// shared by net, producer and API ingress as well as block validation; 0 disables caching
+            static void                 set_recovery_cache_capacity( size_t capacity );
+            static recovery_cache_stats get_recovery_cache_stats();
+
             uint32_t total_actions()const { return context_free_actions.size() + actions.size(); }
 
             account_name first_authorizer()const {
@@ -153,6 +191,7 @@ namespace roxe { namespace chain {
             {
                 local_pack_transaction();
                 local_pack_context_free_data();
+                compute_id();
             }
 
             explicit packed_transaction(signed_transaction&& t, compression_type _compression = none)
@@ -160,6 +199,7 @@ namespace roxe { namespace chain {
             {
                 local_pack_transaction();
                 local_pack_context_free_data();
+                compute_id();
             }
 
             // used by abi_serializer
@@ -172,7 +212,7 @@ namespace roxe { namespace chain {
 
             digest_type packed_digest()const;
 
-            transaction_id_type id()const { return unpacked_trx.id(); }
+            transaction_id_type id()const { return trx_id; }
             bytes               get_raw_transaction()const;
 
             time_point_sec                expiration()const { return unpacked_trx.expiration; }
@@ -184,11 +224,19 @@ namespace roxe { namespace chain {
             const bytes&                  get_packed_context_free_data()const { return packed_context_free_data; }
             const bytes&                  get_packed_transaction()const { return packed_trx; }
 
+            /// same as get_signed_transaction().sig_digest( chain_id, context_free_data ), computed once per chain id
+            digest_type                   sig_digest( const chain_id_type& chain_id )const;
+            /// same as get_signed_transaction().get_signature_keys(), with the cached sig_digest()
+            fc::microseconds              get_signature_keys( const chain_id_type& chain_id, fc::time_point deadline,
+                                                              flat_set<public_key_type>& recovered_pub_keys,
+                                                              bool allow_duplicate_keys = false )const;
+
         private:
             void local_unpack_transaction(vector<bytes>&& context_free_data);
             void local_unpack_context_free_data();
             void local_pack_transaction();
             void local_pack_context_free_data();
+            void compute_id();
 
             friend struct fc::reflector<packed_transaction>;
             friend struct fc::reflector_init_visitor<packed_transaction>;
@@ -203,6 +251,11 @@ namespace roxe { namespace chain {
         private:
             // cache unpacked trx, for thread safety do not modify after construction
             signed_transaction                      unpacked_trx;
+            transaction_id_type                     trx_id;
+            /// packed_trx is the uncompressed encoding unpacked_trx packs to, so it is hashed instead of packing again
+            bool                                    canonical_packed_trx = false;
+            /// the chain id and sig_digest() for it; replaced atomically, the transaction is shared between threads
+            mutable std::shared_ptr<const std::pair<chain_id_type, digest_type>> sig_digest_cache;
         };
 
         using packed_transaction_ptr = std::shared_ptr<packed_transaction>;
@@ -215,6 +268,7 @@ FC_REFLECT(roxe::chain::deferred_transaction_generation_context, (sender_trx_id)
 FC_REFLECT( roxe::chain::transaction_header, (expiration)(ref_block_num)(ref_block_prefix)
         (max_net_usage_words)(max_cpu_usage_ms)(delay_sec) )
 FC_REFLECT_DERIVED( roxe::chain::transaction, (roxe::chain::transaction_header), (context_free_actions)(actions)(transaction_extensions) )
+FC_REFLECT( roxe::chain::transaction::recovery_cache_stats, (size)(capacity)(hits)(misses) )
 FC_REFLECT_DERIVED( roxe::chain::signed_transaction, (roxe::chain::transaction), (signatures)(context_free_data) )
 FC_REFLECT_ENUM( roxe::chain::packed_transaction::compression_type, (none)(zlib))
 // @ignore unpacked_trx
@@ -1,6 +1,7 @@
 #pragma once
 #include <roxe/chain/controller.hpp>
 #include <roxe/chain/trace.hpp>
+#include <roxe/chain/table_access_set.hpp>
 #include <signal.h>
 
 namespace roxe { namespace chain {
@@ -46,7 +47,12 @@ namespace roxe { namespace chain {
 
          void check_net_usage()const;
 
-         void checktime()const;
+         /// called from every intrinsic and injected wasm check, so only the expired flag is read inline
+         void checktime()const {
+            if( BOOST_LIKELY(_deadline_timer.expired == false) )
+               return;
+            check_deadline();
+         }
 
          void pause_billing_timer();
          void resume_billing_timer();
@@ -84,6 +90,8 @@ namespace roxe { namespace chain {
          void schedule_transaction();
          void record_transaction( const transaction_id_type& id, fc::time_point_sec expire );
 
+         void check_deadline()const;
+
          void validate_cpu_usage_to_bill( int64_t u, bool check_minimum = true )const;
 
          void disallow_transaction_extensions( const char* error_msg )const;
@@ -102,6 +110,7 @@ namespace roxe { namespace chain {
 
 
          vector<action_receipt>        executed;
+         optional<table_access_set>    table_access; ///< only recorded when controller::record_table_access_sets()
          flat_set<account_name>        bill_to_accounts;
          flat_set<account_name>        validate_ram_usage;
 
@@ -112,6 +121,9 @@ namespace roxe { namespace chain {
          bool                          is_input           = false;
          bool                          apply_context_free = true;
          bool                          enforce_whiteblacklist = true;
+         bool                          detailed_traces = true; ///< false leaves console, ram deltas and elapsed out of the action traces
+         uint32_t                      console_bytes_left = 0; ///< console output the actions of the transaction may still add
+         bool                          console_truncated = false;
 
          fc::time_point                deadline = fc::time_point::maximum();
          fc::microseconds              leeway = fc::microseconds( config::default_subjective_cpu_leeway_us );
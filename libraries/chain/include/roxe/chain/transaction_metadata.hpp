@@ -4,8 +4,10 @@
  */
 #pragma once
 #include <roxe/chain/transaction.hpp>
+#include <roxe/chain/table_access_set.hpp>
 #include <roxe/chain/types.hpp>
 #include <boost/asio/io_context.hpp>
+#include <functional>
 #include <future>
 
 namespace boost { namespace asio {
@@ -15,6 +17,7 @@ namespace boost { namespace asio {
 namespace roxe { namespace chain {
 
 class transaction_metadata;
+struct key_recovery_callbacks;
 using transaction_metadata_ptr = std::shared_ptr<transaction_metadata>;
 using signing_keys_future_value_type = std::tuple<chain_id_type, fc::microseconds, flat_set<public_key_type>>;
 using signing_keys_future_type = std::shared_future<signing_keys_future_value_type>;
@@ -33,6 +36,10 @@ class transaction_metadata {
       bool                                                       accepted = false;
       bool                                                       implicit = false;
       bool                                                       scheduled = false;
+      bool                                                       dry_run = false; ///< executed and traced, then always rolled back and never added to a block
+      /// the tables its last successful execution read and wrote, only when controller::record_table_access_sets()
+      std::shared_ptr<const table_access_set>                    table_access;
+      uint64_t                                                   table_access_seq = 0; ///< see controller::table_access_stale
 
       transaction_metadata() = delete;
       transaction_metadata(const transaction_metadata&) = delete;
@@ -41,7 +48,8 @@ class transaction_metadata {
       transaction_metadata operator=(transaction_metadata&&) = delete;
 
       explicit transaction_metadata( const signed_transaction& t, packed_transaction::compression_type c = packed_transaction::none )
-      :id(t.id()), packed_trx(std::make_shared<packed_transaction>(t, c)) {
+      :packed_trx(std::make_shared<packed_transaction>(t, c)) {
+         id = packed_trx->id();
          //raw_packed = fc::raw::pack( static_cast<const transaction&>(trx) );
          signed_id = digest_type::hash(*packed_trx);
       }
@@ -52,13 +60,26 @@ class transaction_metadata {
          signed_id = digest_type::hash(*packed_trx);
       }
 
-      // must be called from main application thread
+      /**
+       * Must be called from main application thread.
+       *
+       * @param on_ready called once the returned future is ready, on the thread pool thread which completed the
+       *                 recovery, or right away on the calling thread if it already completed. It must not block,
+       *                 it usually posts the processing of the transaction to the application thread. The thread
+       *                 pool may recover the signatures of one transaction in several tasks, so a task posted to it
+       *                 must never wait on the future.
+       */
       static signing_keys_future_type
       start_recover_keys( const transaction_metadata_ptr& mtrx, boost::asio::io_context& thread_pool,
-                          const chain_id_type& chain_id, fc::microseconds time_limit );
+                          const chain_id_type& chain_id, fc::microseconds time_limit,
+                          std::function<void()> on_ready = std::function<void()>() );
 
       // start_recover_keys must be called first
       recovery_keys_type recover_keys( const chain_id_type& chain_id );
+
+   private:
+      /// the on_ready callbacks of the recovery started by start_recover_keys
+      std::shared_ptr<key_recovery_callbacks>                    key_recovery;
 };
 
 } } // roxe::chain
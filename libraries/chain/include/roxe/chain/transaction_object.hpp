@@ -32,17 +32,17 @@ namespace roxe { namespace chain {
 
         struct by_expiration;
         struct by_trx_id;
+        /**
+         * by_trx_id is hashed, nothing depends on the order of transaction ids. by_expiration orders by expiration
+         * alone, the transactions expiring within the same second form a bucket which the sweep at the start of a
+         * block removes as a whole.
+         */
         using transaction_multi_index = chainbase::shared_multi_index_container<
         transaction_object,
         indexed_by<
                 ordered_unique< tag<by_id>, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_object::id_type, id)>,
-        ordered_unique< tag<by_trx_id>, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_id_type, trx_id)>,
-        ordered_unique< tag<by_expiration>,
-        composite_key< transaction_object,
-                BOOST_MULTI_INDEX_MEMBER( transaction_object, time_point_sec, expiration ),
-                BOOST_MULTI_INDEX_MEMBER( transaction_object, transaction_object::id_type, id)
-        >
-        >
+                hashed_unique< tag<by_trx_id>, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_id_type, trx_id)>,
+                ordered_non_unique< tag<by_expiration>, BOOST_MULTI_INDEX_MEMBER(transaction_object, time_point_sec, expiration)>
         >
         >;
 
@@ -2,10 +2,16 @@
 #include <roxe/chain/code_object.hpp>
 #include <roxe/chain/types.hpp>
 #include <roxe/chain/whitelisted_intrinsics.hpp>
+#include <roxe/chain/genesis_intrinsics.hpp>
 #include <roxe/chain/exceptions.hpp>
+#include <roxe/chain/wasm_profiler.hpp>
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 
+namespace boost { namespace asio {
+   class io_context;
+}}
+
 namespace roxe { namespace chain {
 
    class apply_context;
@@ -39,6 +45,10 @@ namespace roxe { namespace chain {
          { try {
             bool fail = false;
 
+            // Almost every import is a genesis intrinsic; one probe of their perfect hash yields both the
+            // whitelist key and a slot for the cached resolution.
+            const int32_t genesis_index = mod_name == "env" ? find_genesis_intrinsic( export_name ) : -1;
+
             if( whitelisted_intrinsics != nullptr ) {
                // Protect access to "private" injected functions; so for now just simply allow "env" since injected
                // functions are in a different module.
@@ -47,12 +57,21 @@ namespace roxe { namespace chain {
                            ("module",mod_name)("export",export_name) );
 
                // Only consider imports that are in the whitelisted set of intrinsics
-               fail = !is_intrinsic_whitelisted( *whitelisted_intrinsics, export_name );
+               if( genesis_index >= 0 )
+                  fail = !is_intrinsic_whitelisted( *whitelisted_intrinsics,
+                                                    genesis_intrinsic_whitelist_hash( genesis_index ), export_name );
+               else
+                  fail = !is_intrinsic_whitelisted( *whitelisted_intrinsics, export_name );
             }
 
             // Try to resolve an intrinsic first.
-            if( !fail && Runtime::IntrinsicResolver::singleton.resolve( mod_name, export_name, type, out ) ) {
-               return true;
+            if( !fail ) {
+               if( genesis_index >= 0 && type.kind == IR::ObjectKind::function ) {
+                  if( resolve_genesis_intrinsic( genesis_index, mod_name, export_name, type, out ) )
+                     return true;
+               } else if( Runtime::IntrinsicResolver::singleton.resolve( mod_name, export_name, type, out ) ) {
+                  return true;
+               }
             }
 
             ROXE_THROW( wasm_exception, "${module}.${export} unresolveable",
@@ -61,6 +80,10 @@ namespace roxe { namespace chain {
          } FC_CAPTURE_AND_RETHROW( (mod_name)(export_name) ) }
 
       protected:
+         /// IntrinsicResolver lookup memoized per genesis intrinsic and (interned) function type
+         static bool resolve_genesis_intrinsic( uint32_t index, const string& mod_name, const string& export_name,
+                                                IR::ObjectType type, Runtime::ObjectInstance*& out );
+
          const whitelisted_intrinsics_type* whitelisted_intrinsics = nullptr;
       };
    } }
@@ -76,18 +99,33 @@ namespace roxe { namespace chain {
             wabt
          };
 
-         wasm_interface(vm_type vm, const chainbase::database& db);
+         struct instantiation_cache_stats {
+            uint32_t entries = 0;
+            uint32_t instantiated = 0;
+            uint64_t bytes = 0;       ///< estimated memory held by the instantiated modules
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;   ///< modules dropped to stay within the size limit
+         };
+
+         //max_cache_size bounds the estimated memory of the instantiated modules, 0 is unbounded
+         wasm_interface(vm_type vm, const chainbase::database& db, const fc::path& prepared_wasm_dir = fc::path(), uint64_t max_cache_size = 0);
          ~wasm_interface();
 
          //call before dtor to skip what can be minutes of dtor overhead with some runtimes; can cause leaks
          void indicate_shutting_down();
 
          //validates code -- does a WASM validation pass and checks the wasm against ROXE specific constraints
-         static void validate(const controller& control, const bytes& code);
+         //code which passed before against the same intrinsic whitelist is not validated again, see validated_code_cache
+         static void validate(const controller& control, const bytes& code, const digest_type& code_hash);
 
          //indicate that a particular code probably won't be used after given block_num
          void code_block_num_last_used(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, const uint32_t& block_num);
 
+         //starts preparing newly deployed code on the thread pool so the first action using it does not pay for it
+         void prepare_code_async(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, const bytes& code,
+                                 const uint32_t block_num, boost::asio::io_context& thread_pool);
+
          //indicate the current LIB. evicts old cache entries
          void current_lib(const uint32_t lib);
 
@@ -97,6 +135,11 @@ namespace roxe { namespace chain {
          //Immediately exits currently running wasm. UB is called when no wasm running
          void exit();
 
+         //execution time and intrinsic call aggregates per receiver and action, collected while enabled
+         wasm_profiler& get_profiler();
+
+         instantiation_cache_stats get_instantiation_cache_stats()const;
+
       private:
          unique_ptr<struct wasm_interface_impl> my;
          friend class roxe::chain::webassembly::common::intrinsics_accessor;
@@ -7,8 +7,12 @@
 #include <roxe/chain/wasm_roxe_injection.hpp>
 #include <roxe/chain/transaction_context.hpp>
 #include <roxe/chain/code_object.hpp>
+#include <roxe/chain/prepared_wasm_cache.hpp>
 #include <roxe/chain/exceptions.hpp>
+#include <roxe/chain/thread_utils.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/metrics.hpp>
+#include <mutex>
 
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
@@ -32,12 +36,26 @@ namespace roxe { namespace chain {
          std::unique_ptr<wasm_instantiated_module_interface>  module;
          uint8_t                                              vm_type = 0;
          uint8_t                                              vm_version = 0;
+         std::shared_future<prepared_wasm_cache::entry>       prepared; ///< valid while the code is prepared on the thread pool
+         bool                                                 discard_persisted = false;
+         size_t                                               instantiated_size = 0; ///< estimated memory held by module
+         uint64_t                                             reinstantiate_us = 0;  ///< what bringing module back after an eviction costs
+         mutable double                                       retain_priority = 0;   ///< not indexed, the entry with the lowest is evicted first
       };
       struct by_hash;
       struct by_first_block_num;
       struct by_last_block_num;
 
-      wasm_interface_impl(wasm_interface::vm_type vm, const chainbase::database& d) : db(d) {
+      wasm_interface_impl(wasm_interface::vm_type vm, const chainbase::database& d, const fc::path& prepared_wasm_dir, uint64_t max_cache_size)
+      : max_cache_bytes(max_cache_size), db(d), prepared_cache(prepared_wasm_dir),
+        hits_counter( fc::metrics::registry::instance().add_counter( "roxe_wasm_instantiation_cache_hits_total",
+                      "Contract executions which found their module instantiated" ) ),
+        misses_counter( fc::metrics::registry::instance().add_counter( "roxe_wasm_instantiation_cache_misses_total",
+                        "Contract executions which had to instantiate their module" ) ),
+        evictions_counter( fc::metrics::registry::instance().add_counter( "roxe_wasm_instantiation_cache_evictions_total",
+                           "Instantiated modules dropped to stay within wasm-instantiation-cache-size-mb" ) ),
+        bytes_gauge( fc::metrics::registry::instance().add_gauge( "roxe_wasm_instantiation_cache_bytes",
+                     "Estimated memory held by instantiated modules" ) ) {
          if(vm == wasm_interface::vm_type::wavm)
             runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
          else if(vm == wasm_interface::vm_type::wabt)
@@ -47,6 +65,7 @@ namespace roxe { namespace chain {
       }
 
       ~wasm_interface_impl() {
+         bytes_gauge.add(-int64_t(cache_bytes));
          if(is_shutting_down)
             for(wasm_cache_index::iterator it = wasm_instantiation_cache.begin(); it != wasm_instantiation_cache.end(); ++it)
                wasm_instantiation_cache.modify(it, [](wasm_cache_entry& e) {
@@ -54,7 +73,7 @@ namespace roxe { namespace chain {
                });
       }
 
-      std::vector<uint8_t> parse_initial_memory(const Module& module) {
+      static std::vector<uint8_t> parse_initial_memory(const Module& module) {
          std::vector<uint8_t> mem_image;
 
          for(const DataSegment& data_segment : module.dataSegments) {
@@ -77,12 +96,149 @@ namespace roxe { namespace chain {
          if(it != wasm_instantiation_cache.end())
             wasm_instantiation_cache.modify(it, [block_num](wasm_cache_entry& e) {
                e.last_block_num_used = block_num;
+               e.discard_persisted = true;
             });
+         else if(prepared_cache.enabled())
+            //keep a placeholder so the persisted entry is discarded once the removal becomes irreversible
+            wasm_instantiation_cache.emplace( wasm_interface_impl::wasm_cache_entry{
+                                                 .code_hash = code_hash,
+                                                 .first_block_num_used = block_num,
+                                                 .last_block_num_used = block_num,
+                                                 .module = nullptr,
+                                                 .vm_type = vm_type,
+                                                 .vm_version = vm_version,
+                                                 .prepared = {},
+                                                 .discard_persisted = true
+                                              } );
       }
 
       void current_lib(uint32_t lib) {
          //anything last used before or on the LIB can be evicted
-         wasm_instantiation_cache.get<by_last_block_num>().erase(wasm_instantiation_cache.get<by_last_block_num>().begin(), wasm_instantiation_cache.get<by_last_block_num>().upper_bound(lib));
+         auto& idx = wasm_instantiation_cache.get<by_last_block_num>();
+         auto end = idx.upper_bound(lib);
+         for(auto it = idx.begin(); it != end; ++it) {
+            if(prepared_cache.enabled() && it->discard_persisted)
+               prepared_cache.erase(it->code_hash, it->vm_type, it->vm_version);
+            cache_bytes -= it->instantiated_size;
+            bytes_gauge.add(-int64_t(it->instantiated_size));
+         }
+         idx.erase(idx.begin(), end);
+      }
+
+      /**
+       * Drops instantiated modules, other than keep, until needed more bytes fit into max_cache_bytes. The entries stay,
+       * so the LIB bookkeeping is unchanged, and their next use instantiates the module again, from the persisted code
+       * when the code cache is enabled.
+       *
+       * The module with the lowest retain_priority goes first. Following GreedyDual-Size, an entry's priority is what
+       * instantiating it again costs per byte it holds, on top of the priority of the last evicted entry at the time it
+       * was last used; so cheap and large modules go before expensive and small ones, and of two alike the one unused
+       * for longer goes first.
+       *
+       * Only called while no contract runs, apply instantiates the module before running it.
+       */
+      void evict_for(size_t needed, const wasm_cache_entry& keep) {
+         if(!max_cache_bytes)
+            return;
+         while(cache_bytes + needed > max_cache_bytes) {
+            auto victim = wasm_instantiation_cache.end();
+            for(auto it = wasm_instantiation_cache.begin(); it != wasm_instantiation_cache.end(); ++it)
+               if(it->module && &*it != &keep && (victim == wasm_instantiation_cache.end() || it->retain_priority < victim->retain_priority))
+                  victim = it;
+            if(victim == wasm_instantiation_cache.end())
+               return;
+            evicted_priority = victim->retain_priority;
+            cache_bytes -= victim->instantiated_size;
+            bytes_gauge.add(-int64_t(victim->instantiated_size));
+            wasm_instantiation_cache.modify(victim, [](wasm_cache_entry& e) {
+               e.module.reset();
+               e.instantiated_size = 0;
+            });
+            ++evictions;
+            evictions_counter.inc();
+         }
+      }
+
+      void touch(const wasm_cache_entry& e) {
+         e.retain_priority = evicted_priority + double(e.reinstantiate_us) / std::max<size_t>(e.instantiated_size, 1);
+      }
+
+      //the runtimes keep the module's IR and compiled code, a few times the size of the prepared wasm, next to the initial memory
+      static constexpr size_t instantiated_code_factor = 4;
+
+      //injection keeps its bookkeeping in static state, so only one preparation may run at a time
+      static std::mutex& prepare_mutex() {
+         static std::mutex m;
+         return m;
+      }
+
+      static prepared_wasm_cache::entry prepare_code(const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version, const char* code, size_t code_size) {
+         std::lock_guard<std::mutex> g(prepare_mutex());
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code, code_size);
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         wasm_injections::wasm_binary_injection injector(module);
+         injector.inject();
+
+         prepared_wasm_cache::entry result;
+         result.code_hash = code_hash;
+         result.vm_type = vm_type;
+         result.vm_version = vm_version;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            result.code = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+         result.initial_memory = parse_initial_memory(module);
+         return result;
+      }
+
+      void prepare_code_async(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version,
+                              const bytes& code, uint32_t block_num, boost::asio::io_context& thread_pool) {
+         wasm_cache_index::iterator it = wasm_instantiation_cache.find(boost::make_tuple(code_hash, vm_type, vm_version));
+         if(it != wasm_instantiation_cache.end() && (it->module || it->prepared.valid()))
+            return;
+
+         auto c = std::make_shared<bytes>(code);
+         std::shared_future<prepared_wasm_cache::entry> f =
+               async_thread_pool(thread_pool, [c, code_hash, vm_type, vm_version, cache = prepared_cache]() mutable {
+                  prepared_wasm_cache::entry e;
+                  if(!cache.get(code_hash, vm_type, vm_version, e)) {
+                     e = prepare_code(code_hash, vm_type, vm_version, c->data(), c->size());
+                     cache.set(e);
+                  }
+                  return e;
+               });
+
+         //until the code is actually used the entry is evictable, e.g. when the setcode never makes it into a block
+         if(it == wasm_instantiation_cache.end())
+            wasm_instantiation_cache.emplace( wasm_interface_impl::wasm_cache_entry{
+                                                 .code_hash = code_hash,
+                                                 .first_block_num_used = block_num,
+                                                 .last_block_num_used = block_num,
+                                                 .module = nullptr,
+                                                 .vm_type = vm_type,
+                                                 .vm_version = vm_version,
+                                                 .prepared = std::move(f)
+                                              } );
+         else
+            wasm_instantiation_cache.modify(it, [&](wasm_cache_entry& e) {
+               e.prepared = std::move(f);
+               e.last_block_num_used = block_num;
+               e.discard_persisted = false;
+            });
       }
 
       const std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_hash, const uint8_t& vm_type,
@@ -104,7 +260,13 @@ namespace roxe { namespace chain {
                                                    } ).first;
          }
 
-         if(!it->module) {
+         if(it->module) {
+            ++hits;
+            hits_counter.inc();
+            touch(*it);
+         } else {
+            ++misses;
+            misses_counter.inc();
             if(!codeobject)
                codeobject = &db.get<code_object,by_code_hash>(boost::make_tuple(code_hash, vm_type, vm_version));
 
@@ -112,34 +274,49 @@ namespace roxe { namespace chain {
                trx_context.resume_billing_timer();
             });
             trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)codeobject->code.data(), codeobject->code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
 
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
-
-            std::vector<U8> bytes;
-            try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               ROXE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+            //the cost of instantiating again, code prepared on the thread pool only counts once it was evicted and is
+            //brought back; preparing it inline does not count when it is persisted, next time it is read from disk
+            const auto start = fc::time_point::now();
+            fc::microseconds not_repeated;
+            prepared_wasm_cache::entry prepared;
+            bool have_prepared = false;
+            if(it->prepared.valid()) {
+               try {
+                  //wait for the thread pool if it has not finished yet
+                  prepared = it->prepared.get();
+                  have_prepared = true;
+               } catch(const fc::exception& e) {
+                  wlog("background preparation of ${h} failed, preparing inline: ${e}", ("h", code_hash)("e", e.to_detail_string()));
+               } catch(const std::exception& e) {
+                  wlog("background preparation of ${h} failed, preparing inline: ${e}", ("h", code_hash)("e", e.what()));
+               }
+            }
+            if(have_prepared) {
+               not_repeated = fc::time_point::now() - start;
+            } else if(!prepared_cache.get(code_hash, vm_type, vm_version, prepared)) {
+               const auto prepare_start = fc::time_point::now();
+               prepared = prepare_code(code_hash, vm_type, vm_version, codeobject->code.data(), codeobject->code.size());
+               prepared_cache.set(prepared);
+               if(prepared_cache.enabled())
+                  not_repeated = fc::time_point::now() - prepare_start;
             }
 
+            const size_t size = prepared.code.size() * instantiated_code_factor + prepared.initial_memory.size();
+            evict_for(size, *it);
+
             wasm_instantiation_cache.modify(it, [&](auto& c) {
-               c.module = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module));
+               c.prepared = {};
+               c.first_block_num_used = codeobject->first_block_used;
+               c.last_block_num_used = UINT32_MAX;
+               c.discard_persisted = false;
+               c.module = runtime_interface->instantiate_module((const char*)prepared.code.data(), prepared.code.size(), std::move(prepared.initial_memory));
+               c.instantiated_size = size;
+               c.reinstantiate_us = std::max<int64_t>((fc::time_point::now() - start - not_repeated).count(), 1);
             });
+            cache_bytes += size;
+            bytes_gauge.add(size);
+            touch(*it);
          }
          return it->module;
       }
@@ -163,7 +340,21 @@ namespace roxe { namespace chain {
       > wasm_cache_index;
       wasm_cache_index wasm_instantiation_cache;
 
+      const uint64_t             max_cache_bytes; ///< 0 is unbounded
+      size_t                     cache_bytes = 0;
+      double                     evicted_priority = 0;
+      uint64_t                   hits = 0;
+      uint64_t                   misses = 0;
+      uint64_t                   evictions = 0;
+
       const chainbase::database& db;
+      prepared_wasm_cache        prepared_cache;
+      wasm_profiler              profiler;
+
+      fc::metrics::counter&      hits_counter;
+      fc::metrics::counter&      misses_counter;
+      fc::metrics::counter&      evictions_counter;
+      fc::metrics::gauge&        bytes_gauge;
    };
 
 #define _REGISTER_INTRINSIC_EXPLICIT(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
@@ -0,0 +1,142 @@
+#pragma once
+#include <roxe/chain/types.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace roxe { namespace chain {
+
+   /**
+    * @class wasm_profiler
+    * @brief opt-in aggregation of contract execution cost per (receiver, action)
+    *
+    * For every contract apply the wall clock time spent in the contract and the number of calls made to each
+    * intrinsic are accumulated. Intrinsic wrappers report their calls through count_intrinsic(), which is a
+    * single thread local test when no profiled action is running. Profiling only observes execution; it has
+    * no effect on consensus.
+    *
+    * Sampling is a separate mode cheap enough to leave on. A sampler thread raises a flag every interval, which
+    * contract code notices at its next checktime, the call injected into every loop and function call and made
+    * by every intrinsic. The runtime then reports the contract function executing there through take_sample()
+    * and the sample is added to the folded stack "receiver;action;function" of the contract's code.
+    */
+   class wasm_profiler {
+      public:
+         struct action_stats {
+            account_name                receiver;
+            action_name                 action;
+            uint64_t                    executions = 0;
+            uint64_t                    total_us = 0;
+            uint64_t                    max_us = 0;
+            std::map<string, uint64_t>  intrinsic_calls;
+         };
+
+         struct contract_samples {
+            account_name                          receiver;
+            digest_type                           code_hash;
+            uint64_t                              samples = 0;
+            vector<std::pair<string, uint64_t>>   stacks;    ///< folded stacks with their sample counts, most sampled first
+         };
+
+         /// marks one contract apply as the target of samples while in scope, does nothing for a null profiler
+         class scoped_sampling {
+            public:
+               scoped_sampling( wasm_profiler* profiler, account_name receiver, action_name action, const digest_type& code_hash );
+               ~scoped_sampling();
+
+               scoped_sampling( const scoped_sampling& ) = delete;
+               scoped_sampling& operator=( const scoped_sampling& ) = delete;
+
+            private:
+               friend class wasm_profiler;
+
+               wasm_profiler*          profiler;
+               account_name            receiver;
+               action_name             action;
+               digest_type             code_hash;
+               scoped_sampling*        previous = nullptr;
+         };
+
+         /// records execution of one contract apply while in scope, does nothing for a null profiler
+         class scoped_action {
+            public:
+               scoped_action( wasm_profiler* profiler, account_name receiver, action_name action );
+               ~scoped_action();
+
+               scoped_action( const scoped_action& ) = delete;
+               scoped_action& operator=( const scoped_action& ) = delete;
+
+            private:
+               wasm_profiler*          profiler;
+               account_name            receiver;
+               action_name             action;
+               fc::time_point          start;
+               vector<uint64_t>        counts;
+               vector<uint64_t>*       previous_counts = nullptr;
+         };
+
+         /// assigns the id an intrinsic reports its calls with; registering the same name twice returns the same id
+         static uint32_t register_intrinsic( const char* name );
+
+         static void count_intrinsic( uint32_t id ) {
+            if( current_counts ) {
+               if( id >= current_counts->size() ) current_counts->resize( id + 1 );
+               ++(*current_counts)[id];
+            }
+         }
+
+         ~wasm_profiler();
+
+         void enable( bool e ) { enabled_ = e; }
+         bool enabled()const { return enabled_; }
+
+         /// starts sampling the running contract function every interval_us, 0 stops it
+         void enable_sampling( uint32_t interval_us );
+         uint32_t sampling_interval_us()const { return sample_interval_us; }
+         bool sampling()const { return sample_interval_us != 0; }
+
+         /// the flag checked at each checktime, a single relaxed load while no sample is due
+         static bool sample_due() { return sample_requested.load( std::memory_order_relaxed ); }
+
+         /**
+          * Counts a sample of the contract apply in scope on this thread and lowers the flag.
+          * @param function the index of the function among the module's function definitions, or -1 when the
+          *                 runtime cannot tell which function runs
+          * @param name the function's name from the name section, if any
+          */
+         static void take_sample( int64_t function, const string& name );
+
+         /// @return the samples of each contract code, most sampled first
+         vector<contract_samples> get_samples()const;
+         void clear_samples();
+
+         /// @return the aggregates ordered by total time, most expensive first
+         vector<action_stats> get_stats()const;
+         void clear();
+
+      private:
+         void record( account_name receiver, action_name action, fc::microseconds elapsed, const vector<uint64_t>& counts );
+
+         void run_sampler();
+
+         static thread_local vector<uint64_t>* current_counts;
+         static thread_local scoped_sampling*  current_sampling;
+         static std::atomic<bool>              sample_requested;
+
+         bool                                                      enabled_ = false;
+         mutable std::mutex                                        mtx;
+         std::map<std::pair<account_name, action_name>, action_stats> stats;
+
+         uint32_t                                                  sample_interval_us = 0;
+         std::thread                                               sampler;
+         std::mutex                                                sampler_mtx;
+         std::condition_variable                                   sampler_cv;
+         bool                                                      sampler_stop = false;
+         std::map<std::pair<account_name, digest_type>, std::map<string, uint64_t>> samples;  ///< guarded by mtx
+   };
+
+} } // roxe::chain
+
+FC_REFLECT( roxe::chain::wasm_profiler::action_stats, (receiver)(action)(executions)(total_us)(max_us)(intrinsic_calls) )
+FC_REFLECT( roxe::chain::wasm_profiler::contract_samples, (receiver)(code_hash)(samples)(stacks) )
@@ -4,6 +4,7 @@
 #include <roxe/chain/webassembly/runtime_interface.hpp>
 #include <roxe/chain/exceptions.hpp>
 #include <roxe/chain/apply_context.hpp>
+#include <roxe/chain/wasm_profiler.hpp>
 #include <softfloat_types.h>
 
 //wabt includes
@@ -653,15 +654,17 @@ template<typename Ret, typename MethodSig, typename Cls, typename... Params>
 struct intrinsic_function_invoker {
    using impl = intrinsic_invoker_impl<Ret, std::tuple<Params...>>;
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static Ret wrapper(wabt_apply_instance_vars& vars, Params... params, const TypedValues&, int) {
+      wasm_profiler::count_intrinsic(*ProfileId);
+      if( wasm_profiler::sample_due() ) wasm_profiler::take_sample( -1, {} ); // the interpreter's frames aren't native ones
       class_from_wasm<Cls>::value(vars.ctx).checktime();
       return (class_from_wasm<Cls>::value(vars.ctx).*Method)(params...);
    }
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static const intrinsic_registrator::intrinsic_fn fn() {
-      return impl::template fn<wrapper<Method>>();
+      return impl::template fn<wrapper<Method, ProfileId>>();
    }
 };
 
@@ -669,16 +672,18 @@ template<typename MethodSig, typename Cls, typename... Params>
 struct intrinsic_function_invoker<void, MethodSig, Cls, Params...> {
    using impl = intrinsic_invoker_impl<void_type, std::tuple<Params...>>;
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static void_type wrapper(wabt_apply_instance_vars& vars, Params... params, const TypedValues& args, int offset) {
+      wasm_profiler::count_intrinsic(*ProfileId);
+      if( wasm_profiler::sample_due() ) wasm_profiler::take_sample( -1, {} ); // the interpreter's frames aren't native ones
       class_from_wasm<Cls>::value(vars.ctx).checktime();
       (class_from_wasm<Cls>::value(vars.ctx).*Method)(params...);
       return void_type();
    }
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static const intrinsic_registrator::intrinsic_fn fn() {
-      return impl::template fn<wrapper<Method>>();
+      return impl::template fn<wrapper<Method, ProfileId>>();
    }
 
 };
@@ -710,11 +715,15 @@ struct intrinsic_function_invoker_wrapper<Ret (Cls::*)(Params...) const volatile
 #define _INTRINSIC_NAME(LABEL, SUFFIX) __INTRINSIC_NAME(LABEL,SUFFIX)
 
 #define _REGISTER_WABT_INTRINSIC(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
-   static roxe::chain::webassembly::wabt_runtime::intrinsic_registrator _INTRINSIC_NAME(__wabt_intrinsic_fn, __COUNTER__) (\
+   __REGISTER_WABT_INTRINSIC(__COUNTER__, CLS, MOD, METHOD, WASM_SIG, NAME, SIG)
+
+#define __REGISTER_WABT_INTRINSIC(ID, CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
+   static const uint32_t _INTRINSIC_NAME(__wabt_intrinsic_profile_id, ID) = roxe::chain::wasm_profiler::register_intrinsic(MOD "." NAME);\
+   static roxe::chain::webassembly::wabt_runtime::intrinsic_registrator _INTRINSIC_NAME(__wabt_intrinsic_fn, ID) (\
       MOD,\
       NAME,\
       roxe::chain::webassembly::wabt_runtime::wabt_function_type_provider<WASM_SIG>::type(),\
-      roxe::chain::webassembly::wabt_runtime::intrinsic_function_invoker_wrapper<SIG>::type::fn<&CLS::METHOD>()\
+      roxe::chain::webassembly::wabt_runtime::intrinsic_function_invoker_wrapper<SIG>::type::fn<&CLS::METHOD, &_INTRINSIC_NAME(__wabt_intrinsic_profile_id, ID)>()\
    );\
 
 } } } }// roxe::chain::webassembly::wabt_runtime
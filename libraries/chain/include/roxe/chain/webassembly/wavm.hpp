@@ -4,6 +4,7 @@
 #include <roxe/chain/exceptions.hpp>
 #include <roxe/chain/webassembly/runtime_interface.hpp>
 #include <roxe/chain/apply_context.hpp>
+#include <roxe/chain/wasm_profiler.hpp>
 #include <softfloat.hpp>
 #include "Runtime/Runtime.h"
 #include "IR/Types.h"
@@ -32,6 +33,9 @@ struct running_instance_context {
 };
 extern running_instance_context the_running_instance_context;
 
+/// reports the JITed contract function that called the current intrinsic to wasm_profiler::take_sample()
+void sample_running_function();
+
 /**
  * class to represent an in-wasm-memory array
  * it is a hint to the transcriber that the next parameter will
@@ -640,15 +644,17 @@ template<typename WasmSig, typename Ret, typename MethodSig, typename Cls, typen
 struct intrinsic_function_invoker {
    using impl = intrinsic_invoker_impl<Ret, std::tuple<Params...>, std::tuple<>>;
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static Ret wrapper(running_instance_context& ctx, Params... params) {
+      wasm_profiler::count_intrinsic(*ProfileId);
+      if( wasm_profiler::sample_due() ) sample_running_function();
       class_from_wasm<Cls>::value(*ctx.apply_ctx).checktime();
       return (class_from_wasm<Cls>::value(*ctx.apply_ctx).*Method)(params...);
    }
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static const WasmSig *fn() {
-      auto fn = impl::template fn<wrapper<Method>>();
+      auto fn = impl::template fn<wrapper<Method, ProfileId>>();
       static_assert(std::is_same<WasmSig *, decltype(fn)>::value,
                     "Intrinsic function signature does not match the ABI");
       return fn;
@@ -659,16 +665,18 @@ template<typename WasmSig, typename MethodSig, typename Cls, typename... Params>
 struct intrinsic_function_invoker<WasmSig, void, MethodSig, Cls, Params...> {
    using impl = intrinsic_invoker_impl<void_type, std::tuple<Params...>, std::tuple<>>;
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static void_type wrapper(running_instance_context& ctx, Params... params) {
+      wasm_profiler::count_intrinsic(*ProfileId);
+      if( wasm_profiler::sample_due() ) sample_running_function();
       class_from_wasm<Cls>::value(*ctx.apply_ctx).checktime();
       (class_from_wasm<Cls>::value(*ctx.apply_ctx).*Method)(params...);
       return void_type();
    }
 
-   template<MethodSig Method>
+   template<MethodSig Method, const uint32_t* ProfileId>
    static const WasmSig *fn() {
-      auto fn = impl::template fn<wrapper<Method>>();
+      auto fn = impl::template fn<wrapper<Method, ProfileId>>();
       static_assert(std::is_same<WasmSig *, decltype(fn)>::value,
                     "Intrinsic function signature does not match the ABI");
       return fn;
@@ -708,10 +716,14 @@ struct intrinsic_function_invoker_wrapper<WasmSig, Ret (Cls::*)(Params...) const
 #define _INTRINSIC_NAME(LABEL, SUFFIX) __INTRINSIC_NAME(LABEL,SUFFIX)
 
 #define _REGISTER_WAVM_INTRINSIC(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
-   static Intrinsics::Function _INTRINSIC_NAME(__intrinsic_fn, __COUNTER__) (\
+   __REGISTER_WAVM_INTRINSIC(__COUNTER__, CLS, MOD, METHOD, WASM_SIG, NAME, SIG)
+
+#define __REGISTER_WAVM_INTRINSIC(ID, CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
+   static const uint32_t _INTRINSIC_NAME(__intrinsic_profile_id, ID) = roxe::chain::wasm_profiler::register_intrinsic(MOD "." NAME);\
+   static Intrinsics::Function _INTRINSIC_NAME(__intrinsic_fn, ID) (\
       MOD "." NAME,\
       roxe::chain::webassembly::wavm::wasm_function_type_provider<WASM_SIG>::type(),\
-      (void *)roxe::chain::webassembly::wavm::intrinsic_function_invoker_wrapper<WASM_SIG, SIG>::type::fn<&CLS::METHOD>()\
+      (void *)roxe::chain::webassembly::wavm::intrinsic_function_invoker_wrapper<WASM_SIG, SIG>::type::fn<&CLS::METHOD, &_INTRINSIC_NAME(__intrinsic_profile_id, ID)>()\
    );\
 
 
@@ -7,6 +7,8 @@
 
 #include <roxe/chain/types.hpp>
 
+#include <string_view>
+
 namespace roxe { namespace chain {
 
    using whitelisted_intrinsics_type = shared_flat_multimap<uint64_t, shared_string>;
@@ -15,6 +17,9 @@ namespace roxe { namespace chain {
 
    bool is_intrinsic_whitelisted( const whitelisted_intrinsics_type& whitelisted_intrinsics, const std::string& name );
 
+   /// as above with the whitelist key @p h of @p name already known, e.g. from genesis_intrinsic_whitelist_hash()
+   bool is_intrinsic_whitelisted( const whitelisted_intrinsics_type& whitelisted_intrinsics, uint64_t h, std::string_view name );
+
    void add_intrinsic_to_whitelist( whitelisted_intrinsics_type& whitelisted_intrinsics, const std::string& name );
 
    void remove_intrinsic_from_whitelist( whitelisted_intrinsics_type& whitelisted_intrinsics, const std::string& name );
@@ -0,0 +1,85 @@
+#include <roxe/chain/key_account_index.hpp>
+#include <roxe/chain/permission_object.hpp>
+#include <roxe/chain/exceptions.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fstream>
+
+namespace roxe { namespace chain {
+
+   void key_account_index::build( const chainbase::database& db ) {
+      std::set<entry> result;
+      for( const auto& p : db.get_index<permission_index, by_owner>() ) {
+         for( const auto& k : p.auth.keys )
+            result.insert( entry{ k.key, p.owner, p.name } );
+      }
+      std::lock_guard<std::mutex> g( mtx );
+      entries = std::move( result );
+   }
+
+   void key_account_index::update( const chainbase::database& db, account_name account ) {
+      const auto& idx = db.get_index<permission_index, by_owner>();
+      std::lock_guard<std::mutex> g( mtx );
+      for( auto itr = idx.lower_bound( boost::make_tuple( account ) ); itr != idx.end() && itr->owner == account; ++itr ) {
+         for( const auto& k : itr->auth.keys )
+            entries.insert( entry{ k.key, itr->owner, itr->name } );
+      }
+   }
+
+   bool key_account_index::holds( const chainbase::database& db, const entry& e ) {
+      const auto* p = db.find<permission_object, by_owner>( boost::make_tuple( e.account, e.permission ) );
+      return p && std::any_of( p->auth.keys.begin(), p->auth.keys.end(), [&e]( const key_weight& k ) { return k.key == e.key; } );
+   }
+
+   vector<account_name> key_account_index::lookup( const chainbase::database& db, const public_key_type& key )const {
+      vector<account_name> result;
+      std::lock_guard<std::mutex> g( mtx );
+      for( auto itr = entries.lower_bound( entry{ key, account_name(), permission_name() } ); itr != entries.end() && itr->key == key; ++itr ) {
+         if( (result.empty() || result.back() != itr->account) && holds( db, *itr ) )
+            result.push_back( itr->account );
+      }
+      return result;
+   }
+
+   void key_account_index::save( const fc::path& p, const chainbase::database& db, const block_id_type& head_id )const {
+      vector<entry> valid;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         valid.reserve( entries.size() );
+         for( const auto& e : entries ) {
+            if( holds( db, e ) )
+               valid.push_back( e );
+         }
+      }
+      const auto tmp = p.generic_string() + ".tmp";
+      {
+         std::ofstream out( tmp, std::ios::binary | std::ios::trunc );
+         ROXE_ASSERT( out.good(), chain_exception, "unable to open ${f}", ("f", tmp) );
+         auto data = fc::raw::pack( std::make_pair( head_id, valid ) );
+         out.write( data.data(), data.size() );
+         ROXE_ASSERT( out.good(), chain_exception, "unable to write ${f}", ("f", tmp) );
+      }
+      fc::rename( tmp, p );
+   }
+
+   bool key_account_index::load( const fc::path& p, const block_id_type& head_id ) {
+      if( !fc::exists( p ) )
+         return false;
+      std::ifstream in( p.generic_string(), std::ios::binary );
+      vector<char> data( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+      std::pair<block_id_type, vector<entry>> saved;
+      fc::datastream<const char*> ds( data.data(), data.size() );
+      fc::raw::unpack( ds, saved );
+      if( saved.first != head_id )
+         return false;
+      std::lock_guard<std::mutex> g( mtx );
+      entries = std::set<entry>( saved.second.begin(), saved.second.end() );
+      return true;
+   }
+
+   size_t key_account_index::size()const {
+      std::lock_guard<std::mutex> g( mtx );
+      return entries.size();
+   }
+
+} } // roxe::chain
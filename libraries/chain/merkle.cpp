@@ -1,4 +1,5 @@
 #include <roxe/chain/merkle.hpp>
+#include <roxe/chain/thread_utils.hpp>
 #include <fc/io/raw.hpp>
 
 namespace roxe { namespace chain {
@@ -32,21 +33,80 @@ bool is_canonical_right(const digest_type& val) {
 }
 
 
-digest_type merkle(vector<digest_type> ids) {
-   if( 0 == ids.size() ) { return digest_type(); }
+namespace {
 
-   while( ids.size() > 1 ) {
-      if( ids.size() % 2 )
-         ids.push_back(ids.back());
+   // a packed canonical pair is the two digests back to back, so each pair is hashed straight out of the level
+   static_assert( sizeof(digest_type) == 32, "digests are expected to be stored without padding" );
 
-      for (size_t i = 0; i < ids.size() / 2; i++) {
-         ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+   /// hashes the pairs [begin, end) of level into next
+   void hash_pairs( digest_type* level, size_t begin, size_t end, digest_type* next ) {
+      const size_t count = end - begin;
+      vector<const char*> pairs( count );
+      vector<uint32_t>    sizes( count, 2 * sizeof(digest_type) );
+      for( size_t i = 0; i < count; ++i ) {
+         digest_type* pair = level + 2 * (begin + i);
+         pair[0] = make_canonical_left( pair[0] );
+         pair[1] = make_canonical_right( pair[1] );
+         pairs[i] = pair[0].data();
       }
+      digest_type::hash_many( pairs.data(), sizes.data(), count, next + begin );
+   }
+
+   template<typename HashLevel>
+   digest_type reduce( vector<digest_type>& ids, HashLevel&& hash_level ) {
+      if( 0 == ids.size() ) { return digest_type(); }
+
+      vector<digest_type> next;
+      next.reserve( (ids.size() + 1) / 2 );
+      while( ids.size() > 1 ) {
+         if( ids.size() % 2 )
+            ids.push_back(ids.back());
 
-      ids.resize(ids.size() / 2);
+         next.resize( ids.size() / 2 );
+         hash_level( ids.data(), next.size(), next.data() );
+         ids.swap( next );
+      }
+
+      return ids.front();
    }
 
-   return ids.front();
+}
+
+digest_type merkle(vector<digest_type> ids) {
+   return reduce( ids, []( digest_type* level, size_t count, digest_type* next ) {
+      hash_pairs( level, 0, count, next );
+   } );
+}
+
+digest_type merkle( vector<digest_type> ids, boost::asio::io_context& thread_pool, size_t thread_count ) {
+   return reduce( ids, [&]( digest_type* level, size_t count, digest_type* next ) {
+      if( count < parallel_merkle_threshold || thread_count < 1 ) {
+         hash_pairs( level, 0, count, next );
+         return;
+      }
+      // the calling thread takes a part as well
+      const size_t parts = thread_count + 1;
+      const size_t part_size = (count + parts - 1) / parts;
+      vector<std::future<void>> futures;
+      futures.reserve( parts - 1 );
+      size_t begin = 0;
+      for( ; begin + part_size < count; begin += part_size ) {
+         const size_t end = begin + part_size;
+         futures.emplace_back( async_thread_pool( thread_pool, [level, begin, end, next]() {
+            hash_pairs( level, begin, end, next );
+         } ) );
+      }
+      try {
+         hash_pairs( level, begin, count, next );
+      } catch( ... ) {
+         // the parts on the pool still use level and next
+         for( auto& f : futures )
+            f.wait();
+         throw;
+      }
+      for( auto& f : futures )
+         f.get();
+   } );
 }
 
 } } // roxe::chain
@@ -1,35 +1,53 @@
 #include <roxe/chain/name.hpp>
 #include <fc/variant.hpp>
-#include <boost/algorithm/string.hpp>
 #include <fc/exception/exception.hpp>
 #include <roxe/chain/exceptions.hpp>
 
 namespace roxe { namespace chain {
 
+   // A name is normalized when printing it yields the input again: only name
+   // characters, a 13th character that fits in 4 bits, and no trailing dots
+   static bool is_normalized_name( const char* str, size_t len ) {
+      for( size_t i = 0; i < len; ++i ) {
+         if( detail::name_chars.symbols[uint8_t(str[i])] & detail::name_char_table::invalid_name_char )
+            return false;
+      }
+      if( len == 13 && char_to_symbol(str[12]) > 0x0f )
+         return false;
+      return len == 0 || str[len - 1] != '.';
+   }
+
    void name::set( const char* str ) {
       const auto len = strnlen(str, 14);
       ROXE_ASSERT(len <= 13, name_type_exception, "Name is longer than 13 characters (${name}) ", ("name", string(str)));
       value = string_to_name(str);
-      ROXE_ASSERT(to_string() == string(str), name_type_exception,
+      ROXE_ASSERT(is_normalized_name(str, len), name_type_exception,
                  "Name not properly normalized (name: ${name}, normalized: ${normalized}) ",
                  ("name", string(str))("normalized", to_string()));
    }
 
    // keep in sync with name::to_string() in contract definition for name
-   name::operator string()const {
-     static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
-
-      string str(13,'.');
-
-      uint64_t tmp = value;
-      for( uint32_t i = 0; i <= 12; ++i ) {
-         char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
-         str[12-i] = c;
-         tmp >>= (i == 0 ? 4 : 5);
-      }
+   char* name::write_as_string( char* begin, char* end )const {
+      if( value == 0 )
+         return begin;
+
+      // the lowest non-zero symbol is the last character printed
+      size_t size = 13;
+      if( (value & 0x0f) == 0 )
+         size = 12 - __builtin_ctzll( value >> 4 ) / 5;
+      if( size_t(end - begin) < size )
+         return begin;
+
+      for( size_t i = 0; i < size && i < 12; ++i )
+         begin[i] = detail::name_charmap[(value >> (59 - 5 * i)) & 0x1f];
+      if( size == 13 )
+         begin[12] = detail::name_charmap[value & 0x0f];
+      return begin + size;
+   }
 
-      boost::algorithm::trim_right_if( str, []( char c ){ return c == '.'; } );
-      return str;
+   name::operator string()const {
+      char buffer[13];
+      return string( buffer, write_as_string( buffer, buffer + sizeof(buffer) ) );
    }
 
 } } /// roxe::chain
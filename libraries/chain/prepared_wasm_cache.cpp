@@ -0,0 +1,106 @@
+#include <roxe/chain/prepared_wasm_cache.hpp>
+#include <roxe/chain/exceptions.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+#include <fstream>
+
+namespace roxe { namespace chain {
+
+   const uint32_t prepared_wasm_cache::magic_number = 0x3C0DECAC;
+
+   /**
+    * History:
+    * Version 1: initial version; entry followed by the sha256 of the packed entry
+    */
+   const uint32_t prepared_wasm_cache::version = 1;
+
+   static void remove_quietly( const fc::path& p ) {
+      try {
+         fc::remove( p );
+      } FC_LOG_AND_DROP()
+   }
+
+   prepared_wasm_cache::prepared_wasm_cache( const fc::path& cache_dir )
+   :dir(cache_dir)
+   {
+      if( enabled() && !fc::is_directory( dir ) )
+         fc::create_directories( dir );
+   }
+
+   fc::path prepared_wasm_cache::entry_path( const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version )const {
+      return dir / (code_hash.str() + "-" + std::to_string(vm_type) + "-" + std::to_string(vm_version) + ".bin");
+   }
+
+   bool prepared_wasm_cache::get( const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version, entry& result )const {
+      if( !enabled() ) return false;
+
+      const auto p = entry_path( code_hash, vm_type, vm_version );
+      if( !fc::exists( p ) ) return false;
+
+      try {
+         string content;
+         fc::read_file_contents( p, content );
+
+         fc::datastream<const char*> ds( content.data(), content.size() );
+
+         uint32_t totem = 0;
+         fc::raw::unpack( ds, totem );
+         uint32_t v = 0;
+         fc::raw::unpack( ds, v );
+         if( totem != magic_number || v != version ) {
+            wlog( "discarding prepared wasm cache file '${f}' with unexpected header", ("f", p.generic_string()) );
+            remove_quietly( p );
+            return false;
+         }
+
+         const char* packed_begin = content.data() + ds.tellp();
+         fc::raw::unpack( ds, result );
+         const size_t packed_size = content.data() + ds.tellp() - packed_begin;
+
+         digest_type checksum;
+         fc::raw::unpack( ds, checksum );
+         if( checksum != digest_type::hash( packed_begin, packed_size ) ||
+             result.code_hash != code_hash || result.vm_type != vm_type || result.vm_version != vm_version ) {
+            wlog( "discarding corrupted prepared wasm cache file '${f}'", ("f", p.generic_string()) );
+            remove_quietly( p );
+            return false;
+         }
+         return true;
+      } catch( const fc::exception& e ) {
+         wlog( "discarding unreadable prepared wasm cache file '${f}': ${e}", ("f", p.generic_string())("e", e.to_detail_string()) );
+      }
+
+      remove_quietly( p );
+      return false;
+   }
+
+   void prepared_wasm_cache::set( const entry& e ) {
+      if( !enabled() ) return;
+
+      const auto p = entry_path( e.code_hash, e.vm_type, e.vm_version );
+      const auto tmp = fc::path( p.generic_string() + ".tmp" );
+      try {
+         const auto packed = fc::raw::pack( e );
+         {
+            std::ofstream out( tmp.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+            fc::raw::pack( out, magic_number );
+            fc::raw::pack( out, version );
+            out.write( packed.data(), packed.size() );
+            fc::raw::pack( out, digest_type::hash( packed.data(), packed.size() ) );
+            ROXE_ASSERT( out.good(), misc_exception, "failure writing '${f}'", ("f", tmp.generic_string()) );
+         }
+         // rename so a reader never observes a partially written entry
+         fc::rename( tmp, p );
+      } catch( const fc::exception& ex ) {
+         // the cache is only an optimization; failing to persist an entry must not affect execution
+         wlog( "unable to persist prepared wasm cache file '${f}': ${e}", ("f", p.generic_string())("e", ex.to_detail_string()) );
+      }
+   }
+
+   void prepared_wasm_cache::erase( const digest_type& code_hash, uint8_t vm_type, uint8_t vm_version ) {
+      if( !enabled() ) return;
+
+      remove_quietly( entry_path( code_hash, vm_type, vm_version ) );
+   }
+
+} } // roxe::chain
@@ -154,6 +154,18 @@ is not allowed to schedule a deferred transaction in which the RAM costs are pai
 unless that account authorized the action;
 but is allowed to execute database operations that increase RAM usage of an account other than the receiver as long as
 either the account authorized the action or the action's net effect on RAM usage for the account is to not increase it.
+*/
+            {}
+         } )
+         (  builtin_protocol_feature_t::batched_index_reads, builtin_protocol_feature_spec{
+            "BATCHED_INDEX_READS",
+            fc::variant("3486b30fbb3af90faa6a528e7cb189aef1f46d74dffa635540fcd907caab3eaf").as<digest_type>(),
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: BATCHED_INDEX_READS
+
+Adds the db_idx64_range and db_idx128_range intrinsics, which copy a range of a secondary index together with the
+primary keys and rows it refers to into contract memory in a single call.
 */
             {}
          } )
@@ -467,6 +479,8 @@ either the account authorized the action or the action's net effect on RAM usage
    :_protocol_feature_set( std::move(pfs) )
    {
       _builtin_protocol_features.resize( _protocol_feature_set._recognized_builtin_protocol_features.size() );
+      ROXE_ASSERT( _builtin_protocol_features.size() <= max_builtin_features, protocol_feature_exception,
+                  "more builtin protocol features than the activation bitset holds" );
    }
 
    void protocol_feature_manager::init( chainbase::database& db ) {
@@ -592,14 +606,15 @@ either the account authorized the action or the action's net effect on RAM usage
       return const_iterator{this, static_cast<std::size_t>(itr - begin)};
    }
 
-   bool protocol_feature_manager::is_builtin_activated( builtin_protocol_feature_t feature_codename,
-                                                        uint32_t current_block_num )const
-   {
-      uint32_t indx = static_cast<uint32_t>( feature_codename );
-
-      if( indx >= _builtin_protocol_features.size() ) return false;
-
-      return (_builtin_protocol_features[indx].activation_block_num <= current_block_num);
+   void protocol_feature_manager::refresh_active_builtins( uint32_t current_block_num )const {
+      uint64_t active = 0;
+      const auto n = std::min<size_t>( _builtin_protocol_features.size(), max_builtin_features );
+      for( size_t i = 0; i < n; ++i ) {
+         if( _builtin_protocol_features[i].activation_block_num <= current_block_num )
+            active |= uint64_t(1) << i;
+      }
+      _active_builtins = active;
+      _active_builtins_block_num = current_block_num;
    }
 
    void protocol_feature_manager::activate_feature( const digest_type& feature_digest,
@@ -648,6 +663,7 @@ either the account authorized the action or the action's net effect on RAM usage
       _builtin_protocol_features[indx].previous = _head_of_builtin_activation_list;
       _builtin_protocol_features[indx].activation_block_num = current_block_num;
       _head_of_builtin_activation_list = indx;
+      _active_builtins_block_num = builtin_protocol_feature_entry::not_active;
    }
 
    void protocol_feature_manager::popped_blocks_to( uint32_t block_num ) {
@@ -667,6 +683,8 @@ either the account authorized the action or the action's net effect on RAM usage
       {
          _activated_protocol_features.pop_back();
       }
+
+      _active_builtins_block_num = builtin_protocol_feature_entry::not_active;
    }
 
 } }  // roxe::chain
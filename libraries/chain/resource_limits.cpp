@@ -6,6 +6,8 @@
 #include <boost/tuple/tuple_io.hpp>
 #include <roxe/chain/database_utils.hpp>
 #include <algorithm>
+#include <deque>
+#include <unordered_map>
 
 namespace roxe { namespace chain { namespace resource_limits {
 
@@ -47,6 +49,111 @@ void resource_limits_state_object::update_virtual_net_limit( const resource_limi
    virtual_net_limit = update_elastic_limit(virtual_net_limit, average_block_net_usage.average(), cfg.net_limit_parameters);
 }
 
+struct resource_limits_manager::pending_usage : chainbase::undo_observer {
+   struct account_usage {
+      usage_accumulator net_usage;
+      usage_accumulator cpu_usage;
+   };
+
+   /// the values each account had before the first change made to it within an undo session
+   struct undo_frame {
+      int64_t                                                    revision;
+      std::unordered_map<account_name, optional<account_usage>>  old_values;
+   };
+
+   std::unordered_map<account_name, account_usage>  accounts;
+   std::deque<undo_frame>                           frames;
+
+   const account_usage* find( const account_name& a )const {
+      auto itr = accounts.find( a );
+      return itr != accounts.end() ? &itr->second : nullptr;
+   }
+
+   account_usage& modify( const resource_usage_object& usage ) {
+      auto itr = accounts.find( usage.owner );
+      if( !frames.empty() ) {
+         optional<account_usage> old;
+         if( itr != accounts.end() ) old = itr->second;
+         frames.back().old_values.emplace( usage.owner, std::move(old) );
+      }
+      if( itr == accounts.end() )
+         itr = accounts.emplace( usage.owner, account_usage{ usage.net_usage, usage.cpu_usage } ).first;
+      return itr->second;
+   }
+
+   void apply_to( resource_usage_object& usage )const {
+      if( const auto* pending = find( usage.owner ) ) {
+         usage.net_usage = pending->net_usage;
+         usage.cpu_usage = pending->cpu_usage;
+      }
+   }
+
+   void flush( chainbase::database& db ) {
+      for( const auto& [owner, pending] : accounts ) {
+         db.modify( db.get<resource_usage_object,by_owner>( owner ), [&]( auto& bu ) {
+            bu.net_usage = pending.net_usage;
+            bu.cpu_usage = pending.cpu_usage;
+         });
+      }
+      if( !frames.empty() ) {
+         // undoing the head session restores the rows to what they were before this flush, so it must
+         // restore the pending values that were already there when the session started
+         auto& head = frames.back().old_values;
+         for( const auto& [owner, pending] : accounts )
+            head.emplace( owner, pending );
+         for( auto itr = head.begin(); itr != head.end(); ) {
+            if( itr->second ) ++itr;
+            else              itr = head.erase( itr );
+         }
+      }
+      accounts.clear();
+   }
+
+   void on_start_undo_session( int64_t revision ) override {
+      frames.push_back( undo_frame{ revision, {} } );
+   }
+
+   void on_undo( int64_t revision ) override {
+      while( !frames.empty() && frames.back().revision > revision ) {
+         for( auto& [owner, old] : frames.back().old_values ) {
+            if( old ) accounts[owner] = *old;
+            else      accounts.erase( owner );
+         }
+         frames.pop_back();
+      }
+   }
+
+   void on_squash( int64_t revision ) override {
+      while( !frames.empty() && frames.back().revision > revision ) {
+         if( frames.size() < 2 || frames[frames.size() - 2].revision != revision ) {
+            // squashing into the undo floor makes the changes permanent
+            frames.pop_back();
+            break;
+         }
+         auto& prior = frames[frames.size() - 2];
+         for( auto& [owner, old] : frames.back().old_values )
+            prior.old_values.emplace( owner, std::move(old) ); // keeps the older value recorded by the prior session
+         frames.pop_back();
+      }
+   }
+
+   void on_commit( int64_t revision ) override {
+      while( !frames.empty() && frames.front().revision <= revision )
+         frames.pop_front();
+   }
+};
+
+resource_limits_manager::resource_limits_manager(chainbase::database& db)
+:_db(db)
+,_pending_usage(std::make_unique<pending_usage>())
+{
+   _db.add_undo_observer( *_pending_usage );
+}
+
+resource_limits_manager::~resource_limits_manager() {
+   _db.remove_undo_observer( *_pending_usage );
+}
+
 void resource_limits_manager::add_indices() {
    resource_index_set::add_indices(_db);
 }
@@ -69,6 +176,15 @@ void resource_limits_manager::add_to_snapshot( const snapshot_writer_ptr& snapsh
    resource_index_set::walk_indices([this, &snapshot]( auto utils ){
       snapshot->write_section<typename decltype(utils)::index_t::value_type>([this]( auto& section ){
          decltype(utils)::walk(_db, [this, &section]( const auto &row ) {
+            if constexpr( std::is_same_v<std::decay_t<decltype(row)>, resource_usage_object> ) {
+               // usage of a pending block that is not written yet
+               if( _pending_usage->find( row.owner ) ) {
+                  auto usage = row;
+                  _pending_usage->apply_to( usage );
+                  section.add_row(usage, _db);
+                  return;
+               }
+            }
             section.add_row(row, _db);
          });
       });
@@ -113,11 +229,9 @@ void resource_limits_manager::set_block_parameters(const elastic_limit_parameter
 void resource_limits_manager::update_account_usage(const flat_set<account_name>& accounts, uint32_t time_slot ) {
    const auto& config = _db.get<resource_limits_config_object>();
    for( const auto& a : accounts ) {
-      const auto& usage = _db.get<resource_usage_object,by_owner>( a );
-      _db.modify( usage, [&]( auto& bu ){
-          bu.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
-          bu.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
-      });
+      auto& bu = _pending_usage->modify( _db.get<resource_usage_object,by_owner>( a ) );
+      bu.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
+      bu.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
    }
 }
 
@@ -127,16 +241,14 @@ void resource_limits_manager::add_transaction_usage(const flat_set<account_name>
 
    for( const auto& a : accounts ) {
 
-      const auto& usage = _db.get<resource_usage_object,by_owner>( a );
       int64_t unused;
       int64_t net_weight;
       int64_t cpu_weight;
       get_account_limits( a, unused, net_weight, cpu_weight );
 
-      _db.modify( usage, [&]( auto& bu ){
-          bu.net_usage.add( net_usage, time_slot, config.account_net_usage_average_window );
-          bu.cpu_usage.add( cpu_usage, time_slot, config.account_cpu_usage_average_window );
-      });
+      auto& usage = _pending_usage->modify( _db.get<resource_usage_object,by_owner>( a ) );
+      usage.net_usage.add( net_usage, time_slot, config.account_net_usage_average_window );
+      usage.cpu_usage.add( cpu_usage, time_slot, config.account_cpu_usage_average_window );
 
       if( cpu_weight >= 0 && state.total_cpu_weight > 0 ) {
          uint128_t window_size = config.account_cpu_usage_average_window;
@@ -326,6 +438,8 @@ void resource_limits_manager::process_account_limit_updates() {
 }
 
 void resource_limits_manager::process_block_usage(uint32_t block_num) {
+   _pending_usage->flush( _db );
+
    const auto& s = _db.get<resource_limits_state_object>();
    const auto& config = _db.get<resource_limits_config_object>();
    _db.modify(s, [&](resource_limits_state_object& state){
@@ -373,7 +487,9 @@ std::pair<int64_t, bool> resource_limits_manager::get_account_cpu_limit( const a
 std::pair<account_resource_limit, bool> resource_limits_manager::get_account_cpu_limit_ex( const account_name& name, uint32_t greylist_limit ) const {
 
    const auto& state = _db.get<resource_limits_state_object>();
-   const auto& usage = _db.get<resource_usage_object, by_owner>(name);
+   const auto& usage_row = _db.get<resource_usage_object, by_owner>(name);
+   const auto* pending = _pending_usage->find(name);
+   const auto& cpu_usage = pending ? pending->cpu_usage : usage_row.cpu_usage;
    const auto& config = _db.get<resource_limits_config_object>();
 
    int64_t cpu_weight, x, y;
@@ -401,7 +517,7 @@ std::pair<account_resource_limit, bool> resource_limits_manager::get_account_cpu
    uint128_t all_user_weight = (uint128_t)state.total_cpu_weight;
 
    auto max_user_use_in_window = (virtual_cpu_capacity_in_window * user_weight) / all_user_weight;
-   auto cpu_used_in_window  = impl::integer_divide_ceil((uint128_t)usage.cpu_usage.value_ex * window_size, (uint128_t)config::rate_limiting_precision);
+   auto cpu_used_in_window  = impl::integer_divide_ceil((uint128_t)cpu_usage.value_ex * window_size, (uint128_t)config::rate_limiting_precision);
 
    if( max_user_use_in_window <= cpu_used_in_window )
       arl.available = 0;
@@ -421,7 +537,9 @@ std::pair<int64_t, bool> resource_limits_manager::get_account_net_limit( const a
 std::pair<account_resource_limit, bool> resource_limits_manager::get_account_net_limit_ex( const account_name& name, uint32_t greylist_limit ) const {
    const auto& config = _db.get<resource_limits_config_object>();
    const auto& state  = _db.get<resource_limits_state_object>();
-   const auto& usage  = _db.get<resource_usage_object, by_owner>(name);
+   const auto& usage_row = _db.get<resource_usage_object, by_owner>(name);
+   const auto* pending = _pending_usage->find(name);
+   const auto& net_usage = pending ? pending->net_usage : usage_row.net_usage;
 
    int64_t net_weight, x, y;
    get_account_limits( name, x, net_weight, y );
@@ -448,7 +566,7 @@ std::pair<account_resource_limit, bool> resource_limits_manager::get_account_net
    uint128_t all_user_weight = (uint128_t)state.total_net_weight;
 
    auto max_user_use_in_window = (virtual_network_capacity_in_window * user_weight) / all_user_weight;
-   auto net_used_in_window  = impl::integer_divide_ceil((uint128_t)usage.net_usage.value_ex * window_size, (uint128_t)config::rate_limiting_precision);
+   auto net_used_in_window  = impl::integer_divide_ceil((uint128_t)net_usage.value_ex * window_size, (uint128_t)config::rate_limiting_precision);
 
    if( max_user_use_in_window <= net_used_in_window )
       arl.available = 0;
@@ -0,0 +1,258 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/chain/reversible_block_log.hpp>
+#include <roxe/chain/exceptions.hpp>
+#include <fc/io/raw.hpp>
+#include <boost/filesystem.hpp>
+#include <deque>
+#include <fstream>
+
+namespace roxe { namespace chain {
+
+   const uint32_t reversible_block_log::magic_number = 0x8EB10C00;
+   const uint32_t reversible_block_log::version      = 1;
+   const char*    reversible_block_log::filename     = "reversible.log";
+
+   namespace detail {
+      /// once the blocks dropped from the front take up this much and more than the remaining blocks, the file is rewritten
+      static const uint64_t compact_threshold = 16*1024*1024;
+      static const uint64_t header_size = sizeof(uint32_t) * 2;
+
+      class reversible_block_log_impl {
+         public:
+            struct entry {
+               uint64_t       pos;   ///< position of the packed block
+               uint32_t       size;  ///< size of the packed block
+               block_id_type  id;
+            };
+
+            fc::path             file;
+            bool                 read_only = false;
+            std::fstream         stream;
+            std::deque<entry>    entries;
+            uint32_t             first_num = 0;
+            uint64_t             end_pos = header_size;
+
+            uint64_t record_start( const entry& e )const { return e.pos - sizeof(uint32_t); }
+
+            void open();
+            void resize( uint64_t size );
+            void compact();
+      };
+
+      void reversible_block_log_impl::open() {
+         if( !fc::exists( file ) ) {
+            if( read_only ) return;
+            std::ofstream out( file.generic_string().c_str(), std::ios::out | std::ios::binary );
+            fc::raw::pack( out, reversible_block_log::magic_number );
+            fc::raw::pack( out, reversible_block_log::version );
+         }
+
+         std::ifstream in( file.generic_string().c_str(), std::ios::in | std::ios::binary );
+         in.seekg( 0, std::ios::end );
+         const uint64_t file_size = in.tellg();
+         in.seekg( 0 );
+         ROXE_ASSERT( file_size >= header_size, reversible_blocks_exception,
+                      "Reversible block log ${f} is too small to hold its header", ("f", file.generic_string()) );
+
+         uint32_t totem = 0;
+         uint32_t v = 0;
+         fc::raw::unpack( in, totem );
+         fc::raw::unpack( in, v );
+         ROXE_ASSERT( totem == reversible_block_log::magic_number, reversible_blocks_exception,
+                      "Reversible block log ${f} has unexpected magic number ${m}", ("f", file.generic_string())("m", totem) );
+         ROXE_ASSERT( v == reversible_block_log::version, reversible_blocks_exception,
+                      "Unsupported version ${v} of reversible block log ${f}", ("f", file.generic_string())("v", v) );
+
+         uint64_t pos = header_size;
+         vector<char> data;
+         while( pos + sizeof(uint32_t) <= file_size ) {
+            uint32_t size = 0;
+            in.seekg( pos );
+            fc::raw::unpack( in, size );
+            if( pos + sizeof(uint32_t) + size > file_size ) break;
+
+            data.resize( size );
+            in.read( data.data(), size );
+            signed_block b;
+            try {
+               fc::datastream<const char*> ds( data.data(), data.size() );
+               fc::raw::unpack( ds, b );
+            } catch( const fc::exception& e ) {
+               wlog( "Unable to unpack block at position ${p} of ${f}: ${e}", ("p", pos)("f", file.generic_string())("e", e.to_string()) );
+               break;
+            }
+
+            const uint32_t num = b.block_num();
+            if( entries.empty() ) {
+               first_num = num;
+            } else if( num != first_num + entries.size() ) {
+               wlog( "Gap in reversible block log ${f} between ${end} and ${num}",
+                     ("f", file.generic_string())("end", first_num + entries.size() - 1)("num", num) );
+               break;
+            }
+            entries.push_back( entry{ pos + sizeof(uint32_t), size, b.id() } );
+            pos += sizeof(uint32_t) + size;
+         }
+         in.close();
+
+         end_pos = pos;
+         if( end_pos != file_size ) {
+            wlog( "Discarding ${n} bytes at the end of reversible block log ${f} which do not hold a valid block",
+                  ("n", file_size - end_pos)("f", file.generic_string()) );
+            if( !read_only )
+               boost::filesystem::resize_file( file, end_pos );
+         }
+
+         stream.open( file.generic_string().c_str(), read_only ? (std::ios::in | std::ios::binary)
+                                                               : (std::ios::in | std::ios::out | std::ios::binary) );
+      }
+
+      void reversible_block_log_impl::resize( uint64_t size ) {
+         stream.flush();
+         boost::filesystem::resize_file( file, size );
+         end_pos = size;
+      }
+
+      void reversible_block_log_impl::compact() {
+         const auto temp_file = fc::path( file.generic_string() + ".tmp" );
+         const uint64_t offset = record_start( entries.front() ) - header_size;
+         {
+            std::ofstream out( temp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+            fc::raw::pack( out, reversible_block_log::magic_number );
+            fc::raw::pack( out, reversible_block_log::version );
+
+            vector<char> buffer( 1024*1024 );
+            stream.seekg( record_start( entries.front() ) );
+            for( uint64_t remaining = end_pos - record_start( entries.front() ); remaining > 0; ) {
+               const auto n = std::min<uint64_t>( remaining, buffer.size() );
+               stream.read( buffer.data(), n );
+               out.write( buffer.data(), n );
+               remaining -= n;
+            }
+         }
+         stream.close();
+         fc::rename( temp_file, file );
+         stream.open( file.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary );
+
+         for( auto& e : entries )
+            e.pos -= offset;
+         end_pos -= offset;
+      }
+   }
+
+   reversible_block_log::reversible_block_log( const fc::path& data_dir, bool read_only )
+   :my( new detail::reversible_block_log_impl() )
+   {
+      my->read_only = read_only;
+      my->file = data_dir / filename;
+      if( !read_only && !fc::is_directory( data_dir ) )
+         fc::create_directories( data_dir );
+      my->stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+      my->open();
+   }
+
+   reversible_block_log::reversible_block_log( reversible_block_log&& other ) {
+      my = std::move( other.my );
+   }
+
+   reversible_block_log::~reversible_block_log() {}
+
+   void reversible_block_log::append( const signed_block_ptr& b ) {
+      try {
+         ROXE_ASSERT( !my->read_only, reversible_blocks_exception, "Cannot append to a read only reversible block log" );
+         const uint32_t num = b->block_num();
+         if( !empty() && num <= last_block_num() )
+            truncate( num );
+         ROXE_ASSERT( empty() || num == last_block_num() + 1, gap_in_reversible_blocks_db,
+                      "gap in reversible block log between ${end} and ${num}", ("end", last_block_num())("num", num) );
+
+         const auto data = fc::raw::pack( *b );
+         const uint32_t size = data.size();
+         my->stream.seekp( my->end_pos );
+         my->stream.write( (const char*)&size, sizeof(size) );
+         my->stream.write( data.data(), data.size() );
+         my->stream.flush();
+
+         if( my->entries.empty() )
+            my->first_num = num;
+         my->entries.push_back( detail::reversible_block_log_impl::entry{ my->end_pos + sizeof(size), size, b->id() } );
+         my->end_pos += sizeof(size) + size;
+      } FC_LOG_AND_RETHROW()
+   }
+
+   void reversible_block_log::truncate( uint32_t block_num ) {
+      if( empty() || block_num > last_block_num() ) return;
+      if( block_num <= my->first_num ) {
+         clear();
+         return;
+      }
+      const auto n = block_num - my->first_num;
+      const auto new_end = my->record_start( my->entries[n] );
+      my->entries.resize( n );
+      my->resize( new_end );
+   }
+
+   void reversible_block_log::remove_up_to( uint32_t block_num ) {
+      if( empty() || block_num < my->first_num ) return;
+      if( block_num >= last_block_num() ) {
+         clear();
+         return;
+      }
+      my->entries.erase( my->entries.begin(), my->entries.begin() + (block_num - my->first_num + 1) );
+      my->first_num = block_num + 1;
+
+      const uint64_t dead = my->record_start( my->entries.front() ) - detail::header_size;
+      const uint64_t live = my->end_pos - my->record_start( my->entries.front() );
+      if( dead >= detail::compact_threshold && dead > live )
+         my->compact();
+   }
+
+   void reversible_block_log::clear() {
+      my->entries.clear();
+      my->first_num = 0;
+      if( !my->read_only )
+         my->resize( detail::header_size );
+   }
+
+   signed_block_ptr reversible_block_log::read_block_by_num( uint32_t block_num )const {
+      try {
+         if( empty() || block_num < my->first_num || block_num > last_block_num() )
+            return {};
+         const auto& e = my->entries[block_num - my->first_num];
+         vector<char> data( e.size );
+         my->stream.seekg( e.pos );
+         my->stream.read( data.data(), data.size() );
+
+         auto b = std::make_shared<signed_block>();
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         fc::raw::unpack( ds, *b );
+         return b;
+      } FC_LOG_AND_RETHROW()
+   }
+
+   optional<block_id_type> reversible_block_log::block_id_for_num( uint32_t block_num )const {
+      if( empty() || block_num < my->first_num || block_num > last_block_num() )
+         return {};
+      return my->entries[block_num - my->first_num].id;
+   }
+
+   bool reversible_block_log::empty()const {
+      return my->entries.empty();
+   }
+
+   uint32_t reversible_block_log::first_block_num()const {
+      return empty() ? 0 : my->first_num;
+   }
+
+   uint32_t reversible_block_log::last_block_num()const {
+      return empty() ? 0 : my->first_num + my->entries.size() - 1;
+   }
+
+   bool reversible_block_log::exists( const fc::path& data_dir ) {
+      return fc::exists( data_dir / filename );
+   }
+
+} } // roxe::chain
@@ -104,6 +104,7 @@ void apply_roxe_newaccount(apply_context& context) {
    db.create<account_metadata_object>([&](auto& a) {
       a.name = create.name;
    });
+   context.control.invalidate_receiver_dispatch();
 
    for( const auto& auth : { create.owner, create.active } ){
       validate_authority_precondition( context, auth );
@@ -141,7 +142,7 @@ void apply_roxe_setcode(apply_context& context) {
 
    if( code_size > 0 ) {
      code_hash = fc::sha256::hash( act.code.data(), (uint32_t)act.code.size() );
-     wasm_interface::validate(context.control, act.code);
+     wasm_interface::validate(context.control, act.code, code_hash);
    }
 
    const auto& account = db.get<account_metadata_object,by_name>(act.account);
@@ -183,6 +184,9 @@ void apply_roxe_setcode(apply_context& context) {
             o.vm_type = act.vmtype;
             o.vm_version = act.vmversion;
          });
+         context.control.get_wasm_interface().prepare_code_async(code_hash, act.vmtype, act.vmversion, act.code,
+                                                                 context.control.head_block_num() + 1,
+                                                                 context.control.get_thread_pool());
       }
    }
 
@@ -377,6 +381,7 @@ void apply_roxe_linkauth(apply_context& context) {
             (int64_t)(config::billable_size_v<permission_link_object>)
          );
       }
+      context.control.get_mutable_authorization_manager().invalidate_resolution_cache();
 
   } FC_CAPTURE_AND_RETHROW((requirement))
 }
@@ -398,6 +403,7 @@ void apply_roxe_unlinkauth(apply_context& context) {
    );
 
    db.remove(*link);
+   context.control.get_mutable_authorization_manager().invalidate_resolution_cache();
 }
 
 void apply_roxe_canceldelay(apply_context& context) {
@@ -4,6 +4,10 @@
 
 namespace roxe { namespace chain {
 
+void snapshot_writer::write_packed_rows( const packed_snapshot_rows& ) {
+   ROXE_THROW(snapshot_exception, "This snapshot writer does not accept packed rows");
+}
+
 variant_snapshot_writer::variant_snapshot_writer(fc::mutable_variant_object& snapshot)
 : snapshot(snapshot)
 {
@@ -159,6 +163,11 @@ void ostream_snapshot_writer::write_row( const detail::abstract_snapshot_row_wri
    row_count++;
 }
 
+void ostream_snapshot_writer::write_packed_rows( const packed_snapshot_rows& rows ) {
+   snapshot.write(rows.data.data(), rows.data.size());
+   row_count += rows.row_count;
+}
+
 void ostream_snapshot_writer::write_end_section( ) {
    auto restore = snapshot.tellp();
 
@@ -336,6 +345,90 @@ void istream_snapshot_reader::clear_section() {
    cur_row = 0;
 }
 
+read_ahead_file_streambuf::read_ahead_file_streambuf( const fc::path& p, size_t chunk_size )
+:chunk_size(chunk_size)
+{
+   file.exceptions(std::ios::failbit | std::ios::badbit);
+   file.open(p.generic_string(), std::ios::in | std::ios::binary);
+   file_size = fc::file_size(p);
+   setg(nullptr, nullptr, nullptr);
+}
+
+read_ahead_file_streambuf::~read_ahead_file_streambuf() {
+   try {
+      cancel_prefetch();
+   } FC_LOG_AND_DROP()
+}
+
+size_t read_ahead_file_streambuf::read_at( uint64_t pos, std::vector<char>& buf ) {
+   const size_t n = pos < file_size ? std::min<uint64_t>(chunk_size, file_size - pos) : 0;
+   buf.resize(n);
+   if (n) {
+      file.seekg(pos);
+      file.read(buf.data(), n);
+   }
+   return n;
+}
+
+void read_ahead_file_streambuf::start_prefetch( uint64_t pos ) {
+   if (pos >= file_size)
+      return;
+   next_pos = pos;
+   prefetch = std::async(std::launch::async, [this, pos]() { return read_at(pos, next); });
+}
+
+void read_ahead_file_streambuf::cancel_prefetch() {
+   if (prefetch.valid())
+      prefetch.get();
+}
+
+read_ahead_file_streambuf::int_type read_ahead_file_streambuf::underflow() {
+   if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+
+   const uint64_t pos = current_pos + current.size();
+   if (prefetch.valid() && next_pos == pos) {
+      prefetch.get();
+      std::swap(current, next);
+   } else {
+      cancel_prefetch();
+      read_at(pos, current);
+   }
+   current_pos = pos;
+   setg(current.data(), current.data(), current.data() + current.size());
+   if (current.empty())
+      return traits_type::eof();
+
+   start_prefetch(current_pos + current.size());
+   return traits_type::to_int_type(*gptr());
+}
+
+read_ahead_file_streambuf::pos_type read_ahead_file_streambuf::seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which ) {
+   off_type base = 0;
+   if (dir == std::ios_base::cur)
+      base = current_pos + (gptr() - eback());
+   else if (dir == std::ios_base::end)
+      base = file_size;
+   return seekpos(pos_type(base + off), which);
+}
+
+read_ahead_file_streambuf::pos_type read_ahead_file_streambuf::seekpos( pos_type sp, std::ios_base::openmode which ) {
+   if (!(which & std::ios_base::in) || off_type(sp) < 0 || uint64_t(off_type(sp)) > file_size)
+      return pos_type(off_type(-1));
+
+   const uint64_t pos = off_type(sp);
+   if (pos >= current_pos && pos <= current_pos + current.size()) {
+      // still inside the current chunk, keep the prefetch running
+      setg(current.data(), current.data() + (pos - current_pos), current.data() + current.size());
+   } else {
+      cancel_prefetch();
+      current.clear();
+      current_pos = pos;
+      setg(nullptr, nullptr, nullptr);
+   }
+   return sp;
+}
+
 integrity_hash_snapshot_writer::integrity_hash_snapshot_writer(fc::sha256::encoder& enc)
 :enc(enc)
 {
@@ -350,6 +443,10 @@ void integrity_hash_snapshot_writer::write_row( const detail::abstract_snapshot_
    row_writer.write(enc);
 }
 
+void integrity_hash_snapshot_writer::write_packed_rows( const packed_snapshot_rows& rows ) {
+   enc.write(rows.data.data(), rows.data.size());
+}
+
 void integrity_hash_snapshot_writer::write_end_section( ) {
    // no-op for structural details
 }
@@ -0,0 +1,59 @@
+#include <roxe/chain/startup_profile.hpp>
+
+#include <algorithm>
+
+namespace roxe { namespace chain {
+
+   namespace {
+      // taken during static initialization so the report covers the time before main too
+      [[maybe_unused]] startup_profile& initial_instance = startup_profile::instance();
+   }
+
+   startup_profile::scoped_phase::scoped_phase( startup_profile& profile, std::string name )
+   :_profile( profile ) {
+      _phase.name = std::move( name );
+      _phase.start = fc::time_point::now();
+   }
+
+   startup_profile::scoped_phase::~scoped_phase() {
+      _phase.duration = fc::time_point::now() - _phase.start;
+      _profile.record( std::move( _phase ) );
+   }
+
+   startup_profile::startup_profile()
+   :_process_start( fc::time_point::now() ) {}
+
+   startup_profile& startup_profile::instance() {
+      static startup_profile p;
+      return p;
+   }
+
+   void startup_profile::record( startup_phase p ) {
+      std::lock_guard<std::mutex> g( _mtx );
+      _phases.push_back( std::move( p ) );
+   }
+
+   void startup_profile::set_ready() {
+      std::lock_guard<std::mutex> g( _mtx );
+      _ready = fc::time_point::now();
+   }
+
+   fc::time_point startup_profile::ready()const {
+      std::lock_guard<std::mutex> g( _mtx );
+      return _ready;
+   }
+
+   std::vector<startup_phase> startup_profile::phases()const {
+      std::vector<startup_phase> result;
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         result = _phases;
+      }
+      // phases are recorded as they end, so an enclosing phase comes after the ones within it
+      std::stable_sort( result.begin(), result.end(), []( const startup_phase& a, const startup_phase& b ) {
+         return a.start < b.start || ( a.start == b.start && a.duration > b.duration );
+      } );
+      return result;
+   }
+
+} } /// roxe::chain
@@ -0,0 +1,223 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/chain/state_delta.hpp>
+#include <roxe/chain/exceptions.hpp>
+#include <roxe/chain/database_utils.hpp>
+
+#include <roxe/chain/account_object.hpp>
+#include <roxe/chain/code_object.hpp>
+#include <roxe/chain/block_summary_object.hpp>
+#include <roxe/chain/global_property_object.hpp>
+#include <roxe/chain/protocol_state_object.hpp>
+#include <roxe/chain/contract_table_objects.hpp>
+#include <roxe/chain/generated_transaction_object.hpp>
+#include <roxe/chain/transaction_object.hpp>
+#include <roxe/chain/permission_object.hpp>
+#include <roxe/chain/permission_link_object.hpp>
+#include <roxe/chain/resource_limits.hpp>
+#include <roxe/chain/resource_limits_private.hpp>
+
+#include <boost/core/demangle.hpp>
+
+namespace roxe { namespace chain {
+
+   using namespace resource_limits;
+
+   /// every index of the chain state, including those the authorization and resource managers add
+   using state_delta_index_set = index_set<
+      account_index,
+      account_metadata_index,
+      account_ram_correction_index,
+      global_property_multi_index,
+      protocol_state_multi_index,
+      dynamic_global_property_multi_index,
+      block_summary_multi_index,
+      transaction_multi_index,
+      generated_transaction_multi_index,
+      table_id_multi_index,
+      code_index,
+      key_value_index,
+      index64_index,
+      index128_index,
+      index256_index,
+      index_double_index,
+      index_long_double_index,
+      permission_index,
+      permission_usage_index,
+      permission_link_index,
+      resource_limits_index,
+      resource_usage_index,
+      resource_limits_state_index,
+      resource_limits_config_index
+   >;
+
+   namespace {
+      /// the reflection of most objects covers all they hold but the id, which the row carries itself
+      template<typename T, typename = void>
+      struct state_delta_row_codec {
+         template<typename Stream>
+         static void pack( Stream& ds, const T& o, const chainbase::database& ) {
+            fc::raw::pack( ds, o );
+         }
+         template<typename Stream>
+         static void unpack( Stream& ds, T& o, chainbase::database& ) {
+            fc::raw::unpack( ds, o );
+         }
+      };
+
+      /// contract rows refer to their table by id, which their reflection leaves out
+      template<typename T>
+      struct state_delta_row_codec<T, std::void_t<decltype(std::declval<T>().t_id)>> {
+         template<typename Stream>
+         static void pack( Stream& ds, const T& o, const chainbase::database& ) {
+            fc::raw::pack( ds, o.t_id );
+            fc::raw::pack( ds, o );
+         }
+         template<typename Stream>
+         static void unpack( Stream& ds, T& o, chainbase::database& ) {
+            fc::raw::unpack( ds, o.t_id );
+            fc::raw::unpack( ds, o );
+         }
+      };
+
+      template<>
+      struct state_delta_row_codec<permission_object> {
+         template<typename Stream>
+         static void pack( Stream& ds, const permission_object& o, const chainbase::database& ) {
+            fc::raw::pack( ds, o.usage_id );
+            fc::raw::pack( ds, o.parent );
+            fc::raw::pack( ds, o.owner );
+            fc::raw::pack( ds, o.name );
+            fc::raw::pack( ds, o.last_updated );
+            fc::raw::pack( ds, o.auth.to_authority() );
+         }
+         template<typename Stream>
+         static void unpack( Stream& ds, permission_object& o, chainbase::database& ) {
+            authority auth;
+            fc::raw::unpack( ds, o.usage_id );
+            fc::raw::unpack( ds, o.parent );
+            fc::raw::unpack( ds, o.owner );
+            fc::raw::unpack( ds, o.name );
+            fc::raw::unpack( ds, o.last_updated );
+            fc::raw::unpack( ds, auth );
+            o.auth = auth;
+         }
+      };
+
+      template<>
+      struct state_delta_row_codec<protocol_state_object> {
+         using traits = detail::snapshot_row_traits<protocol_state_object>;
+
+         template<typename Stream>
+         static void pack( Stream& ds, const protocol_state_object& o, const chainbase::database& db ) {
+            fc::raw::pack( ds, traits::to_snapshot_row( o, db ) );
+         }
+         template<typename Stream>
+         static void unpack( Stream& ds, protocol_state_object& o, chainbase::database& db ) {
+            snapshot_protocol_state_object row;
+            fc::raw::unpack( ds, row );
+            traits::from_snapshot_row( std::move(row), o, db );
+         }
+      };
+
+      template<typename T>
+      state_delta_row pack_row( const T& o, const chainbase::database& db ) {
+         fc::datastream<size_t> ps;
+         state_delta_row_codec<T>::pack( ps, o, db );
+         state_delta_row row;
+         row.id = o.id._id;
+         row.data.resize( ps.tellp() );
+         fc::datastream<char*> ds( row.data.data(), row.data.size() );
+         state_delta_row_codec<T>::pack( ds, o, db );
+         return row;
+      }
+
+      template<typename T>
+      string index_name() {
+         return boost::core::demangle( typeid(T).name() );
+      }
+   }
+
+   state_delta make_state_delta( const chainbase::database& db, const block_id_type& block_id ) {
+      state_delta delta;
+      delta.block_id = block_id;
+      state_delta_index_set::walk_indices( [&db, &delta]( auto utils ) {
+         using index_t = typename decltype(utils)::index_t;
+         using value_t = typename index_t::value_type;
+
+         const auto& idx = db.get_index<index_t>();
+         const auto* undo = idx.head_undo_state();
+         if( !undo )
+            return;
+
+         state_delta_table table;
+         table.name = index_name<value_t>();
+         table.next_id = idx.next_id()._id;
+         table.removed.reserve( undo->removed_values.size() );
+         for( const auto& item : undo->removed_values )
+            table.removed.push_back( item.first._id );
+
+         // the ids of modified objects are below old_next_id, those of created objects are not
+         table.rows.reserve( undo->old_values.size() );
+         for( const auto& item : undo->old_values )
+            table.rows.push_back( pack_row( idx.get( item.first ), db ) );
+         for( auto itr = idx.indices().lower_bound( undo->old_next_id ); itr != idx.indices().end(); ++itr )
+            table.rows.push_back( pack_row( *itr, db ) );
+
+         delta.tables.emplace_back( std::move(table) );
+      } );
+      return delta;
+   }
+
+   void apply_state_delta( chainbase::database& db, const state_delta& delta ) {
+      flat_map<string, const state_delta_table*> tables;
+      for( const auto& t : delta.tables ) {
+         ROXE_ASSERT( tables.emplace( t.name, &t ).second, database_exception,
+                      "state delta of block ${b} changes ${t} twice", ("b", delta.block_id)("t", t.name) );
+      }
+
+      size_t applied = 0;
+      state_delta_index_set::walk_indices( [&db, &delta, &tables, &applied]( auto utils ) {
+         using index_t = typename decltype(utils)::index_t;
+         using value_t = typename index_t::value_type;
+         using id_type = typename value_t::id_type;
+
+         auto itr = tables.find( index_name<value_t>() );
+         if( itr == tables.end() )
+            return;
+         const auto& table = *itr->second;
+         auto& idx = db.get_mutable_index<index_t>();
+
+         // removing first frees the unique keys of removed objects for the objects which take them over
+         for( const auto id : table.removed ) {
+            const auto* obj = idx.find( id_type( id ) );
+            ROXE_ASSERT( obj, database_exception, "state delta of block ${b} removes ${t} ${id} which does not exist",
+                         ("b", delta.block_id)("t", table.name)("id", id) );
+            idx.remove( *obj );
+         }
+         for( const auto& row : table.rows ) {
+            fc::datastream<const char*> ds( row.data.data(), row.data.size() );
+            if( const auto* obj = idx.find( id_type( row.id ) ) ) {
+               idx.modify( *obj, [&ds, &db]( value_t& o ) {
+                  state_delta_row_codec<value_t>::unpack( ds, o, db );
+               } );
+            } else {
+               ROXE_ASSERT( !(id_type( row.id ) < idx.next_id()), database_exception,
+                            "state delta of block ${b} modifies ${t} ${id} which does not exist",
+                            ("b", delta.block_id)("t", table.name)("id", row.id) );
+               idx.emplace_with_id( id_type( row.id ), [&ds, &db]( value_t& o ) {
+                  state_delta_row_codec<value_t>::unpack( ds, o, db );
+               } );
+            }
+         }
+         idx.set_next_id( id_type( table.next_id ) );
+         ++applied;
+      } );
+
+      ROXE_ASSERT( applied == tables.size(), database_exception,
+                   "state delta of block ${b} changes indices this node does not know", ("b", delta.block_id) );
+   }
+
+} } /// roxe::chain
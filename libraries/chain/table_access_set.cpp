@@ -0,0 +1,63 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/chain/table_access_set.hpp>
+
+namespace roxe { namespace chain {
+
+   namespace {
+      template<typename Set>
+      bool intersects( const Set& a, const Set& b ) {
+         auto ai = a.begin();
+         auto bi = b.begin();
+         while( ai != a.end() && bi != b.end() ) {
+            if( *ai < *bi ) ++ai;
+            else if( *bi < *ai ) ++bi;
+            else return true;
+         }
+         return false;
+      }
+   }
+
+   bool table_access_set::conflicts_with( const table_access_set& other )const {
+      return intersects( writes, other.writes )
+          || intersects( writes, other.reads )
+          || intersects( reads,  other.writes );
+   }
+
+   vector<uint32_t> compute_execution_waves( const vector<table_access_set>& access_sets ) {
+      vector<uint32_t> waves;
+      waves.reserve( access_sets.size() );
+
+      // for each table, one past the latest wave that wrote it and one past the latest wave that read it
+      map<table_access_set::table_key, uint32_t> after_write;
+      map<table_access_set::table_key, uint32_t> after_read;
+
+      for( const auto& s : access_sets ) {
+         uint32_t wave = 0;
+         for( const auto& k : s.reads ) {
+            auto itr = after_write.find( k );
+            if( itr != after_write.end() ) wave = std::max( wave, itr->second );
+         }
+         for( const auto& k : s.writes ) {
+            auto itr = after_write.find( k );
+            if( itr != after_write.end() ) wave = std::max( wave, itr->second );
+            itr = after_read.find( k );
+            if( itr != after_read.end() ) wave = std::max( wave, itr->second );
+         }
+
+         for( const auto& k : s.reads ) {
+            auto& r = after_read[k];
+            r = std::max( r, wave + 1 );
+         }
+         for( const auto& k : s.writes ) {
+            after_write[k] = wave + 1;
+         }
+         waves.push_back( wave );
+      }
+
+      return waves;
+   }
+
+} } // roxe::chain
@@ -6,21 +6,191 @@
 #include <roxe/chain/thread_utils.hpp>
 #include <fc/log/logger_config.hpp>
 
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+#include <time.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace roxe { namespace chain {
 
+namespace {
+   struct pool_registry {
+      std::mutex                                                                    mtx;
+      std::unordered_map<const boost::asio::io_context*, thread_pool_metrics*>      pools;
+   };
+
+   pool_registry& registry() {
+      static pool_registry r;
+      return r;
+   }
+
+   struct affinity_registry {
+      std::mutex                                     mtx;
+      std::map<std::string, std::vector<uint32_t>>   cpus;
+   };
+
+   affinity_registry& affinities() {
+      static affinity_registry r;
+      return r;
+   }
+
+   /// @return the NUMA node of cpu, -1 if unknown
+   int numa_node_of( uint32_t cpu ) {
+#ifdef __linux__
+      const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string( cpu );
+      DIR* d = opendir( dir.c_str() );
+      if( !d ) return -1;
+      int node = -1;
+      while( dirent* e = readdir( d ) ) {
+         if( strncmp( e->d_name, "node", 4 ) == 0 && isdigit( e->d_name[4] ) ) {
+            node = atoi( e->d_name + 4 );
+            break;
+         }
+      }
+      closedir( d );
+      return node;
+#else
+      return -1;
+#endif
+   }
+
+   uint64_t thread_cpu_us() {
+      timespec ts;
+      clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+      return uint64_t( ts.tv_sec ) * 1000000 + ts.tv_nsec / 1000;
+   }
+
+   /// ioc.run() reporting the thread's CPU time at most every 100ms, reading the clock per handler costs too much
+   void run_measured( boost::asio::io_context& ioc, thread_pool_metrics& m, const std::string& thread_name ) {
+      auto& cpu_us = fc::metrics::registry::instance().add_counter( "roxe_thread_pool_thread_cpu_us_total",
+            "CPU time of a thread pool thread, its rate over 1e6 is the thread's utilization",
+            {{"pool", m.pool}, {"thread", thread_name}} );
+      uint64_t reported = thread_cpu_us();
+      auto next_report = std::chrono::steady_clock::now();
+      while( ioc.run_one() ) {
+         m.handlers.inc();
+         const auto now = std::chrono::steady_clock::now();
+         if( now >= next_report ) {
+            const uint64_t cpu = thread_cpu_us();
+            cpu_us.inc( cpu - reported );
+            reported = cpu;
+            next_report = now + std::chrono::milliseconds( 100 );
+         }
+      }
+      cpu_us.inc( thread_cpu_us() - reported );
+   }
+}
+
+//
+// thread_pool_metrics
+//
+thread_pool_metrics::thread_pool_metrics( std::string p )
+: pool( std::move( p ) )
+, threads( fc::metrics::registry::instance().add_gauge( "roxe_thread_pool_threads", "Threads of the pool", {{"pool", pool}} ) )
+, queued( fc::metrics::registry::instance().add_gauge( "roxe_thread_pool_tasks_queued",
+          "Tasks posted to the pool that have not started yet", {{"pool", pool}} ) )
+, wait( fc::metrics::registry::instance().add_histogram( "roxe_thread_pool_task_wait_seconds",
+        "Time tasks waited for a thread of the pool", fc::metrics::exponential_bounds( 0.000001, 4, 12 ), {{"pool", pool}} ) )
+, run( fc::metrics::registry::instance().add_histogram( "roxe_thread_pool_task_run_seconds",
+       "Time tasks ran on a thread of the pool", fc::metrics::exponential_bounds( 0.000001, 4, 12 ), {{"pool", pool}} ) )
+, handlers( fc::metrics::registry::instance().add_counter( "roxe_thread_pool_handlers_total",
+            "Handlers run by the threads of the pool: tasks, timers and socket completions", {{"pool", pool}} ) )
+{}
+
+thread_pool_metrics* thread_pool_metrics::of( const boost::asio::io_context& ioc ) {
+   auto& r = registry();
+   std::lock_guard<std::mutex> g( r.mtx );
+   auto itr = r.pools.find( &ioc );
+   return itr != r.pools.end() ? itr->second : nullptr;
+}
+
+//
+// thread_affinity
+//
+void thread_affinity::set( const std::string& pool, std::vector<uint32_t> cpus ) {
+   auto& r = affinities();
+   std::lock_guard<std::mutex> g( r.mtx );
+   if( cpus.empty() )
+      r.cpus.erase( pool );
+   else
+      r.cpus[pool] = std::move( cpus );
+}
+
+bool thread_affinity::pin_current_thread( const std::string& pool ) {
+   std::vector<uint32_t> cpus;
+   {
+      auto& r = affinities();
+      std::lock_guard<std::mutex> g( r.mtx );
+      auto itr = r.cpus.find( pool );
+      if( itr == r.cpus.end() )
+         return false;
+      cpus = itr->second;
+   }
+#ifdef __linux__
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   for( auto cpu : cpus ) {
+      if( cpu < CPU_SETSIZE )
+         CPU_SET( cpu, &set );
+   }
+   return pthread_setaffinity_np( pthread_self(), sizeof(set), &set ) == 0;
+#else
+   return false;
+#endif
+}
+
+std::string thread_affinity::describe() {
+   auto& r = affinities();
+   std::lock_guard<std::mutex> g( r.mtx );
+   std::ostringstream out;
+   for( const auto& p : r.cpus ) {
+      std::set<int> nodes;
+      out << p.first << ": cpus";
+      for( auto cpu : p.second ) {
+         out << ' ' << cpu;
+         nodes.insert( numa_node_of( cpu ) );
+      }
+      out << " (numa nodes";
+      for( int n : nodes ) {
+         if( n < 0 ) out << " unknown";
+         else out << ' ' << n;
+      }
+      out << ")\n";
+   }
+   return out.str();
+}
 
 //
 // named_thread_pool
 //
 named_thread_pool::named_thread_pool( std::string name_prefix, size_t num_threads )
 : _thread_pool( num_threads )
+, _metrics( name_prefix )
+, _num_threads( num_threads )
 {
+   {
+      auto& r = registry();
+      std::lock_guard<std::mutex> g( r.mtx );
+      r.pools[&_ioc] = &_metrics;
+   }
+   _metrics.threads.add( num_threads );
    _ioc_work.emplace( boost::asio::make_work_guard( _ioc ) );
    for( size_t i = 0; i < num_threads; ++i ) {
-      boost::asio::post( _thread_pool, [&ioc = _ioc, name_prefix, i]() {
+      boost::asio::post( _thread_pool, [&ioc = _ioc, &metrics = _metrics, name_prefix, i]() {
          std::string tn = name_prefix + "-" + std::to_string( i );
          fc::set_os_thread_name( tn );
-         ioc.run();
+         thread_affinity::pin_current_thread( name_prefix );
+         run_measured( ioc, metrics, tn );
       } );
    }
 }
@@ -30,6 +200,12 @@ named_thread_pool::~named_thread_pool() {
 }
 
 void named_thread_pool::stop() {
+   {
+      auto& r = registry();
+      std::lock_guard<std::mutex> g( r.mtx );
+      if( r.pools.erase( &_ioc ) )
+         _metrics.threads.add( -int64_t( _num_threads ) );
+   }
    _ioc_work.reset();
    _ioc.stop();
    _thread_pool.join();
@@ -37,4 +213,4 @@ void named_thread_pool::stop() {
 }
 
 
-} } // roxe::chain
\ No newline at end of file
+} } // roxe::chain
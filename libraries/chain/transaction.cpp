@@ -6,6 +6,7 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 
 #include <boost/range/adaptor/transformed.hpp>
@@ -26,7 +27,7 @@ namespace roxe { namespace chain {
 using namespace boost::multi_index;
 
 struct cached_pub_key {
-   transaction_id_type trx_id;
+   digest_type digest;
    public_key_type pub_key;
    signature_type sig;
    fc::microseconds cpu_usage;
@@ -50,6 +51,12 @@ typedef multi_index_container<
    >
 > recovery_cache_type;
 
+static recovery_cache_type recovery_cache;
+static std::mutex recovery_cache_mtx;
+static size_t recovery_cache_capacity = config::default_sig_recovery_cache_size; // protected by recovery_cache_mtx
+static std::atomic<uint64_t> recovery_cache_hits{0};
+static std::atomic<uint64_t> recovery_cache_misses{0};
+
 void deferred_transaction_generation_context::reflector_init() {
       static_assert( fc::raw::has_feature_reflector_init_on_unpacked_reflected_types,
                      "deferred_transaction_generation_context expects FC to support reflector_init" );
@@ -97,39 +104,27 @@ fc::microseconds transaction::get_signature_keys( const vector<signature_type>&
       const chain_id_type& chain_id, fc::time_point deadline, const vector<bytes>& cfd,
       flat_set<public_key_type>& recovered_pub_keys, bool allow_duplicate_keys)const
 { try {
-   using boost::adaptors::transformed;
-
-   constexpr size_t recovery_cache_size = 10000;
-   static recovery_cache_type recovery_cache;
-   static std::mutex cache_mtx;
-
    auto start = fc::time_point::now();
-   recovered_pub_keys.clear();
    const digest_type digest = sig_digest(chain_id, cfd);
+   const auto digest_time = fc::time_point::now() - start;
+   return get_signature_keys( signatures, digest, deadline, recovered_pub_keys, allow_duplicate_keys ) + digest_time;
+} FC_CAPTURE_AND_RETHROW() }
+
+fc::microseconds transaction::get_signature_keys( const vector<signature_type>& signatures, const digest_type& digest,
+      fc::time_point deadline, flat_set<public_key_type>& recovered_pub_keys, bool allow_duplicate_keys )
+{
+   recovered_pub_keys.clear();
 
-   std::unique_lock<std::mutex> lock(cache_mtx, std::defer_lock);
    fc::microseconds sig_cpu_usage;
-   const auto digest_time = fc::time_point::now() - start;
-   for(const signature_type& sig : signatures) {
-      auto sig_start = fc::time_point::now();
-      ROXE_ASSERT( sig_start < deadline, tx_cpu_usage_exceeded, "transaction signature verification executed for too long",
-                  ("now", sig_start)("deadline", deadline)("start", start) );
-      public_key_type recov;
-      const auto& tid = id();
-      lock.lock();
-      recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find( sig );
-      if( it == recovery_cache.get<by_sig>().end() || it->trx_id != tid ) {
-         lock.unlock();
-         recov = public_key_type( sig, digest );
-         fc::microseconds cpu_usage = fc::time_point::now() - sig_start;
-         lock.lock();
-         recovery_cache.emplace_back( cached_pub_key{tid, recov, sig, cpu_usage} ); //could fail on dup signatures; not a problem
-         sig_cpu_usage += cpu_usage;
-      } else {
-         recov = it->pub_key;
-         sig_cpu_usage += it->cpu_usage;
-      }
-      lock.unlock();
+   auto sig_start = fc::time_point::now();
+   ROXE_ASSERT( sig_start < deadline, tx_cpu_usage_exceeded, "transaction signature verification executed for too long",
+               ("now", sig_start)("deadline", deadline) );
+   vector<public_key_type> keys;
+   vector<fc::microseconds> cpu_usage;
+   recover_signature_keys( signatures, digest, keys, cpu_usage );
+   for( size_t i = 0; i < keys.size(); ++i ) {
+      const public_key_type& recov = keys[i];
+      sig_cpu_usage += cpu_usage[i];
       bool successful_insertion = false;
       std::tie(std::ignore, successful_insertion) = recovered_pub_keys.insert(recov);
       ROXE_ASSERT( allow_duplicate_keys || successful_insertion, tx_duplicate_sig,
@@ -137,13 +132,103 @@ fc::microseconds transaction::get_signature_keys( const vector<signature_type>&
                   ("key", recov) );
    }
 
+   return sig_cpu_usage;
+}
+
+public_key_type transaction::recover_signature_key( const signature_type& sig, const digest_type& digest,
+                                                    fc::microseconds& cpu_usage )
+{
+   std::unique_lock<std::mutex> lock(recovery_cache_mtx);
+   recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find( sig );
+   if( it != recovery_cache.get<by_sig>().end() && it->digest == digest ) {
+      ++recovery_cache_hits;
+      cpu_usage = it->cpu_usage;
+      return it->pub_key;
+   }
+   lock.unlock();
+   ++recovery_cache_misses;
+
+   auto start = fc::time_point::now();
+   public_key_type recov( sig, digest );
+   cpu_usage = fc::time_point::now() - start;
+
    lock.lock();
-   while ( recovery_cache.size() > recovery_cache_size )
+   if( recovery_cache_capacity > 0 ) {
+      recovery_cache.emplace_back( cached_pub_key{digest, recov, sig, cpu_usage} ); //could fail on dup signatures; not a problem
+      while ( recovery_cache.size() > recovery_cache_capacity )
+         recovery_cache.erase( recovery_cache.begin());
+   }
+   return recov;
+}
+
+void transaction::recover_signature_keys( const vector<signature_type>& sigs, const digest_type& digest,
+                                          vector<public_key_type>& keys, vector<fc::microseconds>& cpu_usage )
+{
+   keys.resize( sigs.size() );
+   cpu_usage.resize( sigs.size() );
+   if( sigs.size() == 1 ) {
+      keys[0] = recover_signature_key( sigs[0], digest, cpu_usage[0] );
+      return;
+   }
+
+   vector<size_t> misses;
+   {
+      std::lock_guard<std::mutex> g(recovery_cache_mtx);
+      const auto& by_sig_idx = recovery_cache.get<by_sig>();
+      for( size_t i = 0; i < sigs.size(); ++i ) {
+         auto it = by_sig_idx.find( sigs[i] );
+         if( it != by_sig_idx.end() && it->digest == digest ) {
+            ++recovery_cache_hits;
+            keys[i] = it->pub_key;
+            cpu_usage[i] = it->cpu_usage;
+         } else {
+            misses.push_back( i );
+         }
+      }
+   }
+   if( misses.empty() )
+      return;
+   recovery_cache_misses += misses.size();
+
+   vector<signature_type> miss_sigs;
+   miss_sigs.reserve( misses.size() );
+   for( size_t i : misses )
+      miss_sigs.push_back( sigs[i] );
+   const vector<digest_type> digests( misses.size(), digest );
+   vector<public_key_type> recovered( misses.size() );
+   auto start = fc::time_point::now();
+   public_key_type::recover_many( miss_sigs.data(), digests.data(), misses.size(), recovered.data() );
+   const fc::microseconds per_sig( (fc::time_point::now() - start).count() / int64_t(misses.size()) );
+
+   std::lock_guard<std::mutex> g(recovery_cache_mtx);
+   for( size_t j = 0; j < misses.size(); ++j ) {
+      keys[misses[j]] = recovered[j];
+      cpu_usage[misses[j]] = per_sig;
+      if( recovery_cache_capacity > 0 )
+         recovery_cache.emplace_back( cached_pub_key{digest, recovered[j], miss_sigs[j], per_sig} ); //could fail on dup signatures; not a problem
+   }
+   while ( recovery_cache.size() > recovery_cache_capacity )
       recovery_cache.erase( recovery_cache.begin());
-   lock.unlock();
+}
 
-   return sig_cpu_usage + digest_time;
-} FC_CAPTURE_AND_RETHROW() }
+void transaction::set_recovery_cache_capacity( size_t capacity ) {
+   std::lock_guard<std::mutex> g(recovery_cache_mtx);
+   recovery_cache_capacity = capacity;
+   while ( recovery_cache.size() > recovery_cache_capacity )
+      recovery_cache.erase( recovery_cache.begin());
+}
+
+transaction::recovery_cache_stats transaction::get_recovery_cache_stats() {
+   recovery_cache_stats stats;
+   {
+      std::lock_guard<std::mutex> g(recovery_cache_mtx);
+      stats.size = recovery_cache.size();
+      stats.capacity = recovery_cache_capacity;
+   }
+   stats.hits = recovery_cache_hits;
+   stats.misses = recovery_cache_misses;
+   return stats;
+}
 
 vector<transaction_extensions> transaction::validate_and_extract_extensions()const {
    using transaction_extensions_t = transaction_extension_types::transaction_extensions_t;
@@ -216,6 +301,38 @@ uint32_t packed_transaction::get_prunable_size()const {
    return static_cast<uint32_t>(size);
 }
 
+digest_type packed_transaction::sig_digest( const chain_id_type& chain_id )const {
+   auto cached = std::atomic_load( &sig_digest_cache );
+   if( cached && cached->first == chain_id )
+      return cached->second;
+
+   // transaction::sig_digest() of unpacked_trx
+   digest_type::encoder enc;
+   fc::raw::pack( enc, chain_id );
+   if( canonical_packed_trx )
+      enc.write( packed_trx.data(), packed_trx.size() );
+   else
+      fc::raw::pack( enc, static_cast<const transaction&>( unpacked_trx ) );
+   if( unpacked_trx.context_free_data.size() ) {
+      fc::raw::pack( enc, digest_type::hash( unpacked_trx.context_free_data ) );
+   } else {
+      fc::raw::pack( enc, digest_type() );
+   }
+   const auto digest = enc.result();
+   std::atomic_store( &sig_digest_cache, std::make_shared<const std::pair<chain_id_type, digest_type>>( chain_id, digest ) );
+   return digest;
+}
+
+fc::microseconds packed_transaction::get_signature_keys( const chain_id_type& chain_id, fc::time_point deadline,
+                                                         flat_set<public_key_type>& recovered_pub_keys,
+                                                         bool allow_duplicate_keys )const
+{ try {
+   auto start = fc::time_point::now();
+   const digest_type digest = sig_digest( chain_id );
+   const auto digest_time = fc::time_point::now() - start;
+   return transaction::get_signature_keys( signatures, digest, deadline, recovered_pub_keys, allow_duplicate_keys ) + digest_time;
+} FC_CAPTURE_AND_RETHROW() }
+
 digest_type packed_transaction::packed_digest()const {
    digest_type::encoder prunable;
    fc::raw::pack( prunable, signatures );
@@ -349,6 +466,7 @@ packed_transaction::packed_transaction( bytes&& packed_txn, vector<signature_typ
    if( !packed_context_free_data.empty() ) {
       local_unpack_context_free_data();
    }
+   compute_id();
 }
 
 packed_transaction::packed_transaction( bytes&& packed_txn, vector<signature_type>&& sigs, vector<bytes>&& cfd, compression_type _compression )
@@ -360,6 +478,7 @@ packed_transaction::packed_transaction( bytes&& packed_txn, vector<signature_typ
    if( !unpacked_trx.context_free_data.empty() ) {
       local_pack_context_free_data();
    }
+   compute_id();
 }
 
 packed_transaction::packed_transaction( transaction&& t, vector<signature_type>&& sigs, bytes&& packed_cfd, compression_type _compression )
@@ -372,6 +491,7 @@ packed_transaction::packed_transaction( transaction&& t, vector<signature_type>&
    if( !packed_context_free_data.empty() ) {
       local_unpack_context_free_data();
    }
+   compute_id();
 }
 
 void packed_transaction::reflector_init()
@@ -382,6 +502,7 @@ void packed_transaction::reflector_init()
    ROXE_ASSERT( unpacked_trx.expiration == time_point_sec(), tx_decompression_error, "packed_transaction already unpacked" );
    local_unpack_transaction({});
    local_unpack_context_free_data();
+   compute_id();
 }
 
 void packed_transaction::local_unpack_transaction(vector<bytes>&& context_free_data)
@@ -423,6 +544,7 @@ void packed_transaction::local_pack_transaction()
       switch(compression) {
          case none:
             packed_trx = pack_transaction(unpacked_trx);
+            canonical_packed_trx = true;
             break;
          case zlib:
             packed_trx = zlib_compress_transaction(unpacked_trx);
@@ -433,6 +555,19 @@ void packed_transaction::local_pack_transaction()
    } FC_CAPTURE_AND_RETHROW((compression))
 }
 
+void packed_transaction::compute_id()
+{
+   // the id hashes the encoding unpacked_trx packs to, which received bytes need not be: they may be compressed,
+   // use longer varints than needed or carry trailing bytes
+   if( canonical_packed_trx ) {
+      trx_id = digest_type::hash( packed_trx.data(), packed_trx.size() );
+      return;
+   }
+   const bytes repacked = pack_transaction( unpacked_trx );
+   trx_id = digest_type::hash( repacked.data(), repacked.size() );
+   canonical_packed_trx = compression == none && repacked == packed_trx;
+}
+
 void packed_transaction::local_pack_context_free_data()
 {
    try {
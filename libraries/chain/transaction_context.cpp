@@ -6,6 +6,7 @@
 #include <roxe/chain/generated_transaction_object.hpp>
 #include <roxe/chain/transaction_object.hpp>
 #include <roxe/chain/global_property_object.hpp>
+#include <roxe/chain/billing_clock.hpp>
 
 #pragma push_macro("N")
 #undef N
@@ -88,6 +89,8 @@ namespace bacc = boost::accumulators;
          return;
       initialized = true;
 
+      ilog("Billing clock reads the ${c}", ("c", billing_clock::uses_tsc() ? "invariant TSC" : "system clock"));
+
       #define TIMER_STATS_FORMAT "min:${min}us max:${max}us mean:${mean}us stddev:${stddev}us"
       #define TIMER_STATS \
          ("min", bacc::min(deadline_timer_verification.samples))("max", bacc::max(deadline_timer_verification.samples)) \
@@ -118,7 +121,7 @@ namespace bacc = boost::accumulators;
          expired = 1;
          return;
       }
-      microseconds x = tp.time_since_epoch() - fc::time_point::now().time_since_epoch();
+      microseconds x = tp.time_since_epoch() - billing_clock::now().time_since_epoch();
       if(x.count() <= deadline_timer_verification.timer_overhead)
          expired = 1;
       else {
@@ -167,6 +170,10 @@ namespace bacc = boost::accumulators;
       trace->block_time = c.pending_block_time();
       trace->producer_block_id = c.pending_producer_block_id();
       executed.reserve( trx.total_actions() );
+      if( c.record_table_access_sets() ) {
+         table_access.emplace();
+      }
+      console_bytes_left = c.max_console_output_bytes();
    }
 
    void transaction_context::disallow_transaction_extensions( const char* error_msg )const {
@@ -359,6 +366,8 @@ namespace bacc = boost::accumulators;
    void transaction_context::exec() {
       ROXE_ASSERT( is_initialized, transaction_exception, "must first initialize" );
 
+      trace->action_traces.reserve( (apply_context_free ? trx.context_free_actions.size() : 0) + trx.actions.size() );
+
       if( apply_context_free ) {
          for( const auto& act : trx.context_free_actions ) {
             schedule_action( act, act.account, true, 0, 0 );
@@ -426,7 +435,7 @@ namespace bacc = boost::accumulators;
       eager_net_limit = net_limit;
       check_net_usage();
 
-      auto now = fc::time_point::now();
+      auto now = billing_clock::now();
       trace->elapsed = now - start;
 
       update_billed_cpu_time( now );
@@ -465,10 +474,8 @@ namespace bacc = boost::accumulators;
       }
    }
 
-   void transaction_context::checktime()const {
-      if(BOOST_LIKELY(_deadline_timer.expired == false))
-         return;
-      auto now = fc::time_point::now();
+   void transaction_context::check_deadline()const {
+      auto now = billing_clock::now();
       if( BOOST_UNLIKELY( now > _deadline ) ) {
          // edump((now-start)(now-pseudo_start));
          if( explicit_billed_cpu_time || deadline_exception_code == deadline_exception::code_value ) {
@@ -500,7 +507,7 @@ namespace bacc = boost::accumulators;
    void transaction_context::pause_billing_timer() {
       if( explicit_billed_cpu_time || pseudo_start == fc::time_point() ) return; // either irrelevant or already paused
 
-      auto now = fc::time_point::now();
+      auto now = billing_clock::now();
       billed_time = now - pseudo_start;
       deadline_exception_code = deadline_exception::code_value; // Other timeout exceptions cannot be thrown while billable timer is paused.
       pseudo_start = fc::time_point();
@@ -510,7 +517,7 @@ namespace bacc = boost::accumulators;
    void transaction_context::resume_billing_timer() {
       if( explicit_billed_cpu_time || pseudo_start != fc::time_point() ) return; // either irrelevant or already running
 
-      auto now = fc::time_point::now();
+      auto now = billing_clock::now();
       pseudo_start = now - billed_time;
       if( (pseudo_start + billing_timer_duration_limit) <= deadline ) {
          _deadline = pseudo_start + billing_timer_duration_limit;
@@ -659,7 +666,8 @@ namespace bacc = boost::accumulators;
    {
       uint32_t new_action_ordinal = trace->action_traces.size() + 1;
 
-      trace->action_traces.reserve( new_action_ordinal );
+      if( trace->action_traces.capacity() < new_action_ordinal )
+         trace->action_traces.reserve( std::max<size_t>( new_action_ordinal, 2 * trace->action_traces.capacity() ) );
 
       const action& provided_action = get_action_trace( action_ordinal ).act;
 
@@ -1,9 +1,150 @@
 #include <roxe/chain/transaction_metadata.hpp>
 #include <roxe/chain/thread_utils.hpp>
+#include <roxe/chain/exceptions.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <atomic>
+#include <mutex>
 
 namespace roxe { namespace chain {
 
+/// the on_ready callbacks of one key recovery, run by the pool thread which fulfills its promise
+struct key_recovery_callbacks {
+   std::mutex                         mtx;
+   bool                               done = false;
+   vector<std::function<void()>>      callbacks;
+
+   /// runs on_ready once the recovery completed, right away if it already has
+   void add( std::function<void()> on_ready ) {
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         if( !done ) {
+            callbacks.emplace_back( std::move( on_ready ) );
+            return;
+         }
+      }
+      on_ready();
+   }
+
+   /// called after the promise of the recovery is fulfilled
+   void complete() {
+      vector<std::function<void()>> ready;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         done = true;
+         ready.swap( callbacks );
+      }
+      for( auto& f : ready )
+         f();
+   }
+};
+
+namespace {
+
+   /**
+    *  Recovers the signatures of one transaction concurrently, one thread pool task per signature. The last
+    *  task to finish combines the keys, fulfills the promise and runs the on_ready callbacks. None of the tasks
+    *  waits on another, but the tasks of the other signatures are queued behind whatever was posted to the pool
+    *  in the meantime, which is why nothing posted to the pool may wait on the future.
+    */
+   struct split_key_recovery : std::enable_shared_from_this<split_key_recovery> {
+      split_key_recovery( const transaction_metadata_ptr& mtrx, const chain_id_type& chain_id, fc::microseconds time_limit,
+                          std::shared_ptr<key_recovery_callbacks> callbacks )
+      :chain_id(chain_id)
+      ,time_limit(time_limit)
+      ,mtrx_wp(mtrx)
+      ,ptrx(mtrx->packed_trx)
+      ,trn(ptrx->get_signed_transaction())
+      ,callbacks(std::move(callbacks))
+      ,keys(trn.signatures.size())
+      ,cpu_usage(trn.signatures.size())
+      ,remaining(trn.signatures.size())
+      {}
+
+      /// computes the digest once, then fans out the signatures; runs on the thread pool
+      void start( boost::asio::io_context& thread_pool ) {
+         if( mtrx_wp.expired() ) {
+            promise.set_value( std::make_tuple( chain_id, fc::microseconds(), flat_set<public_key_type>() ) );
+            callbacks->complete();
+            return;
+         }
+         try {
+            start_time = fc::time_point::now();
+            deadline = time_limit == fc::microseconds::maximum() ? fc::time_point::maximum() : start_time + time_limit;
+            digest = ptrx->sig_digest( chain_id );
+            digest_time = fc::time_point::now() - start_time;
+         } catch( ... ) {
+            promise.set_exception( std::current_exception() );
+            callbacks->complete();
+            return;
+         }
+
+         for( size_t i = 1; i < keys.size(); ++i ) {
+            boost::asio::post( thread_pool, [self = shared_from_this(), i]() { self->recover( i ); } );
+         }
+         recover( 0 );
+      }
+
+      void recover( size_t i ) {
+         try {
+            auto sig_start = fc::time_point::now();
+            ROXE_ASSERT( sig_start < deadline, tx_cpu_usage_exceeded, "transaction signature verification executed for too long",
+                        ("now", sig_start)("deadline", deadline)("start", start_time) );
+            keys[i] = transaction::recover_signature_key( trn.signatures[i], digest, cpu_usage[i] );
+         } catch( ... ) {
+            std::lock_guard<std::mutex> g( except_mtx );
+            if( !except ) except = std::current_exception();
+         }
+         if( --remaining == 0 ) {
+            finish();
+            callbacks->complete();
+         }
+      }
+
+      void finish() {
+         if( except ) {
+            promise.set_exception( except );
+            return;
+         }
+         try {
+            flat_set<public_key_type> recovered_pub_keys;
+            recovered_pub_keys.reserve( keys.size() );
+            fc::microseconds sig_cpu_usage = digest_time;
+            for( size_t i = 0; i < keys.size(); ++i ) {
+               sig_cpu_usage += cpu_usage[i];
+               bool successful_insertion = false;
+               std::tie(std::ignore, successful_insertion) = recovered_pub_keys.insert( keys[i] );
+               ROXE_ASSERT( successful_insertion, tx_duplicate_sig,
+                           "transaction includes more than one signature signed using the same key associated with public key: ${key}",
+                           ("key", keys[i]) );
+            }
+            promise.set_value( std::make_tuple( chain_id, sig_cpu_usage, std::move( recovered_pub_keys ) ) );
+         } catch( ... ) {
+            promise.set_exception( std::current_exception() );
+         }
+      }
+
+      const chain_id_type                        chain_id;
+      const fc::microseconds                     time_limit;
+      std::weak_ptr<transaction_metadata>        mtrx_wp;
+      const packed_transaction_ptr               ptrx;
+      const signed_transaction&                  trn;
+      const std::shared_ptr<key_recovery_callbacks> callbacks;
+      std::promise<signing_keys_future_value_type> promise;
+
+      fc::time_point                             start_time;
+      fc::time_point                             deadline;
+      fc::microseconds                           digest_time;
+      digest_type                                digest;
+
+      vector<public_key_type>                    keys;
+      vector<fc::microseconds>                   cpu_usage;
+      std::atomic<size_t>                        remaining;
+      std::mutex                                 except_mtx;
+      std::exception_ptr                         except;
+   };
+
+}
+
 recovery_keys_type transaction_metadata::recover_keys( const chain_id_type& chain_id ) {
    // Unlikely for more than one chain_id to be used in one nodroxe instance
    if( signing_keys_future.valid() ) {
@@ -16,10 +157,10 @@ recovery_keys_type transaction_metadata::recover_keys( const chain_id_type& chai
    // shared_keys_future not created or different chain_id
    std::promise<signing_keys_future_value_type> p;
    flat_set<public_key_type> recovered_pub_keys;
-   const signed_transaction& trn = packed_trx->get_signed_transaction();
-   fc::microseconds cpu_usage = trn.get_signature_keys( chain_id, fc::time_point::maximum(), recovered_pub_keys );
+   fc::microseconds cpu_usage = packed_trx->get_signature_keys( chain_id, fc::time_point::maximum(), recovered_pub_keys );
    p.set_value( std::make_tuple( chain_id, cpu_usage, std::move( recovered_pub_keys ) ) );
    signing_keys_future = p.get_future().share();
+   key_recovery.reset();
 
    const std::tuple<chain_id_type, fc::microseconds, flat_set<public_key_type>>& sig_keys = signing_keys_future.get();
    return std::make_pair( std::get<1>( sig_keys ), std::cref( std::get<2>( sig_keys ) ) );
@@ -28,23 +169,51 @@ recovery_keys_type transaction_metadata::recover_keys( const chain_id_type& chai
 signing_keys_future_type transaction_metadata::start_recover_keys( const transaction_metadata_ptr& mtrx,
                                                                    boost::asio::io_context& thread_pool,
                                                                    const chain_id_type& chain_id,
-                                                                   fc::microseconds time_limit )
+                                                                   fc::microseconds time_limit,
+                                                                   std::function<void()> on_ready )
 {
-   if( mtrx->signing_keys_future.valid() && std::get<0>( mtrx->signing_keys_future.get() ) == chain_id ) // already created
+   if( mtrx->signing_keys_future.valid() && std::get<0>( mtrx->signing_keys_future.get() ) == chain_id ) { // already created
+      if( on_ready ) {
+         // a future not created by start_recover_keys was created ready by recover_keys or taken from a block_state
+         if( mtrx->key_recovery )
+            mtrx->key_recovery->add( std::move( on_ready ) );
+         else
+            on_ready();
+      }
       return mtrx->signing_keys_future;
+   }
 
+   auto callbacks = std::make_shared<key_recovery_callbacks>();
+   if( on_ready )
+      callbacks->callbacks.emplace_back( std::move( on_ready ) );
+   mtrx->key_recovery = callbacks;
+
+   // multisig transactions dominate recovery latency, spread their signatures across the pool
+   if( mtrx->packed_trx->get_signatures().size() > 1 ) {
+      auto recovery = std::make_shared<split_key_recovery>( mtrx, chain_id, time_limit, std::move( callbacks ) );
+      mtrx->signing_keys_future = recovery->promise.get_future().share();
+      async_thread_pool( thread_pool, [recovery, &thread_pool]() { recovery->start( thread_pool ); } );
+      return mtrx->signing_keys_future;
+   }
+
+   auto promise = std::make_shared<std::promise<signing_keys_future_value_type>>();
+   mtrx->signing_keys_future = promise->get_future().share();
    std::weak_ptr<transaction_metadata> mtrx_wp = mtrx;
-   mtrx->signing_keys_future = async_thread_pool( thread_pool, [time_limit, chain_id, mtrx_wp]() {
-      fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
-                                fc::time_point::maximum() : fc::time_point::now() + time_limit;
-      auto mtrx = mtrx_wp.lock();
-      fc::microseconds cpu_usage;
-      flat_set<public_key_type> recovered_pub_keys;
-      if( mtrx ) {
-         const signed_transaction& trn = mtrx->packed_trx->get_signed_transaction();
-         cpu_usage = trn.get_signature_keys( chain_id, deadline, recovered_pub_keys );
-      }
-      return std::make_tuple( chain_id, cpu_usage, std::move( recovered_pub_keys ));
+   async_thread_pool( thread_pool, [time_limit, chain_id, mtrx_wp, promise, callbacks{std::move( callbacks )}]() {
+      try {
+         fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
+                                   fc::time_point::maximum() : fc::time_point::now() + time_limit;
+         auto mtrx = mtrx_wp.lock();
+         fc::microseconds cpu_usage;
+         flat_set<public_key_type> recovered_pub_keys;
+         if( mtrx ) {
+            cpu_usage = mtrx->packed_trx->get_signature_keys( chain_id, deadline, recovered_pub_keys );
+         }
+         promise->set_value( std::make_tuple( chain_id, cpu_usage, std::move( recovered_pub_keys ) ) );
+      } catch( ... ) {
+         promise->set_exception( std::current_exception() );
+      }
+      callbacks->complete();
    } );
 
    return mtrx->signing_keys_future;
@@ -13,6 +13,7 @@
 #include <roxe/chain/global_property_object.hpp>
 #include <roxe/chain/protocol_state_object.hpp>
 #include <roxe/chain/account_object.hpp>
+#include <roxe/chain/native_float.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/crypto/sha256.hpp>
 #include <fc/crypto/sha1.hpp>
@@ -22,18 +23,107 @@
 #include <compiler_builtins.hpp>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <atomic>
+#include <charconv>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <string.h>
 
 namespace roxe { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm, const chainbase::database& d) : my( new wasm_interface_impl(vm, d) ) {}
+   bool root_resolver::resolve_genesis_intrinsic( uint32_t index, const string& mod_name, const string& export_name,
+                                                  IR::ObjectType type, Runtime::ObjectInstance*& out ) {
+      struct resolved_intrinsic {
+         const IR::FunctionType*   type;
+         Runtime::ObjectInstance*  object;
+      };
+      // intrinsics are registered during static initialization and never go away, so entries live for the process;
+      // a racing resolution of the same slot just discards its copy
+      static std::vector<std::atomic<const resolved_intrinsic*>> cache( genesis_intrinsics.size() );
+
+      auto& slot = cache.at( index );
+      const resolved_intrinsic* r = slot.load( std::memory_order_acquire );
+      if( r && r->type == asFunctionType( type ) ) {
+         out = r->object;
+         return true;
+      }
+
+      if( !Runtime::IntrinsicResolver::singleton.resolve( mod_name, export_name, type, out ) )
+         return false;
+
+      // a contract importing the name with a different signature fails to resolve above, so this only ever
+      // records the registered type
+      if( !r ) {
+         auto fresh = std::make_unique<resolved_intrinsic>( resolved_intrinsic{ asFunctionType( type ), out } );
+         if( slot.compare_exchange_strong( r, fresh.get(), std::memory_order_acq_rel ) )
+            fresh.release();
+      }
+      return true;
+   }
+
+   namespace {
+      /**
+       * Code which passed wasm_interface::validate, so that setting the same code again, on another account or after
+       * clearing it, skips parsing and validating the module. Validation depends on nothing but the code, the
+       * intrinsic whitelist it links against and whether the nesting depth is checked, which only a producer does.
+       * Failures are not kept. Shared by the controllers of the process, validation is the same for all of them.
+       */
+      class validated_code_cache {
+         public:
+            static constexpr size_t max_entries = 1024;
+
+            /// @return whether code_hash passed against whitelist_hash, with the nesting depth checked if nesting_checked
+            bool contains( const digest_type& code_hash, const digest_type& whitelist_hash, bool nesting_checked ) {
+               std::lock_guard<std::mutex> g( mtx );
+               auto itr = entries.find( std::make_pair( code_hash, whitelist_hash ) );
+               return itr != entries.end() && (itr->second || !nesting_checked);
+            }
+
+            void add( const digest_type& code_hash, const digest_type& whitelist_hash, bool nesting_checked ) {
+               std::lock_guard<std::mutex> g( mtx );
+               if( entries.size() >= max_entries )
+                  entries.clear(); // redeploys of recent code are what the cache is for, start over rather than track age
+               auto& checked = entries[std::make_pair( code_hash, whitelist_hash )];
+               checked = checked || nesting_checked;
+            }
+
+            static validated_code_cache& instance() {
+               static validated_code_cache cache;
+               return cache;
+            }
+
+         private:
+            std::mutex                                                    mtx;
+            std::map<std::pair<digest_type, digest_type>, bool>          entries; ///< to whether the nesting depth was checked
+      };
+
+      digest_type hash_whitelist( const whitelisted_intrinsics_type& whitelisted_intrinsics ) {
+         digest_type::encoder enc;
+         for( const auto& e : whitelisted_intrinsics ) {
+            fc::raw::pack( enc, e.first );
+            fc::raw::pack( enc, e.second.size() );
+            enc.write( e.second.data(), e.second.size() );
+         }
+         return enc.result();
+      }
+   }
+
+   wasm_interface::wasm_interface(vm_type vm, const chainbase::database& d, const fc::path& prepared_wasm_dir, uint64_t max_cache_size)
+   : my( new wasm_interface_impl(vm, d, prepared_wasm_dir, max_cache_size) ) {}
 
    wasm_interface::~wasm_interface() {}
 
-   void wasm_interface::validate(const controller& control, const bytes& code) {
+   void wasm_interface::validate(const controller& control, const bytes& code, const digest_type& code_hash) {
+      const auto& pso = control.db().get<protocol_state_object>();
+      const auto whitelist_hash = hash_whitelist( pso.whitelisted_intrinsics );
+      const bool nesting_checked = control.is_producing_block(); // see wasm_binary_validation
+      auto& cache = validated_code_cache::instance();
+      if( cache.contains( code_hash, whitelist_hash, nesting_checked ) )
+         return;
+
       Module module;
       try {
          Serialization::MemoryInputStream stream((U8*)code.data(), code.size());
@@ -47,11 +137,11 @@ namespace roxe { namespace chain {
       wasm_validations::wasm_binary_validation validator(control, module);
       validator.validate();
 
-      const auto& pso = control.db().get<protocol_state_object>();
-
       root_resolver resolver( pso.whitelisted_intrinsics );
       LinkResult link_result = linkModule(module, resolver);
 
+      cache.add( code_hash, whitelist_hash, nesting_checked );
+
       //there are a couple opportunties for improvement here--
       //Easy: Cache the Module created here so it can be reused for instantiaion
       //Hard: Kick off instantiation in a separate thread at this location
@@ -65,12 +155,39 @@ namespace roxe { namespace chain {
       my->code_block_num_last_used(code_hash, vm_type, vm_version, block_num);
    }
 
+   void wasm_interface::prepare_code_async(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, const bytes& code,
+                                           const uint32_t block_num, boost::asio::io_context& thread_pool) {
+      my->prepare_code_async(code_hash, vm_type, vm_version, code, block_num, thread_pool);
+   }
+
    void wasm_interface::current_lib(const uint32_t lib) {
       my->current_lib(lib);
    }
 
    void wasm_interface::apply( const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, apply_context& context ) {
-      my->get_instantiated_module(code_hash, vm_type, vm_version, context.trx_context)->apply(context);
+      auto& module = my->get_instantiated_module(code_hash, vm_type, vm_version, context.trx_context);
+      wasm_profiler::scoped_action profile( my->profiler.enabled() ? &my->profiler : nullptr,
+                                            context.get_receiver(), context.get_action().name );
+      wasm_profiler::scoped_sampling sampling( my->profiler.sampling() ? &my->profiler : nullptr,
+                                               context.get_receiver(), context.get_action().name, code_hash );
+      module->apply(context);
+   }
+
+   wasm_profiler& wasm_interface::get_profiler() {
+      return my->profiler;
+   }
+
+   wasm_interface::instantiation_cache_stats wasm_interface::get_instantiation_cache_stats()const {
+      instantiation_cache_stats s;
+      s.entries = my->wasm_instantiation_cache.size();
+      for( const auto& e : my->wasm_instantiation_cache )
+         if( e.module )
+            ++s.instantiated;
+      s.bytes = my->cache_bytes;
+      s.hits = my->hits;
+      s.misses = my->misses;
+      s.evictions = my->evictions;
+      return s;
    }
 
    void wasm_interface::exit() {
@@ -242,26 +359,19 @@ class softfloat_api : public context_aware_api {
       softfloat_api( apply_context& ctx )
       :context_aware_api(ctx, true) {}
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstrict-aliasing"
-      // float binops
+      // float binops, add, sub, div, mul and sqrt take the native path whenever it matches softfloat, see native_float
       float _roxe_f32_add( float a, float b ) {
-         float32_t ret = f32_add( to_softfloat32(a), to_softfloat32(b) );
-         return *reinterpret_cast<float*>(&ret);
+         return native_float::f32_add( a, b );
       }
       float _roxe_f32_sub( float a, float b ) {
-         float32_t ret = f32_sub( to_softfloat32(a), to_softfloat32(b) );
-         return *reinterpret_cast<float*>(&ret);
+         return native_float::f32_sub( a, b );
       }
       float _roxe_f32_div( float a, float b ) {
-         float32_t ret = f32_div( to_softfloat32(a), to_softfloat32(b) );
-         return *reinterpret_cast<float*>(&ret);
+         return native_float::f32_div( a, b );
       }
       float _roxe_f32_mul( float a, float b ) {
-         float32_t ret = f32_mul( to_softfloat32(a), to_softfloat32(b) );
-         return *reinterpret_cast<float*>(&ret);
+         return native_float::f32_mul( a, b );
       }
-#pragma GCC diagnostic pop
       float _roxe_f32_min( float af, float bf ) {
          float32_t a = to_softfloat32(af);
          float32_t b = to_softfloat32(bf);
@@ -313,8 +423,7 @@ class softfloat_api : public context_aware_api {
          return from_softfloat32(a);
       }
       float _roxe_f32_sqrt( float a ) {
-         float32_t ret = f32_sqrt( to_softfloat32(a) );
-         return from_softfloat32(ret);
+         return native_float::f32_sqrt( a );
       }
       // ceil, floor, trunc and nearest are lifted from libc
       float _roxe_f32_ceil( float af ) {
@@ -416,20 +525,16 @@ class softfloat_api : public context_aware_api {
 
       // double binops
       double _roxe_f64_add( double a, double b ) {
-         float64_t ret = f64_add( to_softfloat64(a), to_softfloat64(b) );
-         return from_softfloat64(ret);
+         return native_float::f64_add( a, b );
       }
       double _roxe_f64_sub( double a, double b ) {
-         float64_t ret = f64_sub( to_softfloat64(a), to_softfloat64(b) );
-         return from_softfloat64(ret);
+         return native_float::f64_sub( a, b );
       }
       double _roxe_f64_div( double a, double b ) {
-         float64_t ret = f64_div( to_softfloat64(a), to_softfloat64(b) );
-         return from_softfloat64(ret);
+         return native_float::f64_div( a, b );
       }
       double _roxe_f64_mul( double a, double b ) {
-         float64_t ret = f64_mul( to_softfloat64(a), to_softfloat64(b) );
-         return from_softfloat64(ret);
+         return native_float::f64_mul( a, b );
       }
       double _roxe_f64_min( double af, double bf ) {
          float64_t a = to_softfloat64(af);
@@ -477,8 +582,7 @@ class softfloat_api : public context_aware_api {
          return from_softfloat64(a);
       }
       double _roxe_f64_sqrt( double a ) {
-         float64_t ret = f64_sqrt( to_softfloat64(a) );
-         return from_softfloat64(ret);
+         return native_float::f64_sqrt( a );
       }
       // ceil, floor, trunc and nearest are lifted from libc
       double _roxe_f64_ceil( double af ) {
@@ -1029,34 +1133,34 @@ class console_api : public context_aware_api {
    public:
       console_api( apply_context& ctx )
       : context_aware_api(ctx,true)
-      , ignore(!ctx.control.contracts_console()) {}
+      , ignore(!ctx.console_enabled()) {}
 
       // Kept as intrinsic rather than implementing on WASM side (using prints_l and strlen) because strlen is faster on native side.
       void prints(null_terminated_ptr str) {
          if ( !ignore ) {
-            context.console_append( static_cast<const char*>(str) );
+            context.console_append( str.value, strlen( str.value ) );
          }
       }
 
       void prints_l(array_ptr<const char> str, size_t str_len ) {
          if ( !ignore ) {
-            context.console_append(string(str, str_len));
+            context.console_append( str.value, str_len );
          }
       }
 
       void printi(int64_t val) {
          if ( !ignore ) {
-            std::ostringstream oss;
-            oss << val;
-            context.console_append( oss.str() );
+            char buf[24];
+            auto res = std::to_chars( buf, buf + sizeof(buf), val );
+            context.console_append( buf, res.ptr - buf );
          }
       }
 
       void printui(uint64_t val) {
          if ( !ignore ) {
-            std::ostringstream oss;
-            oss << val;
-            context.console_append( oss.str() );
+            char buf[24];
+            auto res = std::to_chars( buf, buf + sizeof(buf), val );
+            context.console_append( buf, res.ptr - buf );
          }
       }
 
@@ -1193,6 +1297,12 @@ class console_api : public context_aware_api {
          return context.IDX.previous_secondary(iterator, primary);\
       }
 
+#define DB_API_METHOD_WRAPPERS_RANGE_SECONDARY(IDX, TYPE)\
+      int db_##IDX##_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary_table, const TYPE& secondary, uint64_t primary,\
+                            uint32_t max_rows, array_ptr<char> buffer, size_t buffer_size ) {\
+         return context.IDX.range_secondary(code, scope, table, primary_table, secondary, primary, max_rows, buffer, buffer_size);\
+      }
+
 #define DB_API_METHOD_WRAPPERS_ARRAY_SECONDARY(IDX, ARR_SIZE, ARR_ELEMENT_TYPE)\
       int db_##IDX##_store( uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, array_ptr<const ARR_ELEMENT_TYPE> data, size_t data_len) {\
          ROXE_ASSERT( data_len == ARR_SIZE,\
@@ -1323,6 +1433,8 @@ class database_api : public context_aware_api {
 
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx64,  uint64_t)
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx128, uint128_t)
+      DB_API_METHOD_WRAPPERS_RANGE_SECONDARY(idx64,  uint64_t)
+      DB_API_METHOD_WRAPPERS_RANGE_SECONDARY(idx128, uint128_t)
       DB_API_METHOD_WRAPPERS_ARRAY_SECONDARY(idx256, 2, uint128_t)
       DB_API_METHOD_WRAPPERS_FLOAT_SECONDARY(idx_double, float64_t)
       DB_API_METHOD_WRAPPERS_FLOAT_SECONDARY(idx_long_double, float128_t)
@@ -1780,6 +1892,9 @@ REGISTER_INTRINSICS(producer_api,
    (db_##IDX##_next,           int(int, int))\
    (db_##IDX##_previous,       int(int, int))
 
+#define DB_SECONDARY_INDEX_METHODS_RANGE(IDX) \
+   (db_##IDX##_range,          int(int64_t,int64_t,int64_t,int64_t,int,int64_t,int,int,int))
+
 #define DB_SECONDARY_INDEX_METHODS_ARRAY(IDX) \
       (db_##IDX##_store,          int(int64_t,int64_t,int64_t,int64_t,int,int))\
       (db_##IDX##_remove,         void(int))\
@@ -1806,6 +1921,8 @@ REGISTER_INTRINSICS( database_api,
 
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx64)
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx128)
+   DB_SECONDARY_INDEX_METHODS_RANGE(idx64)
+   DB_SECONDARY_INDEX_METHODS_RANGE(idx128)
    DB_SECONDARY_INDEX_METHODS_ARRAY(idx256)
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx_double)
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx_long_double)
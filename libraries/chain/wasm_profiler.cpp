@@ -0,0 +1,189 @@
+#include <roxe/chain/wasm_profiler.hpp>
+#include <fc/log/logger_config.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace roxe { namespace chain {
+
+   thread_local vector<uint64_t>* wasm_profiler::current_counts = nullptr;
+   thread_local wasm_profiler::scoped_sampling* wasm_profiler::current_sampling = nullptr;
+   std::atomic<bool> wasm_profiler::sample_requested{false};
+
+   static std::mutex& intrinsic_names_mutex() {
+      static std::mutex m;
+      return m;
+   }
+
+   static vector<string>& intrinsic_names() {
+      static vector<string> names;
+      return names;
+   }
+
+   uint32_t wasm_profiler::register_intrinsic( const char* name ) {
+      std::lock_guard<std::mutex> g( intrinsic_names_mutex() );
+      auto& names = intrinsic_names();
+      auto itr = std::find( names.begin(), names.end(), name );
+      if( itr != names.end() )
+         return static_cast<uint32_t>( itr - names.begin() );
+      names.emplace_back( name );
+      return static_cast<uint32_t>( names.size() - 1 );
+   }
+
+   wasm_profiler::scoped_action::scoped_action( wasm_profiler* profiler, account_name receiver, action_name action )
+   :profiler(profiler)
+   ,receiver(receiver)
+   ,action(action)
+   {
+      if( !profiler ) return;
+      previous_counts = current_counts;
+      current_counts = &counts;
+      start = fc::time_point::now();
+   }
+
+   wasm_profiler::scoped_action::~scoped_action() {
+      if( !profiler ) return;
+      const auto elapsed = fc::time_point::now() - start;
+      current_counts = previous_counts;
+      try {
+         profiler->record( receiver, action, elapsed, counts );
+      } FC_LOG_AND_DROP()
+   }
+
+   void wasm_profiler::record( account_name receiver, action_name action, fc::microseconds elapsed, const vector<uint64_t>& counts ) {
+      std::lock_guard<std::mutex> g( mtx );
+      auto& s = stats[std::make_pair( receiver, action )];
+      s.receiver = receiver;
+      s.action = action;
+      ++s.executions;
+      s.total_us += elapsed.count();
+      s.max_us = std::max<uint64_t>( s.max_us, elapsed.count() );
+      if( counts.empty() ) return;
+
+      std::lock_guard<std::mutex> ng( intrinsic_names_mutex() );
+      const auto& names = intrinsic_names();
+      for( size_t i = 0; i < counts.size() && i < names.size(); ++i ) {
+         if( counts[i] ) s.intrinsic_calls[names[i]] += counts[i];
+      }
+   }
+
+   vector<wasm_profiler::action_stats> wasm_profiler::get_stats()const {
+      vector<action_stats> result;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         result.reserve( stats.size() );
+         for( const auto& s : stats )
+            result.push_back( s.second );
+      }
+      std::sort( result.begin(), result.end(), []( const action_stats& a, const action_stats& b ) {
+         return a.total_us > b.total_us;
+      } );
+      return result;
+   }
+
+   void wasm_profiler::clear() {
+      std::lock_guard<std::mutex> g( mtx );
+      stats.clear();
+   }
+
+   wasm_profiler::scoped_sampling::scoped_sampling( wasm_profiler* profiler, account_name receiver, action_name action, const digest_type& code_hash )
+   :profiler(profiler)
+   ,receiver(receiver)
+   ,action(action)
+   ,code_hash(code_hash)
+   {
+      if( !profiler ) return;
+      previous = current_sampling;
+      current_sampling = this;
+      // a sample raised while no contract ran would otherwise land on the first function of this one
+      if( !previous )
+         sample_requested.store( false, std::memory_order_relaxed );
+   }
+
+   wasm_profiler::scoped_sampling::~scoped_sampling() {
+      if( !profiler ) return;
+      current_sampling = previous;
+   }
+
+   wasm_profiler::~wasm_profiler() {
+      enable_sampling( 0 );
+   }
+
+   void wasm_profiler::enable_sampling( uint32_t interval_us ) {
+      if( sampler.joinable() ) {
+         {
+            std::lock_guard<std::mutex> g( sampler_mtx );
+            sampler_stop = true;
+         }
+         sampler_cv.notify_all();
+         sampler.join();
+         sampler_stop = false;
+      }
+      sample_interval_us = interval_us;
+      if( interval_us )
+         sampler = std::thread( [this]() { run_sampler(); } );
+   }
+
+   void wasm_profiler::run_sampler() {
+      fc::set_os_thread_name( "wasm-sampler" );
+      const auto interval = std::chrono::microseconds( sample_interval_us );
+      std::unique_lock<std::mutex> g( sampler_mtx );
+      while( !sampler_cv.wait_for( g, interval, [this]() { return sampler_stop; } ) )
+         sample_requested.store( true, std::memory_order_relaxed );
+   }
+
+   void wasm_profiler::take_sample( int64_t function, const string& name ) {
+      sample_requested.store( false, std::memory_order_relaxed );
+      auto* s = current_sampling;
+      if( !s ) return;
+
+      string stack = s->receiver.to_string();
+      stack += ';';
+      stack += s->action.to_string();
+      if( function >= 0 ) {
+         stack += ';';
+         // the folded format separates frames with ';' and the count with a space
+         if( name.empty() ) {
+            stack += "wasm-function[" + std::to_string( function ) + "]";
+         } else {
+            for( char c : name )
+               stack += ( c == ';' || c == ' ' ) ? '_' : c;
+         }
+      }
+      try {
+         std::lock_guard<std::mutex> g( s->profiler->mtx );
+         ++s->profiler->samples[std::make_pair( s->receiver, s->code_hash )][stack];
+      } FC_LOG_AND_DROP()
+   }
+
+   vector<wasm_profiler::contract_samples> wasm_profiler::get_samples()const {
+      vector<contract_samples> result;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         result.reserve( samples.size() );
+         for( const auto& c : samples ) {
+            contract_samples r;
+            r.receiver = c.first.first;
+            r.code_hash = c.first.second;
+            r.stacks.reserve( c.second.size() );
+            for( const auto& st : c.second ) {
+               r.samples += st.second;
+               r.stacks.emplace_back( st.first, st.second );
+            }
+            result.push_back( std::move( r ) );
+         }
+      }
+      for( auto& r : result ) {
+         std::sort( r.stacks.begin(), r.stacks.end(), []( const auto& a, const auto& b ) { return a.second > b.second; } );
+      }
+      std::sort( result.begin(), result.end(), []( const contract_samples& a, const contract_samples& b ) {
+         return a.samples > b.samples;
+      } );
+      return result;
+   }
+
+   void wasm_profiler::clear_samples() {
+      std::lock_guard<std::mutex> g( mtx );
+      samples.clear();
+   }
+
+} } // roxe::chain
@@ -15,6 +15,8 @@
 #include <vector>
 #include <iterator>
 
+#include <execinfo.h>
+
 using namespace IR;
 using namespace Runtime;
 
@@ -22,10 +24,29 @@ namespace roxe { namespace chain { namespace webassembly { namespace wavm {
 
 running_instance_context the_running_instance_context;
 
+void sample_running_function() {
+   // JITed code registers no unwind info, so the unwinder stops at the innermost contract frame after walking
+   // the native frames of the intrinsic above it
+   void* frames[64];
+   const int depth = backtrace( frames, sizeof(frames) / sizeof(frames[0]) );
+   Uptr function_index = 0;
+   std::string name;
+   for( int i = 0; i < depth; ++i ) {
+      if( Runtime::getFunctionDefAt( reinterpret_cast<Uptr>( frames[i] ), function_index, name ) ) {
+         wasm_profiler::take_sample( static_cast<int64_t>( function_index ), name );
+         return;
+      }
+   }
+   wasm_profiler::take_sample( -1, name );
+}
+
 namespace detail {
 struct wavm_runtime_initializer {
    wavm_runtime_initializer() {
       Runtime::init();
+      // the first backtrace() loads the unwinder, better here than in the first sample
+      void* frame;
+      backtrace( &frame, 1 );
    }
 };
 
@@ -95,7 +116,7 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             MemoryInstance* default_mem = getDefaultMemory(_instance);
             if(default_mem) {
                //reset memory resizes the sandbox'ed memory to the module's init memory size and then
-               // (effectively) memzeros it all
+               // (effectively) memzeros it all; only pages dirtied by the previous call are actually released
                resetMemory(default_mem, _initial_memory_config);
 
                char* memstart = &memoryRef<char>(getDefaultMemory(_instance), 0);
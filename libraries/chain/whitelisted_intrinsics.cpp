@@ -8,9 +8,9 @@
 namespace roxe { namespace chain {
 
    template<typename Iterator>
-   bool find_intrinsic_helper( uint64_t h, const std::string& name, Iterator& itr, const Iterator& end ) {
+   bool find_intrinsic_helper( uint64_t h, std::string_view name, Iterator& itr, const Iterator& end ) {
       for( ; itr != end && itr->first == h; ++itr ) {
-         if( itr->second.compare( 0, itr->second.size(), name.c_str(), name.size() ) == 0 ) {
+         if( itr->second.compare( 0, itr->second.size(), name.data(), name.size() ) == 0 ) {
             return true;
          }
       }
@@ -51,6 +51,13 @@ namespace roxe { namespace chain {
       return find_intrinsic_helper( h, name, itr, end );
    }
 
+   bool is_intrinsic_whitelisted( const whitelisted_intrinsics_type& whitelisted_intrinsics, uint64_t h, std::string_view name )
+   {
+      auto itr = whitelisted_intrinsics.lower_bound( h );
+      const auto end = whitelisted_intrinsics.end();
+
+      return find_intrinsic_helper( h, name, itr, end );
+   }
 
    void add_intrinsic_to_whitelist( whitelisted_intrinsics_type& whitelisted_intrinsics, const std::string& name )
    {
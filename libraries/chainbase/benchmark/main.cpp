@@ -0,0 +1,273 @@
+/**
+ * Microbenchmarks of chainbase, run once for every pinnable_mapped_file::map_mode.
+ *
+ *    chainbase_bench [rows] [database size in MiB]
+ *
+ * The table mimics the chain's contract table rows: a primary key unique within a scope, a secondary key and a
+ * variable sized value. Each phase prints its throughput; the fragmentation phase instead prints how free space
+ * and the largest free block evolve over a long run of rows being replaced by rows of another size.
+ */
+#include <chainbase/chainbase.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace chainbase;
+using namespace boost::multi_index;
+
+struct row_object : public chainbase::object<0, row_object> {
+   template<typename Constructor, typename Allocator>
+   row_object( Constructor&& c, Allocator&& a ) : value( a ) {
+      c(*this);
+   }
+
+   id_type        id;
+   uint64_t       scope     = 0;
+   uint64_t       primary   = 0;
+   uint64_t       secondary = 0;
+   shared_string  value;
+};
+
+struct by_id;
+struct by_scope_primary;
+struct by_scope_secondary;
+
+typedef multi_index_container<
+   row_object,
+   indexed_by<
+      ordered_unique< tag<by_id>, member<row_object, row_object::id_type, &row_object::id> >,
+      ordered_unique< tag<by_scope_primary>,
+         composite_key< row_object,
+            member<row_object, uint64_t, &row_object::scope>,
+            member<row_object, uint64_t, &row_object::primary>
+         >
+      >,
+      ordered_unique< tag<by_scope_secondary>,
+         composite_key< row_object,
+            member<row_object, uint64_t, &row_object::scope>,
+            member<row_object, uint64_t, &row_object::secondary>,
+            member<row_object, row_object::id_type, &row_object::id>
+         >
+      >
+   >,
+   chainbase::allocator<row_object>
+> row_index;
+
+CHAINBASE_SET_INDEX_TYPE( row_object, row_index )
+
+namespace {
+
+   const uint64_t scopes = 64;
+
+   class stopwatch {
+      public:
+         stopwatch() : _start( std::chrono::steady_clock::now() ) {}
+
+         double elapsed_ns()const {
+            return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - _start ).count();
+         }
+
+      private:
+         std::chrono::steady_clock::time_point _start;
+   };
+
+   void report( pinnable_mapped_file::map_mode mode, const char* phase, uint64_t ops, const stopwatch& sw ) {
+      const double ns = sw.elapsed_ns();
+      std::cout << std::left << std::setw(8) << mode << std::setw(24) << phase << std::right
+                << std::setw(10) << ops << " ops " << std::fixed << std::setprecision(1)
+                << std::setw(10) << ns / ops << " ns/op " << std::setw(12) << ops * 1e9 / ns << " ops/s\n";
+   }
+
+   void set_value( row_object& r, std::mt19937_64& rng ) {
+      r.value.assign( 16 + rng() % 240, 'v' );
+   }
+
+   void run( const bfs::path& dir, pinnable_mapped_file::map_mode mode, uint64_t rows, uint64_t size ) {
+      chainbase::database db( dir, database::read_write, size, false, mode );
+      db.add_index<row_index>();
+      std::mt19937_64 rng( 42 );
+
+      {
+         stopwatch sw;
+         for( uint64_t i = 0; i < rows; ++i ) {
+            db.create<row_object>( [&]( row_object& r ) {
+               r.scope     = i % scopes;
+               r.primary   = i / scopes;
+               r.secondary = rng();
+               set_value( r, rng );
+            });
+         }
+         report( mode, "emplace", rows, sw );
+      }
+
+      const auto& by_primary   = db.get_index<row_index, by_scope_primary>();
+      const auto& by_secondary = db.get_index<row_index, by_scope_secondary>();
+      {
+         uint64_t found = 0;
+         stopwatch sw;
+         for( uint64_t i = 0; i < rows; ++i ) {
+            const uint64_t k = rng() % rows;
+            found += by_primary.find( boost::make_tuple( k % scopes, k / scopes ) ) != by_primary.end();
+         }
+         report( mode, "find by_scope_primary", rows, sw );
+         if( found != rows )
+            throw std::runtime_error( "lookup missed a row" );
+      }
+
+      {
+         const uint64_t scans = rows / 100;
+         uint64_t visited = 0;
+         stopwatch sw;
+         for( uint64_t i = 0; i < scans; ++i ) {
+            const uint64_t scope = rng() % scopes;
+            auto itr = by_secondary.lower_bound( boost::make_tuple( scope, rng() ) );
+            for( int n = 0; n < 100 && itr != by_secondary.end() && itr->scope == scope; ++n, ++itr )
+               ++visited;
+         }
+         report( mode, "secondary range row", visited, sw );
+      }
+
+      {
+         stopwatch sw;
+         for( uint64_t i = 0; i < rows; ++i ) {
+            const uint64_t k = rng() % rows;
+            db.modify( *by_primary.find( boost::make_tuple( k % scopes, k / scopes ) ), [&]( row_object& r ) {
+               r.secondary = rng();
+               set_value( r, rng );
+            });
+         }
+         report( mode, "modify", rows, sw );
+      }
+
+      // every cycle touches a block's worth of rows: modifies 100, creates 10 and removes the 10 it created
+      const uint64_t cycles = 1000;
+      auto block = [&]( uint64_t cycle ) {
+         for( int n = 0; n < 100; ++n ) {
+            const uint64_t k = rng() % rows;
+            db.modify( *by_primary.find( boost::make_tuple( k % scopes, k / scopes ) ), [&]( row_object& r ) {
+               r.secondary = rng();
+            });
+         }
+         std::vector<row_object::id_type> created;
+         for( uint64_t n = 0; n < 10; ++n ) {
+            created.push_back( db.create<row_object>( [&]( row_object& r ) {
+               r.scope     = scopes + n;
+               r.primary   = cycle;
+               r.secondary = rng();
+               set_value( r, rng );
+            }).id );
+         }
+         for( auto id : created )
+            db.remove( db.get<row_object>( id ) );
+      };
+      {
+         stopwatch sw;
+         for( uint64_t i = 0; i < cycles; ++i ) {
+            auto session = db.start_undo_session( true );
+            block( i );
+            session.undo();
+         }
+         report( mode, "session undo", cycles, sw );
+      }
+      {
+         stopwatch sw;
+         auto outer = db.start_undo_session( true );
+         for( uint64_t i = 0; i < cycles; ++i ) {
+            auto session = db.start_undo_session( true );
+            block( i );
+            session.squash();
+         }
+         outer.undo();
+         report( mode, "session squash", cycles, sw );
+      }
+      {
+         stopwatch sw;
+         for( uint64_t i = 0; i < cycles; ++i ) {
+            auto session = db.start_undo_session( true );
+            block( i );
+            session.push();
+            db.commit( db.revision() );
+         }
+         report( mode, "session commit", cycles, sw );
+      }
+
+      {
+         const uint64_t removed = rows / 2;
+         stopwatch sw;
+         for( uint64_t i = 0; i < removed; ++i ) {
+            auto itr = by_primary.find( boost::make_tuple( i % scopes, i / scopes ) );
+            db.remove( *itr );
+         }
+         report( mode, "remove", removed, sw );
+      }
+
+      // long run replacing random rows with rows of a different size; a growing gap between the free memory and
+      // the largest free block is fragmentation
+      {
+         std::vector<row_object::id_type> live;
+         auto create = [&]( uint64_t primary ) {
+            return db.create<row_object>( [&]( row_object& r ) {
+               r.scope     = scopes + 1000;
+               r.primary   = primary;
+               r.secondary = rng();
+               r.value.assign( 8 + rng() % 2040, 'f' );
+            }).id;
+         };
+         uint64_t next = 0;
+         while( live.size() < rows / 4 )
+            live.push_back( create( next++ ) );
+
+         const uint64_t rounds = 10;
+         for( uint64_t round = 1; round <= rounds; ++round ) {
+            stopwatch sw;
+            for( uint64_t i = 0; i < rows / rounds; ++i ) {
+               const size_t n = rng() % live.size();
+               db.remove( db.get<row_object>( live[n] ) );
+               live[n] = create( next++ );
+            }
+            const size_t free_mem = db.get_free_memory();
+            const size_t largest  = db.get_largest_free_block();
+            std::cout << std::left << std::setw(8) << mode << std::setw(24) << "fragmentation" << std::right
+                      << " round " << round << " free " << free_mem
+                      << " largest free block " << largest << " ("
+                      << std::fixed << std::setprecision(1) << (free_mem ? 100.0 * largest / free_mem : 0.0)
+                      << "%) " << sw.elapsed_ns() / (rows / rounds) << " ns/replace\n";
+         }
+      }
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   const uint64_t rows    = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1000000;
+   const uint64_t size_mb = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : 2048;
+   if( rows < 1000 ) {
+      std::cerr << "usage: " << argv[0] << " [rows >= 1000] [database size in MiB]\n";
+      return 1;
+   }
+
+   const pinnable_mapped_file::map_mode modes[] = { pinnable_mapped_file::map_mode::mapped,
+                                                     pinnable_mapped_file::map_mode::heap,
+                                                     pinnable_mapped_file::map_mode::locked };
+   int result = 0;
+   for( auto mode : modes ) {
+      const bfs::path dir = bfs::temp_directory_path() / bfs::unique_path();
+      try {
+         run( dir, mode, rows, size_mb * 1024 * 1024 );
+      } catch( const std::exception& e ) {
+         // locked mode needs a large enough RLIMIT_MEMLOCK, so report the failure and carry on
+         std::cerr << mode << " failed: " << e.what() << "\n";
+         result = 1;
+      }
+      bfs::remove_all( dir );
+   }
+   return result;
+}
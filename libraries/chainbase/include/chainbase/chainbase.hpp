@@ -19,6 +19,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <fstream>
@@ -126,30 +127,42 @@ namespace chainbase {
    template<typename Constructor, typename Allocator> \
    OBJECT_TYPE( Constructor&& c, Allocator&&  ) { c(*this); }
 
+   /**
+    *  Objects created during a session are not recorded individually. Ids are handed out in increasing order
+    *  so every object with an id of at least old_next_id was created during the session (or a later one).
+    */
    template< typename value_type >
    class undo_state
    {
       public:
          typedef typename value_type::id_type                      id_type;
          typedef allocator< std::pair<const id_type, value_type> > id_value_allocator_type;
-         typedef allocator< id_type >                              id_allocator_type;
 
          template<typename T>
          undo_state( allocator<T> al )
          :old_values( id_value_allocator_type( al.get_segment_manager() ) ),
-          removed_values( id_value_allocator_type( al.get_segment_manager() ) ),
-          new_ids( id_allocator_type( al.get_segment_manager() ) ){}
+          removed_values( id_value_allocator_type( al.get_segment_manager() ) ){}
 
          typedef boost::interprocess::map< id_type, value_type, std::less<id_type>, id_value_allocator_type >  id_value_type_map;
-         typedef boost::interprocess::set< id_type, std::less<id_type>, id_allocator_type >                    id_type_set;
+
+         /// true if the object was created during this session
+         bool is_new( const id_type& id )const { return !(id < old_next_id); }
 
          id_value_type_map            old_values;
          id_value_type_map            removed_values;
-         id_type_set                  new_ids;
          id_type                      old_next_id = 0;
          int64_t                      revision = 0;
    };
 
+   /// what the undo states of one index hold, summed over its revisions
+   struct undo_stack_usage {
+      uint64_t revisions = 0;   ///< undo states, revisions without changes to the index have none
+      uint64_t modified  = 0;   ///< copies of modified objects
+      uint64_t removed   = 0;   ///< copies of removed objects
+      uint64_t created   = 0;   ///< objects created since the oldest undo state, undone by id rather than copied
+      uint64_t bytes     = 0;   ///< map nodes of the copies, but not what the copied objects allocate themselves
+   };
+
    /**
     * The code we want to implement is this:
     *
@@ -199,10 +212,11 @@ namespace chainbase {
 
          /**
           * Construct a new element in the multi_index_container.
-          * Set the ID to the next available ID, then increment _next_id and fire off on_create().
+          * Set the ID to the next available ID and then increment _next_id.
           */
          template<typename Constructor>
          const value_type& emplace( Constructor&& c ) {
+            if( enabled() ) head_state();
             auto new_id = _next_id;
 
             auto constructor = [&]( value_type& v ) {
@@ -217,10 +231,30 @@ namespace chainbase {
             }
 
             ++_next_id;
-            on_create( *insert_result.first );
             return *insert_result.first;
          }
 
+         /**
+          * Construct a new element with the given ID, which replicates an object created elsewhere with that ID.
+          * The IDs in between are skipped as if their objects had been created and removed again.
+          */
+         template<typename Constructor>
+         const value_type& emplace_with_id( typename value_type::id_type id, Constructor&& c ) {
+            set_next_id( id );
+            return emplace( std::forward<Constructor>(c) );
+         }
+
+         /// skips the IDs below id, they are never handed out
+         void set_next_id( typename value_type::id_type id ) {
+            if( id < _next_id )
+               BOOST_THROW_EXCEPTION( std::logic_error("cannot hand out an ID again") );
+            if( id == _next_id ) return;
+            if( enabled() ) head_state();
+            _next_id = id;
+         }
+
+         typename value_type::id_type next_id()const { return _next_id; }
+
          /**
           *  @pre modifier cannot change the object in such a way that causes a uniqueness violation for any unique indices
           *  @pre any modifications done within an undo session for a given generic_index must satisfy the condition that the compacted set of modifications in the session can be undone in any order without causing a uniqueness violation in any intermediate step
@@ -237,6 +271,22 @@ namespace chainbase {
             _indices.erase( _indices.iterator_to( obj ) );
          }
 
+         /**
+          * Removes the objects in [first, last) of one of the indices, e.g. a key range looked up once instead of
+          * once per object.
+          * @return the number of objects removed
+          */
+         template<typename Iterator>
+         size_t remove_range( Iterator first, Iterator last ) {
+            size_t removed = 0;
+            while( first != last ) {
+               const value_type& obj = *first++;
+               remove( obj );
+               ++removed;
+            }
+            return removed;
+         }
+
          template<typename CompatibleKey>
          const value_type* find( CompatibleKey&& key )const {
             auto itr = _indices.find( std::forward<CompatibleKey>(key) );
@@ -298,11 +348,14 @@ namespace chainbase {
                int64_t        _revision = 0;
          };
 
+         /**
+          *  Starting a session only bumps the revision. The undo_state of a revision is created the first time an
+          *  object of this index is created, modified or removed in it, so indices a session never touches cost
+          *  nothing to start, squash, undo or commit.
+          */
          session start_undo_session( bool enabled ) {
             if( enabled ) {
-               _stack.emplace_back( _indices.get_allocator() );
-               _stack.back().old_next_id = _next_id;
-               _stack.back().revision = ++_revision;
+               ++_revision;
                return session( *this, _revision );
             } else {
                return session( *this, -1 );
@@ -321,27 +374,26 @@ namespace chainbase {
          void undo() {
             if( !enabled() ) return;
 
-            const auto& head = _stack.back();
+            if( const auto* state = head_undo_state() ) {
+               const auto& head = *state;
 
-            for( auto id : head.new_ids )
-            {
-               _indices.erase( _indices.find( id ) );
-            }
-            _next_id = head.old_next_id;
+               _indices.erase( _indices.lower_bound( head.old_next_id ), _indices.end() );
+               _next_id = head.old_next_id;
 
-            for( auto& item : head.old_values ) {
-               auto ok = _indices.modify( _indices.find( item.second.id ), [&]( value_type& v ) {
-                  v = std::move( item.second );
-               });
-               if( !ok ) std::abort(); // uniqueness violation
-            }
+               for( auto& item : head.old_values ) {
+                  auto ok = _indices.modify( _indices.find( item.second.id ), [&]( value_type& v ) {
+                     v = std::move( item.second );
+                  });
+                  if( !ok ) std::abort(); // uniqueness violation
+               }
 
-            for( auto& item : head.removed_values ) {
-               bool ok = _indices.emplace( std::move( item.second ) ).second;
-               if( !ok ) std::abort(); // uniqueness violation
-            }
+               for( auto& item : head.removed_values ) {
+                  bool ok = _indices.emplace( std::move( item.second ) ).second;
+                  if( !ok ) std::abort(); // uniqueness violation
+               }
 
-            _stack.pop_back();
+               _stack.pop_back();
+            }
             --_revision;
          }
 
@@ -354,8 +406,22 @@ namespace chainbase {
          void squash()
          {
             if( !enabled() ) return;
-            if( _stack.size() == 1 ) {
-               _stack.pop_front();
+            if( _revision - 1 == _undo_floor ) {
+               // squashing the oldest revision makes its changes permanent
+               if( head_undo_state() ) _stack.pop_back();
+               --_revision;
+               return;
+            }
+
+            if( !head_undo_state() ) {
+               // nothing was recorded in the squashed revision
+               --_revision;
+               return;
+            }
+
+            if( _stack.size() < 2 || _stack[_stack.size()-2].revision != _revision - 1 ) {
+               // nothing was recorded in the prior revision, so the head state becomes its state unchanged
+               _stack.back().revision = _revision - 1;
                --_revision;
                return;
             }
@@ -364,7 +430,7 @@ namespace chainbase {
             auto& prev_state = _stack[_stack.size()-2];
 
             // An object's relationship to a state can be:
-            // in new_ids            : new
+            // id >= old_next_id     : new
             // in old_values (was=X) : upd(was=X)
             // in removed (was=X)    : del(was=X)
             // not in any of above   : nop
@@ -407,7 +473,7 @@ namespace chainbase {
 
             for( const auto& item : state.old_values )
             {
-               if( prev_state.new_ids.find( item.second.id ) != prev_state.new_ids.end() )
+               if( prev_state.is_new( item.second.id ) )
                {
                   // new+upd -> new, type A
                   continue;
@@ -423,17 +489,15 @@ namespace chainbase {
                prev_state.old_values.emplace( std::move(item) );
             }
 
-            // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
-            for( auto id : state.new_ids )
-               prev_state.new_ids.insert(id);
+            // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new which is implied
+            // by prev_state.old_next_id
 
             // *+del
             for( auto& obj : state.removed_values )
             {
-               if( prev_state.new_ids.find(obj.second.id) != prev_state.new_ids.end() )
+               if( prev_state.is_new( obj.second.id ) )
                {
                   // new + del -> nop (type C)
-                  prev_state.new_ids.erase(obj.second.id);
                   continue;
                }
                auto it = prev_state.old_values.find(obj.second.id);
@@ -463,6 +527,7 @@ namespace chainbase {
             {
                _stack.pop_front();
             }
+            _undo_floor = std::max( _undo_floor, std::min( revision, _revision ) );
          }
 
          /**
@@ -476,13 +541,14 @@ namespace chainbase {
 
          void set_revision( uint64_t revision )
          {
-            if( _stack.size() != 0 )
+            if( _stack.size() != 0 || enabled() )
                BOOST_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
 
             if( revision > std::numeric_limits<int64_t>::max() )
                BOOST_THROW_EXCEPTION( std::logic_error("revision to set is too high") );
 
             _revision = static_cast<int64_t>(revision);
+            _undo_floor = _revision;
          }
 
          void remove_object( int64_t id )
@@ -493,28 +559,53 @@ namespace chainbase {
          }
 
          std::pair<int64_t, int64_t> undo_stack_revision_range()const {
-            int64_t begin = _revision;
-            int64_t end   = _revision;
+            return {_undo_floor, _revision};
+         }
 
-            if( _stack.size() > 0 ) {
-               begin = _stack.front().revision - 1;
-               end   = _stack.back().revision;
-            }
+         const auto& stack()const { return _stack; }
 
-            return {begin, end};
+         /// sums over the revisions of the undo stack, the rows of the index are not visited
+         undo_stack_usage undo_usage()const {
+            // a tree node holds the id/value pair, the parent, child pointers and the color
+            constexpr uint64_t map_node_size = sizeof( typename undo_state_type::id_value_type_map::value_type ) + 4 * sizeof( void* );
+            undo_stack_usage u;
+            u.revisions = _stack.size();
+            for( const auto& state : _stack ) {
+               u.modified += state.old_values.size();
+               u.removed += state.removed_values.size();
+            }
+            if( _stack.size() )
+               u.created = _next_id._id - _stack.front().old_next_id._id;
+            u.bytes = ( u.modified + u.removed ) * map_node_size;
+            return u;
          }
 
-         const auto& stack()const { return _stack; }
+         /// the undo state of the current revision, nullptr if nothing in this index has changed since it started
+         const undo_state_type* head_undo_state()const {
+            if( _stack.size() && _stack.back().revision == _revision )
+               return &_stack.back();
+            return nullptr;
+         }
 
       private:
-         bool enabled()const { return _stack.size(); }
+         /// true while there is a revision that can be undone
+         bool enabled()const { return _revision > _undo_floor; }
+
+         undo_state_type& head_state() {
+            if( !head_undo_state() ) {
+               _stack.emplace_back( _indices.get_allocator() );
+               _stack.back().old_next_id = _next_id;
+               _stack.back().revision = _revision;
+            }
+            return _stack.back();
+         }
 
          void on_modify( const value_type& v ) {
             if( !enabled() ) return;
 
-            auto& head = _stack.back();
+            auto& head = head_state();
 
-            if( head.new_ids.find( v.id ) != head.new_ids.end() )
+            if( head.is_new( v.id ) )
                return;
 
             auto itr = head.old_values.find( v.id );
@@ -527,11 +618,9 @@ namespace chainbase {
          void on_remove( const value_type& v ) {
             if( !enabled() ) return;
 
-            auto& head = _stack.back();
-            if( head.new_ids.count(v.id) ) {
-               head.new_ids.erase( v.id );
+            auto& head = head_state();
+            if( head.is_new( v.id ) )
                return;
-            }
 
             auto itr = head.old_values.find( v.id );
             if( itr != head.old_values.end() ) {
@@ -546,13 +635,6 @@ namespace chainbase {
             head.removed_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) );
          }
 
-         void on_create( const value_type& v ) {
-            if( !enabled() ) return;
-            auto& head = _stack.back();
-
-            head.new_ids.insert( v.id );
-         }
-
          boost::interprocess::deque< undo_state_type, allocator<undo_state_type> > _stack;
 
          /**
@@ -562,6 +644,8 @@ namespace chainbase {
           *  Commit will discard all revisions prior to the committed revision.
           */
          int64_t                         _revision = 0;
+         int64_t                         _undo_floor = 0; ///< revisions above this one can still be undone
+
          typename value_type::id_type    _next_id = 0;
          index_type                      _indices;
          uint32_t                        _size_of_value_type = 0;
@@ -598,6 +682,7 @@ namespace chainbase {
          virtual ~abstract_index(){}
          virtual void     set_revision( uint64_t revision ) = 0;
          virtual unique_ptr<abstract_session> start_undo_session( bool enabled ) = 0;
+         virtual int64_t  start_undo_revision() = 0;
 
          virtual int64_t revision()const = 0;
          virtual void    undo()const = 0;
@@ -606,8 +691,10 @@ namespace chainbase {
          virtual void    undo_all()const = 0;
          virtual uint32_t type_id()const  = 0;
          virtual uint64_t row_count()const = 0;
+         virtual uint64_t node_size()const = 0;
          virtual const std::string& type_name()const = 0;
          virtual std::pair<int64_t, int64_t> undo_stack_revision_range()const = 0;
+         virtual undo_stack_usage undo_usage()const = 0;
 
          virtual void remove_object( int64_t id ) = 0;
 
@@ -625,6 +712,13 @@ namespace chainbase {
             return unique_ptr<abstract_session>(new session_impl<typename BaseIndex::session>( _base.start_undo_session( enabled ) ) );
          }
 
+         /// starts a session whose undo is driven by database::session rather than by a session object of its own
+         virtual int64_t start_undo_revision() override {
+            auto s = _base.start_undo_session( true );
+            s.push();
+            return s.revision();
+         }
+
          virtual void     set_revision( uint64_t revision ) override { _base.set_revision( revision ); }
          virtual int64_t  revision()const  override { return _base.revision(); }
          virtual void     undo()const  override { _base.undo(); }
@@ -633,8 +727,10 @@ namespace chainbase {
          virtual void     undo_all() const override {_base.undo_all(); }
          virtual uint32_t type_id()const override { return BaseIndex::value_type::type_id; }
          virtual uint64_t row_count()const override { return _base.indices().size(); }
+         virtual uint64_t node_size()const override { return sizeof( typename BaseIndex::index_type::node_type ); }
          virtual const std::string& type_name() const override { return BaseIndex_name; }
          virtual std::pair<int64_t, int64_t> undo_stack_revision_range()const override { return _base.undo_stack_revision_range(); }
+         virtual undo_stack_usage undo_usage()const override { return _base.undo_usage(); }
 
          virtual void     remove_object( int64_t id ) override { return _base.remove_object( id ); }
       private:
@@ -649,6 +745,20 @@ namespace chainbase {
    };
 
 
+   /**
+    *  Follows the undo sessions of a database, for state kept outside of it that has to be undone and squashed
+    *  along with the database. Each call is made after the database has changed its revision.
+    */
+   class undo_observer
+   {
+      public:
+         virtual ~undo_observer(){}
+         virtual void on_start_undo_session( int64_t revision ) = 0;
+         virtual void on_undo( int64_t revision ) = 0;   ///< @param revision the revision after the undo
+         virtual void on_squash( int64_t revision ) = 0; ///< @param revision the revision after the squash
+         virtual void on_commit( int64_t revision ) = 0;
+   };
+
    class read_write_mutex_manager
    {
       public:
@@ -702,6 +812,28 @@ namespace chainbase {
          database& operator=(database&&) = default;
          bool is_read_only() const { return _read_only; }
          void flush();
+
+         /// @see pinnable_mapped_file::checkpoint
+         bool checkpoint(const std::function<bool()>& flushed = std::function<bool()>()) { return _db_file.checkpoint(flushed); }
+
+         /// @see pinnable_mapped_file::checkpoint_running
+         bool checkpoint_running() { return _db_file.checkpoint_running(); }
+
+         /// @see pinnable_mapped_file::mark_pages_cold
+         size_t mark_pages_cold() { return _db_file.mark_pages_cold(); }
+
+         /// @see pinnable_mapped_file::save_resident_pages
+         size_t save_resident_pages() { return _db_file.save_resident_pages(); }
+
+         /// @see pinnable_mapped_file::load_resident_pages
+         std::vector<std::pair<size_t, size_t>> load_resident_pages()const { return _db_file.load_resident_pages(); }
+
+         /// @see pinnable_mapped_file::prefetch
+         void prefetch( size_t offset, size_t size ) { _db_file.prefetch( offset, size ); }
+
+         /// @see pinnable_mapped_file::is_process_private
+         bool is_process_private()const { return _db_file.is_process_private(); }
+
          void set_require_locking( bool enable_require_locking );
 
 #ifdef CHAINBASE_CHECK_LOCKING
@@ -722,12 +854,7 @@ namespace chainbase {
 
          struct session {
             public:
-               session( session&& s ):_index_sessions( std::move(s._index_sessions) ),_revision( s._revision ){}
-               session( vector<std::unique_ptr<abstract_session>>&& s ):_index_sessions( std::move(s) )
-               {
-                  if( _index_sessions.size() )
-                     _revision = _index_sessions[0]->revision();
-               }
+               session( session&& s ):_db( s._db ),_revision( s._revision ){ s._db = nullptr; }
 
                ~session() {
                   undo();
@@ -735,20 +862,19 @@ namespace chainbase {
 
                void push()
                {
-                  for( auto& i : _index_sessions ) i->push();
-                  _index_sessions.clear();
+                  _db = nullptr;
                }
 
                void squash()
                {
-                  for( auto& i : _index_sessions ) i->squash();
-                  _index_sessions.clear();
+                  if( _db ) _db->squash();
+                  _db = nullptr;
                }
 
                void undo()
                {
-                  for( auto& i : _index_sessions ) i->undo();
-                  _index_sessions.clear();
+                  if( _db ) _db->undo();
+                  _db = nullptr;
                }
 
                int64_t revision()const { return _revision; }
@@ -756,9 +882,10 @@ namespace chainbase {
             private:
                friend class database;
                session(){}
+               session( database& db, int64_t revision ):_db( &db ),_revision( revision ){}
 
-               vector< std::unique_ptr<abstract_session> > _index_sessions;
-               int64_t _revision = -1;
+               database* _db = nullptr;
+               int64_t   _revision = -1;
          };
 
          session start_undo_session( bool enabled );
@@ -773,6 +900,17 @@ namespace chainbase {
          void commit( int64_t revision );
          void undo_all();
 
+         /// the revisions above first can still be undone, up to and including second
+         std::pair<int64_t, int64_t> undo_stack_revision_range()const {
+            if( _index_list.size() == 0 ) return {0, 0};
+            return _index_list[0]->undo_stack_revision_range();
+         }
+
+         void add_undo_observer( undo_observer& observer ) { _undo_observers.push_back( &observer ); }
+         void remove_undo_observer( undo_observer& observer ) {
+            _undo_observers.erase( std::remove( _undo_observers.begin(), _undo_observers.end(), &observer ), _undo_observers.end() );
+         }
+
 
          void set_revision( uint64_t revision )
          {
@@ -862,6 +1000,14 @@ namespace chainbase {
             return _db_file.get_segment_manager()->get_free_memory();
          }
 
+         /**
+          * The largest single allocation the segment can currently satisfy, read from the largest block in the
+          * allocator's free tree without allocating, so it works on read only databases. The further this is below
+          * get_free_memory() the more fragmented the free space is. Like other reads it must not race the thread
+          * changing the database.
+          */
+         size_t get_largest_free_block()const;
+
          template<typename MultiIndexType>
          const generic_index<MultiIndexType>& get_index()const
          {
@@ -967,6 +1113,58 @@ namespace chainbase {
              return get_mutable_index<index_type>().emplace( std::forward<Constructor>(con) );
          }
 
+         struct index_usage {
+            std::string   type_name;
+            uint64_t      row_count = 0;
+            uint64_t      node_size = 0; ///< bytes of one container node including every index's links, but not what the object allocates itself
+         };
+
+         struct index_undo_usage {
+            std::string        type_name;
+            undo_stack_usage   usage;
+         };
+
+         std::vector<index_undo_usage> undo_usage_per_index()const {
+            std::vector<index_undo_usage> ret;
+            for( const auto* ai_ptr : _index_list )
+               ret.push_back( {ai_ptr->type_name(), ai_ptr->undo_usage()} );
+            return ret;
+         }
+
+         /// how often and how long an undo stack operation ran, over all indices at once
+         struct operation_timing {
+            uint64_t count    = 0;
+            uint64_t total_ns = 0;
+            uint64_t max_ns   = 0;
+            uint64_t last_ns  = 0;
+
+            void add( uint64_t ns ) {
+               ++count;
+               total_ns += ns;
+               max_ns = std::max( max_ns, ns );
+               last_ns = ns;
+            }
+         };
+
+         struct undo_timings {
+            operation_timing undo;     ///< includes undo_all
+            operation_timing squash;
+            operation_timing commit;
+         };
+
+         /// kept by this process only, written by the thread modifying the database
+         const undo_timings& get_undo_timings()const { return _undo_timings; }
+
+         std::vector<index_usage> usage_per_index()const {
+            std::vector<index_usage> ret;
+            for(const auto& ai_ptr : _index_map) {
+               if(!ai_ptr)
+                  continue;
+               ret.push_back({ai_ptr->type_name(), ai_ptr->row_count(), ai_ptr->node_size()});
+            }
+            return ret;
+         }
+
          database_index_row_count_multiset row_count_per_index()const {
             database_index_row_count_multiset ret;
             for(const auto& ai_ptr : _index_map) {
@@ -991,6 +1189,10 @@ namespace chainbase {
           */
          vector<unique_ptr<abstract_index>>                          _index_map;
 
+         vector<undo_observer*>                                      _undo_observers;
+
+         undo_timings                                                _undo_timings;
+
 #ifdef CHAINBASE_CHECK_LOCKING
          int32_t                                                     _read_lock_count = 0;
          int32_t                                                     _write_lock_count = 0;
@@ -5,7 +5,9 @@
 namespace chainbase {
 
 constexpr size_t header_size = 1024;
-constexpr uint64_t header_id = 0x3242444f49534f45ULL; //"ROXEDB2" little endian
+constexpr uint64_t header_id = 0x3342444f49534f45ULL; //"ROXEDB3" little endian
+/// files from before undo states stopped recording created ids; they cannot be converted, see README.md
+constexpr uint64_t header_id_without_id_ranges = 0x3242444f49534f45ULL; //"ROXEDB2" little endian
 
 struct environment  {
    environment() {
@@ -4,6 +4,9 @@
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/asio/io_service.hpp>
+#include <functional>
+#include <utility>
+#include <vector>
 
 namespace chainbase {
 
@@ -29,20 +32,80 @@ class pinnable_mapped_file {
 
       segment_manager* get_segment_manager() const { return _segment_manager;}
 
+      /**
+       * In heap or locked mode, writes the database back to the state file as it is at the time of the call, then
+       * clears the dirty flag of the file so that it can be opened again should the process die before shutdown.
+       * Only the pages changed since they were last written go to the file. Where the kernel tracks soft-dirty pages
+       * for heap mode memory they are found from /proc/self/pagemap, otherwise by comparing every page with the file.
+       *
+       * In heap mode on posix a forked child writes the copy-on-write image of the database and this returns right
+       * away, the caller goes on changing the database meanwhile. The database must only be changed from the thread
+       * calling this. In locked mode the pages are written before this returns. Does nothing in mapped mode where the
+       * file is the database.
+       *
+       * @param flushed called once the pages are synced, before the dirty flag is cleared which it keeps set by
+       *                returning false. In heap mode it runs in the forked child and must do nothing but write files.
+       * @return false if no checkpoint was started, also while the previous one is still running
+       */
+      bool checkpoint(const std::function<bool()>& flushed = std::function<bool()>());
+
+      /// @return true while the child started by checkpoint() is writing, reaps it once it has exited
+      bool checkpoint_running();
+
+      /**
+       * In mapped mode, tells the kernel that the pages of the database are cold. Pages which are touched again before
+       * memory runs short are kept, the rest are the first to be written back to the file and dropped from memory, and
+       * are read back in from the file when next touched. Done periodically this keeps the rows accessed recently in
+       * memory and lets the ones left alone since the previous call go to disk. Does nothing in heap or locked mode, or
+       * where the kernel does not support it.
+       *
+       * @return the number of bytes advised
+       */
+      size_t mark_pages_cold();
+
+      /**
+       * In mapped mode, records which pages of the database are in memory, as ranges of pages, in shared_memory.hot
+       * next to the database file. After a restart prefetch() of the recorded ranges brings back the pages that were
+       * in use. Does nothing in heap or locked mode where the whole database is in memory.
+       *
+       * @return the number of bytes in memory
+       */
+      size_t save_resident_pages();
+
+      /// @return the ranges recorded by save_resident_pages, as offsets and sizes in bytes, empty if there are none for this database
+      std::vector<std::pair<size_t, size_t>> load_resident_pages() const;
+
+      /// in mapped mode, asks the kernel to start reading the given range of the database file into memory
+      void prefetch(size_t offset, size_t size);
+
+      /**
+       * In heap mode the database lives in memory private to this process. A forked child then keeps the database
+       * as it was at the fork, copy-on-write, while this process goes on changing it.
+       */
+      bool is_process_private() const { return _private_region != nullptr; }
+
    private:
-      void                                          set_mapped_file_db_dirty(bool);
+      bool                                          set_mapped_file_db_dirty(bool);
       void                                          load_database_file(boost::asio::io_service& sig_ios);
       void                                          save_database_file();
-      bool                                          all_zeros(char* data, size_t sz);
+      bool                                          write_changed_pages(bool print_progress, size_t& written);
+      void                                          track_changed_pages();
+      void                                          wait_for_checkpoint();
       bip::mapped_region                            get_huge_region(const std::vector<std::string>& huge_paths);
+      char*                                         memory_address() const;
 
       bip::file_lock                                _mapped_file_lock;
       bfs::path                                     _data_file_path;
+      bfs::path                                     _resident_pages_path;
       std::string                                   _database_name;
       bool                                          _writable;
 
       bip::mapped_region                            _file_mapped_region;
       bip::mapped_region                            _mapped_region;
+      void*                                         _private_region = nullptr; ///< heap mode memory, on posix
+      size_t                                        _private_region_size = 0;
+      int                                           _checkpoint_pid = 0;       ///< child writing a checkpoint, heap mode on posix
+      uint64_t                                      _soft_dirty_clear = 0;     ///< clear of the soft-dirty bits since which changes are tracked, 0 if not
 
 #ifdef _WIN32
       bip::permissions                              _db_permissions;
@@ -53,6 +116,8 @@ class pinnable_mapped_file {
       segment_manager*                              _segment_manager = nullptr;
 
       constexpr static unsigned                     _db_size_multiple_requirement = 1024*1024; //1MB
+      constexpr static unsigned                     _checkpoint_page_size = 4096;
+      constexpr static unsigned                     _max_preload_threads = 16;
 };
 
 std::istream& operator>>(std::istream& in, pinnable_mapped_file::map_mode& runtime);
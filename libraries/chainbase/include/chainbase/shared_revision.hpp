@@ -0,0 +1,75 @@
+#pragma once
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace chainbase {
+
+namespace bip = boost::interprocess;
+namespace bfs = boost::filesystem;
+
+/**
+ * A reader/writer lock in a small file next to shared_memory.bin through which the one process changing a database
+ * in mapped mode and the processes mapping the same file read-only take turns.
+ *
+ * The writer holds the lock exclusively for a span of changes, typically one block. A reader holds it shared for
+ * the whole of a query, so it never follows the nodes of an index the writer is changing, and so that the writer
+ * waits for the queries in progress before it changes the database. Once a writer waits, new readers wait for it.
+ * With the revision the writer publishes an opaque payload, e.g. the head block, which is read under the same lock.
+ * Readers map the state itself read-only but need write access to this file to take the lock.
+ */
+class shared_revision {
+   public:
+      static constexpr size_t max_payload_size = 256 * 1024;
+
+      /// the writer creates the file, readers require that it exists
+      shared_revision(const bfs::path& dir, bool writable);
+      ~shared_revision();
+
+      shared_revision(const shared_revision&) = delete;
+      shared_revision& operator=(const shared_revision&) = delete;
+
+      /**
+       * writer: takes the lock, the database is about to change; the writer holds it from its start to its first
+       * end_write(). Readers hold the lock only for a query, one which still holds it after max_wait died within
+       * its query, the lock is set up again then.
+       *
+       * @return false when the lock had to be set up again
+       */
+      bool begin_write(std::chrono::milliseconds max_wait = std::chrono::milliseconds(5000));
+      /// writer: the changes are done and the database holds revision, releases the lock
+      void end_write(int64_t revision, const char* payload, size_t size);
+
+      /// reader: waits while the writer changes the database and holds the lock shared, throws when the wait runs out
+      void begin_read(std::chrono::milliseconds max_wait = std::chrono::milliseconds(5000))const;
+      /// reader: releases the lock taken by begin_read()
+      void end_read()const;
+
+      /// the revision of the last span, read it between begin_read() and end_read()
+      int64_t revision()const;
+      /// a copy of the payload of the last span, read it between begin_read() and end_read()
+      std::vector<char> payload()const;
+
+      /// the number of spans ended since the file was created, read it between begin_read() and end_read()
+      uint64_t spans()const;
+      /// a writer has the file open, or had when it died
+      bool writer_attached()const;
+
+      static bfs::path file_path(const bfs::path& dir) { return dir / "shared_memory.rev"; }
+
+   private:
+      struct data;
+
+      data* get()const { return reinterpret_cast<data*>(_region.get_address()); }
+
+      bool               _writable;
+      bool               _writing = false;
+      bip::mapped_region _region;
+};
+
+}
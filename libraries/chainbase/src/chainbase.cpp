@@ -1,6 +1,7 @@
 #include <chainbase/chainbase.hpp>
 #include <boost/array.hpp>
 
+#include <chrono>
 #include <iostream>
 
 #ifndef _WIN32
@@ -38,47 +39,103 @@ namespace chainbase {
    }
 #endif
 
+   namespace {
+      typedef pinnable_mapped_file::segment_manager::memory_algorithm memory_algorithm;
+
+      // rbtree_best_fit keeps its free blocks in a private tree ordered by size. Names in an explicit instantiation
+      // are not access checked, which lets free_blocks_header() hand out the member holding the tree.
+      struct free_blocks_tag { friend auto free_blocks_header( free_blocks_tag ); };
+      template<auto Header>
+      struct expose_free_blocks { friend auto free_blocks_header( free_blocks_tag ) { return Header; } };
+      template struct expose_free_blocks<&memory_algorithm::m_header>;
+   }
+
+   size_t database::get_largest_free_block()const
+   {
+      // only reads the tree, read only mappings included; the C style cast reaches the private base
+      const auto* algo = (const memory_algorithm*)_db_file.get_segment_manager();
+      const auto& free_blocks = (algo->*free_blocks_header( free_blocks_tag{} )).m_imultiset;
+      if( free_blocks.empty() )
+         return 0;
+      const size_t units = free_blocks.rbegin()->m_size;
+      return units * memory_algorithm::Alignment - memory_algorithm::PayloadPerAllocation;
+   }
+
+   namespace {
+      /// adds the time until it goes out of scope to an operation_timing
+      struct scoped_timing {
+         explicit scoped_timing( database::operation_timing& t ):timing( t ) {}
+         ~scoped_timing() {
+            timing.add( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count() );
+         }
+         database::operation_timing&                  timing;
+         const std::chrono::steady_clock::time_point  start = std::chrono::steady_clock::now();
+      };
+   }
+
    void database::undo()
    {
+      scoped_timing t( _undo_timings.undo );
       for( auto& item : _index_list )
       {
          item->undo();
       }
+      for( auto* observer : _undo_observers )
+      {
+         observer->on_undo( revision() );
+      }
    }
 
    void database::squash()
    {
+      scoped_timing t( _undo_timings.squash );
       for( auto& item : _index_list )
       {
          item->squash();
       }
+      for( auto* observer : _undo_observers )
+      {
+         observer->on_squash( revision() );
+      }
    }
 
    void database::commit( int64_t revision )
    {
+      scoped_timing t( _undo_timings.commit );
       for( auto& item : _index_list )
       {
          item->commit( revision );
       }
+      for( auto* observer : _undo_observers )
+      {
+         observer->on_commit( revision );
+      }
    }
 
    void database::undo_all()
    {
+      scoped_timing t( _undo_timings.undo );
       for( auto& item : _index_list )
       {
          item->undo_all();
       }
+      for( auto* observer : _undo_observers )
+      {
+         observer->on_undo( revision() );
+      }
    }
 
    database::session database::start_undo_session( bool enabled )
    {
-      if( enabled ) {
-         vector< std::unique_ptr<abstract_session> > _sub_sessions;
-         _sub_sessions.reserve( _index_list.size() );
+      if( enabled && _index_list.size() ) {
+         int64_t revision = -1;
          for( auto& item : _index_list ) {
-            _sub_sessions.push_back( item->start_undo_session( enabled ) );
+            revision = item->start_undo_revision();
+         }
+         for( auto* observer : _undo_observers ) {
+            observer->on_start_undo_session( revision );
          }
-         return session( std::move( _sub_sessions ) );
+         return session( *this, revision );
       } else {
          return session();
       }
@@ -3,18 +3,88 @@
 #include <boost/interprocess/managed_external_buffer.hpp>
 #include <boost/interprocess/anonymous_shared_memory.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
 #ifdef __linux__
 #include <sys/vfs.h>
 #include <linux/magic.h>
 #endif
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace chainbase {
 
+namespace {
+   constexpr uint64_t pagemap_soft_dirty = 1ull << 55;
+
+#ifdef __linux__
+   /// bumped on every clear of the soft-dirty bits, which are shared by all the databases of the process
+   std::atomic<uint64_t> soft_dirty_clears{0};
+
+   bool clear_soft_dirty() {
+      int fd = open("/proc/self/clear_refs", O_WRONLY);
+      if(fd < 0)
+         return false;
+      bool cleared = write(fd, "4", 1) == 1;
+      close(fd);
+      if(cleared)
+         ++soft_dirty_clears;
+      return cleared;
+   }
+
+   /// reads the /proc/self/pagemap entries of `count` pages starting at `addr`
+   bool read_pagemap(int fd, const void* addr, uint64_t* entries, size_t count) {
+      const size_t page_size = sysconf(_SC_PAGESIZE);
+      const off_t offset = (uintptr_t)addr / page_size * sizeof(uint64_t);
+      size_t done = 0;
+      while(done != count * sizeof(uint64_t)) {
+         ssize_t r = pread(fd, (char*)entries + done, count * sizeof(uint64_t) - done, offset + done);
+         if(r <= 0)
+            return false;
+         done += r;
+      }
+      return true;
+   }
+
+   /// kernels without CONFIG_MEM_SOFT_DIRTY accept the clear but never set the bit, so try it on a page of our own
+   bool soft_dirty_supported() {
+      static const bool supported = []() {
+         const size_t page_size = sysconf(_SC_PAGESIZE);
+         void* p = mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if(p == MAP_FAILED)
+            return false;
+         *(volatile char*)p = 1;
+         bool works = false;
+         int fd = open("/proc/self/pagemap", O_RDONLY);
+         uint64_t before = 0, after = 0;
+         if(fd >= 0 && clear_soft_dirty() && read_pagemap(fd, p, &before, 1)) {
+            *(volatile char*)p = 2;
+            works = read_pagemap(fd, p, &after, 1) && !(before & pagemap_soft_dirty) && (after & pagemap_soft_dirty);
+         }
+         if(fd >= 0)
+            close(fd);
+         munmap(p, page_size);
+         return works;
+      }();
+      return supported;
+   }
+#endif
+}
+
 pinnable_mapped_file::pinnable_mapped_file(const bfs::path& dir, bool writable, uint64_t shared_file_size, bool allow_dirty,
                                           map_mode mode, std::vector<std::string> hugepage_paths) :
    _data_file_path(bfs::absolute(dir/"shared_memory.bin")),
+   _resident_pages_path(bfs::absolute(dir/"shared_memory.hot")),
    _database_name(dir.filename().string()),
    _writable(writable)
 {
@@ -43,6 +113,9 @@ pinnable_mapped_file::pinnable_mapped_file(const bfs::path& dir, bool writable,
          BOOST_THROW_EXCEPTION(std::runtime_error("Failed to read DB header."));
 
       db_header* dbheader = reinterpret_cast<db_header*>(header);
+      if(dbheader->id == header_id_without_id_ranges)
+         BOOST_THROW_EXCEPTION(std::runtime_error("\"" + _database_name + "\" database was written by an earlier version "
+            "whose undo history has a different layout. Restore it from a snapshot or replay the block log."));
       if(dbheader->id != header_id)
          BOOST_THROW_EXCEPTION(std::runtime_error("\"" + _database_name + "\" database format not compatible with this version of chainbase."));
       if(!allow_dirty && dbheader->dirty)
@@ -96,7 +169,8 @@ pinnable_mapped_file::pinnable_mapped_file(const bfs::path& dir, bool writable,
       if(!_mapped_file_lock.try_lock())
          BOOST_THROW_EXCEPTION(std::runtime_error("could not gain write access to the shared memory file"));
 
-      set_mapped_file_db_dirty(true);
+      if(!set_mapped_file_db_dirty(true))
+         std::cerr << "CHAINBASE: ERROR: syncing buffers failed" << std::endl;
    }
 
    if(mode == mapped) {
@@ -113,8 +187,18 @@ pinnable_mapped_file::pinnable_mapped_file(const bfs::path& dir, bool writable,
       });
 
       try {
-         if(mode == heap)
+         if(mode == heap) {
+#ifndef _WIN32
+            // private rather than shared anonymous memory, so that forked children see the database copy-on-write
+            void* p = mmap(nullptr, _file_mapped_region.get_size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(p == MAP_FAILED)
+               BOOST_THROW_EXCEPTION(std::runtime_error("Failed to allocate memory for database \"" + _database_name + "\""));
+            _private_region = p;
+            _private_region_size = _file_mapped_region.get_size();
+#else
             _mapped_region = bip::mapped_region(bip::anonymous_shared_memory(_file_mapped_region.get_size()));
+#endif
+         }
          else
             _mapped_region = get_huge_region(hugepage_paths);
 
@@ -134,10 +218,16 @@ pinnable_mapped_file::pinnable_mapped_file(const bfs::path& dir, bool writable,
          throw;
       }
 
-      _segment_manager = reinterpret_cast<segment_manager*>((char*)_mapped_region.get_address()+header_size);
+      _segment_manager = reinterpret_cast<segment_manager*>(memory_address()+header_size);
+      if(_writable)
+         track_changed_pages();
    }
 }
 
+char* pinnable_mapped_file::memory_address() const {
+   return _private_region ? (char*)_private_region : (char*)_mapped_region.get_address();
+}
+
 bip::mapped_region pinnable_mapped_file::get_huge_region(const std::vector<std::string>& huge_paths) {
    std::map<unsigned, std::string> page_size_to_paths;
    const auto mapped_file_size = _file_mapped_region.get_size();
@@ -175,61 +265,294 @@ bip::mapped_region pinnable_mapped_file::get_huge_region(const std::vector<std::
 void pinnable_mapped_file::load_database_file(boost::asio::io_service& sig_ios) {
    std::cerr << "CHAINBASE: Preloading \"" << _database_name << "\" database file, this could take a moment..." << std::endl;
    char* const src = (char*)_file_mapped_region.get_address();
-   char* const dst = (char*)_mapped_region.get_address();
-   size_t offset = 0;
+   char* const dst = memory_address();
+   const size_t size = _file_mapped_region.get_size();
+   const size_t num_chunks = size / _db_size_multiple_requirement;
+   const auto start = std::chrono::steady_clock::now();
+
+   // Workers take runs of chunks in turn so that every thread reads large sequential ranges of the file. Each
+   // destination page is first touched by the thread copying it, which spreads the database over the memory of
+   // the nodes those threads run on.
+   const size_t chunks_per_claim = 64;
+   const unsigned num_threads = std::max(1u, std::min(std::thread::hardware_concurrency(), _max_preload_threads));
+   std::atomic<size_t> next_chunk{0};
+   std::atomic<size_t> chunks_done{0};
+   std::atomic<bool>   abort{false};
+
+   std::vector<std::thread> workers;
+   for(unsigned i = 0; i < num_threads; ++i) {
+      workers.emplace_back([&]() {
+         while(!abort) {
+            size_t first = next_chunk.fetch_add(chunks_per_claim);
+            if(first >= num_chunks)
+               break;
+            size_t last = std::min(first + chunks_per_claim, num_chunks);
+            for(size_t c = first; c != last && !abort; ++c) {
+               memcpy(dst+c*_db_size_multiple_requirement, src+c*_db_size_multiple_requirement, _db_size_multiple_requirement);
+               ++chunks_done;
+            }
+         }
+      });
+   }
+
+   try {
+      time_t t = time(nullptr);
+      while(chunks_done != num_chunks) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+         if(time(nullptr) != t) {
+            t = time(nullptr);
+            std::cerr << "              " << chunks_done*100/num_chunks << "% complete..." << std::endl;
+         }
+         sig_ios.poll();
+      }
+   }
+   catch(...) {
+      abort = true;
+      for(auto& w : workers)
+         w.join();
+      throw;
+   }
+   for(auto& w : workers)
+      w.join();
+
+   const auto elapsed_ms = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+   std::cerr << "           Complete, " << size/(1024*1024) << " MiB in " << elapsed_ms << " ms using " << num_threads
+             << " threads (" << size/(1024*1024)*1000/elapsed_ms << " MiB/s)" << std::endl;
+}
+
+bool pinnable_mapped_file::write_changed_pages(bool print_progress, size_t& written) {
+   char* src = memory_address();
+   char* dst = (char*)_file_mapped_region.get_address();
+   const size_t size = _file_mapped_region.get_size();
+   written = 0;
    time_t t = time(nullptr);
-   while(offset != _file_mapped_region.get_size()) {
-      memcpy(dst+offset, src+offset, _db_size_multiple_requirement);
-      offset += _db_size_multiple_requirement;
 
-      if(time(nullptr) != t) {
+   // the flag goes up first so that a file left half written is never taken for a consistent one
+   if(!set_mapped_file_db_dirty(true))
+      return false;
+
+   int pagemap = -1;
+   uint64_t entries[_db_size_multiple_requirement / _checkpoint_page_size];
+#ifdef __linux__
+   // the bits only tell the changes since they were last cleared for this database
+   if(_soft_dirty_clear && _soft_dirty_clear == soft_dirty_clears)
+      pagemap = open("/proc/self/pagemap", O_RDONLY);
+#endif
+   for(size_t offset = 0; offset != size; offset += _db_size_multiple_requirement) {
+      bool soft_dirty = false;
+#ifdef __linux__
+      soft_dirty = pagemap >= 0 && read_pagemap(pagemap, src+offset, entries, _db_size_multiple_requirement / _checkpoint_page_size);
+#endif
+      // only pages that differ are touched so unchanged parts of the file are never dirtied in the page cache
+      for(size_t i = 0; i != _db_size_multiple_requirement / _checkpoint_page_size; ++i) {
+         const size_t page = offset + i*_checkpoint_page_size;
+         if((soft_dirty && !(entries[i] & pagemap_soft_dirty)) || !memcmp(dst+page, src+page, _checkpoint_page_size))
+            continue;
+         memcpy(dst+page, src+page, _checkpoint_page_size);
+         written += _checkpoint_page_size;
+      }
+
+      if(print_progress && time(nullptr) != t) {
          t = time(nullptr);
-         std::cerr << "              " << offset/(_file_mapped_region.get_size()/100) << "% complete..." << std::endl;
+         std::cerr << "              " << (offset+_db_size_multiple_requirement)/(size/100) << "% complete..." << std::endl;
       }
-      sig_ios.poll();
    }
-   std::cerr << "           Complete" << std::endl;
+#ifndef _WIN32
+   if(pagemap >= 0)
+      close(pagemap);
+#endif
+   return _file_mapped_region.flush(0, 0, false);
+}
+
+void pinnable_mapped_file::track_changed_pages() {
+#ifdef __linux__
+   // soft-dirty bits are kept for the private memory of heap mode, in pages of the size compared
+   if(is_process_private() && sysconf(_SC_PAGESIZE) == _checkpoint_page_size && soft_dirty_supported() && clear_soft_dirty())
+      _soft_dirty_clear = soft_dirty_clears;
+   else
+      _soft_dirty_clear = 0;
+#endif
 }
 
-bool pinnable_mapped_file::all_zeros(char* data, size_t sz) {
-   uint64_t* p = (uint64_t*)data;
-   uint64_t* end = p+sz/sizeof(uint64_t);
-   while(p != end) {
-      if(*p++ != 0)
+bool pinnable_mapped_file::checkpoint(const std::function<bool()>& flushed) {
+   if(!_writable || !memory_address() || checkpoint_running())
+      return false;
+
+#ifndef _WIN32
+   if(is_process_private()) {
+      pid_t pid = fork();
+      if(pid < 0) {
+         std::cerr << "CHAINBASE: ERROR: could not fork to write a checkpoint of \"" << _database_name << "\": " << strerror(errno) << std::endl;
          return false;
+      }
+      if(pid == 0) {
+         // the other threads, and the locks they held, did not come along: write files and leave
+         size_t written;
+         bool ok = write_changed_pages(false, written) && (!flushed || flushed()) && set_mapped_file_db_dirty(false);
+         _exit(ok ? 0 : 1);
+      }
+      _checkpoint_pid = pid;
+      // the child has the changes made so far, track the ones made from now on
+      track_changed_pages();
+      return true;
    }
+#endif
+
+   size_t written;
+   if(!write_changed_pages(false, written)) {
+      std::cerr << "CHAINBASE: ERROR: syncing buffers failed" << std::endl;
+      return false;
+   }
+   if(!flushed || flushed())
+      set_mapped_file_db_dirty(false);
    return true;
 }
 
-void pinnable_mapped_file::save_database_file() {
-   std::cerr << "CHAINBASE: Writing \"" << _database_name << "\" database file, this could take a moment..." << std::endl;
-   char* src = (char*)_mapped_region.get_address();
-   char* dst = (char*)_file_mapped_region.get_address();
-   size_t offset = 0;
-   time_t t = time(nullptr);
-   while(offset != _file_mapped_region.get_size()) {
-      if(!all_zeros(src+offset, _db_size_multiple_requirement))
-         memcpy(dst+offset, src+offset, _db_size_multiple_requirement);
-      offset += _db_size_multiple_requirement;
+bool pinnable_mapped_file::checkpoint_running() {
+#ifndef _WIN32
+   if(!_checkpoint_pid)
+      return false;
+   int status = 0;
+   pid_t r = waitpid(_checkpoint_pid, &status, WNOHANG);
+   if(r == 0 || (r < 0 && errno == EINTR))
+      return true;
+   if(r != _checkpoint_pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      // the changes it was given are no longer tracked, compare every page next time
+      std::cerr << "CHAINBASE: ERROR: writing a checkpoint of \"" << _database_name << "\" failed" << std::endl;
+      _soft_dirty_clear = 0;
+   }
+   _checkpoint_pid = 0;
+#endif
+   return false;
+}
 
-      if(time(nullptr) != t) {
-         t = time(nullptr);
-         std::cerr << "              " << offset/(_file_mapped_region.get_size()/100) << "% complete..." << std::endl;
+void pinnable_mapped_file::wait_for_checkpoint() {
+   while(checkpoint_running())
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+size_t pinnable_mapped_file::mark_pages_cold() {
+   if(memory_address())
+      return 0;
+#if defined(MADV_COLD)
+   if(madvise(_file_mapped_region.get_address(), _file_mapped_region.get_size(), MADV_COLD))
+      return 0;
+   return _file_mapped_region.get_size();
+#else
+   return 0;
+#endif
+}
+
+namespace {
+   /// shared_memory.hot: the header, then pairs of the first page and the number of pages of every resident range
+   struct resident_pages_header {
+      uint64_t magic     = 0x544f482d42444843; // "CHDB-HOT"
+      uint64_t file_size = 0;
+      uint64_t page_size = 0;
+      uint64_t ranges    = 0;
+   };
+}
+
+size_t pinnable_mapped_file::save_resident_pages() {
+   if(memory_address() || !_writable)
+      return 0;
+#ifndef _WIN32
+   const size_t page_size = sysconf(_SC_PAGESIZE);
+   const size_t size = _file_mapped_region.get_size();
+   std::vector<unsigned char> resident((size + page_size - 1) / page_size);
+   if(mincore(_file_mapped_region.get_address(), size, resident.data()))
+      return 0;
+
+   std::vector<uint64_t> ranges;
+   size_t resident_pages = 0;
+   for(size_t page = 0; page < resident.size(); ) {
+      if(!(resident[page] & 1)) {
+         ++page;
+         continue;
       }
+      size_t end = page + 1;
+      while(end < resident.size() && (resident[end] & 1))
+         ++end;
+      ranges.push_back(page);
+      ranges.push_back(end - page);
+      resident_pages += end - page;
+      page = end;
+   }
+
+   resident_pages_header header;
+   header.file_size = size;
+   header.page_size = page_size;
+   header.ranges = ranges.size() / 2;
+   const bfs::path tmp = _resident_pages_path.string() + ".tmp";
+   {
+      std::ofstream out(tmp.string(), std::ios::binary | std::ios::trunc);
+      out.write((const char*)&header, sizeof(header));
+      out.write((const char*)ranges.data(), ranges.size() * sizeof(uint64_t));
+      if(!out)
+         return 0;
+   }
+   boost::system::error_code ec;
+   bfs::rename(tmp, _resident_pages_path, ec);
+   return ec ? 0 : resident_pages * page_size;
+#else
+   return 0;
+#endif
+}
+
+std::vector<std::pair<size_t, size_t>> pinnable_mapped_file::load_resident_pages() const {
+   std::vector<std::pair<size_t, size_t>> result;
+   if(memory_address())
+      return result;
+   std::ifstream in(_resident_pages_path.string(), std::ios::binary);
+   resident_pages_header header;
+   if(!in.read((char*)&header, sizeof(header)) || header.magic != resident_pages_header().magic ||
+      header.file_size != _file_mapped_region.get_size() || header.page_size == 0)
+      return result;
+   result.reserve(header.ranges);
+   for(uint64_t i = 0; i < header.ranges; ++i) {
+      uint64_t range[2];
+      if(!in.read((char*)range, sizeof(range)))
+         return {};
+      const size_t offset = range[0] * header.page_size;
+      if(offset >= header.file_size)
+         return {};
+      result.emplace_back(offset, std::min<size_t>(range[1] * header.page_size, header.file_size - offset));
    }
-   std::cerr << "           Syncing buffers..." << std::endl;
-   if(_file_mapped_region.flush(0, 0, false) == false)
+   return result;
+}
+
+void pinnable_mapped_file::prefetch(size_t offset, size_t size) {
+#ifndef _WIN32
+   if(memory_address() || offset >= _file_mapped_region.get_size())
+      return;
+   size = std::min(size, _file_mapped_region.get_size() - offset);
+   madvise((char*)_file_mapped_region.get_address() + offset, size, MADV_WILLNEED);
+#endif
+}
+
+void pinnable_mapped_file::save_database_file() {
+   wait_for_checkpoint();
+   std::cerr << "CHAINBASE: Writing \"" << _database_name << "\" database file, this could take a moment..." << std::endl;
+   size_t written;
+   if(!write_changed_pages(true, written))
       std::cerr << "CHAINBASE: ERROR: syncing buffers failed" << std::endl;
-   std::cerr << "           Complete" << std::endl;
+   std::cerr << "           Complete, " << written/(1024*1024) << " MiB written" << std::endl;
 }
 
 pinnable_mapped_file::pinnable_mapped_file(pinnable_mapped_file&& o) :
    _mapped_file_lock(std::move(o._mapped_file_lock)),
    _data_file_path(std::move(o._data_file_path)),
+   _resident_pages_path(std::move(o._resident_pages_path)),
    _database_name(std::move(o._database_name)),
    _file_mapped_region(std::move(o._file_mapped_region)),
    _mapped_region(std::move(o._mapped_region))
 {
+   _private_region = o._private_region;
+   _private_region_size = o._private_region_size;
+   o._private_region = nullptr;
+   _checkpoint_pid = o._checkpoint_pid;
+   o._checkpoint_pid = 0;
+   _soft_dirty_clear = o._soft_dirty_clear;
    _segment_manager = o._segment_manager;
    _writable = o._writable;
    o._writable = false; //prevent dtor from doing anything interesting
@@ -238,9 +561,14 @@ pinnable_mapped_file::pinnable_mapped_file(pinnable_mapped_file&& o) :
 pinnable_mapped_file& pinnable_mapped_file::operator=(pinnable_mapped_file&& o) {
    _mapped_file_lock = std::move(o._mapped_file_lock);
    _data_file_path = std::move(o._data_file_path);
+   _resident_pages_path = std::move(o._resident_pages_path);
    _database_name = std::move(o._database_name);
    _file_mapped_region = std::move(o._file_mapped_region);
    _mapped_region = std::move(o._mapped_region);
+   std::swap(_private_region, o._private_region);
+   std::swap(_private_region_size, o._private_region_size);
+   std::swap(_checkpoint_pid, o._checkpoint_pid);
+   _soft_dirty_clear = o._soft_dirty_clear;
    _segment_manager = o._segment_manager;
    _writable = o._writable;
    o._writable = false; //prevent dtor from doing anything interesting
@@ -249,19 +577,23 @@ pinnable_mapped_file& pinnable_mapped_file::operator=(pinnable_mapped_file&& o)
 
 pinnable_mapped_file::~pinnable_mapped_file() {
    if(_writable) {
-      if(_mapped_region.get_address()) //in heap or locked mode
+      if(memory_address()) //in heap or locked mode
          save_database_file();
       else
          if(_file_mapped_region.flush(0, 0, false) == false)
             std::cerr << "CHAINBASE: ERROR: syncing buffers failed" << std::endl;
-      set_mapped_file_db_dirty(false);
+      if(!set_mapped_file_db_dirty(false))
+         std::cerr << "CHAINBASE: ERROR: syncing buffers failed" << std::endl;
    }
+#ifndef _WIN32
+   if(_private_region)
+      munmap(_private_region, _private_region_size);
+#endif
 }
 
-void pinnable_mapped_file::set_mapped_file_db_dirty(bool dirty) {
+bool pinnable_mapped_file::set_mapped_file_db_dirty(bool dirty) {
    *((char*)_file_mapped_region.get_address()+header_dirty_bit_offset) = dirty;
-   if(_file_mapped_region.flush(0, 0, false) == false)
-      std::cerr << "CHAINBASE: ERROR: syncing buffers failed" << std::endl;
+   return _file_mapped_region.flush(0, 0, false);
 }
 
 std::istream& operator>>(std::istream& in, pinnable_mapped_file::map_mode& runtime) {
@@ -0,0 +1,141 @@
+#include <chainbase/shared_revision.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace chainbase {
+
+struct shared_revision::data {
+   uint64_t                             id;
+   bip::interprocess_sharable_mutex     lock;
+   uint64_t                             spans;
+   int64_t                              revision;
+   uint32_t                             payload_size;
+   std::atomic<uint32_t>                writer_pid;    ///< 0 once the writer closed the file
+   char                                 payload[max_payload_size];
+};
+
+namespace {
+   constexpr uint64_t shared_revision_id = 0x32766572'62646863ULL; // "chdbrev2"
+
+   static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                 "the writer pid is shared between processes and so has to be lock free");
+
+   boost::posix_time::ptime deadline_after(std::chrono::milliseconds wait) {
+      return boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(wait.count());
+   }
+}
+
+shared_revision::shared_revision(const bfs::path& dir, bool writable)
+:_writable(writable) {
+   const auto path = file_path(dir);
+   if(!_writable && !bfs::exists(path))
+      BOOST_THROW_EXCEPTION(std::runtime_error("no revision published at " + path.string() + ", is the writer running with it enabled?"));
+   if(_writable && (!bfs::exists(path) || bfs::file_size(path) != sizeof(data))) {
+      bfs::create_directories(dir);
+      std::ofstream ofs(path.generic_string(), std::ofstream::trunc);
+      ofs.close();
+      bfs::resize_file(path, sizeof(data));
+   }
+   // readers change the lock, so every process maps the file writable
+   _region = bip::mapped_region(bip::file_mapping(path.generic_string().c_str(), bip::read_write), bip::read_write);
+   if(_region.get_size() < sizeof(data))
+      BOOST_THROW_EXCEPTION(std::runtime_error("revision file " + path.string() + " is truncated"));
+
+   data* d = get();
+   if(_writable) {
+      if(d->id != shared_revision_id) {
+         std::memset((void*)d, 0, sizeof(data));
+         new (&d->lock) bip::interprocess_sharable_mutex;
+         d->id = shared_revision_id;
+      }
+      else if(d->writer_pid.load(std::memory_order_acquire) != 0) {
+         // the previous writer died, possibly within a span; the lock does not track its owner
+         d->lock.unlock();
+      }
+      // the database is not consistent before the writer ends its first span
+      begin_write();
+      d->writer_pid.store(getpid(), std::memory_order_release);
+   }
+   else if(d->id != shared_revision_id) {
+      BOOST_THROW_EXCEPTION(std::runtime_error("revision file " + path.string() + " has not been set up by a writer"));
+   }
+}
+
+shared_revision::~shared_revision() {
+   if(_writable && _region.get_address()) {
+      if(_writing)
+         get()->lock.unlock();
+      get()->writer_pid.store(0, std::memory_order_release);
+   }
+}
+
+bool shared_revision::begin_write(std::chrono::milliseconds max_wait) {
+   if(_writing)
+      return true; // still within the span begun on open
+   data* d = get();
+   bool reset = false;
+   if(!d->lock.timed_lock(deadline_after(max_wait))) {
+      // a reader holding the lock this long died within its query, and the lock does not track its readers;
+      // a reader waiting for it right now gives up after its own wait
+      new (&d->lock) bip::interprocess_sharable_mutex;
+      d->lock.lock();
+      reset = true;
+   }
+   _writing = true;
+   return !reset;
+}
+
+void shared_revision::end_write(int64_t revision, const char* payload, size_t size) {
+   data* d = get();
+   begin_write();
+   // a payload which does not fit is left out rather than cut
+   if(size > max_payload_size)
+      size = 0;
+   if(size)
+      std::memcpy(d->payload, payload, size);
+   d->payload_size = size;
+   d->revision = revision;
+   ++d->spans;
+   _writing = false;
+   d->lock.unlock();
+}
+
+void shared_revision::begin_read(std::chrono::milliseconds max_wait)const {
+   if(!get()->lock.timed_lock_sharable(deadline_after(max_wait)))
+      BOOST_THROW_EXCEPTION(std::runtime_error("the database writer did not finish its changes within the wait"));
+}
+
+void shared_revision::end_read()const {
+   get()->lock.unlock_sharable();
+}
+
+int64_t shared_revision::revision()const {
+   return get()->revision;
+}
+
+std::vector<char> shared_revision::payload()const {
+   const data* d = get();
+   const size_t size = std::min<size_t>(d->payload_size, max_payload_size);
+   return std::vector<char>(d->payload, d->payload + size);
+}
+
+uint64_t shared_revision::spans()const {
+   return get()->spans;
+}
+
+bool shared_revision::writer_attached()const {
+   return get()->writer_pid.load(std::memory_order_acquire) != 0;
+}
+
+}
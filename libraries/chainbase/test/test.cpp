@@ -2,12 +2,19 @@
 
 #include <boost/test/unit_test.hpp>
 #include <chainbase/chainbase.hpp>
+#include <chainbase/environment.hpp>
+#include <chainbase/shared_revision.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <fstream>
 #include <iostream>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace chainbase;
 using namespace boost::multi_index;
@@ -131,4 +138,456 @@ BOOST_AUTO_TEST_CASE( open_and_create ) {
    }
 }
 
+BOOST_AUTO_TEST_CASE( undo_squash_created_objects ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      db.add_index< book_index >();
+      const auto& books = db.get_index< book_index >().indices();
+
+      db.create<book>( []( book& b ) { b.a = 1; } );
+
+      {
+         auto outer = db.start_undo_session(true);
+         db.create<book>( []( book& b ) { b.a = 2; } );
+         {
+            auto inner = db.start_undo_session(true);
+            const auto& b3 = db.create<book>( []( book& b ) { b.a = 3; } );
+            db.create<book>( []( book& b ) { b.a = 4; } );
+            db.modify( db.get( book::id_type(1) ), []( book& b ) { b.a = 20; } );
+            db.remove( b3 );
+            inner.squash();
+         }
+         BOOST_REQUIRE_EQUAL( books.size(), 3u );
+         BOOST_REQUIRE( db.find( book::id_type(2) ) == nullptr );
+         BOOST_REQUIRE_EQUAL( db.get( book::id_type(1) ).a, 20 );
+         BOOST_REQUIRE_EQUAL( db.get( book::id_type(3) ).a, 4 );
+         BOOST_REQUIRE( db.get_index< book_index >().stack().back().old_values.empty() );
+      }
+
+      // the squashed session was undone as a whole, ids are reused from where they were before it
+      BOOST_REQUIRE_EQUAL( books.size(), 1u );
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(0) ).a, 1 );
+      BOOST_REQUIRE_EQUAL( db.create<book>( []( book& b ) { b.a = 5; } ).id._id, 1 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( lazy_undo_states ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      db.add_index< book_index >();
+      const auto& idx = db.get_index< book_index >();
+
+      const auto& the_book = db.create<book>( []( book& b ) { b.a = 1; } );
+      BOOST_REQUIRE( idx.stack().empty() );
+
+      {
+         auto outer = db.start_undo_session(true);
+         BOOST_REQUIRE( idx.stack().empty() ); // untouched sessions have no undo state
+         {
+            auto inner = db.start_undo_session(true);
+            db.modify( the_book, []( book& b ) { b.a = 2; } );
+            BOOST_REQUIRE_EQUAL( idx.stack().size(), 1u );
+            BOOST_REQUIRE_EQUAL( idx.stack().back().revision, 2 );
+            inner.squash();
+         }
+         BOOST_REQUIRE_EQUAL( idx.stack().size(), 1u );
+         BOOST_REQUIRE_EQUAL( idx.stack().back().revision, 1 );
+         BOOST_REQUIRE_EQUAL( the_book.a, 2 );
+      }
+      BOOST_REQUIRE_EQUAL( the_book.a, 1 );
+      BOOST_REQUIRE( idx.stack().empty() );
+      BOOST_REQUIRE_EQUAL( db.revision(), 0 );
+
+      db.start_undo_session(true).push();
+      {
+         auto s = db.start_undo_session(true);
+         db.modify( the_book, []( book& b ) { b.a = 3; } );
+         s.push();
+      }
+      db.start_undo_session(true).push();
+      BOOST_REQUIRE_EQUAL( idx.undo_stack_revision_range().first, 0 );
+      BOOST_REQUIRE_EQUAL( idx.undo_stack_revision_range().second, 3 );
+
+      db.commit( 1 );
+      BOOST_REQUIRE_EQUAL( idx.undo_stack_revision_range().first, 1 );
+      BOOST_REQUIRE_EQUAL( idx.undo_stack_revision_range().second, 3 );
+      BOOST_REQUIRE_EQUAL( idx.stack().size(), 1u );
+
+      db.undo_all();
+      BOOST_REQUIRE_EQUAL( db.revision(), 1 );
+      BOOST_REQUIRE_EQUAL( the_book.a, 1 );
+      BOOST_REQUIRE( idx.stack().empty() );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( heap_checkpoint_writes_changed_pages ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      auto file_value = [&]() {
+         // a read only open refuses a file with the dirty flag set
+         chainbase::database ro(temp, database::read_only);
+         ro.add_index< book_index >();
+         return ro.get( book::id_type(0) ).a;
+      };
+      {
+         chainbase::database db(temp, database::read_write, 1024*1024*8, false, pinnable_mapped_file::map_mode::heap);
+         db.add_index< book_index >();
+         const auto& new_book = db.create<book>( []( book& b ) { b.a = 3; } );
+
+         bool flushed = false;
+         BOOST_REQUIRE( db.checkpoint( [&]() { flushed = true; return true; } ) );
+         // the checkpoint holds the database as it was when it was started
+         db.modify( new_book, []( book& b ) { b.a = 4; } );
+         while( db.checkpoint_running() )
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+         BOOST_REQUIRE( !flushed ); // called in the child
+         BOOST_REQUIRE_EQUAL( file_value(), 3 );
+
+         BOOST_REQUIRE( db.checkpoint( []() { return false; } ) );
+         while( db.checkpoint_running() )
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+         BOOST_REQUIRE_THROW( file_value(), std::runtime_error );
+
+         BOOST_REQUIRE( db.checkpoint() );
+         db.modify( new_book, []( book& b ) { b.a = 5; } );
+      }
+      // shutdown waits for the checkpoint, then writes what changed after it
+      BOOST_REQUIRE_EQUAL( file_value(), 5 );
+      chainbase::database db(temp, database::read_write, 1024*1024*8, false, pinnable_mapped_file::map_mode::heap);
+      db.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(0) ).a, 5 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( earlier_undo_layout_rejected ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      {
+         chainbase::database db(temp, database::read_write, 1024*1024*8);
+         db.add_index< book_index >();
+      }
+      {
+         std::fstream f( (temp / "shared_memory.bin").string(), std::ios::in | std::ios::out | std::ios::binary );
+         f.write( (const char*)&chainbase::header_id_without_id_ranges, sizeof(chainbase::header_id_without_id_ranges) );
+      }
+      BOOST_REQUIRE_EXCEPTION( chainbase::database(temp, database::read_write, 1024*1024*8), std::runtime_error,
+                               []( const std::runtime_error& e ) { return std::string( e.what() ).find( "snapshot" ) != std::string::npos; } );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( mapped_cold_pages_stay_readable ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      {
+         chainbase::database db(temp, database::read_write, 1024*1024*8, false, pinnable_mapped_file::map_mode::heap);
+         BOOST_REQUIRE_EQUAL( db.mark_pages_cold(), 0u );
+      }
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      db.add_index< book_index >();
+      const auto& new_book = db.create<book>( []( book& b ) { b.a = 3; } );
+      db.mark_pages_cold();
+      BOOST_REQUIRE_EQUAL( new_book.a, 3 );
+      db.modify( new_book, []( book& b ) { b.a = 4; } );
+      db.mark_pages_cold();
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(0) ).a, 4 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( mapped_resident_pages_round_trip ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      {
+         chainbase::database db(temp, database::read_write, 1024*1024*8);
+         db.add_index< book_index >();
+         db.create<book>( []( book& b ) { b.a = 3; } );
+         BOOST_REQUIRE( db.save_resident_pages() > 0 );
+      }
+      {
+         chainbase::database db(temp, database::read_write, 1024*1024*8);
+         const auto ranges = db.load_resident_pages();
+         BOOST_REQUIRE( !ranges.empty() );
+         for( const auto& r : ranges ) {
+            BOOST_REQUIRE( r.first + r.second <= 1024*1024*8 );
+            db.prefetch( r.first, r.second );
+         }
+         db.add_index< book_index >();
+         BOOST_REQUIRE_EQUAL( db.get( book::id_type(0) ).a, 3 );
+      }
+      chainbase::database db(temp, database::read_write, 1024*1024*8, false, pinnable_mapped_file::map_mode::heap);
+      BOOST_REQUIRE_EQUAL( db.save_resident_pages(), 0u );
+      BOOST_REQUIRE( db.load_resident_pages().empty() );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( heap_forked_child_keeps_state ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8, false, pinnable_mapped_file::map_mode::heap);
+      BOOST_REQUIRE( db.is_process_private() );
+      db.add_index< book_index >();
+      const auto& new_book = db.create<book>( []( book& b ) { b.a = 3; } );
+
+      int fds[2];
+      BOOST_REQUIRE_EQUAL( pipe( fds ), 0 );
+      pid_t pid = fork();
+      BOOST_REQUIRE_GE( pid, 0 );
+      if( pid == 0 ) {
+         char c;
+         close( fds[1] );
+         bool ok = read( fds[0], &c, 1 ) == 1 && new_book.a == 3;
+         _exit( ok ? 0 : 1 );
+      }
+      close( fds[0] );
+      db.modify( new_book, []( book& b ) { b.a = 4; } );
+      BOOST_REQUIRE_EQUAL( write( fds[1], "x", 1 ), 1 );
+      close( fds[1] );
+
+      int status = 0;
+      BOOST_REQUIRE_EQUAL( waitpid( pid, &status, 0 ), pid );
+      BOOST_REQUIRE( WIFEXITED( status ) );
+      BOOST_REQUIRE_EQUAL( WEXITSTATUS( status ), 0 );
+      BOOST_REQUIRE_EQUAL( new_book.a, 4 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( largest_free_block ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      auto* sm = db.get_segment_manager();
+
+      auto largest = db.get_largest_free_block();
+      BOOST_REQUIRE_GT( largest, 0u );
+      BOOST_REQUIRE_LE( largest, db.get_free_memory() );
+      void* whole = sm->allocate( largest, std::nothrow );
+      BOOST_REQUIRE( whole );
+      sm->deallocate( whole );
+      BOOST_REQUIRE( !sm->allocate( largest + 64, std::nothrow ) );
+
+      // a read only mapping can not be written, it is read from the free tree
+      chainbase::database ro(temp, database::read_only, 0, true);
+      BOOST_REQUIRE_EQUAL( ro.get_largest_free_block(), largest );
+
+      // pin a small allocation in the middle of the free space and the largest block has to shrink
+      void* a = sm->allocate( largest / 2 );
+      void* b = sm->allocate( 64 );
+      sm->deallocate( a );
+      BOOST_REQUIRE_LT( db.get_largest_free_block(), largest / 2 + largest / 4 );
+      sm->deallocate( b );
+      BOOST_REQUIRE_EQUAL( db.get_largest_free_block(), largest );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( undo_usage_and_timings ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      db.add_index< book_index >();
+
+      const auto& first = db.create<book>( []( book& b ) { b.a = 1; } );
+      const auto& second = db.create<book>( []( book& b ) { b.a = 2; } );
+      BOOST_REQUIRE_EQUAL( db.undo_usage_per_index().at(0).usage.revisions, 0u );
+
+      {
+         auto s1 = db.start_undo_session(true);
+         db.modify( first, []( book& b ) { b.a = 10; } );
+         db.create<book>( []( book& b ) { b.a = 3; } );
+         s1.push();
+      }
+      {
+         auto s2 = db.start_undo_session(true);
+         db.remove( second );
+         db.create<book>( []( book& b ) { b.a = 4; } );
+         s2.push();
+      }
+      auto usage = db.undo_usage_per_index().at(0).usage;
+      BOOST_REQUIRE_EQUAL( usage.revisions, 2u );
+      BOOST_REQUIRE_EQUAL( usage.modified, 1u );
+      BOOST_REQUIRE_EQUAL( usage.removed, 1u );
+      BOOST_REQUIRE_EQUAL( usage.created, 2u );
+      BOOST_REQUIRE_GT( usage.bytes, 2 * sizeof(book) );
+
+      db.squash();
+      usage = db.undo_usage_per_index().at(0).usage;
+      BOOST_REQUIRE_EQUAL( usage.revisions, 1u );
+      BOOST_REQUIRE_EQUAL( usage.modified + usage.removed, 2u );
+
+      db.undo();
+      BOOST_REQUIRE_EQUAL( db.undo_usage_per_index().at(0).usage.revisions, 0u );
+      BOOST_REQUIRE_EQUAL( db.get_undo_timings().undo.count, 1u );
+      BOOST_REQUIRE_EQUAL( db.get_undo_timings().squash.count, 1u );
+      BOOST_REQUIRE_EQUAL( db.get_undo_timings().commit.count, 0u );
+      BOOST_REQUIRE_GE( db.get_undo_timings().undo.max_ns, db.get_undo_timings().undo.last_ns );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( emplace_with_id_undo ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      db.add_index< book_index >();
+      db.create<book>( []( book& b ) { b.a = 1; } );
+
+      auto& idx = db.get_mutable_index< book_index >();
+      {
+         auto session = db.start_undo_session(true);
+         const auto& b = idx.emplace_with_id( book::id_type(3), []( book& b ) { b.a = 3; } );
+         BOOST_REQUIRE_EQUAL( b.id._id, 3 );
+         BOOST_REQUIRE_EQUAL( idx.next_id()._id, 4 );
+         idx.set_next_id( book::id_type(6) );
+         BOOST_REQUIRE_THROW( idx.emplace_with_id( book::id_type(5), []( book& ) {} ), std::logic_error );
+         BOOST_REQUIRE_EQUAL( idx.head_undo_state()->old_next_id._id, 1 );
+      }
+      // undone along with the object
+      BOOST_REQUIRE_EQUAL( idx.next_id()._id, 1 );
+      BOOST_REQUIRE_EQUAL( idx.indices().size(), 1u );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( remove_range_undo ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db(temp, database::read_write, 1024*1024*8);
+      db.add_index< book_index >();
+      for( int a : { 1, 2, 2, 2, 3 } )
+         db.create<book>( [a]( book& b ) { b.a = a; } );
+
+      auto& idx = db.get_mutable_index< book_index >();
+      const auto& by_a = idx.indices().get<1>();
+      {
+         auto session = db.start_undo_session(true);
+         BOOST_REQUIRE_EQUAL( idx.remove_range( by_a.lower_bound( 2 ), by_a.upper_bound( 2 ) ), 3u );
+         BOOST_REQUIRE_EQUAL( idx.indices().size(), 2u );
+         BOOST_REQUIRE_EQUAL( idx.head_undo_state()->removed_values.size(), 3u );
+      }
+      BOOST_REQUIRE_EQUAL( by_a.count( 2 ), 3u );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( shared_revision_lock ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      BOOST_REQUIRE_THROW( shared_revision( temp, false ), std::runtime_error );
+
+      std::string head = "head block";
+      {
+         shared_revision writer( temp, true );
+         shared_revision reader( temp, false );
+         BOOST_REQUIRE( reader.writer_attached() );
+
+         // nothing is consistent until the writer ends its first span
+         BOOST_REQUIRE_THROW( reader.begin_read( std::chrono::milliseconds(1) ), std::runtime_error );
+         writer.end_write( 7, head.data(), head.size() );
+
+         reader.begin_read();
+         BOOST_REQUIRE_EQUAL( reader.revision(), 7 );
+         BOOST_REQUIRE_EQUAL( reader.spans(), 1u );
+         BOOST_REQUIRE( reader.payload() == std::vector<char>( head.begin(), head.end() ) );
+
+         // the writer waits for the query in progress, readers share the lock
+         shared_revision other_reader( temp, false );
+         other_reader.begin_read( std::chrono::milliseconds(1) );
+         other_reader.end_read();
+         std::atomic<bool> written{false};
+         std::thread t( [&]() {
+            writer.begin_write();
+            written = true;
+            writer.end_write( 8, nullptr, 0 );
+         } );
+         std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+         BOOST_REQUIRE( !written );
+         BOOST_REQUIRE_EQUAL( reader.revision(), 7 );
+         reader.end_read();
+         t.join();
+         BOOST_REQUIRE( written );
+
+         reader.begin_read();
+         BOOST_REQUIRE_EQUAL( reader.revision(), 8 );
+         BOOST_REQUIRE( reader.payload().empty() );
+         reader.end_read();
+
+         // a reader which never releases the lock does not stop the writer for good
+         reader.begin_read();
+         BOOST_REQUIRE( !writer.begin_write( std::chrono::milliseconds(10) ) );
+         writer.end_write( 9, nullptr, 0 );
+      }
+
+      // a writer which died within a span leaves the lock held, the next one takes it over
+      pid_t pid = fork();
+      BOOST_REQUIRE( pid >= 0 );
+      if( pid == 0 ) {
+         shared_revision writer( temp, true );
+         _exit( 0 );
+      }
+      int status = 0;
+      BOOST_REQUIRE_EQUAL( waitpid( pid, &status, 0 ), pid );
+      {
+         shared_revision reader( temp, false );
+         BOOST_REQUIRE( reader.writer_attached() );
+         BOOST_REQUIRE_THROW( reader.begin_read( std::chrono::milliseconds(1) ), std::runtime_error );
+         shared_revision writer( temp, true );
+         writer.end_write( 10, nullptr, 0 );
+         reader.begin_read();
+         BOOST_REQUIRE_EQUAL( reader.revision(), 10 );
+         reader.end_read();
+      }
+
+      shared_revision reader( temp, false );
+      BOOST_REQUIRE( !reader.writer_attached() );
+      reader.begin_read();
+      BOOST_REQUIRE_EQUAL( reader.revision(), 10 );
+      reader.end_read();
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
 // BOOST_AUTO_TEST_SUITE_END()
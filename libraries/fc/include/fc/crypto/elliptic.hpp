@@ -50,6 +50,14 @@ namespace fc {
            public_key( const public_key_point_data& v );
            public_key( const compact_signature& c, const fc::sha256& digest, bool check_canonical = true );
 
+           /**
+            *  out[i] = public_key( sigs[i], digests[i], check_canonical ) for count signatures, recovered together
+            *  where the implementation can share work between them. Throws for the first signature which can
+            *  not be recovered.
+            */
+           static void recover_many( const compact_signature* sigs, const fc::sha256* digests, size_t count,
+                                     public_key* out, bool check_canonical = true );
+
            public_key child( const fc::sha256& offset )const;
 
            bool valid()const;
@@ -44,6 +44,9 @@ namespace fc {
            public_key( const public_key_point_data& v );
            public_key( const compact_signature& c, const fc::sha256& digest, bool check_canonical = true );
 
+           /// the serialized key public_key( c, digest ) recovers, without building an OpenSSL key
+           static public_key_data recover_data( const compact_signature& c, const fc::sha256& digest );
+
            bool valid()const;
            public_key mult( const fc::sha256& offset );
            public_key add( const fc::sha256& offset )const;
@@ -145,7 +148,7 @@ namespace fc {
         using crypto::shim<compact_signature>::shim;
 
         public_key_type recover(const sha256& digest, bool check_canonical) const {
-           return public_key_type(public_key(_data, digest, check_canonical).serialize());
+           return public_key_type(public_key::recover_data(_data, digest));
         }
      };
 
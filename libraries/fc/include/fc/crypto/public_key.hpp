@@ -28,6 +28,13 @@ namespace fc { namespace crypto {
 
          public_key( const signature& c, const sha256& digest, bool check_canonical = true );
 
+         /**
+          *  out[i] = public_key( sigs[i], digests[i], check_canonical ) for count signatures. The K1 signatures
+          *  are recovered in one batch.
+          */
+         static void recover_many( const signature* sigs, const sha256* digests, size_t count, public_key* out,
+                                   bool check_canonical = true );
+
          bool valid()const;
 
          // serialize to/from string
@@ -80,6 +80,11 @@ class ripemd160
 
   template<> struct get_typename<uint160_t>    { static const char* name()  { return "uint160_t";  } };
 
+  namespace raw {
+    template<> struct is_bulk_copyable<ripemd160> : std::true_type {};
+    static_assert( sizeof(ripemd160) == 20, "ripemd160 packs as its bytes" );
+  }
+
 } // namespace fc
 
 namespace std
@@ -74,6 +74,11 @@ class sha224
   void to_variant( const sha224& bi, variant& v );
   void from_variant( const variant& v, sha224& bi );
 
+  namespace raw {
+    template<> struct is_bulk_copyable<sha224> : std::true_type {};
+    static_assert( sizeof(sha224) == 28, "sha224 packs as its bytes" );
+  }
+
 } // fc
 namespace std
 {
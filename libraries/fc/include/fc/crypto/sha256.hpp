@@ -24,6 +24,12 @@ class sha256
     static sha256 hash( const string& );
     static sha256 hash( const sha256& );
 
+    /**
+     *  Hashes count independent messages, out[i] being the hash of the sizes[i] bytes at data[i]. Several
+     *  messages are hashed at once in SIMD lanes when the cpu supports it and has no SHA extensions.
+     */
+    static void hash_many( const char* const* data, const uint32_t* sizes, size_t count, sha256* out );
+
     template<typename T>
     static sha256 hash( const T& t ) 
     { 
@@ -106,6 +112,11 @@ class sha256
 
   uint64_t hash64(const char* buf, size_t len);    
 
+  namespace raw {
+    template<> struct is_bulk_copyable<sha256> : std::true_type {};
+    static_assert( sizeof(sha256) == 32, "sha256 packs as its bytes" );
+  }
+
 } // fc
 
 namespace std
@@ -1,6 +1,7 @@
 #pragma once
 #include <fc/fwd.hpp>
 #include <fc/string.hpp>
+#include <fc/io/raw_fwd.hpp>
 
 namespace fc
 {
@@ -72,6 +73,11 @@ class sha512
   void to_variant( const sha512& bi, variant& v );
   void from_variant( const variant& v, sha512& bi );
 
+  namespace raw {
+    template<> struct is_bulk_copyable<sha512> : std::true_type {};
+    static_assert( sizeof(sha512) == 64, "sha512 packs as its bytes" );
+  }
+
 } // fc
 
 #include <fc/reflect/reflect.hpp>
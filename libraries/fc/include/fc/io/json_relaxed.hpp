@@ -26,7 +26,7 @@ namespace fc { namespace json_relaxed
    template<typename T>
    std::string tokenFromStream( T& in )
    {
-      std::stringstream token;
+      std::string token;
       try
       {
          char c = in.peek();
@@ -36,7 +36,7 @@ namespace fc { namespace json_relaxed
             switch( c = in.peek() )
             {
                case '\\':
-                  token << parseEscape( in );
+                  token += parseEscape( in );
                   break;
                case '\t':
                case ' ':
@@ -46,7 +46,7 @@ namespace fc { namespace json_relaxed
                case '\n':
                case '\x04':
                   in.get();
-                  return token.str();
+                  return token;
                case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h':
                case 'i': case 'j': case 'k': case 'l': case 'm': case 'n': case 'o': case 'p':
                case 'q': case 'r': case 's': case 't': case 'u': case 'v': case 'w': case 'x':
@@ -58,34 +58,34 @@ namespace fc { namespace json_relaxed
                case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
                case '8': case '9':
                case '_': case '-': case '.': case '+': case '/':
-                  token << c;
+                  token += c;
                   in.get();
                   break;
                case EOF:
                   FC_THROW_EXCEPTION( eof_exception, "unexpected end of file" );
                default:
-                  return token.str();
+                  return token;
             }
          }
-         return token.str();
+         return token;
       }
       catch( const fc::eof_exception& eof )
       {
-         return token.str();
+         return token;
       }
       catch (const std::ios_base::failure&)
       {
-         return token.str();
+         return token;
       }
 
       FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
    }
 
    template<typename T, bool strict, bool allow_escape>
    std::string quoteStringFromStream( T& in )
    {
-       std::stringstream token;
+       std::string token;
        try
        {
            char q = in.get();
@@ -130,23 +130,24 @@ namespace fc { namespace json_relaxed
                                if( c3 == q )
                                {
                                    in.get();
-                                   return token.str();
+                                   return token;
                                }
-                               token << q << q;
+                               token += q;
+                               token += q;
                                continue;
                            }
-                           token << q;
+                           token += q;
                            continue;
                        }
                        else if( c == '\x04' )
                            FC_THROW_EXCEPTION( parse_error_exception, "unexpected EOF in string '${token}'",
-                                      ("token", token.str() ) );
+                                      ("token", token ) );
                        else if( allow_escape && (c == '\\') )
-                           token << parseEscape( in );
+                           token += parseEscape( in );
                        else
                        {
                            in.get();
-                           token << c;
+                           token += c;
                        }
                    }
                }
@@ -163,25 +164,25 @@ namespace fc { namespace json_relaxed
                if( c == q )
                {
                    in.get();
-                   return token.str();
+                   return token;
                }
                else if( c == '\x04' )
                    FC_THROW_EXCEPTION( parse_error_exception, "unexpected EOF in string '${token}'",
-                              ("token", token.str() ) );
+                              ("token", token ) );
                else if( allow_escape && (c == '\\') )
-                   token << parseEscape( in );
+                   token += parseEscape( in );
                else if( (c == '\r') | (c == '\n') )
                    FC_THROW_EXCEPTION( parse_error_exception, "unexpected EOL in string '${token}'",
-                              ("token", token.str() ) );
+                              ("token", token ) );
                else
                {
                    in.get();
-                   token << c;
+                   token += c;
                }
            }
            
        } FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
    }
 
    template<typename T, bool strict>
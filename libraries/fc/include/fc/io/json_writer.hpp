@@ -0,0 +1,53 @@
+#pragma once
+#include <fc/io/json.hpp>
+
+namespace fc
+{
+   /**
+    *  Writes a JSON document token by token at the end of a string, producing the text json::to_string
+    *  would produce for the equivalent variant without first building that variant.
+    *
+    *  Separators are inserted by the writer; a mark taken before writing a value allows to drop that value
+    *  again, e.g. to write it in some other way after a failure.
+    */
+   class json_writer
+   {
+      public:
+         struct mark
+         {
+            size_t size = 0;
+            size_t depth = 0;
+            bool   first = true;
+            bool   after_key = false;
+         };
+
+         explicit json_writer( std::string& out, json::output_formatting format = json::stringify_large_ints_and_doubles );
+
+         void begin_object();
+         void end_object();
+         void begin_array();
+         void end_array();
+
+         void key( const std::string& k );
+         void value( const variant& v );
+         void value( const std::string& s );
+         void value( bool b );
+         void null_value();
+         /// appends a value which already is valid JSON text
+         void raw_value( const std::string& json );
+
+         mark get_mark()const;
+         void rollback( const mark& m );
+
+         const std::string& buffer()const { return out; }
+
+      private:
+         void separate();
+
+         std::string&             out;
+         json::output_formatting  format;
+         std::vector<bool>        first;     ///< per open object or array, whether nothing was written in it yet
+         bool                     after_key = false;
+   };
+
+} // fc
@@ -174,8 +174,12 @@ namespace fc {
     template<typename Stream, typename T, size_t N>
     inline void pack( Stream& s, T (&v)[N]) {
       fc::raw::pack( s, unsigned_int((uint32_t)N) );
-      for (uint64_t i = 0; i < N; ++i)
-         fc::raw::pack(s, v[i]);
+      if constexpr( is_bulk_copyable<T>::value ) {
+         s.write( (const char*)&v[0], N*sizeof(T) );
+      } else {
+         for (uint64_t i = 0; i < N; ++i)
+            fc::raw::pack(s, v[i]);
+      }
     }
 
     template<typename Stream, typename T, size_t N>
@@ -183,8 +187,12 @@ namespace fc {
     { try {
       unsigned_int size; fc::raw::unpack( s, size );
       FC_ASSERT( size.value == N );
-      for (uint64_t i = 0; i < N; ++i)
-         fc::raw::unpack(s, v[i]);
+      if constexpr( is_bulk_copyable<T>::value ) {
+         s.read( (char*)&v[0], N*sizeof(T) );
+      } else {
+         for (uint64_t i = 0; i < N; ++i)
+            fc::raw::unpack(s, v[i]);
+      }
     } FC_RETHROW_EXCEPTIONS( warn, "${type} (&v)[${length}]", ("type",fc::get_typename<T>::name())("length",N) ) }
 
     template<typename Stream, typename T>
@@ -560,11 +568,16 @@ namespace fc {
     inline void pack( Stream& s, const std::vector<T>& value ) {
       FC_ASSERT( value.size() <= MAX_NUM_ARRAY_ELEMENTS );
       fc::raw::pack( s, unsigned_int((uint32_t)value.size()) );
-      auto itr = value.begin();
-      auto end = value.end();
-      while( itr != end ) {
-        fc::raw::pack( s, *itr );
-        ++itr;
+      if constexpr( is_bulk_copyable<T>::value ) {
+        if( value.size() )
+          s.write( (const char*)value.data(), value.size()*sizeof(T) );
+      } else {
+        auto itr = value.begin();
+        auto end = value.end();
+        while( itr != end ) {
+          fc::raw::pack( s, *itr );
+          ++itr;
+        }
       }
     }
 
@@ -573,11 +586,16 @@ namespace fc {
       unsigned_int size; fc::raw::unpack( s, size );
       FC_ASSERT( size.value <= MAX_NUM_ARRAY_ELEMENTS );
       value.resize(size.value);
-      auto itr = value.begin();
-      auto end = value.end();
-      while( itr != end ) {
-        fc::raw::unpack( s, *itr );
-        ++itr;
+      if constexpr( is_bulk_copyable<T>::value ) {
+        if( value.size() )
+          s.read( (char*)value.data(), value.size()*sizeof(T) );
+      } else {
+        auto itr = value.begin();
+        auto end = value.end();
+        while( itr != end ) {
+          fc::raw::unpack( s, *itr );
+          ++itr;
+        }
       }
     }
 
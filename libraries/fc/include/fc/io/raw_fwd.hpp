@@ -26,8 +26,16 @@ namespace fc {
    template<typename Storage> class fixed_string;
 
    namespace raw {
+    /**
+     *  Whether the packed form of a T is its object representation, so that consecutive T pack and unpack with a
+     *  single copy. Holds for the arithmetic types other than bool; types which pack as their bytes specialize it.
+     */
     template<typename T>
-    constexpr bool is_trivial_array = std::is_scalar<T>::value == true && std::is_pointer<T>::value == false;
+    struct is_bulk_copyable : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T,bool>::value> {};
+
+    template<typename T>
+    constexpr bool is_trivial_array = (std::is_scalar<T>::value == true && std::is_pointer<T>::value == false) ||
+                                      is_bulk_copyable<T>::value;
 
     template<typename T>
     inline size_t pack_size(  const T& v );
@@ -0,0 +1,55 @@
+#pragma once
+#include <fc/log/appender.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant.hpp>
+
+namespace fc
+{
+   /**
+    *  Hands log messages to a background thread which writes them to another appender, so that the logging
+    *  thread only pays for putting the message into a fixed size lock free queue. Formatting and output happen
+    *  on the background thread, in the order the messages were queued.
+    *
+    *  The wrapped appender is configured inline, e.g.
+    *  { "name": "stderr", "type": "async", "args": { "type": "console", "args": { "stream": "std_error" },
+    *                                                 "capacity": 8192, "overflow": "drop_below_warn" } }
+    */
+   class async_appender final : public appender
+   {
+      public:
+         /// what logging does when the queue is full
+         struct overflow_policy {
+            enum type {
+               block,            ///< wait for the background thread to make room
+               drop,             ///< discard the message
+               drop_below_warn   ///< discard debug and info messages, wait with warnings and errors
+            };
+         };
+
+         struct config
+         {
+            string                  type;                  ///< type of the wrapped appender, e.g. "console"
+            variant                 args;                  ///< configuration of the wrapped appender
+            uint32_t                capacity = 8192;       ///< number of messages the queue holds
+            overflow_policy::type   overflow = overflow_policy::drop_below_warn;
+         };
+
+         async_appender( const variant& args );
+         async_appender( const config& cfg, const appender::ptr& wrapped );
+         ~async_appender();
+
+         void initialize( boost::asio::io_service& io_service ) override;
+         void log( const log_message& m ) override;
+
+         /// waits until every message queued so far is written
+         void flush();
+
+      private:
+         class impl;
+         std::unique_ptr<impl> my;
+   };
+} // namespace fc
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT_ENUM( fc::async_appender::overflow_policy::type, (block)(drop)(drop_below_warn) )
+FC_REFLECT( fc::async_appender::config, (type)(args)(capacity)(overflow) )
@@ -8,6 +8,9 @@ namespace fc
 {
   // Log appender that sends log messages in JSON format over UDP
   // https://www.graylog2.org/resources/gelf/specification
+  // Messages are queued by log() and formatted, compressed and sent by a thread of the appender, so logging never
+  // waits for the network. Messages logged while max_queue_size of them are waiting are dropped and counted, the
+  // next message sent reports the count in _dropped_before.
   class gelf_appender final : public appender 
   {
   public:
@@ -15,6 +18,7 @@ namespace fc
     {
       string endpoint = "127.0.0.1:12201";
       string host = "fc"; // the name of the host, source or application that sent this message (just passed through to GELF server)
+      uint32_t max_queue_size = 10000;
     };
 
     gelf_appender(const variant& args);
@@ -37,4 +41,4 @@ namespace fc
 
 #include <fc/reflect/reflect.hpp>
 FC_REFLECT(fc::gelf_appender::config,
-           (endpoint)(host))
+           (endpoint)(host)(max_queue_size))
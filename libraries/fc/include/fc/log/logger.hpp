@@ -61,6 +61,15 @@ namespace fc
 #define DEFAULT_LOGGER
 #endif
 
+// the lowest level compiled in, e.g. -DFC_MIN_LOG_LEVEL=info removes every debug statement from the binary while
+// its arguments are still compiled and checked
+#ifndef FC_MIN_LOG_LEVEL
+#define FC_MIN_LOG_LEVEL all
+#endif
+
+#define FC_LOG_ENABLED( LOGGER, LOG_LEVEL ) \
+   ( fc::log_level::LOG_LEVEL >= fc::log_level::FC_MIN_LOG_LEVEL && (LOGGER).is_enabled( fc::log_level::LOG_LEVEL ) )
+
 // suppress warning "conditional expression is constant" in the while(0) for visual c++
 // http://cnicholson.net/2009/03/stupid-c-tricks-dowhile0-and-c4127/
 #define FC_MULTILINE_MACRO_BEGIN do {
@@ -76,31 +85,31 @@ namespace fc
 
 #define fc_dlog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::debug ) ) \
+   if( FC_LOG_ENABLED( LOGGER, debug ) ) \
       (LOGGER).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 #define fc_ilog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::info ) ) \
+   if( FC_LOG_ENABLED( LOGGER, info ) ) \
       (LOGGER).log( FC_LOG_MESSAGE( info, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 #define fc_wlog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::warn ) ) \
+   if( FC_LOG_ENABLED( LOGGER, warn ) ) \
       (LOGGER).log( FC_LOG_MESSAGE( warn, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 #define fc_elog( LOGGER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (LOGGER).is_enabled( fc::log_level::error ) ) \
+   if( FC_LOG_ENABLED( LOGGER, error ) ) \
       (LOGGER).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 #define dlog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::debug ) ) \
+   if( FC_LOG_ENABLED( fc::logger::get(DEFAULT_LOGGER), debug ) ) \
       (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
@@ -110,26 +119,26 @@ namespace fc
  */
 #define ulog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get("user")).is_enabled( fc::log_level::debug ) ) \
+   if( FC_LOG_ENABLED( fc::logger::get("user"), debug ) ) \
       (fc::logger::get("user")).log( FC_LOG_MESSAGE( debug, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 
 #define ilog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::info ) ) \
+   if( FC_LOG_ENABLED( fc::logger::get(DEFAULT_LOGGER), info ) ) \
       (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( info, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 #define wlog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::warn ) ) \
+   if( FC_LOG_ENABLED( fc::logger::get(DEFAULT_LOGGER), warn ) ) \
       (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( warn, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
 #define elog( FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::error ) ) \
+   if( FC_LOG_ENABLED( fc::logger::get(DEFAULT_LOGGER), error ) ) \
       (fc::logger::get(DEFAULT_LOGGER)).log( FC_LOG_MESSAGE( error, FORMAT, __VA_ARGS__ ) ); \
   FC_MULTILINE_MACRO_END
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <fc/log/logger.hpp>
 #include <fc/log/appender.hpp>
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -61,12 +62,17 @@ namespace fc {
    private:
       static log_config& get();
 
+      /// creates an appender of a registered type, to be called with log_mutex held
+      static appender::ptr create_appender( const fc::string& type, const variant& args );
+
       friend class logger;
+      friend class async_appender;
 
       std::mutex                                               log_mutex;
       std::unordered_map<std::string, appender_factory::ptr>   appender_factory_map;
       std::unordered_map<std::string, appender::ptr>           appender_map;
       std::unordered_map<std::string, logger>                  logger_map;
+      std::atomic<uint64_t>                                    generation{0}; ///< changes whenever logger_map is rebuilt
    };
 
    void configure_logging( const fc::path& log_config );
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fc { namespace metrics {
+
+   /// label name and value pairs telling apart the metrics of one family
+   typedef std::vector<std::pair<std::string, std::string>> labels;
+
+   /// A value that only grows, e.g. the number of requests served
+   class counter {
+      public:
+         void inc( uint64_t n = 1 ) { _value.fetch_add( n, std::memory_order_relaxed ); }
+         uint64_t value()const { return _value.load( std::memory_order_relaxed ); }
+
+      private:
+         std::atomic<uint64_t> _value{0};
+   };
+
+   /// A value that goes up and down, e.g. a queue depth
+   class gauge {
+      public:
+         void set( int64_t v ) { _value.store( v, std::memory_order_relaxed ); }
+         void add( int64_t n ) { _value.fetch_add( n, std::memory_order_relaxed ); }
+         int64_t value()const { return _value.load( std::memory_order_relaxed ); }
+
+      private:
+         std::atomic<int64_t> _value{0};
+   };
+
+   /// Counts observations into buckets with fixed upper bounds, and keeps their count and sum
+   class histogram {
+      public:
+         explicit histogram( std::vector<double> bounds );
+
+         void observe( double v );
+
+         const std::vector<double>& bounds()const { return _bounds; }
+         /// @return cumulative count of each bound followed by the total count, as exposed to Prometheus
+         std::vector<uint64_t> cumulative_counts()const;
+         double sum()const;
+
+      private:
+         std::vector<double>                      _bounds;
+         std::unique_ptr<std::atomic<uint64_t>[]> _buckets;   ///< one per bound plus one above the last bound
+         std::atomic<uint64_t>                    _sum_bits{0}; ///< the sum as the bits of a double
+   };
+
+   /// @return count bounds starting at start, each factor times the previous one
+   std::vector<double> exponential_bounds( double start, double factor, size_t count );
+
+   /**
+    *  Process wide set of metrics, rendered in the Prometheus text exposition format.
+    *
+    *  Metrics are registered once, typically when a plugin initializes, and then updated with relaxed atomic
+    *  operations from whichever thread does the work; nothing is aggregated until a scrape renders them.
+    *  Registering a name and labels again returns the metric registered first. The returned references stay
+    *  valid for the life of the process.
+    */
+   class registry {
+      public:
+         static registry& instance();
+
+         counter&   add_counter( const std::string& name, const std::string& help, const labels& l = labels() );
+         gauge&     add_gauge( const std::string& name, const std::string& help, const labels& l = labels() );
+         histogram& add_histogram( const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                                   const labels& l = labels() );
+
+         /// text exposition format, version 0.0.4
+         std::string render()const;
+
+      private:
+         enum class metric_type { counter, gauge, histogram };
+
+         struct entry {
+            labels                     label_values;
+            std::unique_ptr<counter>   c;
+            std::unique_ptr<gauge>     g;
+            std::unique_ptr<histogram> h;
+         };
+
+         struct family {
+            metric_type        type;
+            std::string        help;
+            std::vector<entry> entries;
+         };
+
+         entry& find_or_add( const std::string& name, const std::string& help, metric_type type, const labels& l );
+
+         mutable std::mutex             _mtx;
+         std::map<std::string, family>  _families;
+   };
+
+} } // namespace fc::metrics
@@ -28,6 +28,8 @@ class http_client {
 
       void add_cert(const std::string& cert_pem_string);
       void set_verify_peers(bool enabled);
+      /// at most max_idle_per_host kept alive connections per endpoint are kept for reuse, for at most max_idle_time each
+      void set_connection_pool(uint32_t max_idle_per_host, const microseconds& max_idle_time);
 
 private:
    std::unique_ptr<class http_client_impl> _my;
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace fc { namespace tracing {
+
+   /// A named interval on one thread
+   struct span {
+      const char* name     = nullptr;   ///< a string literal, spans only keep the pointer
+      uint64_t    start_ns = 0;         ///< steady clock
+      uint64_t    end_ns   = 0;
+      uint64_t    arg      = 0;         ///< e.g. the block number the work belongs to, 0 if none
+      uint32_t    tid      = 0;         ///< small sequential id of the recording thread
+   };
+
+   namespace detail {
+      extern std::atomic<bool> enabled_flag;
+   }
+
+   /**
+    *  Recording is off by default. While it is on, every thread records into its own ring buffer, allocated when
+    *  the thread records its first span, so recording takes no lock and the oldest spans of a busy thread are
+    *  overwritten first.
+    */
+   inline bool enabled() { return detail::enabled_flag.load( std::memory_order_relaxed ); }
+   void set_enabled( bool on );
+
+   /// capacity in spans of the rings of threads that have not recorded yet, rounded up to a power of two
+   void set_ring_capacity( uint32_t spans );
+
+   uint64_t now_ns();
+
+   void record( const char* name, uint64_t start_ns, uint64_t end_ns, uint64_t arg = 0 );
+
+   /// Records the lifetime of the object as a span, if recording was on when it was created
+   class scoped_span {
+      public:
+         explicit scoped_span( const char* name, uint64_t arg = 0 )
+         :_name( enabled() ? name : nullptr ), _arg( arg ), _start( _name ? now_ns() : 0 ) {}
+
+         ~scoped_span() {
+            if( _name )
+               record( _name, _start, now_ns(), _arg );
+         }
+
+         void set_arg( uint64_t arg ) { _arg = arg; }
+
+         scoped_span( const scoped_span& ) = delete;
+         scoped_span& operator=( const scoped_span& ) = delete;
+
+      private:
+         const char* _name;
+         uint64_t    _arg;
+         uint64_t    _start;
+   };
+
+   /// @return the spans still held by every thread's ring that started in [from_ns, to_ns], ordered by start
+   std::vector<span> collect( uint64_t from_ns = 0, uint64_t to_ns = std::numeric_limits<uint64_t>::max() );
+
+   /// forgets every span recorded so far
+   void clear();
+
+   /// @return the spans in the Chrome trace event format, which Perfetto and chrome://tracing load
+   std::string to_chrome_json( const std::vector<span>& spans, const char* arg_name = "block_num" );
+
+} } // namespace fc::tracing
@@ -75,9 +75,8 @@ namespace fc
        
       template<typename T>
       variant_object( string key, T&& val )
-      :_key_value( std::make_shared<std::vector<entry> >() )
+      :variant_object( std::move(key), variant(forward<T>(val)) )
       {
-         *this = variant_object( std::move(key), variant(forward<T>(val)) );
       }
       variant_object( const variant_object& );
       variant_object( variant_object&& );
@@ -0,0 +1,38 @@
+#ifndef _SECP256K1_BATCH_
+# define _SECP256K1_BATCH_
+
+# include <stddef.h>
+# include <secp256k1.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** Recover the compressed ECDSA public keys of several compact signatures at once.
+ *  Gives the keys secp256k1_ecdsa_recover_compact gives one signature at a time, but the inversions of r and
+ *  of the recovered points are shared by all the signatures (one inversion of each kind per batch).
+ *  Returns: 1: every public key was recovered.
+ *           0: at least one signature is invalid, see results.
+ *  In:      ctx:     pointer to a context object, initialized for verification (cannot be NULL)
+ *           count:   the number of signatures
+ *           msg32s:  the 32-byte message hash of each signature (cannot be NULL)
+ *           sig64s:  each signature as 64 byte array (cannot be NULL)
+ *           recids:  the recovery id (0-3) of each signature (cannot be NULL)
+ *  Out:     pubkeys: pointer to 33 * count bytes, the key of signature i is put at pubkeys + 33 * i (cannot be NULL)
+ *           results: pointer to count ints, 1 for each signature whose key was recovered, 0 otherwise (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_recover_compact_batch(
+  const secp256k1_context_t* ctx,
+  size_t count,
+  const unsigned char * const *msg32s,
+  const unsigned char * const *sig64s,
+  const int *recids,
+  unsigned char *pubkeys,
+  int *results
+) SECP256K1_ARG_NONNULL(1);
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -11,6 +11,10 @@
 #define USE_FIELD_INV_NUM 1
 #define USE_SCALAR_INV_NUM 1
 
+//split the scalars of ecmult with the secp256k1 endomorphism (GLV), which roughly halves
+//the doublings of public key recovery
+#define USE_ENDOMORPHISM 1
+
 //use impls best for 64-bit
 #define USE_FIELD_5X52 1
 #define USE_SCALAR_4X64 1
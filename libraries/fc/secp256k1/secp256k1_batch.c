@@ -0,0 +1,105 @@
+/* The upstream library is built as one translation unit and its internals are static, so the batch functions
+ * are compiled together with it rather than patched into upstream. */
+#include "upstream/src/secp256k1.c"
+#include "include/secp256k1_batch.h"
+
+int secp256k1_ecdsa_recover_compact_batch(const secp256k1_context_t* ctx, size_t count, const unsigned char * const *msg32s, const unsigned char * const *sig64s, const int *recids, unsigned char *pubkeys, int *results) {
+    secp256k1_scalar_t *r, *s, *m, *prefix;
+    secp256k1_gej_t *xj, *qj;
+    secp256k1_ge_t *q;
+    size_t *index;
+    secp256k1_scalar_t inv, rn, u1, u2;
+    secp256k1_fe_t fx;
+    secp256k1_ge_t x;
+    unsigned char brx[32];
+    size_t i, k, n = 0;
+    int ret = 1;
+    DEBUG_CHECK(ctx != NULL);
+    DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+
+    if (count == 0) {
+        return 1;
+    }
+    r = (secp256k1_scalar_t *)checked_malloc(sizeof(secp256k1_scalar_t) * count);
+    s = (secp256k1_scalar_t *)checked_malloc(sizeof(secp256k1_scalar_t) * count);
+    m = (secp256k1_scalar_t *)checked_malloc(sizeof(secp256k1_scalar_t) * count);
+    prefix = (secp256k1_scalar_t *)checked_malloc(sizeof(secp256k1_scalar_t) * count);
+    xj = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * count);
+    qj = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * count);
+    q = (secp256k1_ge_t *)checked_malloc(sizeof(secp256k1_ge_t) * count);
+    index = (size_t *)checked_malloc(sizeof(size_t) * count);
+
+    /* the checks of secp256k1_ecdsa_recover_compact and secp256k1_ecdsa_sig_recover up to the inversion of r */
+    for (i = 0; i < count; i++) {
+        int overflow = 0;
+        results[i] = 0;
+        secp256k1_scalar_set_b32(&r[n], sig64s[i], &overflow);
+        if (overflow) {
+            continue;
+        }
+        secp256k1_scalar_set_b32(&s[n], sig64s[i] + 32, &overflow);
+        if (overflow || secp256k1_scalar_is_zero(&r[n]) || secp256k1_scalar_is_zero(&s[n])) {
+            continue;
+        }
+        secp256k1_scalar_set_b32(&m[n], msg32s[i], NULL);
+        secp256k1_scalar_get_b32(brx, &r[n]);
+        VERIFY_CHECK(secp256k1_fe_set_b32(&fx, brx));
+        if (recids[i] & 2) {
+            if (secp256k1_fe_cmp_var(&fx, &secp256k1_ecdsa_const_p_minus_order) >= 0) {
+                continue;
+            }
+            secp256k1_fe_add(&fx, &secp256k1_ecdsa_const_order_as_fe);
+        }
+        if (!secp256k1_ge_set_xo_var(&x, &fx, recids[i] & 1)) {
+            continue;
+        }
+        secp256k1_gej_set_ge(&xj[n], &x);
+        index[n] = i;
+        n++;
+    }
+
+    if (n > 0) {
+        /* Montgomery's trick: one inversion of the product of all r, the single inverses follow from the prefix products */
+        prefix[0] = r[0];
+        for (k = 1; k < n; k++) {
+            secp256k1_scalar_mul(&prefix[k], &prefix[k - 1], &r[k]);
+        }
+        secp256k1_scalar_inverse_var(&inv, &prefix[n - 1]);
+        for (k = n; k-- > 0; ) {
+            if (k > 0) {
+                secp256k1_scalar_mul(&rn, &inv, &prefix[k - 1]);
+                secp256k1_scalar_mul(&inv, &inv, &r[k]);
+            } else {
+                rn = inv;
+            }
+            secp256k1_scalar_mul(&u1, &rn, &m[k]);
+            secp256k1_scalar_negate(&u1, &u1);
+            secp256k1_scalar_mul(&u2, &rn, &s[k]);
+            secp256k1_ecmult(&ctx->ecmult_ctx, &qj[k], &xj[k], &u2, &u1);
+        }
+
+        /* the recovered points share one field inversion to become affine */
+        secp256k1_ge_set_all_gej_var(n, q, qj);
+        for (k = 0; k < n; k++) {
+            int len = 0;
+            if (secp256k1_eckey_pubkey_serialize(&q[k], pubkeys + 33 * index[k], &len, 1)) {
+                results[index[k]] = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!results[i]) {
+            ret = 0;
+        }
+    }
+    free(r);
+    free(s);
+    free(m);
+    free(prefix);
+    free(xj);
+    free(qj);
+    free(q);
+    free(index);
+    return ret;
+}
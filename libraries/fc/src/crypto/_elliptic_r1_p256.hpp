@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+/* secp256r1 public key recovery on fixed size integers, without OpenSSL or heap allocations
+ */
+namespace fc { namespace crypto { namespace r1 { namespace p256 {
+
+   /// whether the 32 byte big endian s is at most half the curve order
+   bool is_low_s( const unsigned char* s32 );
+
+   /**
+    *  Recovers the compressed public key of the signature (r32, s32) over digest32, giving the key the OpenSSL
+    *  based recovery gives for every input, including r above the curve order. A recovered point at infinity
+    *  gives an all zero key, as it serializes through OpenSSL.
+    *
+    *  @param recid  0 - 3, i.e. the first byte of the compact signature - 27 with the compression flag removed
+    *  @return false if no point has the x coordinate selected by r and recid, or r is a multiple of the order
+    */
+   bool recover( const unsigned char* digest32, const unsigned char* r32, const unsigned char* s32, int recid,
+                 unsigned char* pub33 );
+
+} } } } // fc::crypto::r1::p256
@@ -323,6 +323,13 @@ namespace fc { namespace ecc {
 //      return 1 == ECDSA_verify( 0, (unsigned char*)&digest, sizeof(digest), (unsigned char*)&sig, sizeof(sig), my->_key );
 //    }
 
+    void public_key::recover_many( const compact_signature* sigs, const fc::sha256* digests, size_t count,
+                                   public_key* out, bool check_canonical )
+    {
+        for( size_t i = 0; i < count; ++i )
+            out[i] = public_key( sigs[i], digests[i], check_canonical );
+    }
+
     public_key::public_key( const compact_signature& c, const fc::sha256& digest, bool check_canonical )
     {
         int nV = c.data[0];
@@ -7,6 +7,8 @@
 #include <fc/exception/exception.hpp>
 #include <fc/log/logger.hpp>
 
+#include "_elliptic_r1_p256.hpp"
+
 namespace fc { namespace crypto { namespace r1 {
     namespace detail
     {
@@ -530,35 +532,28 @@ namespace fc { namespace crypto { namespace r1 {
     }
 
     public_key::public_key( const compact_signature& c, const fc::sha256& digest, bool check_canonical )
+    :public_key( recover_data( c, digest ) )
+    {
+    }
+
+    public_key_data public_key::recover_data( const compact_signature& c, const fc::sha256& digest )
     {
         int nV = c.data[0];
         if (nV<27 || nV>=35)
             FC_THROW_EXCEPTION( exception, "unable to reconstruct public key from signature" );
 
-        ecdsa_sig sig = ECDSA_SIG_new();
-        BIGNUM *r = BN_new(), *s = BN_new();
-        BN_bin2bn(&c.data[1],32,r);
-        BN_bin2bn(&c.data[33],32,s);
-        ECDSA_SIG_set0(sig, r, s);
-
-        my->_key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
-
-        const EC_GROUP* group = EC_KEY_get0_group(my->_key);
-        ssl_bignum order, halforder;
-        EC_GROUP_get_order(group, order, nullptr);
-        BN_rshift1(halforder, order);
-        if(BN_cmp(s, halforder) > 0)
+        const unsigned char* r = (const unsigned char*)&c.data[1];
+        const unsigned char* s = (const unsigned char*)&c.data[33];
+        if( !p256::is_low_s( s ) )
            FC_THROW_EXCEPTION( exception, "invalid high s-value encountered in r1 signature" );
 
         if (nV >= 31)
-        {
-            EC_KEY_set_conv_form( my->_key, POINT_CONVERSION_COMPRESSED );
             nV -= 4;
-//            fprintf( stderr, "compressed\n" );
-        }
 
-        if (ECDSA_SIG_recover_key_GFp(my->_key, sig, (unsigned char*)&digest, sizeof(digest), nV - 27, 0) == 1)
-            return;
+        // serialized keys are compressed whatever the signature says
+        public_key_data dat;
+        if( p256::recover( (const unsigned char*)digest.data(), r, s, nV - 27, (unsigned char*)dat.data ) )
+            return dat;
         FC_THROW_EXCEPTION( exception, "unable to reconstruct public key from signature" );
     }
 
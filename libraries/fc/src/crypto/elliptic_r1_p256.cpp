@@ -0,0 +1,262 @@
+#include "_elliptic_r1_p256.hpp"
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+
+#include <cstring>
+
+namespace fc { namespace crypto { namespace r1 { namespace p256 {
+
+   namespace {
+
+      typedef unsigned __int128 uint128_t;
+
+      /// 256 bit integer, least significant limb first
+      struct num {
+         uint64_t v[4];
+      };
+
+      const num p_value = {{ 0xffffffffffffffffULL, 0x00000000ffffffffULL, 0x0000000000000000ULL, 0xffffffff00000001ULL }};
+      const num n_value = {{ 0xf3b9cac2fc632551ULL, 0xbce6faada7179e84ULL, 0xffffffffffffffffULL, 0xffffffff00000000ULL }};
+      const num b_value = {{ 0x3bce3c3e27d2604bULL, 0x651d06b0cc53b0f6ULL, 0xb3ebbd55769886bcULL, 0x5ac635d8aa3a93e7ULL }};
+      /// floor(n / 2)
+      const num half_n_value = {{ 0x79dce5617e3192a8ULL, 0xde737d56d38bcf42ULL, 0x7fffffffffffffffULL, 0x7fffffff80000000ULL }};
+      /// (p + 1) / 4, y2^((p + 1) / 4) being a square root of y2 as p = 3 mod 4
+      const num sqrt_exponent = {{ 0x0000000000000000ULL, 0x0000000040000000ULL, 0x4000000000000000ULL, 0x3fffffffc0000000ULL }};
+      /// 2^512 mod p, to enter the Montgomery form
+      const num r2_value = {{ 0x0000000000000003ULL, 0xfffffffbffffffffULL, 0xfffffffffffffffeULL, 0x00000004fffffffdULL }};
+      const num one_value = {{ 1, 0, 0, 0 }};
+      /// 2^256 mod p, one in Montgomery form
+      const num mont_one = {{ 0x0000000000000001ULL, 0xffffffff00000000ULL, 0xffffffffffffffffULL, 0x00000000fffffffeULL }};
+
+      bool is_zero( const num& a ) {
+         return (a.v[0] | a.v[1] | a.v[2] | a.v[3]) == 0;
+      }
+
+      bool equal( const num& a, const num& b ) {
+         return a.v[0] == b.v[0] && a.v[1] == b.v[1] && a.v[2] == b.v[2] && a.v[3] == b.v[3];
+      }
+
+      int compare( const num& a, const num& b ) {
+         for( int i = 3; i >= 0; --i ) {
+            if( a.v[i] != b.v[i] )
+               return a.v[i] < b.v[i] ? -1 : 1;
+         }
+         return 0;
+      }
+
+      /// r = a + b, returns the carry
+      uint64_t add( num& r, const num& a, const num& b ) {
+         uint64_t carry = 0;
+         for( int i = 0; i < 4; ++i ) {
+            uint64_t d;
+            const bool c1 = __builtin_add_overflow( a.v[i], b.v[i], &d );
+            const bool c2 = __builtin_add_overflow( d, carry, &r.v[i] );
+            carry = c1 | c2;
+         }
+         return carry;
+      }
+
+      /// r = a - b, returns the borrow
+      uint64_t sub( num& r, const num& a, const num& b ) {
+         uint64_t borrow = 0;
+         for( int i = 0; i < 4; ++i ) {
+            uint64_t d;
+            const bool b1 = __builtin_sub_overflow( a.v[i], b.v[i], &d );
+            const bool b2 = __builtin_sub_overflow( d, borrow, &r.v[i] );
+            borrow = b1 | b2;
+         }
+         return borrow;
+      }
+
+      num from_bytes( const unsigned char* be32 ) {
+         num r;
+         for( int i = 0; i < 4; ++i ) {
+            uint64_t limb = 0;
+            for( int j = 0; j < 8; ++j )
+               limb = (limb << 8) | be32[(3 - i) * 8 + j];
+            r.v[i] = limb;
+         }
+         return r;
+      }
+
+      void to_bytes( unsigned char* be32, const num& a ) {
+         for( int i = 0; i < 4; ++i )
+            for( int j = 0; j < 8; ++j )
+               be32[(3 - i) * 8 + j] = (unsigned char)(a.v[i] >> (56 - 8 * j));
+      }
+
+      /// field arithmetic modulo p on values below p, multiplications in Montgomery form (a * 2^256 mod p)
+      num add_mod( const num& a, const num& b ) {
+         num r, t;
+         const uint64_t carry = add( r, a, b );
+         const uint64_t borrow = sub( t, r, p_value );
+         return carry || !borrow ? t : r;
+      }
+
+      num sub_mod( const num& a, const num& b ) {
+         num r, t;
+         if( sub( r, a, b ) ) {
+            add( t, r, p_value );
+            return t;
+         }
+         return r;
+      }
+
+      /// Montgomery multiplication; -p^-1 mod 2^64 is 1 and the limbs of p = 2^256 - 2^224 + 2^192 + 2^96 - 1
+      /// leave two multiplications per reduction round
+      num mul( const num& a, const num& b ) {
+         uint64_t t[9] = {};
+         for( int i = 0; i < 4; ++i ) {
+            uint128_t c = 0;
+            for( int j = 0; j < 4; ++j ) {
+               c += (uint128_t)a.v[j] * b.v[i] + t[i + j];
+               t[i + j] = (uint64_t)c;
+               c >>= 64;
+            }
+            t[i + 4] = (uint64_t)c;
+         }
+         for( int i = 0; i < 4; ++i ) {
+            // t + q * p with q = t[i] clears limb i, its low limb p[0] = 2^64 - 1 carrying q into limb i + 1
+            const uint64_t q = t[i];
+            uint128_t c = (uint128_t)q * 0xffffffffULL + t[i + 1] + q;
+            t[i + 1] = (uint64_t)c;
+            c >>= 64;
+            c += t[i + 2];
+            t[i + 2] = (uint64_t)c;
+            c >>= 64;
+            c += (uint128_t)q * 0xffffffff00000001ULL + t[i + 3];
+            t[i + 3] = (uint64_t)c;
+            c >>= 64;
+            for( int k = i + 4; k < 9; ++k ) {
+               c += t[k];
+               t[k] = (uint64_t)c;
+               c >>= 64;
+            }
+         }
+         num r = {{ t[4], t[5], t[6], t[7] }}, s;
+         const uint64_t borrow = sub( s, r, p_value );
+         return t[8] || !borrow ? s : r;
+      }
+
+      num sqr( const num& a ) { return mul( a, a ); }
+      num to_mont( const num& a ) { return mul( a, r2_value ); }
+      num from_mont( const num& a ) { return mul( a, one_value ); }
+
+      /// a^e, a and the result in Montgomery form
+      num pow( const num& a, const num& e ) {
+         num r = mont_one;
+         for( int i = 255; i >= 0; --i ) {
+            r = sqr( r );
+            if( (e.v[i / 64] >> (i % 64)) & 1 )
+               r = mul( r, a );
+         }
+         return r;
+      }
+
+      /// the EC_POINT_mul of OpenSSL, whose P-256 implementation is the fastest on hand, on objects allocated once
+      /// per thread
+      struct openssl_context {
+         const EC_GROUP* group;
+         BN_CTX*         ctx;
+         BIGNUM*         order;
+         BIGNUM*         zero;
+         BIGNUM*         r;
+         BIGNUM*         s;
+         BIGNUM*         e;
+         BIGNUM*         rr;
+         BIGNUM*         x;
+         BIGNUM*         y;
+         EC_POINT*       rp;
+         EC_POINT*       q;
+
+         openssl_context() {
+            static const EC_GROUP* shared_group = EC_GROUP_new_by_curve_name( NID_X9_62_prime256v1 );
+            group = shared_group;
+            ctx = BN_CTX_new();
+            order = BN_new();
+            zero = BN_new();
+            r = BN_new();
+            s = BN_new();
+            e = BN_new();
+            rr = BN_new();
+            x = BN_new();
+            y = BN_new();
+            rp = EC_POINT_new( group );
+            q = EC_POINT_new( group );
+            EC_GROUP_get_order( group, order, ctx );
+            BN_zero( zero );
+         }
+
+         ~openssl_context() {
+            EC_POINT_free( q );
+            EC_POINT_free( rp );
+            BN_free( y );
+            BN_free( x );
+            BN_free( rr );
+            BN_free( e );
+            BN_free( s );
+            BN_free( r );
+            BN_free( zero );
+            BN_free( order );
+            BN_CTX_free( ctx );
+         }
+      };
+
+   }
+
+   bool is_low_s( const unsigned char* s32 ) {
+      return compare( from_bytes( s32 ), half_n_value ) <= 0;
+   }
+
+   bool recover( const unsigned char* digest32, const unsigned char* r32, const unsigned char* s32, int recid,
+                 unsigned char* pub33 ) {
+      // x = r + (recid / 2) * n, which has to be a field element
+      const num r = from_bytes( r32 );
+      num x = r;
+      if( (recid & 2) && add( x, r, n_value ) )
+         return false;
+      if( compare( x, p_value ) >= 0 )
+         return false;
+
+      // the point R with that x and the parity of y given by recid, y^2 = x^3 - 3x + b
+      const num xm = to_mont( x );
+      const num y2 = add_mod( sub_mod( mul( sqr( xm ), xm ), add_mod( add_mod( xm, xm ), xm ) ), to_mont( b_value ) );
+      const num ym = pow( y2, sqrt_exponent );
+      if( !equal( sqr( ym ), y2 ) )
+         return false;
+      num y = from_mont( ym );
+      if( int(y.v[0] & 1) != (recid & 1) ) {
+         if( is_zero( y ) )
+            return false;
+         y = sub_mod( num{{ 0, 0, 0, 0 }}, y );
+      }
+
+      // Q = r^-1 * (s * R - e * G)
+      static thread_local openssl_context c;
+      unsigned char x32[32], y32[32];
+      to_bytes( x32, x );
+      to_bytes( y32, y );
+      if( !BN_bin2bn( r32, 32, c.r ) || !BN_bin2bn( s32, 32, c.s ) || !BN_bin2bn( digest32, 32, c.e ) ||
+          !BN_bin2bn( x32, 32, c.x ) || !BN_bin2bn( y32, 32, c.y ) )
+         return false;
+      if( !EC_POINT_set_affine_coordinates_GFp( c.group, c.rp, c.x, c.y, c.ctx ) )
+         return false;
+      if( !BN_mod_inverse( c.rr, c.r, c.order, c.ctx ) )
+         return false;
+      if( !BN_mod_sub( c.e, c.zero, c.e, c.order, c.ctx ) ||
+          !BN_mod_mul( c.s, c.s, c.rr, c.order, c.ctx ) ||
+          !BN_mod_mul( c.e, c.e, c.rr, c.order, c.ctx ) )
+         return false;
+      if( !EC_POINT_mul( c.group, c.q, c.e, c.rp, c.s, c.ctx ) )
+         return false;
+
+      if( EC_POINT_is_at_infinity( c.group, c.q ) ) {
+         memset( pub33, 0, 33 );
+         return true;
+      }
+      return EC_POINT_point2oct( c.group, c.q, POINT_CONVERSION_COMPRESSED, pub33, 33, c.ctx ) == 33;
+   }
+
+} } } } // fc::crypto::r1::p256
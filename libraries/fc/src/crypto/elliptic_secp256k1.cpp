@@ -10,6 +10,7 @@
 #include <fc/log/logger.hpp>
 
 #include <secp256k1.h>
+#include <secp256k1_batch.h>
 
 #if _WIN32
 # include <malloc.h>
@@ -169,6 +170,37 @@ namespace fc { namespace ecc {
         FC_ASSERT( pk_len == my->_key.size() );
     }
 
+    void public_key::recover_many( const compact_signature* sigs, const fc::sha256* digests, size_t count,
+                                   public_key* out, bool check_canonical )
+    {
+        std::vector<const unsigned char*> msgs( count );
+        std::vector<const unsigned char*> sig64s( count );
+        std::vector<int> recids( count );
+        for( size_t i = 0; i < count; ++i ) {
+            int nV = sigs[i].data[0];
+            if (nV<27 || nV>=35)
+                FC_THROW_EXCEPTION( exception, "unable to reconstruct public key from signature" );
+            if( check_canonical )
+            {
+                FC_ASSERT( is_canonical( sigs[i] ), "signature is not canonical" );
+            }
+            msgs[i] = (const unsigned char*) digests[i].data();
+            sig64s[i] = (const unsigned char*) sigs[i].begin() + 1;
+            recids[i] = (nV - 27) & 3;
+        }
+
+        std::vector<unsigned char> keys( count * sizeof(public_key_data) );
+        std::vector<int> results( count );
+        static_assert( sizeof(public_key_data) == 33, "secp256k1 batch recovery writes compressed keys" );
+        if( !secp256k1_ecdsa_recover_compact_batch( detail::_get_context(), count, msgs.data(), sig64s.data(), recids.data(),
+                                                    keys.data(), results.data() ) ) {
+            for( size_t i = 0; i < count; ++i )
+                FC_ASSERT( results[i], "unable to reconstruct public key from signature ${i}", ("i", i) );
+        }
+        for( size_t i = 0; i < count; ++i )
+            memcpy( out[i].my->_key.begin(), keys.data() + i * sizeof(public_key_data), sizeof(public_key_data) );
+    }
+
 
      commitment_type blind( const blind_factor_type& blind, uint64_t value )
      {
@@ -1,6 +1,9 @@
 #include <fc/crypto/public_key.hpp>
 #include <fc/crypto/common.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/crypto/city.hpp>
+
+#include <mutex>
 
 namespace fc { namespace crypto {
 
@@ -24,6 +27,30 @@ namespace fc { namespace crypto {
    {
    }
 
+   void public_key::recover_many( const signature* sigs, const sha256* digests, size_t count, public_key* out,
+                                  bool check_canonical )
+   {
+      std::vector<size_t> k1;
+      std::vector<ecc::compact_signature> k1_sigs;
+      std::vector<sha256> k1_digests;
+      for( size_t i = 0; i < count; ++i ) {
+         if( sigs[i]._storage.contains<ecc::signature_shim>() ) {
+            k1.push_back( i );
+            k1_sigs.push_back( sigs[i]._storage.get<ecc::signature_shim>()._data );
+            k1_digests.push_back( digests[i] );
+         } else {
+            out[i] = public_key( sigs[i], digests[i], check_canonical );
+         }
+      }
+      if( k1.empty() )
+         return;
+
+      std::vector<ecc::public_key> keys( k1.size() );
+      ecc::public_key::recover_many( k1_sigs.data(), k1_digests.data(), k1.size(), keys.data(), check_canonical );
+      for( size_t j = 0; j < k1.size(); ++j )
+         out[k1[j]] = public_key( storage_type( ecc::public_key_shim( keys[j].serialize() ) ) );
+   }
+
    static public_key::storage_type parse_base58(const std::string& base58str)
    {
       constexpr auto legacy_prefix = config::public_key_legacy_prefix;
@@ -68,16 +95,75 @@ namespace fc { namespace crypto {
       return _storage.visit(is_valid_visitor());
    }
 
+   namespace {
+      struct serialize_visitor : public fc::visitor<const ecc::public_key_data&> {
+         template< typename KeyType >
+         const ecc::public_key_data& operator()( const KeyType& key )const {
+            static_assert( std::is_same<typename KeyType::data_type, ecc::public_key_data>::value, "" );
+            return key.serialize();
+         }
+      };
+
+      /// the string forms of recently printed keys, in a direct mapped table so that its size stays bounded
+      class string_cache {
+         public:
+            bool get( int which, const ecc::public_key_data& data, std::string& str ) {
+               std::lock_guard<std::mutex> g( mtx );
+               const auto& e = entries[index( data )];
+               if( e.str.empty() || e.which != which || e.data != data )
+                  return false;
+               str = e.str;
+               return true;
+            }
+
+            void put( int which, const ecc::public_key_data& data, const std::string& str ) {
+               std::lock_guard<std::mutex> g( mtx );
+               auto& e = entries[index( data )];
+               e.which = which;
+               e.data = data;
+               e.str = str;
+            }
+
+         private:
+            struct entry {
+               int                  which = 0;
+               ecc::public_key_data data;
+               std::string          str;
+            };
+
+            static size_t index( const ecc::public_key_data& data ) {
+               return city_hash64( data.data, data.size() ) % entries_size;
+            }
+
+            static const size_t   entries_size = 4096;
+            std::mutex            mtx;
+            std::vector<entry>    entries = std::vector<entry>( entries_size );
+      };
+
+      string_cache& get_string_cache() {
+         static string_cache cache;
+         return cache;
+      }
+   }
+
    public_key::operator std::string() const
    {
+      // API output of accounts and blocks prints the same keys over and over
+      const int which = _storage.which();
+      const auto& data = _storage.visit( serialize_visitor() );
+      std::string str;
+      if( get_string_cache().get( which, data, str ) )
+         return str;
+
       auto data_str = _storage.visit(base58str_visitor<storage_type, config::public_key_prefix, 0>());
 
-      auto which = _storage.which();
       if (which == 0) {
-         return std::string(config::public_key_legacy_prefix) + data_str;
+         str = std::string(config::public_key_legacy_prefix) + data_str;
       } else {
-         return std::string(config::public_key_base_prefix) + "_" + data_str;
+         str = std::string(config::public_key_base_prefix) + "_" + data_str;
       }
+      get_string_cache().put( which, data, str );
+      return str;
    }
 
    std::ostream& operator<<(std::ostream& s, const public_key& k) {
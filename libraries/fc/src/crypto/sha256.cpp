@@ -9,6 +9,13 @@
 #include <fc/exception/exception.hpp>
 #include "_digest_common.hpp"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FC_SHA256_MULTI_BUFFER
+#include <algorithm>
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 namespace fc {
 
     sha256::sha256() { memset( _hash, 0, sizeof(_hash) ); }
@@ -55,6 +62,161 @@ namespace fc {
         return hash( s.data(), sizeof( s._hash ) );
     }
 
+#ifdef FC_SHA256_MULTI_BUFFER
+    namespace detail { namespace sha256_mb {
+
+       constexpr size_t lanes = 8;
+
+       static const uint32_t k[64] = {
+          0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+          0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+          0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+          0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+          0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+          0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+          0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+          0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+       };
+
+       static const uint32_t initial_state[8] = {
+          0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+       };
+
+       /// OpenSSL already uses the SHA extensions for a single message, lanes only pay off without them
+       static bool use_multi_buffer() {
+          static const bool use = []() {
+             if( !__builtin_cpu_supports( "avx2" ) )
+                return false;
+             unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+             if( !__get_cpuid_count( 7, 0, &eax, &ebx, &ecx, &edx ) )
+                return false;
+             return !( ebx & (1u << 29) );
+          }();
+          return use;
+       }
+
+#define FC_SHA256_ROR(x, n) _mm256_or_si256( _mm256_srli_epi32( x, n ), _mm256_slli_epi32( x, 32 - (n) ) )
+
+       /// one block of each lane, the state of the lanes outside of active is left alone
+       __attribute__((target("avx2")))
+       static void compress( __m256i* state, const uint8_t* const* blocks, __m256i active ) {
+          const __m256i bswap = _mm256_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                                 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 );
+          __m256i w[64];
+          for( int t = 0; t < 16; ++t ) {
+             uint32_t words[lanes];
+             for( size_t l = 0; l < lanes; ++l )
+                memcpy( &words[l], blocks[l] + 4 * t, 4 );
+             w[t] = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)words ), bswap );
+          }
+          for( int t = 16; t < 64; ++t ) {
+             const __m256i s0 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROR( w[t - 15], 7 ), FC_SHA256_ROR( w[t - 15], 18 ) ),
+                                                  _mm256_srli_epi32( w[t - 15], 3 ) );
+             const __m256i s1 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROR( w[t - 2], 17 ), FC_SHA256_ROR( w[t - 2], 19 ) ),
+                                                  _mm256_srli_epi32( w[t - 2], 10 ) );
+             w[t] = _mm256_add_epi32( _mm256_add_epi32( w[t - 16], s0 ), _mm256_add_epi32( w[t - 7], s1 ) );
+          }
+
+          __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+          __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+          for( int t = 0; t < 64; ++t ) {
+             const __m256i S1 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROR( e, 6 ), FC_SHA256_ROR( e, 11 ) ), FC_SHA256_ROR( e, 25 ) );
+             const __m256i ch = _mm256_xor_si256( _mm256_and_si256( e, f ), _mm256_andnot_si256( e, g ) );
+             const __m256i t1 = _mm256_add_epi32( _mm256_add_epi32( _mm256_add_epi32( h, S1 ), ch ),
+                                                  _mm256_add_epi32( _mm256_set1_epi32( k[t] ), w[t] ) );
+             const __m256i S0 = _mm256_xor_si256( _mm256_xor_si256( FC_SHA256_ROR( a, 2 ), FC_SHA256_ROR( a, 13 ) ), FC_SHA256_ROR( a, 22 ) );
+             const __m256i maj = _mm256_or_si256( _mm256_and_si256( a, b ), _mm256_and_si256( c, _mm256_or_si256( a, b ) ) );
+             h = g;
+             g = f;
+             f = e;
+             e = _mm256_add_epi32( d, t1 );
+             d = c;
+             c = b;
+             b = a;
+             a = _mm256_add_epi32( t1, _mm256_add_epi32( S0, maj ) );
+          }
+          const __m256i out[8] = { a, b, c, d, e, f, g, h };
+          for( int i = 0; i < 8; ++i )
+             state[i] = _mm256_blendv_epi8( state[i], _mm256_add_epi32( state[i], out[i] ), active );
+       }
+
+#undef FC_SHA256_ROR
+
+       /// hashes up to lanes messages side by side
+       __attribute__((target("avx2")))
+       static void hash_lanes( const char* const* data, const uint32_t* sizes, size_t n, sha256* out ) {
+          static const uint8_t zero_block[64] = {};
+          uint8_t  tails[lanes][128];
+          uint64_t full_blocks[lanes] = {};
+          uint64_t total_blocks[lanes] = {};
+          uint64_t max_blocks = 0;
+          for( size_t l = 0; l < n; ++l ) {
+             const uint32_t size = sizes[l];
+             const uint32_t rem = size % 64;
+             full_blocks[l] = size / 64;
+             memset( tails[l], 0, sizeof(tails[l]) );
+             memcpy( tails[l], data[l] + full_blocks[l] * 64, rem );
+             tails[l][rem] = 0x80;
+             const uint64_t tail_blocks = rem + 9 > 64 ? 2 : 1;
+             const uint64_t bits = uint64_t(size) * 8;
+             for( int i = 0; i < 8; ++i )
+                tails[l][tail_blocks * 64 - 1 - i] = uint8_t( bits >> (8 * i) );
+             total_blocks[l] = full_blocks[l] + tail_blocks;
+             max_blocks = std::max( max_blocks, total_blocks[l] );
+          }
+
+          __m256i state[8];
+          for( int i = 0; i < 8; ++i )
+             state[i] = _mm256_set1_epi32( initial_state[i] );
+          for( uint64_t blk = 0; blk < max_blocks; ++blk ) {
+             const uint8_t* blocks[lanes];
+             int32_t        mask[lanes];
+             for( size_t l = 0; l < lanes; ++l ) {
+                if( blk < full_blocks[l] )
+                   blocks[l] = (const uint8_t*)data[l] + blk * 64;
+                else if( blk < total_blocks[l] )
+                   blocks[l] = tails[l] + (blk - full_blocks[l]) * 64;
+                else
+                   blocks[l] = zero_block;
+                mask[l] = blk < total_blocks[l] ? -1 : 0;
+             }
+             compress( state, blocks, _mm256_loadu_si256( (const __m256i*)mask ) );
+          }
+
+          uint32_t words[8][lanes];
+          for( int i = 0; i < 8; ++i )
+             _mm256_storeu_si256( (__m256i*)words[i], state[i] );
+          for( size_t l = 0; l < n; ++l ) {
+             uint8_t* digest = (uint8_t*)out[l].data();
+             for( int i = 0; i < 8; ++i ) {
+                const uint32_t v = words[i][l];
+                digest[4 * i]     = uint8_t( v >> 24 );
+                digest[4 * i + 1] = uint8_t( v >> 16 );
+                digest[4 * i + 2] = uint8_t( v >> 8 );
+                digest[4 * i + 3] = uint8_t( v );
+             }
+          }
+       }
+
+    } } // detail::sha256_mb
+#endif
+
+    void sha256::hash_many( const char* const* data, const uint32_t* sizes, size_t count, sha256* out ) {
+       size_t i = 0;
+#ifdef FC_SHA256_MULTI_BUFFER
+       if( detail::sha256_mb::use_multi_buffer() ) {
+          // less than half filled lanes are slower than hashing the messages one by one
+          while( count - i >= detail::sha256_mb::lanes / 2 ) {
+             const size_t n = std::min( detail::sha256_mb::lanes, count - i );
+             detail::sha256_mb::hash_lanes( data + i, sizes + i, n, out + i );
+             i += n;
+          }
+       }
+#endif
+       for( ; i < count; ++i )
+          out[i] = hash( data[i], sizes[i] );
+    }
+
     void sha256::encoder::write( const char* d, uint32_t dlen ) {
       SHA256_Update( &my->ctx, d, dlen);
     }
@@ -1,4 +1,5 @@
 #include <fc/io/json.hpp>
+#include <fc/io/json_writer.hpp>
 #include <fc/exception/exception.hpp>
 //#include <fc/io/fstream.hpp>
 //#include <fc/io/sstream.hpp>
@@ -10,8 +11,70 @@
 
 #include <boost/filesystem/fstream.hpp>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace fc
 {
+    namespace {
+       /**
+        *  The subset of istream the parsers use, reading from a string in memory. peek() and get() behave like
+        *  they do on a std::stringstream, including returning EOF and setting eof() when reading past the end,
+        *  without the sentry and locale overhead paid by the stream on every character.
+        */
+       class string_input {
+          public:
+             explicit string_input( const std::string& s ) : pos( s.data() ), end( s.data() + s.size() ) {}
+
+             int peek() {
+                if( pos == end ) { at_eof = true; return EOF; }
+                return static_cast<unsigned char>( *pos );
+             }
+             int get() {
+                if( pos == end ) { at_eof = true; return EOF; }
+                return static_cast<unsigned char>( *pos++ );
+             }
+             bool eof()const { return at_eof; }
+
+             /// appends the characters up to the next '"', '\\', 0x04 or the end of the input to token
+             void read_plain_chars( std::string& token ) {
+                const char* start = pos;
+#if defined(__SSE2__)
+                const __m128i quote     = _mm_set1_epi8( '"' );
+                const __m128i backslash = _mm_set1_epi8( '\\' );
+                const __m128i eot       = _mm_set1_epi8( 0x04 );
+                while( end - pos >= 16 ) {
+                   const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pos ) );
+                   const int mask = _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                                                   _mm_cmpeq_epi8( chunk, backslash ) ),
+                                                                     _mm_cmpeq_epi8( chunk, eot ) ) );
+                   if( mask ) {
+                      pos += __builtin_ctz( mask );
+                      token.append( start, pos );
+                      return;
+                   }
+                   pos += 16;
+                }
+#endif
+                while( pos != end && *pos != '"' && *pos != '\\' && *pos != 0x04 )
+                   ++pos;
+                token.append( start, pos );
+             }
+
+          private:
+             const char* pos;
+             const char* end;
+             bool        at_eof = false;
+       };
+
+       /// streams other than string_input are read one character at a time
+       template<typename T>
+       void read_plain_chars( T& in, std::string& token ) {}
+
+       void read_plain_chars( string_input& in, std::string& token ) { in.read_plain_chars( token ); }
+    }
+
     // forward declarations of provided functions
     template<typename T, json::parse_type parser_type> variant variant_from_stream( T& in, uint32_t max_depth );
     template<typename T> char parseEscape( T& in );
@@ -22,7 +85,7 @@ namespace fc
     template<typename T, json::parse_type parser_type> variants arrayFromStream( T& in, uint32_t max_depth );
     template<typename T, json::parse_type parser_type> variant number_from_stream( T& in );
     template<typename T> variant token_from_stream( T& in );
-    void escape_string( const std::string& str, std::ostream& os );
+    template<typename T> void escape_string( const std::string& str, T& os );
     template<typename T> void to_stream( T& os, const variants& a, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant_object& o, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant& v, json::output_formatting format );
@@ -89,7 +152,7 @@ namespace fc
    template<typename T>
    std::string stringFromStream( T& in )
    {
-      std::stringstream token;
+      std::string token;
       try
       {
          char c = in.peek();
@@ -101,31 +164,32 @@ namespace fc
          in.get();
          while( !in.eof() )
          {
+            read_plain_chars( in, token );
             switch( c = in.peek() )
             {
                case '\\':
-                  token << parseEscape( in );
+                  token += parseEscape( in );
                   break;
                case 0x04:
                   FC_THROW_EXCEPTION( parse_error_exception, "EOF before closing '\"' in string '${token}'",
-                                                   ("token", token.str() ) );
+                                                   ("token", token ) );
                case '"':
                   in.get();
-                  return token.str();
+                  return token;
                default:
-                  token << c;
+                  token += c;
                   in.get();
             }
          }
          FC_THROW_EXCEPTION( parse_error_exception, "EOF before closing '\"' in string '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
        } FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
    }
    template<typename T>
    std::string stringFromToken( T& in )
    {
-      std::stringstream token;
+      std::string token;
       try
       {
          char c = in.peek();
@@ -135,37 +199,37 @@ namespace fc
             switch( c = in.peek() )
             {
                case '\\':
-                  token << parseEscape( in );
+                  token += parseEscape( in );
                   break;
                case '\t':
                case ' ':
                case '\n':
                   in.get();
-                  return token.str();
+                  return token;
                case '\0':
                   FC_THROW_EXCEPTION( eof_exception, "unexpected end of file" );
                default:
                 if( isalnum( c ) || c == '_' || c == '-' || c == '.' || c == ':' || c == '/' )
                 {
-                  token << c;
+                  token += c;
                   in.get();
                 }
-                else return token.str();
+                else return token;
             }
          }
-         return token.str();
+         return token;
       }
       catch( const fc::eof_exception& eof )
       {
-         return token.str();
+         return token;
       }
       catch (const std::ios_base::failure&)
       {
-         return token.str();
+         return token;
       }
 
       FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
    }
 
    template<typename T, json::parse_type parser_type>
@@ -253,14 +317,14 @@ namespace fc
    template<typename T, json::parse_type parser_type>
    variant number_from_stream( T& in )
    {
-      std::stringstream ss;
+      std::string ss;
 
       bool  dot = false;
       bool  neg = false;
       if( in.peek() == '-')
       {
         neg = true;
-        ss.put( in.get() );
+        ss += char( in.get() );
       }
       bool done = false;
 
@@ -285,14 +349,14 @@ namespace fc
               case '7':
               case '8':
               case '9':
-                 ss.put( in.get() );
+                 ss += char( in.get() );
                  break;
               case '\0':
                  FC_THROW_EXCEPTION( eof_exception, "unexpected end of file" );
               default:
                  if( isalnum( c ) )
                  {
-                    return ss.str() + stringFromToken( in );
+                    return ss + stringFromToken( in );
                  }
                 done = true;
                 break;
@@ -305,7 +369,7 @@ namespace fc
       catch (const std::ios_base::failure&)
       {
       }
-      std::string str = ss.str();
+      std::string& str = ss;
       if (str == "-." || str == "." || str == "-") // check the obviously wrong things we could have encountered
         FC_THROW_EXCEPTION(parse_error_exception, "Can't parse token \"${token}\" as a JSON numeric constant", ("token", str));
       if( dot )
@@ -317,8 +381,7 @@ namespace fc
    template<typename T>
    variant token_from_stream( T& in )
    {
-      std::stringstream ss;
-      ss.exceptions( std::ifstream::badbit );
+      std::string ss;
       bool received_eof = false;
       bool done = false;
 
@@ -338,7 +401,7 @@ namespace fc
               case 'f':
               case 'a':
               case 's':
-                 ss.put( in.get() );
+                 ss += char( in.get() );
                  break;
               default:
                  done = true;
@@ -357,7 +420,7 @@ namespace fc
 
       // we can get here either by processing a delimiter as in "null,"
       // an EOF like "null<EOF>", or an invalid token like "nullZ"
-      std::string str = ss.str();
+      std::string& str = ss;
       if( str == "null" )
         return variant();
       if( str == "true" )
@@ -442,18 +505,18 @@ namespace fc
 
    variant json::from_string( const std::string& utf8_str, parse_type ptype, uint32_t max_depth )
    { try {
-      std::stringstream in( utf8_str );
+      string_input in( utf8_str );
       //in.exceptions( std::ifstream::eofbit );
       switch( ptype )
       {
           case legacy_parser:
-             return variant_from_stream<std::stringstream, legacy_parser>( in, max_depth );
+             return variant_from_stream<string_input, legacy_parser>( in, max_depth );
           case legacy_parser_with_string_doubles:
-              return variant_from_stream<std::stringstream, legacy_parser_with_string_doubles>( in, max_depth );
+              return variant_from_stream<string_input, legacy_parser_with_string_doubles>( in, max_depth );
           case strict_parser:
-              return json_relaxed::variant_from_stream<std::stringstream, true>( in, max_depth );
+              return json_relaxed::variant_from_stream<string_input, true>( in, max_depth );
           case relaxed_parser:
-              return json_relaxed::variant_from_stream<std::stringstream, false>( in, max_depth );
+              return json_relaxed::variant_from_stream<string_input, false>( in, max_depth );
           default:
               FC_ASSERT( false, "Unknown JSON parser type {ptype}", ("ptype", ptype) );
       }
@@ -462,13 +525,13 @@ namespace fc
    variants json::variants_from_string( const std::string& utf8_str, parse_type ptype, uint32_t max_depth )
    { try {
       variants result;
-      std::stringstream in( utf8_str );
+      string_input in( utf8_str );
       //in.exceptions( std::ifstream::eofbit );
       try {
          while( true )
          {
            // result.push_back( variant_from_stream( in ));
-           result.push_back(json_relaxed::variant_from_stream<std::stringstream, false>( in, max_depth ));
+           result.push_back(json_relaxed::variant_from_stream<string_input, false>( in, max_depth ));
          }
       } catch ( const fc::eof_exception& ){}
       return result;
@@ -491,7 +554,8 @@ namespace fc
     *
     *  All other characters are printed as UTF8.
     */
-   void escape_string( const string& str, std::ostream& os )
+   template<typename T>
+   void escape_string( const string& str, T& os )
    {
       os << '"';
       for( auto itr = str.begin(); itr != str.end(); ++itr )
@@ -840,20 +904,20 @@ namespace fc
    bool json::is_valid( const std::string& utf8_str, parse_type ptype, uint32_t max_depth )
    {
       if( utf8_str.size() == 0 ) return false;
-      std::stringstream in( utf8_str );
+      string_input in( utf8_str );
       switch( ptype )
       {
           case legacy_parser:
-             variant_from_stream<std::stringstream, legacy_parser>( in, max_depth );
+             variant_from_stream<string_input, legacy_parser>( in, max_depth );
               break;
           case legacy_parser_with_string_doubles:
-             variant_from_stream<std::stringstream, legacy_parser_with_string_doubles>( in, max_depth );
+             variant_from_stream<string_input, legacy_parser_with_string_doubles>( in, max_depth );
               break;
           case strict_parser:
-             json_relaxed::variant_from_stream<std::stringstream, true>( in, max_depth );
+             json_relaxed::variant_from_stream<string_input, true>( in, max_depth );
               break;
           case relaxed_parser:
-             json_relaxed::variant_from_stream<std::stringstream, false>( in, max_depth );
+             json_relaxed::variant_from_stream<string_input, false>( in, max_depth );
               break;
           default:
               FC_ASSERT( false, "Unknown JSON parser type {ptype}", ("ptype", ptype) );
@@ -862,4 +926,120 @@ namespace fc
       return false;
    }
 
+   namespace {
+      /// the subset of ostream to_stream uses, appending to a string
+      struct string_appender {
+         std::string& out;
+         string_appender& operator<<( char c )               { out += c; return *this; }
+         string_appender& operator<<( const char* s )        { out += s; return *this; }
+         string_appender& operator<<( const std::string& s ) { out += s; return *this; }
+         string_appender& operator<<( int64_t i )            { out += std::to_string( i ); return *this; }
+         string_appender& operator<<( uint64_t i )           { out += std::to_string( i ); return *this; }
+      };
+   }
+
+   json_writer::json_writer( std::string& out, json::output_formatting format )
+   :out(out),format(format) {}
+
+   void json_writer::separate()
+   {
+      if( after_key ) {
+         after_key = false;
+         return;
+      }
+      if( !first.empty() ) {
+         if( !first.back() ) out += ',';
+         first.back() = false;
+      }
+   }
+
+   void json_writer::begin_object()
+   {
+      separate();
+      out += '{';
+      first.push_back( true );
+   }
+
+   void json_writer::end_object()
+   {
+      FC_ASSERT( !first.empty() && !after_key, "json_writer: unbalanced end_object" );
+      first.pop_back();
+      out += '}';
+   }
+
+   void json_writer::begin_array()
+   {
+      separate();
+      out += '[';
+      first.push_back( true );
+   }
+
+   void json_writer::end_array()
+   {
+      FC_ASSERT( !first.empty() && !after_key, "json_writer: unbalanced end_array" );
+      first.pop_back();
+      out += ']';
+   }
+
+   void json_writer::key( const std::string& k )
+   {
+      FC_ASSERT( !after_key, "json_writer: key without value" );
+      separate();
+      string_appender a{out};
+      escape_string( k, a );
+      out += ':';
+      after_key = true;
+   }
+
+   void json_writer::value( const variant& v )
+   {
+      separate();
+      string_appender a{out};
+      fc::to_stream( a, v, format );
+   }
+
+   void json_writer::value( const std::string& s )
+   {
+      separate();
+      string_appender a{out};
+      escape_string( s, a );
+   }
+
+   void json_writer::value( bool b )
+   {
+      separate();
+      out += b ? "true" : "false";
+   }
+
+   void json_writer::null_value()
+   {
+      separate();
+      out += "null";
+   }
+
+   void json_writer::raw_value( const std::string& json )
+   {
+      separate();
+      out += json;
+   }
+
+   json_writer::mark json_writer::get_mark()const
+   {
+      mark m;
+      m.size = out.size();
+      m.depth = first.size();
+      m.first = first.empty() || first.back();
+      m.after_key = after_key;
+      return m;
+   }
+
+   void json_writer::rollback( const mark& m )
+   {
+      FC_ASSERT( m.size <= out.size() && m.depth <= first.size(), "json_writer: rollback past a mark that was not taken" );
+      out.resize( m.size );
+      first.resize( m.depth );
+      if( !first.empty() ) first.back() = m.first;
+      after_key = m.after_key;
+   }
+
 } // fc
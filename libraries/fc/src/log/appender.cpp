@@ -1,6 +1,7 @@
 #include <fc/log/appender.hpp>
 #include <fc/log/console_appender.hpp>
 #include <fc/log/gelf_appender.hpp>
+#include <fc/log/async_appender.hpp>
 #include <fc/log/logger_config.hpp>
 
 
@@ -9,5 +10,6 @@ namespace fc {
    static bool reg_console_appender = log_config::register_appender<console_appender>( "console" );
    //static bool reg_file_appender = appender::register_appender<file_appender>( "file" );
    static bool reg_gelf_appender = log_config::register_appender<gelf_appender>( "gelf" );
+   static bool reg_async_appender = log_config::register_appender<async_appender>( "async" );
 
 } // namespace fc
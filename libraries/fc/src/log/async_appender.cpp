@@ -0,0 +1,182 @@
+#include <fc/log/async_appender.hpp>
+#include <fc/log/logger_config.hpp>
+#include <fc/log/log_message.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/optional.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace fc {
+
+   class async_appender::impl {
+   public:
+      /// a slot holds a message once its sequence is one past the position it was written at
+      struct slot {
+         std::atomic<uint64_t>   sequence{0};
+         fc::optional<log_message> msg;
+      };
+
+      config                     cfg;
+      appender::ptr              wrapped;
+      std::unique_ptr<slot[]>    slots;
+      uint64_t                   mask = 0;
+
+      std::atomic<uint64_t>      push_pos{0};
+      uint64_t                   pop_pos = 0;        ///< only used by the writer thread
+      std::atomic<uint64_t>      written{0};
+      std::atomic<uint64_t>      dropped{0};
+
+      std::mutex                 wake_mutex;
+      std::condition_variable    wake;
+      std::atomic<bool>          waiting{false};
+      std::atomic<bool>          stopping{false};
+      std::thread                writer;
+
+      impl( const config& c, const appender::ptr& w )
+      :cfg(c), wrapped(w)
+      {
+         FC_ASSERT( wrapped, "async appender needs an appender to write to" );
+         FC_ASSERT( cfg.capacity > 0 && cfg.capacity <= (1u << 24), "async appender capacity must be in [1, 2^24]" );
+         uint64_t size = 2;
+         while( size < cfg.capacity ) size <<= 1;
+         mask = size - 1;
+         slots.reset( new slot[size] );
+         for( uint64_t i = 0; i < size; ++i )
+            slots[i].sequence.store( i, std::memory_order_relaxed );
+         writer = std::thread( [this]() { run(); } );
+      }
+
+      ~impl() {
+         stopping = true;
+         {
+            std::lock_guard<std::mutex> g( wake_mutex );
+            wake.notify_one();
+         }
+         writer.join();
+      }
+
+      /// any number of threads may push
+      bool try_push( const log_message& m ) {
+         uint64_t pos = push_pos.load( std::memory_order_relaxed );
+         for( ;; ) {
+            slot& s = slots[pos & mask];
+            const int64_t diff = int64_t( s.sequence.load( std::memory_order_acquire ) ) - int64_t( pos );
+            if( diff == 0 ) {
+               if( push_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+                  s.msg = m;
+                  s.sequence.store( pos + 1, std::memory_order_release );
+                  return true;
+               }
+            } else if( diff < 0 ) {
+               return false; // full
+            } else {
+               pos = push_pos.load( std::memory_order_relaxed );
+            }
+         }
+      }
+
+      bool has_queued()const {
+         return slots[pop_pos & mask].sequence.load( std::memory_order_acquire ) == pop_pos + 1;
+      }
+
+      void write( const log_message& m ) {
+         try {
+            wrapped->log( m );
+         } catch( ... ) {
+            // nothing to report a failing appender to, keep writing the next messages
+         }
+      }
+
+      void write_queued() {
+         while( has_queued() ) {
+            slot& s = slots[pop_pos & mask];
+            write( *s.msg );
+            s.msg.reset();
+            s.sequence.store( pop_pos + mask + 1, std::memory_order_release );
+            ++pop_pos;
+            written.store( pop_pos, std::memory_order_release );
+         }
+         if( auto n = dropped.exchange( 0, std::memory_order_relaxed ) ) {
+            write( log_message( FC_LOG_CONTEXT(warn), "async appender dropped ${n} messages as its queue was full",
+                                mutable_variant_object( "n", n ) ) );
+         }
+      }
+
+      void run() {
+         set_os_thread_name( "log" );
+         for( ;; ) {
+            write_queued();
+            if( stopping.load( std::memory_order_acquire ) ) {
+               write_queued();
+               break;
+            }
+            std::unique_lock<std::mutex> g( wake_mutex );
+            waiting.store( true );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            // the timeout only matters if a wake up gets lost, e.g. when a push races with going to sleep
+            if( !has_queued() && !stopping.load() )
+               wake.wait_for( g, std::chrono::milliseconds( 100 ) );
+            waiting.store( false, std::memory_order_relaxed );
+         }
+      }
+
+      void notify() {
+         std::atomic_thread_fence( std::memory_order_seq_cst );
+         if( waiting.load( std::memory_order_relaxed ) ) {
+            std::lock_guard<std::mutex> g( wake_mutex );
+            wake.notify_one();
+         }
+      }
+   };
+
+   async_appender::async_appender( const variant& args )
+   {
+      auto cfg = args.as<config>();
+      auto wrapped = log_config::create_appender( cfg.type, cfg.args );
+      FC_ASSERT( wrapped, "unknown appender type ${t} for async appender", ("t", cfg.type) );
+      my.reset( new impl( cfg, wrapped ) );
+   }
+
+   async_appender::async_appender( const config& cfg, const appender::ptr& wrapped )
+   :my( new impl( cfg, wrapped ) )
+   {
+   }
+
+   async_appender::~async_appender() {}
+
+   void async_appender::initialize( boost::asio::io_service& io_service ) {
+      my->wrapped->initialize( io_service );
+   }
+
+   void async_appender::log( const log_message& m ) {
+      if( my->try_push( m ) ) {
+         my->notify();
+         return;
+      }
+
+      const auto policy = my->cfg.overflow;
+      if( policy == overflow_policy::drop ||
+          (policy == overflow_policy::drop_below_warn && m.get_context().get_log_level() < log_level::warn) ) {
+         my->dropped.fetch_add( 1, std::memory_order_relaxed );
+         return;
+      }
+      do {
+         my->notify();
+         std::this_thread::yield();
+      } while( !my->try_push( m ) );
+      my->notify();
+   }
+
+   void async_appender::flush() {
+      const uint64_t target = my->push_pos.load( std::memory_order_acquire );
+      while( my->written.load( std::memory_order_acquire ) < target ) {
+         my->notify();
+         std::this_thread::yield();
+      }
+   }
+
+} // namespace fc
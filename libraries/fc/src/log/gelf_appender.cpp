@@ -6,15 +6,21 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/variant.hpp>
 #include <fc/io/json.hpp>
+#include <fc/io/json_writer.hpp>
+#include <fc/log/logger_config.hpp>
+#include <fc/metrics.hpp>
 #include <fc/crypto/city.hpp>
 #include <fc/compress/zlib.hpp>
 
+#include <boost/asio/ip/udp.hpp>
 #include <boost/lexical_cast.hpp>
+#include <condition_variable>
+#include <deque>
 #include <iomanip>
 #include <iostream>
-#include <queue>
+#include <mutex>
 #include <sstream>
-#include <iostream>
+#include <thread>
 
 namespace fc
 {
@@ -29,17 +35,198 @@ namespace fc
   class gelf_appender::impl
   {
   public:
+    /// a message waiting for the sender thread, formatting is left to that thread
+    struct queued_message
+    {
+      log_message message;
+      int64_t     time_ns;
+    };
+
     config                                    cfg;
     optional<boost::asio::ip::udp::endpoint>  gelf_endpoint;
-    udp_socket                                gelf_socket;
+    boost::asio::io_context                   sender_ioc;
+    boost::asio::ip::udp::socket              gelf_socket{sender_ioc};
+
+    std::mutex                                mtx;
+    std::condition_variable                   not_empty;
+    std::deque<queued_message>                queue;          // protected by mtx
+    bool                                      stopping = false; // protected by mtx
+    uint64_t                                  dropped = 0;    // protected by mtx, not reported yet
+    std::thread                               sender;
+
+    metrics::counter&                         sent_counter;
+    metrics::counter&                         dropped_counter;
+    uint64_t                                  log_counter = 0; // sender thread only
 
     impl(const config& c) :
-      cfg(c)
+      cfg(c),
+      sent_counter(metrics::registry::instance().add_counter("fc_gelf_messages_sent_total", "Log messages sent to the GELF endpoint")),
+      dropped_counter(metrics::registry::instance().add_counter("fc_gelf_messages_dropped_total",
+                                                                "Log messages dropped because the GELF send queue was full"))
     {
     }
 
     ~impl()
     {
+      {
+        std::lock_guard<std::mutex> g(mtx);
+        stopping = true;
+      }
+      not_empty.notify_one();
+      if (sender.joinable())
+        sender.join();
+    }
+
+    /// @return false if the queue is full and the message is dropped
+    bool push(log_message&& m, int64_t time_ns)
+    {
+      {
+        std::lock_guard<std::mutex> g(mtx);
+        if (queue.size() >= cfg.max_queue_size) {
+          ++dropped;
+          dropped_counter.inc();
+          return false;
+        }
+        queue.push_back(queued_message{std::move(m), time_ns});
+      }
+      not_empty.notify_one();
+      return true;
+    }
+
+    /// sender thread: takes all the queued messages at once and sends them, until stopped with an empty queue
+    void run()
+    {
+      std::deque<queued_message> batch;
+      for (;;) {
+        uint64_t batch_dropped = 0;
+        {
+          std::unique_lock<std::mutex> g(mtx);
+          not_empty.wait(g, [this]() { return stopping || !queue.empty(); });
+          if (queue.empty())
+            return;
+          batch.swap(queue);
+          std::swap(batch_dropped, dropped);
+        }
+        string json;
+        for (auto& m : batch) {
+          try {
+            json.clear();
+            format(m, batch_dropped, json);
+            batch_dropped = 0;
+            send(zlib_compress(json));
+            sent_counter.inc();
+          } catch (...) {
+            // nothing to log to, the message is lost
+          }
+        }
+        batch.clear();
+      }
+    }
+
+    /// writes m as GELF 1.1 JSON, with numbers unstringified, reporting dropped messages before it if any
+    void format(const queued_message& m, uint64_t dropped_before, string& out)
+    {
+      const log_context context = m.message.get_context();
+      json_writer w(out, json::legacy_generator);
+      w.begin_object();
+      w.key("version"); w.value(string("1.1"));
+      w.key("host"); w.value(cfg.host);
+      w.key("short_message"); w.value(format_string(m.message.get_format(), m.message.get_data()));
+      w.key("timestamp"); w.value(variant(m.time_ns / 1000000.));
+      w.key("_timestamp_ns"); w.value(variant(m.time_ns));
+      w.key("_log_id"); w.value(fc::to_string(++log_counter));
+
+      int level = 6; // info, also for all and off which shouldn't be used in log messages
+      switch (context.get_log_level())
+      {
+      case log_level::debug: level = 7; break;
+      case log_level::info:  level = 6; break;
+      case log_level::warn:  level = 4; break;
+      case log_level::error: level = 3; break;
+      case log_level::all:
+      case log_level::off:
+        break;
+      }
+      w.key("level"); w.value(variant(level));
+
+      if (!context.get_context().empty()) {
+        w.key("context"); w.value(context.get_context());
+      }
+      w.key("_line"); w.value(variant(context.get_line_number()));
+      w.key("_file"); w.value(context.get_file());
+      w.key("_method_name"); w.value(context.get_method());
+      w.key("_thread_name"); w.value(context.get_thread_name());
+      if (!context.get_task_name().empty()) {
+        w.key("_task_name"); w.value(context.get_task_name());
+      }
+      if (dropped_before) {
+        w.key("_dropped_before"); w.value(variant(dropped_before));
+      }
+      w.end_object();
+    }
+
+    void send(string gelf_message_as_string)
+    {
+      // graylog2 expects the zlib header to be 0x78 0x9c
+      // but miniz.c generates 0x78 0x01 (indicating
+      // low compression instead of default compression)
+      // so change that here
+      FC_ASSERT(gelf_message_as_string[0] == (char)0x78);
+      if (gelf_message_as_string[1] == (char)0x01 ||
+          gelf_message_as_string[1] == (char)0xda)
+        gelf_message_as_string[1] = (char)0x9c;
+      FC_ASSERT(gelf_message_as_string[1] == (char)0x9c);
+
+      // packets are sent by UDP, and they tend to disappear if they
+      // get too large.  It's hard to find any solid numbers on how
+      // large they can be before they get dropped -- datagrams can
+      // be up to 64k, but anything over 512 is not guaranteed.
+      // You can play with this number, intermediate values like
+      // 1400 and 8100 are likely to work on most intranets.
+      const unsigned max_payload_size = 512;
+
+      boost::system::error_code ec;
+      if (gelf_message_as_string.size() <= max_payload_size)
+      {
+        // no need to split
+        gelf_socket.send_to(boost::asio::buffer(gelf_message_as_string), *gelf_endpoint, 0, ec);
+      }
+      else
+      {
+        // split the message
+        // we need to generate an 8-byte ID for this message.
+        // city hash should do
+        uint64_t message_id = city_hash64(gelf_message_as_string.c_str(), gelf_message_as_string.size());
+        const unsigned header_length = 2 /* magic */ + 8 /* msg id */ + 1 /* seq */ + 1 /* count */;
+        const unsigned body_length = max_payload_size - header_length;
+        unsigned total_number_of_packets = (gelf_message_as_string.size() + body_length - 1) / body_length;
+        unsigned bytes_sent = 0;
+        unsigned number_of_packets_sent = 0;
+        char send_buffer[max_payload_size];
+        while (bytes_sent < gelf_message_as_string.size())
+        {
+          unsigned bytes_to_send = std::min((unsigned)gelf_message_as_string.size() - bytes_sent,
+                                            body_length);
+
+          char* ptr = send_buffer;
+          // magic number for chunked message
+          *(unsigned char*)ptr++ = 0x1e;
+          *(unsigned char*)ptr++ = 0x0f;
+
+          // message id
+          memcpy(ptr, (char*)&message_id, sizeof(message_id));
+          ptr += sizeof(message_id);
+
+          *(unsigned char*)(ptr++) = number_of_packets_sent;
+          *(unsigned char*)(ptr++) = total_number_of_packets;
+          memcpy(ptr, gelf_message_as_string.c_str() + bytes_sent,
+                 bytes_to_send);
+          gelf_socket.send_to(boost::asio::buffer(send_buffer, header_length + bytes_to_send), *gelf_endpoint, 0, ec);
+          ++number_of_packets_sent;
+          bytes_sent += bytes_to_send;
+        }
+        FC_ASSERT(number_of_packets_sent == total_number_of_packets);
+      }
     }
   };
 
@@ -84,8 +271,11 @@ namespace fc
 
       if (my->gelf_endpoint)
       {
-        my->gelf_socket.initialize(io_service);
-        my->gelf_socket.open();
+        my->gelf_socket.open(boost::asio::ip::udp::v4());
+        my->sender = std::thread([my = my.get()]() {
+          fc::set_os_thread_name("gelf");
+          my->run();
+        });
         std::cerr << "opened GELF socket to endpoint " << my->cfg.endpoint << "\n";
       }
     }
@@ -100,124 +290,10 @@ namespace fc
 
   void gelf_appender::log(const log_message& message)
   {
-    if (!my->gelf_endpoint)
+    if (!my->sender.joinable())
       return;
 
-    log_context context = message.get_context();
-
-    mutable_variant_object gelf_message;
-    gelf_message["version"] = "1.1";
-    gelf_message["host"] = my->cfg.host;
-    gelf_message["short_message"] = format_string(message.get_format(), message.get_data());
-
     // use now() instead of context.get_timestamp() because log_message construction can include user provided long running calls
-    const auto time_ns = time_point::now().time_since_epoch().count();
-    gelf_message["timestamp"] = time_ns / 1000000.;
-    gelf_message["_timestamp_ns"] = time_ns;
-
-    static uint64_t gelf_log_counter;
-    gelf_message["_log_id"] = fc::to_string(++gelf_log_counter);
-
-    switch (context.get_log_level())
-    {
-    case log_level::debug:
-      gelf_message["level"] = 7; // debug
-      break;
-    case log_level::info:
-      gelf_message["level"] = 6; // info
-      break;
-    case log_level::warn:
-      gelf_message["level"] = 4; // warning
-      break;
-    case log_level::error:
-      gelf_message["level"] = 3; // error
-      break;
-    case log_level::all:
-    case log_level::off:
-      // these shouldn't be used in log messages, but do something deterministic just in case
-      gelf_message["level"] = 6; // info
-      break;
-    }
-
-    if (!context.get_context().empty())
-      gelf_message["context"] = context.get_context();
-    gelf_message["_line"] = context.get_line_number();
-    gelf_message["_file"] = context.get_file();
-    gelf_message["_method_name"] = context.get_method();
-    gelf_message["_thread_name"] = context.get_thread_name();
-    if (!context.get_task_name().empty())
-      gelf_message["_task_name"] = context.get_task_name();
-
-    string gelf_message_as_string = json::to_string(gelf_message, json::legacy_generator); // GELF 1.1 specifies unstringified numbers
-    //unsigned uncompressed_size = gelf_message_as_string.size();
-    gelf_message_as_string = zlib_compress(gelf_message_as_string);
-
-    // graylog2 expects the zlib header to be 0x78 0x9c
-    // but miniz.c generates 0x78 0x01 (indicating
-    // low compression instead of default compression)
-    // so change that here
-    FC_ASSERT(gelf_message_as_string[0] == (char)0x78);
-    if (gelf_message_as_string[1] == (char)0x01 ||
-        gelf_message_as_string[1] == (char)0xda)
-      gelf_message_as_string[1] = (char)0x9c;
-    FC_ASSERT(gelf_message_as_string[1] == (char)0x9c);
-
-    // packets are sent by UDP, and they tend to disappear if they
-    // get too large.  It's hard to find any solid numbers on how
-    // large they can be before they get dropped -- datagrams can
-    // be up to 64k, but anything over 512 is not guaranteed.
-    // You can play with this number, intermediate values like
-    // 1400 and 8100 are likely to work on most intranets.
-    const unsigned max_payload_size = 512;
-
-    if (gelf_message_as_string.size() <= max_payload_size)
-    {
-      // no need to split
-      std::shared_ptr<char> send_buffer(new char[gelf_message_as_string.size()],
-                                        [](char* p){ delete[] p; });
-      memcpy(send_buffer.get(), gelf_message_as_string.c_str(),
-             gelf_message_as_string.size());
-
-      my->gelf_socket.send_to(send_buffer, gelf_message_as_string.size(),
-                              *my->gelf_endpoint);
-    }
-    else
-    {
-      // split the message
-      // we need to generate an 8-byte ID for this message.
-      // city hash should do
-      uint64_t message_id = city_hash64(gelf_message_as_string.c_str(), gelf_message_as_string.size());
-      const unsigned header_length = 2 /* magic */ + 8 /* msg id */ + 1 /* seq */ + 1 /* count */;
-      const unsigned body_length = max_payload_size - header_length;
-      unsigned total_number_of_packets = (gelf_message_as_string.size() + body_length - 1) / body_length;
-      unsigned bytes_sent = 0;
-      unsigned number_of_packets_sent = 0;
-      while (bytes_sent < gelf_message_as_string.size())
-      {
-        unsigned bytes_to_send = std::min((unsigned)gelf_message_as_string.size() - bytes_sent,
-                                          body_length);
-
-        std::shared_ptr<char> send_buffer(new char[max_payload_size],
-                                          [](char* p){ delete[] p; });
-        char* ptr = send_buffer.get();
-        // magic number for chunked message
-        *(unsigned char*)ptr++ = 0x1e;
-        *(unsigned char*)ptr++ = 0x0f;
-
-        // message id
-        memcpy(ptr, (char*)&message_id, sizeof(message_id));
-        ptr += sizeof(message_id);
-
-        *(unsigned char*)(ptr++) = number_of_packets_sent;
-        *(unsigned char*)(ptr++) = total_number_of_packets;
-        memcpy(ptr, gelf_message_as_string.c_str() + bytes_sent,
-               bytes_to_send);
-        my->gelf_socket.send_to(send_buffer, header_length + bytes_to_send,
-                                *my->gelf_endpoint);
-        ++number_of_packets_sent;
-        bytes_sent += bytes_to_send;
-      }
-      FC_ASSERT(number_of_packets_sent == total_number_of_packets);
-    }
+    my->push(log_message(message), time_point::now().time_since_epoch().count());
   }
 } // fc
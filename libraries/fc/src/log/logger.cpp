@@ -75,8 +75,34 @@ namespace fc {
     void logger::set_name( const fc::string& n ) { my->_name = n; }
     const fc::string& logger::name()const { return my->_name; }
 
+    namespace {
+       /// the loggers a thread looked up, valid until logging is configured again
+       struct logger_cache {
+          uint64_t                                   generation = 0;
+          std::vector<std::pair<fc::string, logger>> loggers;
+
+          ~logger_cache() { destroyed = true; }
+          static thread_local bool destroyed;
+       };
+       thread_local bool logger_cache::destroyed = false;
+       thread_local logger_cache cache;
+    }
+
     logger logger::get( const fc::string& s ) {
-       return log_config::get_logger( s );
+       // spares dlog, ilog, ... the log_config mutex and map lookup, even when their level is disabled
+       if( logger_cache::destroyed )
+          return log_config::get_logger( s );
+       const uint64_t generation = log_config::get().generation.load( std::memory_order_acquire );
+       if( cache.generation != generation ) {
+          cache.loggers.clear();
+          cache.generation = generation;
+       }
+       for( const auto& l : cache.loggers ) {
+          if( l.first == s )
+             return l.second;
+       }
+       cache.loggers.emplace_back( s, log_config::get_logger( s ) );
+       return cache.loggers.back().second;
     }
 
     void logger::update( const fc::string& name, logger& log ) {
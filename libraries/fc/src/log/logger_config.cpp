@@ -6,6 +6,7 @@
 #include <string>
 #include <fc/log/console_appender.hpp>
 #include <fc/log/gelf_appender.hpp>
+#include <fc/log/async_appender.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/exception/exception.hpp>
 
@@ -35,6 +36,13 @@ namespace fc {
          log = log_config::get().logger_map[name];
    }
 
+   appender::ptr log_config::create_appender( const fc::string& type, const variant& args ) {
+      auto fact_itr = log_config::get().appender_factory_map.find( type );
+      if( fact_itr == log_config::get().appender_factory_map.end() )
+         return appender::ptr();
+      return fact_itr->second->create( args );
+   }
+
    void log_config::initialize_appenders( boost::asio::io_service& ios ) {
       std::lock_guard g( log_config::get().log_mutex );
       for( auto& iter : log_config::get().appender_map )
@@ -52,20 +60,21 @@ namespace fc {
       try {
       static bool reg_console_appender = log_config::register_appender<console_appender>( "console" );
       static bool reg_gelf_appender = log_config::register_appender<gelf_appender>( "gelf" );
+      static bool reg_async_appender = log_config::register_appender<async_appender>( "async" );
 
       std::lock_guard g( log_config::get().log_mutex );
+      ++log_config::get().generation;
       log_config::get().logger_map.clear();
       log_config::get().appender_map.clear();
 
       //slog( "\n%s", fc::json::to_pretty_string(cfg).c_str() );
       for( size_t i = 0; i < cfg.appenders.size(); ++i ) {
          // create appender
-         auto fact_itr = log_config::get().appender_factory_map.find( cfg.appenders[i].type );
-         if( fact_itr == log_config::get().appender_factory_map.end() ) {
+         auto ap = create_appender( cfg.appenders[i].type, cfg.appenders[i].args );
+         if( !ap ) {
             //wlog( "Unknown appender type '%s'", type.c_str() );
             continue;
          }
-         auto ap = fact_itr->second->create( cfg.appenders[i].args );
          log_config::get().appender_map[cfg.appenders[i].name] = ap;
       }
       for( size_t i = 0; i < cfg.loggers.size(); ++i ) {
@@ -84,7 +93,7 @@ namespace fc {
             if( ap ) { lgr.add_appender(ap); }
          }
       }
-      return reg_console_appender || reg_gelf_appender;
+      return reg_console_appender || reg_gelf_appender || reg_async_appender;
       } catch ( exception& e )
       {
          std::cerr<<e.to_detail_string()<<"\n";
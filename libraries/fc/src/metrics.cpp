@@ -0,0 +1,181 @@
+#include <fc/metrics.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace fc { namespace metrics {
+
+   namespace {
+      uint64_t to_bits( double d ) {
+         uint64_t b;
+         memcpy( &b, &d, sizeof(b) );
+         return b;
+      }
+
+      double from_bits( uint64_t b ) {
+         double d;
+         memcpy( &d, &b, sizeof(d) );
+         return d;
+      }
+
+      void append_number( std::string& out, double v ) {
+         char buf[32];
+         snprintf( buf, sizeof(buf), "%.15g", v );
+         out += buf;
+      }
+
+      void append_labels( std::string& out, const labels& l, const char* extra_name = nullptr, const std::string& extra_value = {} ) {
+         if( l.empty() && !extra_name ) return;
+         out += '{';
+         bool first = true;
+         auto append = [&]( const std::string& name, const std::string& value ) {
+            if( !first ) out += ',';
+            first = false;
+            out += name;
+            out += "=\"";
+            for( char c : value ) {
+               if( c == '\\' || c == '"' ) {
+                  out += '\\';
+                  out += c;
+               } else if( c == '\n' ) {
+                  out += "\\n";
+               } else {
+                  out += c;
+               }
+            }
+            out += '"';
+         };
+         for( const auto& p : l )
+            append( p.first, p.second );
+         if( extra_name )
+            append( extra_name, extra_value );
+         out += '}';
+      }
+   }
+
+   histogram::histogram( std::vector<double> bounds )
+   :_bounds( std::move( bounds ) )
+   ,_buckets( new std::atomic<uint64_t>[_bounds.size() + 1]() )
+   {
+      FC_ASSERT( std::is_sorted( _bounds.begin(), _bounds.end() ) &&
+                 std::adjacent_find( _bounds.begin(), _bounds.end() ) == _bounds.end(),
+                 "histogram bounds must be increasing" );
+   }
+
+   void histogram::observe( double v ) {
+      const auto bucket = std::lower_bound( _bounds.begin(), _bounds.end(), v ) - _bounds.begin();
+      _buckets[bucket].fetch_add( 1, std::memory_order_relaxed );
+      uint64_t expected = _sum_bits.load( std::memory_order_relaxed );
+      while( !_sum_bits.compare_exchange_weak( expected, to_bits( from_bits( expected ) + v ), std::memory_order_relaxed ) )
+         ;
+   }
+
+   std::vector<uint64_t> histogram::cumulative_counts()const {
+      std::vector<uint64_t> result( _bounds.size() + 1 );
+      uint64_t total = 0;
+      for( size_t i = 0; i < result.size(); ++i ) {
+         total += _buckets[i].load( std::memory_order_relaxed );
+         result[i] = total;
+      }
+      return result;
+   }
+
+   double histogram::sum()const {
+      return from_bits( _sum_bits.load( std::memory_order_relaxed ) );
+   }
+
+   std::vector<double> exponential_bounds( double start, double factor, size_t count ) {
+      FC_ASSERT( start > 0 && factor > 1, "exponential bounds need start > 0 and factor > 1" );
+      std::vector<double> result;
+      result.reserve( count );
+      for( double b = start; result.size() < count; b *= factor )
+         result.push_back( b );
+      return result;
+   }
+
+   registry& registry::instance() {
+      static registry r;
+      return r;
+   }
+
+   registry::entry& registry::find_or_add( const std::string& name, const std::string& help, metric_type type, const labels& l ) {
+      auto itr = _families.find( name );
+      if( itr == _families.end() )
+         itr = _families.emplace( name, family{type, help, {}} ).first;
+      FC_ASSERT( itr->second.type == type, "metric ${n} is already registered with another type", ("n", name) );
+      auto& entries = itr->second.entries;
+      auto e = std::find_if( entries.begin(), entries.end(), [&]( const entry& e ) { return e.label_values == l; } );
+      if( e != entries.end() )
+         return *e;
+      entries.emplace_back();
+      entries.back().label_values = l;
+      return entries.back();
+   }
+
+   counter& registry::add_counter( const std::string& name, const std::string& help, const labels& l ) {
+      std::lock_guard<std::mutex> g( _mtx );
+      auto& e = find_or_add( name, help, metric_type::counter, l );
+      if( !e.c ) e.c.reset( new counter );
+      return *e.c;
+   }
+
+   gauge& registry::add_gauge( const std::string& name, const std::string& help, const labels& l ) {
+      std::lock_guard<std::mutex> g( _mtx );
+      auto& e = find_or_add( name, help, metric_type::gauge, l );
+      if( !e.g ) e.g.reset( new gauge );
+      return *e.g;
+   }
+
+   histogram& registry::add_histogram( const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                                       const labels& l ) {
+      std::lock_guard<std::mutex> g( _mtx );
+      auto& e = find_or_add( name, help, metric_type::histogram, l );
+      if( !e.h ) e.h.reset( new histogram( bounds ) );
+      return *e.h;
+   }
+
+   std::string registry::render()const {
+      std::string out;
+      std::lock_guard<std::mutex> g( _mtx );
+      for( const auto& f : _families ) {
+         const auto& name = f.first;
+         out += "# HELP " + name + " " + f.second.help + "\n";
+         out += "# TYPE " + name + " ";
+         out += f.second.type == metric_type::counter ? "counter\n" : f.second.type == metric_type::gauge ? "gauge\n" : "histogram\n";
+         for( const auto& e : f.second.entries ) {
+            if( e.c || e.g ) {
+               out += name;
+               append_labels( out, e.label_values );
+               out += ' ';
+               out += e.c ? std::to_string( e.c->value() ) : std::to_string( e.g->value() );
+               out += '\n';
+               continue;
+            }
+            const auto counts = e.h->cumulative_counts();
+            const auto& bounds = e.h->bounds();
+            for( size_t i = 0; i < counts.size(); ++i ) {
+               std::string le = "+Inf";
+               if( i < bounds.size() ) {
+                  le.clear();
+                  append_number( le, bounds[i] );
+               }
+               out += name + "_bucket";
+               append_labels( out, e.label_values, "le", le );
+               out += ' ' + std::to_string( counts[i] ) + '\n';
+            }
+            out += name + "_sum";
+            append_labels( out, e.label_values );
+            out += ' ';
+            append_number( out, e.h->sum() );
+            out += '\n';
+            out += name + "_count";
+            append_labels( out, e.label_values );
+            out += ' ' + std::to_string( counts.back() ) + '\n';
+         }
+      }
+      return out;
+   }
+
+} } // namespace fc::metrics
@@ -13,6 +13,9 @@
 #include <boost/asio/ssl/rfc2818_verification.hpp>
 #include <boost/filesystem.hpp>
 
+#include <deque>
+#include <mutex>
+
 using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
 namespace http = boost::beast::http;    // from <boost/beast/http.hpp>
 namespace ssl = boost::asio::ssl;       // from <boost/asio/ssl.hpp>
@@ -30,6 +33,12 @@ static const std::map<string,uint16_t> default_proto_ports = {
    {"https", 443}
 };
 
+/**
+ * Requests are sent over a pool of kept alive connections per endpoint. A request takes an idle connection of its
+ * endpoint, or opens a new one, and puts it back once the response is read, so requests of several threads to the
+ * same endpoint run at once over connections of their own. An idle connection is only reused if the server has not
+ * closed it and it was used recently; TLS sessions are resumed when a connection to an endpoint is reopened.
+ */
 class http_client_impl {
 public:
    using host_key = std::tuple<std::string, std::string, uint16_t>;
@@ -43,14 +52,24 @@ public:
                                      , unix_socket_ptr
 #endif
                                     >;
-   using connection_map = std::map<host_key, connection>;
    using unix_url_split_map = std::map<string, fc::url>;
    using error_code = boost::system::error_code;
    using deadline_type = boost::posix_time::ptime;
 
+   /// a connection with the io_context its operations run on, declared first so that it outlives the socket
+   struct pooled_connection {
+      boost::asio::io_context ioc;
+      connection              stream;
+      fc::time_point          idle_since;
+      bool                    reused = false;
+   };
+   using pooled_connection_ptr = std::unique_ptr<pooled_connection>;
+   /// idle connections by endpoint, the most recently used last
+   using connection_pool = std::map<host_key, std::deque<pooled_connection_ptr>>;
+   using ssl_session_ptr = std::shared_ptr<SSL_SESSION>;
+
    http_client_impl()
-   :_ioc()
-   ,_sslc(ssl::context::sslv23_client)
+   :_sslc(ssl::context::sslv23_client)
    {
       set_verify_peers(true);
    }
@@ -69,10 +88,16 @@ public:
       }
    }
 
+   void set_connection_pool(uint32_t max_idle_per_host, const fc::microseconds& max_idle_time) {
+      std::lock_guard<std::mutex> g(_mtx);
+      _max_idle_per_host = max_idle_per_host;
+      _max_idle_time = max_idle_time;
+   }
+
    template<typename SyncReadStream, typename Fn, typename CancelFn>
-   error_code sync_do_with_deadline( SyncReadStream& s, deadline_type deadline, Fn f, CancelFn cf ) {
+   error_code sync_do_with_deadline( boost::asio::io_context& ioc, SyncReadStream& s, deadline_type deadline, Fn f, CancelFn cf ) {
       bool timer_expired = false;
-      boost::asio::deadline_timer timer(_ioc);
+      boost::asio::deadline_timer timer(ioc);
 
       timer.expires_at(deadline);
       bool timer_cancelled = false;
@@ -88,8 +113,8 @@ public:
       optional<error_code> f_result;
       f(f_result);
 
-      _ioc.restart();
-      while (_ioc.run_one())
+      ioc.restart();
+      while (ioc.run_one())
       {
          if (f_result) {
             timer_cancelled = true;
@@ -107,18 +132,18 @@ public:
    }
 
    template<typename SyncReadStream, typename Fn>
-   error_code sync_do_with_deadline( SyncReadStream& s, deadline_type deadline, Fn f) {
-      return sync_do_with_deadline(s, deadline, f, [&s](){
+   error_code sync_do_with_deadline( boost::asio::io_context& ioc, SyncReadStream& s, deadline_type deadline, Fn f) {
+      return sync_do_with_deadline(ioc, s, deadline, f, [&s](){
          s.lowest_layer().cancel();
       });
    };
 
    template<typename SyncReadStream>
-   error_code sync_connect_with_timeout( SyncReadStream& s, const std::string& host, const std::string& port,  const deadline_type& deadline ) {
-      tcp::resolver local_resolver(_ioc);
+   error_code sync_connect_with_timeout( boost::asio::io_context& ioc, SyncReadStream& s, const std::string& host, const std::string& port,  const deadline_type& deadline ) {
+      tcp::resolver local_resolver(ioc);
       bool cancelled = false;
 
-      auto res = sync_do_with_deadline(s, deadline, [&local_resolver, &cancelled, &s, &host, &port](optional<error_code>& final_ec){
+      auto res = sync_do_with_deadline(ioc, s, deadline, [&local_resolver, &cancelled, &s, &host, &port](optional<error_code>& final_ec){
          local_resolver.async_resolve(host, port, [&cancelled, &s, &final_ec](const error_code& ec, tcp::resolver::results_type resolved ){
             if (ec) {
                final_ec.emplace(ec);
@@ -140,8 +165,8 @@ public:
    };
 
    template<typename SyncReadStream>
-   error_code sync_write_with_timeout(SyncReadStream& s, http::request<http::string_body>& req, const deadline_type& deadline ) {
-      return sync_do_with_deadline(s, deadline, [&s, &req](optional<error_code>& final_ec){
+   error_code sync_write_with_timeout(boost::asio::io_context& ioc, SyncReadStream& s, http::request<http::string_body>& req, const deadline_type& deadline ) {
+      return sync_do_with_deadline(ioc, s, deadline, [&s, &req](optional<error_code>& final_ec){
          http::async_write(s, req, [&final_ec]( const error_code& ec, std::size_t ) {
             final_ec.emplace(ec);
          });
@@ -149,8 +174,8 @@ public:
    }
 
    template<typename SyncReadStream>
-   error_code sync_read_with_timeout(SyncReadStream& s, boost::beast::flat_buffer& buffer, http::response<http::string_body>& res, const deadline_type& deadline ) {
-      return sync_do_with_deadline(s, deadline, [&s, &buffer, &res](optional<error_code>& final_ec){
+   error_code sync_read_with_timeout(boost::asio::io_context& ioc, SyncReadStream& s, boost::beast::flat_buffer& buffer, http::response<http::string_body>& res, const deadline_type& deadline ) {
+      return sync_do_with_deadline(ioc, s, deadline, [&s, &buffer, &res](optional<error_code>& final_ec){
          http::async_read(s, buffer, res, [&final_ec]( const error_code& ec, std::size_t ) {
             final_ec.emplace(ec);
          });
@@ -168,39 +193,34 @@ public:
    }
 
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
-   connection_map::iterator create_unix_connection( const url& dest, const deadline_type& deadline) {
-      auto key = url_to_host_key(dest);
-      auto socket = std::make_unique<local::stream_protocol::socket>(_ioc);
+   pooled_connection_ptr create_unix_connection( const url& dest, const deadline_type& deadline) {
+      auto conn = std::make_unique<pooled_connection>();
+      auto socket = std::make_unique<local::stream_protocol::socket>(conn->ioc);
 
       error_code ec;
       socket->connect(local::stream_protocol::endpoint(*dest.host()), ec);
       FC_ASSERT(!ec, "Failed to connect: ${message}", ("message",ec.message()));
 
-      auto res = _connections.emplace(std::piecewise_construct,
-                                      std::forward_as_tuple(key),
-                                      std::forward_as_tuple(std::move(socket)));
-
-      return res.first;
+      conn->stream = connection(std::move(socket));
+      return conn;
    }
 #endif
 
-   connection_map::iterator create_raw_connection( const url& dest, const deadline_type& deadline ) {
-      auto key = url_to_host_key(dest);
-      auto socket = std::make_unique<tcp::socket>(_ioc);
+   pooled_connection_ptr create_raw_connection( const url& dest, const deadline_type& deadline ) {
+      auto conn = std::make_unique<pooled_connection>();
+      auto socket = std::make_unique<tcp::socket>(conn->ioc);
 
-      error_code ec = sync_connect_with_timeout(*socket, *dest.host(), dest.port() ? std::to_string(*dest.port()) : "80", deadline);
+      error_code ec = sync_connect_with_timeout(conn->ioc, *socket, *dest.host(), dest.port() ? std::to_string(*dest.port()) : "80", deadline);
       FC_ASSERT(!ec, "Failed to connect: ${message}", ("message",ec.message()));
 
-      auto res = _connections.emplace(std::piecewise_construct,
-                                      std::forward_as_tuple(key),
-                                      std::forward_as_tuple(std::move(socket)));
-
-      return res.first;
+      conn->stream = connection(std::move(socket));
+      return conn;
    }
 
-   connection_map::iterator create_ssl_connection( const url& dest, const deadline_type& deadline ) {
+   pooled_connection_ptr create_ssl_connection( const url& dest, const deadline_type& deadline ) {
       auto key = url_to_host_key(dest);
-      auto ssl_socket = std::make_unique<ssl::stream<tcp::socket>>(_ioc, _sslc);
+      auto conn = std::make_unique<pooled_connection>();
+      auto ssl_socket = std::make_unique<ssl::stream<tcp::socket>>(conn->ioc, _sslc);
 
       // Set SNI Hostname (many hosts need this to handshake successfully)
       if(!SSL_set_tlsext_host_name(ssl_socket->native_handle(), dest.host()->c_str()))
@@ -211,9 +231,22 @@ public:
 
       ssl_socket->set_verify_callback(boost::asio::ssl::rfc2818_verification(*dest.host()));
 
-      error_code ec = sync_connect_with_timeout(ssl_socket->next_layer(), *dest.host(), dest.port() ? std::to_string(*dest.port()) : "443", deadline);
+      // resume the session of the last connection to the endpoint, saving the full handshake
+      ssl_session_ptr session;
+      {
+         std::lock_guard<std::mutex> g(_mtx);
+         auto itr = _ssl_sessions.find(key);
+         if (itr != _ssl_sessions.end()) {
+            session = itr->second;
+         }
+      }
+      if (session) {
+         SSL_set_session(ssl_socket->native_handle(), session.get());
+      }
+
+      error_code ec = sync_connect_with_timeout(conn->ioc, ssl_socket->next_layer(), *dest.host(), dest.port() ? std::to_string(*dest.port()) : "443", deadline);
       if (!ec) {
-         ec = sync_do_with_deadline(ssl_socket->next_layer(), deadline, [&ssl_socket](optional<error_code>& final_ec) {
+         ec = sync_do_with_deadline(conn->ioc, ssl_socket->next_layer(), deadline, [&ssl_socket](optional<error_code>& final_ec) {
             ssl_socket->async_handshake(ssl::stream_base::client, [&final_ec](const error_code& ec) {
                final_ec.emplace(ec);
             });
@@ -221,14 +254,16 @@ public:
       }
       FC_ASSERT(!ec, "Failed to connect: ${message}", ("message",ec.message()));
 
-      auto res = _connections.emplace(std::piecewise_construct,
-                                      std::forward_as_tuple(key),
-                                      std::forward_as_tuple(std::move(ssl_socket)));
+      if (SSL_SESSION* s = SSL_get1_session(ssl_socket->native_handle())) {
+         std::lock_guard<std::mutex> g(_mtx);
+         _ssl_sessions[key] = ssl_session_ptr(s, SSL_SESSION_free);
+      }
 
-      return res.first;
+      conn->stream = connection(std::move(ssl_socket));
+      return conn;
    }
 
-   connection_map::iterator create_connection( const url& dest, const deadline_type& deadline ) {
+   pooled_connection_ptr create_connection( const url& dest, const deadline_type& deadline ) {
       if (dest.proto() == "http") {
          return create_raw_connection(dest, deadline);
       } else if (dest.proto() == "https") {
@@ -242,61 +277,95 @@ public:
       }
    }
 
-   struct check_closed_visitor : public visitor<bool> {
+   /// an idle connection is usable if nothing can be read from it, the server neither closed it nor sent anything unasked
+   struct check_usable_visitor : public visitor<bool> {
+      template<typename Socket>
+      static bool usable( Socket& s ) {
+         if (!s.is_open()) {
+            return false;
+         }
+         error_code ec;
+         s.non_blocking(true, ec);
+         if (ec) {
+            return false;
+         }
+         char c;
+         s.receive(boost::asio::buffer(&c, 1), Socket::message_peek, ec);
+         const bool would_block = ec == boost::asio::error::would_block || ec == boost::asio::error::try_again;
+         s.non_blocking(false, ec);
+         return would_block && !ec;
+      }
+
       bool operator() ( const raw_socket_ptr& ptr ) const {
-         return !ptr->is_open();
+         return usable(*ptr);
       }
 
       bool operator() ( const ssl_socket_ptr& ptr ) const {
-         return !ptr->lowest_layer().is_open();
+         return usable(ptr->next_layer());
       }
 
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
       bool operator() ( const unix_socket_ptr& ptr) const {
-         return !ptr->is_open();
+         return usable(*ptr);
       }
 #endif
    };
 
-   bool check_closed( const connection_map::iterator& conn_itr ) {
-      if (conn_itr->second.visit(check_closed_visitor())) {
-         _connections.erase(conn_itr);
-         return true;
-      } else {
-         return false;
+   pooled_connection_ptr get_connection( const url& dest, const deadline_type& deadline ) {
+      auto key = url_to_host_key(dest);
+      {
+         std::lock_guard<std::mutex> g(_mtx);
+         auto itr = _idle_connections.find(key);
+         if (itr != _idle_connections.end()) {
+            auto& idle = itr->second;
+            const auto now = fc::time_point::now();
+            while (!idle.empty()) {
+               auto conn = std::move(idle.back());
+               idle.pop_back();
+               if (now - conn->idle_since <= _max_idle_time && conn->stream.visit(check_usable_visitor())) {
+                  conn->reused = true;
+                  return conn;
+               }
+            }
+         }
       }
+      return create_connection(dest, deadline);
    }
 
-   connection_map::iterator get_connection( const url& dest, const deadline_type& deadline ) {
-      auto key = url_to_host_key(dest);
-      auto conn_itr = _connections.find(key);
-      if (conn_itr == _connections.end() || check_closed(conn_itr)) {
-         return create_connection(dest, deadline);
-      } else {
-         return conn_itr;
+   void release_connection( const url& dest, pooled_connection_ptr conn ) {
+      conn->idle_since = fc::time_point::now();
+      conn->reused = false;
+      std::lock_guard<std::mutex> g(_mtx);
+      auto& idle = _idle_connections[url_to_host_key(dest)];
+      idle.emplace_back(std::move(conn));
+      while (idle.size() > _max_idle_per_host) {
+         idle.pop_front();
       }
    }
 
    struct write_request_visitor : visitor<error_code> {
-      write_request_visitor(http_client_impl* that, http::request<http::string_body>& req, const deadline_type& deadline)
+      write_request_visitor(http_client_impl* that, boost::asio::io_context& ioc, http::request<http::string_body>& req, const deadline_type& deadline)
       :that(that)
+      ,ioc(ioc)
       ,req(req)
       ,deadline(deadline)
       {}
 
       template<typename S>
       error_code operator() ( S& stream ) const {
-         return that->sync_write_with_timeout(*stream, req, deadline);
+         return that->sync_write_with_timeout(ioc, *stream, req, deadline);
       }
 
       http_client_impl*                 that;
+      boost::asio::io_context&          ioc;
       http::request<http::string_body>& req;
       const deadline_type&              deadline;
    };
 
    struct read_response_visitor : visitor<error_code> {
-      read_response_visitor(http_client_impl* that, boost::beast::flat_buffer& buffer, http::response<http::string_body>& res, const deadline_type& deadline)
+      read_response_visitor(http_client_impl* that, boost::asio::io_context& ioc, boost::beast::flat_buffer& buffer, http::response<http::string_body>& res, const deadline_type& deadline)
       :that(that)
+      ,ioc(ioc)
       ,buffer(buffer)
       ,res(res)
       ,deadline(deadline)
@@ -304,10 +373,11 @@ public:
 
       template<typename S>
       error_code operator() ( S& stream ) const {
-         return that->sync_read_with_timeout(*stream, buffer, res, deadline);
+         return that->sync_read_with_timeout(ioc, *stream, buffer, res, deadline);
       }
 
       http_client_impl*                  that;
+      boost::asio::io_context&           ioc;
       boost::beast::flat_buffer&         buffer;
       http::response<http::string_body>& res;
       const deadline_type&               deadline;
@@ -340,28 +410,37 @@ public:
       req.body() = json::to_string(payload);
       req.prepare_payload();
 
-      auto conn_iter = get_connection(dest, deadline);
-      auto eraser = make_scoped_exit([this, &conn_iter](){
-         _connections.erase(conn_iter);
-      });
+      // Declare a container to hold the response
+      http::response<http::string_body> res;
 
-      // Send the HTTP request to the remote host
-      error_code ec = conn_iter->second.visit(write_request_visitor(this, req, deadline));
-      FC_ASSERT(!ec, "Failed to send request: ${message}", ("message",ec.message()));
+      auto conn = get_connection(dest, deadline);
+      for (;;) {
+         // Send the HTTP request to the remote host
+         error_code ec = conn->stream.visit(write_request_visitor(this, conn->ioc, req, deadline));
 
-      // This buffer is used for reading and must be persisted
-      boost::beast::flat_buffer buffer;
+         // This buffer is used for reading and must be persisted
+         boost::beast::flat_buffer buffer;
 
-      // Declare a container to hold the response
-      http::response<http::string_body> res;
+         // Receive the HTTP response
+         if (!ec) {
+            ec = conn->stream.visit(read_response_visitor(this, conn->ioc, buffer, res, deadline));
+         }
+         if (!ec) {
+            break;
+         }
 
-      // Receive the HTTP response
-      ec = conn_iter->second.visit(read_response_visitor(this, buffer, res, deadline));
-      FC_ASSERT(!ec, "Failed to read response: ${message}", ("message",ec.message()));
+         // the server may close a kept alive connection just as it is reused, the request is repeated once on a new one
+         if (conn->reused && ec != boost::system::errc::timed_out && buffer.size() == 0) {
+            conn = create_connection(dest, deadline);
+            res = {};
+            continue;
+         }
+         FC_THROW("Failed to send request or read response: ${message}", ("message",ec.message()));
+      }
 
       // if the connection can be kept open, keep it open
       if (res.keep_alive()) {
-         eraser.cancel();
+         release_connection(dest, std::move(conn));
       }
 
       auto result = json::from_string(res.body());
@@ -406,10 +485,13 @@ public:
       and creates another fc::url that will be used downstream of the http_client::post_sync()
       call.
    */
-   const fc::url& get_unix_url(const std::string& full_url) {
-      unix_url_split_map::const_iterator found = _unix_url_paths.find(full_url);
-      if(found != _unix_url_paths.end())
-         return found->second;
+   fc::url get_unix_url(const std::string& full_url) {
+      {
+         std::lock_guard<std::mutex> g(_mtx);
+         unix_url_split_map::const_iterator found = _unix_url_paths.find(full_url);
+         if(found != _unix_url_paths.end())
+            return found->second;
+      }
 
       boost::filesystem::path socket_file(full_url);
       if(socket_file.is_relative())
@@ -426,14 +508,18 @@ public:
       if(socket_file.empty())
          FC_THROW_EXCEPTION( parse_error_exception, "couldn't discover socket path");
       url_path = "/" / url_path;
+      std::lock_guard<std::mutex> g(_mtx);
       return _unix_url_paths.emplace(full_url, fc::url("unix", socket_file.string(), ostring(), ostring(), url_path.string(), ostring(), ovariant_object(), fc::optional<uint16_t>())).first->second;
    }
 #endif
 
-   boost::asio::io_context  _ioc;
-   ssl::context             _sslc;
-   connection_map           _connections;
-   unix_url_split_map       _unix_url_paths;
+   ssl::context                         _sslc;
+   std::mutex                           _mtx; ///< guards the members below, requests run unlocked
+   connection_pool                      _idle_connections;
+   std::map<host_key, ssl_session_ptr>  _ssl_sessions;
+   uint32_t                             _max_idle_per_host = 4;
+   fc::microseconds                     _max_idle_time = fc::seconds(60);
+   unix_url_split_map                   _unix_url_paths;
 };
 
 
@@ -460,8 +546,12 @@ void http_client::set_verify_peers(bool enabled) {
    _my->set_verify_peers(enabled);
 }
 
+void http_client::set_connection_pool(uint32_t max_idle_per_host, const microseconds& max_idle_time) {
+   _my->set_connection_pool(max_idle_per_host, max_idle_time);
+}
+
 http_client::~http_client() {
 
 }
 
-}
\ No newline at end of file
+}
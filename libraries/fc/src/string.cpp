@@ -102,6 +102,19 @@ namespace fc  {
     FC_RETHROW_EXCEPTIONS( warn, "${i} => int64_t", ("i",i) )
   }
 
+  int64_t    to_int64( const char* i, size_t len )
+  {
+    try
+    {
+      return boost::lexical_cast<int64_t>(i, len);
+    }
+    catch( const boost::bad_lexical_cast& e )
+    {
+      FC_THROW_EXCEPTION( parse_error_exception, "Couldn't parse int64_t" );
+    }
+    FC_RETHROW_EXCEPTIONS( warn, "${i} => int64_t", ("i",std::string(i, len)) )
+  }
+
   uint64_t   to_uint64( const fc::string& i )
   { try {
     try
@@ -0,0 +1,176 @@
+#include <fc/tracing.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+#include <pthread.h>
+
+namespace fc { namespace tracing {
+
+   namespace detail {
+      std::atomic<bool> enabled_flag{false};
+   }
+
+   namespace {
+      /// written by its thread only; readers copy the slots and then drop whatever was overwritten meanwhile
+      struct thread_ring {
+         uint32_t                tid = 0;
+         std::string             thread_name;
+         std::unique_ptr<span[]> slots;
+         uint64_t                mask = 0;
+         std::atomic<uint64_t>   pos{0};     ///< number of spans ever recorded
+         std::atomic<uint64_t>   floor{0};   ///< spans before this position were cleared
+      };
+
+      struct ring_registry {
+         std::mutex                                mtx;
+         std::vector<std::shared_ptr<thread_ring>> rings;   ///< kept after their thread exits
+         uint64_t                                  capacity = 1 << 15;
+      };
+
+      ring_registry& registry() {
+         static ring_registry r;
+         return r;
+      }
+
+      thread_ring& local_ring() {
+         thread_local thread_ring* ring = nullptr;
+         if( !ring ) {
+            auto& reg = registry();
+            auto r = std::make_shared<thread_ring>();
+            char name[64] = {};
+            pthread_getname_np( pthread_self(), name, sizeof(name) );
+            r->thread_name = name;
+            std::lock_guard<std::mutex> g( reg.mtx );
+            r->slots.reset( new span[reg.capacity] );
+            r->mask = reg.capacity - 1;
+            r->tid = reg.rings.size() + 1;
+            reg.rings.push_back( r );
+            ring = r.get();
+         }
+         return *ring;
+      }
+
+      void append_escaped( std::string& out, const std::string& s ) {
+         for( char c : s ) {
+            if( c == '"' || c == '\\' ) {
+               out += '\\';
+               out += c;
+            } else if( static_cast<unsigned char>(c) >= 0x20 ) {
+               out += c;
+            }
+         }
+      }
+
+      void append_us( std::string& out, uint64_t ns ) {
+         char buf[32];
+         snprintf( buf, sizeof(buf), "%llu.%03u", static_cast<unsigned long long>( ns / 1000 ), static_cast<unsigned>( ns % 1000 ) );
+         out += buf;
+      }
+   }
+
+   void set_enabled( bool on ) {
+      detail::enabled_flag.store( on, std::memory_order_relaxed );
+   }
+
+   void set_ring_capacity( uint32_t spans ) {
+      uint64_t capacity = 1;
+      while( capacity < spans )
+         capacity <<= 1;
+      auto& reg = registry();
+      std::lock_guard<std::mutex> g( reg.mtx );
+      reg.capacity = capacity;
+   }
+
+   uint64_t now_ns() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+   }
+
+   void record( const char* name, uint64_t start_ns, uint64_t end_ns, uint64_t arg ) {
+      auto& ring = local_ring();
+      const uint64_t p = ring.pos.load( std::memory_order_relaxed );
+      span& s = ring.slots[p & ring.mask];
+      s.name = name;
+      s.start_ns = start_ns;
+      s.end_ns = end_ns;
+      s.arg = arg;
+      s.tid = ring.tid;
+      ring.pos.store( p + 1, std::memory_order_release );
+   }
+
+   std::vector<span> collect( uint64_t from_ns, uint64_t to_ns ) {
+      std::vector<std::shared_ptr<thread_ring>> rings;
+      {
+         auto& reg = registry();
+         std::lock_guard<std::mutex> g( reg.mtx );
+         rings = reg.rings;
+      }
+      std::vector<span> result;
+      for( const auto& ring : rings ) {
+         const uint64_t capacity = ring->mask + 1;
+         const uint64_t end = ring->pos.load( std::memory_order_acquire );
+         const uint64_t begin = std::max( end > capacity ? end - capacity : 0, ring->floor.load( std::memory_order_relaxed ) );
+         std::vector<span> copied;
+         copied.reserve( end - begin );
+         for( uint64_t p = begin; p < end; ++p )
+            copied.push_back( ring->slots[p & ring->mask] );
+         // the thread kept recording while the slots were copied, drop the ones it overwrote
+         const uint64_t now_end = ring->pos.load( std::memory_order_acquire );
+         const uint64_t first_valid = now_end > capacity ? now_end - capacity : 0;
+         for( uint64_t p = std::max( begin, first_valid ); p < end; ++p ) {
+            const auto& s = copied[p - begin];
+            if( s.start_ns >= from_ns && s.start_ns <= to_ns )
+               result.push_back( s );
+         }
+      }
+      std::sort( result.begin(), result.end(), []( const span& a, const span& b ) { return a.start_ns < b.start_ns; } );
+      return result;
+   }
+
+   void clear() {
+      auto& reg = registry();
+      std::lock_guard<std::mutex> g( reg.mtx );
+      for( const auto& ring : reg.rings )
+         ring->floor.store( ring->pos.load( std::memory_order_acquire ), std::memory_order_relaxed );
+   }
+
+   std::string to_chrome_json( const std::vector<span>& spans, const char* arg_name ) {
+      std::string out;
+      out.reserve( 64 + spans.size() * 128 );
+      out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+      bool first = true;
+      {
+         auto& reg = registry();
+         std::lock_guard<std::mutex> g( reg.mtx );
+         for( const auto& ring : reg.rings ) {
+            if( !first ) out += ',';
+            first = false;
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string( ring->tid ) + ",\"args\":{\"name\":\"";
+            append_escaped( out, ring->thread_name.empty() ? "thread-" + std::to_string( ring->tid ) : ring->thread_name );
+            out += "\"}}";
+         }
+      }
+      for( const auto& s : spans ) {
+         if( !first ) out += ',';
+         first = false;
+         out += "{\"name\":\"";
+         append_escaped( out, s.name );
+         out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string( s.tid ) + ",\"ts\":";
+         append_us( out, s.start_ns );
+         out += ",\"dur\":";
+         append_us( out, s.end_ns > s.start_ns ? s.end_ns - s.start_ns : 0 );
+         if( s.arg ) {
+            out += ",\"args\":{\"";
+            out += arg_name;
+            out += "\":" + std::to_string( s.arg ) + "}";
+         }
+         out += '}';
+      }
+      out += "]}";
+      return out;
+   }
+
+} } // namespace fc::tracing
@@ -94,8 +94,17 @@ namespace fc
       return _key_value->size();
    }
 
+   namespace {
+      /// a variant_object is immutable, so all empty ones share the same vector
+      const std::shared_ptr<std::vector<variant_object::entry>>& empty_key_value()
+      {
+         static const auto empty = std::make_shared<std::vector<variant_object::entry>>();
+         return empty;
+      }
+   }
+
    variant_object::variant_object()
-      :_key_value(std::make_shared<std::vector<entry>>() )
+      :_key_value( empty_key_value() )
    {
    }
 
@@ -115,7 +124,7 @@ namespace fc
    variant_object::variant_object( variant_object&& obj)
    : _key_value( fc::move(obj._key_value) )
    {
-      obj._key_value = std::make_shared<std::vector<entry>>();
+      obj._key_value = empty_key_value();
       FC_ASSERT( _key_value != nullptr );
    }
 
@@ -158,7 +167,8 @@ namespace fc
 
    variant_object& variant_object::operator=( const mutable_variant_object& obj )
    {
-      *_key_value = *obj._key_value;
+      // the vector may be shared with other copies of this object
+      _key_value = std::make_shared<std::vector<entry>>( *obj._key_value );
       return *this;
    }
 
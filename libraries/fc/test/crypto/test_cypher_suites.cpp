@@ -4,6 +4,9 @@
 #include <fc/crypto/public_key.hpp>
 #include <fc/crypto/private_key.hpp>
 #include <fc/crypto/signature.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/crypto/base58.hpp>
+#include <fc/crypto/hex.hpp>
 #include <fc/utility.hpp>
 
 using namespace fc::crypto;
@@ -56,6 +59,41 @@ BOOST_AUTO_TEST_CASE(test_r1_recovery) try {
    BOOST_CHECK_EQUAL(std::string(recovered_pub), std::string(pub));
 } FC_LOG_AND_RETHROW();
 
+BOOST_AUTO_TEST_CASE(test_r1_recovery_digests) try {
+   auto key = private_key::generate<r1::private_key_shim>();
+   auto pub = key.get_public_key();
+   for( int i = 0; i < 64; ++i ) {
+      auto digest = sha256::hash( i );
+      auto sig = key.sign( digest );
+      BOOST_CHECK_EQUAL( std::string(public_key( sig, digest )), std::string(pub) );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_recover_many) try {
+   std::vector<signature> sigs;
+   std::vector<sha256> digests;
+   std::vector<public_key> pubs;
+   for( int i = 0; i < 12; ++i ) {
+      auto digest = sha256::hash( i );
+      // mostly k1 with a few r1 in between, which are recovered one at a time
+      auto key = i % 5 == 3 ? private_key::generate<r1::private_key_shim>() : private_key::generate<ecc::private_key_shim>();
+      sigs.push_back( key.sign( digest ) );
+      digests.push_back( digest );
+      pubs.push_back( key.get_public_key() );
+   }
+
+   std::vector<public_key> recovered( sigs.size() );
+   public_key::recover_many( sigs.data(), digests.data(), sigs.size(), recovered.data() );
+   for( size_t i = 0; i < sigs.size(); ++i )
+      BOOST_CHECK_EQUAL( std::string(recovered[i]), std::string(pubs[i]) );
+
+   // a signature over another digest recovers another key, as it does on its own
+   std::swap( digests[0], digests[1] );
+   public_key::recover_many( sigs.data(), digests.data(), 2, recovered.data() );
+   BOOST_CHECK_EQUAL( std::string(recovered[0]), std::string(public_key( sigs[0], digests[0] )) );
+   BOOST_CHECK( recovered[0] != pubs[0] );
+} FC_LOG_AND_RETHROW();
+
 BOOST_AUTO_TEST_CASE(test_k1_recyle) try {
    auto key = private_key::generate<ecc::private_key_shim>();
    auto pub = key.get_public_key();
@@ -78,5 +116,58 @@ BOOST_AUTO_TEST_CASE(test_r1_recyle) try {
    BOOST_CHECK_EQUAL(std::string(pub), std::string(recycled_pub));
 } FC_LOG_AND_RETHROW();
 
+BOOST_AUTO_TEST_CASE(test_sha256_hash_many) try {
+   // every message length around the padding boundaries, in batches which do not fill all lanes as well
+   for( size_t count : { 1, 3, 4, 7, 8, 9, 17, 64 } ) {
+      std::vector<std::string> messages;
+      for( size_t i = 0; i < count; ++i ) {
+         std::string m( (i * 37 + count) % 300, '\0' );
+         for( size_t j = 0; j < m.size(); ++j )
+            m[j] = char( i * 131 + j * 7 );
+         messages.push_back( m );
+      }
+      std::vector<const char*> data;
+      std::vector<uint32_t> sizes;
+      for( const auto& m : messages ) {
+         data.push_back( m.data() );
+         sizes.push_back( m.size() );
+      }
+      std::vector<sha256> out( count );
+      sha256::hash_many( data.data(), sizes.data(), count, out.data() );
+      for( size_t i = 0; i < count; ++i )
+         BOOST_CHECK_EQUAL( out[i].str(), sha256::hash( messages[i].data(), messages[i].size() ).str() );
+   }
+} FC_LOG_AND_RETHROW();
+
+BOOST_AUTO_TEST_CASE(test_base58) try {
+   const std::vector<std::pair<std::string, std::string>> vectors = {
+      { "", "" },
+      { "61", "2g" },
+      { "626262", "a3gV" },
+      { "516b6fcd0f", "ABnLTmg" },
+      { "bf4f89001e670274dd", "3SEo3LWLoPntC" },
+      { "ecac89cad93923c02321", "EJDM8drfXA6uyA" },
+      { "00000000000000000000", "1111111111" },
+      { "00eb15231dfceb60925886b67d065299925915aeb172c06647", "1NS17iag9jJgTHD1VXjvLCEnZuQ3rJDE9L" },
+   };
+   for( const auto& v : vectors ) {
+      std::vector<char> bin( v.first.size() / 2 );
+      if( bin.size() )
+         fc::from_hex( v.first, bin.data(), bin.size() );
+      BOOST_CHECK_EQUAL( fc::to_base58( bin ), v.second );
+      BOOST_CHECK( fc::from_base58( v.second ) == bin );
+   }
+   BOOST_CHECK( fc::from_base58( " \t2g  " ) == std::vector<char>{ 'a' } );
+   BOOST_CHECK_THROW( fc::from_base58( "2g0" ), fc::parse_error_exception );
+   BOOST_CHECK_THROW( fc::from_base58( "2 g" ), fc::parse_error_exception );
+
+   // printed twice, the second time from the cache of key strings
+   const auto k1 = std::string( "ROXE7MVh6bachyhuHm1rTN5n3mwSpQh1VFELNUcGKVdG3GxXYELUDt" );
+   const auto r1 = std::string( "PUB_R1_6EPHFSKVYHBjQgxVGQPrwCxTg7BbZ69H9i4gztN9deKTEXYne4" );
+   for( int i = 0; i < 2; ++i ) {
+      BOOST_CHECK_EQUAL( std::string( public_key( k1 ) ), k1 );
+      BOOST_CHECK_EQUAL( std::string( public_key( r1 ) ), r1 );
+   }
+} FC_LOG_AND_RETHROW();
 
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -95,12 +95,14 @@ namespace roxe { namespace testing {
          virtual ~base_tester() {};
 
          void              init(const setup_policy policy = setup_policy::full, db_read_mode read_mode = db_read_mode::SPECULATIVE);
-         void              init(controller::config config, const snapshot_reader_ptr& snapshot = nullptr);
+         void              init(controller::config config, const snapshot_reader_ptr& snapshot = nullptr,
+                                const vector<snapshot_reader_ptr>& differential_snapshots = vector<snapshot_reader_ptr>());
          void              init(controller::config config, protocol_feature_set&& pfs, const snapshot_reader_ptr& snapshot = nullptr);
          void              execute_setup_policy(const setup_policy policy);
 
          void              close();
-         void              open( protocol_feature_set&& pfs, const snapshot_reader_ptr& snapshot);
+         void              open( protocol_feature_set&& pfs, const snapshot_reader_ptr& snapshot,
+                                 const vector<snapshot_reader_ptr>& differential_snapshots = vector<snapshot_reader_ptr>());
          void              open( const snapshot_reader_ptr& snapshot);
          bool              is_same_chain( base_tester& other );
 
@@ -375,8 +377,6 @@ namespace roxe { namespace testing {
          vcfg.state_dir  = tempdir.path() /  std::string("v_").append(config::default_state_dir_name);
          vcfg.state_size = 1024*1024*16;
          vcfg.state_guard_size = 0;
-         vcfg.reversible_cache_size = 1024*1024*8;
-         vcfg.reversible_guard_size = 0;
          vcfg.contracts_console = false;
 
          vcfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
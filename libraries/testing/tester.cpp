@@ -127,8 +127,6 @@ namespace roxe { namespace testing {
       cfg.state_dir  = tempdir.path() / config::default_state_dir_name;
       cfg.state_size = 1024*1024*16;
       cfg.state_guard_size = 0;
-      cfg.reversible_cache_size = 1024*1024*8;
-      cfg.reversible_guard_size = 0;
       cfg.contracts_console = true;
       cfg.read_mode = read_mode;
 
@@ -146,9 +144,10 @@ namespace roxe { namespace testing {
       execute_setup_policy(policy);
    }
 
-   void base_tester::init(controller::config config, const snapshot_reader_ptr& snapshot) {
+   void base_tester::init(controller::config config, const snapshot_reader_ptr& snapshot,
+                          const vector<snapshot_reader_ptr>& differential_snapshots) {
       cfg = config;
-      open(snapshot);
+      open(make_protocol_feature_set(), snapshot, differential_snapshots);
    }
 
    void base_tester::init(controller::config config, protocol_feature_set&& pfs, const snapshot_reader_ptr& snapshot) {
@@ -204,17 +203,18 @@ namespace roxe { namespace testing {
       open( make_protocol_feature_set(), snapshot );
    }
 
-   void base_tester::open( protocol_feature_set&& pfs, const snapshot_reader_ptr& snapshot ) {
+   void base_tester::open( protocol_feature_set&& pfs, const snapshot_reader_ptr& snapshot,
+                           const vector<snapshot_reader_ptr>& differential_snapshots ) {
       control.reset( new controller(cfg, std::move(pfs)) );
       control->add_indices();
-      control->startup( []() { return false; }, snapshot);
+      control->startup( []() { return false; }, snapshot, differential_snapshots);
       chain_transactions.clear();
       control->accepted_block.connect([this]( const block_state_ptr& block_state ){
         FC_ASSERT( block_state->block );
           for( const auto& receipt : block_state->block->transactions ) {
               if( receipt.trx.contains<packed_transaction>() ) {
                   auto &pt = receipt.trx.get<packed_transaction>();
-                  chain_transactions[pt.get_transaction().id()] = receipt;
+                  chain_transactions[pt.id()] = receipt;
               } else {
                   auto& id = receipt.trx.get<transaction_id_type>();
                   chain_transactions[id] = receipt;
@@ -369,7 +369,7 @@ namespace roxe { namespace testing {
    void base_tester::produce_min_num_of_blocks_to_spend_time_wo_inactive_prod(const fc::microseconds target_elapsed_time) {
       fc::microseconds elapsed_time;
       while (elapsed_time < target_elapsed_time) {
-         for(uint32_t i = 0; i < control->head_block_state()->active_schedule.producers.size(); i++) {
+         for(uint32_t i = 0; i < control->head_block_state()->active_schedule->producers.size(); i++) {
             const auto time_to_skip = fc::milliseconds(config::producer_repetitions * config::block_interval_ms);
             produce_block(time_to_skip);
             elapsed_time += time_to_skip;
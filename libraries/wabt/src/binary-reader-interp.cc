@@ -1276,6 +1276,13 @@ wabt::Result BinaryReaderInterp::OnBrIfExpr(Index depth) {
   Index drop_count, keep_count;
   CHECK_RESULT(typechecker_.OnBrIf(depth));
   CHECK_RESULT(GetBrDropKeepCount(depth, &drop_count, &keep_count));
+  if (drop_count == 0) {
+    /* nothing to drop, so a single conditional branch is enough; this saves a
+     * dispatch on every br_if, taken or not */
+    CHECK_RESULT(EmitOpcode(Opcode::BrIf));
+    CHECK_RESULT(EmitBrOffset(depth, GetLabel(depth)->offset));
+    return wabt::Result::Ok;
+  }
   /* flip the br_if so if <cond> is true it can drop values from the stack */
   CHECK_RESULT(EmitOpcode(Opcode::InterpBrUnless));
   IstreamOffset fixup_br_offset = GetIstreamOffset();
@@ -90,6 +90,11 @@ namespace Platform
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void decommitVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// Releases the physical memory of committed pages, which read back as zero, while leaving them committed and
+	// their access unchanged.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API void zeroVirtualPages(U8* baseVirtualAddress,Uptr numPages);
+
 	// Frees virtual addresses. Any physical memory committed to the addresses must have already been decommitted.
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
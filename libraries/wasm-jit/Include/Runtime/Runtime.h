@@ -127,6 +127,11 @@ namespace Runtime
 	// Returns the type of a FunctionInstance.
 	RUNTIME_API const IR::FunctionType* getFunctionType(FunctionInstance* function);
 
+	// Finds the JITed function definition containing an instruction pointer: its index among the module's
+	// function definitions and its name from the name section, empty if it has none. Returns false if the
+	// instruction pointer isn't in JITed WebAssembly code.
+	RUNTIME_API bool getFunctionDefAt(Uptr ip,Uptr& outFunctionDefIndex,std::string& outName);
+
 	//
 	// Tables
 	//
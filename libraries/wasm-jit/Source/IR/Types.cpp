@@ -1,6 +1,7 @@
 #include "Types.h"
 
 #include <map>
+#include <mutex>
 
 namespace IR
 {
@@ -20,11 +21,18 @@ namespace IR
 			static std::map<Key,FunctionType*> map;
 			return map;
 		}
+		// Modules may be deserialized off the main thread, so the interned types must be guarded.
+		static std::mutex& mutex()
+		{
+			static std::mutex m;
+			return m;
+		}
 	};
 
 	template<typename Key,typename Value,typename CreateValueThunk>
 	Value findExistingOrCreateNew(std::map<Key,Value>& map,Key&& key,CreateValueThunk createValueThunk)
 	{
+		std::lock_guard<std::mutex> lock(FunctionTypeMap::mutex());
 		auto mapIt = map.find(key);
 		if(mapIt != map.end()) { return mapIt->second; }
 		else
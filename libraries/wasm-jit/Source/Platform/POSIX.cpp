@@ -101,6 +101,14 @@ namespace Platform
 		if(mprotect(baseVirtualAddress,numBytes,PROT_NONE)) { Errors::fatal("mprotect failed"); }
 	}
 
+	void zeroVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		// Private anonymous pages dropped by MADV_DONTNEED are zero filled on the next access. Unlike
+		// decommitVirtualPages the mapping is not mprotect'ed, so it is neither split nor merged again.
+		if(madvise(baseVirtualAddress,numPages << getPageSizeLog2(),MADV_DONTNEED)) { Errors::fatal("madvise failed"); }
+	}
+
 	void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
@@ -78,6 +78,14 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
 	}
 
+	void zeroVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		// Windows has no way to drop the contents of pages that stay committed, decommitted pages come back zeroed.
+		// Only the memory of linear memories is zeroed, which is read/write.
+		decommitVirtualPages(baseVirtualAddress,numPages);
+		if(!commitVirtualPages(baseVirtualAddress,numPages,MemoryAccess::ReadWrite)) { Errors::fatal("VirtualAlloc(MEM_COMMIT) failed"); }
+	}
+
 	void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
@@ -657,6 +657,16 @@ namespace LLVMJIT
 		return true;
 	}
 
+	FunctionInstance* getFunctionInstanceAt(Uptr ip)
+	{
+		Platform::Lock addressToSymbolMapLock(addressToSymbolMapMutex);
+		auto symbolIt = addressToSymbolMap.upper_bound(ip);
+		if(symbolIt == addressToSymbolMap.end()) { return nullptr; }
+		JITSymbol* symbol = symbolIt->second;
+		if(ip < symbol->baseAddress || ip >= symbol->baseAddress + symbol->numBytes) { return nullptr; }
+		return symbol->type == JITSymbol::Type::functionInstance ? symbol->functionInstance : nullptr;
+	}
+
 	InvokeFunctionPointer getInvokeThunk(const FunctionType* functionType)
 	{
 		// Reuse cached invoke thunks for the same function type.
@@ -89,14 +89,28 @@ namespace Runtime
 	}
 
 	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
-		memory->type.size.min = 1;
-		if(shrinkMemory(memory, memory->numPages - 1) == -1)
-			causeException(Exception::Cause::outOfMemory);
-		memset(memory->baseAddress, 0, 1<<IR::numBytesPerPageLog2);
+		// The pages the new memory keeps stay committed and are only zeroed, releasing just the pages that were
+		// actually touched, so the cost of a reset scales with the pages the previous call dirtied rather than with
+		// the size of the memory. Leaving their protection alone spares the mprotect calls, which split and merge
+		// the mapping and flush the TLBs of every thread, on each action. Only the pages beyond the new size are
+		// decommitted, or the missing ones committed.
+		const Uptr numKeptPages = std::min(Uptr(memory->numPages),Uptr(newMemoryType.size.min));
+		if(numKeptPages > 0)
+		{
+			Platform::zeroVirtualPages(memory->baseAddress,numKeptPages << getPlatformPagesPerWebAssemblyPageLog2());
+		}
+		if(memory->numPages > numKeptPages)
+		{
+			Platform::decommitVirtualPages(
+				memory->baseAddress + (numKeptPages << IR::numBytesPerPageLog2),
+				(memory->numPages - numKeptPages) << getPlatformPagesPerWebAssemblyPageLog2()
+				);
+		}
+		memory->numPages = numKeptPages;
 		memory->type = newMemoryType;
-		if(growMemory(memory, memory->type.size.min - 1) == -1)
+		if(growMemory(memory, memory->type.size.min - numKeptPages) == -1)
 			causeException(Exception::Cause::outOfMemory);
-   }
+	}
 
 	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
 	{
@@ -114,7 +128,8 @@ namespace Runtime
 			{
 				return -1;
 			}
-			memset(memory->baseAddress + (memory->numPages << IR::numBytesPerPageLog2), 0, numNewPages << IR::numBytesPerPageLog2);
+			// Pages past the end of the memory are never committed (shrinkMemory and resetMemory decommit them), so they are
+			// already zero here; clearing them again would only fault in every page.
 			memory->numPages += numNewPages;
 		}
 		return previousNumPages;
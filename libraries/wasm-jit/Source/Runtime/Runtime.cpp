@@ -4,6 +4,7 @@
 #include "Runtime.h"
 #include "RuntimePrivate.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace Runtime
@@ -136,6 +137,19 @@ namespace Runtime
 		return function->type;
 	}
 
+	bool getFunctionDefAt(Uptr ip,Uptr& outFunctionDefIndex,std::string& outName)
+	{
+		FunctionInstance* function = LLVMJIT::getFunctionInstanceAt(ip);
+		if(!function || !function->moduleInstance) { return false; }
+		const auto& defs = function->moduleInstance->functionDefs;
+		auto defIt = std::find(defs.begin(),defs.end(),function);
+		if(defIt == defs.end()) { return false; }
+		outFunctionDefIndex = Uptr(defIt - defs.begin());
+		// functions the name section doesn't name were given a "<function #N>" debug name
+		outName = function->debugName.size() && function->debugName[0] != '<' ? function->debugName : std::string();
+		return true;
+	}
+
 	GlobalInstance* createGlobal(GlobalType type,Value initialValue)
 	{
 		return new GlobalInstance(type,initialValue);
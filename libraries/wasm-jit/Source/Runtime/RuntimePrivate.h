@@ -22,6 +22,7 @@ namespace LLVMJIT
 	void init();
 	void instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance);
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription);
+	FunctionInstance* getFunctionInstanceAt(Uptr ip);
 	
 	typedef void (*InvokeFunctionPointer)(void*,U64*);
 
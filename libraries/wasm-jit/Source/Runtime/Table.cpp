@@ -9,6 +9,18 @@ namespace Runtime
 	// Global lists of tables; used to query whether an address is reserved by one of them.
 	std::vector<TableInstance*> tables;
 
+	// The address space reserved by destroyed tables, all of the same size and with no pages committed. Creating a
+	// table takes one from here so that instantiating and evicting modules does not map and unmap address space,
+	// each munmap flushing the TLBs of every thread.
+	struct TableReservation
+	{
+		TableInstance::FunctionElement* baseAddress;
+		U8* reservedBaseAddress;
+		Uptr reservedNumPlatformPages;
+	};
+	static std::vector<TableReservation> pooledTableReservations;
+	enum { maxPooledTableReservations = 256 };
+
 	static Uptr getNumPlatformPages(Uptr numBytes)
 	{
 		return (numBytes + (Uptr(1)<<Platform::getPageSizeLog2()) - 1) >> Platform::getPageSizeLog2();
@@ -20,8 +32,19 @@ namespace Runtime
 
 		const Uptr tableMaxBytes = sizeof(TableInstance::FunctionElement)*roxe::chain::wasm_constraints::maximum_table_elements;
 		
-		const Uptr alignmentBytes = 1U << Platform::getPageSizeLog2();
-		table->baseAddress = (TableInstance::FunctionElement*)allocateVirtualPagesAligned(tableMaxBytes,alignmentBytes,table->reservedBaseAddress,table->reservedNumPlatformPages);
+		if(!pooledTableReservations.empty())
+		{
+			const TableReservation& reservation = pooledTableReservations.back();
+			table->baseAddress = reservation.baseAddress;
+			table->reservedBaseAddress = reservation.reservedBaseAddress;
+			table->reservedNumPlatformPages = reservation.reservedNumPlatformPages;
+			pooledTableReservations.pop_back();
+		}
+		else
+		{
+			const Uptr alignmentBytes = 1U << Platform::getPageSizeLog2();
+			table->baseAddress = (TableInstance::FunctionElement*)allocateVirtualPagesAligned(tableMaxBytes,alignmentBytes,table->reservedBaseAddress,table->reservedNumPlatformPages);
+		}
 		table->endOffset = tableMaxBytes;
 		if(!table->baseAddress) { delete table; return nullptr; }
 		
@@ -39,8 +62,15 @@ namespace Runtime
 		// Decommit all pages.
 		if(elements.size() > 0) { Platform::decommitVirtualPages((U8*)baseAddress,getNumPlatformPages(elements.size() * sizeof(TableInstance::FunctionElement))); }
 
-		// Free the virtual address space.
-		if(reservedNumPlatformPages > 0) { Platform::freeVirtualPages((U8*)reservedBaseAddress,reservedNumPlatformPages); }
+		// Keep the virtual address space for the next table, or free it.
+		if(reservedNumPlatformPages > 0)
+		{
+			if(pooledTableReservations.size() < maxPooledTableReservations)
+			{
+				pooledTableReservations.push_back({baseAddress,reservedBaseAddress,reservedNumPlatformPages});
+			}
+			else { Platform::freeVirtualPages((U8*)reservedBaseAddress,reservedNumPlatformPages); }
+		}
 		reservedBaseAddress = nullptr;
 		reservedNumPlatformPages = 0;
 		baseAddress = nullptr;
@@ -6,12 +6,90 @@
 #include <roxe/chain/exceptions.hpp>
 
 #include <fc/io/json.hpp>
+#include <fc/io/json_writer.hpp>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace roxe {
 
 static appbase::abstract_plugin& _chain_api_plugin = app().register_plugin<chain_api_plugin>();
 
 using namespace roxe;
+namespace bpo = boost::program_options;
+using boost::signals2::scoped_connection;
+
+/**
+ * Rendered responses of frequently repeated calls, keyed by the call and its normalized parameters.
+ *
+ * Responses computed from the state at the current head are dropped on every accepted or irreversible block.
+ * Responses which can not change any more, those about irreversible blocks, are kept in an LRU bounded by
+ * their total size. Head responses are only added while they fit in that same bound.
+ */
+class response_cache {
+public:
+   explicit response_cache( size_t max_bytes )
+      : max_bytes(max_bytes) {}
+
+   optional<string> get( const string& key ) {
+      std::lock_guard<std::mutex> g( mtx );
+      auto h = head.find( key );
+      if( h != head.end() ) return h->second;
+      auto p = permanent.find( key );
+      if( p == permanent.end() ) return {};
+      lru.splice( lru.begin(), lru, p->second );
+      return p->second->second;
+   }
+
+   /// changes whenever the head responses are dropped
+   uint64_t generation()const {
+      std::lock_guard<std::mutex> g( mtx );
+      return gen;
+   }
+
+   /**
+    * @param is_permanent the response will never change
+    * @param computed_at the generation() before the response was computed, a head response computed
+    *                    across a change of the head is not added
+    */
+   void put( const string& key, const string& json, bool is_permanent, uint64_t computed_at ) {
+      const size_t size = key.size() + json.size();
+      std::lock_guard<std::mutex> g( mtx );
+      if( size > max_bytes ) return;
+      if( !is_permanent ) {
+         if( computed_at != gen || head_bytes + permanent_bytes + size > max_bytes ) return;
+         if( head.emplace( key, json ).second ) head_bytes += size;
+         return;
+      }
+      if( permanent.count( key ) ) return;
+      lru.emplace_front( key, json );
+      permanent.emplace( key, lru.begin() );
+      permanent_bytes += size;
+      while( head_bytes + permanent_bytes > max_bytes && !lru.empty() ) {
+         permanent_bytes -= lru.back().first.size() + lru.back().second.size();
+         permanent.erase( lru.back().first );
+         lru.pop_back();
+      }
+   }
+
+   void head_changed() {
+      std::lock_guard<std::mutex> g( mtx );
+      head.clear();
+      head_bytes = 0;
+      ++gen;
+   }
+
+private:
+   mutable std::mutex                                            mtx;
+   const size_t                                                  max_bytes;
+   uint64_t                                                      gen = 0;
+   std::unordered_map<string, string>                            head;
+   size_t                                                        head_bytes = 0;
+   std::list<std::pair<string, string>>                          lru;
+   std::unordered_map<string, std::list<std::pair<string, string>>::iterator> permanent;
+   size_t                                                        permanent_bytes = 0;
+};
 
 class chain_api_plugin_impl {
 public:
@@ -19,14 +97,40 @@ public:
       : db(db) {}
 
    controller& db;
+   std::shared_ptr<response_cache>           cache;
+   fc::optional<scoped_connection>           accepted_block_connection;
+   fc::optional<scoped_connection>           irreversible_block_connection;
 };
 
 
 chain_api_plugin::chain_api_plugin(){}
 chain_api_plugin::~chain_api_plugin(){}
 
-void chain_api_plugin::set_program_options(options_description&, options_description&) {}
-void chain_api_plugin::plugin_initialize(const variables_map&) {}
+void chain_api_plugin::set_program_options(options_description&, options_description& cfg) {
+   cfg.add_options()
+         ("chain-api-response-cache-mb", bpo::value<uint32_t>()->default_value(0),
+          "Maximum size in megabytes of the rendered get_info, get_block, get_account and get_currency_balance responses to cache, 0 disables the cache. "
+          "Responses about irreversible blocks are kept until evicted, the others until the next block.")
+         ;
+}
+
+void chain_api_plugin::plugin_initialize(const variables_map& options) {
+   try {
+      my.reset(new chain_api_plugin_impl(app().get_plugin<chain_plugin>().chain()));
+      const uint64_t cache_mb = options.at( "chain-api-response-cache-mb" ).as<uint32_t>();
+      if( cache_mb > 0 && my->db.is_state_replica() ) {
+         wlog( "chain-api-response-cache-mb is ignored in a state replica, which sees no blocks to drop responses on" );
+      } else if( cache_mb > 0 ) {
+         my->cache = std::make_shared<response_cache>( cache_mb * 1024 * 1024 );
+         my->accepted_block_connection.emplace( my->db.accepted_block.connect( [cache = my->cache]( const chain::block_state_ptr& ) {
+            cache->head_changed();
+         } ) );
+         my->irreversible_block_connection.emplace( my->db.irreversible_block.connect( [cache = my->cache]( const chain::block_state_ptr& ) {
+            cache->head_changed();
+         } ) );
+      }
+   } FC_LOG_AND_RETHROW()
+}
 
 struct async_result_visitor : public fc::visitor<fc::variant> {
    template<typename T>
@@ -41,7 +145,8 @@ struct async_result_visitor : public fc::visitor<fc::variant> {
           api_handle.validate(); \
           try { \
              if (body.empty()) body = "{}"; \
-             fc::variant result( api_handle.call_name(fc::json::from_string(body).as<api_namespace::call_name ## _params>()) ); \
+             const auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+             fc::variant result( api_handle.read_state( [&]() { return api_handle.call_name(params); } ) ); \
              cb(http_response_code, std::move(result)); \
           } catch (...) { \
              http_plugin::handle_exception(#api_name, #call_name, body, cb); \
@@ -68,34 +173,112 @@ struct async_result_visitor : public fc::visitor<fc::variant> {
    }\
 }
 
+// for calls whose results are written as JSON text by api_handle.call_name ## _json
+#define JSON_CALL(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle](string, string body, url_response_json_callback cb) mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             const auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+             cb(http_response_code, api_handle.read_state( [&]() { return api_handle.call_name ## _json(params); } )); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, \
+                [cb](int code, fc::variant result) { cb(code, fc::json::to_string(result)); }); \
+          } \
+       }}
+
+// looks up the rendered response in cache first, is_permanent( result ) tells whether it can never change
+#define CACHED_CALL(api_name, api_handle, api_namespace, call_name, http_response_code, is_permanent) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle, cache, is_permanent](string, string body, url_response_json_callback cb) mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             const auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+             const string key = "/v1/" #api_name "/" #call_name + fc::json::to_string(params); \
+             if( auto json = cache->get(key) ) { \
+                cb(http_response_code, std::move(*json)); \
+                return; \
+             } \
+             const auto generation = cache->generation(); \
+             fc::variant result( api_handle.read_state( [&]() { return api_handle.call_name(params); } ) ); \
+             string json = fc::json::to_string(result); \
+             cache->put(key, json, is_permanent(result), generation); \
+             cb(http_response_code, std::move(json)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, \
+                [cb](int code, fc::variant result) { cb(code, fc::json::to_string(result)); }); \
+          } \
+       }}
+
+/// one kind of call in /v1/chain/batch, renders the result for the parameters of the call
+using batch_call = std::function<string(const fc::variant&)>;
+static const size_t max_batch_calls = 1000;
+
+#define BATCH_CALL(api_handle, api_namespace, call_name) \
+{std::string(#call_name), \
+   [api_handle](const fc::variant& params) mutable { \
+      const auto p = params.as<api_namespace::call_name ## _params>(); \
+      return fc::json::to_string( fc::variant( api_handle.read_state( [&]() { return api_handle.call_name( p ); } ) ) ); \
+   }}
+
+#define BATCH_JSON_CALL(api_handle, api_namespace, call_name) \
+{std::string(#call_name), \
+   [api_handle](const fc::variant& params) mutable { \
+      const auto p = params.as<api_namespace::call_name ## _params>(); \
+      return api_handle.read_state( [&]() { return api_handle.call_name ## _json( p ); } ); \
+   }}
+
 #define CHAIN_RO_CALL(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 #define CHAIN_RW_CALL(call_name, http_response_code) CALL(chain, rw_api, chain_apis::read_write, call_name, http_response_code)
+#define CHAIN_RO_JSON_CALL(call_name, http_response_code) JSON_CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CACHED_CALL(call_name, http_response_code, is_permanent) CACHED_CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code, is_permanent)
+#define CHAIN_RO_BATCH_CALL(call_name) BATCH_CALL(ro_api, chain_apis::read_only, call_name)
+#define CHAIN_RO_BATCH_JSON_CALL(call_name) BATCH_JSON_CALL(ro_api, chain_apis::read_only, call_name)
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
 
 void chain_api_plugin::plugin_startup() {
    ilog( "starting chain_api_plugin" );
-   my.reset(new chain_api_plugin_impl(app().get_plugin<chain_plugin>().chain()));
    auto ro_api = app().get_plugin<chain_plugin>().get_read_only_api();
    auto rw_api = app().get_plugin<chain_plugin>().get_read_write_api();
 
    auto& _http_plugin = app().get_plugin<http_plugin>();
    ro_api.set_shorten_abi_errors( !_http_plugin.verbose_errors() );
 
+   if( my->cache ) {
+      auto cache = my->cache;
+      auto at_head = []( const fc::variant& ) { return false; };
+      auto irreversible_block = [&db = my->db]( const fc::variant& result ) {
+         return result["block_num"].as_uint64() <= db.last_irreversible_block_num();
+      };
+      _http_plugin.add_json_api({
+         CHAIN_RO_CACHED_CALL(get_info, 200, at_head),
+         CHAIN_RO_CACHED_CALL(get_account, 200, at_head),
+         CHAIN_RO_CACHED_CALL(get_currency_balance, 200, at_head),
+         CHAIN_RO_CACHED_CALL(get_block, 200, irreversible_block)
+      }, true);
+   } else {
+      _http_plugin.add_api({
+         CHAIN_RO_CALL(get_info, 200l),
+         CHAIN_RO_CALL(get_account, 200),
+         CHAIN_RO_CALL(get_currency_balance, 200),
+         CHAIN_RO_CALL(get_block, 200)
+      }, true);
+   }
+
+   // these only query the chain state and the fork database and may run outside of the main thread
    _http_plugin.add_api({
-      CHAIN_RO_CALL(get_info, 200l),
       CHAIN_RO_CALL(get_activated_protocol_features, 200),
-      CHAIN_RO_CALL(get_block, 200),
       CHAIN_RO_CALL(get_block_header_state, 200),
-      CHAIN_RO_CALL(get_account, 200),
+      CHAIN_RO_CALL(get_raw_block, 200),
       CHAIN_RO_CALL(get_code, 200),
       CHAIN_RO_CALL(get_code_hash, 200),
       CHAIN_RO_CALL(get_abi, 200),
       CHAIN_RO_CALL(get_raw_code_and_abi, 200),
       CHAIN_RO_CALL(get_raw_abi, 200),
-      CHAIN_RO_CALL(get_table_rows, 200),
       CHAIN_RO_CALL(get_table_by_scope, 200),
-      CHAIN_RO_CALL(get_currency_balance, 200),
       CHAIN_RO_CALL(get_currency_stats, 200),
       CHAIN_RO_CALL(get_producers, 200),
       CHAIN_RO_CALL(get_producer_schedule, 200),
@@ -104,11 +287,117 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RO_CALL(abi_bin_to_json, 200),
       CHAIN_RO_CALL(get_required_keys, 200),
       CHAIN_RO_CALL(get_transaction_id, 200),
+      CHAIN_RO_CALL(get_key_accounts, 200),
+      CHAIN_RO_CALL(get_startup_report, 200)
+   }, true);
+
+   _http_plugin.add_api({
       CHAIN_RW_CALL_ASYNC(push_block, chain_apis::read_write::push_block_results, 202),
       CHAIN_RW_CALL_ASYNC(push_transaction, chain_apis::read_write::push_transaction_results, 202),
       CHAIN_RW_CALL_ASYNC(push_transactions, chain_apis::read_write::push_transactions_results, 202),
-      CHAIN_RW_CALL_ASYNC(send_transaction, chain_apis::read_write::send_transaction_results, 202)
+      CHAIN_RW_CALL_ASYNC(send_transaction, chain_apis::read_write::send_transaction_results, 202),
+      CHAIN_RW_CALL_ASYNC(dry_run_transaction, chain_apis::read_write::dry_run_transaction_results, 200)
+   });
+
+   // the body is the binary packing of a vector<packed_transaction>, as fc::raw::pack writes it, so submitters
+   // holding signed transactions skip the JSON and ABI conversions; the response has the id and error of each
+   _http_plugin.add_api({
+      {std::string("/v1/chain/push_packed_transactions"),
+       [rw_api](string, string body, url_response_callback cb) mutable {
+          rw_api.validate();
+          try {
+             auto params = fc::raw::unpack<chain_apis::read_write::push_packed_transactions_params>( body.data(), body.size() );
+             rw_api.push_packed_transactions( std::move( params ),
+                [cb, size = body.size()]( const fc::static_variant<fc::exception_ptr, chain_apis::read_write::push_packed_transactions_results>& result ) {
+                   if( result.contains<fc::exception_ptr>() ) {
+                      try {
+                         result.get<fc::exception_ptr>()->dynamic_rethrow_exception();
+                      } catch (...) {
+                         http_plugin::handle_exception("chain", "push_packed_transactions", std::to_string( size ) + " bytes", cb);
+                      }
+                   } else {
+                      cb(202, result.visit(async_result_visitor()));
+                   }
+                });
+          } catch (...) {
+             http_plugin::handle_exception("chain", "push_packed_transactions", std::to_string( body.size() ) + " bytes", cb);
+          }
+       }}
    });
+
+   // table rows can make large responses, they are written without building a variant of the result first
+   _http_plugin.add_json_api({
+      CHAIN_RO_JSON_CALL(get_table_rows, 200)
+   }, true);
+
+   // the body is an array of {"call": <read-only chain call>, "params": <its parameters>}, the response an array,
+   // in the same order, of {"code": <http code>, "result": <result or error>}; the calls are executed one after
+   // the other in a single handler and so all see the same state
+   auto batch_calls = std::make_shared<const std::map<string, batch_call>>( std::map<string, batch_call>{
+      CHAIN_RO_BATCH_CALL(get_info),
+      CHAIN_RO_BATCH_CALL(get_activated_protocol_features),
+      CHAIN_RO_BATCH_CALL(get_block),
+      CHAIN_RO_BATCH_CALL(get_block_header_state),
+      CHAIN_RO_BATCH_CALL(get_raw_block),
+      CHAIN_RO_BATCH_CALL(get_account),
+      CHAIN_RO_BATCH_CALL(get_code),
+      CHAIN_RO_BATCH_CALL(get_code_hash),
+      CHAIN_RO_BATCH_CALL(get_abi),
+      CHAIN_RO_BATCH_CALL(get_raw_code_and_abi),
+      CHAIN_RO_BATCH_CALL(get_raw_abi),
+      CHAIN_RO_BATCH_JSON_CALL(get_table_rows),
+      CHAIN_RO_BATCH_CALL(get_table_by_scope),
+      CHAIN_RO_BATCH_CALL(get_currency_balance),
+      CHAIN_RO_BATCH_CALL(get_currency_stats),
+      CHAIN_RO_BATCH_CALL(get_producers),
+      CHAIN_RO_BATCH_CALL(get_producer_schedule),
+      CHAIN_RO_BATCH_CALL(get_scheduled_transactions),
+      CHAIN_RO_BATCH_CALL(abi_json_to_bin),
+      CHAIN_RO_BATCH_CALL(abi_bin_to_json),
+      CHAIN_RO_BATCH_CALL(get_required_keys),
+      CHAIN_RO_BATCH_CALL(get_transaction_id)
+   } );
+   _http_plugin.add_json_api({
+      {std::string("/v1/chain/batch"),
+       [ro_api, batch_calls](string, string body, url_response_json_callback cb) mutable {
+          ro_api.validate();
+          try {
+             if (body.empty()) body = "[]";
+             const auto requests = fc::json::from_string(body).get_array();
+             ROXE_ASSERT( requests.size() <= max_batch_calls, fc::invalid_arg_exception,
+                          "At most ${max} calls allowed in a batch", ("max", max_batch_calls) );
+             string json;
+             fc::json_writer writer( json );
+             writer.begin_array();
+             for( const auto& request : requests ) {
+                int code = 200;
+                string result;
+                try {
+                   const auto& call_name = request.get_object()["call"].get_string();
+                   auto itr = batch_calls->find( call_name );
+                   ROXE_ASSERT( itr != batch_calls->end(), fc::invalid_arg_exception,
+                                "Unknown or not batchable call: ${c}", ("c", call_name) );
+                   const auto& obj = request.get_object();
+                   result = itr->second( obj.contains( "params" ) ? obj["params"] : fc::variant( fc::variant_object() ) );
+                } catch (...) {
+                   http_plugin::handle_exception("chain", "batch", fc::json::to_string(request),
+                      [&code, &result](int c, fc::variant error) { code = c; result = fc::json::to_string(error); });
+                }
+                writer.begin_object();
+                writer.key( "code" );
+                writer.value( fc::variant( code ) );
+                writer.key( "result" );
+                writer.raw_value( result );
+                writer.end_object();
+             }
+             writer.end_array();
+             cb(200, std::move(json));
+          } catch (...) {
+             http_plugin::handle_exception("chain", "batch", body,
+                [cb](int code, fc::variant result) { cb(code, fc::json::to_string(result)); });
+          }
+       }}
+   }, true);
 }
 
 void chain_api_plugin::plugin_shutdown() {}
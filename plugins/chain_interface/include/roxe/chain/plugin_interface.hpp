@@ -50,6 +50,8 @@ namespace roxe { namespace chain { namespace plugin_interface {
          // synchronously push a block/trx to a single provider
          using block_sync            = method_decl<chain_plugin_interface, void(const signed_block_ptr&), first_provider_policy>;
          using transaction_async     = method_decl<chain_plugin_interface, void(const transaction_metadata_ptr&, bool, next_function<transaction_trace_ptr>), first_provider_policy>;
+         // push a batch of trxs at once, the next function of each trx is called with its own result
+         using transactions_async    = method_decl<chain_plugin_interface, void(const std::vector<transaction_metadata_ptr>&, bool, const std::vector<next_function<transaction_trace_ptr>>&), first_provider_policy>;
       }
    }
 
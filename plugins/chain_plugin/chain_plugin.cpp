@@ -11,21 +11,28 @@
 #include <roxe/chain/config.hpp>
 #include <roxe/chain/wasm_interface.hpp>
 #include <roxe/chain/resource_limits.hpp>
-#include <roxe/chain/reversible_block_object.hpp>
+#include <roxe/chain/reversible_block_log.hpp>
 #include <roxe/chain/controller.hpp>
 #include <roxe/chain/generated_transaction_object.hpp>
+#include <roxe/chain/global_property_object.hpp>
 #include <roxe/chain/snapshot.hpp>
+#include <roxe/chain/thread_utils.hpp>
 
 #include <roxe/chain/roxe_contract.hpp>
 
 #include <boost/signals2/connection.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/variant.hpp>
+#include <fc/bitutil.hpp>
 #include <signal.h>
 #include <cstdlib>
+#include <array>
+#include <atomic>
 
 namespace roxe {
 
@@ -117,6 +124,29 @@ using fc::flat_map;
 
 using boost::signals2::scoped_connection;
 
+/// parses a thread-cpus entry, <pool>=<cpu list> with the list like 2-5,8
+static std::pair<string, vector<uint32_t>> parse_thread_cpus( const string& spec ) {
+   auto eq = spec.find( '=' );
+   ROXE_ASSERT( eq != string::npos && eq > 0 && eq + 1 < spec.size(), plugin_config_exception,
+                "thread-cpus ${s} is not <pool>=<cpu list>", ("s", spec) );
+   vector<string> ranges;
+   boost::split( ranges, spec.substr( eq + 1 ), boost::is_any_of( "," ) );
+   vector<uint32_t> cpus;
+   try {
+      for( const auto& r : ranges ) {
+         auto dash = r.find( '-' );
+         uint32_t first = boost::lexical_cast<uint32_t>( r.substr( 0, dash ) );
+         uint32_t last = dash == string::npos ? first : boost::lexical_cast<uint32_t>( r.substr( dash + 1 ) );
+         ROXE_ASSERT( first <= last, plugin_config_exception, "thread-cpus ${s} has an empty range ${r}", ("s", spec)("r", r) );
+         for( uint32_t cpu = first; cpu <= last; ++cpu )
+            cpus.push_back( cpu );
+      }
+   } catch( const boost::bad_lexical_cast& ) {
+      ROXE_THROW( plugin_config_exception, "thread-cpus ${s} has an invalid cpu list", ("s", spec) );
+   }
+   return { spec.substr( 0, eq ), std::move( cpus ) };
+}
+
 //using txn_msg_rate_limits = controller::txn_msg_rate_limits;
 
 #define CATCH_AND_CALL(NEXT)\
@@ -137,6 +167,58 @@ using boost::signals2::scoped_connection;
    }
 
 
+/**
+ * What is needed to reject transactions from their header alone without touching the chain state, kept in atomics
+ * so that it can be read from any thread: the head block and the last two block id prefixes seen for each
+ * ref_block_num. Two prefixes are kept for forks that switch back, and a ref_block_num is only judged if it
+ * refers to a block at most a transaction lifetime behind the head, since others may be blocks not seen yet.
+ */
+class transaction_prefilter {
+public:
+   void accepted_block( const block_state_ptr& bsp ) {
+      const uint16_t num = fc::endian_reverse_u32( bsp->id._hash[0] );
+      const uint32_t prefix = bsp->id._hash[1];
+      auto& slot = prefixes[num];
+      const uint64_t last = slot.load( std::memory_order_relaxed );
+      if( static_cast<uint32_t>( last ) != prefix )
+         slot.store( (last << 32) | prefix, std::memory_order_relaxed );
+      head_num.store( bsp->block_num, std::memory_order_relaxed );
+      head_time_us.store( bsp->header.timestamp.to_time_point().time_since_epoch().count(), std::memory_order_relaxed );
+   }
+
+   fc::exception_ptr check( const packed_transaction& ptrx )const {
+      const auto& trx = ptrx.get_transaction();
+      const auto head_time = fc::time_point( fc::microseconds( head_time_us.load( std::memory_order_relaxed ) ) );
+      // the next block is later than the head, so this never accepts less than the producer would
+      if( fc::time_point( trx.expiration ) < head_time ) {
+         return std::make_shared<expired_tx_exception>(
+               FC_LOG_MESSAGE( error, "expired transaction, expiration ${e} is before head block time ${h}",
+                               ("e", trx.expiration)("h", head_time) ) );
+      }
+
+      const uint16_t behind = static_cast<uint16_t>( head_num.load( std::memory_order_relaxed ) ) - trx.ref_block_num;
+      if( behind > max_ref_block_age )
+         return nullptr;
+      const uint64_t seen = prefixes[trx.ref_block_num].load( std::memory_order_relaxed );
+      if( seen == 0 )
+         return nullptr;
+      if( static_cast<uint32_t>( seen ) == trx.ref_block_prefix ||
+          ( (seen >> 32) != 0 && static_cast<uint32_t>( seen >> 32 ) == trx.ref_block_prefix ) )
+         return nullptr;
+      return std::make_shared<invalid_ref_block_exception>(
+            FC_LOG_MESSAGE( error, "transaction's reference block ${n} with prefix ${p} did not match",
+                            ("n", trx.ref_block_num)("p", trx.ref_block_prefix) ) );
+   }
+
+private:
+   /// blocks in twice the default maximum transaction lifetime of an hour, more behind the head are not judged
+   static constexpr uint16_t max_ref_block_age = 2 * 3600 * 1000 / config::block_interval_ms;
+
+   std::array<std::atomic<uint64_t>, 0x10000> prefixes{};
+   std::atomic<uint32_t>                      head_num{0};
+   std::atomic<int64_t>                       head_time_us{0};
+};
+
 class chain_plugin_impl {
 public:
    chain_plugin_impl()
@@ -164,6 +246,16 @@ public:
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_ms;
    fc::optional<bfs::path>          snapshot_path;
+   vector<bfs::path>                snapshot_diff_paths;
+   transaction_prefilter            prefilter;
+   std::unique_ptr<abi_serializer_cache> abi_cache;
+   std::unique_ptr<key_account_index> key_index;
+   bfs::path                        key_index_file;
+   std::unique_ptr<boost::asio::steady_timer> replica_timer;
+   std::chrono::milliseconds        replica_refresh{50};
+   bool                             replica_writer_attached = true;
+
+   void schedule_replica_refresh();
 
 
    // retained references to channels for easy publication
@@ -209,22 +301,56 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-stride", bpo::value<uint32_t>()->default_value(0),
+          "split the block log into a new file every time the head block number is a multiple of this value (0 to never split)")
+         ("max-retained-block-files", bpo::value<uint32_t>()->default_value(0),
+          "the number of split block log files kept in the blocks directory, older files are archived or deleted (0 to keep all)")
+         ("blocks-archive-dir", bpo::value<bfs::path>(),
+          "the location split block log files beyond max-retained-block-files are moved to (absolute path or relative to the blocks directory). If not set they are deleted.")
+         ("block-log-async-writes", bpo::value<bool>()->default_value(false),
+          "append irreversible blocks to the block log from a writer thread instead of the main thread. Blocks still queued when the process dies are missing from the end of the log.")
          ("protocol-features-dir", bpo::value<bfs::path>()->default_value("protocol_features"),
           "the location of the protocol_features directory (absolute path or relative to application config dir)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("wasm-runtime", bpo::value<roxe::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
+         ("prepared-wasm-cache-dir", bpo::value<bfs::path>()->default_value("prepared_wasm"),
+          "the location of the directory used to persist contract wasm after injection, so a restart skips re-injecting it (absolute path or relative to application data dir); WAVM still compiles the code on first use after every restart. An empty value disables the cache")
+         ("wasm-instantiation-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_instantiation_cache_size / (1024 * 1024)),
+          "estimated memory in MiB the instantiated contracts may take; beyond it the contracts cheapest to instantiate again per byte and unused for longest are dropped, 0 is unbounded")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
+         ("abi-serializer-cache-size", bpo::value<uint32_t>()->default_value(abi_serializer_cache::default_max_size),
+          "number of contract accounts whose constructed ABI serializer is kept for the API plugins; 0 disables the cache")
+         ("key-account-index", bpo::value<bool>()->default_value(false),
+          "keep an index of the accounts each public key is a part of, served by /v1/chain/get_key_accounts")
+         ("key-account-index-file", bpo::value<bfs::path>()->default_value("key-accounts.bin"),
+          "the file the key account index is kept in across restarts (absolute path or relative to the state dir)")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
          ("chain-state-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the chain state database drops below this size (in MiB).")
-         ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024  * 1024)), "Maximum size (in MiB) of the reversible blocks database")
-         ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
+         ("reversible-blocks-db-size-mb", bpo::value<uint64_t>(), "Deprecated and ignored, reversible blocks are kept in an append only log")
+         ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>(), "Deprecated and ignored, reversible blocks are kept in an append only log")
          ("signature-cpu-billable-pct", bpo::value<uint32_t>()->default_value(config::default_sig_cpu_bill_pct / config::percent_1),
           "Percentage of actual signature recovery cpu to bill. Whole number percentages, e.g. 50 for 50%")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
+         ("thread-cpus", bpo::value<vector<string>>()->composing(),
+          "Pins the threads of a pool to CPUs, as <pool>=<cpu list> where the list is like 2-5,8 (may specify multiple times). "
+          "Pools are main (the main thread), chain, net, http, prod, ship, ship-init and mongoc. Threads of pools not listed run on any CPU. "
+          "The state database is loaded by the main thread, so in heap or locked mode its memory is allocated on the NUMA node of the main thread's CPUs.")
+         ("signature-recovery-cache-size", bpo::value<uint32_t>()->default_value(config::default_sig_recovery_cache_size),
+          "Number of recovered signature keys cached, shared by p2p, API and block validation; 0 disables the cache")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
+         ("contracts-console-max-bytes", bpo::value<uint32_t>()->default_value(config::default_max_console_output_bytes),
+          "Contract console output kept per transaction, for the log and the traces; the rest is cut off")
+         ("profile-wasm", bpo::bool_switch()->default_value(false),
+          "aggregate contract execution time and intrinsic calls per receiver and action, see producer_api_plugin get_wasm_profile")
+         ("wasm-sample-interval-us", bpo::value<uint32_t>()->default_value(0),
+          "sample the contract function running every this many microseconds into folded stacks per contract, see producer_api_plugin get_wasm_samples; 0 disables sampling. 10000 costs well under 1% of contract execution")
+         ("record-table-access-sets", bpo::bool_switch()->default_value(false),
+          "record the contract tables each transaction reads and writes, and log how many conflict-free execution waves each block needs")
+         ("enable-differential-snapshots", bpo::bool_switch()->default_value(false),
+          "track the contract tables changed since the last snapshot so that differential snapshots can be created, see producer_api_plugin create_differential_snapshot")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
           "Account added to actor whitelist (may specify multiple times)")
          ("actor-blacklist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -266,6 +392,27 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
 #ifdef __linux__
          ("database-hugepage-path", bpo::value<vector<string>>()->composing(), "Optional path for database hugepages when in \"locked\" mode (may specify multiple times)")
 #endif
+         ("database-checkpoint-interval", bpo::value<uint32_t>()->default_value(0),
+          "In \"heap\" or \"locked\" mode, write the state pages changed since the last checkpoint back to the state file every N irreversible blocks (0 to disable). After a crash the node resumes from the last checkpoint and replays the blocks after it instead of requiring a full replay. In \"heap\" mode a forked process writes the checkpoint, which needs memory for the state pages changed while it runs; in \"locked\" mode the main thread is blocked while it is written.")
+         ("database-cold-page-interval", bpo::value<uint32_t>()->default_value(0),
+          "In \"mapped\" mode, every N irreversible blocks mark the state pages as cold so that the pages holding table rows not accessed in the last N blocks are the first to be written back to the state file and dropped from memory when it runs short, and are read back in when next accessed (0 to disable). "
+          "Lets a node run with less memory than the size of the state at the cost of disk reads for cold rows. Requires Linux 5.4 or later.")
+         ("database-hot-page-profile-interval", bpo::value<uint32_t>()->default_value(0),
+          "In \"mapped\" mode, every N irreversible blocks record which state pages are in memory, and at startup read the recorded pages back in parallel "
+          "so that the node does not fault in its working set one page at a time after a restart (0 to disable).")
+         ("publish-state-revision", bpo::bool_switch()->default_value(false),
+          "Publish the revision and head block of the state after every block in shared_memory.rev in the state directory, so that state replicas on this host can serve reads from it. "
+          "Requires database-map-mode = mapped and read-mode = read-only.")
+         ("state-replica-of", bpo::value<bfs::path>(),
+          "Serve the read-only chain API from the state of a node on this host run with publish-state-revision, mapping its state directory, given here, read-only. "
+          "A replica applies no blocks and only knows the blocks in its own blocks directory, so net_plugin and producer_plugin should not be enabled. "
+          "The node publishing the state waits for the queries of its replicas in progress before it applies a block, and the replicas need write access to shared_memory.rev.")
+         ("state-replica-refresh-ms", bpo::value<uint32_t>()->default_value(50),
+          "How often a state replica takes the head block the writer published.")
+         ("state-delta-standby", bpo::bool_switch()->default_value(false),
+          "Follow a primary by applying the state delta of each of its blocks, as state_delta_plugin reads them from the primary's delta log, "
+          "instead of executing the transactions. Blocks from peers are ignored and none are produced until the standby is promoted with "
+          "/v1/producer/promote_standby, from then on it validates blocks in full. Requires read-mode = speculative or head.")
          ;
 
 // TODO: rate limiting
@@ -286,11 +433,11 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("extract-genesis-json", bpo::value<bfs::path>(),
           "extract genesis_state from blocks.log as JSON, write into specified file, and exit")
          ("fix-reversible-blocks", bpo::bool_switch()->default_value(false),
-          "recovers reversible block database if that database is in a bad state")
+          "truncates the reversible block log after --truncate-at-block and exits; a partially written log is repaired on every startup")
          ("force-all-checks", bpo::bool_switch()->default_value(false),
           "do not skip any checks that can be skipped while replaying irreversible blocks")
          ("disable-replay-opts", bpo::bool_switch()->default_value(false),
-          "disable optimizations that specifically target replay")
+          "disable optimizations that specifically target replay, and applying irreversible blocks without undo sessions in \"irreversible\" read mode")
          ("replay-blockchain", bpo::bool_switch()->default_value(false),
           "clear chain state database and replay all blocks")
          ("hard-replay-blockchain", bpo::bool_switch()->default_value(false),
@@ -304,6 +451,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("export-reversible-blocks", bpo::value<bfs::path>(),
            "export reversible block database in portable format into specified file and then exit")
          ("snapshot", bpo::value<bfs::path>(), "File to read Snapshot State from")
+         ("snapshot-diff", bpo::value<vector<bfs::path>>()->composing()->multitoken(),
+          "Differential snapshot applied on top of --snapshot (may specify multiple times, in the order they were created)")
          ;
 
 }
@@ -637,10 +786,52 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       if(options.count("abi-serializer-max-time-ms"))
          my->abi_serializer_max_time_ms = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
+      if( options.at( "abi-serializer-cache-size" ).as<uint32_t>() > 0 )
+         my->abi_cache = std::make_unique<abi_serializer_cache>( options.at( "abi-serializer-cache-size" ).as<uint32_t>() );
 
       my->chain_config->blocks_dir = my->blocks_dir;
+      my->chain_config->blocks_log_stride = options.at( "blocks-log-stride" ).as<uint32_t>();
+      my->chain_config->max_retained_block_files = options.at( "max-retained-block-files" ).as<uint32_t>();
+      my->chain_config->block_log_async_writes = options.at( "block-log-async-writes" ).as<bool>();
+      if( options.count( "blocks-archive-dir" )) {
+         auto bad = options.at( "blocks-archive-dir" ).as<bfs::path>();
+         if( bad.is_relative())
+            my->chain_config->blocks_archive_dir = my->blocks_dir / bad;
+         else
+            my->chain_config->blocks_archive_dir = bad;
+      }
+      if( options.count( "prepared-wasm-cache-dir" )) {
+         auto ccd = options.at( "prepared-wasm-cache-dir" ).as<bfs::path>();
+         if( ccd.empty() )
+            my->chain_config->prepared_wasm_cache_dir = fc::path();
+         else if( ccd.is_relative())
+            my->chain_config->prepared_wasm_cache_dir = app().data_dir() / ccd;
+         else
+            my->chain_config->prepared_wasm_cache_dir = ccd;
+      }
+      my->chain_config->wasm_instantiation_cache_size = options.at( "wasm-instantiation-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
       my->chain_config->read_only = my->readonly;
+      if( options.count( "state-replica-of" ) ) {
+         auto sd = options.at( "state-replica-of" ).as<bfs::path>();
+         my->chain_config->state_dir = sd.is_relative() ? app().data_dir() / sd : sd;
+         my->chain_config->state_replica = true;
+         // the state directory belongs to the node publishing it
+         for( const char* o : { "delete-all-blocks", "hard-replay-blockchain", "replay-blockchain" } ) {
+            ROXE_ASSERT( !options.count( o ) || !options.at( o ).as<bool>(), plugin_config_exception,
+                         "${o} can not be used with state-replica-of", ("o", o) );
+         }
+         ROXE_ASSERT( !options.count( "snapshot" ), plugin_config_exception, "snapshot can not be used with state-replica-of" );
+         // a replica does not apply the transactions that would keep the index current
+         ROXE_ASSERT( !options.at( "key-account-index" ).as<bool>(), plugin_config_exception,
+                      "key-account-index can not be used with state-replica-of" );
+      }
+
+      if( options.at( "key-account-index" ).as<bool>() ) {
+         my->key_index = std::make_unique<key_account_index>();
+         auto kf = options.at( "key-account-index-file" ).as<bfs::path>();
+         my->key_index_file = kf.is_relative() ? bfs::path( my->chain_config->state_dir ) / kf : kf;
+      }
 
       if( options.count( "chain-state-db-size-mb" ))
          my->chain_config->state_size = options.at( "chain-state-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
@@ -648,12 +839,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "chain-state-db-guard-size-mb" ))
          my->chain_config->state_guard_size = options.at( "chain-state-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
-      if( options.count( "reversible-blocks-db-size-mb" ))
-         my->chain_config->reversible_cache_size =
-               options.at( "reversible-blocks-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
-
-      if( options.count( "reversible-blocks-db-guard-size-mb" ))
-         my->chain_config->reversible_guard_size = options.at( "reversible-blocks-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
+      if( options.count( "reversible-blocks-db-size-mb" ) || options.count( "reversible-blocks-db-guard-size-mb" ))
+         wlog( "reversible-blocks-db-size-mb and reversible-blocks-db-guard-size-mb are deprecated and ignored" );
 
       if( options.count( "chain-threads" )) {
          my->chain_config->thread_pool_size = options.at( "chain-threads" ).as<uint16_t>();
@@ -661,17 +848,37 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                      "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
       }
 
+      if( options.count( "thread-cpus" )) {
+         bool pin_main = false;
+         for( const auto& spec : options.at( "thread-cpus" ).as<vector<string>>() ) {
+            auto pool_cpus = parse_thread_cpus( spec );
+            pin_main = pin_main || pool_cpus.first == "main";
+            thread_affinity::set( pool_cpus.first, std::move( pool_cpus.second ) );
+         }
+         // before the controller creates its pool and loads the state database
+         if( pin_main && !thread_affinity::pin_current_thread( "main" ) )
+            wlog( "unable to pin the main thread to its CPUs" );
+         ilog( "thread CPUs:\n${t}", ("t", thread_affinity::describe()) );
+      }
+
       my->chain_config->sig_cpu_bill_pct = options.at("signature-cpu-billable-pct").as<uint32_t>();
       ROXE_ASSERT( my->chain_config->sig_cpu_bill_pct >= 0 && my->chain_config->sig_cpu_bill_pct <= 100, plugin_config_exception,
                   "signature-cpu-billable-pct must be 0 - 100, ${pct}", ("pct", my->chain_config->sig_cpu_bill_pct) );
       my->chain_config->sig_cpu_bill_pct *= config::percent_1;
 
+      my->chain_config->sig_recovery_cache_size = options.at( "signature-recovery-cache-size" ).as<uint32_t>();
+
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
+      my->chain_config->max_console_output_bytes = options.at( "contracts-console-max-bytes" ).as<uint32_t>();
+      my->chain_config->record_table_access_sets = options.at( "record-table-access-sets" ).as<bool>();
+      my->chain_config->profile_wasm = options.at( "profile-wasm" ).as<bool>();
+      my->chain_config->wasm_sample_interval_us = options.at( "wasm-sample-interval-us" ).as<uint32_t>();
+      my->chain_config->differential_snapshots = options.at( "enable-differential-snapshots" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
 
       if( options.count( "extract-genesis-json" ) || options.at( "print-genesis-json" ).as<bool>()) {
@@ -736,14 +943,9 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
              options.at( "fix-reversible-blocks" ).as<bool>()) {
             // Do not try to recover reversible blocks if the directory does not exist, unless the option was explicitly provided.
             if( !recover_reversible_blocks( backup_dir / config::reversible_blocks_dir_name,
-                                            my->chain_config->reversible_cache_size,
                                             my->chain_config->blocks_dir / config::reversible_blocks_dir_name,
                                             options.at( "truncate-at-block" ).as<uint32_t>())) {
-               ilog( "Reversible blocks database was not corrupted. Copying from backup to blocks directory." );
-               fc::copy( backup_dir / config::reversible_blocks_dir_name,
-                         my->chain_config->blocks_dir / config::reversible_blocks_dir_name );
-               fc::copy( backup_dir / config::reversible_blocks_dir_name / "shared_memory.bin",
-                         my->chain_config->blocks_dir / config::reversible_blocks_dir_name / "shared_memory.bin" );
+               ilog( "Copied reversible blocks from backup to blocks directory." );
             }
          }
       } else if( options.at( "replay-blockchain" ).as<bool>()) {
@@ -752,19 +954,15 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
             wlog( "The --truncate-at-block option does not work for a regular replay of the blockchain." );
          clear_chainbase_files( my->chain_config->state_dir );
          if( options.at( "fix-reversible-blocks" ).as<bool>()) {
-            if( !recover_reversible_blocks( my->chain_config->blocks_dir / config::reversible_blocks_dir_name,
-                                            my->chain_config->reversible_cache_size )) {
-               ilog( "Reversible blocks database was not corrupted." );
-            }
+            wlog( "The --fix-reversible-blocks option is not needed for a replay, the reversible block log is repaired on startup." );
          }
       } else if( options.at( "fix-reversible-blocks" ).as<bool>()) {
          if( !recover_reversible_blocks( my->chain_config->blocks_dir / config::reversible_blocks_dir_name,
-                                         my->chain_config->reversible_cache_size,
                                          optional<fc::path>(),
                                          options.at( "truncate-at-block" ).as<uint32_t>())) {
-            ilog( "Reversible blocks database verified to not be corrupted. Now exiting..." );
+            ilog( "Reversible block log did not need to be truncated. Now exiting..." );
          } else {
-            ilog( "Exiting after fixing reversible blocks database..." );
+            ilog( "Exiting after truncating reversible block log..." );
          }
          ROXE_THROW( fixed_reversible_db_exception, "fixed corrupted reversible blocks database" );
       } else if( options.at( "truncate-at-block" ).as<uint32_t>() > 0 ) {
@@ -774,8 +972,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          ilog("Importing reversible blocks from '${file}'", ("file", reversible_blocks_file.generic_string()) );
          fc::remove_all( my->chain_config->blocks_dir/config::reversible_blocks_dir_name );
 
-         import_reversible_blocks( my->chain_config->blocks_dir/config::reversible_blocks_dir_name,
-                                   my->chain_config->reversible_cache_size, reversible_blocks_file );
+         import_reversible_blocks( my->chain_config->blocks_dir/config::reversible_blocks_dir_name, reversible_blocks_file );
 
          ROXE_THROW( node_management_success, "imported reversible blocks" );
       }
@@ -798,6 +995,14 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          });
          infile.close();
 
+         if( options.count( "snapshot-diff" )) {
+            my->snapshot_diff_paths = options.at( "snapshot-diff" ).as<vector<bfs::path>>();
+            for( const auto& p : my->snapshot_diff_paths ) {
+               ROXE_ASSERT( fc::exists(p), plugin_config_exception,
+                           "Cannot load differential snapshot, ${name} does not exist", ("name", p.generic_string()) );
+            }
+         }
+
          ROXE_ASSERT( options.count( "genesis-timestamp" ) == 0,
                  plugin_config_exception,
                  "--snapshot is incompatible with --genesis-timestamp as the snapshot contains genesis information");
@@ -893,8 +1098,42 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count("database-hugepage-path") )
          my->chain_config->db_hugepage_paths = options.at("database-hugepage-path").as<std::vector<std::string>>();
 #endif
+      my->chain_config->db_checkpoint_interval = options.at("database-checkpoint-interval").as<uint32_t>();
+      my->chain_config->db_cold_page_interval = options.at("database-cold-page-interval").as<uint32_t>();
+      if( my->chain_config->db_cold_page_interval && my->chain_config->db_map_mode != pinnable_mapped_file::map_mode::mapped )
+         wlog( "database-cold-page-interval has no effect unless database-map-mode = mapped" );
+      my->chain_config->db_hot_page_profile_interval = options.at("database-hot-page-profile-interval").as<uint32_t>();
+      if( my->chain_config->db_hot_page_profile_interval && my->chain_config->db_map_mode != pinnable_mapped_file::map_mode::mapped )
+         wlog( "database-hot-page-profile-interval has no effect unless database-map-mode = mapped" );
+
+      my->chain_config->publish_state_revision = options.at("publish-state-revision").as<bool>();
+      ROXE_ASSERT( !my->chain_config->publish_state_revision ||
+                   (my->chain_config->db_map_mode == pinnable_mapped_file::map_mode::mapped && my->chain_config->read_mode == db_read_mode::READ_ONLY),
+                   plugin_config_exception,
+                   "publish-state-revision requires database-map-mode = mapped and read-mode = read-only, replicas map the state file and "
+                   "only see it between blocks" );
+      my->chain_config->state_delta_standby = options.at("state-delta-standby").as<bool>();
+      ROXE_ASSERT( !my->chain_config->state_delta_standby ||
+                   (!my->chain_config->state_replica && my->chain_config->read_mode != db_read_mode::IRREVERSIBLE &&
+                    my->chain_config->read_mode != db_read_mode::READ_ONLY),
+                   plugin_config_exception,
+                   "state-delta-standby requires read-mode = speculative or head and can not be used with state-replica-of" );
+      if( my->chain_config->state_replica ) {
+         ROXE_ASSERT( !my->chain_config->publish_state_revision, plugin_config_exception,
+                      "a state replica does not publish a state of its own" );
+         my->chain_config->read_mode = db_read_mode::READ_ONLY;
+         my->chain_config->db_map_mode = pinnable_mapped_file::map_mode::mapped;
+         my->replica_refresh = std::chrono::milliseconds( std::max<uint32_t>( options.at("state-replica-refresh-ms").as<uint32_t>(), 1 ) );
+      }
 
-      my->chain.emplace( *my->chain_config, std::move(pfs) );
+      {
+         // opens and, in heap or locked mode, loads the state database, the block logs and the fork database
+         auto phase = startup_profile::instance().phase( "controller_open" );
+         my->chain.emplace( *my->chain_config, std::move(pfs) );
+         const auto& db = my->chain->db();
+         phase.add( "state_size_bytes", db.get_segment_manager()->get_size() );
+         phase.add( "state_used_bytes", db.get_segment_manager()->get_size() - db.get_free_memory() );
+      }
       my->chain_id.emplace( my->chain->get_chain_id());
 
       // set up method providers
@@ -937,6 +1176,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
             } );
 
       my->accepted_block_connection = my->chain->accepted_block.connect( [this]( const block_state_ptr& blk ) {
+         my->prefilter.accepted_block( blk );
          my->accepted_block_channel.publish( priority::high, blk );
       } );
 
@@ -951,6 +1191,26 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       my->applied_transaction_connection = my->chain->applied_transaction.connect(
             [this]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
+               if( my->abi_cache ) {
+                  for( const auto& at : std::get<0>(t)->action_traces ) {
+                     if( at.receiver == config::system_account_name && at.act.account == config::system_account_name &&
+                         at.act.name == setabi::get_name() && at.act.data.size() >= sizeof(account_name) ) {
+                        my->abi_cache->invalidate( fc::raw::unpack<account_name>( at.act.data ) );
+                     }
+                  }
+               }
+               if( my->key_index ) {
+                  for( const auto& at : std::get<0>(t)->action_traces ) {
+                     if( at.receiver != config::system_account_name || at.act.account != config::system_account_name )
+                        continue;
+                     if( at.act.name == newaccount::get_name() ) {
+                        my->key_index->update( my->chain->db(), at.act.data_as<newaccount>().name );
+                     } else if( (at.act.name == updateauth::get_name() || at.act.name == deleteauth::get_name()) &&
+                                at.act.data.size() >= sizeof(account_name) ) {
+                        my->key_index->update( my->chain->db(), fc::raw::unpack<account_name>( at.act.data ) );
+                     }
+                  }
+               }
                my->applied_transaction_channel.publish( priority::low, std::get<0>(t) );
             } );
 
@@ -959,15 +1219,50 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
 }
 
+/// the slowest plugins and every startup phase, indented by the phases they are a part of
+static void log_startup_report( const chain_apis::read_only::get_startup_report_results& r ) {
+   auto ms = []( fc::microseconds d ) { return d.count() / 1000; };
+   ilog( "startup took ${t} ms", ("t", ms( r.total )) );
+   for( const auto& p : r.plugins ) {
+      if( ms( p.initialize ) + ms( p.startup ) > 0 )
+         ilog( "   ${p}: initialize ${i} ms, startup ${s} ms", ("p", p.name)("i", ms( p.initialize ))("s", ms( p.startup )) );
+   }
+   std::vector<fc::time_point> enclosing_ends;
+   for( const auto& phase : r.phases ) {
+      const auto end = phase.start + phase.duration;
+      while( !enclosing_ends.empty() && enclosing_ends.back() < end )
+         enclosing_ends.pop_back();
+      string counters;
+      for( const auto& c : phase.counters )
+         counters += " " + c.first + "=" + std::to_string( c.second );
+      ilog( "   ${indent}${n}: ${t} ms${c}", ("indent", string( 3 * enclosing_ends.size(), ' ' ))("n", phase.name)
+            ("t", ms( phase.duration ))("c", counters) );
+      enclosing_ends.push_back( end );
+   }
+}
+
 void chain_plugin::plugin_startup()
 { try {
+   // channel subscribers have all registered during plugin_initialize, before the replay in startup below
+   if( my->applied_transaction_channel.has_subscribers() )
+      my->chain->require_detailed_traces();
+
    try {
       auto shutdown = [](){ return app().is_quiting(); };
       if (my->snapshot_path) {
-         auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
+         read_ahead_file_streambuf buf( *my->snapshot_path );
+         std::istream infile( &buf );
          auto reader = std::make_shared<istream_snapshot_reader>(infile);
-         my->chain->startup(shutdown, reader);
-         infile.close();
+
+         vector<std::unique_ptr<read_ahead_file_streambuf>> diff_bufs;
+         vector<std::unique_ptr<std::istream>> diff_files;
+         vector<snapshot_reader_ptr> diffs;
+         for( const auto& p : my->snapshot_diff_paths ) {
+            diff_bufs.emplace_back( std::make_unique<read_ahead_file_streambuf>( p ) );
+            diff_files.emplace_back( std::make_unique<std::istream>( diff_bufs.back().get() ) );
+            diffs.emplace_back( std::make_shared<istream_snapshot_reader>( *diff_files.back() ) );
+         }
+         my->chain->startup(shutdown, reader, diffs);
       } else {
          my->chain->startup(shutdown);
       }
@@ -978,31 +1273,91 @@ void chain_plugin::plugin_startup()
       throw;
    }
 
+   if( my->chain->head_block_state() )
+      my->prefilter.accepted_block( my->chain->head_block_state() );
+
+   if( my->key_index ) {
+      bool loaded = false;
+      try {
+         loaded = my->key_index->load( my->key_index_file, my->chain->head_block_id() );
+      } FC_LOG_AND_DROP()
+      if( !loaded )
+         my->key_index->build( my->chain->db() );
+      ilog( "key account index ${h} with ${n} keys", ("h", loaded ? "loaded" : "built")("n", my->key_index->size()) );
+   }
+
    if(!my->readonly) {
       ilog("starting chain in read/write mode");
    }
 
+   if( my->chain->is_state_replica() ) {
+      my->replica_timer = std::make_unique<boost::asio::steady_timer>( app().get_io_service() );
+      my->schedule_replica_refresh();
+   }
+
    ilog("Blockchain started; head block is #${num}, genesis timestamp is ${ts}",
         ("num", my->chain->head_block_num())("ts", (std::string)my->chain_config->genesis.initial_timestamp));
 
+   {
+      const auto& db = my->chain->db();
+      const auto free_bytes = db.get_free_memory();
+      ilog("State database uses ${used} MiB of ${size} MiB; ${free} MiB free, largest free block ${largest} MiB",
+           ("used", (db.get_segment_manager()->get_size() - free_bytes) / (1024*1024))
+           ("size", db.get_segment_manager()->get_size() / (1024*1024))
+           ("free", free_bytes / (1024*1024))("largest", db.get_largest_free_block() / (1024*1024)));
+   }
+
    my->chain_config.reset();
+
+   // runs once every plugin has started
+   app().post( priority::low, [this]() {
+      startup_profile::instance().set_ready();
+      log_startup_report( get_read_only_api().get_startup_report( {} ) );
+   } );
 } FC_CAPTURE_AND_RETHROW() }
 
+void chain_plugin_impl::schedule_replica_refresh() {
+   replica_timer->expires_from_now( replica_refresh );
+   replica_timer->async_wait( app().get_priority_queue().wrap( priority::high, [this]( const boost::system::error_code& ec ) {
+      if( ec ) return;
+      try {
+         chain->refresh_replica_head();
+      } FC_LOG_AND_DROP()
+      const bool attached = chain->replica_writer_attached();
+      if( attached != replica_writer_attached ) {
+         if( attached )
+            ilog( "the node publishing the state is running again" );
+         else
+            wlog( "the node publishing the state stopped, serving the state as it left it" );
+         replica_writer_attached = attached;
+      }
+      schedule_replica_refresh();
+   } ) );
+}
+
 void chain_plugin::plugin_shutdown() {
+   if( my->replica_timer )
+      my->replica_timer->cancel();
    my->pre_accepted_block_connection.reset();
    my->accepted_block_header_connection.reset();
    my->accepted_block_connection.reset();
    my->irreversible_block_connection.reset();
    my->accepted_transaction_connection.reset();
    my->applied_transaction_connection.reset();
+   if( my->key_index && my->chain ) {
+      try {
+         my->key_index->save( my->key_index_file, my->chain->db(), my->chain->head_block_id() );
+      } FC_LOG_AND_DROP()
+   }
    if(app().is_quiting())
       my->chain->get_wasm_interface().indicate_shutting_down();
    my->chain.reset();
 }
 
-chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time)
+chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time, abi_serializer_cache* abi_cache)
 : db(db)
 , abi_serializer_max_time(abi_serializer_max_time)
+, abi_cache(abi_cache)
 {
 }
 
@@ -1022,121 +1377,51 @@ void chain_plugin::accept_transaction(const chain::transaction_metadata_ptr& trx
    my->incoming_transaction_async_method(trx, false, std::forward<decltype(next)>(next));
 }
 
+fc::exception_ptr chain_plugin::prefilter_transaction( const packed_transaction& trx )const {
+   return my->prefilter.check( trx );
+}
+
 bool chain_plugin::block_is_on_preferred_chain(const block_id_type& block_id) {
    auto b = chain().fetch_block_by_number( block_header::num_from_id(block_id) );
    return b && b->id() == block_id;
 }
 
-bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, uint32_t cache_size,
-                                              optional<fc::path> new_db_dir, uint32_t truncate_at_block ) {
-   try {
-      chainbase::database reversible( db_dir, database::read_only); // Test if dirty
-      // If it reaches here, then the reversible database is not dirty
-
-      if( truncate_at_block == 0 )
-         return false;
-
-      reversible.add_index<reversible_block_index>();
-      const auto& ubi = reversible.get_index<reversible_block_index,by_num>();
-
-      auto itr = ubi.rbegin();
-      if( itr != ubi.rend() && itr->blocknum <= truncate_at_block )
-         return false; // Because we are not going to be truncating the reversible database at all.
-   } catch( const std::runtime_error& ) {
-   } catch( ... ) {
-      throw;
-   }
-   // Reversible block database is dirty. So back it up (unless already moved) and then create a new one.
-
-   auto reversible_dir = fc::canonical( db_dir );
-   if( reversible_dir.filename().generic_string() == "." ) {
-      reversible_dir = reversible_dir.parent_path();
-   }
-   fc::path backup_dir;
-
-   auto now = fc::time_point::now();
-
+bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, optional<fc::path> new_db_dir, uint32_t truncate_at_block ) {
+   auto reversible_dir = db_dir;
    if( new_db_dir ) {
-      backup_dir = reversible_dir;
+      fc::create_directories( *new_db_dir );
+      if( reversible_block_log::exists( db_dir ) )
+         fc::copy( db_dir / reversible_block_log::filename, *new_db_dir / reversible_block_log::filename );
+      // a reversible block database of an earlier version is imported on startup
+      if( fc::exists( db_dir / "shared_memory.bin" ) )
+         fc::copy( db_dir / "shared_memory.bin", *new_db_dir / "shared_memory.bin" );
       reversible_dir = *new_db_dir;
-   } else {
-      auto reversible_dir_name = reversible_dir.filename().generic_string();
-      ROXE_ASSERT( reversible_dir_name != ".", invalid_reversible_blocks_dir, "Invalid path to reversible directory" );
-      backup_dir = reversible_dir.parent_path() / reversible_dir_name.append("-").append( now );
-
-      ROXE_ASSERT( !fc::exists(backup_dir),
-                  reversible_blocks_backup_dir_exist,
-                 "Cannot move existing reversible directory to already existing directory '${backup_dir}'",
-                 ("backup_dir", backup_dir) );
-
-      fc::rename( reversible_dir, backup_dir );
-      ilog( "Moved existing reversible directory to backup location: '${new_db_dir}'", ("new_db_dir", backup_dir) );
    }
 
-   fc::create_directories( reversible_dir );
-
-   ilog( "Reconstructing '${reversible_dir}' from backed up reversible directory", ("reversible_dir", reversible_dir) );
-
-   chainbase::database  old_reversible( backup_dir, database::read_only, 0, true );
-   chainbase::database  new_reversible( reversible_dir, database::read_write, cache_size );
-   std::fstream         reversible_blocks;
-   reversible_blocks.open( (reversible_dir.parent_path() / std::string("portable-reversible-blocks-").append( now ) ).generic_string().c_str(),
-                           std::ios::out | std::ios::binary );
-
-   uint32_t num = 0;
-   uint32_t start = 0;
-   uint32_t end = 0;
-   old_reversible.add_index<reversible_block_index>();
-   new_reversible.add_index<reversible_block_index>();
-   const auto& ubi = old_reversible.get_index<reversible_block_index,by_num>();
-   auto itr = ubi.begin();
-   if( itr != ubi.end() ) {
-      start = itr->blocknum;
-      end = start - 1;
-   }
-   if( truncate_at_block > 0 && start > truncate_at_block ) {
-      ilog( "Did not recover any reversible blocks since the specified block number to stop at (${stop}) is less than first block in the reversible database (${start}).", ("stop", truncate_at_block)("start", start) );
-      return true;
+   if( !reversible_block_log::exists( reversible_dir ) ) {
+      ilog( "There is no reversible block log in '${dir}'", ("dir", reversible_dir.generic_string()) );
+      return false;
    }
-   try {
-      for( ; itr != ubi.end(); ++itr ) {
-         ROXE_ASSERT( itr->blocknum == end + 1, gap_in_reversible_blocks_db,
-                     "gap in reversible block database between ${end} and ${blocknum}",
-                     ("end", end)("blocknum", itr->blocknum)
-                   );
-         reversible_blocks.write( itr->packedblock.data(), itr->packedblock.size() );
-         new_reversible.create<reversible_block_object>( [&]( auto& ubo ) {
-            ubo.blocknum = itr->blocknum;
-            ubo.set_block( itr->get_block() ); // get_block and set_block rather than copying the packed data acts as additional validation
-         });
-         end = itr->blocknum;
-         ++num;
-         if( end == truncate_at_block )
-            break;
-      }
-   } catch( const gap_in_reversible_blocks_db& e ) {
-      wlog( "${details}", ("details", e.to_detail_string()) );
-   } catch( ... ) {}
-
-   if( end == truncate_at_block )
-      ilog( "Stopped recovery of reversible blocks early at specified block number: ${stop}", ("stop", truncate_at_block) );
 
-   if( num == 0 )
-      ilog( "There were no recoverable blocks in the reversible block database" );
-   else if( num == 1 )
-      ilog( "Recovered 1 block from reversible block database: block ${start}", ("start", start) );
-   else
-      ilog( "Recovered ${num} blocks from reversible block database: blocks ${start} to ${end}",
-            ("num", num)("start", start)("end", end) );
+   // opening the log cuts off a partially written block
+   reversible_block_log reversible( reversible_dir );
+   if( truncate_at_block == 0 || reversible.empty() || reversible.last_block_num() <= truncate_at_block )
+      return false;
 
+   if( reversible.first_block_num() > truncate_at_block ) {
+      ilog( "Did not recover any reversible blocks since the specified block number to stop at (${stop}) is less than first block in the reversible block log (${start}).",
+            ("stop", truncate_at_block)("start", reversible.first_block_num()) );
+   } else {
+      ilog( "Stopped recovery of reversible blocks early at specified block number: ${stop}", ("stop", truncate_at_block) );
+   }
+   reversible.truncate( truncate_at_block + 1 );
    return true;
 }
 
 bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
-                                             uint32_t cache_size,
                                              const fc::path& reversible_blocks_file ) {
    std::fstream         reversible_blocks;
-   chainbase::database  new_reversible( reversible_dir, database::read_write, cache_size );
+   reversible_block_log new_reversible( reversible_dir );
    reversible_blocks.open( reversible_blocks_file.generic_string().c_str(), std::ios::in | std::ios::binary );
 
    reversible_blocks.seekg( 0, std::ios::end );
@@ -1146,12 +1431,12 @@ bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
    uint32_t num = 0;
    uint32_t start = 0;
    uint32_t end = 0;
-   new_reversible.add_index<reversible_block_index>();
+   new_reversible.clear();
    try {
       while( reversible_blocks.tellg() < end_pos ) {
-         signed_block tmp;
-         fc::raw::unpack(reversible_blocks, tmp);
-         num = tmp.block_num();
+         auto tmp = std::make_shared<signed_block>();
+         fc::raw::unpack(reversible_blocks, *tmp);
+         num = tmp->block_num();
 
          if( start == 0 ) {
             start = num;
@@ -1162,10 +1447,7 @@ bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
                       );
          }
 
-         new_reversible.create<reversible_block_object>( [&]( auto& ubo ) {
-            ubo.blocknum = num;
-            ubo.set_block( std::make_shared<signed_block>(std::move(tmp)) );
-         });
+         new_reversible.append( tmp );
          end = num;
       }
    } catch( gap_in_reversible_blocks_db& e ) {
@@ -1183,46 +1465,38 @@ bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
 
 bool chain_plugin::export_reversible_blocks( const fc::path& reversible_dir,
                                              const fc::path& reversible_blocks_file ) {
-   chainbase::database  reversible( reversible_dir, database::read_only, 0, true );
+   if( !reversible_block_log::exists( reversible_dir ) && fc::exists( reversible_dir / "shared_memory.bin" ) ) {
+      wlog( "'${dir}' holds a reversible block database of an earlier version, start nodroxe once to import it before exporting",
+            ("dir", reversible_dir.generic_string()) );
+   }
+
+   reversible_block_log reversible( reversible_dir, true );
    std::fstream         reversible_blocks;
    reversible_blocks.open( reversible_blocks_file.generic_string().c_str(), std::ios::out | std::ios::binary );
 
    uint32_t num = 0;
-   uint32_t start = 0;
-   uint32_t end = 0;
-   reversible.add_index<reversible_block_index>();
-   const auto& ubi = reversible.get_index<reversible_block_index,by_num>();
-   auto itr = ubi.begin();
-   if( itr != ubi.end() ) {
-      start = itr->blocknum;
-      end = start - 1;
+   const uint32_t start = reversible.first_block_num();
+   const uint32_t end = reversible.last_block_num();
+   if( !reversible.empty() ) {
+      try {
+         for( uint32_t n = start; n <= end; ++n ) {
+            const auto b = reversible.read_block_by_num( n ); // unpacking verifies that the packed block has not been corrupted
+            const auto data = fc::raw::pack( *b );
+            reversible_blocks.write( data.data(), data.size() );
+            ++num;
+         }
+      } catch( ... ) {}
    }
-   try {
-      for( ; itr != ubi.end(); ++itr ) {
-         ROXE_ASSERT( itr->blocknum == end + 1, gap_in_reversible_blocks_db,
-                     "gap in reversible block database between ${end} and ${blocknum}",
-                     ("end", end)("blocknum", itr->blocknum)
-                   );
-         signed_block tmp;
-         fc::datastream<const char *> ds( itr->packedblock.data(), itr->packedblock.size() );
-         fc::raw::unpack(ds, tmp); // Verify that packed block has not been corrupted.
-         reversible_blocks.write( itr->packedblock.data(), itr->packedblock.size() );
-         end = itr->blocknum;
-         ++num;
-      }
-   } catch( const gap_in_reversible_blocks_db& e ) {
-      wlog( "${details}", ("details", e.to_detail_string()) );
-   } catch( ... ) {}
 
    if( num == 0 ) {
-      ilog( "There were no recoverable blocks in the reversible block database" );
+      ilog( "There were no recoverable blocks in the reversible block log" );
       return false;
    }
    else if( num == 1 )
-      ilog( "Exported 1 block from reversible block database: block ${start}", ("start", start) );
+      ilog( "Exported 1 block from reversible block log: block ${start}", ("start", start) );
    else
-      ilog( "Exported ${num} blocks from reversible block database: blocks ${start} to ${end}",
-            ("num", num)("start", start)("end", end) );
+      ilog( "Exported ${num} blocks from reversible block log: blocks ${start} to ${end}",
+            ("num", num)("start", start)("end", start + num - 1) );
 
    return (end >= start) && ((end - start + 1) == num);
 }
@@ -1239,13 +1513,18 @@ fc::microseconds chain_plugin::get_abi_serializer_max_time() const {
    return my->abi_serializer_max_time_ms;
 }
 
+abi_serializer_cache* chain_plugin::get_abi_serializer_cache() const {
+   return my->abi_cache.get();
+}
+
+const key_account_index* chain_plugin::get_key_account_index() const {
+   return my->key_index.get();
+}
+
 void chain_plugin::log_guard_exception(const chain::guard_exception&e ) {
    if (e.code() == chain::database_guard_exception::code_value) {
       elog("Database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
            "Please increase the value set for \"chain-state-db-size-mb\" and restart the process!");
-   } else if (e.code() == chain::reversible_guard_exception::code_value) {
-      elog("Reversible block database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
-           "Please increase the value set for \"reversible-blocks-db-size-mb\" and restart the process!");
    }
 
    dlog("Details: ${details}", ("details", e.to_detail_string()));
@@ -1259,7 +1538,7 @@ void chain_plugin::handle_guard_exception(const chain::guard_exception& e) {
 }
 
 void chain_plugin::handle_db_exhaustion() {
-   elog("database memory exhausted: increase chain-state-db-size-mb and/or reversible-blocks-db-size-mb");
+   elog("database memory exhausted: increase chain-state-db-size-mb");
    //return 1 -- it's what programs/nodroxe/main.cpp considers "BAD_ALLOC"
    std::_Exit(1);
 }
@@ -1273,6 +1552,7 @@ void chain_plugin::handle_bad_alloc() {
 namespace chain_apis {
 
 const string read_only::KEYi64 = "i64";
+const uint32_t read_only::max_raw_blocks;
 
 template<typename I>
 std::string itoh(I n, size_t hlen = sizeof(I)<<1) {
@@ -1306,6 +1586,17 @@ read_only::get_info_results read_only::get_info(const read_only::get_info_params
    };
 }
 
+read_only::get_startup_report_results read_only::get_startup_report(const read_only::get_startup_report_params&) const {
+   get_startup_report_results result;
+   const auto& profile = startup_profile::instance();
+   if( profile.ready() != fc::time_point() )
+      result.total = profile.ready() - profile.process_start();
+   for( const auto& t : app().get_plugin_timings() )
+      result.plugins.push_back( {t.name, fc::microseconds( t.initialize.count() ), fc::microseconds( t.startup.count() )} );
+   result.phases = profile.phases();
+   return result;
+}
+
 read_only::get_activated_protocol_features_results
 read_only::get_activated_protocol_features( const read_only::get_activated_protocol_features_params& params )const {
    read_only::get_activated_protocol_features_results result;
@@ -1471,6 +1762,18 @@ abi_def get_abi( const controller& db, const name& account ) {
    return abi;
 }
 
+abi_serializer_cache::cached_abi_ptr read_only::get_cached_abi( const name& account )const {
+   if( abi_cache ) {
+      auto cached = abi_cache->get( db.db(), account, abi_serializer_max_time );
+      if( cached ) return cached;
+   }
+   // not cached, or the account has no ABI: get_abi asserts that the account exists
+   auto result = std::make_shared<abi_serializer_cache::cached_abi>();
+   result->abi = roxe::chain_apis::get_abi( db, account );
+   result->serializer.set_abi( result->abi, abi_serializer_max_time );
+   return result;
+}
+
 string get_table_type( const abi_def& abi, const name& table_name ) {
    for( const auto& t : abi.tables ) {
       if( t.name == table_name ){
@@ -1480,48 +1783,170 @@ string get_table_type( const abi_def& abi, const name& table_name ) {
    ROXE_ASSERT( false, chain::contract_table_query_exception, "Table ${table} is not specified in the ABI", ("table",table_name) );
 }
 
+read_only::table_rows_response read_only::get_table_rows_response( const get_table_rows_params& p ) {
+   const bool keys_only = p.keys_only && *p.keys_only;
+   const bool count_only = p.count_only && *p.count_only;
+   ROXE_ASSERT( !(keys_only && count_only), chain::contract_table_query_exception, "keys_only and count_only are exclusive" );
+   if( count_only ) return table_rows_response::count;
+   if( keys_only ) return table_rows_response::keys;
+   return table_rows_response::rows;
+}
+
+fc::microseconds read_only::get_table_query_time( const optional<uint32_t>& time_limit_ms ) {
+   return fc::milliseconds( std::min( time_limit_ms ? *time_limit_ms : default_table_query_time_ms, max_table_query_time_ms ) );
+}
+
+read_only::table_rows_collector::table_rows_collector( const get_table_rows_params& p, const abi_serializer* abis,
+                                                       const fc::microseconds& max_time, bool short_path )
+:p(p)
+,abis(abis)
+,table_type(abis ? abis->get_table_type(p.table) : chain::type_name())
+,max_time(max_time)
+,short_path(short_path)
+{}
+
+void read_only::table_rows_collector::row( const vector<char>& data, account_name payer ) {
+   fc::variant data_var;
+   if( abis ) {
+      data_var = abis->binary_to_variant( table_type, data, max_time, short_path );
+   } else {
+      data_var = fc::variant( data );
+   }
+
+   if( p.show_payer && *p.show_payer ) {
+      result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", payer) );
+   } else {
+      result.rows.emplace_back( std::move(data_var) );
+   }
+}
+
+void read_only::table_rows_collector::key( uint64_t primary_key, account_name payer ) {
+   if( p.show_payer && *p.show_payer ) {
+      result.rows.emplace_back( fc::mutable_variant_object("key", primary_key)("payer", payer) );
+   } else {
+      result.rows.emplace_back( primary_key );
+   }
+}
+
+read_only::table_rows_json_writer::table_rows_json_writer( const get_table_rows_params& p, const abi_serializer* abis,
+                                                           const fc::microseconds& max_time, bool short_path, fc::json_writer& writer )
+:p(p)
+,abis(abis)
+,table_type(abis ? abis->get_table_type(p.table) : chain::type_name())
+,max_time(max_time)
+,short_path(short_path)
+,writer(writer)
+{}
+
+void read_only::table_rows_json_writer::row( const vector<char>& data, account_name payer ) {
+   const bool show_payer = p.show_payer && *p.show_payer;
+   if( show_payer ) {
+      writer.begin_object();
+      writer.key( "data" );
+   }
+   if( abis ) {
+      abis->binary_to_json( table_type, data, writer, max_time, short_path );
+   } else {
+      writer.value( fc::variant( data ) );
+   }
+   if( show_payer ) {
+      writer.key( "payer" );
+      writer.value( fc::variant( payer ) );
+      writer.end_object();
+   }
+}
+
+void read_only::table_rows_json_writer::key( uint64_t primary_key, account_name payer ) {
+   const bool show_payer = p.show_payer && *p.show_payer;
+   if( show_payer ) {
+      writer.begin_object();
+      writer.key( "key" );
+   }
+   writer.value( fc::variant( primary_key ) );
+   if( show_payer ) {
+      writer.key( "payer" );
+      writer.value( fc::variant( payer ) );
+      writer.end_object();
+   }
+}
+
 read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
-   const abi_def abi = roxe::chain_apis::get_abi( db, p.code );
+   const auto cached = table_rows_decoded( p ) ? get_cached_abi( p.code ) : abi_serializer_cache::cached_abi_ptr();
+   table_rows_collector sink( p, cached ? &cached->serializer : nullptr, abi_serializer_max_time, shorten_abi_errors );
+   walk_table_rows( p, cached ? &cached->abi : nullptr, sink );
+   return std::move( sink.result );
+}
+
+string read_only::get_table_rows_json( const read_only::get_table_rows_params& p )const {
+   const auto cached = table_rows_decoded( p ) ? get_cached_abi( p.code ) : abi_serializer_cache::cached_abi_ptr();
+   string json;
+   fc::json_writer writer( json );
+   writer.begin_object();
+   writer.key( "rows" );
+   writer.begin_array();
+   table_rows_json_writer sink( p, cached ? &cached->serializer : nullptr, abi_serializer_max_time, shorten_abi_errors, writer );
+   walk_table_rows( p, cached ? &cached->abi : nullptr, sink );
+   writer.end_array();
+   writer.key( "more" );
+   writer.value( sink.more );
+   if( sink.next_key ) {
+      writer.key( "next_key" );
+      writer.value( *sink.next_key );
+   }
+   if( sink.count ) {
+      writer.key( "count" );
+      writer.value( *sink.count );
+   }
+   writer.end_object();
+   return json;
+}
+
+template<typename RowSink>
+void read_only::walk_table_rows( const read_only::get_table_rows_params& p, const abi_def* abi, RowSink& sink )const {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
    bool primary = false;
    auto table_with_index = get_table_index_name( p, primary );
    if( primary ) {
       ROXE_ASSERT( p.table == table_with_index, chain::contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
-      auto table_type = get_table_type( abi, p.table );
-      if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
-         return get_table_rows_ex<key_value_index>(p,abi);
+      // the primary index is always i64, the ABI is only checked when the rows are decoded through it anyway
+      if( !abi || p.key_type == "i64" || p.key_type == "name" ) {
+         return get_table_rows_ex<key_value_index>(p, sink);
+      }
+      auto table_type = get_table_type( *abi, p.table );
+      if( table_type == KEYi64 ) {
+         return get_table_rows_ex<key_value_index>(p, sink);
       }
-      ROXE_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
+      ROXE_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",*abi));
    } else {
       ROXE_ASSERT( !p.key_type.empty(), chain::contract_table_query_exception, "key type required for non-primary index" );
 
       if (p.key_type == chain_apis::i64 || p.key_type == "name") {
-         return get_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
+         return get_table_rows_by_seckey<index64_index, uint64_t>(p, sink, [](uint64_t v)->uint64_t {
             return v;
          });
       }
       else if (p.key_type == chain_apis::i128) {
-         return get_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
+         return get_table_rows_by_seckey<index128_index, uint128_t>(p, sink, [](uint128_t v)->uint128_t {
             return v;
          });
       }
       else if (p.key_type == chain_apis::i256) {
          if ( p.encode_type == chain_apis::hex) {
             using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, sink, conv::function());
          }
          using  conv = keytype_converter<chain_apis::i256>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, sink, conv::function());
       }
       else if (p.key_type == chain_apis::float64) {
-         return get_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
+         return get_table_rows_by_seckey<index_double_index, double>(p, sink, [](double v)->float64_t {
             float64_t f = *(float64_t *)&v;
             return f;
          });
       }
       else if (p.key_type == chain_apis::float128) {
-         return get_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
+         return get_table_rows_by_seckey<index_long_double_index, double>(p, sink, [](double v)->float128_t{
             float64_t f = *(float64_t *)&v;
             float128_t f128;
             f64_to_f128M(f, &f128);
@@ -1530,11 +1955,11 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
       }
       else if (p.key_type == chain_apis::sha256) {
          using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, sink, conv::function());
       }
       else if(p.key_type == chain_apis::ripemd160) {
          using  conv = keytype_converter<chain_apis::ripemd160,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, sink, conv::function());
       }
       ROXE_ASSERT(false, chain::contract_table_query_exception,  "Unsupported secondary index type: ${t}", ("t", p.key_type));
    }
@@ -1563,16 +1988,24 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
    if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
       return result;
 
+   const bool count_only = p.count_only && *p.count_only;
+   const uint32_t limit = count_only ? std::numeric_limits<uint32_t>::max() : p.limit;
    auto walk_table_range = [&]( auto itr, auto end_itr ) {
       auto cur_time = fc::time_point::now();
-      auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
-      for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
+      auto end_time = cur_time + get_table_query_time( p.time_limit_ms );
+      uint32_t count = 0;
+      for( ; cur_time <= end_time && count < limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
          if( p.table && itr->table != p.table ) continue;
 
-         result.rows.push_back( {itr->code, itr->scope, itr->table, itr->payer, itr->count} );
+         if( !count_only ) {
+            result.rows.push_back( {itr->code, itr->scope, itr->table, itr->payer, itr->count} );
+         }
 
          ++count;
       }
+      if( count_only ) {
+         result.count = count;
+      }
       if( itr != end_itr ) {
          result.more = string(itr->scope);
       }
@@ -1657,9 +2090,10 @@ fc::variant get_global_row( const database& db, const abi_def& abi, const abi_se
 }
 
 read_only::get_producers_result read_only::get_producers( const read_only::get_producers_params& p ) const try {
-   const abi_def abi = roxe::chain_apis::get_abi(db, config::system_account_name);
+   const auto cached = get_cached_abi( config::system_account_name );
+   const abi_def& abi = cached->abi;
    const auto table_type = get_table_type(abi, N(producers));
-   const abi_serializer abis{ abi, abi_serializer_max_time };
+   const abi_serializer& abis = cached->serializer;
    ROXE_ASSERT(table_type == KEYi64, chain::contract_table_query_exception, "Invalid table type ${type} for table producers", ("type",table_type));
 
    const auto& d = db.db();
@@ -1736,6 +2170,8 @@ template<typename Api>
 struct resolver_factory {
    static auto make(const Api* api, const fc::microseconds& max_serialization_time) {
       return [api, max_serialization_time](const account_name &name) -> optional<abi_serializer> {
+         if( api->abi_cache )
+            return api->abi_cache->get_serializer( api->db.db(), name, max_serialization_time );
          const auto* accnt = api->db.db().template find<account_object, by_name>(name);
          if (accnt != nullptr) {
             abi_def abi;
@@ -1862,6 +2298,52 @@ fc::variant read_only::get_block(const read_only::get_block_params& params) cons
            ("ref_block_prefix", ref_block_prefix);
 }
 
+read_only::get_raw_block_results read_only::get_raw_block(const read_only::get_raw_block_params& params) const {
+   ROXE_ASSERT( !params.block_num_or_id.empty() && params.block_num_or_id.size() <= 64,
+               chain::block_id_type_exception,
+               "Invalid Block number or ID, must be greater than 0 and less than 64 characters"
+   );
+   ROXE_ASSERT( params.count > 0 && params.count <= max_raw_blocks, fc::invalid_arg_exception,
+               "count must be between 1 and ${max}", ("max", max_raw_blocks) );
+
+   uint32_t first_num = 0;
+   optional<block_id_type> first_id;
+   try {
+      first_num = fc::to_uint64(params.block_num_or_id);
+   } catch( ... ) {
+      try {
+         first_id = fc::variant(params.block_num_or_id).as<block_id_type>();
+      } ROXE_RETHROW_EXCEPTIONS(chain::block_id_type_exception, "Invalid block ID: ${block_num_or_id}", ("block_num_or_id", params.block_num_or_id))
+      first_num = block_header::num_from_id( *first_id );
+   }
+
+   get_raw_block_results result;
+   for( uint32_t num = first_num; num - first_num < params.count; ++num ) {
+      raw_block rb;
+      rb.block_num = num;
+      rb.block = db.fetch_serialized_block_by_number( num );
+      if( rb.block.empty() ) break;
+      // only the header is unpacked, for the id
+      fc::datastream<const char*> ds( rb.block.data(), rb.block.size() );
+      block_header header;
+      fc::raw::unpack( ds, header );
+      rb.id = header.id();
+
+      if( first_id && num == first_num && rb.id != *first_id ) {
+         // a block of another branch of the fork database
+         auto block = db.fetch_block_by_id( *first_id );
+         ROXE_ASSERT( block, unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+         rb.block = fc::raw::pack( *block );
+         rb.id = *first_id;
+         result.blocks.emplace_back( std::move(rb) );
+         break;
+      }
+      result.blocks.emplace_back( std::move(rb) );
+   }
+   ROXE_ASSERT( !result.blocks.empty(), unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+   return result;
+}
+
 fc::variant read_only::get_block_header_state(const get_block_header_state_params& params) const {
    block_state_ptr b;
    optional<uint64_t> block_num;
@@ -1896,6 +2378,63 @@ void read_write::push_block(read_write::push_block_params&& params, next_functio
    } CATCH_AND_CALL(next);
 }
 
+fc::variant read_write::push_transaction_output( const transaction_trace_ptr& trx_trace_ptr )const {
+   fc::variant output;
+   try {
+      output = db.to_variant_with_abi( *trx_trace_ptr, abi_serializer_max_time );
+
+      // Create map of (closest_unnotified_ancestor_action_ordinal, global_sequence) with action trace
+      std::map< std::pair<uint32_t, uint64_t>, fc::mutable_variant_object > act_traces_map;
+      for( const auto& act_trace : output["action_traces"].get_array() ) {
+         if (act_trace["receipt"].is_null() && act_trace["except"].is_null()) continue;
+         auto closest_unnotified_ancestor_action_ordinal =
+               act_trace["closest_unnotified_ancestor_action_ordinal"].as<fc::unsigned_int>().value;
+         auto global_sequence = act_trace["receipt"].is_null() ?
+                                    std::numeric_limits<uint64_t>::max() :
+                                    act_trace["receipt"]["global_sequence"].as<uint64_t>();
+         act_traces_map.emplace( std::make_pair( closest_unnotified_ancestor_action_ordinal,
+                                                 global_sequence ),
+                                 act_trace.get_object() );
+      }
+
+      std::function<vector<fc::variant>(uint32_t)> convert_act_trace_to_tree_struct =
+      [&](uint32_t closest_unnotified_ancestor_action_ordinal) {
+         vector<fc::variant> restructured_act_traces;
+         auto it = act_traces_map.lower_bound(
+                     std::make_pair( closest_unnotified_ancestor_action_ordinal, 0)
+         );
+         for( ;
+            it != act_traces_map.end() && it->first.first == closest_unnotified_ancestor_action_ordinal; ++it )
+         {
+            auto& act_trace_mvo = it->second;
+
+            auto action_ordinal = act_trace_mvo["action_ordinal"].as<fc::unsigned_int>().value;
+            act_trace_mvo["inline_traces"] = convert_act_trace_to_tree_struct(action_ordinal);
+            if (act_trace_mvo["receipt"].is_null()) {
+               act_trace_mvo["receipt"] = fc::mutable_variant_object()
+                  ("abi_sequence", 0)
+                  ("act_digest", digest_type::hash(trx_trace_ptr->action_traces[action_ordinal-1].act))
+                  ("auth_sequence", flat_map<account_name,uint64_t>())
+                  ("code_sequence", 0)
+                  ("global_sequence", 0)
+                  ("receiver", act_trace_mvo["receiver"])
+                  ("recv_sequence", 0);
+            }
+            restructured_act_traces.push_back( std::move(act_trace_mvo) );
+         }
+         return restructured_act_traces;
+      };
+
+      fc::mutable_variant_object output_mvo(output);
+      output_mvo["action_traces"] = convert_act_trace_to_tree_struct(0);
+
+      output = output_mvo;
+   } catch( chain::abi_exception& ) {
+      output = *trx_trace_ptr;
+   }
+   return output;
+}
+
 void read_write::push_transaction(const read_write::push_transaction_params& params, next_function<read_write::push_transaction_results> next) {
    try {
       auto pretty_input = std::make_shared<packed_transaction>();
@@ -1903,9 +2442,14 @@ void read_write::push_transaction(const read_write::push_transaction_params& par
       transaction_metadata_ptr ptrx;
       try {
          abi_serializer::from_variant(params, *pretty_input, resolver, abi_serializer_max_time);
-         ptrx = std::make_shared<transaction_metadata>( pretty_input );
       } ROXE_RETHROW_EXCEPTIONS(chain::packed_transaction_type_exception, "Invalid packed transaction")
 
+      if( auto except = app().get_plugin<chain_plugin>().prefilter_transaction( *pretty_input ) ) {
+         next( except );
+         return;
+      }
+      ptrx = std::make_shared<transaction_metadata>( pretty_input );
+
       app().get_method<incoming::methods::transaction_async>()(ptrx, true, [this, next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result) -> void{
          if (result.contains<fc::exception_ptr>()) {
             next(result.get<fc::exception_ptr>());
@@ -1913,62 +2457,7 @@ void read_write::push_transaction(const read_write::push_transaction_params& par
             auto trx_trace_ptr = result.get<transaction_trace_ptr>();
 
             try {
-               fc::variant output;
-               try {
-                  output = db.to_variant_with_abi( *trx_trace_ptr, abi_serializer_max_time );
-
-                  // Create map of (closest_unnotified_ancestor_action_ordinal, global_sequence) with action trace
-                  std::map< std::pair<uint32_t, uint64_t>, fc::mutable_variant_object > act_traces_map;
-                  for( const auto& act_trace : output["action_traces"].get_array() ) {
-                     if (act_trace["receipt"].is_null() && act_trace["except"].is_null()) continue;
-                     auto closest_unnotified_ancestor_action_ordinal =
-                           act_trace["closest_unnotified_ancestor_action_ordinal"].as<fc::unsigned_int>().value;
-                     auto global_sequence = act_trace["receipt"].is_null() ?
-                                                std::numeric_limits<uint64_t>::max() :
-                                                act_trace["receipt"]["global_sequence"].as<uint64_t>();
-                     act_traces_map.emplace( std::make_pair( closest_unnotified_ancestor_action_ordinal,
-                                                             global_sequence ),
-                                             act_trace.get_object() );
-                  }
-
-                  std::function<vector<fc::variant>(uint32_t)> convert_act_trace_to_tree_struct =
-                  [&](uint32_t closest_unnotified_ancestor_action_ordinal) {
-                     vector<fc::variant> restructured_act_traces;
-                     auto it = act_traces_map.lower_bound(
-                                 std::make_pair( closest_unnotified_ancestor_action_ordinal, 0)
-                     );
-                     for( ;
-                        it != act_traces_map.end() && it->first.first == closest_unnotified_ancestor_action_ordinal; ++it )
-                     {
-                        auto& act_trace_mvo = it->second;
-
-                        auto action_ordinal = act_trace_mvo["action_ordinal"].as<fc::unsigned_int>().value;
-                        act_trace_mvo["inline_traces"] = convert_act_trace_to_tree_struct(action_ordinal);
-                        if (act_trace_mvo["receipt"].is_null()) {
-                           act_trace_mvo["receipt"] = fc::mutable_variant_object()
-                              ("abi_sequence", 0)
-                              ("act_digest", digest_type::hash(trx_trace_ptr->action_traces[action_ordinal-1].act))
-                              ("auth_sequence", flat_map<account_name,uint64_t>())
-                              ("code_sequence", 0)
-                              ("global_sequence", 0)
-                              ("receiver", act_trace_mvo["receiver"])
-                              ("recv_sequence", 0);
-                        }
-                        restructured_act_traces.push_back( std::move(act_trace_mvo) );
-                     }
-                     return restructured_act_traces;
-                  };
-
-                  fc::mutable_variant_object output_mvo(output);
-                  output_mvo["action_traces"] = convert_act_trace_to_tree_struct(0);
-
-                  output = output_mvo;
-               } catch( chain::abi_exception& ) {
-                  output = *trx_trace_ptr;
-               }
-
-               const chain::transaction_id_type& id = trx_trace_ptr->id;
-               next(read_write::push_transaction_results{id, output});
+               next(read_write::push_transaction_results{trx_trace_ptr->id, push_transaction_output(trx_trace_ptr)});
             } CATCH_AND_CALL(next);
          }
       });
@@ -1979,35 +2468,208 @@ void read_write::push_transaction(const read_write::push_transaction_params& par
    } CATCH_AND_CALL(next);
 }
 
-static void push_recurse(read_write* rw, int index, const std::shared_ptr<read_write::push_transactions_params>& params, const std::shared_ptr<read_write::push_transactions_results>& results, const next_function<read_write::push_transactions_results>& next) {
-   auto wrapped_next = [=](const fc::static_variant<fc::exception_ptr, read_write::push_transaction_results>& result) {
-      if (result.contains<fc::exception_ptr>()) {
-         const auto& e = result.get<fc::exception_ptr>();
-         results->emplace_back( read_write::push_transaction_results{ transaction_id_type(), fc::mutable_variant_object( "error", e->to_detail_string() ) } );
-      } else {
-         const auto& r = result.get<read_write::push_transaction_results>();
-         results->emplace_back( r );
+namespace {
+   /// a push_transactions call, shared by the tasks decoding its transactions on the thread pool
+   struct push_transactions_batch {
+      read_write::push_transactions_params                  params;
+      std::map<account_name, optional<abi_serializer>>      abis;     ///< of the accounts of all actions, resolved up front
+      vector<transaction_metadata_ptr>                      trxs;     ///< null where the transaction is answered already
+      read_write::push_transactions_results                 results;
+      std::atomic<size_t>                                   decoding{0};
+      size_t                                                unanswered = 0;
+      next_function<read_write::push_transactions_results>  next;
+
+      void answer( size_t i, read_write::push_transaction_results&& r ) {
+         results[i] = std::move( r );
+         answered();
+      }
+      void answered() {
+         if( --unanswered == 0 )
+            next( results );
       }
 
-      size_t next_index = index + 1;
-      if (next_index < params->size()) {
-         push_recurse(rw, next_index, params, results, next );
-      } else {
-         next(*results);
+      static read_write::push_transaction_results error_result( const fc::exception_ptr& e ) {
+         return read_write::push_transaction_results{ transaction_id_type(), fc::mutable_variant_object( "error", e->to_detail_string() ) };
       }
    };
 
-   rw->push_transaction(params->at(index), wrapped_next);
+   /// adds the accounts of the actions in a transaction given as variant to accounts
+   void collect_action_accounts( const fc::variant_object& trx, std::set<account_name>& accounts ) {
+      for( const char* key : { "context_free_actions", "actions" } ) {
+         auto itr = trx.find( key );
+         if( itr == trx.end() || !itr->value().is_array() )
+            continue;
+         for( const auto& act : itr->value().get_array() ) {
+            if( act.is_object() && act.get_object().contains( "account" ) )
+               accounts.insert( act["account"].as<account_name>() );
+         }
+      }
+   }
 }
 
 void read_write::push_transactions(const read_write::push_transactions_params& params, next_function<read_write::push_transactions_results> next) {
    try {
       ROXE_ASSERT( params.size() <= 1000, too_many_tx_at_once, "Attempt to push too many transactions at once" );
-      auto params_copy = std::make_shared<read_write::push_transactions_params>(params.begin(), params.end());
-      auto result = std::make_shared<read_write::push_transactions_results>();
-      result->reserve(params.size());
+      if( params.empty() ) {
+         next( read_write::push_transactions_results() );
+         return;
+      }
+      auto batch = std::make_shared<push_transactions_batch>();
+      batch->params = params;
+      batch->trxs.resize( params.size() );
+      batch->results.resize( params.size() );
+      batch->unanswered = params.size();
+      batch->next = next;
+
+      // ABIs come from the chain state, which only the main thread may read while the transactions are decoded
+      auto resolver = make_resolver(this, abi_serializer_max_time);
+      vector<bool> resolved( params.size(), true );
+      for( size_t i = 0; i < params.size(); ++i ) {
+         auto fail = [&]( const fc::exception_ptr& e ) {
+            resolved[i] = false;
+            batch->results[i] = push_transactions_batch::error_result( e );
+         };
+         try {
+            std::set<account_name> accounts;
+            collect_action_accounts( params[i], accounts );
+            for( const auto& a : accounts ) {
+               if( !batch->abis.count( a ) )
+                  batch->abis.emplace( a, resolver( a ) );
+            }
+         } CATCH_AND_CALL(fail);
+      }
+      batch->decoding = std::count( resolved.begin(), resolved.end(), true );
+      if( batch->decoding == 0 ) {
+         next( batch->results );
+         return;
+      }
 
-      push_recurse(this, 0, params_copy, result, next);
+      auto& plugin = app().get_plugin<chain_plugin>();
+      const auto max_time = abi_serializer_max_time;
+      for( size_t i = 0; i < params.size(); ++i ) {
+         if( !resolved[i] )
+            continue;
+         boost::asio::post( db.get_thread_pool(), [this, batch, i, &plugin, max_time]() {
+            auto batch_resolver = [&batch = *batch]( const account_name& n ) -> optional<abi_serializer> {
+               auto itr = batch.abis.find( n );
+               return itr != batch.abis.end() ? itr->second : optional<abi_serializer>();
+            };
+            auto fail = [&batch = *batch, i]( const fc::exception_ptr& e ) {
+               batch.results[i] = push_transactions_batch::error_result( e );
+            };
+            try {
+               auto pretty_input = std::make_shared<packed_transaction>();
+               try {
+                  abi_serializer::from_variant( batch->params[i], *pretty_input, batch_resolver, max_time );
+               } ROXE_RETHROW_EXCEPTIONS(chain::packed_transaction_type_exception, "Invalid packed transaction")
+               if( auto except = plugin.prefilter_transaction( *pretty_input ) )
+                  fail( except );
+               else
+                  batch->trxs[i] = std::make_shared<transaction_metadata>( pretty_input );
+            } CATCH_AND_CALL(fail);
+            if( --batch->decoding != 0 )
+               return;
+
+            // the last decoded transaction hands the batch to the producer in a single call
+            app().post( priority::low, [this, batch]() {
+               vector<transaction_metadata_ptr> trxs;
+               vector<next_function<transaction_trace_ptr>> nexts;
+               for( size_t i = 0; i < batch->trxs.size(); ++i ) {
+                  if( !batch->trxs[i] ) { // failed to decode, its result is set already
+                     batch->answered();
+                     continue;
+                  }
+                  trxs.emplace_back( std::move( batch->trxs[i] ) );
+                  nexts.emplace_back( [this, batch, i]( const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result ) {
+                     if( result.contains<fc::exception_ptr>() ) {
+                        batch->answer( i, push_transactions_batch::error_result( result.get<fc::exception_ptr>() ) );
+                        return;
+                     }
+                     const auto& trx_trace_ptr = result.get<transaction_trace_ptr>();
+                     auto fail = [&]( const fc::exception_ptr& e ) { batch->answer( i, push_transactions_batch::error_result( e ) ); };
+                     try {
+                        batch->answer( i, read_write::push_transaction_results{trx_trace_ptr->id, push_transaction_output( trx_trace_ptr )} );
+                     } CATCH_AND_CALL(fail);
+                  } );
+               }
+               if( trxs.empty() )
+                  return;
+               auto fail = [&nexts]( const fc::exception_ptr& e ) {
+                  for( const auto& n : nexts )
+                     n( e );
+               };
+               try {
+                  app().get_method<incoming::methods::transactions_async>()( trxs, true, nexts );
+               } CATCH_AND_CALL(fail);
+            } );
+         } );
+      }
+   } catch ( boost::interprocess::bad_alloc& ) {
+      chain_plugin::handle_db_exhaustion();
+   } catch ( const std::bad_alloc& ) {
+      chain_plugin::handle_bad_alloc();
+   } CATCH_AND_CALL(next);
+}
+
+void read_write::push_packed_transactions(read_write::push_packed_transactions_params&& params,
+                                          next_function<read_write::push_packed_transactions_results> next) {
+   try {
+      ROXE_ASSERT( params.size() <= max_packed_transactions, too_many_tx_at_once, "Attempt to push too many transactions at once" );
+      struct packed_batch {
+         read_write::push_packed_transactions_results                 results;
+         size_t                                                       unanswered = 0;
+         next_function<read_write::push_packed_transactions_results>  next;
+
+         void answer( size_t i, optional<string> error ) {
+            results[i].error = std::move( error );
+            if( --unanswered == 0 )
+               next( results );
+         }
+      };
+      auto batch = std::make_shared<packed_batch>();
+      batch->results.resize( params.size() );
+      batch->unanswered = params.size();
+      batch->next = next;
+      if( params.empty() ) {
+         batch->next( batch->results );
+         return;
+      }
+
+      auto& plugin = app().get_plugin<chain_plugin>();
+      vector<transaction_metadata_ptr> trxs;
+      vector<next_function<transaction_trace_ptr>> nexts;
+      trxs.reserve( params.size() );
+      nexts.reserve( params.size() );
+      for( size_t i = 0; i < params.size(); ++i ) {
+         auto fail = [&batch, i]( const fc::exception_ptr& e ) { batch->answer( i, e->to_detail_string() ); };
+         try {
+            auto ptrx = std::make_shared<packed_transaction>( std::move( params[i] ) );
+            batch->results[i].transaction_id = ptrx->id();
+            if( auto except = plugin.prefilter_transaction( *ptrx ) ) {
+               fail( except );
+               continue;
+            }
+            auto trx = std::make_shared<transaction_metadata>( std::move( ptrx ) );
+            nexts.emplace_back( [batch, i]( const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result ) {
+               if( result.contains<fc::exception_ptr>() ) {
+                  batch->answer( i, result.get<fc::exception_ptr>()->to_detail_string() );
+                  return;
+               }
+               const auto& trace = result.get<transaction_trace_ptr>();
+               batch->answer( i, trace->except ? trace->except->to_detail_string() : optional<string>() );
+            } );
+            trxs.emplace_back( std::move( trx ) );
+         } CATCH_AND_CALL(fail);
+      }
+      if( trxs.empty() )
+         return;
+      auto fail = [&nexts]( const fc::exception_ptr& e ) {
+         for( const auto& n : nexts )
+            n( e );
+      };
+      try {
+         app().get_method<incoming::methods::transactions_async>()( trxs, true, nexts );
+      } CATCH_AND_CALL(fail);
    } catch ( boost::interprocess::bad_alloc& ) {
       chain_plugin::handle_db_exhaustion();
    } catch ( const std::bad_alloc& ) {
@@ -2023,9 +2685,14 @@ void read_write::send_transaction(const read_write::send_transaction_params& par
       transaction_metadata_ptr ptrx;
       try {
          abi_serializer::from_variant(params, *pretty_input, resolver, abi_serializer_max_time);
-         ptrx = std::make_shared<transaction_metadata>( pretty_input );
       } ROXE_RETHROW_EXCEPTIONS(chain::packed_transaction_type_exception, "Invalid packed transaction")
 
+      if( auto except = app().get_plugin<chain_plugin>().prefilter_transaction( *pretty_input ) ) {
+         next( except );
+         return;
+      }
+      ptrx = std::make_shared<transaction_metadata>( pretty_input );
+
       app().get_method<incoming::methods::transaction_async>()(ptrx, true, [this, next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result) -> void{
          if (result.contains<fc::exception_ptr>()) {
             next(result.get<fc::exception_ptr>());
@@ -2052,6 +2719,43 @@ void read_write::send_transaction(const read_write::send_transaction_params& par
    } CATCH_AND_CALL(next);
 }
 
+void read_write::dry_run_transaction(const read_write::dry_run_transaction_params& params, next_function<read_write::dry_run_transaction_results> next) {
+   try {
+      auto pretty_input = std::make_shared<packed_transaction>();
+      auto resolver = make_resolver(this, abi_serializer_max_time);
+      transaction_metadata_ptr ptrx;
+      try {
+         abi_serializer::from_variant(params, *pretty_input, resolver, abi_serializer_max_time);
+         ptrx = std::make_shared<transaction_metadata>( pretty_input );
+         ptrx->dry_run = true;
+      } ROXE_RETHROW_EXCEPTIONS(chain::packed_transaction_type_exception, "Invalid packed transaction")
+
+      const fc::microseconds max_trx_time( db.get_global_properties().configuration.max_transaction_cpu_usage );
+      transaction_metadata::start_recover_keys( ptrx, db.get_thread_pool(), db.get_chain_id(), max_trx_time,
+                                                [this, ptrx, max_trx_time, next]() {
+         app().post( priority::low, [this, ptrx, max_trx_time, next]() {
+            try {
+               ROXE_ASSERT( db.is_building_block(), missing_pending_block_state, "no pending block to run the transaction against" );
+               auto trx_trace_ptr = db.push_transaction( ptrx, fc::time_point::now() + max_trx_time );
+
+               fc::variant output;
+               try {
+                  output = db.to_variant_with_abi( *trx_trace_ptr, abi_serializer_max_time );
+               } catch( chain::abi_exception& ) {
+                  output = *trx_trace_ptr;
+               }
+
+               next(read_write::dry_run_transaction_results{trx_trace_ptr->id, output});
+            } CATCH_AND_CALL(next);
+         });
+      });
+   } catch ( boost::interprocess::bad_alloc& ) {
+      chain_plugin::handle_db_exhaustion();
+   } catch ( const std::bad_alloc& ) {
+      chain_plugin::handle_bad_alloc();
+   } CATCH_AND_CALL(next);
+}
+
 read_only::get_abi_results read_only::get_abi( const get_abi_params& params )const {
    get_abi_results result;
    result.account_name = params.account_name;
@@ -2178,9 +2882,9 @@ read_only::get_account_results read_only::get_account( const get_account_params&
 
    const auto& code_account = db.db().get<account_object,by_name>( config::system_account_name );
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( !abi_serializer::is_empty_abi(code_account.abi) ) {
+      const auto cached = get_cached_abi( config::system_account_name );
+      const abi_serializer& abis = cached->serializer;
 
       const auto token_code = N(roxe.token);
 
@@ -2251,6 +2955,13 @@ read_only::get_account_results read_only::get_account( const get_account_params&
    return result;
 }
 
+read_only::get_key_accounts_results read_only::get_key_accounts( const get_key_accounts_params& params )const {
+   ROXE_ASSERT( key_index, plugin_config_exception, "key-account-index is not enabled" );
+   get_key_accounts_results result;
+   result.account_names = key_index->lookup( db.db(), params.public_key );
+   return result;
+}
+
 static variant action_abi_to_variant( const abi_def& abi, type_name action_type ) {
    variant v;
    auto it = std::find_if(abi.structs.begin(), abi.structs.end(), [&](auto& x){return x.name == action_type;});
@@ -2264,9 +2975,10 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    ROXE_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( !abi_serializer::is_empty_abi(code_account->abi) ) {
+      const auto cached = get_cached_abi( params.code );
+      const abi_def& abi = cached->abi;
+      const abi_serializer& abis = cached->serializer;
       auto action_type = abis.get_action_type(params.action);
       ROXE_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
       try {
@@ -2284,9 +2996,9 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
    abi_bin_to_json_result result;
    const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( !abi_serializer::is_empty_abi(code_account.abi) ) {
+      const auto cached = get_cached_abi( params.code );
+      const abi_serializer& abis = cached->serializer;
       result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
    } else {
       ROXE_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
@@ -11,14 +11,18 @@
 #include <roxe/chain/controller.hpp>
 #include <roxe/chain/contract_table_objects.hpp>
 #include <roxe/chain/resource_limits.hpp>
+#include <roxe/chain/startup_profile.hpp>
 #include <roxe/chain/transaction.hpp>
 #include <roxe/chain/abi_serializer.hpp>
+#include <roxe/chain/abi_serializer_cache.hpp>
+#include <roxe/chain/key_account_index.hpp>
 #include <roxe/chain/plugin_interface.hpp>
 #include <roxe/chain/types.hpp>
 
 #include <boost/container/flat_set.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
 
+#include <fc/scoped_exit.hpp>
 #include <fc/static_variant.hpp>
 
 namespace fc { class variant; }
@@ -72,16 +76,35 @@ double convert_to_type(const string& str, const string& desc);
 class read_only {
    const controller& db;
    const fc::microseconds abi_serializer_max_time;
+   chain::abi_serializer_cache* abi_cache = nullptr;
+   const chain::key_account_index* key_index = nullptr;
    bool  shorten_abi_errors = true;
 
+   /// @return the ABI of account with its serializer, from the cache if there is one; asserts the account exists
+   chain::abi_serializer_cache::cached_abi_ptr get_cached_abi( const name& account )const;
+
 public:
    static const string KEYi64;
 
-   read_only(const controller& db, const fc::microseconds& abi_serializer_max_time)
-      : db(db), abi_serializer_max_time(abi_serializer_max_time) {}
+   read_only(const controller& db, const fc::microseconds& abi_serializer_max_time, chain::abi_serializer_cache* abi_cache = nullptr,
+             const chain::key_account_index* key_index = nullptr)
+      : db(db), abi_serializer_max_time(abi_serializer_max_time), abi_cache(abi_cache), key_index(key_index) {}
 
    void validate() const {}
 
+   /**
+    * Runs the query f. In a state replica f holds the published state shared, so that the node publishing it does not
+    * change the state under f.
+    */
+   template<typename F>
+   auto read_state( F&& f )const -> decltype( f() ) {
+      if( !db.is_state_replica() )
+         return f();
+      db.begin_replica_read();
+      auto end = fc::make_scoped_exit( [this]() { db.end_replica_read(); } );
+      return f();
+   }
+
    void set_shorten_abi_errors( bool f ) { shorten_abi_errors = f; }
 
    using get_info_params = empty;
@@ -109,6 +132,21 @@ public:
    };
    get_info_results get_info(const get_info_params&) const;
 
+   using get_startup_report_params = empty;
+
+   struct startup_plugin_timing {
+      string           name;
+      fc::microseconds initialize;  ///< its plugin_initialize alone, not those of its dependencies
+      fc::microseconds startup;
+   };
+
+   struct get_startup_report_results {
+      fc::microseconds                  total;    ///< from the process starting until its main loop ran, 0 while starting
+      vector<startup_plugin_timing>     plugins;  ///< in the order they were initialized
+      vector<chain::startup_phase>      phases;   ///< ordered by start, a phase before those within it
+   };
+   get_startup_report_results get_startup_report(const get_startup_report_params&) const;
+
    struct get_activated_protocol_features_params {
       optional<uint32_t>  lower_bound;
       optional<uint32_t>  upper_bound;
@@ -163,6 +201,15 @@ public:
    };
    get_account_results get_account( const get_account_params& params )const;
 
+   struct get_key_accounts_params {
+      public_key_type  public_key;
+   };
+   struct get_key_accounts_results {
+      vector<name>     account_names;
+   };
+   /// the accounts with a permission holding the key, from the index kept when key-account-index is enabled
+   get_key_accounts_results get_key_accounts( const get_key_accounts_params& params )const;
+
 
    struct get_code_results {
       name                   account_name;
@@ -271,6 +318,26 @@ public:
 
    fc::variant get_block(const get_block_params& params) const;
 
+   static const uint32_t max_raw_blocks = 1000;
+
+   struct get_raw_block_params {
+      string   block_num_or_id;
+      uint32_t count = 1; ///< number of consecutive blocks starting at block_num_or_id, at most max_raw_blocks
+   };
+
+   struct raw_block {
+      uint32_t             block_num = 0;
+      chain::block_id_type id;
+      vector<char>         block; ///< the packed signed_block
+   };
+
+   struct get_raw_block_results {
+      vector<raw_block> blocks;
+   };
+
+   /// returns the blocks as stored, irreversible ones straight from the block log without unpacking them
+   get_raw_block_results get_raw_block(const get_raw_block_params& params) const;
+
    struct get_block_header_state_params {
       string block_num_or_id;
    };
@@ -291,14 +358,25 @@ public:
       string      encode_type{"dec"}; //dec, hex , default=dec
       optional<bool>  reverse;
       optional<bool>  show_payer; // show RAM pyer
+      optional<bool>  keys_only; // rows are the primary keys, neither copied nor decoded
+      optional<bool>  count_only; // no rows, only the count of the rows in range, limit is ignored
+      optional<uint32_t> time_limit_ms; // time budget of the walk, at most max_table_query_time_ms
     };
 
    struct get_table_rows_result {
       vector<fc::variant> rows; ///< one row per item, either encoded as hex String or JSON object
       bool                more = false; ///< true if last element in data is not the end and sizeof data() < limit
+      optional<string>    next_key; ///< when more, fill lower_bound (upper_bound if reverse) with this value to continue
+      optional<uint32_t>  count; ///< the rows walked, for count_only
    };
 
+   /// the default and the maximum time budget of get_table_rows and get_table_by_scope
+   static constexpr uint32_t default_table_query_time_ms = 10;
+   static constexpr uint32_t max_table_query_time_ms = 100;
+
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
+   /// @return the JSON text of get_table_rows( params ), rows being written without building their variants
+   string get_table_rows_json( const get_table_rows_params& params )const;
 
    struct get_table_by_scope_params {
       name        code; // mandatory
@@ -307,6 +385,8 @@ public:
       string      upper_bound; // upper bound of scope, optional
       uint32_t    limit = 10;
       optional<bool>  reverse;
+      optional<bool>  count_only; // no rows, only the count of the tables in range, limit is ignored
+      optional<uint32_t> time_limit_ms; // time budget of the walk, at most max_table_query_time_ms
    };
    struct get_table_by_scope_result_row {
       name        code;
@@ -318,6 +398,7 @@ public:
    struct get_table_by_scope_result {
       vector<get_table_by_scope_result_row> rows;
       string      more; ///< fill lower_bound with this value to fetch more rows
+      optional<uint32_t> count; ///< the tables walked, for count_only
    };
 
    get_table_by_scope_result get_table_by_scope( const get_table_by_scope_params& params )const;
@@ -408,15 +489,65 @@ public:
 
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
-   template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
-      read_only::get_table_rows_result result;
+   /// what the walk of get_table_rows passes to its sink for every row, decided before a row is copied
+   enum class table_rows_response { rows, keys, count };
+   static table_rows_response get_table_rows_response( const get_table_rows_params& p );
+   /// only json rows are decoded, the ABI is not even loaded for anything else
+   static bool table_rows_decoded( const get_table_rows_params& p ) {
+      return p.json && get_table_rows_response( p ) == table_rows_response::rows;
+   }
+   static fc::microseconds get_table_query_time( const optional<uint32_t>& time_limit_ms );
+
+   /// receives the rows found by get_table_rows_ex and get_table_rows_by_seckey into a get_table_rows_result
+   struct table_rows_collector {
+      /// abis is null unless table_rows_decoded( p )
+      table_rows_collector( const get_table_rows_params& p, const abi_serializer* abis, const fc::microseconds& max_time, bool short_path );
+
+      void row( const vector<char>& data, account_name payer );
+      void key( uint64_t primary_key, account_name payer );
+      void set_count( uint32_t count ) { result.count = count; }
+      void set_more( optional<string> next_key ) { result.more = true; result.next_key = std::move( next_key ); }
+
+      const get_table_rows_params&  p;
+      const abi_serializer*         abis;
+      const chain::type_name        table_type;
+      const fc::microseconds        max_time;
+      const bool                    short_path;
+      get_table_rows_result         result;
+   };
+
+   /// writes the rows found by get_table_rows_ex and get_table_rows_by_seckey as the elements of a JSON array
+   struct table_rows_json_writer {
+      /// abis is null unless table_rows_decoded( p )
+      table_rows_json_writer( const get_table_rows_params& p, const abi_serializer* abis, const fc::microseconds& max_time, bool short_path,
+                              fc::json_writer& writer );
+
+      void row( const vector<char>& data, account_name payer );
+      void key( uint64_t primary_key, account_name payer );
+      void set_count( uint32_t c ) { count = c; }
+      void set_more( optional<string> k ) { more = true; next_key = std::move( k ); }
+
+      const get_table_rows_params&  p;
+      const abi_serializer*         abis;
+      const chain::type_name        table_type;
+      const fc::microseconds        max_time;
+      const bool                    short_path;
+      fc::json_writer&              writer;
+      bool                          more = false;
+      optional<string>              next_key;
+      optional<uint32_t>            count;
+   };
+
+   /// finds the rows requested by p in the index it names and passes them to sink, abi is null unless table_rows_decoded( p )
+   template<typename RowSink>
+   void walk_table_rows( const get_table_rows_params& p, const abi_def* abi, RowSink& sink )const;
+
+   template <typename IndexType, typename SecKeyType, typename RowSink, typename ConvFn>
+   void get_table_rows_by_seckey( const read_only::get_table_rows_params& p, RowSink& sink, ConvFn conv )const {
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -456,34 +587,37 @@ public:
          }
 
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
-            return result;
+            return;
 
+         const auto response = get_table_rows_response( p );
+         const uint32_t limit = response == table_rows_response::count ? std::numeric_limits<uint32_t>::max() : p.limit;
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
-            auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
+            auto end_time = cur_time + get_table_query_time( p.time_limit_ms );
             vector<char> data;
-            for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
-               const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple(t_id->id, itr->primary_key) );
-               if( itr2 == nullptr ) continue;
-               copy_inline_row(*itr2, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
+            uint32_t count = 0;
+            for( ; cur_time <= end_time && count < limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
+               if( response == table_rows_response::rows ) {
+                  const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary_hash>( boost::make_tuple(t_id->id, itr->primary_key) );
+                  if( itr2 == nullptr ) continue;
+                  copy_inline_row(*itr2, data);
+                  sink.row( data, itr->payer );
+               } else if( response == table_rows_response::keys ) {
+                  sink.key( itr->primary_key, itr->payer );
                }
 
                ++count;
             }
+            if( response == table_rows_response::count ) {
+               sink.set_count( count );
+            }
             if( itr != end_itr ) {
-               result.more = true;
+               optional<string> next_key;
+               // only the integer secondary keys round trip through lower_bound
+               if constexpr( std::is_same<secondary_key_type, uint64_t>::value ) {
+                  next_key = p.key_type == "name" ? name( itr->secondary_key ).to_string() : std::to_string( itr->secondary_key );
+               }
+               sink.set_more( std::move( next_key ) );
             }
          };
 
@@ -495,18 +629,14 @@ public:
             walk_table_row_range( lower, upper );
          }
       }
-      return result;
    }
 
-   template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
-      read_only::get_table_rows_result result;
+   template <typename IndexType, typename RowSink>
+   void get_table_rows_ex( const read_only::get_table_rows_params& p, RowSink& sink )const {
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
       if( t_id != nullptr ) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -534,30 +664,28 @@ public:
          }
 
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple  )
-            return result;
+            return;
 
+         const auto response = get_table_rows_response( p );
+         const uint32_t limit = response == table_rows_response::count ? std::numeric_limits<uint32_t>::max() : p.limit;
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
-            auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
+            auto end_time = cur_time + get_table_query_time( p.time_limit_ms );
             vector<char> data;
-            for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++count, ++itr, cur_time = fc::time_point::now() ) {
-               copy_inline_row(*itr, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
+            uint32_t count = 0;
+            for( ; cur_time <= end_time && count < limit && itr != end_itr; ++count, ++itr, cur_time = fc::time_point::now() ) {
+               if( response == table_rows_response::rows ) {
+                  copy_inline_row(*itr, data);
+                  sink.row( data, itr->payer );
+               } else if( response == table_rows_response::keys ) {
+                  sink.key( itr->primary_key, itr->payer );
                }
             }
+            if( response == table_rows_response::count ) {
+               sink.set_count( count );
+            }
             if( itr != end_itr ) {
-               result.more = true;
+               sink.set_more( p.key_type == "name" ? name( itr->primary_key ).to_string() : std::to_string( itr->primary_key ) );
             }
          };
 
@@ -569,7 +697,6 @@ public:
             walk_table_row_range( lower, upper );
          }
       }
-      return result;
    }
 
    chain::symbol extract_core_symbol()const;
@@ -580,8 +707,12 @@ public:
 class read_write {
    controller& db;
    const fc::microseconds abi_serializer_max_time;
+   chain::abi_serializer_cache* abi_cache = nullptr;
+
+   /// @return the trace of a pushed transaction as variant, with the action traces nested in their parents
+   fc::variant push_transaction_output( const chain::transaction_trace_ptr& trx_trace_ptr )const;
 public:
-   read_write(controller& db, const fc::microseconds& abi_serializer_max_time);
+   read_write(controller& db, const fc::microseconds& abi_serializer_max_time, chain::abi_serializer_cache* abi_cache = nullptr);
    void validate() const;
 
    using push_block_params = chain::signed_block;
@@ -600,10 +731,28 @@ public:
    using push_transactions_results = vector<push_transaction_results>;
    void push_transactions(const push_transactions_params& params, chain::plugin_interface::next_function<push_transactions_results> next);
 
+   /**
+    * Pushes transactions which are packed and signed already, without converting them through the ABIs. Only the id
+    * and, when it failed, the error of each transaction are answered, in the order of params.
+    */
+   using push_packed_transactions_params = vector<chain::packed_transaction>;
+   struct push_packed_transaction_result {
+      chain::transaction_id_type  transaction_id;
+      optional<string>            error;
+   };
+   using push_packed_transactions_results = vector<push_packed_transaction_result>;
+   static constexpr size_t max_packed_transactions = 10000;
+   void push_packed_transactions(push_packed_transactions_params&& params, chain::plugin_interface::next_function<push_packed_transactions_results> next);
+
    using send_transaction_params = push_transaction_params;
    using send_transaction_results = push_transaction_results;
    void send_transaction(const send_transaction_params& params, chain::plugin_interface::next_function<send_transaction_results> next);
 
+   /// executes the transaction on top of the pending block and discards all of its effects, returning the trace
+   using dry_run_transaction_params = push_transaction_params;
+   using dry_run_transaction_results = push_transaction_results;
+   void dry_run_transaction(const dry_run_transaction_params& params, chain::plugin_interface::next_function<dry_run_transaction_results> next);
+
    friend resolver_factory<read_write>;
 };
 
@@ -683,8 +832,10 @@ public:
    void plugin_startup();
    void plugin_shutdown();
 
-   chain_apis::read_only get_read_only_api() const { return chain_apis::read_only(chain(), get_abi_serializer_max_time()); }
-   chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time()); }
+   chain_apis::read_only get_read_only_api() const {
+      return chain_apis::read_only(chain(), get_abi_serializer_max_time(), get_abi_serializer_cache(), get_key_account_index());
+   }
+   chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time(), get_abi_serializer_cache()); }
 
    void accept_block( const chain::signed_block_ptr& block );
    void accept_transaction(const chain::packed_transaction& trx, chain::plugin_interface::next_function<chain::transaction_trace_ptr> next);
@@ -692,14 +843,20 @@ public:
 
    bool block_is_on_preferred_chain(const chain::block_id_type& block_id);
 
+   /**
+    * Cheap checks of the header of an incoming transaction, meant to drop hopeless ones at the network and HTTP
+    * ingress before their keys are recovered and they reach the main thread. Safe to call from any thread.
+    *
+    * @return the reason the transaction can never be applied, or null if it may be
+    */
+   fc::exception_ptr prefilter_transaction( const chain::packed_transaction& trx )const;
+
    static bool recover_reversible_blocks( const fc::path& db_dir,
-                                          uint32_t cache_size,
                                           optional<fc::path> new_db_dir = optional<fc::path>(),
                                           uint32_t truncate_at_block = 0
                                         );
 
    static bool import_reversible_blocks( const fc::path& reversible_dir,
-                                         uint32_t cache_size,
                                          const fc::path& reversible_blocks_file
                                        );
 
@@ -715,6 +872,11 @@ public:
    chain::chain_id_type get_chain_id() const;
    fc::microseconds get_abi_serializer_max_time() const;
 
+   /// serializers of the contracts' ABIs for the API plugins, kept current with setabi; null if disabled
+   chain::abi_serializer_cache* get_abi_serializer_cache() const;
+   /// the accounts of each public key, kept current with newaccount, updateauth and deleteauth; null if disabled
+   const chain::key_account_index* get_key_account_index() const;
+
    static void handle_guard_exception(const chain::guard_exception& e);
    static void handle_db_exhaustion();
    static void handle_bad_alloc();
@@ -730,19 +892,25 @@ FC_REFLECT( roxe::chain_apis::permission, (perm_name)(parent)(required_auth) )
 FC_REFLECT(roxe::chain_apis::empty, )
 FC_REFLECT(roxe::chain_apis::read_only::get_info_results,
 (server_version)(chain_id)(head_block_num)(last_irreversible_block_num)(last_irreversible_block_id)(head_block_id)(head_block_time)(head_block_producer)(virtual_block_cpu_limit)(virtual_block_net_limit)(block_cpu_limit)(block_net_limit)(server_version_string)(fork_db_head_block_num)(fork_db_head_block_id) )
+FC_REFLECT(roxe::chain_apis::read_only::startup_plugin_timing, (name)(initialize)(startup) )
+FC_REFLECT(roxe::chain_apis::read_only::get_startup_report_results, (total)(plugins)(phases) )
 FC_REFLECT(roxe::chain_apis::read_only::get_activated_protocol_features_params, (lower_bound)(upper_bound)(limit)(search_by_block_num)(reverse) )
 FC_REFLECT(roxe::chain_apis::read_only::get_activated_protocol_features_results, (activated_protocol_features)(more) )
 FC_REFLECT(roxe::chain_apis::read_only::get_block_params, (block_num_or_id))
+FC_REFLECT(roxe::chain_apis::read_only::get_raw_block_params, (block_num_or_id)(count))
+FC_REFLECT(roxe::chain_apis::read_only::raw_block, (block_num)(id)(block))
+FC_REFLECT(roxe::chain_apis::read_only::get_raw_block_results, (blocks))
 FC_REFLECT(roxe::chain_apis::read_only::get_block_header_state_params, (block_num_or_id))
 
 FC_REFLECT( roxe::chain_apis::read_write::push_transaction_results, (transaction_id)(processed) )
+FC_REFLECT( roxe::chain_apis::read_write::push_packed_transaction_result, (transaction_id)(error) )
 
-FC_REFLECT( roxe::chain_apis::read_only::get_table_rows_params, (json)(code)(scope)(table)(table_key)(lower_bound)(upper_bound)(limit)(key_type)(index_position)(encode_type)(reverse)(show_payer) )
-FC_REFLECT( roxe::chain_apis::read_only::get_table_rows_result, (rows)(more) );
+FC_REFLECT( roxe::chain_apis::read_only::get_table_rows_params, (json)(code)(scope)(table)(table_key)(lower_bound)(upper_bound)(limit)(key_type)(index_position)(encode_type)(reverse)(show_payer)(keys_only)(count_only)(time_limit_ms) )
+FC_REFLECT( roxe::chain_apis::read_only::get_table_rows_result, (rows)(more)(next_key)(count) );
 
-FC_REFLECT( roxe::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse) )
+FC_REFLECT( roxe::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse)(count_only)(time_limit_ms) )
 FC_REFLECT( roxe::chain_apis::read_only::get_table_by_scope_result_row, (code)(scope)(table)(payer)(count));
-FC_REFLECT( roxe::chain_apis::read_only::get_table_by_scope_result, (rows)(more) );
+FC_REFLECT( roxe::chain_apis::read_only::get_table_by_scope_result, (rows)(more)(count) );
 
 FC_REFLECT( roxe::chain_apis::read_only::get_currency_balance_params, (code)(account)(symbol));
 FC_REFLECT( roxe::chain_apis::read_only::get_currency_stats_params, (code)(symbol));
@@ -766,6 +934,8 @@ FC_REFLECT( roxe::chain_apis::read_only::get_code_results, (account_name)(code_h
 FC_REFLECT( roxe::chain_apis::read_only::get_code_hash_results, (account_name)(code_hash) )
 FC_REFLECT( roxe::chain_apis::read_only::get_abi_results, (account_name)(abi) )
 FC_REFLECT( roxe::chain_apis::read_only::get_account_params, (account_name)(expected_core_symbol) )
+FC_REFLECT( roxe::chain_apis::read_only::get_key_accounts_params, (public_key) )
+FC_REFLECT( roxe::chain_apis::read_only::get_key_accounts_results, (account_names) )
 FC_REFLECT( roxe::chain_apis::read_only::get_code_params, (account_name)(code_as_wasm) )
 FC_REFLECT( roxe::chain_apis::read_only::get_code_hash_params, (account_name) )
 FC_REFLECT( roxe::chain_apis::read_only::get_abi_params, (account_name) )
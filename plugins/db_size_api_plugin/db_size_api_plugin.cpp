@@ -24,6 +24,9 @@ using namespace roxe;
           } \
        }}
 
+#define INVOKE_R_R(api_handle, call_name, in_param) \
+     auto result = api_handle->call_name(fc::json::from_string(body).as<in_param>());
+
 #define INVOKE_R_V(api_handle, call_name) \
      auto result = api_handle->call_name();
 
@@ -32,6 +35,10 @@ void db_size_api_plugin::plugin_startup() {
    app().get_plugin<http_plugin>().add_api({
        CALL(db_size, this, get,
             INVOKE_R_V(this, get), 200),
+       CALL(db_size, this, get_tables,
+            INVOKE_R_R(this, get_tables, db_size_get_tables_params), 200),
+       CALL(db_size, this, get_undo,
+            INVOKE_R_V(this, get_undo), 200),
    });
 }
 
@@ -42,14 +49,105 @@ db_size_stats db_size_api_plugin::get() {
    ret.free_bytes = db.get_segment_manager()->get_free_memory();
    ret.size = db.get_segment_manager()->get_size();
    ret.used_bytes = ret.size - ret.free_bytes;
+   ret.largest_free_block = db.get_largest_free_block();
+
+   auto indices = db.usage_per_index();
+   std::sort(indices.begin(), indices.end(), [](const auto& a, const auto& b) {
+      return std::tie(a.row_count, a.type_name) < std::tie(b.row_count, b.type_name);
+   });
+   ret.node_bytes = 0;
+   for(const auto& i : indices) {
+      ret.indices.emplace_back(db_size_index_count{i.type_name, i.row_count, i.row_count * i.node_size});
+      ret.node_bytes += i.row_count * i.node_size;
+   }
+
+   return ret;
+}
+
+db_size_get_tables_result db_size_api_plugin::get_tables( const db_size_get_tables_params& params ) {
+   using namespace roxe::chain;
+   const chainbase::database& db = app().get_plugin<chain_plugin>().chain().db();
+   const uint32_t limit = std::min( params.limit, 1000u );
+   db_size_get_tables_result ret;
+   if( limit == 0 )
+      return ret;
+
+   // min heap on row count holding the largest tables seen so far
+   auto more_rows = []( const table_id_object* a, const table_id_object* b ) { return a->count > b->count; };
+   vector<const table_id_object*> top;
+   top.reserve( limit );
+   for( const auto& t : db.get_index<table_id_multi_index>().indices() ) {
+      if( top.size() < limit ) {
+         top.push_back( &t );
+         std::push_heap( top.begin(), top.end(), more_rows );
+      } else if( t.count > top.front()->count ) {
+         std::pop_heap( top.begin(), top.end(), more_rows );
+         top.back() = &t;
+         std::push_heap( top.begin(), top.end(), more_rows );
+      }
+   }
+   std::sort_heap( top.begin(), top.end(), more_rows );
+
+   const auto deadline = fc::time_point::now() + fc::milliseconds( params.time_limit_ms );
+   const auto& kv_index = db.get_index<key_value_index, by_scope_primary>();
+   bool out_of_time = false;
+   for( const auto* t : top ) {
+      db_size_table row{ t->code, t->scope, t->table, t->count };
+      if( !out_of_time ) {
+         uint64_t bytes = 0;
+         uint32_t n = 0;
+         auto itr = kv_index.lower_bound( boost::make_tuple( t->id ) );
+         for( ; itr != kv_index.end() && itr->t_id == t->id; ++itr ) {
+            bytes += itr->value.size();
+            if( ++n % 1000 == 0 && fc::time_point::now() > deadline ) {
+               out_of_time = true;
+               break;
+            }
+         }
+         if( !out_of_time )
+            row.value_bytes = bytes;
+      }
+      ret.tables.emplace_back( std::move( row ) );
+   }
+
+   return ret;
+}
+
+static db_size_undo_operation to_undo_operation( const chainbase::database::operation_timing& t ) {
+   return db_size_undo_operation{ t.count, t.total_ns / 1000, t.max_ns / 1000, t.last_ns / 1000 };
+}
+
+db_size_get_undo_result db_size_api_plugin::get_undo() {
+   const auto& chain = app().get_plugin<chain_plugin>().chain();
+   const chainbase::database& db = chain.db();
+   db_size_get_undo_result ret;
+
+   ret.revision = db.revision();
+   const auto range = db.undo_stack_revision_range();
+   ret.undo_revisions = range.second - range.first;
+   ret.free_bytes = db.get_free_memory();
+   ret.free_above_guard = static_cast<int64_t>( ret.free_bytes ) - static_cast<int64_t>( chain.state_guard_size() );
+   ret.largest_free_block = db.get_largest_free_block();
+
+   const auto& timings = db.get_undo_timings();
+   ret.undo = to_undo_operation( timings.undo );
+   ret.squash = to_undo_operation( timings.squash );
+   ret.commit = to_undo_operation( timings.commit );
 
-   chainbase::database::database_index_row_count_multiset indices = db.row_count_per_index();
-   for(const auto& i : indices)
-      ret.indices.emplace_back(db_size_index_count{i.second, i.first});
+   for( const auto& i : db.undo_usage_per_index() ) {
+      ret.undo_bytes += i.usage.bytes;
+      if( i.usage.revisions )
+         ret.indices.emplace_back( db_size_index_undo{ i.type_name, i.usage.revisions, i.usage.modified,
+                                                       i.usage.removed, i.usage.created, i.usage.bytes } );
+   }
+   std::sort( ret.indices.begin(), ret.indices.end(), []( const auto& a, const auto& b ) {
+      return std::tie( b.bytes, b.created, a.index ) < std::tie( a.bytes, a.created, b.index );
+   } );
 
    return ret;
 }
 
+#undef INVOKE_R_R
 #undef INVOKE_R_V
 #undef CALL
 
@@ -16,15 +16,64 @@ using namespace appbase;
 struct db_size_index_count {
    string   index;
    uint64_t row_count;
+   uint64_t node_bytes; ///< row_count times the size of one container node
+};
+
+struct db_size_undo_operation {
+   uint64_t count = 0;
+   uint64_t total_us = 0;
+   uint64_t max_us = 0;
+   uint64_t last_us = 0;
+};
+
+struct db_size_index_undo {
+   string   index;
+   uint64_t revisions = 0;
+   uint64_t modified = 0;
+   uint64_t removed = 0;
+   uint64_t created = 0;
+   uint64_t bytes = 0;
 };
 
 struct db_size_stats {
    uint64_t                    free_bytes;
    uint64_t                    used_bytes;
    uint64_t                    size;
+   uint64_t                    largest_free_block; ///< far below free_bytes means the free space is fragmented
+   uint64_t                    node_bytes; ///< sum over all indices, the rest of used_bytes is memory owned by objects and allocator overhead
    vector<db_size_index_count> indices;
 };
 
+struct db_size_get_undo_result {
+   int64_t                     revision = 0;
+   int64_t                     undo_revisions = 0;   ///< revisions that can still be undone
+   uint64_t                    free_bytes = 0;
+   int64_t                     free_above_guard = 0; ///< database_guard_exception is thrown once this falls below zero
+   uint64_t                    largest_free_block = 0;
+   uint64_t                    undo_bytes = 0;       ///< sum over all indices
+   db_size_undo_operation      undo;
+   db_size_undo_operation      squash;
+   db_size_undo_operation      commit;
+   vector<db_size_index_undo>  indices;              ///< indices with undo states, most undo bytes first
+};
+
+struct db_size_get_tables_params {
+   uint32_t limit = 20;
+   uint32_t time_limit_ms = 10; ///< budget for summing row bytes, tables past it are reported without value_bytes
+};
+
+struct db_size_table {
+   chain::name                code;
+   chain::name                scope;
+   chain::name                table;
+   uint64_t                   row_count = 0; ///< primary and secondary index rows
+   fc::optional<uint64_t>     value_bytes; ///< sum of the primary row values
+};
+
+struct db_size_get_tables_result {
+   vector<db_size_table> tables; ///< largest by row count first
+};
+
 class db_size_api_plugin : public plugin<db_size_api_plugin> {
 public:
    APPBASE_PLUGIN_REQUIRES((http_plugin) (chain_plugin))
@@ -42,11 +91,19 @@ public:
    void plugin_shutdown() {}
 
    db_size_stats get();
+   db_size_get_tables_result get_tables( const db_size_get_tables_params& params );
+   db_size_get_undo_result get_undo();
 
 private:
 };
 
 }
 
-FC_REFLECT( roxe::db_size_index_count, (index)(row_count) )
-FC_REFLECT( roxe::db_size_stats, (free_bytes)(used_bytes)(size)(indices) )
\ No newline at end of file
+FC_REFLECT( roxe::db_size_index_count, (index)(row_count)(node_bytes) )
+FC_REFLECT( roxe::db_size_stats, (free_bytes)(used_bytes)(size)(largest_free_block)(node_bytes)(indices) )
+FC_REFLECT( roxe::db_size_get_tables_params, (limit)(time_limit_ms) )
+FC_REFLECT( roxe::db_size_table, (code)(scope)(table)(row_count)(value_bytes) )
+FC_REFLECT( roxe::db_size_get_tables_result, (tables) )
+FC_REFLECT( roxe::db_size_undo_operation, (count)(total_us)(max_us)(last_us) )
+FC_REFLECT( roxe::db_size_index_undo, (index)(revisions)(modified)(removed)(created)(bytes) )
+FC_REFLECT( roxe::db_size_get_undo_result, (revision)(undo_revisions)(free_bytes)(free_above_guard)(largest_free_block)(undo_bytes)(undo)(squash)(commit)(indices) )
\ No newline at end of file
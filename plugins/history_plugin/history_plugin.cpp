@@ -10,6 +10,8 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/signals2/connection.hpp>
 
+#include <fstream>
+
 namespace roxe {
    using namespace chain;
    using boost::signals2::scoped_connection;
@@ -26,14 +28,16 @@ namespace roxe {
       int32_t      account_sequence_num = 0; ///< the sequence number for this account (per-account)
    };
 
+   /// the packed action trace itself is kept in the action trace log, this object only locates it
    struct action_history_object : public chainbase::object<action_history_object_type, action_history_object> {
 
-      OBJECT_CTOR( action_history_object, (packed_action_trace) );
+      OBJECT_CTOR( action_history_object );
 
       id_type      id;
       uint64_t     action_sequence_num; ///< the sequence number of the relevant action
 
-      shared_string        packed_action_trace;
+      uint64_t             trace_pos = 0; ///< position of the packed action trace in the action trace log
+      uint32_t             trace_size = 0;
       uint32_t             block_num;
       block_timestamp_type block_time;
       transaction_id_type  trx_id;
@@ -135,6 +139,16 @@ namespace roxe {
       }
    };
 
+   /**
+    *  The history is kept apart from the chain state: the indices live in their own chainbase database in the
+    *  history directory and the packed action traces are appended to a log file next to it, so only fixed
+    *  size rows are mapped into memory while the traces grow on disk.
+    *
+    *  The actions of a block are recorded once the block is accepted, each block in an undo session of the
+    *  history database whose revision is the block number. Sessions are undone when a fork replaces their
+    *  blocks and committed once the blocks become irreversible. Traces of undone blocks stay in the log
+    *  unreferenced.
+    */
    class history_plugin_impl {
       public:
          bool bypass_filter = false;
@@ -142,6 +156,14 @@ namespace roxe {
          std::set<filter_entry> filter_out;
          chain_plugin*          chain_plug = nullptr;
          fc::optional<scoped_connection> applied_transaction_connection;
+         fc::optional<scoped_connection> accepted_block_connection;
+         fc::optional<scoped_connection> irreversible_block_connection;
+
+         fc::optional<chainbase::database> history_db;
+         mutable std::fstream              action_trace_log;
+
+         std::map<transaction_id_type, transaction_trace_ptr> cached_traces;
+         transaction_trace_ptr                                onblock_trace;
 
           bool filter(const action_trace& act) {
             bool pass_on = false;
@@ -204,9 +226,35 @@ namespace roxe {
             return result;
          }
 
+         void open_history( const bfs::path& dir, uint64_t db_size ) {
+            if( !fc::is_directory( dir ) )
+               fc::create_directories( dir );
+            history_db.emplace( dir, chainbase::database::read_write, db_size );
+            history_db->add_index<account_history_index>();
+            history_db->add_index<action_history_index>();
+            history_db->add_index<account_control_history_multi_index>();
+            history_db->add_index<public_key_history_multi_index>();
+
+            const auto log_filename = dir / "action_traces.log";
+            action_trace_log.open( log_filename.generic_string(), std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app );
+            ROXE_ASSERT( action_trace_log.is_open(), chain::plugin_config_exception,
+                        "unable to open ${f}", ("f", log_filename.generic_string()) );
+         }
+
+         action_trace read_action_trace( const action_history_object& aho )const {
+            std::vector<char> packed( aho.trace_size );
+            action_trace_log.seekg( aho.trace_pos );
+            action_trace_log.read( packed.data(), packed.size() );
+            ROXE_ASSERT( action_trace_log, chain::plugin_exception, "unable to read action ${seq} from the action trace log",
+                        ("seq", aho.action_sequence_num) );
+            fc::datastream<const char*> ds( packed.data(), packed.size() );
+            action_trace t;
+            fc::raw::unpack( ds, t );
+            return t;
+         }
+
          void record_account_action( account_name n, const action_trace& act ) {
-            auto& chain = chain_plug->chain();
-            chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
+            chainbase::database& db = *history_db;
 
             const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
             auto itr = idx.lower_bound( boost::make_tuple( name(n.value+1), 0 ) );
@@ -224,8 +272,7 @@ namespace roxe {
          }
 
          void on_system_action( const action_trace& at ) {
-            auto& chain = chain_plug->chain();
-            chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
+            chainbase::database& db = *history_db;
             if( at.act.name == N(newaccount) )
             {
                const auto create = at.act.data_as<chain::newaccount>();
@@ -250,20 +297,22 @@ namespace roxe {
             }
          }
 
-         void on_action_trace( const action_trace& at ) {
+         void on_action_trace( const action_trace& at, const block_state_ptr& bsp ) {
             if( filter( at ) ) {
                //idump((fc::json::to_pretty_string(at)));
-               auto& chain = chain_plug->chain();
-               chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
+               chainbase::database& db = *history_db;
+
+               const auto packed = fc::raw::pack( at );
+               action_trace_log.seekp( 0, std::ios_base::end );
+               const uint64_t pos = action_trace_log.tellp();
+               action_trace_log.write( packed.data(), packed.size() );
 
                db.create<action_history_object>( [&]( auto& aho ) {
-                  auto ps = fc::raw::pack_size( at );
-                  aho.packed_action_trace.resize(ps);
-                  datastream<char*> ds( aho.packed_action_trace.data(), ps );
-                  fc::raw::pack( ds, at );
+                  aho.trace_pos  = pos;
+                  aho.trace_size = packed.size();
                   aho.action_sequence_num = at.receipt->global_sequence;
-                  aho.block_num = chain.head_block_num() + 1;
-                  aho.block_time = chain.pending_block_time();
+                  aho.block_num  = bsp->block_num;
+                  aho.block_time = bsp->header.timestamp;
                   aho.trx_id     = at.trx_id;
                });
 
@@ -277,14 +326,64 @@ namespace roxe {
          }
 
          void on_applied_transaction( const transaction_trace_ptr& trace ) {
-            if( !trace->receipt || (trace->receipt->status != transaction_receipt_header::executed &&
-                  trace->receipt->status != transaction_receipt_header::soft_fail) )
+            if( !trace->receipt )
+               return;
+            const auto* act = trace->action_traces.empty() ? nullptr : &trace->action_traces.front().act;
+            if( act && act->account == chain::config::system_account_name && act->name == N(onblock) )
+               onblock_trace = trace;
+            else if( trace->failed_dtrx_trace )
+               cached_traces[trace->failed_dtrx_trace->id] = trace;
+            else
+               cached_traces[trace->id] = trace;
+         }
+
+         void record_transaction( const transaction_trace_ptr& trace, const block_state_ptr& bsp ) {
+            if( trace->receipt->status != transaction_receipt_header::executed &&
+                trace->receipt->status != transaction_receipt_header::soft_fail )
                return;
             for( const auto& atrace : trace->action_traces ) {
                if( !atrace.receipt ) continue;
-               on_action_trace( atrace );
+               on_action_trace( atrace, bsp );
             }
          }
+
+         void on_accepted_block( const block_state_ptr& bsp ) {
+            auto& db = *history_db;
+            while( db.revision() >= bsp->block_num ) {
+               const auto revision = db.revision();
+               db.undo();
+               if( revision == db.revision() ) {
+                  // the block is irreversible in the history database already, e.g. during a replay
+                  cached_traces.clear();
+                  onblock_trace.reset();
+                  return;
+               }
+            }
+            if( db.revision() + 1 < bsp->block_num ) {
+               db.commit( db.revision() );
+               db.set_revision( bsp->block_num - 1 );
+            }
+
+            auto session = db.start_undo_session( true );
+            if( onblock_trace )
+               record_transaction( onblock_trace, bsp );
+            for( const auto& r : bsp->block->transactions ) {
+               const auto& id = r.trx.contains<transaction_id_type>() ? r.trx.get<transaction_id_type>()
+                                                                      : r.trx.get<packed_transaction>().id();
+               auto itr = cached_traces.find( id );
+               if( itr != cached_traces.end() )
+                  record_transaction( itr->second, bsp );
+            }
+            action_trace_log.flush();
+            session.push();
+
+            cached_traces.clear();
+            onblock_trace.reset();
+         }
+
+         void on_irreversible_block( const block_state_ptr& bsp ) {
+            history_db->commit( bsp->block_num );
+         }
    };
 
    history_plugin::history_plugin()
@@ -305,6 +404,12 @@ namespace roxe {
             ("filter-out,F", bpo::value<vector<string>>()->composing(),
              "Do not track actions which match receiver:action:actor. Action and Actor both blank excludes all from Reciever. Actor blank excludes all from reciever:action. Receiver may not be blank.")
             ;
+      cfg.add_options()
+            ("history-dir", bpo::value<bfs::path>()->default_value("history"),
+             "the location of the history database and action trace log (absolute path or relative to application data dir)")
+            ("history-db-size-mb", bpo::value<uint64_t>()->default_value(1024),
+             "Maximum size (in MiB) of the history database, which holds the indices of the tracked actions")
+            ;
    }
 
    void history_plugin::plugin_initialize(const variables_map& options) {
@@ -314,7 +419,7 @@ namespace roxe {
             for( auto& s : fo ) {
                if( s == "*" || s == "\"*\"" ) {
                   my->bypass_filter = true;
-                  wlog( "--filter-on * enabled. This can fill shared_mem, causing nodroxe to stop." );
+                  wlog( "--filter-on * enabled. This can fill the history database, causing nodroxe to stop." );
                   break;
                }
                std::vector<std::string> v;
@@ -343,17 +448,24 @@ namespace roxe {
          ROXE_ASSERT( my->chain_plug, chain::missing_chain_plugin_exception, ""  );
          auto& chain = my->chain_plug->chain();
 
-         chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
-         // TODO: Use separate chainbase database for managing the state of the history_plugin (or remove deprecated history_plugin entirely)
-         db.add_index<account_history_index>();
-         db.add_index<action_history_index>();
-         db.add_index<account_control_history_multi_index>();
-         db.add_index<public_key_history_multi_index>();
+         auto dir = options.at( "history-dir" ).as<bfs::path>();
+         if( dir.is_relative() )
+            dir = app().data_dir() / dir;
+         my->open_history( dir, options.at( "history-db-size-mb" ).as<uint64_t>() * 1024 * 1024 );
 
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
                   my->on_applied_transaction( std::get<0>(t) );
                } ));
+         chain.require_detailed_traces();
+         my->accepted_block_connection.emplace(
+               chain.accepted_block.connect( [&]( const block_state_ptr& bsp ) {
+                  my->on_accepted_block( bsp );
+               } ));
+         my->irreversible_block_connection.emplace(
+               chain.irreversible_block.connect( [&]( const block_state_ptr& bsp ) {
+                  my->on_irreversible_block( bsp );
+               } ));
       } FC_LOG_AND_RETHROW()
    }
 
@@ -362,17 +474,34 @@ namespace roxe {
 
    void history_plugin::plugin_shutdown() {
       my->applied_transaction_connection.reset();
+      my->accepted_block_connection.reset();
+      my->irreversible_block_connection.reset();
+      my->action_trace_log.flush();
    }
 
 
 
 
    namespace history_apis {
+      /// like controller::to_variant_with_abi, with the serializers shared through the chain_plugin cache
+      template<typename T>
+      static fc::variant to_variant_with_abi( chain_plugin& chain_plug, const T& obj ) {
+         auto& chain = chain_plug.chain();
+         const auto abi_serializer_max_time = chain_plug.get_abi_serializer_max_time();
+         auto* abi_cache = chain_plug.get_abi_serializer_cache();
+         if( !abi_cache )
+            return chain.to_variant_with_abi( obj, abi_serializer_max_time );
+         fc::variant pretty_output;
+         abi_serializer::to_variant( obj, pretty_output,
+                                     [&]( account_name n ) { return abi_cache->get_serializer( chain.db(), n, abi_serializer_max_time ); },
+                                     abi_serializer_max_time );
+         return pretty_output;
+      }
+
       read_only::get_actions_result read_only::get_actions( const read_only::get_actions_params& params )const {
          edump((params));
         auto& chain = history->chain_plug->chain();
-        const auto& db = chain.db();
-        const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
+        const auto& db = *history->history_db;
 
         const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
 
@@ -417,14 +546,12 @@ namespace roxe {
         result.last_irreversible_block = chain.last_irreversible_block_num();
         while( start_itr != end_itr ) {
            const auto& a = db.get<action_history_object, by_action_sequence_num>( start_itr->action_sequence_num );
-           fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
-           action_trace t;
-           fc::raw::unpack( ds, t );
+           const auto t = history->read_action_trace( a );
            result.actions.emplace_back( ordered_action_result{
                                  start_itr->action_sequence_num,
                                  start_itr->account_sequence_num,
                                  a.block_num, a.block_time,
-                                 chain.to_variant_with_abi(t, abi_serializer_max_time)
+                                 to_variant_with_abi(*history->chain_plug, t)
                                  });
 
            end_time = fc::time_point::now();
@@ -440,7 +567,6 @@ namespace roxe {
 
       read_only::get_transaction_result read_only::get_transaction( const read_only::get_transaction_params& p )const {
          auto& chain = history->chain_plug->chain();
-         const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
 
          transaction_id_type input_id;
          auto input_id_length = p.id.size();
@@ -461,7 +587,7 @@ namespace roxe {
             return (*(input_id.data() + input_id_size) & 0xF0) == (*(id.data() + input_id_size) & 0xF0);
          };
 
-         const auto& db = chain.db();
+         const auto& db = *history->history_db;
          const auto& idx = db.get_index<action_history_index, by_trx_id>();
          auto itr = idx.lower_bound( boost::make_tuple( input_id ) );
 
@@ -481,10 +607,7 @@ namespace roxe {
 
             while( itr != idx.end() && itr->trx_id == result.id ) {
 
-              fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
-              action_trace t;
-              fc::raw::unpack( ds, t );
-              result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
+              result.traces.emplace_back( to_variant_with_abi(*history->chain_plug, history->read_action_trace( *itr )) );
 
               ++itr;
             }
@@ -497,7 +620,7 @@ namespace roxe {
                         auto &pt = receipt.trx.get<packed_transaction>();
                         if (pt.id() == result.id) {
                             fc::mutable_variant_object r("receipt", receipt);
-                            r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer_max_time));
+                            r("trx", to_variant_with_abi(*history->chain_plug, pt.get_signed_transaction()));
                             result.trx = move(r);
                             break;
                         }
@@ -525,7 +648,7 @@ namespace roxe {
                         result.block_num = *p.block_num_hint;
                         result.block_time = blk->timestamp;
                         fc::mutable_variant_object r("receipt", receipt);
-                        r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer_max_time));
+                        r("trx", to_variant_with_abi(*history->chain_plug, pt.get_signed_transaction()));
                         result.trx = move(r);
                         found = true;
                         break;
@@ -556,7 +679,7 @@ namespace roxe {
 
       read_only::get_key_accounts_results read_only::get_key_accounts(const get_key_accounts_params& params) const {
          std::set<account_name> accounts;
-         const auto& db = history->chain_plug->chain().db();
+         const auto& db = *history->history_db;
          const auto& pub_key_idx = db.get_index<public_key_history_multi_index, by_pub_key>();
          auto range = pub_key_idx.equal_range( params.public_key );
          for (auto obj = range.first; obj != range.second; ++obj)
@@ -566,7 +689,7 @@ namespace roxe {
 
       read_only::get_controlled_accounts_results read_only::get_controlled_accounts(const get_controlled_accounts_params& params) const {
          std::set<account_name> accounts;
-         const auto& db = history->chain_plug->chain().db();
+         const auto& db = *history->history_db;
          const auto& account_control_idx = db.get_index<account_control_history_multi_index, by_controlling>();
          auto range = account_control_idx.equal_range( params.controlling_account );
          for (auto obj = range.first; obj != range.second; ++obj)
@@ -18,6 +18,10 @@ void http_client_plugin::set_program_options(options_description&, options_descr
        "PEM encoded trusted root certificate (or path to file containing one) used to validate any TLS connections made.  (may specify multiple times)\n")
       ("https-client-validate-peers", boost::program_options::value<bool>()->default_value(true),
        "true: validate that the peer certificates are valid and trusted, false: ignore cert errors")
+      ("http-client-max-idle-connections", boost::program_options::value<uint32_t>()->default_value(4),
+       "Number of kept alive connections per endpoint kept open for later requests, 0 closes every connection after its request")
+      ("http-client-max-idle-ms", boost::program_options::value<uint32_t>()->default_value(60000),
+       "Milliseconds an idle connection is kept for reuse")
       ;
 
 }
@@ -51,6 +55,8 @@ void http_client_plugin::plugin_initialize(const variables_map& options) {
       }
 
       my->set_verify_peers( options.at( "https-client-validate-peers" ).as<bool>());
+      my->set_connection_pool( options.at( "http-client-max-idle-connections" ).as<uint32_t>(),
+                               fc::milliseconds( options.at( "http-client-max-idle-ms" ).as<uint32_t>() ));
    } FC_LOG_AND_RETHROW()
 }
 
@@ -12,6 +12,8 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/io/json.hpp>
 #include <fc/crypto/openssl.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/metrics.hpp>
 
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
@@ -25,7 +27,9 @@
 
 #include <thread>
 #include <memory>
-#include <regex>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 
 namespace roxe {
 
@@ -37,7 +41,6 @@ namespace roxe {
    using std::vector;
    using std::set;
    using std::string;
-   using std::regex;
    using boost::optional;
    using boost::asio::ip::tcp;
    using boost::asio::ip::address_v4;
@@ -131,10 +134,78 @@ namespace roxe {
    using ssl_context_ptr =  websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context>;
 
    static bool verbose_http_errors = false;
+   static fc::microseconds slow_request_time{0};   ///< requests taking longer are logged, 0 logs none
+
+   const fc::string slow_request_logger_name("http_slow_requests");
+   fc::logger slow_request_log;
+
+   /// what http_plugin reports through metrics_plugin, updated from the http threads
+   struct http_metrics {
+      fc::metrics::registry&  r = fc::metrics::registry::instance();
+      fc::metrics::counter&   requests = r.add_counter( "roxe_http_requests_total", "Requests for a known endpoint" );
+      fc::metrics::counter&   not_found = r.add_counter( "roxe_http_not_found_total", "Requests for an unknown endpoint" );
+      fc::metrics::counter&   busy = r.add_counter( "roxe_http_busy_total", "Requests refused because too many bytes were in flight" );
+      fc::metrics::counter&   errors = r.add_counter( "roxe_http_errors_total", "Requests answered with an internal error" );
+      fc::metrics::counter&   request_bytes = r.add_counter( "roxe_http_request_bytes_total", "Bytes of request bodies" );
+      fc::metrics::counter&   response_bytes = r.add_counter( "roxe_http_response_bytes_total", "Bytes of response bodies" );
+      fc::metrics::histogram& latency = r.add_histogram( "roxe_http_request_seconds",
+                                                         "Time from reading a request to sending its response",
+                                                         fc::metrics::exponential_bounds( 0.0001, 2, 16 ) );
+   };
+
+   static http_metrics& metrics() {
+      static http_metrics m;
+      return m;
+   }
+
+   /**
+    * The time of one endpoint's requests, split by phase:
+    * accept - on the http thread, from reading the request to handing it to the main thread
+    * queue - waiting for the main thread, or for the read-only window
+    * handler - from the handler starting until it answered, parsing the parameters included
+    * serialize - rendering the response as JSON on the http thread, handlers adding a JSON api render it themselves
+    * send - waiting for an http thread and writing the response
+    * Created when the endpoint is added, so requests only look them up.
+    */
+   struct endpoint_metrics {
+      explicit endpoint_metrics( const string& u )
+      :url( u )
+      ,requests( metrics().r.add_counter( "roxe_http_endpoint_requests_total", "Requests per endpoint", {{"endpoint", u}} ) )
+      ,accept( phase( "accept" ) ), queue( phase( "queue" ) ), handler( phase( "handler" ) )
+      ,serialize( phase( "serialize" ) ), send( phase( "send" ) ) {}
+
+      const string            url;
+      fc::metrics::counter&   requests;
+      fc::metrics::histogram& accept;
+      fc::metrics::histogram& queue;
+      fc::metrics::histogram& handler;
+      fc::metrics::histogram& serialize;
+      fc::metrics::histogram& send;
+
+      private:
+         fc::metrics::histogram& phase( const char* p ) {
+            return metrics().r.add_histogram( "roxe_http_endpoint_seconds", "Time of the requests per endpoint and phase",
+                                              fc::metrics::exponential_bounds( 0.00001, 2, 20 ), {{"endpoint", url}, {"phase", p}} );
+         }
+   };
+
+   /// when a request reached each phase, carried along with it
+   struct request_timing {
+      const endpoint_metrics* endpoint = nullptr;
+      fc::time_point          received;
+      fc::time_point          dispatched;
+      fc::time_point          started;
+      fc::time_point          responded;
+      size_t                  body_size = 0;
+      fc::sha256              body_hash;   ///< only with a slow request log
+   };
 
    class http_plugin_impl {
       public:
          map<string,url_handler>  url_handlers;
+         map<string,json_url_handler> json_url_handlers;
+         map<string,std::unique_ptr<endpoint_metrics>> endpoints;
+         set<string>              read_only_urls;
          optional<tcp::endpoint>  listen_endpoint;
          string                   access_control_allow_origin;
          string                   access_control_allow_headers;
@@ -149,10 +220,17 @@ namespace roxe {
          std::atomic<size_t>                         bytes_in_flight{0};
          size_t                                      max_bytes_in_flight = 0;
 
+         bool                                        read_only_on_threads = false;
+         std::mutex                                  read_only_mtx;
+         std::vector<std::function<void()>>          read_only_calls;           // protected by read_only_mtx
+         bool                                        read_only_window_posted = false; // protected by read_only_mtx
+
          optional<tcp::endpoint>  https_listen_endpoint;
          string                   https_cert_chain;
          string                   https_key;
          https_ecdh_curve_t       https_ecdh_curve = SECP384R1;
+         uint32_t                 https_session_cache_size = 0;
+         ssl_context_ptr          https_context; ///< shared by all https connections so that their sessions can be resumed
 
          websocket_server_tls_type https_server;
 
@@ -166,14 +244,21 @@ namespace roxe {
             return !validate_host || header_host_port == endpoint_local_host_port || valid_hosts.find(header_host_port) != valid_hosts.end();
          }
 
+         /// @return true if host ends in :<number> without a preceeding colon, which would imply ipv6
+         static bool has_explicit_port( const std::string& host ) {
+            auto colon = host.rfind(':');
+            if (colon == std::string::npos || colon == 0 || colon + 1 == host.size() || host[colon - 1] == ':')
+               return false;
+            return std::all_of(host.begin() + colon + 1, host.end(), [](char c) { return c >= '0' && c <= '9'; });
+         }
+
          bool host_is_valid( const std::string& host, const string& endpoint_local_host_port, bool secure) {
             if (!validate_host) {
                return true;
             }
 
             // normalise the incoming host so that it always has the explicit port
-            static auto has_port_expr = regex("[^:]:[0-9]+$"); /// ends in :<number> without a preceeding colon which implies ipv6
-            if (std::regex_search(host, has_port_expr)) {
+            if (has_explicit_port(host)) {
                return host_port_is_valid( host, endpoint_local_host_port );
             } else {
                // according to RFC 2732 ipv6 addresses should always be enclosed with brackets so we shouldn't need to special case here
@@ -181,7 +266,8 @@ namespace roxe {
             }
          }
 
-         ssl_context_ptr on_tls_init(websocketpp::connection_hdl hdl) {
+         /// builds https_context, the certificate chain and key are read once rather than for every connection
+         void create_tls_context() {
             ssl_context_ptr ctx = websocketpp::lib::make_shared<websocketpp::lib::asio::ssl::context>(asio::ssl::context::sslv23_server);
 
             try {
@@ -207,18 +293,117 @@ namespace roxe {
                   "EECDH+ECDSA+AESGCM:EECDH+aRSA+AESGCM:EECDH+ECDSA+SHA384:EECDH+ECDSA+SHA256:AES256:" \
                   "!DHE:!RSA:!AES128:!RC4:!DES:!3DES:!DSS:!SRP:!PSK:!EXP:!MD5:!LOW:!aNULL:!eNULL") != 1)
                   ROXE_THROW(chain::http_exception, "Failed to set HTTPS cipher list");
+
+               // resumed sessions skip the key exchange, through the server side cache or through tickets
+               SSL_CTX* native = ctx->native_handle();
+               if( https_session_cache_size ) {
+                  static const unsigned char session_id_context[] = "roxe-https";
+                  SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_SERVER);
+                  SSL_CTX_sess_set_cache_size(native, https_session_cache_size);
+                  if(SSL_CTX_set_session_id_context(native, session_id_context, sizeof(session_id_context) - 1) != 1)
+                     ROXE_THROW(chain::http_exception, "Failed to set HTTPS session id context");
+               } else {
+                  SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_OFF);
+                  SSL_CTX_set_options(native, SSL_OP_NO_TICKET);
+               }
             } catch (const fc::exception& e) {
                elog("https server initialization error: ${w}", ("w", e.to_detail_string()));
+               throw;
             } catch(std::exception& e) {
                elog("https server initialization error: ${w}", ("w", e.what()));
+               throw;
+            }
+
+            https_context = std::move(ctx);
+         }
+
+         /// queues a read-only call for the next read-only window, posting the window to the main thread if needed
+         void queue_read_only( std::function<void()> call ) {
+            bool post_window = false;
+            {
+               std::lock_guard<std::mutex> g( read_only_mtx );
+               read_only_calls.emplace_back( std::move( call ) );
+               if( !read_only_window_posted )
+                  read_only_window_posted = post_window = true;
             }
+            if( post_window )
+               app().post( appbase::priority::low, [this]() { run_read_only_window(); } );
+         }
 
-            return ctx;
+         /**
+          * Runs on the main thread: executes the queued read-only calls on the thread pool and on the main
+          * thread itself, and returns once all of them have completed. Nothing on the main thread modifies
+          * state meanwhile, so the calls see the state between two main thread tasks as they did before.
+          */
+         void run_read_only_window() {
+            std::vector<std::function<void()>> calls;
+            {
+               std::lock_guard<std::mutex> g( read_only_mtx );
+               calls.swap( read_only_calls );
+               read_only_window_posted = false;
+            }
+            if( calls.empty() ) return;
+
+            std::atomic<size_t> next{0};
+            auto run_calls = [&calls, &next]() {
+               for( size_t i = next++; i < calls.size(); i = next++ ) {
+                  try {
+                     calls[i]();
+                  } FC_LOG_AND_DROP()
+               }
+            };
+
+            std::mutex mtx;
+            std::condition_variable cv;
+            size_t helpers = std::min<size_t>( calls.size() - 1, thread_pool_size );
+            for( size_t i = 0, n = helpers; i < n; ++i ) {
+               boost::asio::post( thread_pool->get_executor(), [&]() {
+                  run_calls();
+                  std::lock_guard<std::mutex> g( mtx );
+                  if( --helpers == 0 ) cv.notify_one();
+               } );
+            }
+            run_calls();
+            std::unique_lock<std::mutex> g( mtx );
+            cv.wait( g, [&]() { return helpers == 0; } );
+         }
+
+         template<class T>
+         static void send_response(typename websocketpp::server<T>::connection_ptr con, int code, std::string json,
+                                   std::atomic<size_t>& bytes_in_flight, const request_timing& t, fc::microseconds serialize) {
+            const size_t json_size = json.size();
+            bytes_in_flight += json_size;
+            con->set_body( std::move( json ) );
+            con->set_status( websocketpp::http::status_code::value( code ) );
+            con->send_http_response();
+            bytes_in_flight -= json_size;
+
+            const auto now = fc::time_point::now();
+            const auto accept = t.dispatched - t.received;
+            const auto queue = t.started - t.dispatched;
+            const auto handler = t.responded - t.started;
+            const auto send = now - t.responded - serialize;
+            metrics().response_bytes.inc( json_size );
+            metrics().latency.observe( (now - t.received).count() / 1e6 );
+            t.endpoint->accept.observe( accept.count() / 1e6 );
+            t.endpoint->queue.observe( queue.count() / 1e6 );
+            t.endpoint->handler.observe( handler.count() / 1e6 );
+            t.endpoint->serialize.observe( serialize.count() / 1e6 );
+            t.endpoint->send.observe( send.count() / 1e6 );
+
+            if( slow_request_time.count() > 0 && now - t.received >= slow_request_time ) {
+               fc_wlog( slow_request_log, "slow request ${url}: ${total}us, accept ${a}us, queue ${q}us, handler ${h}us, "
+                        "serialize ${s}us, send ${se}us; status ${code}, request ${in} bytes sha256 ${hash}, response ${out} bytes",
+                        ("url", t.endpoint->url)("total", (now - t.received).count())("a", accept.count())("q", queue.count())
+                        ("h", handler.count())("s", serialize.count())("se", send.count())("code", code)
+                        ("in", t.body_size)("hash", t.body_hash)("out", json_size) );
+            }
          }
 
          template<class T>
          static void handle_exception(typename websocketpp::server<T>::connection_ptr con) {
             string err = "Internal Service error, http: ";
+            metrics().errors.inc();
             try {
                con->set_status( websocketpp::http::status_code::internal_server_error );
                try {
@@ -264,6 +449,8 @@ namespace roxe {
 
          template<class T>
          void handle_http_request(typename websocketpp::server<T>::connection_ptr con) {
+            request_timing timing;
+            timing.received = fc::time_point::now();
             try {
                auto& req = con->get_request();
 
@@ -292,6 +479,7 @@ namespace roxe {
 
                if( bytes_in_flight > max_bytes_in_flight ) {
                   dlog( "503 - too many bytes in flight: ${bytes}", ("bytes", bytes_in_flight.load()) );
+                  metrics().busy.inc();
                   error_results results{websocketpp::http::status_code::too_many_requests, "Busy", error_results::error_info()};
                   con->set_body( fc::json::to_string( results ));
                   con->set_status( websocketpp::http::status_code::too_many_requests );
@@ -301,35 +489,59 @@ namespace roxe {
                std::string body = con->get_request_body();
                std::string resource = con->get_uri()->get_resource();
                auto handler_itr = url_handlers.find( resource );
-               if( handler_itr != url_handlers.end()) {
+               auto json_handler_itr = json_url_handlers.find( resource );
+               if( handler_itr != url_handlers.end() || json_handler_itr != json_url_handlers.end() ) {
                   con->defer_http_response();
                   bytes_in_flight += body.size();
-                  app().post( appbase::priority::low,
-                              [&ioc = thread_pool->get_executor(), &bytes_in_flight = this->bytes_in_flight, handler_itr,
-                               resource{std::move( resource )}, body{std::move( body )}, con]() {
+                  metrics().requests.inc();
+                  metrics().request_bytes.inc( body.size() );
+                  timing.endpoint = endpoints.at( resource ).get();
+                  timing.endpoint->requests.inc();
+                  timing.body_size = body.size();
+                  if( slow_request_time.count() > 0 )
+                     timing.body_hash = fc::sha256::hash( body );
+                  timing.dispatched = fc::time_point::now();
+                  const bool renders_json = handler_itr == url_handlers.end();
+                  const bool on_threads = read_only_on_threads && read_only_urls.count( resource );
+                  auto call = [&ioc = thread_pool->get_executor(), &bytes_in_flight = this->bytes_in_flight, handler_itr, json_handler_itr,
+                               renders_json, resource{std::move( resource )}, body{std::move( body )}, con, timing]() mutable {
+                     timing.started = fc::time_point::now();
                      try {
-                        handler_itr->second( resource, body,
-                              [&ioc, &bytes_in_flight, con]( int code, fc::variant response_body ) {
-                           boost::asio::post( ioc, [response_body{std::move( response_body )}, &bytes_in_flight, con, code]() mutable {
-                              std::string json = fc::json::to_string( response_body );
-                              response_body.clear();
-                              const size_t json_size = json.size();
-                              bytes_in_flight += json_size;
-                              con->set_body( std::move( json ) );
-                              con->set_status( websocketpp::http::status_code::value( code ) );
-                              con->send_http_response();
-                              bytes_in_flight -= json_size;
-                           } );
-                        });
+                        if( renders_json ) {
+                           json_handler_itr->second( resource, body,
+                                 [&ioc, &bytes_in_flight, con, timing]( int code, std::string json ) mutable {
+                              timing.responded = fc::time_point::now();
+                              boost::asio::post( ioc, [json{std::move( json )}, &bytes_in_flight, con, code, timing]() mutable {
+                                 send_response<T>( con, code, std::move( json ), bytes_in_flight, timing, fc::microseconds() );
+                              } );
+                           });
+                        } else {
+                           handler_itr->second( resource, body,
+                                 [&ioc, &bytes_in_flight, con, timing]( int code, fc::variant response_body ) mutable {
+                              timing.responded = fc::time_point::now();
+                              boost::asio::post( ioc, [response_body{std::move( response_body )}, &bytes_in_flight, con, code, timing]() mutable {
+                                 const auto serialize_start = fc::time_point::now();
+                                 std::string json = fc::json::to_string( response_body );
+                                 response_body.clear();
+                                 send_response<T>( con, code, std::move( json ), bytes_in_flight, timing, fc::time_point::now() - serialize_start );
+                              } );
+                           });
+                        }
                         bytes_in_flight -= body.size();
                      } catch( ... ) {
                         handle_exception<T>( con );
                         con->send_http_response();
                      }
-                  } );
+                  };
+                  if( on_threads ) {
+                     queue_read_only( std::move( call ) );
+                  } else {
+                     app().post( appbase::priority::low, std::move( call ) );
+                  }
 
                } else {
                   dlog( "404 - not found: ${ep}", ("ep", resource));
+                  metrics().not_found.inc();
                   error_results results{websocketpp::http::status_code::not_found,
                                         "Not Found", error_results::error_info(fc::exception( FC_LOG_MESSAGE( error, "Unknown Endpoint" )), verbose_http_errors )};
                   con->set_body( fc::json::to_string( results ));
@@ -407,6 +619,10 @@ namespace roxe {
             })->default_value(SECP384R1),
             "Configure https ECDH curve to use: secp384r1 or prime256v1")
 
+            ("https-session-cache-size", bpo::value<uint32_t>()->default_value(20480),
+             "Number of TLS sessions cached so that returning https clients can resume them without a full handshake. Session tickets are "
+             "issued as well. 0 disables session resumption.")
+
             ("access-control-allow-origin", bpo::value<string>()->notifier([this](const string& v) {
                 my->access_control_allow_origin = v;
                 ilog("configured http with Access-Control-Allow-Origin: ${o}", ("o", my->access_control_allow_origin));
@@ -443,6 +659,10 @@ namespace roxe {
              "Additionaly acceptable values for the \"Host\" header of incoming HTTP requests, can be specified multiple times.  Includes http/s_server_address by default.")
             ("http-threads", bpo::value<uint16_t>()->default_value( my->thread_pool_size ),
              "Number of worker threads in http thread pool")
+            ("http-read-only-on-threads", bpo::value<bool>()->default_value( my->read_only_on_threads ),
+             "Execute read-only API calls on the http thread pool, in batches during which the main thread waits, instead of one by one on the main thread")
+            ("http-slow-request-ms", bpo::value<uint32_t>()->default_value(0),
+             "Log requests taking at least this many milliseconds, with the time of each phase and the sha256 of the request body, to the http_slow_requests logger; 0 disables the log")
             ;
    }
 
@@ -503,6 +723,7 @@ namespace roxe {
                      ("h", host)( "p", port ));
                my->https_cert_chain = options.at( "https-certificate-chain-file" ).as<string>();
                my->https_key = options.at( "https-private-key-file" ).as<string>();
+               my->https_session_cache_size = options.at( "https-session-cache-size" ).as<uint32_t>();
             } catch ( const boost::system::system_error& ec ) {
                elog( "failed to configure https to listen on ${h}:${p} (${m})",
                      ("h", host)( "p", port )( "m", ec.what()));
@@ -522,12 +743,15 @@ namespace roxe {
                      "http-threads ${num} must be greater than 0", ("num", my->thread_pool_size));
 
          my->max_bytes_in_flight = options.at( "http-max-bytes-in-flight-mb" ).as<uint32_t>() * 1024 * 1024;
+         my->read_only_on_threads = options.at( "http-read-only-on-threads" ).as<bool>();
+         slow_request_time = fc::milliseconds( options.at( "http-slow-request-ms" ).as<uint32_t>() );
 
          //watch out for the returns above when adding new code here
       } FC_LOG_AND_RETHROW()
    }
 
    void http_plugin::plugin_startup() {
+      handle_sighup(); // sets the slow request logger
 
       my->thread_pool.emplace( "http", my->thread_pool_size );
 
@@ -574,9 +798,10 @@ namespace roxe {
 
       if(my->https_listen_endpoint) {
          try {
+            my->create_tls_context();
             my->create_server_for_endpoint(*my->https_listen_endpoint, my->https_server);
             my->https_server.set_tls_init_handler([this](websocketpp::connection_hdl hdl) -> ssl_context_ptr{
-               return my->on_tls_init(hdl);
+               return my->https_context;
             });
 
             ilog("start listening for https requests");
@@ -621,9 +846,22 @@ namespace roxe {
       }
    }
 
-   void http_plugin::add_handler(const string& url, const url_handler& handler) {
+   void http_plugin::handle_sighup() {
+      fc::logger::update( slow_request_logger_name, slow_request_log );
+   }
+
+   void http_plugin::add_handler(const string& url, const url_handler& handler, bool read_only) {
       ilog( "add api url: ${c}", ("c",url) );
       my->url_handlers.insert(std::make_pair(url,handler));
+      my->endpoints.emplace(url, std::make_unique<endpoint_metrics>(url));
+      if( read_only ) my->read_only_urls.insert(url);
+   }
+
+   void http_plugin::add_json_handler(const string& url, const json_url_handler& handler, bool read_only) {
+      ilog( "add api url: ${c}", ("c",url) );
+      my->json_url_handlers.insert(std::make_pair(url,handler));
+      my->endpoints.emplace(url, std::make_unique<endpoint_metrics>(url));
+      if( read_only ) my->read_only_urls.insert(url);
    }
 
    void http_plugin::handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb ) {
@@ -689,6 +927,9 @@ namespace roxe {
          if (handler.first != "/v1/node/get_supported_apis")
             result.apis.emplace_back(handler.first);
       }
+      for (const auto& handler : my->json_url_handlers) {
+         result.apis.emplace_back(handler.first);
+      }
 
       return result;
    }
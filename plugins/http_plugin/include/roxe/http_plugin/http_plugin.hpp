@@ -31,6 +31,22 @@ namespace roxe {
     **/
    using url_handler = std::function<void(string,string,url_response_callback)>;
 
+   /**
+    * @brief A callback function provided to a json_url_handler to
+    * specify the HTTP response code and a body which already is JSON text
+    *
+    * Arguments: response_code, response_json
+    */
+   using url_response_json_callback = std::function<void(int,string)>;
+
+   /**
+    * @brief Callback type for a URL handler which writes its response as JSON text itself,
+    * e.g. with an fc::json_writer, instead of returning an fc::variant to be converted
+    *
+    * Arguments: url, request_body, response_json_callback
+    **/
+   using json_url_handler = std::function<void(string,string,url_response_json_callback)>;
+
    /**
     * @brief An API, containing URLs and handlers
     *
@@ -39,6 +55,7 @@ namespace roxe {
     * call, and the handler is the function which implements the API call
     */
    using api_description = std::map<string, url_handler>;
+   using json_api_description = std::map<string, json_url_handler>;
 
    struct http_plugin_defaults {
       //If empty, unix socket support will be completely disabled. If not empty,
@@ -79,11 +96,22 @@ namespace roxe {
         void plugin_initialize(const variables_map& options);
         void plugin_startup();
         void plugin_shutdown();
-
-        void add_handler(const string& url, const url_handler&);
-        void add_api(const api_description& api) {
+        void handle_sighup() override;
+
+        /**
+         * A read_only handler only reads state modified by the main thread and is safe to call on several threads
+         * at once. With http-read-only-on-threads such handlers are executed on the http thread pool, while the
+         * main thread waits; all other handlers are executed on the main thread.
+         */
+        void add_handler(const string& url, const url_handler&, bool read_only = false);
+        void add_json_handler(const string& url, const json_url_handler&, bool read_only = false);
+        void add_api(const api_description& api, bool read_only = false) {
+           for (const auto& call : api)
+              add_handler(call.first, call.second, read_only);
+        }
+        void add_json_api(const json_api_description& api, bool read_only = false) {
            for (const auto& call : api)
-              add_handler(call.first, call.second);
+              add_json_handler(call.first, call.second, read_only);
         }
 
         // standard exception handling for api handlers
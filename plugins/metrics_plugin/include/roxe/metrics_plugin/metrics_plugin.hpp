@@ -0,0 +1,37 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <appbase/application.hpp>
+#include <roxe/chain_plugin/chain_plugin.hpp>
+
+namespace roxe {
+
+using namespace appbase;
+typedef std::shared_ptr<class metrics_plugin_impl> metrics_ptr;
+
+/**
+ *  Serves the process wide fc::metrics::registry in the Prometheus text format from its own listener and thread,
+ *  so scrapes never wait on, or add work to, the main thread. Other plugins register and update their metrics
+ *  whether or not this plugin is enabled; this plugin adds the chain's own (head, last irreversible block, blocks
+ *  and transactions) from the controller's signals, and the main thread's queue length, wait and run times by
+ *  priority and the busiest sites handlers are posted from.
+ */
+class metrics_plugin : public plugin<metrics_plugin> {
+public:
+   APPBASE_PLUGIN_REQUIRES((chain_plugin))
+
+   metrics_plugin();
+   virtual ~metrics_plugin();
+
+   virtual void set_program_options(options_description& cli, options_description& cfg) override;
+   void plugin_initialize(const variables_map& options);
+   void plugin_startup();
+   void plugin_shutdown();
+
+private:
+   metrics_ptr my;
+};
+
+} // namespace roxe
@@ -0,0 +1,362 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/metrics_plugin/metrics_plugin.hpp>
+#include <roxe/chain/block_state.hpp>
+
+#include <fc/log/logger_config.hpp>
+#include <fc/metrics.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/signals2/connection.hpp>
+
+#include <cstring>
+#include <thread>
+
+namespace roxe {
+   using namespace chain;
+   using boost::signals2::scoped_connection;
+   using boost::asio::ip::tcp;
+
+   static appbase::abstract_plugin& _metrics_plugin = app().register_plugin<metrics_plugin>();
+
+   namespace {
+      std::string priority_label( int priority ) {
+         switch( priority ) {
+            case priority::high:   return "{priority=\"high\"}";
+            case priority::medium: return "{priority=\"medium\"}";
+            case priority::low:    return "{priority=\"low\"}";
+            default:               return "{priority=\"" + std::to_string( priority ) + "\"}";
+         }
+      }
+
+      /// drops the asio wrappers around the posted lambda and what breaks the label quoting
+      std::string site_label( std::string name ) {
+         for( const char* noise : { ", appbase::execution_priority_queue::executor", "boost::asio::detail::", "boost::asio::" } ) {
+            for( auto pos = name.find( noise ); pos != std::string::npos; pos = name.find( noise ) )
+               name.erase( pos, strlen( noise ) );
+         }
+         std::string label = "{site=\"";
+         for( char c : name.substr( 0, 240 ) ) {
+            if( c == '"' || c == '\\' ) label += '\\';
+            label += c;
+         }
+         return label + "\"}";
+      }
+
+      void append_histogram( std::string& out, const std::string& name, const std::string& label,
+                             const appbase::execution_stats::histogram& h ) {
+         uint64_t total = 0;
+         for( size_t i = 0; i < h.counts.size(); ++i ) {
+            total += h.counts[i];
+            const std::string le = i + 1 < h.counts.size() ? std::to_string( h.bound_us( i ) / 1e6 ) : "+Inf";
+            out += name + "_bucket" + label.substr( 0, label.size() - 1 ) + ",le=\"" + le + "\"} " + std::to_string( total ) + "\n";
+         }
+         out += name + "_sum" + label + " " + std::to_string( h.sum_us / 1e6 ) + "\n";
+         out += name + "_count" + label + " " + std::to_string( h.count ) + "\n";
+      }
+
+      /// the main thread's queue keeps its own counters, appbase does not depend on fc
+      std::string render_priority_queue( const appbase::execution_stats& stats ) {
+         std::string out;
+         out += "# HELP roxe_app_queue_length Handlers waiting to run on the main thread\n"
+                "# TYPE roxe_app_queue_length gauge\n";
+         for( const auto& l : stats.levels )
+            out += "roxe_app_queue_length" + priority_label( l.first ) + " " + std::to_string( l.second.queued ) + "\n";
+         out += "# HELP roxe_app_queue_wait_seconds Time handlers waited in the main thread's queue\n"
+                "# TYPE roxe_app_queue_wait_seconds histogram\n";
+         for( const auto& l : stats.levels )
+            append_histogram( out, "roxe_app_queue_wait_seconds", priority_label( l.first ), l.second.wait_us );
+         out += "# HELP roxe_app_queue_run_seconds Time handlers ran on the main thread\n"
+                "# TYPE roxe_app_queue_run_seconds histogram\n";
+         for( const auto& l : stats.levels )
+            append_histogram( out, "roxe_app_queue_run_seconds", priority_label( l.first ), l.second.run_us );
+         out += "# HELP roxe_app_queue_site_run_seconds_total Main thread time of the handlers posted from a site, the busiest sites only\n"
+                "# TYPE roxe_app_queue_site_run_seconds_total counter\n";
+         for( const auto& site : stats.sites )
+            out += "roxe_app_queue_site_run_seconds_total" + site_label( site.name ) + " " + std::to_string( site.run_us / 1e6 ) + "\n";
+         out += "# HELP roxe_app_queue_site_executed_total Handlers posted from a site that ran, the busiest sites only\n"
+                "# TYPE roxe_app_queue_site_executed_total counter\n";
+         for( const auto& site : stats.sites )
+            out += "roxe_app_queue_site_executed_total" + site_label( site.name ) + " " + std::to_string( site.executed ) + "\n";
+         out += "# HELP roxe_app_queue_site_max_run_seconds Longest run of a handler posted from a site, the busiest sites only\n"
+                "# TYPE roxe_app_queue_site_max_run_seconds gauge\n";
+         for( const auto& site : stats.sites )
+            out += "roxe_app_queue_site_max_run_seconds" + site_label( site.name ) + " " + std::to_string( site.max_run_us / 1e6 ) + "\n";
+         return out;
+      }
+   }
+
+   /// A single request and response; scrapers open a connection per scrape
+   class metrics_session : public std::enable_shared_from_this<metrics_session> {
+      public:
+         static constexpr size_t max_request_size = 8192;
+
+         explicit metrics_session( tcp::socket s )
+         :socket( std::move( s ) ), request( max_request_size ) {}
+
+         void start() {
+            boost::asio::async_read_until( socket, request, "\r\n\r\n",
+                  [self = shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               if( ec ) return;
+               self->respond();
+            });
+         }
+
+      private:
+         void respond() {
+            std::istream in( &request );
+            std::string method, target;
+            in >> method >> target;
+            const auto query = target.find( '?' );
+            if( query != std::string::npos )
+               target.resize( query );
+
+            std::string body;
+            std::string status = "200 OK";
+            if( method != "GET" && method != "HEAD" ) {
+               status = "405 Method Not Allowed";
+            } else if( target != "/metrics" ) {
+               status = "404 Not Found";
+            } else {
+               body = fc::metrics::registry::instance().render();
+               auto& queue = app().get_priority_queue();
+               if( queue.stats_enabled() )
+                  body += render_priority_queue( queue.get_stats() );
+            }
+            response = "HTTP/1.1 " + status + "\r\n"
+                       "Content-Type: text/plain; version=0.0.4\r\n"
+                       "Content-Length: " + std::to_string( body.size() ) + "\r\n"
+                       "Connection: close\r\n\r\n";
+            if( method != "HEAD" )
+               response += body;
+            boost::asio::async_write( socket, boost::asio::buffer( response ),
+                  [self = shared_from_this()]( const boost::system::error_code&, size_t ) {
+               boost::system::error_code ec;
+               self->socket.shutdown( tcp::socket::shutdown_both, ec );
+            });
+         }
+
+         tcp::socket            socket;
+         boost::asio::streambuf request;
+         std::string            response;
+   };
+
+   class metrics_plugin_impl {
+      public:
+         fc::optional<scoped_connection> accepted_block_connection;
+         fc::optional<scoped_connection> irreversible_block_connection;
+
+         fc::metrics::registry& r = fc::metrics::registry::instance();
+         fc::metrics::gauge&   head_block_num;
+         fc::metrics::gauge&   head_block_time;
+         fc::metrics::gauge&   lib_num;
+         fc::metrics::gauge&   lib_lag;
+         fc::metrics::counter& blocks;
+         fc::metrics::counter& transactions;
+         fc::metrics::counter& cpu_usage_us;
+         fc::metrics::counter& net_usage_words;
+         fc::metrics::counter& released_trx_metas;
+         fc::metrics::counter& released_trx_meta_bytes;
+         controller::released_trx_metas last_released;
+
+         /// adds what an undo stack operation did since the last update
+         struct undo_operation_metrics {
+            undo_operation_metrics( fc::metrics::registry& r, const char* op )
+            :count( r.add_counter( "roxe_chainbase_operations_total", "Undo stack operations over all indices", {{"op", op}} ) )
+            ,us( r.add_counter( "roxe_chainbase_operation_us_total", "Microseconds spent in undo stack operations", {{"op", op}} ) )
+            ,max( r.add_gauge( "roxe_chainbase_operation_max_us", "Longest undo stack operation since start", {{"op", op}} ) ) {}
+
+            void update( const chainbase::database::operation_timing& t ) {
+               count.inc( t.count - last_count );
+               us.inc( t.total_ns / 1000 - last_us );
+               max.set( t.max_ns / 1000 );
+               last_count = t.count;
+               last_us = t.total_ns / 1000;
+            }
+
+            fc::metrics::counter& count;
+            fc::metrics::counter& us;
+            fc::metrics::gauge&   max;
+            uint64_t              last_count = 0;
+            uint64_t              last_us = 0;
+         };
+
+         fc::metrics::gauge&   state_size;
+         fc::metrics::gauge&   state_free;
+         fc::metrics::gauge&   state_free_above_guard;
+         fc::metrics::gauge&   state_largest_free_block;
+         fc::metrics::gauge&   undo_revisions;
+         fc::metrics::gauge&   undo_bytes;
+         undo_operation_metrics undo_ops;
+         undo_operation_metrics squash_ops;
+         undo_operation_metrics commit_ops;
+
+         tcp::endpoint                  endpoint;
+         boost::asio::io_context        ioc;
+         fc::optional<tcp::acceptor>    acceptor;
+         std::thread                    thread;
+
+         metrics_plugin_impl()
+         :head_block_num( r.add_gauge( "roxe_chain_head_block_num", "Number of the head block" ) )
+         ,head_block_time( r.add_gauge( "roxe_chain_head_block_time_seconds",
+                                      "Timestamp of the head block in seconds since the epoch, time() minus this is the head lag" ) )
+         ,lib_num( r.add_gauge( "roxe_chain_last_irreversible_block_num", "Number of the last irreversible block" ) )
+         ,lib_lag( r.add_gauge( "roxe_chain_irreversible_lag_blocks", "Blocks between the head and the last irreversible block" ) )
+         ,blocks( r.add_counter( "roxe_chain_blocks_total", "Blocks accepted, produced or received" ) )
+         ,transactions( r.add_counter( "roxe_chain_block_transactions_total", "Transactions in accepted blocks" ) )
+         ,cpu_usage_us( r.add_counter( "roxe_chain_block_cpu_usage_us_total", "Billed cpu of the transactions in accepted blocks" ) )
+         ,net_usage_words( r.add_counter( "roxe_chain_block_net_usage_words_total", "Billed net of the transactions in accepted blocks" ) )
+         ,released_trx_metas( r.add_counter( "roxe_chain_block_trx_metas_released_total",
+                                             "Transaction metadata dropped by block states once their block was applied" ) )
+         ,released_trx_meta_bytes( r.add_counter( "roxe_chain_block_trx_metas_released_bytes_total",
+                                                  "Approximate bytes freed by dropping the transaction metadata of applied blocks" ) )
+         ,state_size( r.add_gauge( "roxe_chainbase_size_bytes", "Size of the state segment" ) )
+         ,state_free( r.add_gauge( "roxe_chainbase_free_bytes", "Free bytes of the state segment" ) )
+         ,state_free_above_guard( r.add_gauge( "roxe_chainbase_free_above_guard_bytes",
+                                               "Free bytes above chain-state-db-guard-size-mb, database_guard_exception is thrown below zero" ) )
+         ,state_largest_free_block( r.add_gauge( "roxe_chainbase_largest_free_block_bytes",
+                                                 "Largest allocation the state segment can satisfy, far below the free bytes when fragmented" ) )
+         ,undo_revisions( r.add_gauge( "roxe_chainbase_undo_revisions", "Revisions that can still be undone" ) )
+         ,undo_bytes( r.add_gauge( "roxe_chainbase_undo_bytes", "Bytes of the object copies held by the undo stacks of all indices" ) )
+         ,undo_ops( r, "undo" )
+         ,squash_ops( r, "squash" )
+         ,commit_ops( r, "commit" )
+         {}
+
+         /// the undo stacks are summed per revision, no index is walked
+         void update_state( const controller& chain ) {
+            const auto& db = chain.db();
+            const int64_t free = db.get_free_memory();
+            state_size.set( db.get_segment_manager()->get_size() );
+            state_free.set( free );
+            state_free_above_guard.set( free - static_cast<int64_t>( chain.state_guard_size() ) );
+            state_largest_free_block.set( db.get_largest_free_block() );
+
+            int64_t bytes = 0;
+            for( const auto& i : db.undo_usage_per_index() ) {
+               bytes += i.usage.bytes;
+               r.add_gauge( "roxe_chainbase_index_undo_bytes", "Bytes of the object copies held by the undo stack of an index",
+                            {{"index", i.type_name}} ).set( i.usage.bytes );
+            }
+            undo_bytes.set( bytes );
+            const auto range = db.undo_stack_revision_range();
+            undo_revisions.set( range.second - range.first );
+
+            const auto& timings = db.get_undo_timings();
+            undo_ops.update( timings.undo );
+            squash_ops.update( timings.squash );
+            commit_ops.update( timings.commit );
+         }
+
+         void update_head( const controller& chain ) {
+            head_block_num.set( chain.head_block_num() );
+            head_block_time.set( chain.head_block_time().sec_since_epoch() );
+            lib_num.set( chain.last_irreversible_block_num() );
+            lib_lag.set( chain.head_block_num() - chain.last_irreversible_block_num() );
+         }
+
+         void on_accepted_block( const controller& chain, const block_state_ptr& bsp ) {
+            blocks.inc();
+            transactions.inc( bsp->block->transactions.size() );
+            uint64_t cpu = 0, net = 0;
+            for( const auto& receipt : bsp->block->transactions ) {
+               cpu += receipt.cpu_usage_us;
+               net += receipt.net_usage_words;
+            }
+            cpu_usage_us.inc( cpu );
+            net_usage_words.inc( net );
+            // the metadata of a block is released after its accepted_block signal, so this lags one block
+            const auto& released = chain.get_released_trx_metas();
+            released_trx_metas.inc( released.trxs - last_released.trxs );
+            released_trx_meta_bytes.inc( released.bytes - last_released.bytes );
+            last_released = released;
+            update_head( chain );
+            update_state( chain );
+         }
+
+         void do_accept() {
+            acceptor->async_accept( [this]( const boost::system::error_code& ec, tcp::socket socket ) {
+               if( ec == boost::asio::error::operation_aborted )
+                  return;
+               if( !ec )
+                  std::make_shared<metrics_session>( std::move( socket ) )->start();
+               do_accept();
+            });
+         }
+   };
+
+   metrics_plugin::metrics_plugin()
+   :my(std::make_shared<metrics_plugin_impl>()) {
+   }
+
+   metrics_plugin::~metrics_plugin() {
+   }
+
+   void metrics_plugin::set_program_options(options_description& cli, options_description& cfg) {
+      cfg.add_options()
+            ("metrics-endpoint", bpo::value<string>()->default_value("127.0.0.1:9101"),
+             "The local IP and port to serve Prometheus metrics at /metrics on. Caution: only expose this port to your "
+             "internal network.")
+            ("metrics-priority-queue", bpo::value<bool>()->default_value(true),
+             "Time every handler run on the main thread, by priority and by the site it was posted from. Tells which "
+             "plugin delays block processing, at the cost of two clock reads and a lock per handler.")
+            ;
+   }
+
+   void metrics_plugin::plugin_initialize(const variables_map& options) {
+      try {
+         auto* chain_plug = app().find_plugin<chain_plugin>();
+         ROXE_ASSERT( chain_plug, chain::missing_chain_plugin_exception, "" );
+         auto& chain = chain_plug->chain();
+
+         const auto ip_port = options.at( "metrics-endpoint" ).as<string>();
+         const auto colon = ip_port.rfind( ':' );
+         ROXE_ASSERT( colon != string::npos, chain::plugin_config_exception, "metrics-endpoint ${e} is not host:port", ("e", ip_port) );
+         tcp::resolver resolver( my->ioc );
+         my->endpoint = *resolver.resolve( ip_port.substr( 0, colon ), ip_port.substr( colon + 1 ) ).begin();
+
+         app().get_priority_queue().enable_stats( options.at( "metrics-priority-queue" ).as<bool>() );
+
+         my->accepted_block_connection.emplace(
+               chain.accepted_block.connect( [&]( const block_state_ptr& bsp ) {
+                  my->on_accepted_block( chain, bsp );
+               } ));
+         my->irreversible_block_connection.emplace(
+               chain.irreversible_block.connect( [&]( const block_state_ptr& ) {
+                  my->update_head( chain );
+               } ));
+      } FC_LOG_AND_RETHROW()
+   }
+
+   void metrics_plugin::plugin_startup() {
+      my->update_head( app().get_plugin<chain_plugin>().chain() );
+      my->update_state( app().get_plugin<chain_plugin>().chain() );
+
+      my->acceptor.emplace( my->ioc );
+      my->acceptor->open( my->endpoint.protocol() );
+      my->acceptor->set_option( tcp::acceptor::reuse_address( true ) );
+      boost::system::error_code ec;
+      my->acceptor->bind( my->endpoint, ec );
+      ROXE_ASSERT( !ec, chain::plugin_config_exception, "unable to listen for metrics on ${e}: ${m}",
+                   ("e", my->endpoint.address().to_string() + ":" + std::to_string( my->endpoint.port() ))("m", ec.message()) );
+      my->acceptor->listen();
+      my->do_accept();
+      my->thread = std::thread( [this]() {
+         fc::set_os_thread_name( "metrics" );
+         my->ioc.run();
+      });
+      ilog( "serving metrics on ${e}", ("e", my->endpoint.address().to_string() + ":" + std::to_string( my->endpoint.port() )) );
+   }
+
+   void metrics_plugin::plugin_shutdown() {
+      my->accepted_block_connection.reset();
+      my->irreversible_block_connection.reset();
+      my->ioc.stop();
+      if( my->thread.joinable() )
+         my->thread.join();
+      my->acceptor.reset();
+   }
+
+}
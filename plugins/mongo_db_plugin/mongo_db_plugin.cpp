@@ -8,6 +8,7 @@
 #include <roxe/chain/exceptions.hpp>
 #include <roxe/chain/transaction.hpp>
 #include <roxe/chain/types.hpp>
+#include <roxe/chain/thread_utils.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/log/logger_config.hpp>
@@ -21,6 +22,7 @@
 #include <queue>
 #include <thread>
 #include <mutex>
+#include <functional>
 
 #include <bsoncxx/builder/basic/kvp.hpp>
 #include <bsoncxx/builder/basic/document.hpp>
@@ -66,11 +68,47 @@ struct filter_entry {
    }
 };
 
+/**
+ * The consume thread takes the queued signals in batches. Converting them to BSON is spread over the conversion
+ * threads, the resulting writes are handed to the writer threads, each with its own connection and owning some
+ * of the collections, which write them in bulks. The accounts, pub_keys and account_controls collections are
+ * updated by the consume thread itself, in order, as they provide the abis used for the conversion.
+ */
 class mongo_db_plugin_impl {
 public:
    mongo_db_plugin_impl();
    ~mongo_db_plugin_impl();
 
+   /// collections written by the writer threads
+   enum class collection_id : uint8_t {
+      action_traces,
+      trans_traces,
+      trans,
+      blocks,
+      block_states,
+      count
+   };
+
+   struct pending_write {
+      collection_id          collection;
+      bool                   ordered; ///< false if the write touches a document no other write of its bulk touches
+      mongocxx::model::write op;
+   };
+
+   struct writer {
+      std::vector<std::deque<pending_write>> queues{ static_cast<size_t>(collection_id::count) };
+      size_t                                 queued = 0;
+      bool                                   done = false;
+      std::mutex                             mtx;
+      std::condition_variable                condition;
+      std::thread                            thread;
+   };
+
+   static pending_write make_insert( collection_id c, bsoncxx::document::value doc );
+   static pending_write make_update( collection_id c, bsoncxx::document::value filter, bsoncxx::document::value update,
+                                     bool upsert, bool ordered );
+   static const std::string& collection_name( collection_id c );
+
    fc::optional<boost::signals2::scoped_connection> accepted_block_connection;
    fc::optional<boost::signals2::scoped_connection> irreversible_block_connection;
    fc::optional<boost::signals2::scoped_connection> accepted_transaction_connection;
@@ -82,25 +120,35 @@ public:
    void applied_irreversible_block(const chain::block_state_ptr&);
    void accepted_transaction(const chain::transaction_metadata_ptr&);
    void applied_transaction(const chain::transaction_trace_ptr&);
-   void process_accepted_transaction(const chain::transaction_metadata_ptr&);
-   void _process_accepted_transaction(const chain::transaction_metadata_ptr&);
-   void process_applied_transaction(const chain::transaction_trace_ptr&);
-   void _process_applied_transaction(const chain::transaction_trace_ptr&);
-   void process_accepted_block( const chain::block_state_ptr& );
-   void _process_accepted_block( const chain::block_state_ptr& );
-   void process_irreversible_block(const chain::block_state_ptr&);
-   void _process_irreversible_block(const chain::block_state_ptr&);
+   void process_accepted_transaction(const chain::transaction_metadata_ptr&, std::vector<pending_write>& writes);
+   void _process_accepted_transaction(const chain::transaction_metadata_ptr&, std::vector<pending_write>& writes);
+   void process_applied_transaction(const chain::transaction_trace_ptr&, std::vector<pending_write>& writes);
+   void _process_applied_transaction(const chain::transaction_trace_ptr&, std::vector<pending_write>& writes);
+   void process_accepted_block( const chain::block_state_ptr&, std::vector<pending_write>& writes );
+   void _process_accepted_block( const chain::block_state_ptr&, std::vector<pending_write>& writes );
+   void process_irreversible_block(const chain::block_state_ptr&, std::vector<pending_write>& writes);
+   void _process_irreversible_block(const chain::block_state_ptr&, std::vector<pending_write>& writes);
+
+   /// calls f for [0, count) on the conversion threads and appends the writes in that order
+   void convert( size_t count, const std::function<void( size_t, std::vector<pending_write>& )>& f,
+                 std::vector<pending_write>& writes );
+   void dispatch( std::vector<pending_write>& writes );
+   void run_writer( writer& w );
+   void write_bulks( mongocxx::collection& collection, std::deque<pending_write>& writes );
+   void stop_writers();
 
    optional<abi_serializer> get_abi_serializer( account_name n );
    template<typename T> fc::variant to_variant_with_abi( const T& obj );
 
    void purge_abi_cache();
 
-   bool add_action_trace( mongocxx::bulk_write& bulk_action_traces, const chain::action_trace& atrace,
+   bool add_action_trace( std::vector<pending_write>& writes, const chain::action_trace& atrace,
                           const chain::transaction_trace_ptr& t,
-                          bool executed, const std::chrono::milliseconds& now,
+                          const std::chrono::milliseconds& now,
                           bool& write_ttrace );
 
+   static bool updates_abi( const chain::transaction_trace_ptr& t );
+   void update_accounts( const chain::transaction_trace_ptr& t );
    void update_account(const chain::action& act);
 
    void add_pub_keys( const vector<chain::key_weight>& keys, const account_name& name,
@@ -120,7 +168,8 @@ public:
    void wipe_database();
    void create_expiration_index(mongocxx::collection& collection, uint32_t expire_after_seconds);
 
-   template<typename Queue, typename Entry> void queue(Queue& queue, const Entry& e);
+   /// called on the main thread, takes e unless the queue stays full according to full_policy
+   template<typename Queue, typename Entry> void queue(Queue& queue, Entry e);
 
    bool configured{false};
    bool wipe_database_on_startup{false};
@@ -143,19 +192,28 @@ public:
    mongocxx::instance mongo_inst;
    fc::optional<mongocxx::pool> mongo_pool;
 
-   // consum thread
+   // consume thread
    mongocxx::collection _accounts;
-   mongocxx::collection _trans;
-   mongocxx::collection _trans_traces;
-   mongocxx::collection _action_traces;
-   mongocxx::collection _block_states;
-   mongocxx::collection _blocks;
    mongocxx::collection _pub_keys;
    mongocxx::collection _account_controls;
 
+   enum class queue_full_policy {
+      block, ///< wait for the consume thread, at most max_queue_wait if set, then drop
+      drop
+   };
+
    size_t max_queue_size = 0;
-   int queue_sleep_time = 0;
+   queue_full_policy full_policy = queue_full_policy::block;
+   fc::microseconds max_queue_wait;
+   std::atomic<uint64_t> dropped_entries{0};
    size_t abi_cache_size = 0;
+   uint32_t convert_threads = 2;
+   uint32_t writer_threads = 2;
+   uint32_t bulk_size = 2500;
+   fc::optional<chain::named_thread_pool>  convert_thread_pool;
+   std::vector<std::unique_ptr<writer>>    writers;
+   /// accepted blocks handed to the writers which did not become irreversible yet
+   std::set<std::pair<uint32_t, block_id_type>> stored_blocks;
    std::deque<chain::transaction_metadata_ptr> transaction_metadata_queue;
    std::deque<chain::transaction_metadata_ptr> transaction_metadata_process_queue;
    std::deque<chain::transaction_trace_ptr> transaction_trace_queue;
@@ -166,6 +224,7 @@ public:
    std::deque<chain::block_state_ptr> irreversible_block_state_process_queue;
    std::mutex mtx;
    std::condition_variable condition;
+   std::condition_variable queue_space; ///< notified when the consume thread took the queues
    std::thread consume_thread;
    std::atomic_bool done{false};
    std::atomic_bool startup{true};
@@ -189,6 +248,8 @@ public:
    > abi_cache_index_t;
 
    abi_cache_index_t abi_cache_index;
+   /// guards the abi cache and its reads of the accounts collection, used by the conversion threads
+   std::mutex abi_cache_mtx;
 
    static const action_name newaccount;
    static const action_name setabi;
@@ -291,22 +352,33 @@ bool mongo_db_plugin_impl::filter_include( const transaction& trx ) const
 
 
 template<typename Queue, typename Entry>
-void mongo_db_plugin_impl::queue( Queue& queue, const Entry& e ) {
+void mongo_db_plugin_impl::queue( Queue& queue, Entry e ) {
    std::unique_lock<std::mutex> lock( mtx );
-   auto queue_size = queue.size();
-   if( queue_size > max_queue_size ) {
-      lock.unlock();
-      condition.notify_one();
-      queue_sleep_time += 10;
-      if( queue_sleep_time > 1000 )
-         wlog("queue size: ${q}", ("q", queue_size));
-      std::this_thread::sleep_for( std::chrono::milliseconds( queue_sleep_time ));
-      lock.lock();
-   } else {
-      queue_sleep_time -= 10;
-      if( queue_sleep_time < 0 ) queue_sleep_time = 0;
+   if( queue.size() >= max_queue_size && !done ) {
+      bool has_space = false;
+      if( full_policy == queue_full_policy::block ) {
+         const auto queue_size = queue.size();
+         const auto start = fc::time_point::now();
+         auto space_available = [&]() { return queue.size() < max_queue_size || done; };
+         condition.notify_one();
+         if( max_queue_wait == fc::microseconds() ) {
+            queue_space.wait( lock, space_available );
+            has_space = true;
+         } else {
+            has_space = queue_space.wait_for( lock, std::chrono::microseconds( max_queue_wait.count() ), space_available );
+         }
+         const auto waited = fc::time_point::now() - start;
+         if( waited > fc::microseconds(500000) ) // reduce logging, .5 secs
+            wlog( "waited ${t}us for mongo_db_plugin queue, size: ${q}", ("t", waited.count())("q", queue_size) );
+      }
+      if( !has_space ) {
+         const auto dropped = ++dropped_entries;
+         if( dropped == 1 || dropped % 1000 == 0 )
+            wlog( "mongo_db_plugin queue full, dropped ${n} entries so far", ("n", dropped) );
+         return;
+      }
    }
-   queue.emplace_back( e );
+   queue.emplace_back( std::move( e ) );
    lock.unlock();
    condition.notify_one();
 }
@@ -399,11 +471,6 @@ void mongo_db_plugin_impl::consume_blocks() {
       auto& mongo_conn = *mongo_client;
 
       _accounts = mongo_conn[db_name][accounts_col];
-      _trans = mongo_conn[db_name][trans_col];
-      _trans_traces = mongo_conn[db_name][trans_traces_col];
-      _action_traces = mongo_conn[db_name][action_traces_col];
-      _blocks = mongo_conn[db_name][blocks_col];
-      _block_states = mongo_conn[db_name][block_states_col];
       _pub_keys = mongo_conn[db_name][pub_keys_col];
       _account_controls = mongo_conn[db_name][account_controls_col];
 
@@ -440,6 +507,7 @@ void mongo_db_plugin_impl::consume_blocks() {
          }
 
          lock.unlock();
+         queue_space.notify_all();
 
          if (done) {
             ilog("draining queue, size: ${q}", ("q", transaction_metadata_size + transaction_trace_size + block_state_size + irreversible_block_size));
@@ -448,11 +516,21 @@ void mongo_db_plugin_impl::consume_blocks() {
          // process transactions
          auto start_time = fc::time_point::now();
          auto size = transaction_trace_process_queue.size();
-         while (!transaction_trace_process_queue.empty()) {
-            const auto& t = transaction_trace_process_queue.front();
-            process_applied_transaction(t);
-            transaction_trace_process_queue.pop_front();
+         std::vector<pending_write> writes;
+         for( size_t begin = 0; begin < size; ) {
+            // traces following a setabi are converted once the accounts are updated
+            size_t end = begin + 1;
+            while( end < size && !updates_abi( transaction_trace_process_queue[end - 1] ) )
+               ++end;
+            convert( end - begin, [&]( size_t i, std::vector<pending_write>& w ) {
+               process_applied_transaction( transaction_trace_process_queue[begin + i], w );
+            }, writes );
+            for( size_t i = begin; i < end; ++i )
+               update_accounts( transaction_trace_process_queue[i] );
+            dispatch( writes );
+            begin = end;
          }
+         transaction_trace_process_queue.clear();
          auto time = fc::time_point::now() - start_time;
          auto per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -460,11 +538,11 @@ void mongo_db_plugin_impl::consume_blocks() {
 
          start_time = fc::time_point::now();
          size = transaction_metadata_process_queue.size();
-         while (!transaction_metadata_process_queue.empty()) {
-            const auto& t = transaction_metadata_process_queue.front();
-            process_accepted_transaction(t);
-            transaction_metadata_process_queue.pop_front();
-         }
+         convert( size, [&]( size_t i, std::vector<pending_write>& w ) {
+            process_accepted_transaction( transaction_metadata_process_queue[i], w );
+         }, writes );
+         dispatch( writes );
+         transaction_metadata_process_queue.clear();
          time = fc::time_point::now() - start_time;
          per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -473,11 +551,15 @@ void mongo_db_plugin_impl::consume_blocks() {
          // process blocks
          start_time = fc::time_point::now();
          size = block_state_process_queue.size();
-         while (!block_state_process_queue.empty()) {
-            const auto& bs = block_state_process_queue.front();
-            process_accepted_block( bs );
-            block_state_process_queue.pop_front();
+         if( start_block_reached ) {
+            for( const auto& bs : block_state_process_queue )
+               stored_blocks.emplace( bs->block_num, bs->id );
          }
+         convert( size, [&]( size_t i, std::vector<pending_write>& w ) {
+            process_accepted_block( block_state_process_queue[i], w );
+         }, writes );
+         dispatch( writes );
+         block_state_process_queue.clear();
          time = fc::time_point::now() - start_time;
          per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -488,9 +570,10 @@ void mongo_db_plugin_impl::consume_blocks() {
          size = irreversible_block_state_process_queue.size();
          while (!irreversible_block_state_process_queue.empty()) {
             const auto& bs = irreversible_block_state_process_queue.front();
-            process_irreversible_block(bs);
+            process_irreversible_block(bs, writes);
             irreversible_block_state_process_queue.pop_front();
          }
+         dispatch( writes );
          time = fc::time_point::now() - start_time;
          per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -522,15 +605,6 @@ auto find_account( mongocxx::collection& accounts, const account_name& name ) {
    return accounts.find_one( make_document( kvp( "name", name.to_string())));
 }
 
-auto find_block( mongocxx::collection& blocks, const string& id ) {
-   using bsoncxx::builder::basic::make_document;
-   using bsoncxx::builder::basic::kvp;
-
-   mongocxx::options::find options;
-   options.projection( make_document( kvp( "_id", 1 )) ); // only return _id
-   return blocks.find_one( make_document( kvp( "block_id", id )), options);
-}
-
 void handle_mongo_exception( const std::string& desc, int line_num ) {
    bool shutdown = true;
    try {
@@ -583,6 +657,134 @@ bsoncxx::oid make_custom_oid() {
 
 } // anonymous namespace
 
+mongo_db_plugin_impl::pending_write mongo_db_plugin_impl::make_insert( collection_id c, bsoncxx::document::value doc ) {
+   return pending_write{ c, false, mongocxx::model::write{ mongocxx::model::insert_one{ std::move( doc ) } } };
+}
+
+mongo_db_plugin_impl::pending_write mongo_db_plugin_impl::make_update( collection_id c, bsoncxx::document::value filter,
+                                                                       bsoncxx::document::value update,
+                                                                       bool upsert, bool ordered ) {
+   mongocxx::model::update_one update_op{ std::move( filter ), std::move( update ) };
+   update_op.upsert( upsert );
+   return pending_write{ c, ordered, mongocxx::model::write{ std::move( update_op ) } };
+}
+
+const std::string& mongo_db_plugin_impl::collection_name( collection_id c ) {
+   static const std::string* const names[] = { &action_traces_col, &trans_traces_col, &trans_col, &blocks_col, &block_states_col };
+   static_assert( sizeof(names) / sizeof(names[0]) == static_cast<size_t>(collection_id::count), "missing collection name" );
+   return *names[static_cast<size_t>(c)];
+}
+
+void mongo_db_plugin_impl::convert( size_t count, const std::function<void( size_t, std::vector<pending_write>& )>& f,
+                                    std::vector<pending_write>& writes ) {
+   // a few ranges per thread to even out their cost
+   const size_t tasks = std::min<size_t>( count, convert_threads * 4 );
+   std::vector<std::future<std::vector<pending_write>>> futures;
+   futures.reserve( tasks );
+   for( size_t t = 0; t < tasks; ++t ) {
+      const size_t begin = count * t / tasks;
+      const size_t end = count * (t + 1) / tasks;
+      futures.emplace_back( chain::async_thread_pool( convert_thread_pool->get_executor(), [&f, begin, end]() {
+         std::vector<pending_write> result;
+         for( size_t i = begin; i < end; ++i )
+            f( i, result );
+         return result;
+      } ) );
+   }
+   for( auto& fut : futures ) {
+      auto result = fut.get();
+      std::move( result.begin(), result.end(), std::back_inserter( writes ) );
+   }
+}
+
+void mongo_db_plugin_impl::dispatch( std::vector<pending_write>& writes ) {
+   if( writes.empty() ) return;
+   for( size_t i = 0; i < writers.size(); ++i ) {
+      auto& w = *writers[i];
+      std::unique_lock<std::mutex> lock( w.mtx );
+      // at most a few bulks are queued for each writer
+      w.condition.wait( lock, [&]() { return w.queued < 4 * bulk_size || w.done; } );
+      if( w.done ) continue;
+      for( auto& pw : writes ) {
+         if( static_cast<size_t>(pw.collection) % writers.size() != i ) continue;
+         w.queues[static_cast<size_t>(pw.collection)].push_back( std::move( pw ) );
+         ++w.queued;
+      }
+      lock.unlock();
+      w.condition.notify_all();
+   }
+   writes.clear();
+}
+
+void mongo_db_plugin_impl::run_writer( writer& w ) {
+   try {
+      auto mongo_client = mongo_pool->acquire();
+      auto& mongo_conn = *mongo_client;
+
+      std::vector<mongocxx::collection> collections;
+      for( size_t c = 0; c < static_cast<size_t>(collection_id::count); ++c )
+         collections.push_back( mongo_conn[db_name][collection_name( static_cast<collection_id>(c) )] );
+
+      while( true ) {
+         std::vector<std::deque<pending_write>> queues( collections.size() );
+         {
+            std::unique_lock<std::mutex> lock( w.mtx );
+            w.condition.wait( lock, [&]() { return w.queued || w.done; } );
+            if( !w.queued )
+               break;
+            std::swap( queues, w.queues );
+            w.queued = 0;
+         }
+         w.condition.notify_all();
+         for( size_t c = 0; c < collections.size(); ++c )
+            write_bulks( collections[c], queues[c] );
+      }
+   } catch (fc::exception& e) {
+      elog("FC Exception while writing to mongo ${e}", ("e", e.to_string()));
+   } catch (std::exception& e) {
+      elog("STD Exception while writing to mongo ${e}", ("e", e.what()));
+   } catch (...) {
+      elog("Unknown exception while writing to mongo");
+   }
+   std::lock_guard<std::mutex> lock( w.mtx );
+   w.done = true;
+   w.condition.notify_all();
+}
+
+void mongo_db_plugin_impl::write_bulks( mongocxx::collection& collection, std::deque<pending_write>& writes ) {
+   auto itr = writes.begin();
+   while( itr != writes.end() ) {
+      const bool ordered = itr->ordered;
+      mongocxx::options::bulk_write bulk_opts;
+      bulk_opts.ordered( ordered );
+      auto bulk = collection.create_bulk_write( bulk_opts );
+      for( uint32_t n = 0; itr != writes.end() && itr->ordered == ordered && n < bulk_size; ++itr, ++n )
+         bulk.append( itr->op );
+
+      try {
+         if( !bulk.execute() ) {
+            ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Bulk write to ${c} failed",
+                        ("c", collection.name().to_string()) );
+         }
+      } catch( ... ) {
+         handle_mongo_exception( "bulk write to " + collection.name().to_string(), __LINE__ );
+      }
+   }
+}
+
+void mongo_db_plugin_impl::stop_writers() {
+   for( auto& w : writers ) {
+      {
+         std::lock_guard<std::mutex> lock( w->mtx );
+         w->done = true;
+      }
+      w->condition.notify_all();
+      if( w->thread.joinable() )
+         w->thread.join();
+   }
+   writers.clear();
+}
+
 void mongo_db_plugin_impl::purge_abi_cache() {
    if( abi_cache_index.size() < abi_cache_size ) return;
 
@@ -599,6 +801,8 @@ optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name
    using bsoncxx::builder::basic::make_document;
    if( n.good()) {
       try {
+         // the consume thread, whose connection is used here, waits for the conversion threads
+         std::lock_guard<std::mutex> g( abi_cache_mtx );
 
          auto itr = abi_cache_index.find( n );
          if( itr != abi_cache_index.end() ) {
@@ -686,10 +890,10 @@ fc::variant mongo_db_plugin_impl::to_variant_with_abi( const T& obj ) {
    return pretty_output;
 }
 
-void mongo_db_plugin_impl::process_accepted_transaction( const chain::transaction_metadata_ptr& t ) {
+void mongo_db_plugin_impl::process_accepted_transaction( const chain::transaction_metadata_ptr& t, std::vector<pending_write>& writes ) {
    try {
       if( start_block_reached ) {
-         _process_accepted_transaction( t );
+         _process_accepted_transaction( t, writes );
       }
    } catch (fc::exception& e) {
       elog("FC Exception while processing accepted transaction metadata: ${e}", ("e", e.to_detail_string()));
@@ -700,10 +904,9 @@ void mongo_db_plugin_impl::process_accepted_transaction( const chain::transactio
    }
 }
 
-void mongo_db_plugin_impl::process_applied_transaction( const chain::transaction_trace_ptr& t ) {
+void mongo_db_plugin_impl::process_applied_transaction( const chain::transaction_trace_ptr& t, std::vector<pending_write>& writes ) {
    try {
-      // always call since we need to capture setabi on accounts even if not storing transaction traces
-      _process_applied_transaction( t );
+      _process_applied_transaction( t, writes );
    } catch (fc::exception& e) {
       elog("FC Exception while processing applied transaction trace: ${e}", ("e", e.to_detail_string()));
    } catch (std::exception& e) {
@@ -713,10 +916,10 @@ void mongo_db_plugin_impl::process_applied_transaction( const chain::transaction
    }
 }
 
-void mongo_db_plugin_impl::process_irreversible_block(const chain::block_state_ptr& bs) {
+void mongo_db_plugin_impl::process_irreversible_block(const chain::block_state_ptr& bs, std::vector<pending_write>& writes) {
   try {
      if( start_block_reached ) {
-        _process_irreversible_block( bs );
+        _process_irreversible_block( bs, writes );
      }
   } catch (fc::exception& e) {
      elog("FC Exception while processing irreversible block: ${e}", ("e", e.to_detail_string()));
@@ -727,10 +930,10 @@ void mongo_db_plugin_impl::process_irreversible_block(const chain::block_state_p
   }
 }
 
-void mongo_db_plugin_impl::process_accepted_block( const chain::block_state_ptr& bs ) {
+void mongo_db_plugin_impl::process_accepted_block( const chain::block_state_ptr& bs, std::vector<pending_write>& writes ) {
    try {
       if( start_block_reached ) {
-         _process_accepted_block( bs );
+         _process_accepted_block( bs, writes );
       }
    } catch (fc::exception& e) {
       elog("FC Exception while processing accepted block trace ${e}", ("e", e.to_string()));
@@ -741,7 +944,7 @@ void mongo_db_plugin_impl::process_accepted_block( const chain::block_state_ptr&
    }
 }
 
-void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transaction_metadata_ptr& t ) {
+void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transaction_metadata_ptr& t, std::vector<pending_write>& writes ) {
    using namespace bsoncxx::types;
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
@@ -808,32 +1011,19 @@ void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transacti
 
    trans_doc.append( kvp( "createdAt", b_date{now} ) );
 
-   try {
-      mongocxx::options::update update_opts{};
-      update_opts.upsert( true );
-      if( !_trans.update_one( make_document( kvp( "trx_id", trx_id_str ) ),
-                              make_document( kvp( "$set", trans_doc.view() ) ), update_opts ) ) {
-         ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert trans ${id}", ("id", trx_id) );
-      }
-   } catch( ... ) {
-      handle_mongo_exception( "trans insert", __LINE__ );
-   }
-
+   writes.push_back( make_update( collection_id::trans, make_document( kvp( "trx_id", trx_id_str ) ),
+                                  make_document( kvp( "$set", trans_doc.view() ) ), true, true ) );
 }
 
 bool
-mongo_db_plugin_impl::add_action_trace( mongocxx::bulk_write& bulk_action_traces, const chain::action_trace& atrace,
+mongo_db_plugin_impl::add_action_trace( std::vector<pending_write>& writes, const chain::action_trace& atrace,
                                         const chain::transaction_trace_ptr& t,
-                                        bool executed, const std::chrono::milliseconds& now,
+                                        const std::chrono::milliseconds& now,
                                         bool& write_ttrace )
 {
    using namespace bsoncxx::types;
    using bsoncxx::builder::basic::kvp;
 
-   if( executed && atrace.receiver == chain::config::system_account_name ) {
-      update_account( atrace.act );
-   }
-
    bool added = false;
    const bool in_filter = (store_action_traces || store_transaction_traces) && start_block_reached &&
                     filter_include( atrace.receiver, atrace.act.name, atrace.act.authorization );
@@ -864,8 +1054,7 @@ mongo_db_plugin_impl::add_action_trace( mongocxx::bulk_write& bulk_action_traces
       }
       action_traces_doc.append( kvp( "createdAt", b_date{now} ) );
 
-      mongocxx::model::insert_one insert_op{action_traces_doc.view()};
-      bulk_action_traces.append( insert_op );
+      writes.push_back( make_insert( collection_id::action_traces, action_traces_doc.extract() ) );
       added = true;
    }
 
@@ -873,7 +1062,7 @@ mongo_db_plugin_impl::add_action_trace( mongocxx::bulk_write& bulk_action_traces
 }
 
 
-void mongo_db_plugin_impl::_process_applied_transaction( const chain::transaction_trace_ptr& t ) {
+void mongo_db_plugin_impl::_process_applied_transaction( const chain::transaction_trace_ptr& t, std::vector<pending_write>& writes ) {
    using namespace bsoncxx::types;
    using bsoncxx::builder::basic::kvp;
 
@@ -882,23 +1071,18 @@ void mongo_db_plugin_impl::_process_applied_transaction( const chain::transactio
    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
          std::chrono::microseconds{fc::time_point::now().time_since_epoch().count()});
 
-   mongocxx::options::bulk_write bulk_opts;
-   bulk_opts.ordered(false);
-   mongocxx::bulk_write bulk_action_traces = _action_traces.create_bulk_write(bulk_opts);
-   bool write_atraces = false;
+   if( !start_block_reached ) return;
+
    bool write_ttrace = false; // filters apply to transaction_traces as well
-   bool executed = t->receipt.valid() && t->receipt->status == chain::transaction_receipt_header::executed;
 
    for( const auto& atrace : t->action_traces ) {
       try {
-         write_atraces |= add_action_trace( bulk_action_traces, atrace, t, executed, now, write_ttrace );
+         add_action_trace( writes, atrace, t, now, write_ttrace );
       } catch(...) {
          handle_mongo_exception("add action traces", __LINE__);
       }
    }
 
-   if( !start_block_reached ) return; //< add_action_trace calls update_account which must be called always
-
    // transaction trace insert
 
    if( store_transaction_traces && write_ttrace ) {
@@ -921,47 +1105,56 @@ void mongo_db_plugin_impl::_process_applied_transaction( const chain::transactio
          }
          trans_traces_doc.append( kvp( "createdAt", b_date{now} ) );
 
-         try {
-            if( !_trans_traces.insert_one( trans_traces_doc.view() ) ) {
-               ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert trans ${id}", ("id", t->id) );
-            }
-         } catch( ... ) {
-            handle_mongo_exception( "trans_traces insert: " + json, __LINE__ );
-         }
+         writes.push_back( make_insert( collection_id::trans_traces, trans_traces_doc.extract() ) );
       } catch( ... ) {
          handle_mongo_exception( "trans_traces serialization: " + t->id.str(), __LINE__ );
       }
    }
+}
+
+bool mongo_db_plugin_impl::updates_abi( const chain::transaction_trace_ptr& t ) {
+   if( !t->receipt.valid() || t->receipt->status != chain::transaction_receipt_header::executed )
+      return false;
+   for( const auto& atrace : t->action_traces ) {
+      if( atrace.receiver == chain::config::system_account_name &&
+          atrace.act.account == chain::config::system_account_name && atrace.act.name == setabi )
+         return true;
+   }
+   return false;
+}
 
-   // insert action_traces
-   if( write_atraces ) {
+void mongo_db_plugin_impl::update_accounts( const chain::transaction_trace_ptr& t ) {
+   // always called since we need to capture setabi on accounts even if not storing transaction traces
+   if( !t->receipt.valid() || t->receipt->status != chain::transaction_receipt_header::executed )
+      return;
+   for( const auto& atrace : t->action_traces ) {
+      if( atrace.receiver != chain::config::system_account_name ) continue;
       try {
-         if( !bulk_action_traces.execute() ) {
-            ROXE_ASSERT( false, chain::mongo_db_insert_fail,
-                        "Bulk action traces insert failed for transaction trace: ${id}", ("id", t->id) );
-         }
-      } catch( ... ) {
-         handle_mongo_exception( "action traces insert", __LINE__ );
+         update_account( atrace.act );
+      } catch(...) {
+         handle_mongo_exception("update account", __LINE__);
       }
    }
-
 }
 
-void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr& bs ) {
+void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr& bs, std::vector<pending_write>& writes ) {
    using namespace bsoncxx::types;
    using namespace bsoncxx::builder;
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
 
-   mongocxx::options::update update_opts{};
-   update_opts.upsert( true );
-
    auto block_num = bs->block_num;
    if( block_num % 1000 == 0 )
       ilog( "block_num: ${b}", ("b", block_num) );
    const auto& block_id = bs->id;
    const auto block_id_str = block_id.str();
 
+   auto block_filter = [&]() {
+      if( update_blocks_via_block_num )
+         return make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) );
+      return make_document( kvp( "block_id", block_id_str ) );
+   };
+
    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
          std::chrono::microseconds{fc::time_point::now().time_since_epoch().count()});
 
@@ -990,21 +1183,8 @@ void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr
       }
       block_state_doc.append( kvp( "createdAt", b_date{now} ) );
 
-      try {
-         if( update_blocks_via_block_num ) {
-            if( !_block_states.update_one( make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) ),
-                                           make_document( kvp( "$set", block_state_doc.view() ) ), update_opts ) ) {
-               ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block_state ${num}", ("num", block_num) );
-            }
-         } else {
-            if( !_block_states.update_one( make_document( kvp( "block_id", block_id_str ) ),
-                                           make_document( kvp( "$set", block_state_doc.view() ) ), update_opts ) ) {
-               ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block_state ${bid}", ("bid", block_id) );
-            }
-         }
-      } catch( ... ) {
-         handle_mongo_exception( "block_states insert: " + json, __LINE__ );
-      }
+      writes.push_back( make_update( collection_id::block_states, block_filter(),
+                                     make_document( kvp( "$set", block_state_doc.view() ) ), true, true ) );
    }
 
    if( store_blocks ) {
@@ -1030,25 +1210,12 @@ void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr
       }
       block_doc.append( kvp( "createdAt", b_date{now} ) );
 
-      try {
-         if( update_blocks_via_block_num ) {
-            if( !_blocks.update_one( make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) ),
-                                     make_document( kvp( "$set", block_doc.view() ) ), update_opts ) ) {
-               ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block ${num}", ("num", block_num) );
-            }
-         } else {
-            if( !_blocks.update_one( make_document( kvp( "block_id", block_id_str ) ),
-                                     make_document( kvp( "$set", block_doc.view() ) ), update_opts ) ) {
-               ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block ${bid}", ("bid", block_id) );
-            }
-         }
-      } catch( ... ) {
-         handle_mongo_exception( "blocks insert: " + json, __LINE__ );
-      }
+      writes.push_back( make_update( collection_id::blocks, block_filter(),
+                                     make_document( kvp( "$set", block_doc.view() ) ), true, true ) );
    }
 }
 
-void mongo_db_plugin_impl::_process_irreversible_block(const chain::block_state_ptr& bs)
+void mongo_db_plugin_impl::_process_irreversible_block(const chain::block_state_ptr& bs, std::vector<pending_write>& writes)
 {
    using namespace bsoncxx::types;
    using namespace bsoncxx::builder;
@@ -1062,42 +1229,27 @@ void mongo_db_plugin_impl::_process_irreversible_block(const chain::block_state_
    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
          std::chrono::microseconds{fc::time_point::now().time_since_epoch().count()});
 
-   if( store_blocks ) {
-      auto ir_block = find_block( _blocks, block_id_str );
-      if( !ir_block ) {
-         _process_accepted_block( bs );
-         ir_block = find_block( _blocks, block_id_str );
-         if( !ir_block ) return; // should never happen
-      }
-
-      auto update_doc = make_document( kvp( "$set", make_document( kvp( "irreversible", b_bool{true} ),
-                                                                   kvp( "validated", b_bool{bs->validated} ),
-                                                                   kvp( "updatedAt", b_date{now} ) ) ) );
-
-      _blocks.update_one( make_document( kvp( "_id", ir_block->view()["_id"].get_oid() ) ), update_doc.view() );
-   }
-
-   if( store_block_states ) {
-      auto ir_block = find_block( _block_states, block_id_str );
-      if( !ir_block ) {
-         _process_accepted_block( bs );
-         ir_block = find_block( _block_states, block_id_str );
-         if( !ir_block ) return; // should never happen
-      }
-
-      auto update_doc = make_document( kvp( "$set", make_document( kvp( "irreversible", b_bool{true} ),
-                                                                   kvp( "validated", b_bool{bs->validated} ),
-                                                                   kvp( "updatedAt", b_date{now} ) ) ) );
-
-      _block_states.update_one( make_document( kvp( "_id", ir_block->view()["_id"].get_oid() ) ), update_doc.view() );
+   if( store_blocks || store_block_states ) {
+      // the writes of a collection are executed in order, so the block is stored before it is updated
+      if( !stored_blocks.count( std::make_pair( bs->block_num, block_id ) ) )
+         _process_accepted_block( bs, writes );
+      stored_blocks.erase( stored_blocks.begin(), stored_blocks.lower_bound( std::make_pair( bs->block_num + 1, block_id_type() ) ) );
+
+      auto update_doc = [&]() {
+         return make_document( kvp( "$set", make_document( kvp( "irreversible", b_bool{true} ),
+                                                           kvp( "validated", b_bool{bs->validated} ),
+                                                           kvp( "updatedAt", b_date{now} ) ) ) );
+      };
+      if( store_blocks )
+         writes.push_back( make_update( collection_id::blocks, make_document( kvp( "block_id", block_id_str ) ),
+                                        update_doc(), false, false ) );
+      if( store_block_states )
+         writes.push_back( make_update( collection_id::block_states, make_document( kvp( "block_id", block_id_str ) ),
+                                        update_doc(), false, false ) );
    }
 
    if( store_transactions ) {
       const auto block_num = bs->block->block_num();
-      bool transactions_in_block = false;
-      mongocxx::options::bulk_write bulk_opts;
-      bulk_opts.ordered( false );
-      auto bulk = _trans.create_bulk_write( bulk_opts );
 
       for( const auto& receipt : bs->block->transactions ) {
          string trx_id_str;
@@ -1116,20 +1268,8 @@ void mongo_db_plugin_impl::_process_irreversible_block(const chain::block_state_
                                                                       kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ),
                                                                       kvp( "updatedAt", b_date{now} ) ) ) );
 
-         mongocxx::model::update_one update_op{make_document( kvp( "trx_id", trx_id_str ) ), update_doc.view()};
-         update_op.upsert( false );
-         bulk.append( update_op );
-         transactions_in_block = true;
-      }
-
-      if( transactions_in_block ) {
-         try {
-            if( !bulk.execute() ) {
-               ROXE_ASSERT( false, chain::mongo_db_insert_fail, "Bulk transaction insert failed for block: ${bid}", ("bid", block_id) );
-            }
-         } catch( ... ) {
-            handle_mongo_exception( "bulk transaction insert", __LINE__ );
-         }
+         writes.push_back( make_update( collection_id::trans, make_document( kvp( "trx_id", trx_id_str ) ),
+                                        std::move( update_doc ), false, false ) );
       }
    }
 }
@@ -1312,7 +1452,10 @@ void mongo_db_plugin_impl::update_account(const chain::action& act)
                std::chrono::microseconds{fc::time_point::now().time_since_epoch().count()} );
          auto setabi = act.data_as<chain::setabi>();
 
-         abi_cache_index.erase( setabi.account );
+         {
+            std::lock_guard<std::mutex> g( abi_cache_mtx );
+            abi_cache_index.erase( setabi.account );
+         }
 
          auto account = find_account( _accounts, setabi.account );
          if( !account ) {
@@ -1357,8 +1500,11 @@ mongo_db_plugin_impl::~mongo_db_plugin_impl() {
          ilog( "mongo_db_plugin shutdown in process please be patient this can take a few minutes" );
          done = true;
          condition.notify_one();
+         queue_space.notify_all();
 
          consume_thread.join();
+         stop_writers();
+         convert_thread_pool.reset();
 
          mongo_pool.reset();
       } catch( std::exception& e ) {
@@ -1520,7 +1666,18 @@ void mongo_db_plugin_impl::init() {
       handle_mongo_exception( "mongo init", __LINE__ );
    }
 
-   ilog("starting db plugin thread");
+   ilog("starting db plugin threads");
+
+   convert_thread_pool.emplace( "mongoc", convert_threads );
+   const auto writer_count = std::min<uint32_t>( writer_threads, static_cast<uint32_t>(collection_id::count) );
+   for( uint32_t i = 0; i < writer_count; ++i )
+      writers.emplace_back( std::make_unique<writer>() );
+   for( uint32_t i = 0; i < writer_count; ++i ) {
+      writers[i]->thread = std::thread( [this, i] {
+         fc::set_os_thread_name( "mongow-" + std::to_string( i ) );
+         run_writer( *writers[i] );
+      } );
+   }
 
    consume_thread = std::thread( [this] {
       fc::set_os_thread_name( "mongodb" );
@@ -1548,8 +1705,19 @@ void mongo_db_plugin::set_program_options(options_description& cli, options_desc
    cfg.add_options()
          ("mongodb-queue-size,q", bpo::value<uint32_t>()->default_value(1024),
          "The target queue size between nodroxe and MongoDB plugin thread.")
+         ("mongodb-queue-full-policy", bpo::value<string>()->default_value("block"),
+          "What nodroxe does when a queue to the MongoDB plugin thread is full: 'block' waits until the queue is taken,"
+          " 'drop' discards the entry. Dropped transaction traces may miss account and abi updates.")
+         ("mongodb-queue-max-wait-ms", bpo::value<uint32_t>()->default_value(0),
+          "With the 'block' policy, the longest nodroxe waits for a full queue before dropping the entry, 0 for no limit.")
          ("mongodb-abi-cache-size", bpo::value<uint32_t>()->default_value(2048),
           "The maximum size of the abi cache for serializing data.")
+         ("mongodb-convert-threads", bpo::value<uint32_t>()->default_value(2),
+          "The number of threads converting blocks and traces to BSON.")
+         ("mongodb-writer-threads", bpo::value<uint32_t>()->default_value(2),
+          "The number of MongoDB connections writing the converted documents, each writing its own collections.")
+         ("mongodb-bulk-size", bpo::value<uint32_t>()->default_value(2500),
+          "The maximum number of documents written to a collection in one bulk write.")
          ("mongodb-wipe", bpo::bool_switch()->default_value(false),
          "Required with --replay-blockchain, --hard-replay-blockchain, or --delete-all-blocks to wipe mongo db."
          "This option required to prevent accidental wipe of mongo db.")
@@ -1605,10 +1773,35 @@ void mongo_db_plugin::plugin_initialize(const variables_map& options)
          if( options.count( "mongodb-queue-size" )) {
             my->max_queue_size = options.at( "mongodb-queue-size" ).as<uint32_t>();
          }
+         if( options.count( "mongodb-queue-full-policy" )) {
+            const auto& policy = options.at( "mongodb-queue-full-policy" ).as<string>();
+            if( policy == "block" ) {
+               my->full_policy = mongo_db_plugin_impl::queue_full_policy::block;
+            } else if( policy == "drop" ) {
+               my->full_policy = mongo_db_plugin_impl::queue_full_policy::drop;
+            } else {
+               ROXE_ASSERT( false, chain::plugin_config_exception, "Invalid value ${p} for --mongodb-queue-full-policy", ("p", policy) );
+            }
+         }
+         if( options.count( "mongodb-queue-max-wait-ms" )) {
+            my->max_queue_wait = fc::milliseconds( options.at( "mongodb-queue-max-wait-ms" ).as<uint32_t>() );
+         }
          if( options.count( "mongodb-abi-cache-size" )) {
             my->abi_cache_size = options.at( "mongodb-abi-cache-size" ).as<uint32_t>();
             ROXE_ASSERT( my->abi_cache_size > 0, chain::plugin_config_exception, "mongodb-abi-cache-size > 0 required" );
          }
+         if( options.count( "mongodb-convert-threads" )) {
+            my->convert_threads = options.at( "mongodb-convert-threads" ).as<uint32_t>();
+            ROXE_ASSERT( my->convert_threads > 0, chain::plugin_config_exception, "mongodb-convert-threads > 0 required" );
+         }
+         if( options.count( "mongodb-writer-threads" )) {
+            my->writer_threads = options.at( "mongodb-writer-threads" ).as<uint32_t>();
+            ROXE_ASSERT( my->writer_threads > 0, chain::plugin_config_exception, "mongodb-writer-threads > 0 required" );
+         }
+         if( options.count( "mongodb-bulk-size" )) {
+            my->bulk_size = options.at( "mongodb-bulk-size" ).as<uint32_t>();
+            ROXE_ASSERT( my->bulk_size > 0, chain::plugin_config_exception, "mongodb-bulk-size > 0 required" );
+         }
          if( options.count( "mongodb-block-start" )) {
             my->start_block_num = options.at( "mongodb-block-start" ).as<uint32_t>();
          }
@@ -1698,6 +1891,7 @@ void mongo_db_plugin::plugin_initialize(const variables_map& options)
                chain.applied_transaction.connect( [&]( std::tuple<const chain::transaction_trace_ptr&, const chain::signed_transaction&> t ) {
                   my->applied_transaction( std::get<0>(t) );
                } ));
+         chain.require_detailed_traces();
 
          if( my->wipe_database_on_startup ) {
             my->wipe_database();
@@ -17,6 +17,34 @@ namespace roxe {
       handshake_message last_handshake;
    };
 
+   struct message_traffic {
+      string   type;
+      uint64_t received_count = 0;
+      uint64_t received_bytes = 0;
+      uint64_t sent_count = 0;
+      uint64_t sent_bytes = 0;
+   };
+
+   /// counters of a connection since the node started, for tuning the topology
+   struct connection_stats {
+      string                  peer;
+      bool                    connected = false;
+      vector<message_traffic> traffic;             ///< per message type, types never sent nor received are left out
+      uint32_t                write_queue_bytes = 0;
+      uint32_t                dropped_trxs = 0;    ///< transactions not queued because the peer fell behind
+      int64_t                 rtt_last_us = -1;    ///< round trip time from the last time_message exchange, -1 if none
+      int64_t                 rtt_min_us = -1;
+      int64_t                 rtt_avg_us = -1;
+      vector<uint32_t>        rtt_bounds_ms;       ///< upper bounds of the rtt_histogram buckets but the last one
+      vector<uint32_t>        rtt_histogram;
+      uint32_t                blocks_first = 0;     ///< blocks this peer was the first to send
+      uint32_t                blocks_duplicate = 0; ///< blocks this peer sent which were already known
+      int64_t                 block_lag_us = 0;     ///< moving average of how late the peer delivers blocks
+      double                  failures = 0;         ///< recent failures, each decayed with a 10 minute half life
+      double                  score = 0;            ///< expected block delay in microseconds, lower is preferred
+      double                  sync_rate = 0;        ///< measured blocks per second while syncing from the peer
+   };
+
    class net_plugin : public appbase::plugin<net_plugin>
    {
       public:
@@ -37,6 +65,7 @@ namespace roxe {
         string                       disconnect( const string& endpoint );
         optional<connection_status>  status( const string& endpoint )const;
         vector<connection_status>    connections()const;
+        vector<connection_stats>     stats()const;
 
         size_t num_peers() const;
       private:
@@ -46,3 +75,6 @@ namespace roxe {
 }
 
 FC_REFLECT( roxe::connection_status, (peer)(connecting)(syncing)(last_handshake) )
+FC_REFLECT( roxe::message_traffic, (type)(received_count)(received_bytes)(sent_count)(sent_bytes) )
+FC_REFLECT( roxe::connection_stats, (peer)(connected)(traffic)(write_queue_bytes)(dropped_trxs)
+            (rtt_last_us)(rtt_min_us)(rtt_avg_us)(rtt_bounds_ms)(rtt_histogram)(blocks_first)(blocks_duplicate)(block_lag_us)(failures)(score)(sync_rate) )
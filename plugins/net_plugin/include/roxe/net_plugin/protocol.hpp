@@ -132,6 +132,69 @@ namespace roxe {
       uint32_t end_block;
    };
 
+   /**
+    * A transaction of a compact block: the receipt header with either the id of a receipt which only references
+    * its transaction or the short id (see compact_short_id) of a packed transaction the peer is expected to hold.
+    */
+   struct compact_transaction_receipt : public transaction_receipt_header {
+      fc::static_variant<transaction_id_type, uint64_t> trx;
+   };
+
+   /// a block announced without its packed transactions, sent to peers speaking proto_compact_blocks or later
+   struct compact_block_message {
+      signed_block_header                  header;
+      vector<compact_transaction_receipt>  transactions;
+      extensions_type                      block_extensions;
+   };
+
+   /// asks for the packed transactions at the given receipt indexes of a compact block which could not be rebuilt
+   struct get_block_transactions_message {
+      block_id_type                        id;
+      vector<uint32_t>                     indexes;
+   };
+
+   /// the packed transactions requested by a get_block_transactions_message, in the requested order; empty if unknown
+   struct block_transactions_message {
+      block_id_type                        id;
+      vector<packed_transaction>           transactions;
+   };
+
+   /// a zlib compressed packed net_message, sent to peers speaking proto_compression or later
+   struct compressed_message {
+      vector<char>                         data;
+   };
+
+   /// transactions relayed together, sent to peers speaking proto_trx_batches or later
+   struct transaction_batch_message {
+      vector<packed_transaction>           transactions;
+   };
+
+   /// a finished snapshot a peer serves, see snapshot_list_message
+   struct snapshot_info {
+      block_id_type                        head_block_id;  ///< id of the block the snapshot was taken at
+      fc::sha256                           hash;           ///< of the whole snapshot file
+      uint64_t                             size = 0;
+   };
+
+   /// the snapshots a node serves, newest first, sent after the handshake to peers speaking proto_snapshots or later
+   struct snapshot_list_message {
+      vector<snapshot_info>                snapshots;
+   };
+
+   /// asks for size bytes at offset of the snapshot with the given hash
+   struct snapshot_chunk_request_message {
+      fc::sha256                           hash;
+      uint64_t                             offset = 0;
+      uint32_t                             size = 0;
+   };
+
+   /// the bytes requested by a snapshot_chunk_request_message, empty if the snapshot is no longer served
+   struct snapshot_chunk_message {
+      fc::sha256                           hash;
+      uint64_t                             offset = 0;
+      vector<char>                         data;
+   };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -140,7 +203,15 @@ namespace roxe {
                                       request_message,
                                       sync_request_message,
                                       signed_block,         // which = 7
-                                      packed_transaction>;  // which = 8
+                                      packed_transaction,   // which = 8
+                                      compact_block_message,          // which = 9
+                                      get_block_transactions_message,
+                                      block_transactions_message,
+                                      compressed_message,             // which = 12
+                                      transaction_batch_message,      // which = 13
+                                      snapshot_list_message,
+                                      snapshot_chunk_request_message,
+                                      snapshot_chunk_message>;        // which = 16
 
 } // namespace roxe
 
@@ -159,6 +230,16 @@ FC_REFLECT( roxe::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( roxe::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( roxe::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( roxe::sync_request_message, (start_block)(end_block) )
+FC_REFLECT_DERIVED( roxe::compact_transaction_receipt, (roxe::chain::transaction_receipt_header), (trx) )
+FC_REFLECT( roxe::compact_block_message, (header)(transactions)(block_extensions) )
+FC_REFLECT( roxe::get_block_transactions_message, (id)(indexes) )
+FC_REFLECT( roxe::block_transactions_message, (id)(transactions) )
+FC_REFLECT( roxe::compressed_message, (data) )
+FC_REFLECT( roxe::transaction_batch_message, (transactions) )
+FC_REFLECT( roxe::snapshot_info, (head_block_id)(hash)(size) )
+FC_REFLECT( roxe::snapshot_list_message, (snapshots) )
+FC_REFLECT( roxe::snapshot_chunk_request_message, (hash)(offset)(size) )
+FC_REFLECT( roxe::snapshot_chunk_message, (hash)(offset)(data) )
 
 /**
  *
@@ -13,6 +13,10 @@
 #include <roxe/chain/thread_utils.hpp>
 #include <roxe/producer_plugin/producer_plugin.hpp>
 #include <roxe/chain/contract_types.hpp>
+#include <roxe/chain/merkle.hpp>
+#include <roxe/chain/global_property_object.hpp>
+#include <roxe/chain/genesis_state.hpp>
+#include <roxe/chain/snapshot.hpp>
 
 #include <fc/network/message_buffer.hpp>
 #include <fc/network/ip.hpp>
@@ -22,11 +26,22 @@
 #include <fc/log/logger_config.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/crypto/rand.hpp>
+#include <fc/crypto/city.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/metrics.hpp>
+#include <fc/tracing.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include <array>
+#include <fstream>
+#include <unordered_map>
 
 using namespace roxe::chain::plugin_interface::compat;
 
@@ -49,6 +64,7 @@ namespace roxe {
 
    class sync_manager;
    class dispatch_manager;
+   class snapshot_fetcher;
 
    using connection_ptr = std::shared_ptr<connection>;
    using connection_wptr = std::weak_ptr<connection>;
@@ -61,6 +77,7 @@ namespace roxe {
       time_point_sec  expires;  /// time after which this may be purged.
       uint32_t        block_num = 0; /// block transaction was included in
       std::shared_ptr<vector<char>>   serialized_txn; /// the received raw bundle
+      packed_transaction_ptr          packed_trx; /// used to rebuild compact blocks
    };
 
    struct by_expiry;
@@ -90,6 +107,199 @@ namespace roxe {
       >
    node_transaction_index;
 
+   /// transaction ids are sha256 digests, any 64 bits of them are already a good hash
+   struct transaction_id_hash {
+      size_t operator()( const transaction_id_type& id )const { return id._hash[0]; }
+   };
+
+   /**
+    * Ids of the unexpired transactions received from peers. The net threads consult it to drop transactions
+    * another peer already sent before they reach the main thread.
+    *
+    * Ids are spread over shards by hash, each with its own mutex, so net threads decoding at the same time rarely
+    * wait on each other. Expiry is a timing wheel of expiry_bucket_seconds wide buckets instead of an ordered
+    * index; an id may therefore be kept up to one bucket past its expiration.
+    */
+   class received_transaction_filter {
+   public:
+      static constexpr uint32_t shard_count = 16;
+      static constexpr uint32_t expiry_bucket_seconds = 10;
+
+      /// @return false if the transaction was received before
+      bool add( const transaction_id_type& id, time_point_sec expires ) {
+         auto& s = shard_of( id );
+         const uint32_t bucket = expires.sec_since_epoch() / expiry_bucket_seconds;
+         std::lock_guard<std::mutex> g( s.mtx );
+         if( !s.ids.emplace( id, bucket ).second )
+            return false;
+         s.wheel[bucket].push_back( id );
+         return true;
+      }
+
+      /// forget a transaction which was dropped without being processed, so it is accepted from the next peer
+      void remove( const transaction_id_type& id ) {
+         auto& s = shard_of( id );
+         std::lock_guard<std::mutex> g( s.mtx );
+         s.ids.erase( id ); // its wheel entry is skipped on expiry
+      }
+
+      void expire( time_point_sec now ) {
+         const uint32_t current = now.sec_since_epoch() / expiry_bucket_seconds;
+         for( auto& s : shards ) {
+            std::lock_guard<std::mutex> g( s.mtx );
+            while( !s.wheel.empty() && s.wheel.begin()->first < current ) {
+               const uint32_t bucket = s.wheel.begin()->first;
+               for( const auto& id : s.wheel.begin()->second ) {
+                  auto itr = s.ids.find( id );
+                  if( itr != s.ids.end() && itr->second == bucket )
+                     s.ids.erase( itr );
+               }
+               s.wheel.erase( s.wheel.begin() );
+            }
+         }
+      }
+
+   private:
+      struct shard {
+         std::mutex                                                          mtx;
+         std::unordered_map<transaction_id_type, uint32_t, transaction_id_hash> ids;   ///< id -> expiry bucket
+         std::map<uint32_t, vector<transaction_id_type>>                     wheel; ///< expiry bucket -> ids
+      };
+
+      shard& shard_of( const transaction_id_type& id ) { return shards[id._hash[1] % shard_count]; }
+
+      std::array<shard, shard_count> shards;
+   };
+
+   /**
+    * Transactions a peer is known to have because they were sent to it. Instead of an index entry per transaction
+    * there is a bloom filter per generation_seconds of transaction expiration, about 2.5 bytes per transaction,
+    * dropped as a whole once all its transactions expired. A generation grows by a slice of slice_capacity ids
+    * when full. A false positive, about one in ten thousand, only means a transaction is not relayed to a peer
+    * which is expected to get it from its other peers.
+    */
+   class peer_transaction_filter {
+   public:
+      static constexpr uint32_t generation_seconds = 300;
+      static constexpr uint32_t slice_capacity = 4096;
+      static constexpr uint32_t slice_bits = slice_capacity * 20;
+      static constexpr uint32_t hash_count = 14;
+
+      /// @return false if the peer may have the transaction already
+      bool add( const transaction_id_type& id, time_point_sec expires ) {
+         auto& gen = generations[expires.sec_since_epoch() / generation_seconds];
+         if( gen.contains( id ) )
+            return false;
+         gen.add( id );
+         return true;
+      }
+
+      bool contains( const transaction_id_type& id )const {
+         for( const auto& gen : generations ) {
+            if( gen.second.contains( id ) )
+               return true;
+         }
+         return false;
+      }
+
+      void expire( time_point_sec now ) {
+         generations.erase( generations.begin(), generations.lower_bound( now.sec_since_epoch() / generation_seconds ) );
+      }
+
+      void clear() { generations.clear(); }
+
+   private:
+      struct generation {
+         vector<vector<uint64_t>> slices;
+         uint32_t                 last_slice_size = 0;
+
+         template<typename F>
+         static bool for_each_bit( const transaction_id_type& id, F&& f ) {
+            const uint64_t h1 = id._hash[2];
+            const uint64_t h2 = id._hash[3] | 1;
+            for( uint32_t i = 0; i < hash_count; ++i ) {
+               if( !f( (h1 + i * h2) % slice_bits ) )
+                  return false;
+            }
+            return true;
+         }
+
+         bool contains( const transaction_id_type& id )const {
+            for( const auto& slice : slices ) {
+               if( for_each_bit( id, [&slice]( uint64_t bit ) { return (slice[bit / 64] >> (bit % 64)) & 1; } ) )
+                  return true;
+            }
+            return false;
+         }
+
+         void add( const transaction_id_type& id ) {
+            if( slices.empty() || last_slice_size >= slice_capacity ) {
+               slices.emplace_back( slice_bits / 64 );
+               last_slice_size = 0;
+            }
+            auto& slice = slices.back();
+            for_each_bit( id, [&slice]( uint64_t bit ) { slice[bit / 64] |= uint64_t(1) << (bit % 64); return true; } );
+            ++last_slice_size;
+         }
+      };
+
+      std::map<uint32_t, generation> generations;
+   };
+
+   /**
+    * Compressed forms of shared send buffers, so a block sent to many peers is compressed once. Used from the net
+    * threads; an entry lives as long as the buffer it was made from.
+    */
+   class compressed_buffer_cache {
+   public:
+      std::shared_ptr<vector<char>> get( const std::shared_ptr<vector<char>>& buffer );
+
+   private:
+      struct entry {
+         std::weak_ptr<vector<char>>   original;
+         std::shared_ptr<vector<char>> compressed;
+      };
+
+      std::mutex                               mtx;
+      std::map<const vector<char>*, entry>     entries;
+   };
+
+   /**
+    * The finished full snapshots of the producer_plugin snapshots directory, served to peers. Scanned on the net
+    * threads; a file is hashed again only once its size or modification time changed.
+    */
+   class snapshot_catalog {
+   public:
+      static constexpr size_t max_listed = 4;
+
+      void set_dir( const bfs::path& d ) { dir = d; }
+      /// rescans the directory, @return the newest max_listed snapshots, newest first
+      vector<snapshot_info> scan();
+      /// @return the path of the snapshot with the hash, empty if it is not served
+      bfs::path find( const fc::sha256& hash );
+
+   private:
+      struct entry {
+         uint64_t       size = 0;
+         std::time_t    mtime = 0;
+         snapshot_info  info;
+      };
+
+      bfs::path                  dir;
+      std::mutex                 mtx;
+      std::map<bfs::path, entry> entries;
+   };
+
+   /// a message unpacked on a net thread; blocks and transactions come with their ids computed
+   struct decoded_message {
+      net_message                msg;
+      signed_block_ptr           block;
+      block_id_type              block_id;
+      transaction_metadata_ptr   trx;
+      optional<transaction_id_type> duplicate_trx; ///< id of a transaction dropped by received_transaction_filter
+      fc::exception_ptr          rejected_trx;  ///< why a transaction was dropped by chain_plugin::prefilter_transaction
+   };
+
    class net_plugin_impl {
    public:
       unique_ptr<tcp::acceptor>        acceptor;
@@ -141,11 +351,26 @@ namespace roxe {
       int                           started_sessions = 0;
 
       node_transaction_index        local_txns;
+      received_transaction_filter   received_trxs;
+      std::atomic<int64_t>          trx_recovery_time_limit_us{config::default_max_transaction_cpu_usage}; ///< updated from the main thread
 
       bool                          use_socket_read_watermark = false;
 
       channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
+      uint32_t                      compression_threshold = 0; ///< larger messages are compressed for capable peers, 0 disables
+      uint32_t                      trx_batch_bytes = 0; ///< a transaction batch is sent once this large
+      std::chrono::milliseconds     trx_batch_period{0}; ///< or this long after its first transaction, 0 disables batching
+      unique_ptr<boost::asio::steady_timer> trx_batch_timer;
+      bool                          trx_batch_timer_running = false;
+      compressed_buffer_cache       compressed_buffers;
+
+      bool                          serve_snapshots = false;
+      snapshot_catalog              snapshots;
+      vector<snapshot_info>         served_snapshots; ///< result of the last snapshots scan, updated on the main thread
+      unique_ptr<boost::asio::steady_timer> snapshot_scan_timer;
+      unique_ptr<snapshot_fetcher>  snapshot_fetch; ///< set if p2p-fetch-snapshot-to is configured
+
       uint16_t                                  thread_pool_size = 1;
       optional<roxe::chain::named_thread_pool> thread_pool;
 
@@ -155,15 +380,24 @@ namespace roxe {
       void start_listen_loop();
       void start_read_message(const connection_ptr& c);
 
-      /** \brief Process the next message from the pending message buffer
+      /** \brief Unpack the next message from the pending message buffer
        *
-       * Process the next message from the pending_message_buffer.
-       * message_length is the already determined length of the data
-       * part of the message that will handle the message.
-       * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
+       * Runs on a net thread. Unpacks the next message of the pending_message_buffer,
+       * message_length is the already determined length of the data part of the message.
+       * Transactions are checked against received_trxs and start signature recovery.
+       * A message may decode to several, a transaction_batch_message adds one per transaction.
+       * Throws if the message cannot be unpacked.
        */
-      bool process_next_message(const connection_ptr& conn, uint32_t message_length);
+      void decode_next_message(const connection_ptr& conn, uint32_t message_length, deque<decoded_message>& out);
+      void decode_message(net_message&& msg, deque<decoded_message>& out, bool allow_compressed = true);
+      decoded_message decode_transaction(packed_transaction_ptr ptrx);
+
+      /** \brief Process a message decoded by decode_next_message
+       *
+       * Runs on the main thread. Returns true is successful. Returns false if an
+       * error was encountered processing the message.
+       */
+      bool process_decoded_message(const connection_ptr& conn, decoded_message& msg);
 
       void close(const connection_ptr& c);
       size_t count_open_sockets() const;
@@ -201,9 +435,26 @@ namespace roxe {
       void handle_message(const connection_ptr& c, const signed_block_ptr& msg);
       void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // packed_transaction_ptr overload used instead
       void handle_message(const connection_ptr& c, const packed_transaction_ptr& msg);
+      void handle_message(const connection_ptr& c, const transaction_metadata_ptr& msg);
+      void handle_message(const connection_ptr& c, const compact_block_message& msg);
+      void handle_message(const connection_ptr& c, const get_block_transactions_message& msg);
+      void handle_message(const connection_ptr& c, const block_transactions_message& msg);
+      void handle_message(const connection_ptr& c, const snapshot_list_message& msg);
+      void handle_message(const connection_ptr& c, const snapshot_chunk_request_message& msg);
+      void handle_message(const connection_ptr& c, const snapshot_chunk_message& msg);
+
+      /// validates and applies a complete block received from a peer
+      void process_block(const connection_ptr& c, const signed_block_ptr& msg);
+      /// checks a rebuilt compact block and applies the leading complete blocks of the connection in order
+      void process_compact_blocks(const connection_ptr& c);
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer();
+      /// flushes the transaction batches of all connections once trx_batch_period passed
+      void start_trx_batch_timer();
+      /// rescans the served snapshots on a net thread and sends the list to the peers if it changed
+      void start_snapshot_scan_timer(boost::asio::steady_timer::duration du);
+      void send_snapshot_list(const connection_ptr& c);
       void start_monitors();
 
       void expire_txns();
@@ -250,25 +501,25 @@ namespace roxe {
 
 #define peer_dlog( PEER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( logger.is_enabled( fc::log_level::debug ) ) \
+   if( FC_LOG_ENABLED( logger, debug ) ) \
       logger.log( FC_LOG_MESSAGE( debug, peer_log_format + FORMAT, __VA_ARGS__ (PEER->get_logger_variant()) ) ); \
   FC_MULTILINE_MACRO_END
 
 #define peer_ilog( PEER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( logger.is_enabled( fc::log_level::info ) ) \
+   if( FC_LOG_ENABLED( logger, info ) ) \
       logger.log( FC_LOG_MESSAGE( info, peer_log_format + FORMAT, __VA_ARGS__ (PEER->get_logger_variant()) ) ); \
   FC_MULTILINE_MACRO_END
 
 #define peer_wlog( PEER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( logger.is_enabled( fc::log_level::warn ) ) \
+   if( FC_LOG_ENABLED( logger, warn ) ) \
       logger.log( FC_LOG_MESSAGE( warn, peer_log_format + FORMAT, __VA_ARGS__ (PEER->get_logger_variant()) ) ); \
   FC_MULTILINE_MACRO_END
 
 #define peer_elog( PEER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
-   if( logger.is_enabled( fc::log_level::error ) ) \
+   if( FC_LOG_ENABLED( logger, error ) ) \
       logger.log( FC_LOG_MESSAGE( error, peer_log_format + FORMAT, __VA_ARGS__ (PEER->get_logger_variant())) ); \
   FC_MULTILINE_MACRO_END
 
@@ -288,6 +539,7 @@ namespace roxe {
    constexpr auto     def_send_buffer_size_mb = 4;
    constexpr auto     def_send_buffer_size = 1024*1024*def_send_buffer_size_mb;
    constexpr auto     def_max_write_queue_size = def_send_buffer_size*10;
+   constexpr auto     def_max_trx_write_queue_size = def_send_buffer_size; // transactions are dropped above this
    constexpr auto     def_max_trx_in_progress_size = 100*1024*1024; // 100 MB
    constexpr auto     def_max_clients = 25; // 0 for unlimited clients
    constexpr auto     def_max_nodes_per_host = 1;
@@ -295,10 +547,16 @@ namespace roxe {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_sync_fetch_peers = 4;
 
    constexpr auto     message_header_size = 4;
+   constexpr auto     max_decompressed_message_size = def_send_buffer_size*2; // same limit as for uncompressed messages
    constexpr uint32_t signed_block_which = 7;        // see protocol net_message
    constexpr uint32_t packed_transaction_which = 8;  // see protocol net_message
+   constexpr uint32_t compact_block_which = 9;       // see protocol net_message
+   constexpr size_t   max_pending_compact_blocks = 32;
+   constexpr uint32_t snapshot_chunk_size = 1024*1024;          // well below the message size limit
+   constexpr auto     snapshot_scan_period = std::chrono::seconds(60);
 
    /**
     *  For a while, network version was a 16 bit value equal to the second set of 16 bits
@@ -320,29 +578,39 @@ namespace roxe {
     */
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
+   constexpr uint16_t proto_compact_blocks = 2;  // blocks are announced with compact_block_message
+   constexpr uint16_t proto_compression = 3;     // large messages may be wrapped in compressed_message
+   constexpr uint16_t proto_trx_batches = 4;     // transactions are relayed in transaction_batch_message
+   constexpr uint16_t proto_snapshots = 5;       // served snapshots are listed in snapshot_list_message after the handshake
+
+   constexpr uint16_t net_version = proto_snapshots;
+
+   constexpr uint32_t compressed_message_which = 12; // see protocol net_message
+   constexpr uint32_t trx_batch_which = 13;          // see protocol net_message
+   constexpr uint32_t def_trx_batch_bytes = 64*1024;
+   constexpr uint32_t def_trx_batch_ms = 5;
+   constexpr uint32_t def_compression_threshold = 4096;
+
+   /// identifies a packed transaction of a compact block; salted with the block id so collisions do not repeat across blocks
+   static uint64_t compact_short_id( const block_id_type& blk_id, const transaction_id_type& trx_id ) {
+      char buf[sizeof( blk_id._hash ) + sizeof( trx_id._hash )];
+      memcpy( buf, blk_id._hash, sizeof( blk_id._hash ) );
+      memcpy( buf + sizeof( blk_id._hash ), trx_id._hash, sizeof( trx_id._hash ) );
+      return fc::city_hash64( buf, sizeof( buf ) );
+   }
 
-   constexpr uint16_t net_version = proto_explicit_sync;
-
-   struct transaction_state {
-      transaction_id_type id;
-      uint32_t            block_num = 0; ///< the block number the transaction was included in
-      time_point_sec      expires;
+   /**
+    * A compact block received from a peer while its transactions are being collected. Blocks of a connection are
+    * applied in the order they were received, so a block waiting for transactions holds back the ones after it.
+    */
+   struct pending_compact_block {
+      block_id_type      id;
+      signed_block_ptr   block;
+      vector<uint32_t>   missing;                ///< receipt indexes still without their packed transaction
+      bool               full_requested = false; ///< rebuilding failed, waiting for the full block
+      bool               verified = false;       ///< full block received, or rebuilt block matches transaction_mroot
    };
 
-   typedef multi_index_container<
-      transaction_state,
-      indexed_by<
-         ordered_unique< tag<by_id>, member<transaction_state, transaction_id_type, &transaction_state::id >, sha256_less >,
-         ordered_non_unique< tag< by_expiry >, member< transaction_state,fc::time_point_sec,&transaction_state::expires >>,
-         ordered_non_unique<
-            tag<by_block_num>,
-            member< transaction_state,
-                    uint32_t,
-                    &transaction_state::block_num > >
-         >
-
-      > transaction_state_index;
-
    /**
     *
     */
@@ -366,9 +634,6 @@ namespace roxe {
       void operator() (node_transaction_state& nts) {
          nts.block_num = new_bnum;
       }
-      void operator() (transaction_state& ts) {
-         ts.block_num = new_bnum;
-      }
    };
 
    /**
@@ -389,11 +654,161 @@ namespace roxe {
       static bool populate(handshake_message& hello);
    };
 
+   struct message_type_name {
+      typedef const char* result_type;
+      template<typename T>
+      const char* operator()( const T& )const { return fc::get_typename<T>::name(); }
+   };
+
+   /// node wide totals for metrics_plugin, kept next to the per connection counters below
+   struct net_metrics {
+      fc::metrics::registry& r = fc::metrics::registry::instance();
+      fc::metrics::counter& received_messages = r.add_counter( "roxe_net_received_messages_total", "Messages received from peers" );
+      fc::metrics::counter& received_bytes    = r.add_counter( "roxe_net_received_bytes_total", "Bytes received from peers" );
+      fc::metrics::counter& sent_messages     = r.add_counter( "roxe_net_sent_messages_total", "Messages queued to be sent to peers" );
+      fc::metrics::counter& sent_bytes        = r.add_counter( "roxe_net_sent_bytes_total", "Bytes queued to be sent to peers" );
+      fc::metrics::counter& blocks_first      = r.add_counter( "roxe_net_blocks_first_total", "Blocks received before any other peer delivered them" );
+      fc::metrics::counter& blocks_duplicate  = r.add_counter( "roxe_net_blocks_duplicate_total", "Blocks received after another peer delivered them" );
+      fc::metrics::counter& transactions      = r.add_counter( "roxe_net_transactions_received_total", "Transactions received from peers" );
+      fc::metrics::gauge&   connections       = r.add_gauge( "roxe_net_connections", "Known connections, connected or not" );
+      fc::metrics::gauge&   connected_peers   = r.add_gauge( "roxe_net_connected_peers", "Connections with an open socket" );
+      fc::metrics::gauge&   lib_catchup       = r.add_gauge( "roxe_net_lib_catchup", "1 while syncing irreversible blocks from peers" );
+   };
+
+   static net_metrics& metrics() {
+      static net_metrics m;
+      return m;
+   }
+
+   /**
+    * Counters of a connection reported by net_plugin::stats. Received traffic is counted on the connection's
+    * read_strand and is therefore kept in relaxed atomics; everything else is only updated on the main thread.
+    */
+   struct connection_counters {
+      static constexpr std::array<uint32_t, 9> rtt_bounds_ms = {{1, 2, 5, 10, 20, 50, 100, 200, 500}};
+
+      connection_counters()
+      : received_count( new std::atomic<uint64_t>[net_message::count()]() )
+      , received_bytes( new std::atomic<uint64_t>[net_message::count()]() )
+      , sent_count( net_message::count() )
+      , sent_bytes( net_message::count() )
+      {}
+
+      void add_received( uint32_t which, uint64_t bytes ) {
+         if( which >= net_message::count() ) return;
+         received_count[which].fetch_add( 1, std::memory_order_relaxed );
+         received_bytes[which].fetch_add( bytes, std::memory_order_relaxed );
+         metrics().received_messages.inc();
+         metrics().received_bytes.inc( bytes );
+      }
+
+      /// @param buff a send buffer, its net_message which follows the message header in one byte
+      void add_sent( const vector<char>& buff ) {
+         if( buff.size() <= message_header_size ) return;
+         const uint32_t which = static_cast<unsigned char>( buff[message_header_size] );
+         if( which >= net_message::count() ) return;
+         ++sent_count[which];
+         sent_bytes[which] += buff.size();
+         metrics().sent_messages.inc();
+         metrics().sent_bytes.inc( buff.size() );
+      }
+
+      static constexpr int64_t failure_half_life_us = 600 * 1000000ll;
+
+      /// @param lag how long after its first arrival from any peer this peer delivered the block
+      void add_block_arrival( fc::microseconds lag ) {
+         if( lag.count() == 0 ) {
+            ++blocks_first;
+            metrics().blocks_first.inc();
+         } else {
+            ++blocks_duplicate;
+            metrics().blocks_duplicate.inc();
+         }
+         block_lag_us += (lag.count() - block_lag_us) / 8;
+      }
+
+      /// @return the failures of the peer, each one counted less the longer ago it happened
+      double failures( time_point now )const {
+         if( failure_score == 0 ) return 0;
+         return failure_score * std::exp2( -double( (now - last_failure).count() ) / failure_half_life_us );
+      }
+
+      void add_failure( time_point now ) {
+         failure_score = failures( now ) + 1;
+         last_failure = now;
+      }
+
+      void add_rtt( int64_t rtt_us ) {
+         rtt_last_us = rtt_us;
+         rtt_min_us = rtt_count ? std::min( rtt_min_us, rtt_us ) : rtt_us;
+         rtt_total_us += rtt_us;
+         ++rtt_count;
+         auto bucket = std::upper_bound( rtt_bounds_ms.begin(), rtt_bounds_ms.end(), rtt_us / 1000 );
+         ++rtt_histogram[bucket - rtt_bounds_ms.begin()];
+      }
+
+      void fill( connection_stats& stats )const {
+         for( uint32_t which = 0; which < net_message::count(); ++which ) {
+            message_traffic t;
+            t.received_count = received_count[which].load( std::memory_order_relaxed );
+            t.received_bytes = received_bytes[which].load( std::memory_order_relaxed );
+            t.sent_count = sent_count[which];
+            t.sent_bytes = sent_bytes[which];
+            if( !t.received_count && !t.sent_count ) continue;
+            net_message m;
+            m.set_which( which );
+            t.type = m.visit( message_type_name() );
+            stats.traffic.emplace_back( std::move( t ) );
+         }
+         if( rtt_count ) {
+            stats.rtt_last_us = rtt_last_us;
+            stats.rtt_min_us = rtt_min_us;
+            stats.rtt_avg_us = rtt_total_us / rtt_count;
+         }
+         stats.rtt_bounds_ms.assign( rtt_bounds_ms.begin(), rtt_bounds_ms.end() );
+         stats.rtt_histogram.assign( rtt_histogram.begin(), rtt_histogram.end() );
+         stats.blocks_first = blocks_first;
+         stats.blocks_duplicate = blocks_duplicate;
+         stats.block_lag_us = static_cast<int64_t>( block_lag_us );
+         stats.failures = failures( time_point::now() );
+      }
+
+      std::unique_ptr<std::atomic<uint64_t>[]> received_count;
+      std::unique_ptr<std::atomic<uint64_t>[]> received_bytes;
+      vector<uint64_t>                         sent_count;
+      vector<uint64_t>                         sent_bytes;
+      int64_t                                  rtt_last_us = 0;
+      int64_t                                  rtt_min_us = 0;
+      int64_t                                  rtt_total_us = 0;
+      uint64_t                                 rtt_count = 0;
+      std::array<uint32_t, rtt_bounds_ms.size() + 1> rtt_histogram{};
+      uint32_t                                 blocks_first = 0;
+      uint32_t                                 blocks_duplicate = 0;
+      double                                   block_lag_us = 0;  ///< moving average of add_block_arrival lags
+      double                                   failure_score = 0; ///< failures as of last_failure
+      time_point                               last_failure;
+   };
+
+   /// classes of outbound messages, in the order they are sent
+   enum class write_class : uint8_t {
+      block,       ///< new blocks, requested blocks and protocol messages
+      sync,        ///< blocks sent to a syncing peer
+      transaction  ///< transaction gossip, dropped when the peer falls behind
+   };
+
+   /**
+    * Outbound messages of a connection, one queue per write_class. Each write takes everything queued for blocks,
+    * then at most a quantum of bytes from the sync and the transaction queue, so a transaction flood never delays
+    * a block by more than one write and neither sync nor transactions starve.
+    */
    class queued_buffer : boost::noncopyable {
    public:
+      static constexpr uint32_t sync_quantum = def_send_buffer_size;
+      static constexpr uint32_t trx_quantum = def_send_buffer_size / 4;
+
       void clear_write_queue() {
-         _write_queue.clear();
-         _sync_write_queue.clear();
+         for( auto& q : _write_queues )
+            q.clear();
          _write_queue_size = 0;
       }
 
@@ -405,21 +820,29 @@ namespace roxe {
 
       uint32_t write_queue_size() const { return _write_queue_size; }
 
+      uint32_t dropped_trx_count() const { return _dropped_trx_count; }
+
       bool is_out_queue_empty() const { return _out_queue.empty(); }
 
       bool ready_to_send() const {
          // if out_queue is not empty then async_write is in progress
-         return ((!_sync_write_queue.empty() || !_write_queue.empty()) && _out_queue.empty());
+         return _out_queue.empty() &&
+                std::any_of( _write_queues.begin(), _write_queues.end(), []( const auto& q ) { return !q.empty(); } );
       }
 
+      /// @return false if the buffer is not queued because the peer already has too much to catch up on
+      bool within_budget( write_class cls, size_t size ) {
+         if( cls != write_class::transaction || _write_queue_size + size <= def_max_trx_write_queue_size )
+            return true;
+         ++_dropped_trx_count;
+         return false;
+      }
+
+      /// @return false if the queue grew beyond its limit, the connection should be closed
       bool add_write_queue( const std::shared_ptr<vector<char>>& buff,
                             std::function<void( boost::system::error_code, std::size_t )> callback,
-                            bool to_sync_queue ) {
-         if( to_sync_queue ) {
-            _sync_write_queue.push_back( {buff, callback} );
-         } else {
-            _write_queue.push_back( {buff, callback} );
-         }
+                            write_class cls ) {
+         _write_queues[static_cast<size_t>(cls)].push_back( {buff, callback} );
          _write_queue_size += buff->size();
          if( _write_queue_size > 2 * def_max_write_queue_size ) {
             return false;
@@ -427,13 +850,10 @@ namespace roxe {
          return true;
       }
 
-      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs ) {
-         if( _sync_write_queue.size() > 0 ) { // always send msgs from sync_write_queue first
-            fill_out_buffer( bufs, _sync_write_queue );
-         } else { // postpone real_time write_queue if sync queue is not empty
-            fill_out_buffer( bufs, _write_queue );
-            ROXE_ASSERT( _write_queue_size == 0, plugin_exception, "write queue size expected to be zero" );
-         }
+      void fill_out_buffer( std::vector<std::shared_ptr<vector<char>>>& bufs ) {
+         fill_out_buffer( bufs, _write_queues[static_cast<size_t>(write_class::block)], std::numeric_limits<uint32_t>::max() );
+         fill_out_buffer( bufs, _write_queues[static_cast<size_t>(write_class::sync)], sync_quantum );
+         fill_out_buffer( bufs, _write_queues[static_cast<size_t>(write_class::transaction)], trx_quantum );
       }
 
       void out_callback( boost::system::error_code ec, std::size_t w ) {
@@ -444,11 +864,13 @@ namespace roxe {
 
    private:
       struct queued_write;
-      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs,
-                            deque<queued_write>& w_queue ) {
-         while ( w_queue.size() > 0 ) {
+      void fill_out_buffer( std::vector<std::shared_ptr<vector<char>>>& bufs,
+                            deque<queued_write>& w_queue, uint32_t quantum ) {
+         uint32_t taken = 0;
+         while ( w_queue.size() > 0 && taken < quantum ) {
             auto& m = w_queue.front();
-            bufs.push_back( boost::asio::buffer( *m.buff ));
+            bufs.push_back( m.buff );
+            taken += m.buff->size();
             _write_queue_size -= m.buff->size();
             _out_queue.emplace_back( m );
             w_queue.pop_front();
@@ -462,8 +884,8 @@ namespace roxe {
       };
 
       uint32_t _write_queue_size = 0;
-      deque<queued_write> _write_queue;
-      deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
+      uint32_t _dropped_trx_count = 0;
+      std::array<deque<queued_write>, 3> _write_queues; // indexed by write_class
       deque<queued_write> _out_queue;
 
    }; // queued_buffer
@@ -478,10 +900,11 @@ namespace roxe {
       void initialize();
 
       peer_block_state_index  blk_state;
-      transaction_state_index trx_state;
+      peer_transaction_filter trx_state;
       optional<peer_sync_state>    peer_requested;  // this peer is requesting info from us
       boost::asio::io_context&                  server_ioc;
       boost::asio::io_context::strand           strand;
+      boost::asio::io_context::strand           read_strand; ///< on the net threads, decodes received messages
       socket_ptr                                socket;
 
       fc::message_buffer<1024*1024>    pending_message_buffer;
@@ -497,6 +920,7 @@ namespace roxe {
       int16_t                 sent_handshake_count = 0;
       bool                    connecting = false;
       bool                    syncing = false;
+      bool                    local_peer = false; ///< the peer runs on this host, set when the session starts
       uint16_t                protocol_version  = 0;
       string                  peer_addr;
       unique_ptr<boost::asio::steady_timer> response_expected;
@@ -504,6 +928,10 @@ namespace roxe {
       block_id_type          fork_head;
       uint32_t               fork_head_num = 0;
       optional<request_message> last_req;
+      deque<pending_compact_block> pending_compact_blocks;
+      vector<std::shared_ptr<vector<char>>> trx_batch; ///< packed_transaction send buffers not sent yet
+      uint32_t                trx_batch_size = 0;
+      connection_counters     counters;
 
       connection_status get_status()const {
          connection_status stat;
@@ -514,6 +942,29 @@ namespace roxe {
          return stat;
       }
 
+      static constexpr int64_t failure_penalty_us = 200 * 1000;
+
+      /**
+       * Expected delay in microseconds of a block exchanged with the peer, lower is better: how late the peer
+       * delivers blocks compared to the first peer to deliver them, its round trip time and a penalty per recent
+       * failure. Peers without measurements score 0 so they get tried.
+       */
+      double score( time_point now )const {
+         return counters.block_lag_us + (counters.rtt_count ? counters.rtt_total_us / counters.rtt_count : 0)
+                + counters.failures( now ) * failure_penalty_us;
+      }
+
+      connection_stats get_stats()const {
+         connection_stats stats;
+         stats.peer = peer_addr;
+         stats.connected = socket && socket->is_open() && !connecting;
+         stats.write_queue_bytes = buffer_queue.write_queue_size();
+         stats.dropped_trxs = buffer_queue.dropped_trx_count();
+         counters.fill( stats );
+         stats.score = score( time_point::now() );
+         return stats;
+      }
+
       /** \name Peer Timestamps
        *  Time message handling
        *  @{
@@ -568,11 +1019,14 @@ namespace roxe {
       void blk_send(const block_id_type& blkid);
       void stop_send();
 
-      void enqueue( const net_message &msg, bool trigger_send = true );
-      void enqueue_block( const signed_block_ptr& sb, bool trigger_send = true, bool to_sync_queue = false);
+      void enqueue( const net_message &msg, bool trigger_send = true, write_class cls = write_class::block );
+      void enqueue_block( const signed_block_ptr& sb, bool trigger_send = true, write_class cls = write_class::block);
+      /// queues a packed_transaction send buffer to be sent with others in a transaction_batch_message
+      void enqueue_batched_transaction( const std::shared_ptr<std::vector<char>>& send_buffer );
+      void flush_trx_batch();
       void enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                            bool trigger_send, int priority, go_away_reason close_after_send,
-                           bool to_sync_queue = false);
+                           write_class cls = write_class::block);
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -588,8 +1042,9 @@ namespace roxe {
                        bool trigger_send,
                        int priority,
                        std::function<void(boost::system::error_code, std::size_t)> callback,
-                       bool to_sync_queue = false);
+                       write_class cls = write_class::block);
       void do_queue_write(int priority);
+      void start_write(const std::shared_ptr<std::vector<std::shared_ptr<vector<char>>>>& out, int priority);
 
       bool add_peer_block(const peer_block_state& pbs);
       bool peer_has_block(const block_id_type& blkid);
@@ -638,6 +1093,19 @@ namespace roxe {
          ROXE_ASSERT( false, plugin_config_exception, "operator()(packed_transaction&&) should be called" );
       }
 
+      void operator()( const compressed_message& msg ) const {
+         ROXE_ASSERT( false, plugin_config_exception, "compressed_message is unpacked by decode_message" );
+      }
+      void operator()( compressed_message& msg ) const {
+         ROXE_ASSERT( false, plugin_config_exception, "compressed_message is unpacked by decode_message" );
+      }
+      void operator()( const transaction_batch_message& msg ) const {
+         ROXE_ASSERT( false, plugin_config_exception, "transaction_batch_message is unpacked by decode_message" );
+      }
+      void operator()( transaction_batch_message& msg ) const {
+         ROXE_ASSERT( false, plugin_config_exception, "transaction_batch_message is unpacked by decode_message" );
+      }
+
       void operator()( signed_block&& msg ) const {
          impl.handle_message( c, std::make_shared<signed_block>( std::move( msg ) ) );
       }
@@ -660,19 +1128,35 @@ namespace roxe {
          in_sync
       };
 
+      /// a block range requested from one peer during lib_catchup
+      struct sync_range {
+         connection_ptr peer;
+         uint32_t       start = 0;
+         uint32_t       end = 0;
+         uint32_t       next = 0;   ///< next block expected from the peer
+         time_point     requested;
+      };
+
       uint32_t       sync_known_lib_num;
       uint32_t       sync_last_requested_num;
       uint32_t       sync_next_expected_num;
       uint32_t       sync_req_span;
-      connection_ptr source;
+      uint32_t       sync_fetch_peers;
       stages         state;
 
+      std::map<uint32_t, sync_range>      sync_ranges;      ///< outstanding ranges by first block
+      std::map<uint32_t, uint32_t>        sync_unassigned;  ///< remainders of abandoned ranges, first to last block
+      /// blocks received ahead of sync_next_expected_num, bounded by the sync_fetch_peers * sync_req_span request window
+      std::map<uint32_t, std::pair<connection_ptr, signed_block_ptr>> sync_reorder;
+      std::map<connection_ptr, double>     sync_peer_rate;   ///< measured blocks per second of every peer
+      std::map<connection_ptr, time_point> sync_slow_peers;  ///< peers not given ranges until the time point
+
       chain_plugin* chain_plug = nullptr;
 
       constexpr static auto stage_str(stages s);
 
    public:
-      explicit sync_manager(uint32_t span);
+      sync_manager(uint32_t span, uint32_t fetch_peers);
       void set_state(stages s);
       bool sync_required();
       void send_handshakes();
@@ -680,6 +1164,8 @@ namespace roxe {
       bool is_active(const connection_ptr& conn);
       void reset_lib_num(const connection_ptr& conn);
       void request_next_chunk(const connection_ptr& conn = connection_ptr());
+      /// records the progress of the range a block belongs to; @return true if the block was held back for reordering
+      bool recv_sync_block(const connection_ptr& c, const signed_block_ptr& b, uint32_t blk_num);
       void start_sync(const connection_ptr& c, uint32_t target);
       void reassign_fetch(const connection_ptr& c, go_away_reason reason);
       bool verify_catchup(const connection_ptr& c, uint32_t num, const block_id_type& id);
@@ -687,12 +1173,32 @@ namespace roxe {
       void recv_block(const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num);
       void recv_handshake(const connection_ptr& c, const handshake_message& msg);
       void recv_notice(const connection_ptr& c, const notice_message& msg);
+      /// @return the measured blocks per second of the last ranges synced from the peer, 0 if none
+      double sync_rate(const connection_ptr& c) const {
+         auto itr = sync_peer_rate.find( c );
+         return itr == sync_peer_rate.end() ? 0 : itr->second;
+      }
+
+   private:
+      void reset_sync();
+      void abandon_range(const connection_ptr& c);
+      connection_ptr select_sync_peer(const connection_ptr& preferred, uint32_t start);
    };
 
    class dispatch_manager {
    public:
       std::multimap<block_id_type, connection_ptr, sha256_less> received_blocks;
       std::multimap<transaction_id_type, connection_ptr, sha256_less> received_transactions;
+      /// send buffers of reversible blocks, packed once and shared by every connection the block is sent to
+      std::map<block_id_type, std::shared_ptr<std::vector<char>>, sha256_less> block_buffers;
+
+      std::shared_ptr<std::vector<char>> get_block_buffer(const signed_block_ptr& sb, const block_id_type& id);
+      /// time every reversible block was first received or produced, to measure how late peers deliver it
+      std::map<block_id_type, time_point, sha256_less> block_arrivals;
+
+      void record_block_arrival(const connection_ptr& c, const block_id_type& id);
+      /// @return the connections ordered by connection::score, best first
+      vector<connection_ptr> ranked_connections()const;
 
       void bcast_transaction(const transaction_metadata_ptr& trx);
       void rejected_transaction(const transaction_id_type& msg);
@@ -707,14 +1213,71 @@ namespace roxe {
       void retry_fetch(const connection_ptr& conn);
    };
 
+   /**
+    * Downloads a snapshot served by peers into p2p-fetch-snapshot-to, then stops the node so that it can be restarted
+    * from it. Only snapshots of the trusted block are considered, and one is fetched once peers at min_peers distinct
+    * addresses with as many distinct node ids list it; a single host opening many connections counts once. It is
+    * fetched in snapshot_chunk_size chunks from all of them at once, and used only if its hash matches, it belongs to
+    * this chain and its head block is the trusted one. Runs on the main thread.
+    */
+   class snapshot_fetcher {
+   public:
+      static constexpr uint32_t max_chunks_per_peer = 4;
+      static constexpr int64_t  chunk_timeout_sec = 30;   ///< a chunk not received by then is requested again
+
+      snapshot_fetcher( bfs::path dir, block_id_type trusted_block_id, uint32_t min_peers );
+
+      void start();
+      void stop() { if( timer ) timer->cancel(); }
+
+      void recv_list( const connection_ptr& c, const snapshot_list_message& msg );
+      void recv_chunk( const connection_ptr& c, const snapshot_chunk_message& msg );
+
+   private:
+      struct pending_chunk {
+         connection_wptr peer;
+         time_point      requested;
+      };
+
+      struct offer {
+         string                 address;   ///< ip of the peer, without the port
+         fc::sha256             node_id;
+         vector<snapshot_info>  snapshots;
+      };
+
+      bfs::path                 dir;
+      block_id_type             trusted_block_id;
+      uint32_t                  min_peers = 3;
+      unique_ptr<boost::asio::steady_timer> timer;
+
+      std::map<connection_wptr, offer, std::owner_less<connection_wptr>> offers;
+      std::set<fc::sha256>      rejected;   ///< snapshots that failed verification
+
+      optional<snapshot_info>   target;
+      bfs::path                 part_path;
+      std::fstream              out;
+      std::deque<uint64_t>      unrequested;  ///< chunk indexes
+      std::map<uint64_t, pending_chunk> pending;
+      uint64_t                  chunk_count = 0;
+      uint64_t                  chunks_written = 0;
+      bool                      verifying = false;
+
+      void tick();
+      void select_target();
+      void request_chunks();
+      void abandon_chunk( uint64_t index );
+      void finish();
+      bool offers_target( const vector<snapshot_info>& list ) const;
+   };
+
    //---------------------------------------------------------------------------
 
    connection::connection( string endpoint )
       : blk_state(),
-        trx_state(),
         peer_requested(),
         server_ioc( my_impl->thread_pool->get_executor() ),
         strand( app().get_io_service() ),
+        read_strand( my_impl->thread_pool->get_executor() ),
         socket( std::make_shared<tcp::socket>( my_impl->thread_pool->get_executor() ) ),
         node_id(),
         last_handshake_recv(),
@@ -736,10 +1299,10 @@ namespace roxe {
 
    connection::connection( socket_ptr s )
       : blk_state(),
-        trx_state(),
         peer_requested(),
         server_ioc( my_impl->thread_pool->get_executor() ),
         strand( app().get_io_service() ),
+        read_strand( my_impl->thread_pool->get_executor() ),
         socket( s ),
         node_id(),
         last_handshake_recv(),
@@ -779,6 +1342,9 @@ namespace roxe {
       peer_requested.reset();
       blk_state.clear();
       trx_state.clear();
+      pending_compact_blocks.clear();
+      trx_batch.clear();
+      trx_batch_size = 0;
    }
 
    void connection::flush_queues() {
@@ -817,7 +1383,8 @@ namespace roxe {
       for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
          const bool found = known_ids.find( tx->id ) != known_ids.cend();
          if( !found ) {
-            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
+            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {},
+                         write_class::transaction );
          }
       }
    }
@@ -826,7 +1393,8 @@ namespace roxe {
       for(const auto& t : ids) {
          auto tx = my_impl->local_txns.get<by_id>().find(t);
          if( tx != my_impl->local_txns.end() ) {
-            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {} );
+            queue_write( tx->serialized_txn, true, priority::low, []( boost::system::error_code ec, std::size_t ) {},
+                         write_class::transaction );
          }
       }
    }
@@ -941,8 +1509,13 @@ namespace roxe {
                                 bool trigger_send,
                                 int priority,
                                 std::function<void(boost::system::error_code, std::size_t)> callback,
-                                bool to_sync_queue) {
-      if( !buffer_queue.add_write_queue( buff, callback, to_sync_queue )) {
+                                write_class cls) {
+      if( !buffer_queue.within_budget( cls, buff->size() ) ) {
+         fc_dlog( logger, "write queue ${s} bytes, dropped transaction ${n} to ${p}",
+                  ("s", buffer_queue.write_queue_size())("n", buffer_queue.dropped_trx_count())("p", peer_name()) );
+         return;
+      }
+      if( !buffer_queue.add_write_queue( buff, callback, cls )) {
          fc_wlog( logger, "write_queue full ${s} bytes, giving up on connection ${p}",
                   ("s", buffer_queue.write_queue_size())("p", peer_name()) );
          my_impl->close( shared_from_this() );
@@ -962,11 +1535,48 @@ namespace roxe {
          my_impl->close(c.lock());
          return;
       }
+      auto out = std::make_shared<std::vector<std::shared_ptr<vector<char>>>>();
+      buffer_queue.fill_out_buffer( *out );
+
+      // compressing for a peer on this host costs more time than the loopback copy it saves
+      const uint32_t threshold = protocol_version >= proto_compression && !local_peer ? my_impl->compression_threshold : 0;
+      if( threshold && std::any_of( out->begin(), out->end(), [threshold]( const auto& b ) { return b->size() > threshold; } ) ) {
+         // compress on a net thread, the write is started back on the main thread like every other socket operation;
+         // out_queue is not empty meanwhile, so nothing else is written to the peer in between
+         boost::asio::post( server_ioc, [c, socket=socket, out, threshold, priority]() {
+            try {
+               for( auto& b : *out ) {
+                  if( b->size() > threshold )
+                     b = my_impl->compressed_buffers.get( b );
+               }
+            } FC_LOG_AND_DROP()
+            app().post( priority, [c, socket, out, priority]() {
+               auto conn = c.lock();
+               if( conn && conn->socket == socket ) // not closed meanwhile
+                  conn->start_write( out, priority );
+            });
+         });
+         return;
+      }
+      start_write( out, priority );
+   }
+
+   void connection::start_write( const std::shared_ptr<std::vector<std::shared_ptr<vector<char>>>>& out, int priority ) {
+      connection_wptr c(shared_from_this());
+      if(!socket->is_open()) {
+         fc_elog(logger,"socket not open to ${p}",("p",peer_name()));
+         my_impl->close(c.lock());
+         return;
+      }
       std::vector<boost::asio::const_buffer> bufs;
-      buffer_queue.fill_out_buffer( bufs );
+      bufs.reserve( out->size() );
+      for( const auto& b : *out ) {
+         bufs.push_back( boost::asio::buffer( *b ) );
+         counters.add_sent( *b );
+      }
 
       boost::asio::async_write(*socket, bufs,
-            boost::asio::bind_executor(strand, [c, socket=socket, priority]( boost::system::error_code ec, std::size_t w ) {
+            boost::asio::bind_executor(strand, [c, socket=socket, out, priority]( boost::system::error_code ec, std::size_t w ) {
          app().post(priority, [c, priority, ec, w]() {
             try {
                auto conn = c.lock();
@@ -1027,6 +1637,24 @@ namespace roxe {
       }
    }
 
+   /// wraps an already packed value in a net_message without unpacking it
+   static std::shared_ptr<std::vector<char>> create_serialized_send_buffer( uint32_t which, const vector<char>& packed ) {
+      const uint32_t which_size = fc::raw::pack_size( unsigned_int( which ) );
+      const uint32_t payload_size = which_size + packed.size();
+
+      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
+      constexpr size_t header_size = sizeof( payload_size );
+      const size_t buffer_size = header_size + payload_size;
+
+      auto send_buffer = std::make_shared<vector<char>>( buffer_size );
+      fc::datastream<char*> ds( send_buffer->data(), buffer_size );
+      ds.write( header, header_size );
+      fc::raw::pack( ds, unsigned_int( which ) );
+      ds.write( packed.data(), packed.size() );
+
+      return send_buffer;
+   }
+
    bool connection::enqueue_sync_block() {
       if (!peer_requested)
          return false;
@@ -1038,9 +1666,18 @@ namespace roxe {
       }
       try {
          controller& cc = my_impl->chain_plug->chain();
+         if( num <= cc.last_irreversible_block_num() ) {
+            // irreversible blocks are sent as stored in the block log, they are neither unpacked nor packed again
+            auto packed = cc.fetch_serialized_block_by_number(num);
+            if( !packed.empty() ) {
+               enqueue_buffer( create_serialized_send_buffer( signed_block_which, packed ), trigger_send, priority::low, no_reason,
+                               write_class::sync );
+               return true;
+            }
+         }
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
-            enqueue_block( sb, trigger_send, true);
+            enqueue_block( sb, trigger_send, write_class::sync );
             return true;
          }
       } catch ( ... ) {
@@ -1049,7 +1686,7 @@ namespace roxe {
       return false;
    }
 
-   void connection::enqueue( const net_message& m, bool trigger_send ) {
+   void connection::enqueue( const net_message& m, bool trigger_send, write_class cls ) {
       go_away_reason close_after_send = no_reason;
       if (m.contains<go_away_message>()) {
          close_after_send = m.get<go_away_message>().reason;
@@ -1067,7 +1704,7 @@ namespace roxe {
       ds.write( header, header_size );
       fc::raw::pack( ds, m );
 
-      enqueue_buffer( send_buffer, trigger_send, priority::low, close_after_send );
+      enqueue_buffer( send_buffer, trigger_send, priority::low, close_after_send, cls );
    }
 
    template< typename T>
@@ -1102,13 +1739,199 @@ namespace roxe {
       return create_send_buffer( packed_transaction_which, trx );
    }
 
-   void connection::enqueue_block( const signed_block_ptr& sb, bool trigger_send, bool to_sync_queue) {
-      enqueue_buffer( create_send_buffer( sb ), trigger_send, priority::low, no_reason, to_sync_queue);
+   /// @return the send buffer of a compressed_message carrying the message of send_buffer
+   static std::shared_ptr<std::vector<char>> compress_send_buffer( const std::vector<char>& send_buffer ) {
+      namespace bio = boost::iostreams;
+      vector<char> compressed;
+      {
+         bio::filtering_ostream out;
+         out.push( bio::zlib_compressor( bio::zlib::best_speed ) );
+         out.push( bio::back_inserter( compressed ) );
+         out.write( send_buffer.data() + message_header_size, send_buffer.size() - message_header_size );
+      }
+      return create_send_buffer( compressed_message_which, compressed_message{ std::move( compressed ) } );
+   }
+
+   static vector<char> decompress_message( const vector<char>& data ) {
+      namespace bio = boost::iostreams;
+      bio::filtering_istream in;
+      in.push( bio::zlib_decompressor() );
+      in.push( bio::array_source( data.data(), data.size() ) );
+      vector<char> result;
+      char buf[64*1024];
+      while( in ) {
+         in.read( buf, sizeof( buf ) );
+         const auto n = in.gcount();
+         ROXE_ASSERT( result.size() + n <= max_decompressed_message_size, plugin_exception,
+                      "compressed message exceeds ${m} bytes", ("m", max_decompressed_message_size) );
+         result.insert( result.end(), buf, buf + n );
+      }
+      return result;
+   }
+
+   std::shared_ptr<vector<char>> compressed_buffer_cache::get( const std::shared_ptr<vector<char>>& buffer ) {
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         auto itr = entries.find( buffer.get() );
+         if( itr != entries.end() && itr->second.original.lock() == buffer )
+            return itr->second.compressed ? itr->second.compressed : buffer;
+      }
+      auto compressed = compress_send_buffer( *buffer );
+      if( compressed->size() >= buffer->size() )
+         compressed.reset(); // not worth it, send as is
+      std::lock_guard<std::mutex> g( mtx );
+      if( entries.size() > 256 ) {
+         for( auto itr = entries.begin(); itr != entries.end(); ) {
+            if( itr->second.original.expired() )
+               itr = entries.erase( itr );
+            else
+               ++itr;
+         }
+      }
+      entries[buffer.get()] = entry{ buffer, compressed };
+      return compressed ? compressed : buffer;
+   }
+
+   static fc::sha256 hash_file( const bfs::path& path ) {
+      std::ifstream in( path.generic_string(), std::ios::binary );
+      ROXE_ASSERT( in.good(), chain::snapshot_exception, "unable to open ${f}", ("f", path.generic_string()) );
+      fc::sha256::encoder enc;
+      vector<char> buf( snapshot_chunk_size );
+      while( in.read( buf.data(), buf.size() ) || in.gcount() > 0 )
+         enc.write( buf.data(), in.gcount() );
+      return enc.result();
+   }
+
+   vector<snapshot_info> snapshot_catalog::scan() {
+      static const string prefix = "snapshot-";
+      static const string diff_prefix = "snapshot-diff-";
+      static const string suffix = ".bin";
+
+      std::map<bfs::path, entry> found;
+      if( bfs::is_directory( dir ) ) {
+         for( const auto& f : bfs::directory_iterator( dir ) ) {
+            const string name = f.path().filename().generic_string();
+            if( name.size() <= prefix.size() + suffix.size() || name.compare( 0, prefix.size(), prefix ) != 0 ||
+                name.compare( 0, diff_prefix.size(), diff_prefix ) == 0 ||
+                name.compare( name.size() - suffix.size(), suffix.size(), suffix ) != 0 )
+               continue;
+            entry e;
+            try {
+               e.info.head_block_id = block_id_type( name.substr( prefix.size(), name.size() - prefix.size() - suffix.size() ) );
+               e.size = bfs::file_size( f.path() );
+               e.mtime = bfs::last_write_time( f.path() );
+            } catch( ... ) {
+               continue;
+            }
+            e.info.size = e.size;
+            found.emplace( f.path(), e );
+         }
+      }
+
+      for( auto& f : found ) {
+         {
+            std::lock_guard<std::mutex> g( mtx );
+            auto itr = entries.find( f.first );
+            if( itr != entries.end() && itr->second.size == f.second.size && itr->second.mtime == f.second.mtime ) {
+               f.second.info.hash = itr->second.info.hash;
+               continue;
+            }
+         }
+         try {
+            f.second.info.hash = hash_file( f.first );
+         } FC_LOG_AND_DROP()
+      }
+
+      vector<snapshot_info> result;
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         entries = std::move( found );
+         for( const auto& e : entries ) {
+            if( e.second.info.hash != fc::sha256() )
+               result.push_back( e.second.info );
+         }
+      }
+      std::sort( result.begin(), result.end(), []( const snapshot_info& a, const snapshot_info& b ) {
+         return block_header::num_from_id( a.head_block_id ) > block_header::num_from_id( b.head_block_id );
+      } );
+      if( result.size() > max_listed )
+         result.resize( max_listed );
+      return result;
+   }
+
+   bfs::path snapshot_catalog::find( const fc::sha256& hash ) {
+      std::lock_guard<std::mutex> g( mtx );
+      for( const auto& e : entries ) {
+         if( e.second.info.hash == hash )
+            return e.first;
+      }
+      return bfs::path();
+   }
+
+   static compact_block_message create_compact_block( const block_state_ptr& bs ) {
+      compact_block_message msg;
+      msg.header = bs->header;
+      msg.block_extensions = bs->block->block_extensions;
+      msg.transactions.reserve( bs->block->transactions.size() );
+      for( const auto& r : bs->block->transactions ) {
+         compact_transaction_receipt cr;
+         static_cast<transaction_receipt_header&>( cr ) = r;
+         if( r.trx.contains<transaction_id_type>() )
+            cr.trx = r.trx.get<transaction_id_type>();
+         else
+            cr.trx = compact_short_id( bs->id, r.trx.get<packed_transaction>().id() );
+         msg.transactions.emplace_back( std::move( cr ) );
+      }
+      return msg;
+   }
+
+   void connection::enqueue_block( const signed_block_ptr& sb, bool trigger_send, write_class cls) {
+      enqueue_buffer( my_impl->dispatcher->get_block_buffer( sb, sb->id() ), trigger_send, priority::low, no_reason, cls);
+   }
+
+   /// @return the send buffer of a transaction_batch_message made of packed_transaction send buffers
+   static std::shared_ptr<std::vector<char>> create_trx_batch_buffer( const vector<std::shared_ptr<vector<char>>>& trx_buffers ) {
+      // a packed_transaction send buffer holds the message header, the one byte which and the packed transaction
+      constexpr size_t trx_prefix_size = message_header_size + 1;
+      size_t trxs_size = 0;
+      for( const auto& b : trx_buffers )
+         trxs_size += b->size() - trx_prefix_size;
+
+      const uint32_t payload_size = fc::raw::pack_size( unsigned_int( trx_batch_which ) )
+                                    + fc::raw::pack_size( unsigned_int( trx_buffers.size() ) ) + trxs_size;
+      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
+      auto send_buffer = std::make_shared<vector<char>>( message_header_size + payload_size );
+      fc::datastream<char*> ds( send_buffer->data(), send_buffer->size() );
+      ds.write( header, message_header_size );
+      fc::raw::pack( ds, unsigned_int( trx_batch_which ) );
+      fc::raw::pack( ds, unsigned_int( trx_buffers.size() ) );
+      for( const auto& b : trx_buffers )
+         ds.write( b->data() + trx_prefix_size, b->size() - trx_prefix_size );
+      return send_buffer;
+   }
+
+   void connection::enqueue_batched_transaction( const std::shared_ptr<std::vector<char>>& send_buffer ) {
+      trx_batch.push_back( send_buffer );
+      trx_batch_size += send_buffer->size();
+      if( trx_batch_size >= my_impl->trx_batch_bytes ) {
+         flush_trx_batch();
+      } else {
+         my_impl->start_trx_batch_timer();
+      }
+   }
+
+   void connection::flush_trx_batch() {
+      if( trx_batch.empty() )
+         return;
+      auto send_buffer = trx_batch.size() == 1 ? trx_batch.front() : create_trx_batch_buffer( trx_batch );
+      trx_batch.clear();
+      trx_batch_size = 0;
+      enqueue_buffer( send_buffer, true, priority::low, no_reason, write_class::transaction );
    }
 
    void connection::enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                                     bool trigger_send, int priority, go_away_reason close_after_send,
-                                    bool to_sync_queue)
+                                    write_class cls)
    {
       connection_wptr weak_this = shared_from_this();
       queue_write(send_buffer,trigger_send, priority,
@@ -1125,7 +1948,7 @@ namespace roxe {
                         fc_wlog(logger, "connection expired before enqueued net_message called callback!");
                      }
                   },
-                  to_sync_queue);
+                  cls);
    }
 
    void connection::cancel_wait() {
@@ -1229,12 +2052,12 @@ namespace roxe {
 
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t fetch_peers )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
-      ,source()
+      ,sync_fetch_peers( std::max<uint32_t>( fetch_peers, 1 ) )
       ,state(in_sync)
    {
       chain_plug = app().find_plugin<chain_plugin>();
@@ -1269,16 +2092,17 @@ namespace roxe {
    }
 
    void sync_manager::reset_lib_num(const connection_ptr& c) {
-      if(state == in_sync) {
-         source.reset();
-      }
       if( c->current() ) {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num) {
             sync_known_lib_num =c->last_handshake_recv.last_irreversible_block_num;
          }
-      } else if( c == source ) {
-         sync_last_requested_num = 0;
-         request_next_chunk();
+      } else {
+         sync_peer_rate.erase( c );
+         sync_slow_peers.erase( c );
+         if( std::any_of( sync_ranges.begin(), sync_ranges.end(), [&c]( const auto& r ) { return r.second.peer == c; } ) ) {
+            abandon_range( c );
+            request_next_chunk();
+         }
       }
    }
 
@@ -1290,95 +2114,165 @@ namespace roxe {
               chain_plug->chain().fork_db_pending_head_block_num() < sync_last_requested_num );
    }
 
+   void sync_manager::reset_sync() {
+      sync_last_requested_num = 0;
+      sync_ranges.clear();
+      sync_unassigned.clear();
+      sync_reorder.clear();
+   }
+
+   void sync_manager::abandon_range(const connection_ptr& c) {
+      for( auto itr = sync_ranges.begin(); itr != sync_ranges.end(); ) {
+         if( itr->second.peer == c ) {
+            if( itr->second.next <= itr->second.end )
+               sync_unassigned[itr->second.next] = itr->second.end;
+            itr = sync_ranges.erase( itr );
+         } else {
+            ++itr;
+         }
+      }
+   }
+
+   connection_ptr sync_manager::select_sync_peer(const connection_ptr& preferred, uint32_t start) {
+      auto usable = [&]( const connection_ptr& c ) {
+         return c->current() && c->last_handshake_recv.last_irreversible_block_num >= start &&
+                std::none_of( sync_ranges.begin(), sync_ranges.end(), [&c]( const auto& r ) { return r.second.peer == c; } );
+      };
+      if( preferred && usable( preferred ) )
+         return preferred;
+
+      // fastest measured peer first, discounted by its recent failures, peers without a measurement are tried
+      // before slow ones; ties go to the better connection::score
+      const auto now = time_point::now();
+      connection_ptr best, slow;
+      double best_rate = -1;
+      double best_score = 0;
+      for( const auto& c : my_impl->connections ) {
+         if( !usable( c ) ) continue;
+         auto slow_itr = sync_slow_peers.find( c );
+         if( slow_itr != sync_slow_peers.end() && slow_itr->second > now ) {
+            if( !slow ) slow = c;
+            continue;
+         }
+         auto rate_itr = sync_peer_rate.find( c );
+         double rate = rate_itr == sync_peer_rate.end() ? std::numeric_limits<double>::max() : rate_itr->second;
+         rate /= 1 + c->counters.failures( now );
+         const double score = c->score( now );
+         if( rate > best_rate || (rate == best_rate && score < best_score) ) {
+            best_rate = rate;
+            best_score = score;
+            best = c;
+         }
+      }
+      // a slow peer is better than none while nothing else is outstanding
+      if( !best && sync_ranges.empty() )
+         best = slow;
+      return best;
+   }
+
    void sync_manager::request_next_chunk( const connection_ptr& conn ) {
-      uint32_t head_block = chain_plug->chain().fork_db_pending_head_block_num();
-
-      if (head_block < sync_last_requested_num && source && source->current()) {
-         fc_ilog(logger, "ignoring request, head is ${h} last req = ${r} source is ${p}",
-                  ("h",head_block)("r",sync_last_requested_num)("p",source->peer_name()));
-         return;
-      }
+      // ranges are requested from up to sync_fetch_peers peers at once, within a window of that many ranges past the
+      // next block to apply so the reorder buffer stays bounded
+      const uint32_t window_end = sync_next_expected_num + sync_fetch_peers * sync_req_span - 1;
+      bool request_sent = false;
+      bool no_peer = false;
+      while( sync_ranges.size() < sync_fetch_peers ) {
+         uint32_t start, end;
+         bool from_unassigned = !sync_unassigned.empty();
+         if( from_unassigned ) {
+            start = sync_unassigned.begin()->first;
+            end = sync_unassigned.begin()->second;
+         } else {
+            if( sync_last_requested_num >= sync_known_lib_num )
+               break;
+            start = std::max( sync_last_requested_num + 1, sync_next_expected_num );
+            end = std::min( { start + sync_req_span - 1, sync_known_lib_num, window_end } );
+            if( end < start )
+               break;
+         }
 
-      /* ----------
-       * next chunk provider selection criteria
-       * a provider is supplied and able to be used, use it.
-       * otherwise select the next available from the list, round-robin style.
-       */
+         connection_ptr peer = select_sync_peer( conn, start );
+         if( !peer ) {
+            no_peer = true;
+            break;
+         }
+         end = std::min( end, peer->last_handshake_recv.last_irreversible_block_num );
 
-      if (conn && conn->current() ) {
-         source = conn;
-      }
-      else {
-         if( my_impl->connections.size() == 0 ) {
-            source.reset();
-         } else if( my_impl->connections.size() == 1 ) {
-            if (!source) {
-               source = *my_impl->connections.begin();
-            }
+         if( from_unassigned ) {
+            auto itr = sync_unassigned.begin();
+            if( end < itr->second )
+               sync_unassigned[end + 1] = itr->second;
+            sync_unassigned.erase( itr );
          } else {
-            // init to a linear array search
-            auto cptr = my_impl->connections.begin();
-            auto cend = my_impl->connections.end();
-            // do we remember the previous source?
-            if( source ) {
-               //try to find it in the list
-               cptr = my_impl->connections.find( source );
-               cend = cptr;
-               if( cptr == my_impl->connections.end() ) {
-                  //not there - must have been closed! cend is now connections.end, so just flatten the ring.
-                  source.reset();
-                  cptr = my_impl->connections.begin();
-               } else {
-                  //was found - advance the start to the next. cend is the old source.
-                  if( ++cptr == my_impl->connections.end() && cend != my_impl->connections.end() ) {
-                     cptr = my_impl->connections.begin();
-                  }
-               }
-            }
-
-            //scan the list of peers looking for another able to provide sync blocks.
-            if( cptr != my_impl->connections.end() ) {
-               auto cstart_it = cptr;
-               do {
-                  //select the first one which is current and break out.
-                  if( (*cptr)->current() ) {
-                     source = *cptr;
-                     break;
-                  }
-                  if( ++cptr == my_impl->connections.end() )
-                     cptr = my_impl->connections.begin();
-               } while( cptr != cstart_it );
-            }
-            // no need to check the result, either source advanced or the whole list was checked and the old source is reused.
+            sync_last_requested_num = end;
          }
+
+         fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
+                 ("n",peer->peer_name())("s",start)("e",end));
+         sync_range r;
+         r.peer = peer;
+         r.start = start;
+         r.end = end;
+         r.next = start;
+         r.requested = time_point::now();
+         sync_ranges[start] = std::move( r );
+         peer->request_sync_blocks(start, end);
+         request_sent = true;
       }
 
-      // verify there is an available source
-      if (!source || !source->current() ) {
+      if( no_peer && sync_ranges.empty() ) {
          fc_elog( logger, "Unable to continue syncing at this time");
          sync_known_lib_num = chain_plug->chain().last_irreversible_block_num();
-         sync_last_requested_num = 0;
+         reset_sync();
          set_state(in_sync); // probably not, but we can't do anything else
          return;
       }
+      if( !request_sent && sync_ranges.empty() && conn && conn->current() ) {
+         conn->send_handshake();
+      }
+   }
 
-      bool request_sent = false;
-      if( sync_last_requested_num != sync_known_lib_num ) {
-         uint32_t start = sync_next_expected_num;
-         uint32_t end = start + sync_req_span - 1;
-         if( end > sync_known_lib_num )
-            end = sync_known_lib_num;
-         if( end > 0 && end >= start ) {
-            fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
-                    ("n",source->peer_name())("s",start)("e",end));
-            request_sent = true;
-            source->request_sync_blocks(start, end);
-            sync_last_requested_num = end;
+   bool sync_manager::recv_sync_block(const connection_ptr& c, const signed_block_ptr& b, uint32_t blk_num) {
+      if( state != lib_catchup )
+         return false;
+
+      auto itr = sync_ranges.upper_bound( blk_num );
+      if( itr != sync_ranges.begin() ) {
+         --itr;
+         auto& r = itr->second;
+         if( r.peer == c && blk_num >= r.start && blk_num <= r.end ) {
+            r.next = blk_num + 1;
+            if( blk_num == r.end ) {
+               auto elapsed = time_point::now() - r.requested;
+               double rate = (r.end - r.start + 1) * 1000000.0 / std::max<int64_t>( elapsed.count(), 1 );
+               auto rate_itr = sync_peer_rate.find( c );
+               if( rate_itr == sync_peer_rate.end() )
+                  sync_peer_rate[c] = rate;
+               else
+                  rate_itr->second = (rate_itr->second + rate) / 2;
+
+               // peers far slower than the fastest one are left out for a while when others can take their place
+               double fastest = 0;
+               for( const auto& pr : sync_peer_rate )
+                  fastest = std::max( fastest, pr.second );
+               if( sync_peer_rate.size() > 1 && sync_peer_rate[c] * 4 < fastest ) {
+                  fc_ilog( logger, "sync peer ${p} is slow, ${r} blocks/s", ("p", c->peer_name())("r", sync_peer_rate[c]) );
+                  sync_slow_peers[c] = time_point::now() + fc::seconds( 60 );
+               }
+               sync_ranges.erase( itr );
+               c->cancel_wait();
+               request_next_chunk();
+            } else {
+               c->sync_wait();
+            }
          }
       }
-      if( !request_sent ) {
-         source->send_handshake();
+
+      if( blk_num > sync_next_expected_num && blk_num <= sync_last_requested_num ) {
+         sync_reorder[blk_num] = std::make_pair( c, b );
+         return true;
       }
+      return false;
    }
 
    void sync_manager::send_handshakes()
@@ -1405,6 +2299,7 @@ namespace roxe {
 
       if (state == in_sync) {
          set_state(lib_catchup);
+         reset_sync();
          sync_next_expected_num = chain_plug->chain().last_irreversible_block_num() + 1;
       }
 
@@ -1418,9 +2313,11 @@ namespace roxe {
       fc_ilog(logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
               ( "cc",sync_last_requested_num)("ne",sync_next_expected_num)("p",c->peer_name()));
 
-      if (c == source) {
+      if( std::any_of( sync_ranges.begin(), sync_ranges.end(), [&c]( const auto& r ) { return r.second.peer == c; } ) ) {
          c->cancel_sync(reason);
-         sync_last_requested_num = 0;
+         abandon_range( c );
+         c->counters.add_failure( time_point::now() );
+         sync_slow_peers[c] = time_point::now() + fc::seconds( 60 );
          request_next_chunk();
       }
    }
@@ -1588,10 +2485,10 @@ namespace roxe {
    }
 
    void sync_manager::rejected_block(const connection_ptr& c, uint32_t blk_num) {
+      c->counters.add_failure( time_point::now() );
       if (state != in_sync ) {
          fc_wlog( logger, "block ${bn} not accepted from ${p}, closing connection", ("bn",blk_num)("p",c->peer_name()) );
-         sync_last_requested_num = 0;
-         source.reset();
+         reset_sync();
          my_impl->close(c);
          set_state(in_sync);
          send_handshakes();
@@ -1612,7 +2509,6 @@ namespace roxe {
       if (state == head_catchup) {
          fc_dlog(logger, "sync_manager in head_catchup state");
          set_state(in_sync);
-         source.reset();
 
          block_id_type null_id;
          for (const auto& cp : my_impl->connections) {
@@ -1636,14 +2532,20 @@ namespace roxe {
          if( blk_num == sync_known_lib_num ) {
             fc_dlog( logger, "All caught up with last known last irreversible block resending handshake");
             set_state(in_sync);
+            reset_sync();
             send_handshakes();
+            return;
          }
-         else if (blk_num == sync_last_requested_num) {
-            request_next_chunk();
-         }
-         else {
-            fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
-            c->sync_wait();
+         // the applied block moved the request window
+         request_next_chunk();
+         auto itr = sync_reorder.find( sync_next_expected_num );
+         if( itr != sync_reorder.end() ) {
+            auto peer = std::move( itr->second.first );
+            auto b = std::move( itr->second.second );
+            sync_reorder.erase( itr );
+            app().post( priority::medium, [peer{std::move( peer )}, b{std::move( b )}]() {
+               my_impl->process_block( peer, b );
+            } );
          }
       }
    }
@@ -1651,6 +2553,7 @@ namespace roxe {
    //------------------------------------------------------------------------
 
    void dispatch_manager::bcast_block(const block_state_ptr& bs) {
+      fc::tracing::scoped_span span( "net_bcast_block", bs->block_num );
       std::set<connection_ptr> skips;
       auto range = received_blocks.equal_range(bs->id);
       for (auto org = range.first; org != range.second; ++org) {
@@ -1660,9 +2563,15 @@ namespace roxe {
 
       uint32_t bnum = bs->block_num;
       peer_block_state pbstate{bs->id, bnum};
+      block_arrivals.emplace( bs->id, time_point::now() ); // produced here when not received
 
+      // peers almost always hold the packed transactions already, compact blocks only carry short ids of them
+      bool compact = std::any_of( bs->block->transactions.begin(), bs->block->transactions.end(),
+                                  []( const transaction_receipt& r ) { return r.trx.contains<packed_transaction>(); } );
       std::shared_ptr<std::vector<char>> send_buffer;
-      for( auto& cp : my_impl->connections ) {
+      std::shared_ptr<std::vector<char>> compact_buffer;
+      // the block reaches the rest of the network fastest through the peers quickest to pass it on
+      for( auto& cp : ranked_connections() ) {
          if( skips.find( cp ) != skips.end() || !cp->current() ) {
             continue;
          }
@@ -1672,8 +2581,16 @@ namespace roxe {
                fc_dlog( logger, "not bcast block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()) );
                continue;
             }
+            if( compact && cp->protocol_version >= proto_compact_blocks ) {
+               if( !compact_buffer ) {
+                  compact_buffer = create_send_buffer( compact_block_which, create_compact_block( bs ) );
+               }
+               fc_dlog(logger, "bcast compact block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()));
+               cp->enqueue_buffer( compact_buffer, true, priority::high, no_reason );
+               continue;
+            }
             if( !send_buffer ) {
-               send_buffer = create_send_buffer( bs->block );
+               send_buffer = get_block_buffer( bs->block, bs->id );
             }
             fc_dlog(logger, "bcast block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()));
             cp->enqueue_buffer( send_buffer, true, priority::high, no_reason );
@@ -1682,6 +2599,28 @@ namespace roxe {
 
    }
 
+   void dispatch_manager::record_block_arrival(const connection_ptr& c, const block_id_type& id) {
+      // blocks received while syncing were requested from one peer, they say nothing about its latency
+      if( my_impl->sync_master->syncing_with_peer() )
+         return;
+      const auto now = time_point::now();
+      auto itr = block_arrivals.emplace( id, now ).first;
+      c->counters.add_block_arrival( now - itr->second );
+   }
+
+   vector<connection_ptr> dispatch_manager::ranked_connections()const {
+      vector<connection_ptr> result( my_impl->connections.begin(), my_impl->connections.end() );
+      const auto now = time_point::now();
+      vector<std::pair<double, connection_ptr>> scored;
+      scored.reserve( result.size() );
+      for( auto& c : result )
+         scored.emplace_back( c->score( now ), std::move( c ) );
+      std::stable_sort( scored.begin(), scored.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+      for( size_t i = 0; i < scored.size(); ++i )
+         result[i] = std::move( scored[i].second );
+      return result;
+   }
+
    void dispatch_manager::recv_block(const connection_ptr& c, const block_id_type& id, uint32_t bnum) {
       received_blocks.insert(std::make_pair(id, c));
       if (c &&
@@ -1702,7 +2641,29 @@ namespace roxe {
       received_blocks.erase(range.first, range.second);
    }
 
+   std::shared_ptr<std::vector<char>> dispatch_manager::get_block_buffer(const signed_block_ptr& sb, const block_id_type& id) {
+      auto& buffer = block_buffers[id];
+      if( !buffer ) {
+         buffer = create_send_buffer( sb );
+      }
+      return buffer;
+   }
+
    void dispatch_manager::expire_blocks( uint32_t lib_num ) {
+      for( auto i = block_arrivals.begin(); i != block_arrivals.end(); ) {
+         if( block_header::num_from_id( i->first ) <= lib_num ) {
+            i = block_arrivals.erase( i );
+         } else {
+            ++i;
+         }
+      }
+      for( auto i = block_buffers.begin(); i != block_buffers.end(); ) {
+         if( block_header::num_from_id( i->first ) <= lib_num ) {
+            i = block_buffers.erase( i );
+         } else {
+            ++i;
+         }
+      }
       for( auto i = received_blocks.begin(); i != received_blocks.end(); ) {
          const block_id_type& blk_id = i->first;
          uint32_t blk_num = block_header::num_from_id( blk_id );
@@ -1734,17 +2695,15 @@ namespace roxe {
 
       auto buff = create_send_buffer( trx );
 
-      node_transaction_state nts = {id, trx_expiration, 0, buff};
+      node_transaction_state nts = {id, trx_expiration, 0, buff, ptrx->packed_trx};
       my_impl->local_txns.insert(std::move(nts));
 
       my_impl->send_transaction_to_all( buff, [&id, &skips, trx_expiration](const connection_ptr& c) -> bool {
          if( skips.find(c) != skips.end() || c->syncing ) {
             return false;
           }
-          const auto& bs = c->trx_state.find(id);
-          bool unknown = bs == c->trx_state.end();
+          bool unknown = c->trx_state.add( id, trx_expiration );
           if( unknown ) {
-             c->trx_state.insert(transaction_state({id,0,trx_expiration}));
              fc_dlog(logger, "sending trx to ${n}", ("n",c->peer_name() ) );
           }
           return unknown;
@@ -1848,8 +2807,7 @@ namespace roxe {
          }
          bool sendit = false;
          if (is_txn) {
-            auto trx = conn->trx_state.get<by_id>().find(tid);
-            sendit = trx != conn->trx_state.end();
+            sendit = conn->trx_state.contains(tid);
          }
          else {
             sendit = conn->peer_has_block(bid);
@@ -1945,6 +2903,16 @@ namespace roxe {
       } ) );
    }
 
+   /// @return true when the other end of socket is on this host
+   static bool is_local_peer( const tcp::socket& socket ) {
+      boost::system::error_code ec;
+      auto remote = socket.remote_endpoint( ec ).address();
+      if( ec )
+         return false;
+      auto local = socket.local_endpoint( ec ).address();
+      return !ec && (remote.is_loopback() || remote == local);
+   }
+
    bool net_plugin_impl::start_session(const connection_ptr& con) {
       boost::asio::ip::tcp::no_delay nodelay( true );
       boost::system::error_code ec;
@@ -1956,6 +2924,14 @@ namespace roxe {
          return false;
       }
       else {
+         con->local_peer = is_local_peer( *con->socket );
+         if( con->local_peer ) {
+            // let a whole block go through the kernel with one write and one read
+            boost::system::error_code bec;
+            con->socket->set_option( boost::asio::socket_base::send_buffer_size( def_send_buffer_size ), bec );
+            con->socket->set_option( boost::asio::socket_base::receive_buffer_size( def_send_buffer_size ), bec );
+            fc_dlog( logger, "${peer} is on this host", ("peer", con->peer_name()) );
+         }
          start_read_message( con );
          ++started_sessions;
          return true;
@@ -2072,61 +3048,88 @@ namespace roxe {
 
          boost::asio::async_read(*conn->socket,
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
-            boost::asio::bind_executor( conn->strand,
+            boost::asio::bind_executor( conn->read_strand,
               [this,weak_conn,socket=conn->socket]( boost::system::error_code ec, std::size_t bytes_transferred ) {
-            app().post( priority::medium, [this,weak_conn, socket, ec, bytes_transferred]() {
+            // frame and unpack the received messages here on the net thread, only decoded messages go to the main thread;
+            // the main thread does not touch pending_message_buffer until it starts the next read
+            auto conn = weak_conn.lock();
+            if (!conn || !socket->is_open()) {
+               return;
+            }
+            conn->outstanding_read_bytes.reset();
+
+            auto msgs = std::make_shared<std::deque<decoded_message>>(); // decoded_message cannot be copied, deque never relocates it
+            optional<string> error;
+            try {
+               if( !ec ) {
+                  if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
+                     fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
+                              ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
+                  }
+                  ROXE_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
+                  conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
+                  while (conn->pending_message_buffer.bytes_to_read() > 0) {
+                     uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+
+                     if (bytes_in_buffer < message_header_size) {
+                        conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
+                        break;
+                     } else {
+                        uint32_t message_length;
+                        auto index = conn->pending_message_buffer.read_index();
+                        conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
+                        if(message_length > def_send_buffer_size*2 || message_length == 0) {
+                           error = "incoming message length unexpected (" + std::to_string(message_length) + ")";
+                           break;
+                        }
+
+                        auto total_message_bytes = message_length + message_header_size;
+
+                        if (bytes_in_buffer >= total_message_bytes) {
+                           conn->pending_message_buffer.advance_read_ptr(message_header_size);
+                           decode_next_message( conn, message_length, *msgs );
+                        } else {
+                           auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
+                           auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
+                           if (outstanding_message_bytes > available_buffer_bytes) {
+                              conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
+                           }
+
+                           conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
+                           break;
+                        }
+                     }
+                  }
+               }
+            }
+            catch(const fc::exception &ex) {
+               error = "Exception in handling message: " + ex.to_detail_string();
+            }
+            catch(const std::exception &ex) {
+               error = string( "Exception in handling read data: " ) + ex.what();
+            }
+            catch (...) {
+               error = "Undefined exception handling the read data";
+            }
+
+            app().post( priority::medium, [this,weak_conn, socket, ec, msgs, error{std::move(error)}]() {
                auto conn = weak_conn.lock();
                if (!conn || !conn->socket || !conn->socket->is_open() || !socket->is_open()) {
                   return;
                }
 
-               conn->outstanding_read_bytes.reset();
-
                try {
                   if( !ec ) {
-                     if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
-                        fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
-                                 ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
-                     }
-                     ROXE_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
-                     conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
-                     while (conn->pending_message_buffer.bytes_to_read() > 0) {
-                        uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
-
-                        if (bytes_in_buffer < message_header_size) {
-                           conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
-                           break;
-                        } else {
-                           uint32_t message_length;
-                           auto index = conn->pending_message_buffer.read_index();
-                           conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
-                           if(message_length > def_send_buffer_size*2 || message_length == 0) {
-                              boost::system::error_code ec;
-                              fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
-                                       ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))) );
-                              close(conn);
-                              return;
-                           }
-
-                           auto total_message_bytes = message_length + message_header_size;
-
-                           if (bytes_in_buffer >= total_message_bytes) {
-                              conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!process_next_message(conn, message_length)) {
-                                 return;
-                              }
-                           } else {
-                              auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
-                              auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
-                              if (outstanding_message_bytes > available_buffer_bytes) {
-                                 conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
-                              }
-
-                              conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
-                              break;
-                           }
+                     for( auto& m : *msgs ) {
+                        if( !process_decoded_message( conn, m ) ) {
+                           return;
                         }
                      }
+                     if( error ) {
+                        fc_elog( logger, "${e}, from ${p}", ("e", *error)("p", conn->peer_name()) );
+                        close( conn );
+                        return;
+                     }
                      start_read_message(conn);
                   } else {
                      auto pname = conn->peer_name();
@@ -2161,19 +3164,70 @@ namespace roxe {
       }
    }
 
-   bool net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length) {
-      try {
-         // if next message is a block we already have, exit early
-         auto peek_ds = conn->pending_message_buffer.create_peek_datastream();
-         unsigned_int which{};
-         fc::raw::unpack( peek_ds, which );
-         if( which == signed_block_which ) {
-            block_header bh;
-            fc::raw::unpack( peek_ds, bh );
+   void net_plugin_impl::decode_next_message(const connection_ptr& conn, uint32_t message_length, deque<decoded_message>& out) {
+      fc::tracing::scoped_span span( "net_decode_message" );
+      auto ds = conn->pending_message_buffer.create_datastream();
+      net_message msg;
+      fc::raw::unpack( ds, msg );
+      if( msg.contains<signed_block>() )
+         span.set_arg( msg.get<signed_block>().block_num() );
+      conn->counters.add_received( msg.which(), message_length + message_header_size );
+      decode_message( std::move( msg ), out );
+   }
+
+   void net_plugin_impl::decode_message(net_message&& msg, deque<decoded_message>& out, bool allow_compressed) {
+      if( msg.contains<compressed_message>() ) {
+         ROXE_ASSERT( allow_compressed, plugin_exception, "nested compressed message" );
+         auto data = decompress_message( msg.get<compressed_message>().data );
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         net_message inner;
+         fc::raw::unpack( ds, inner );
+         decode_message( std::move( inner ), out, false );
+         return;
+      }
+      if( msg.contains<transaction_batch_message>() ) {
+         for( auto& trx : msg.get<transaction_batch_message>().transactions )
+            out.emplace_back( decode_transaction( std::make_shared<packed_transaction>( std::move( trx ) ) ) );
+         return;
+      }
+      if( msg.contains<packed_transaction>() ) {
+         out.emplace_back( decode_transaction( std::make_shared<packed_transaction>( std::move( msg.get<packed_transaction>() ) ) ) );
+         return;
+      }
+      out.emplace_back();
+      decoded_message& result = out.back();
+      result.msg = std::move( msg );
+      if( result.msg.contains<signed_block>() ) {
+         result.block = std::make_shared<signed_block>( std::move( result.msg.get<signed_block>() ) );
+         result.block_id = result.block->id();
+         result.msg = net_message();
+      }
+   }
+
+   decoded_message net_plugin_impl::decode_transaction(packed_transaction_ptr ptrx) {
+      decoded_message result;
+      // hopeless transactions are dropped before their metadata is created and their keys are recovered
+      if( ( result.rejected_trx = chain_plug->prefilter_transaction( *ptrx ) ) )
+         return result;
+      auto mtrx = std::make_shared<transaction_metadata>( ptrx );
+      if( !received_trxs.add( mtrx->id, ptrx->expiration() ) ) {
+         result.duplicate_trx = mtrx->id;
+         return result;
+      }
+      // the transaction is not shared yet, so its recovery may be started here; the producer reuses the future
+      transaction_metadata::start_recover_keys( mtrx, thread_pool->get_executor(), chain_id,
+                                                fc::microseconds( trx_recovery_time_limit_us.load() ) );
+      result.trx = std::move( mtrx );
+      return result;
+   }
 
+   bool net_plugin_impl::process_decoded_message(const connection_ptr& conn, decoded_message& m) {
+      try {
+         if( m.block ) {
+            // if the block is one we already have, exit early
             const controller& cc = chain_plug->chain();
-            const block_id_type blk_id = bh.id();
-            const uint32_t blk_num = bh.block_num();
+            const block_id_type& blk_id = m.block_id;
+            const uint32_t blk_num = block_header::num_from_id( blk_id );
             if( !sync_master->syncing_with_peer() ) {
                uint32_t lib = cc.last_irreversible_block_num();
                if( blk_num < lib ) {
@@ -2187,30 +3241,31 @@ namespace roxe {
                      conn->send_handshake();
                      conn->cancel_wait();
                   }
-
-                  conn->pending_message_buffer.advance_read_ptr( message_length );
                   return true;
                }
             }
             if( cc.fetch_block_by_id( blk_id ) ) {
+               dispatcher->record_block_arrival( conn, blk_id );
                if( sync_master->syncing_with_peer() )
                   sync_master->recv_block( conn, blk_id, blk_num );
                conn->cancel_wait();
-               conn->pending_message_buffer.advance_read_ptr( message_length );
                return true;
             }
-         }
-
-         auto ds = conn->pending_message_buffer.create_datastream();
-         net_message msg;
-         fc::raw::unpack( ds, msg );
-         msg_handler m( *this, conn );
-         if( msg.contains<signed_block>() ) {
-            m( std::move( msg.get<signed_block>() ) );
-         } else if( msg.contains<packed_transaction>() ) {
-            m( std::move( msg.get<packed_transaction>() ) );
+            if( sync_master->recv_sync_block( conn, m.block, blk_num ) ) {
+               return true;
+            }
+            handle_message( conn, m.block );
+         } else if( m.trx ) {
+            handle_message( conn, m.trx );
+         } else if( m.rejected_trx ) {
+            fc_dlog( logger, "dropping transaction from ${p}: ${why}", ("p", conn->peer_name())("why", m.rejected_trx->what()) );
+         } else if( m.duplicate_trx ) {
+            fc_dlog( logger, "got a duplicate transaction - dropping" );
+            if( local_txns.get<by_id>().find( *m.duplicate_trx ) == local_txns.end() )
+               dispatcher->recv_transaction( conn, *m.duplicate_trx );
          } else {
-            msg.visit( m );
+            msg_handler h( *this, conn );
+            m.msg.visit( h );
          }
       } catch( const fc::exception& e ) {
          fc_elog( logger, "Exception in handling message from ${p}: ${s}",
@@ -2236,7 +3291,10 @@ namespace roxe {
    void net_plugin_impl::send_transaction_to_all(const std::shared_ptr<std::vector<char>>& send_buffer, VerifierFunc verify) {
       for( auto &c : connections) {
          if( c->current() && verify( c )) {
-            c->enqueue_buffer( send_buffer, true, priority::low, no_reason );
+            if( trx_batch_period.count() > 0 && c->protocol_version >= proto_trx_batches )
+               c->enqueue_batched_transaction( send_buffer );
+            else
+               c->enqueue_buffer( send_buffer, true, priority::low, no_reason, write_class::transaction );
          }
       }
    }
@@ -2370,6 +3428,7 @@ namespace roxe {
          if (c->sent_handshake_count == 0) {
             c->send_handshake();
          }
+         send_snapshot_list( c );
       }
 
       c->last_handshake_recv = msg;
@@ -2412,6 +3471,10 @@ namespace roxe {
          }
 
       c->offset = (double(c->rec - c->org) + double(msg.xmt - c->dst)) / 2;
+      // round trip delay, the time the peer held the message excluded
+      const int64_t rtt_ns = (c->dst - c->org) - (c->xmt - c->rec);
+      if( rtt_ns >= 0 )
+         c->counters.add_rtt( rtt_ns / 1000 );
       double NsecPerUsec{1000};
 
       if(logger.is_enabled(fc::log_level::all))
@@ -2541,24 +3604,30 @@ namespace roxe {
    }
 
    void net_plugin_impl::handle_message(const connection_ptr& c, const packed_transaction_ptr& trx) {
+      handle_message( c, std::make_shared<transaction_metadata>( trx ) );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const transaction_metadata_ptr& ptrx) {
       fc_dlog(logger, "got a packed transaction, cancel wait");
       peer_ilog(c, "received packed_transaction");
+      metrics().transactions.inc();
       controller& cc = my_impl->chain_plug->chain();
+      const auto& tid = ptrx->id;
       if( cc.get_read_mode() == roxe::db_read_mode::READ_ONLY ) {
          fc_dlog(logger, "got a txn in read-only mode - dropping");
+         received_trxs.remove( tid );
          return;
       }
       if( sync_master->is_active(c) ) {
          fc_dlog(logger, "got a txn during sync - dropping");
+         received_trxs.remove( tid );
          return;
       }
 
-      auto ptrx = std::make_shared<transaction_metadata>( trx );
-      const auto& tid = ptrx->id;
-
       if( c->trx_in_progress_size > def_max_trx_in_progress_size ) {
          fc_wlog( logger, "Dropping trx ${id}, too many trx in progress ${s} bytes",
                   ("id", tid)("s", c->trx_in_progress_size) );
+         received_trxs.remove( tid );
          return;
       }
 
@@ -2588,15 +3657,398 @@ namespace roxe {
    }
 
    void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg) {
+      // a full block requested for, or overtaking, a compact block takes its place in the queue
+      if( !c->pending_compact_blocks.empty() ) {
+         const block_id_type blk_id = msg->id();
+         auto itr = std::find_if( c->pending_compact_blocks.begin(), c->pending_compact_blocks.end(),
+                                  [&blk_id]( const pending_compact_block& p ) { return p.id == blk_id; } );
+         if( itr != c->pending_compact_blocks.end() ) {
+            itr->block = msg;
+            itr->missing.clear();
+            itr->full_requested = false;
+            itr->verified = true;
+            process_compact_blocks( c );
+            return;
+         }
+      }
+      process_block( c, msg );
+   }
+
+   static void request_full_block( const connection_ptr& c, pending_compact_block& p ) {
+      p.full_requested = true;
+      request_message req;
+      req.req_blocks.mode = normal;
+      req.req_blocks.ids.push_back( p.id );
+      c->enqueue( req );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const compact_block_message& msg) {
+      controller& cc = chain_plug->chain();
+      const block_id_type blk_id = msg.header.id();
+      const uint32_t blk_num = msg.header.block_num();
+      peer_dlog( c, "received compact block ${n}, ${t} transactions", ("n", blk_num)("t", msg.transactions.size()) );
+      c->cancel_wait();
+
+      if( cc.fetch_block_by_id( blk_id ) ) {
+         dispatcher->record_block_arrival( c, blk_id );
+         if( sync_master->syncing_with_peer() )
+            sync_master->recv_block( c, blk_id, blk_num );
+         return;
+      }
+      if( c->pending_compact_blocks.size() >= max_pending_compact_blocks ) {
+         peer_wlog( c, "too many compact blocks waiting for transactions, dropping them" );
+         c->pending_compact_blocks.clear();
+      }
+
+      pending_compact_block p;
+      p.id = blk_id;
+      p.block = std::make_shared<signed_block>( msg.header );
+      p.block->block_extensions = msg.block_extensions;
+      p.block->transactions.resize( msg.transactions.size() );
+
+      std::unordered_map<uint64_t, uint32_t> wanted;
+      for( uint32_t i = 0; i < msg.transactions.size(); ++i ) {
+         const auto& cr = msg.transactions[i];
+         auto& r = p.block->transactions[i];
+         static_cast<transaction_receipt_header&>( r ) = cr;
+         if( cr.trx.contains<transaction_id_type>() ) {
+            r.trx = cr.trx.get<transaction_id_type>();
+         } else if( !wanted.emplace( cr.trx.get<uint64_t>(), i ).second ) {
+            p.missing.push_back( i ); // short id collision within the block, ask for it
+         }
+      }
+      for( const auto& t : local_txns ) {
+         if( !t.packed_trx ) continue;
+         auto itr = wanted.find( compact_short_id( blk_id, t.id ) );
+         if( itr == wanted.end() ) continue;
+         p.block->transactions[itr->second].trx = *t.packed_trx;
+         wanted.erase( itr );
+         if( wanted.empty() ) break;
+      }
+      for( const auto& w : wanted )
+         p.missing.push_back( w.second );
+      std::sort( p.missing.begin(), p.missing.end() );
+
+      c->pending_compact_blocks.emplace_back( std::move( p ) );
+      auto& pending = c->pending_compact_blocks.back();
+      if( !pending.missing.empty() ) {
+         peer_dlog( c, "requesting ${m} of ${t} transactions of compact block ${n}",
+                    ("m", pending.missing.size())("t", msg.transactions.size())("n", blk_num) );
+         c->enqueue( get_block_transactions_message{ blk_id, pending.missing } );
+         return;
+      }
+      process_compact_blocks( c );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const get_block_transactions_message& msg) {
+      block_transactions_message resp;
+      resp.id = msg.id;
+      signed_block_ptr b;
+      try {
+         b = chain_plug->chain().fetch_block_by_id( msg.id );
+      } FC_LOG_AND_DROP()
+      if( b ) {
+         resp.transactions.reserve( msg.indexes.size() );
+         for( auto i : msg.indexes ) {
+            if( i >= b->transactions.size() || !b->transactions[i].trx.contains<packed_transaction>() ) {
+               resp.transactions.clear();
+               break;
+            }
+            resp.transactions.push_back( b->transactions[i].trx.get<packed_transaction>() );
+         }
+      }
+      c->enqueue( resp );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const block_transactions_message& msg) {
+      auto itr = std::find_if( c->pending_compact_blocks.begin(), c->pending_compact_blocks.end(),
+                               [&msg]( const pending_compact_block& p ) { return p.id == msg.id; } );
+      if( itr == c->pending_compact_blocks.end() || itr->missing.empty() || itr->full_requested )
+         return;
+      if( msg.transactions.size() == itr->missing.size() ) {
+         for( size_t i = 0; i < msg.transactions.size(); ++i )
+            itr->block->transactions[itr->missing[i]].trx = msg.transactions[i];
+         itr->missing.clear();
+      } else {
+         peer_dlog( c, "peer does not have the transactions of compact block ${n}", ("n", block_header::num_from_id( msg.id )) );
+         request_full_block( c, *itr );
+      }
+      process_compact_blocks( c );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const snapshot_list_message& msg) {
+      peer_dlog( c, "peer serves ${n} snapshots", ("n", msg.snapshots.size()) );
+      if( snapshot_fetch )
+         snapshot_fetch->recv_list( c, msg );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const snapshot_chunk_request_message& msg) {
+      if( !serve_snapshots ) {
+         c->enqueue( snapshot_chunk_message{ msg.hash, msg.offset, {} }, true, write_class::sync );
+         return;
+      }
+      // read on a net thread, the main thread only queues the chunk
+      boost::asio::post( thread_pool->get_executor(), [this, c, msg]() {
+         snapshot_chunk_message resp{ msg.hash, msg.offset, {} };
+         try {
+            auto path = snapshots.find( msg.hash );
+            if( !path.empty() ) {
+               std::ifstream in( path.generic_string(), std::ios::binary );
+               resp.data.resize( std::min( msg.size, snapshot_chunk_size ) );
+               in.seekg( msg.offset );
+               in.read( resp.data.data(), resp.data.size() );
+               resp.data.resize( in.gcount() );
+            }
+         } FC_LOG_AND_DROP()
+         app().post( priority::low, [c, resp{std::move( resp )}]() {
+            c->enqueue( resp, true, write_class::sync );
+         } );
+      } );
+   }
+
+   void net_plugin_impl::handle_message(const connection_ptr& c, const snapshot_chunk_message& msg) {
+      if( snapshot_fetch )
+         snapshot_fetch->recv_chunk( c, msg );
+   }
+
+   void net_plugin_impl::send_snapshot_list(const connection_ptr& c) {
+      if( serve_snapshots && c->protocol_version >= proto_snapshots && !served_snapshots.empty() )
+         c->enqueue( snapshot_list_message{ served_snapshots } );
+   }
+
+   snapshot_fetcher::snapshot_fetcher( bfs::path dir, block_id_type trusted_block_id, uint32_t min_peers )
+   : dir( std::move( dir ) ), trusted_block_id( std::move( trusted_block_id ) ), min_peers( std::max<uint32_t>( min_peers, 1 ) ) {
+   }
+
+   void snapshot_fetcher::start() {
+      if( !timer )
+         timer.reset( new boost::asio::steady_timer( my_impl->thread_pool->get_executor() ) );
+      timer->expires_from_now( std::chrono::seconds( 1 ) );
+      timer->async_wait( [this]( boost::system::error_code ec ) {
+         if( ec )
+            return;
+         app().post( priority::low, [this]() {
+            tick();
+            start();
+         } );
+      } );
+   }
+
+   void snapshot_fetcher::recv_list( const connection_ptr& c, const snapshot_list_message& msg ) {
+      boost::system::error_code ec;
+      auto rep = c->socket->remote_endpoint( ec );
+      if( ec )
+         return;
+      offers[c] = offer{ rep.address().to_string(), c->node_id, msg.snapshots };
+      request_chunks();
+   }
+
+   bool snapshot_fetcher::offers_target( const vector<snapshot_info>& list ) const {
+      return target && std::any_of( list.begin(), list.end(), [this]( const snapshot_info& i ) {
+         return i.hash == target->hash && i.head_block_id == target->head_block_id && i.size == target->size;
+      } );
+   }
+
+   void snapshot_fetcher::tick() {
+      for( auto itr = offers.begin(); itr != offers.end(); ) {
+         auto c = itr->first.lock();
+         if( !c || !c->connected() )
+            itr = offers.erase( itr );
+         else
+            ++itr;
+      }
+      if( !target ) {
+         select_target();
+         return;
+      }
+      const auto now = time_point::now();
+      vector<uint64_t> abandoned;
+      for( const auto& p : pending ) {
+         auto c = p.second.peer.lock();
+         if( !c || !c->connected() || now - p.second.requested > fc::seconds( chunk_timeout_sec ) )
+            abandoned.push_back( p.first );
+      }
+      for( auto index : abandoned )
+         abandon_chunk( index );
+      request_chunks();
+   }
+
+   void snapshot_fetcher::select_target() {
+      // connections, and the node ids peers claim, are free to make; count the hosts listing a snapshot
+      std::map<std::pair<fc::sha256, uint64_t>, std::pair<std::set<string>, std::set<fc::sha256>>> votes;
+      for( const auto& o : offers ) {
+         for( const auto& i : o.second.snapshots ) {
+            if( rejected.count( i.hash ) || i.head_block_id != trusted_block_id )
+               continue;
+            auto& v = votes[std::make_pair( i.hash, i.size )];
+            v.first.insert( o.second.address );
+            v.second.insert( o.second.node_id );
+         }
+      }
+      size_t listed_by = 0;
+      for( const auto& v : votes ) {
+         size_t peers = std::min( v.second.first.size(), v.second.second.size() );
+         if( peers < min_peers || peers <= listed_by )
+            continue;
+         target = snapshot_info{ trusted_block_id, v.first.first, v.first.second };
+         listed_by = peers;
+      }
+      if( !target )
+         return;
+
+      fc_ilog( logger, "fetching snapshot of block ${n} ${id}, ${s} bytes listed by ${p} peers",
+               ("n", block_header::num_from_id( target->head_block_id ))("id", target->head_block_id)("s", target->size)("p", listed_by) );
+      if( !bfs::is_directory( dir ) )
+         bfs::create_directories( dir );
+      part_path = dir / fc::format_string( "snapshot-${id}.bin.part", fc::mutable_variant_object()("id", target->head_block_id) );
+      out.close();
+      out.open( part_path.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+      out.close();
+      bfs::resize_file( part_path, target->size );
+      out.open( part_path.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      ROXE_ASSERT( out.good(), chain::snapshot_exception, "unable to open ${f}", ("f", part_path.generic_string()) );
+
+      chunk_count = (target->size + snapshot_chunk_size - 1) / snapshot_chunk_size;
+      chunks_written = 0;
+      unrequested.clear();
+      pending.clear();
+      for( uint64_t i = 0; i < chunk_count; ++i )
+         unrequested.push_back( i );
+      if( chunk_count == 0 )
+         finish();
+      else
+         request_chunks();
+   }
+
+   void snapshot_fetcher::request_chunks() {
+      if( !target || verifying )
+         return;
+      for( const auto& o : offers ) {
+         if( unrequested.empty() )
+            return;
+         auto c = o.first.lock();
+         if( !c || !c->connected() || !offers_target( o.second.snapshots ) )
+            continue;
+         uint32_t outstanding = std::count_if( pending.begin(), pending.end(), [&c]( const auto& p ) {
+            return p.second.peer.lock() == c;
+         } );
+         for( ; outstanding < max_chunks_per_peer && !unrequested.empty(); ++outstanding ) {
+            const uint64_t index = unrequested.front();
+            unrequested.pop_front();
+            const uint64_t offset = index * snapshot_chunk_size;
+            const uint32_t size = std::min<uint64_t>( snapshot_chunk_size, target->size - offset );
+            pending[index] = pending_chunk{ c, time_point::now() };
+            c->enqueue( snapshot_chunk_request_message{ target->hash, offset, size } );
+         }
+      }
+   }
+
+   void snapshot_fetcher::abandon_chunk( uint64_t index ) {
+      if( pending.erase( index ) )
+         unrequested.push_front( index );
+   }
+
+   void snapshot_fetcher::recv_chunk( const connection_ptr& c, const snapshot_chunk_message& msg ) {
+      if( !target || verifying || msg.hash != target->hash || msg.offset % snapshot_chunk_size != 0 )
+         return;
+      const uint64_t index = msg.offset / snapshot_chunk_size;
+      auto itr = pending.find( index );
+      if( itr == pending.end() || itr->second.peer.lock() != c )
+         return;
+      const uint64_t expected = std::min<uint64_t>( snapshot_chunk_size, target->size - msg.offset );
+      if( msg.data.size() != expected ) {
+         peer_wlog( c, "peer no longer serves snapshot ${id}", ("id", target->head_block_id) );
+         offers.erase( c );
+         abandon_chunk( index );
+         request_chunks();
+         return;
+      }
+      out.seekp( msg.offset );
+      out.write( msg.data.data(), msg.data.size() );
+      ROXE_ASSERT( out.good(), chain::snapshot_exception, "unable to write ${f}", ("f", part_path.generic_string()) );
+      pending.erase( itr );
+      if( ++chunks_written == chunk_count )
+         finish();
+      else
+         request_chunks();
+   }
+
+   void snapshot_fetcher::finish() {
+      out.close();
+      verifying = true;
+      fc_ilog( logger, "fetched snapshot ${id}, verifying it", ("id", target->head_block_id) );
+      boost::asio::post( my_impl->thread_pool->get_executor(), [this, info = *target, path = part_path, chain_id = my_impl->chain_id]() {
+         string error;
+         try {
+            ROXE_ASSERT( hash_file( path ) == info.hash, chain::snapshot_validation_exception, "hash does not match the listed one" );
+            std::ifstream in( path.generic_string(), std::ios::binary );
+            istream_snapshot_reader reader( in );
+            reader.validate();
+            // the chain state is not committed to in block headers, the snapshot has to match what the peers listed
+            genesis_state genesis;
+            reader.read_section<genesis_state>( [&genesis]( auto& section ) { section.read_row( genesis ); } );
+            ROXE_ASSERT( genesis.compute_chain_id() == chain_id, chain::snapshot_validation_exception, "snapshot of another chain" );
+            block_header_state head;
+            reader.read_section<block_state>( [&head]( auto& section ) { section.read_row( head ); } );
+            ROXE_ASSERT( head.id == info.head_block_id, chain::snapshot_validation_exception,
+                         "snapshot is of block ${id}", ("id", head.id) );
+         } catch( const fc::exception& e ) {
+            error = e.to_string();
+         } catch( const std::exception& e ) {
+            error = e.what();
+         }
+         app().post( priority::low, [this, error]() {
+            verifying = false;
+            if( error.empty() ) {
+               auto final_path = dir / fc::format_string( "snapshot-${id}.bin", fc::mutable_variant_object()("id", target->head_block_id) );
+               bfs::rename( part_path, final_path );
+               fc_ilog( logger, "snapshot of block ${n} saved, restart with --snapshot ${f}",
+                        ("n", block_header::num_from_id( target->head_block_id ))("f", final_path.generic_string()) );
+               app().quit();
+               return;
+            }
+            fc_elog( logger, "fetched snapshot ${id} is unusable: ${e}", ("id", target->head_block_id)("e", error) );
+            rejected.insert( target->hash );
+            boost::system::error_code ec;
+            bfs::remove( part_path, ec );
+            target.reset();
+         } );
+      } );
+   }
+
+   void net_plugin_impl::process_compact_blocks(const connection_ptr& c) {
+      auto& pending = c->pending_compact_blocks;
+      for( auto& p : pending ) {
+         if( p.verified || p.full_requested || !p.missing.empty() ) continue;
+         vector<digest_type> trx_digests;
+         trx_digests.reserve( p.block->transactions.size() );
+         for( const auto& r : p.block->transactions )
+            trx_digests.emplace_back( r.digest() );
+         p.verified = merkle( std::move( trx_digests ) ) == p.block->transaction_mroot;
+         if( !p.verified ) {
+            peer_dlog( c, "rebuilt compact block ${n} does not match, requesting the full block", ("n", p.block->block_num()) );
+            request_full_block( c, p );
+         }
+      }
+      while( !pending.empty() && pending.front().verified ) {
+         auto b = std::move( pending.front().block );
+         pending.pop_front();
+         process_block( c, b );
+      }
+   }
+
+   void net_plugin_impl::process_block(const connection_ptr& c, const signed_block_ptr& msg) {
       controller &cc = chain_plug->chain();
       block_id_type blk_id = msg->id();
       uint32_t blk_num = msg->block_num();
+      fc::tracing::scoped_span span( "net_process_block", blk_num );
       fc_dlog( logger, "received block ${num}, id ${id}..., canceling wait on ${p}",
                ("num", blk_num)("id", blk_id.str().substr(8,16))("p", c->peer_name()) );
       c->cancel_wait();
 
       try {
          if( cc.fetch_block_by_id(blk_id)) {
+            dispatcher->record_block_arrival( c, blk_id );
             if( sync_master->syncing_with_peer() )
                sync_master->recv_block( c, blk_id, blk_num );
             c->cancel_wait();
@@ -2607,6 +4059,7 @@ namespace roxe {
          fc_elog( logger,"Caught an unknown exception trying to recall blockID" );
       }
 
+      dispatcher->record_block_arrival( c, blk_id );
       dispatcher->recv_block(c, blk_id, blk_num);
       fc::microseconds age( fc::time_point::now() - msg->timestamp);
       peer_ilog(c, "received signed_block : #${n} block age in secs = ${age}",
@@ -2642,10 +4095,6 @@ namespace roxe {
             if( ltx != local_txns.end()) {
                local_txns.modify( ltx, ubn );
             }
-            auto ctx = c->trx_state.get<by_id>().find(id);
-            if( ctx != c->trx_state.end()) {
-               c->trx_state.modify( ctx, ubn );
-            }
          }
          sync_master->recv_block(c, blk_id, blk_num);
       }
@@ -2685,6 +4134,42 @@ namespace roxe {
       });
    }
 
+   void net_plugin_impl::start_trx_batch_timer() {
+      if( trx_batch_timer_running )
+         return;
+      trx_batch_timer_running = true;
+      trx_batch_timer->expires_from_now( trx_batch_period );
+      trx_batch_timer->async_wait( [this]( boost::system::error_code ec ) {
+         app().post( priority::low, [this, ec]() {
+            trx_batch_timer_running = false;
+            if( ec )
+               return;
+            for( auto& c : connections )
+               c->flush_trx_batch();
+         } );
+      });
+   }
+
+   void net_plugin_impl::start_snapshot_scan_timer(boost::asio::steady_timer::duration du) {
+      snapshot_scan_timer->expires_from_now( du );
+      snapshot_scan_timer->async_wait( [this]( boost::system::error_code ec ) {
+         if( ec )
+            return;
+         auto list = snapshots.scan();
+         app().post( priority::low, [this, list{std::move( list )}]() {
+            start_snapshot_scan_timer( snapshot_scan_period );
+            auto same = []( const snapshot_info& a, const snapshot_info& b ) { return a.hash == b.hash; };
+            if( std::equal( list.begin(), list.end(), served_snapshots.begin(), served_snapshots.end(), same ) )
+               return;
+            served_snapshots = list;
+            for( auto& c : connections ) {
+               if( c->connected() )
+                  send_snapshot_list( c );
+            }
+         } );
+      } );
+   }
+
    void net_plugin_impl::ticker() {
       keepalive_timer->expires_from_now(keepalive_interval);
       keepalive_timer->async_wait( [this]( boost::system::error_code ec ) {
@@ -2721,10 +4206,7 @@ namespace roxe {
       uint32_t lib = cc.last_irreversible_block_num();
       dispatcher->expire_blocks( lib );
       for ( auto &c : connections ) {
-         auto &stale_txn = c->trx_state.get<by_block_num>();
-         stale_txn.erase( stale_txn.lower_bound(1), stale_txn.upper_bound(lib) );
-         auto &stale_txn_e = c->trx_state.get<by_expiry>();
-         stale_txn_e.erase(stale_txn_e.lower_bound(time_point_sec()), stale_txn_e.upper_bound(time_point::now()));
+         c->trx_state.expire( now );
          auto &stale_blk = c->blk_state.get<by_block_num>();
          stale_blk.erase( stale_blk.lower_bound(1), stale_blk.upper_bound(lib) );
       }
@@ -2733,6 +4215,7 @@ namespace roxe {
    }
 
    void net_plugin_impl::expire_local_txns() {
+      received_trxs.expire( time_point::now() );
       auto& old = local_txns.get<by_expiry>();
       auto ex_lo = old.lower_bound( fc::time_point_sec(0) );
       auto ex_up = old.upper_bound( time_point::now() );
@@ -2766,6 +4249,10 @@ namespace roxe {
          }
          ++it;
       }
+      metrics().connections.set( connections.size() );
+      metrics().connected_peers.set( std::count_if( connections.begin(), connections.end(),
+                                                    []( const connection_ptr& c ) { return c->connected(); } ) );
+      metrics().lib_catchup.set( sync_master->syncing_with_peer() );
       start_conn_timer(connector_period, std::weak_ptr<connection>());
    }
 
@@ -2783,6 +4270,7 @@ namespace roxe {
 
    void net_plugin_impl::accepted_block(const block_state_ptr& block) {
       fc_dlog(logger,"signaled, id = ${id}",("id", block->id));
+      trx_recovery_time_limit_us = chain_plug->chain().get_global_properties().configuration.max_transaction_cpu_usage;
       dispatcher->bcast_block(block);
    }
 
@@ -2958,6 +4446,22 @@ namespace roxe {
          ( "net-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
            "Number of worker threads in net_plugin thread pool" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "sync-fetch-peers", bpo::value<uint32_t>()->default_value(def_sync_fetch_peers), "number of peers blocks are requested from at once during synchronization, each for its own range of sync-fetch-span blocks")
+         ( "p2p-compression-threshold", bpo::value<uint32_t>()->default_value(def_compression_threshold),
+           "messages larger than this many bytes are sent zlib compressed to peers supporting it, 0 disables compression")
+         ( "p2p-trx-batch-bytes", bpo::value<uint32_t>()->default_value(def_trx_batch_bytes),
+           "transactions relayed to peers supporting it are sent together once this many bytes are waiting")
+         ( "p2p-trx-batch-ms", bpo::value<uint32_t>()->default_value(def_trx_batch_ms),
+           "milliseconds a relayed transaction may wait for others to be sent with, 0 sends every transaction on its own")
+         ( "p2p-serve-snapshots", bpo::value<bool>()->default_value(false),
+           "serve the newest finished snapshots of the producer_plugin snapshots-dir to peers, see p2p-fetch-snapshot-to")
+         ( "p2p-fetch-snapshot-to", bpo::value<bfs::path>(),
+           "fetch the newest snapshot served by peers into this directory (absolute path or relative to application data dir), "
+           "then exit so that the node can be restarted with --snapshot. Start it with an empty data-dir for the fetch.")
+         ( "p2p-fetch-snapshot-block-id", bpo::value<string>(),
+           "id of the block, known to be part of the chain, whose snapshot to fetch; required with p2p-fetch-snapshot-to")
+         ( "p2p-fetch-snapshot-min-peers", bpo::value<uint32_t>()->default_value(3),
+           "number of peers, at distinct addresses and with distinct node ids, that have to serve the same snapshot for it to be fetched")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
@@ -2986,7 +4490,7 @@ namespace roxe {
          if( my->network_version_match )
             wlog( "network-version-match is DEPRECATED as it is a needless restriction" );
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>(), options.at( "sync-fetch-peers" ).as<uint32_t>() ));
          my->dispatcher.reset( new dispatch_manager );
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
@@ -3008,6 +4512,9 @@ namespace roxe {
          }
 
          my->thread_pool_size = options.at( "net-threads" ).as<uint16_t>();
+         my->compression_threshold = options.at( "p2p-compression-threshold" ).as<uint32_t>();
+         my->trx_batch_bytes = options.at( "p2p-trx-batch-bytes" ).as<uint32_t>();
+         my->trx_batch_period = std::chrono::milliseconds( options.at( "p2p-trx-batch-ms" ).as<uint32_t>() );
          ROXE_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
                      "net-threads ${num} must be greater than 0", ("num", my->thread_pool_size) );
 
@@ -3053,6 +4560,18 @@ namespace roxe {
             }
          }
 
+         my->serve_snapshots = options.at( "p2p-serve-snapshots" ).as<bool>();
+         if( options.count( "p2p-fetch-snapshot-to" )) {
+            auto dir = options.at( "p2p-fetch-snapshot-to" ).as<bfs::path>();
+            if( dir.is_relative() )
+               dir = app().data_dir() / dir;
+            // the chain state is not committed to in block headers, pin the block at least
+            ROXE_ASSERT( options.count( "p2p-fetch-snapshot-block-id" ), plugin_config_exception,
+                         "p2p-fetch-snapshot-to requires p2p-fetch-snapshot-block-id" );
+            block_id_type block_id( options.at( "p2p-fetch-snapshot-block-id" ).as<string>() );
+            my->snapshot_fetch.reset( new snapshot_fetcher( dir, block_id, options.at( "p2p-fetch-snapshot-min-peers" ).as<uint32_t>() ) );
+         }
+
          my->chain_plug = app().find_plugin<chain_plugin>();
          ROXE_ASSERT( my->chain_plug, chain::missing_chain_plugin_exception, ""  );
          my->chain_id = my->chain_plug->get_chain_id();
@@ -3119,6 +4638,15 @@ namespace roxe {
 
       my->keepalive_timer.reset( new boost::asio::steady_timer( my->thread_pool->get_executor() ) );
       my->ticker();
+      my->trx_batch_timer.reset( new boost::asio::steady_timer( my->thread_pool->get_executor() ) );
+      if( my->serve_snapshots ) {
+         ROXE_ASSERT( my->producer_plug, plugin_config_exception, "p2p-serve-snapshots requires producer_plugin" );
+         my->snapshots.set_dir( my->producer_plug->get_snapshots_dir() );
+         my->snapshot_scan_timer.reset( new boost::asio::steady_timer( my->thread_pool->get_executor() ) );
+         my->start_snapshot_scan_timer( std::chrono::seconds( 0 ) );
+      }
+      if( my->snapshot_fetch )
+         my->snapshot_fetch->start();
 
       my->incoming_transaction_ack_subscription = app().get_channel<channels::transaction_ack>().subscribe(boost::bind(&net_plugin_impl::transaction_ack, my.get(), _1));
 
@@ -3153,6 +4681,12 @@ namespace roxe {
             my->transaction_check->cancel();
          if( my->keepalive_timer )
             my->keepalive_timer->cancel();
+         if( my->trx_batch_timer )
+            my->trx_batch_timer->cancel();
+         if( my->snapshot_scan_timer )
+            my->snapshot_scan_timer->cancel();
+         if( my->snapshot_fetch )
+            my->snapshot_fetch->stop();
 
          my->done = true;
          if( my->acceptor ) {
@@ -3227,6 +4761,15 @@ namespace roxe {
       }
       return result;
    }
+   vector<connection_stats> net_plugin::stats()const {
+      vector<connection_stats> result;
+      result.reserve( my->connections.size() );
+      for( const auto& c : my->connections ) {
+         result.push_back( c->get_stats() );
+         result.back().sync_rate = my->sync_master->sync_rate( c );
+      }
+      return result;
+   }
    connection_ptr net_plugin_impl::find_connection(const string& host )const {
       for( const auto& c : connections )
          if( c->peer_addr == host ) return c;
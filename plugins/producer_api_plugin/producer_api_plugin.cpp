@@ -101,6 +101,8 @@ void producer_api_plugin::plugin_startup() {
             INVOKE_V_V(producer, resume), 201),
        CALL(producer, producer, paused,
             INVOKE_R_V(producer, paused), 201),
+       CALL(producer, producer, promote_standby,
+            INVOKE_V_V(producer, promote_standby), 201),
        CALL(producer, producer, get_runtime_options,
             INVOKE_R_V(producer, get_runtime_options), 201),
        CALL(producer, producer, update_runtime_options,
@@ -119,6 +121,8 @@ void producer_api_plugin::plugin_startup() {
             INVOKE_R_V(producer, get_integrity_hash), 201),
        CALL_ASYNC(producer, producer, create_snapshot, producer_plugin::snapshot_information,
             INVOKE_R_V_ASYNC(producer, create_snapshot), 201),
+       CALL_ASYNC(producer, producer, create_differential_snapshot, producer_plugin::snapshot_information,
+            INVOKE_R_V_ASYNC(producer, create_differential_snapshot), 201),
        CALL(producer, producer, get_scheduled_protocol_feature_activations,
             INVOKE_R_V(producer, get_scheduled_protocol_feature_activations), 201),
        CALL(producer, producer, schedule_protocol_feature_activations,
@@ -128,6 +132,20 @@ void producer_api_plugin::plugin_startup() {
                                  producer_plugin::get_supported_protocol_features_params), 201),
        CALL(producer, producer, get_account_ram_corrections,
             INVOKE_R_R(producer, get_account_ram_corrections, producer_plugin::get_account_ram_corrections_params), 201),
+       CALL(producer, producer, get_wasm_profile,
+            INVOKE_R_R(producer, get_wasm_profile, producer_plugin::get_wasm_profile_params), 201),
+       CALL(producer, producer, get_wasm_samples,
+            INVOKE_R_R(producer, get_wasm_samples, producer_plugin::get_wasm_samples_params), 201),
+       CALL(producer, producer, get_cpu_history,
+            INVOKE_R_R(producer, get_cpu_history, producer_plugin::get_cpu_history_params), 201),
+       CALL(producer, producer, get_block_timings,
+            INVOKE_R_R(producer, get_block_timings, producer_plugin::get_block_timings_params), 201),
+       CALL(producer, producer, get_resource_leaderboard,
+            INVOKE_R_R(producer, get_resource_leaderboard, producer_plugin::get_resource_leaderboard_params), 201),
+       CALL(producer, producer, set_block_tracing,
+            INVOKE_V_R(producer, set_block_tracing, producer_plugin::set_block_tracing_params), 201),
+       CALL(producer, producer, export_block_trace,
+            INVOKE_R_R(producer, export_block_trace, producer_plugin::export_block_trace_params), 201),
    });
 }
 
@@ -73,6 +73,117 @@ public:
       optional<account_name>   more;
    };
 
+   struct get_wasm_profile_params {
+      uint32_t limit = 100;
+      bool     reset = false; ///< clear the aggregates after returning them
+   };
+
+   struct get_wasm_profile_result {
+      bool                                        enabled = false;
+      std::vector<chain::wasm_profiler::action_stats> rows;
+   };
+
+   struct get_wasm_samples_params {
+      uint32_t limit  = 100;     ///< contracts to return, most sampled first
+      bool     folded = false;   ///< return every stack as a "stack count" line of `folded`, the input of flamegraph.pl
+      bool     reset  = false;   ///< clear the samples after returning them
+   };
+
+   struct get_wasm_samples_result {
+      uint32_t                                            sample_interval_us = 0;
+      std::vector<chain::wasm_profiler::contract_samples> rows;
+      std::string                                         folded;
+   };
+
+   struct get_cpu_history_params {
+      uint32_t limit = 100;
+   };
+
+   struct cpu_history_row {
+      account_name payer;
+      account_name contract;
+      double       cpu_us = 0;  ///< expected CPU of the payer's next transaction to the contract
+      double       samples = 0; ///< decayed number of transactions the expectation is based on
+   };
+
+   struct get_cpu_history_result {
+      double                       average_cpu_us = 0;
+      uint64_t                     pending_transactions = 0;
+      uint64_t                     rejected = 0; ///< incoming transactions rejected as expected to exceed max-transaction-time
+      uint64_t                     deferred = 0; ///< incoming transactions deferred as not expected to fit the produced block
+      std::vector<cpu_history_row> rows;         ///< most expensive first
+   };
+
+   struct get_resource_leaderboard_params {
+      string   window = "hour";  ///< minute, hour or day
+      string   by = "action";    ///< action for per receiver and action, payer for per first authorizer
+      string   sort = "cpu";     ///< cpu, net or ram
+      uint32_t limit = 20;
+   };
+
+   struct resource_leaderboard_row {
+      account_name account;        ///< the receiver, or the payer
+      action_name  action;         ///< empty when by payer
+      double       cpu_us = 0;
+      double       net_bytes = 0;
+      double       ram_bytes = 0;  ///< added less freed, only counted from detailed traces
+      double       count = 0;      ///< actions, or transactions when by payer
+   };
+
+   struct get_resource_leaderboard_result {
+      fc::time_point                        head_block_time; ///< what the decayed sums are as of
+      std::vector<resource_leaderboard_row> rows;            ///< most consuming first
+   };
+
+   struct block_timing_phase {
+      string   name;
+      uint64_t duration_us = 0;
+      uint32_t applied = 0;
+      uint32_t failed = 0;
+      uint32_t deferred = 0; ///< did not fit the block and were left for a later one
+   };
+
+   struct block_timing {
+      uint32_t                        block_num = 0;
+      fc::time_point                  block_time;
+      account_name                    producer;
+      fc::time_point                  start;           ///< when start_block began
+      uint64_t                        total_us = 0;    ///< from start to the block being committed
+      uint64_t                        idle_us = 0;     ///< part of total_us not spent in any phase
+      int64_t                         finish_offset_us = 0; ///< committed relative to block_time, negative when early
+      std::vector<block_timing_phase> phases;
+   };
+
+   struct block_timing_histogram {
+      string                name;
+      std::vector<uint64_t> bounds_us; ///< upper bounds of the buckets but the last one
+      std::vector<uint64_t> counts;    ///< one more than bounds_us
+   };
+
+   struct get_block_timings_params {
+      uint32_t limit = 20;
+   };
+
+   struct get_block_timings_result {
+      std::vector<block_timing>           blocks;     ///< most recent first
+      std::vector<block_timing_histogram> histograms; ///< per phase and for the total, over all produced blocks
+   };
+
+   struct set_block_tracing_params {
+      fc::optional<bool>     enabled;      ///< record every block until disabled
+      fc::optional<uint32_t> first_block;  ///< record only first_block-last_block and write them to a file after the last
+      fc::optional<uint32_t> last_block;   ///< defaults to first_block
+   };
+
+   struct export_block_trace_params {
+      uint32_t seconds = 0;  ///< only the spans that started this recently, 0 for all the rings still hold
+   };
+
+   struct block_trace_information {
+      uint32_t spans = 0;
+      string   file_name;    ///< Chrome trace event JSON, loads in Perfetto or chrome://tracing
+   };
+
    template<typename T>
    using next_function = std::function<void(const fc::static_variant<fc::exception_ptr, T>&)>;
 
@@ -95,6 +206,8 @@ public:
    void pause();
    void resume();
    bool paused() const;
+   /// switches a standby to applying and producing blocks, see chain::controller::is_standby()
+   void promote_standby();
    void update_runtime_options(const runtime_options& options);
    runtime_options get_runtime_options() const;
 
@@ -107,6 +220,10 @@ public:
 
    integrity_hash_information get_integrity_hash() const;
    void create_snapshot(next_function<snapshot_information> next);
+   /// writes the contract tables changed since the last snapshot, requires enable-differential-snapshots
+   void create_differential_snapshot(next_function<snapshot_information> next);
+   /// where finished snapshots are named snapshot-<head block id>.bin
+   const bfs::path& get_snapshots_dir() const;
 
    scheduled_protocol_feature_activations get_scheduled_protocol_feature_activations() const;
    void schedule_protocol_feature_activations(const scheduled_protocol_feature_activations& schedule);
@@ -114,6 +231,18 @@ public:
    fc::variants get_supported_protocol_features( const get_supported_protocol_features_params& params ) const;
 
    get_account_ram_corrections_result  get_account_ram_corrections( const get_account_ram_corrections_params& params ) const;
+
+   get_wasm_profile_result get_wasm_profile( const get_wasm_profile_params& params );
+   get_wasm_samples_result get_wasm_samples( const get_wasm_samples_params& params );
+
+   get_cpu_history_result get_cpu_history( const get_cpu_history_params& params )const;
+
+   get_block_timings_result get_block_timings( const get_block_timings_params& params )const;
+
+   get_resource_leaderboard_result get_resource_leaderboard( const get_resource_leaderboard_params& params )const;
+
+   void set_block_tracing( const set_block_tracing_params& params );
+   block_trace_information export_block_trace( const export_block_trace_params& params );
    
 private:
    std::shared_ptr<class producer_plugin_impl> my;
@@ -130,3 +259,21 @@ FC_REFLECT(roxe::producer_plugin::scheduled_protocol_feature_activations, (proto
 FC_REFLECT(roxe::producer_plugin::get_supported_protocol_features_params, (exclude_disabled)(exclude_unactivatable))
 FC_REFLECT(roxe::producer_plugin::get_account_ram_corrections_params, (lower_bound)(upper_bound)(limit)(reverse))
 FC_REFLECT(roxe::producer_plugin::get_account_ram_corrections_result, (rows)(more))
+FC_REFLECT(roxe::producer_plugin::get_wasm_profile_params, (limit)(reset))
+FC_REFLECT(roxe::producer_plugin::get_wasm_profile_result, (enabled)(rows))
+FC_REFLECT(roxe::producer_plugin::get_wasm_samples_params, (limit)(folded)(reset))
+FC_REFLECT(roxe::producer_plugin::get_wasm_samples_result, (sample_interval_us)(rows)(folded))
+FC_REFLECT(roxe::producer_plugin::get_cpu_history_params, (limit))
+FC_REFLECT(roxe::producer_plugin::cpu_history_row, (payer)(contract)(cpu_us)(samples))
+FC_REFLECT(roxe::producer_plugin::get_cpu_history_result, (average_cpu_us)(pending_transactions)(rejected)(deferred)(rows))
+FC_REFLECT(roxe::producer_plugin::get_resource_leaderboard_params, (window)(by)(sort)(limit))
+FC_REFLECT(roxe::producer_plugin::resource_leaderboard_row, (account)(action)(cpu_us)(net_bytes)(ram_bytes)(count))
+FC_REFLECT(roxe::producer_plugin::get_resource_leaderboard_result, (head_block_time)(rows))
+FC_REFLECT(roxe::producer_plugin::block_timing_phase, (name)(duration_us)(applied)(failed)(deferred))
+FC_REFLECT(roxe::producer_plugin::block_timing, (block_num)(block_time)(producer)(start)(total_us)(idle_us)(finish_offset_us)(phases))
+FC_REFLECT(roxe::producer_plugin::block_timing_histogram, (name)(bounds_us)(counts))
+FC_REFLECT(roxe::producer_plugin::get_block_timings_params, (limit))
+FC_REFLECT(roxe::producer_plugin::get_block_timings_result, (blocks)(histograms))
+FC_REFLECT(roxe::producer_plugin::set_block_tracing_params, (enabled)(first_block)(last_block))
+FC_REFLECT(roxe::producer_plugin::export_block_trace_params, (seconds))
+FC_REFLECT(roxe::producer_plugin::block_trace_information, (spans)(file_name))
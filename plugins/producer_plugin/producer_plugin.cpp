@@ -11,15 +11,24 @@
 #include <roxe/chain/snapshot.hpp>
 
 #include <fc/io/json.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/log/logger_config.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/metrics.hpp>
+#include <fc/tracing.hpp>
 
 #include <boost/asio.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <iostream>
+#include <fstream>
+#include <list>
 #include <algorithm>
+#include <atomic>
+
+#include <sys/wait.h>
+#include <unistd.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/function_output_iterator.hpp>
@@ -134,6 +143,10 @@ public:
       return snapshots_dir / fc::format_string(".incomplete-snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
    }
 
+   static bfs::path get_differential_path(const block_id_type& block_id, const bfs::path& snapshots_dir) {
+      return snapshots_dir / fc::format_string("snapshot-diff-${id}.bin", fc::mutable_variant_object()("id", block_id));
+   }
+
    producer_plugin::snapshot_information finalize( const chain::controller& chain ) const {
       auto in_chain = (bool)chain.fetch_block_by_id( block_id );
       boost::system::error_code ec;
@@ -161,6 +174,30 @@ public:
    std::string       final_path;
 };
 
+/// a full snapshot being written by a forked child process from the state as of the fork
+struct background_snapshot {
+   using next_t = producer_plugin::next_function<producer_plugin::snapshot_information>;
+
+   pid_t          pid = 0;
+   block_id_type  block_id;
+   bfs::path      temp_path;
+   bfs::path      pending_path;
+   bfs::path      final_path;
+   bool           irreversible = false; ///< the head is irreversible, so the snapshot is final once written
+   next_t         next;
+};
+
+static void write_snapshot_file( const chain::controller& chain, const bfs::path& p ) {
+   bfs::create_directory( p.parent_path() );
+
+   auto snap_out = std::ofstream(p.generic_string(), (std::ios::out | std::ios::binary));
+   auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
+   chain.write_snapshot(writer);
+   writer->finalize();
+   snap_out.flush();
+   snap_out.close();
+}
+
 using pending_snapshot_index = multi_index_container<
    pending_snapshot,
    indexed_by<
@@ -173,6 +210,775 @@ enum class pending_block_mode {
    producing,
    speculating
 };
+
+/**
+ * Where the time of producing each block went. A block is recorded from start_block until it is committed, split
+ * into phases with the transactions applied, failed and deferred in each. Transactions arriving while the block is
+ * pending count towards the incoming phase. The most recent blocks are kept, and every block adds to a histogram
+ * per phase.
+ */
+class block_timing_log {
+public:
+   enum phase_type {
+      start_block,
+      expire,
+      unapplied,
+      scheduled,
+      incoming,
+      finalize,
+      sign,
+      commit,
+      phase_count
+   };
+
+   static const char* phase_name( size_t p ) {
+      static const char* names[phase_count] = {"start_block", "expire", "unapplied", "scheduled", "incoming", "finalize", "sign", "commit"};
+      return names[p];
+   }
+
+   /// accounts the time while in scope to a phase of the recorded block, nested scopes count towards the outer one
+   class scope {
+   public:
+      scope( block_timing_log& log, phase_type p )
+      : log( log.active && log.current_phase == phase_count ? &log : nullptr ) {
+         if( this->log ) {
+            this->log->current_phase = p;
+            start = fc::time_point::now();
+         }
+      }
+      ~scope() {
+         if( log ) {
+            log->add( static_cast<phase_type>( log->current_phase ), fc::time_point::now() - start );
+            log->current_phase = phase_count;
+         }
+      }
+      scope( const scope& ) = delete;
+      scope& operator=( const scope& ) = delete;
+   private:
+      block_timing_log* log;
+      fc::time_point    start;
+   };
+
+   size_t capacity = 120;
+
+   block_timing_log() {
+      for( size_t p = 0; p <= phase_count; ++p )
+         histograms[p].assign( bounds_us.size() + 1, 0 );
+   }
+
+   void begin( uint32_t block_num, fc::time_point block_time, account_name producer, fc::time_point start ) {
+      current = producer_plugin::block_timing{};
+      current.block_num = block_num;
+      current.block_time = block_time;
+      current.producer = producer;
+      current.start = start;
+      current.phases.resize( phase_count );
+      for( size_t p = 0; p < phase_count; ++p )
+         current.phases[p].name = phase_name( p );
+      current_phase = phase_count;
+      active = true;
+   }
+
+   /// the block is not going to be produced
+   void abort() { active = false; }
+
+   bool is_active()const { return active; }
+
+   void add( phase_type p, fc::microseconds d ) {
+      if( active )
+         current.phases[p].duration_us += d.count();
+   }
+
+   void applied()  { if( auto ph = phase() ) ++ph->applied; }
+   void failed()   { if( auto ph = phase() ) ++ph->failed; }
+   void deferred() { if( auto ph = phase() ) ++ph->deferred; }
+
+   /// the block was committed
+   void end() {
+      if( !active ) return;
+      active = false;
+      const auto now = fc::time_point::now();
+      current.total_us = (now - current.start).count();
+      uint64_t in_phases = 0;
+      for( size_t p = 0; p < phase_count; ++p ) {
+         in_phases += current.phases[p].duration_us;
+         add_to_histogram( p, current.phases[p].duration_us );
+      }
+      add_to_histogram( phase_count, current.total_us );
+      current.idle_us = current.total_us > in_phases ? current.total_us - in_phases : 0;
+      current.finish_offset_us = (now - current.block_time).count();
+      blocks.emplace_back( std::move( current ) );
+      while( blocks.size() > capacity )
+         blocks.pop_front();
+   }
+
+   producer_plugin::get_block_timings_result get( uint32_t limit )const {
+      producer_plugin::get_block_timings_result result;
+      for( auto itr = blocks.rbegin(); itr != blocks.rend() && result.blocks.size() < limit; ++itr )
+         result.blocks.push_back( *itr );
+      for( size_t p = 0; p <= phase_count; ++p ) {
+         result.histograms.push_back( {p < phase_count ? phase_name( p ) : "total", bounds_us, histograms[p]} );
+      }
+      return result;
+   }
+
+private:
+   producer_plugin::block_timing_phase* phase() {
+      if( !active ) return nullptr;
+      return &current.phases[current_phase == phase_count ? incoming : current_phase];
+   }
+
+   void add_to_histogram( size_t p, uint64_t us ) {
+      const auto b = std::lower_bound( bounds_us.begin(), bounds_us.end(), us ) - bounds_us.begin();
+      ++histograms[p][b];
+   }
+
+   const vector<uint64_t>                  bounds_us{100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000};
+   bool                                    active = false;
+   size_t                                  current_phase = phase_count;
+   producer_plugin::block_timing           current;
+   deque<producer_plugin::block_timing>    blocks;
+   std::array<vector<uint64_t>, phase_count + 1> histograms; ///< the last one is for the total
+};
+
+/**
+ * Transactions waiting to be applied, kept across restarts. The file starts with the magic number, the version and
+ * the chain id, followed by records of a one byte type, a four byte payload size and the payload. A transaction
+ * record holds whether it persists until expired and the packed transaction.
+ *
+ * The file is rewritten with everything still waiting on shutdown. While journaling, transactions are appended as
+ * they arrive as well, and the file is rewritten once it doubled since the last rewrite.
+ */
+class pending_transaction_log {
+public:
+   static constexpr uint32_t magic_number = 0x50545846;
+   static constexpr uint32_t version = 1;
+
+   enum class record_type : uint8_t {
+      transaction = 1
+   };
+
+   struct stored_transaction {
+      bool                   persist_until_expired = false;
+      packed_transaction_ptr trx;
+   };
+
+   fc::path file;
+   bool     journal_enabled = false;
+
+   /// @return the transactions of the file, which is removed; nothing if there is no file or it is for another chain
+   vector<stored_transaction> load( const chain_id_type& chain_id ) {
+      vector<stored_transaction> result;
+      if( !fc::exists( file ) )
+         return result;
+      string content;
+      fc::read_file_contents( file, content );
+      fc::remove( file );
+
+      fc::datastream<const char*> ds( content.data(), content.size() );
+      uint32_t m = 0, v = 0;
+      chain_id_type id = chain_id;
+      if( content.size() < sizeof(m) + sizeof(v) + sizeof(id) )
+         return result;
+      fc::raw::unpack( ds, m );
+      fc::raw::unpack( ds, v );
+      fc::raw::unpack( ds, id );
+      if( m != magic_number || v != version || id != chain_id ) {
+         wlog( "ignoring pending transactions file '${f}' of another version or chain", ("f", file.generic_string()) );
+         return result;
+      }
+      while( ds.remaining() ) {
+         uint8_t type = 0;
+         uint32_t size = 0;
+         if( ds.remaining() < sizeof(type) + sizeof(size) ) break;
+         fc::raw::unpack( ds, type );
+         fc::raw::unpack( ds, size );
+         if( ds.remaining() < size ) {
+            wlog( "ignoring truncated record at the end of pending transactions file '${f}'", ("f", file.generic_string()) );
+            break;
+         }
+         const char* payload = ds.pos();
+         ds.skip( size );
+         if( static_cast<record_type>(type) != record_type::transaction )
+            continue;
+         try {
+            fc::datastream<const char*> pds( payload, size );
+            stored_transaction st;
+            fc::raw::unpack( pds, st.persist_until_expired );
+            auto ptrx = std::make_shared<packed_transaction>();
+            fc::raw::unpack( pds, *ptrx );
+            st.trx = std::move( ptrx );
+            result.emplace_back( std::move( st ) );
+         } LOG_AND_DROP()
+      }
+      return result;
+   }
+
+   /// replaces the file with the given transactions, then keeps it open for appending if journaling
+   void write( const chain_id_type& chain_id, const vector<stored_transaction>& trxs ) {
+      if( out.is_open() )
+         out.close();
+      const auto temp = file.generic_string() + ".tmp";
+      {
+         std::ofstream o( temp.c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+         fc::raw::pack( o, magic_number );
+         fc::raw::pack( o, version );
+         fc::raw::pack( o, chain_id );
+         out.swap( o );
+      }
+      for( const auto& t : trxs )
+         append( t );
+      out.flush();
+      written_size = out.tellp();
+      if( !journal_enabled )
+         out.close();
+      fc::rename( temp, file );
+   }
+
+   /// @return false if the file should be rewritten as it grew too much
+   bool append( const stored_transaction& t ) {
+      if( !out.is_open() )
+         return true;
+      const auto payload = fc::raw::pack( std::make_pair( t.persist_until_expired, *t.trx ) );
+      fc::raw::pack( out, static_cast<uint8_t>(record_type::transaction) );
+      fc::raw::pack( out, static_cast<uint32_t>(payload.size()) );
+      out.write( payload.data(), payload.size() );
+      return static_cast<uint64_t>( out.tellp() ) < 2 * written_size + 1024 * 1024;
+   }
+
+   void flush() {
+      if( out.is_open() )
+         out.flush();
+   }
+
+private:
+   std::ofstream out;
+   uint64_t      written_size = 0;
+};
+
+/**
+ * Decaying history of the CPU transactions took, by payer (first authorizer) and contract (receiver of the first
+ * action). A failed transaction counts with the time it ran before failing, so transactions running into the
+ * deadline are known to be expensive. The weight of what was recorded halves every decay_half_life; an estimate
+ * not refreshed meanwhile moves towards the average of all transactions.
+ */
+class subjective_cpu_history {
+public:
+   struct estimate {
+      double cpu_us = 0;
+      double samples = 0; ///< decayed number of transactions the estimate is based on
+   };
+
+   static constexpr uint32_t default_cpu_estimate_us = 200;
+   static constexpr int64_t  decay_half_life_us = 300 * 1000000ll;
+   static constexpr size_t   max_tracked = 100000;
+
+   void record( const transaction_metadata_ptr& trx, const transaction_trace_ptr& trace ) {
+      if( !trace ) return;
+      const double cpu_us = trace->receipt ? trace->receipt->cpu_usage_us : trace->elapsed.count();
+      const auto now = fc::time_point::now();
+      const auto& t = trx->packed_trx->get_transaction();
+      const account_name payer = t.first_authorizer();
+      const account_name contract = t.actions.empty() ? account_name() : t.actions.front().account;
+      record( _by_payer_contract, std::make_pair( payer, contract ), cpu_us, now );
+      record( _by_contract, contract, cpu_us, now );
+      record( _by_payer, payer, cpu_us, now );
+      _average_cpu_us += (cpu_us - _average_cpu_us) / 64;
+   }
+
+   /// @return the expected CPU of trx from what its payer spent on its contract, else on anything, else the average
+   estimate expected( const transaction_metadata_ptr& trx )const {
+      const auto now = fc::time_point::now();
+      const auto& t = trx->packed_trx->get_transaction();
+      const account_name payer = t.first_authorizer();
+      const account_name contract = t.actions.empty() ? account_name() : t.actions.front().account;
+      estimate e = lookup( _by_payer_contract, std::make_pair( payer, contract ), now );
+      if( e.samples < 1 ) e = lookup( _by_payer, payer, now );
+      if( e.samples < 1 ) e = lookup( _by_contract, contract, now );
+      if( e.samples < 1 ) e.cpu_us = _average_cpu_us;
+      return e;
+   }
+
+   double average_cpu_us()const { return _average_cpu_us; }
+
+   /// @return the payer and contract pairs expected to be most expensive, at most limit of them
+   vector<producer_plugin::cpu_history_row> top( uint32_t limit )const {
+      const auto now = fc::time_point::now();
+      vector<producer_plugin::cpu_history_row> rows;
+      rows.reserve( _by_payer_contract.size() );
+      for( const auto& r : _by_payer_contract ) {
+         auto e = lookup( _by_payer_contract, r.first, now );
+         rows.push_back( {r.first.first, r.first.second, e.cpu_us, e.samples} );
+      }
+      std::sort( rows.begin(), rows.end(), []( const auto& a, const auto& b ) { return a.cpu_us > b.cpu_us; } );
+      if( rows.size() > limit )
+         rows.resize( limit );
+      return rows;
+   }
+
+private:
+   struct entry {
+      double         cpu_us = 0;
+      double         samples = 0;
+      fc::time_point updated;
+   };
+
+   static double decay( const entry& e, fc::time_point now ) {
+      return std::exp2( -double( (now - e.updated).count() ) / decay_half_life_us );
+   }
+
+   template<typename Map>
+   void record( Map& m, const typename Map::key_type& key, double cpu_us, fc::time_point now ) {
+      if( m.size() >= max_tracked ) {
+         // what decayed to nearly nothing is forgotten
+         for( auto itr = m.begin(); itr != m.end(); ) {
+            if( itr->second.samples * decay( itr->second, now ) < 0.1 ) itr = m.erase( itr );
+            else ++itr;
+         }
+         if( m.size() >= max_tracked ) m.clear();
+      }
+      auto& e = m[key];
+      const double w = decay( e, now );
+      e.cpu_us = w * e.cpu_us + (1 - w) * _average_cpu_us;
+      e.samples = e.samples * w + 1;
+      e.cpu_us += (cpu_us - e.cpu_us) / std::min( e.samples, 4.0 );
+      e.updated = now;
+   }
+
+   template<typename Map>
+   estimate lookup( const Map& m, const typename Map::key_type& key, fc::time_point now )const {
+      estimate result;
+      auto itr = m.find( key );
+      if( itr == m.end() ) return result;
+      const double w = decay( itr->second, now );
+      result.cpu_us = w * itr->second.cpu_us + (1 - w) * _average_cpu_us;
+      result.samples = itr->second.samples * w;
+      return result;
+   }
+
+   std::map<std::pair<account_name, account_name>, entry> _by_payer_contract;
+   std::map<account_name, entry>                          _by_contract;
+   std::map<account_name, entry>                          _by_payer;
+   double                                                 _average_cpu_us = default_cpu_estimate_us;
+};
+
+/**
+ * Billed CPU, NET and RAM of the transactions in accepted blocks per receiver and action, and per payer (first
+ * authorizer), as sums decaying exponentially with time constants of a minute, an hour and a day, so a steady rate
+ * shows as the rate times the window. Time is block time, replays add up the same. Traces are held from
+ * applied_transaction until their block is accepted so speculative and failed attempts are not counted. A
+ * transaction's CPU and NET are split over its actions by their elapsed time, evenly when the traces are not detailed.
+ */
+class resource_leaderboard {
+public:
+   static constexpr size_t window_count = 3;
+   static constexpr size_t max_tracked = 20000; ///< per map, the least consuming half is forgotten beyond it
+
+   static size_t window_index( const string& window ) {
+      if( window == "minute" ) return 0;
+      if( window == "hour" ) return 1;
+      ROXE_ASSERT( window == "day", chain::plugin_exception, "window ${w} is not minute, hour or day", ("w", window) );
+      return 2;
+   }
+
+   void on_applied_transaction( const transaction_trace_ptr& trace, const signed_transaction& trx ) {
+      if( !trace->receipt )
+         return;
+      _cached[trace->failed_dtrx_trace ? trace->failed_dtrx_trace->id : trace->id] = {trace, trx.first_authorizer()};
+   }
+
+   void on_block( const block_state_ptr& bsp ) {
+      const auto now = bsp->header.timestamp.to_time_point();
+      for( const auto& r : bsp->block->transactions ) {
+         const auto& id = r.trx.contains<transaction_id_type>() ? r.trx.get<transaction_id_type>()
+                                                                : r.trx.get<packed_transaction>().id();
+         auto itr = _cached.find( id );
+         if( itr != _cached.end() )
+            record( *itr->second.first, itr->second.second, r, now );
+      }
+      _cached.clear();
+   }
+
+   vector<producer_plugin::resource_leaderboard_row> top( const producer_plugin::get_resource_leaderboard_params& params,
+                                                          fc::time_point now )const {
+      const size_t w = window_index( params.window );
+      ROXE_ASSERT( params.sort == "cpu" || params.sort == "net" || params.sort == "ram", chain::plugin_exception,
+                   "sort ${s} is not cpu, net or ram", ("s", params.sort) );
+      vector<producer_plugin::resource_leaderboard_row> rows;
+      auto add = [&]( account_name account, action_name action, const entry& e ) {
+         const auto u = e.windows[w] * decay( e, now, w );
+         rows.push_back( {account, action, u.cpu_us, u.net_bytes, u.ram_bytes, u.count} );
+      };
+      if( params.by == "payer" ) {
+         for( const auto& p : _by_payer ) add( p.first, action_name(), p.second );
+      } else {
+         ROXE_ASSERT( params.by == "action", chain::plugin_exception, "by ${b} is not action or payer", ("b", params.by) );
+         for( const auto& p : _by_action ) add( p.first.first, p.first.second, p.second );
+      }
+      auto key = [&]( const producer_plugin::resource_leaderboard_row& r ) {
+         return params.sort == "cpu" ? r.cpu_us : params.sort == "net" ? r.net_bytes : r.ram_bytes;
+      };
+      const size_t n = std::min<size_t>( params.limit, rows.size() );
+      std::partial_sort( rows.begin(), rows.begin() + n, rows.end(), [&]( const auto& a, const auto& b ) { return key( a ) > key( b ); } );
+      rows.resize( n );
+      return rows;
+   }
+
+private:
+   struct usage {
+      double cpu_us = 0;
+      double net_bytes = 0;
+      double ram_bytes = 0;
+      double count = 0;
+
+      usage operator*( double f )const { return {cpu_us * f, net_bytes * f, ram_bytes * f, count * f}; }
+      usage operator+( const usage& o )const { return {cpu_us + o.cpu_us, net_bytes + o.net_bytes, ram_bytes + o.ram_bytes, count + o.count}; }
+   };
+
+   struct entry {
+      std::array<usage, window_count> windows;
+      fc::time_point                  updated;
+   };
+
+   static double decay( const entry& e, fc::time_point now, size_t window ) {
+      static constexpr double time_constant_us[window_count] = { 60e6, 3600e6, 86400e6 };
+      return now > e.updated ? std::exp( -double( (now - e.updated).count() ) / time_constant_us[window] ) : 1.0;
+   }
+
+   template<typename Map>
+   static void add( Map& m, const typename Map::key_type& key, const usage& u, fc::time_point now ) {
+      if( m.size() >= max_tracked && !m.count( key ) ) {
+         // forget the half that consumed the least cpu over the day
+         std::vector<std::pair<double, typename Map::key_type>> day_cpu;
+         day_cpu.reserve( m.size() );
+         for( const auto& p : m )
+            day_cpu.emplace_back( p.second.windows[window_count - 1].cpu_us * decay( p.second, now, window_count - 1 ), p.first );
+         std::nth_element( day_cpu.begin(), day_cpu.begin() + day_cpu.size() / 2, day_cpu.end(),
+                           []( const auto& a, const auto& b ) { return a.first < b.first; } );
+         for( auto itr = day_cpu.begin(); itr != day_cpu.begin() + day_cpu.size() / 2; ++itr )
+            m.erase( itr->second );
+      }
+      auto& e = m[key];
+      for( size_t w = 0; w < window_count; ++w )
+         e.windows[w] = e.windows[w] * decay( e, now, w ) + u;
+      e.updated = std::max( e.updated, now );
+   }
+
+   void record( const transaction_trace& trace, account_name payer, const transaction_receipt& receipt, fc::time_point now ) {
+      const double cpu_us = receipt.cpu_usage_us;
+      const double net_bytes = uint64_t(receipt.net_usage_words) * 8;
+      int64_t total_elapsed_us = 0;
+      for( const auto& at : trace.action_traces )
+         total_elapsed_us += at.elapsed.count();
+      double ram_bytes = 0;
+      for( const auto& at : trace.action_traces ) {
+         const double share = total_elapsed_us > 0 ? double( at.elapsed.count() ) / total_elapsed_us : 1.0 / trace.action_traces.size();
+         double ram = 0;
+         for( const auto& d : at.account_ram_deltas )
+            ram += d.delta;
+         ram_bytes += ram;
+         add( _by_action, std::make_pair( at.receiver, at.act.name ), usage{cpu_us * share, net_bytes * share, ram, 1}, now );
+      }
+      add( _by_payer, payer, usage{cpu_us, net_bytes, ram_bytes, 1}, now );
+   }
+
+   std::map<transaction_id_type, std::pair<transaction_trace_ptr, account_name>> _cached;
+   std::map<std::pair<account_name, action_name>, entry>                        _by_action;
+   std::map<account_name, entry>                                                 _by_payer;
+};
+
+/**
+ * Backoff of unapplied transactions failing subjectively, so they stop taking the budget of every block. A
+ * transaction is not retried for 2^(failures-1) blocks after failing, up to max_backoff_blocks. A payer
+ * (first authorizer) whose transactions failed payer_failure_threshold times without one applying in between is
+ * backed off as a whole the same way. Applying a transaction forgets its failures and those of its payer.
+ */
+class unapplied_retry_policy {
+public:
+   static constexpr uint32_t payer_failure_threshold = 3;
+
+   void set_max_backoff_blocks( uint32_t blocks ) { _max_backoff_blocks = blocks; }
+
+   /// @return true if trx may be retried in block block_num
+   bool eligible( const transaction_metadata_ptr& trx, uint32_t block_num )const {
+      if( _max_backoff_blocks == 0 ) return true;
+      auto itr = _by_trx.find( trx->signed_id );
+      if( itr != _by_trx.end() && itr->second.retry_block > block_num ) return false;
+      auto pitr = _by_payer.find( trx->packed_trx->get_transaction().first_authorizer() );
+      return pitr == _by_payer.end() || pitr->second.retry_block <= block_num;
+   }
+
+   /// @return the number of times trx failed since it last applied
+   uint32_t failures( const transaction_metadata_ptr& trx )const {
+      auto itr = _by_trx.find( trx->signed_id );
+      return itr == _by_trx.end() ? 0 : itr->second.failures;
+   }
+
+   void failed( const transaction_metadata_ptr& trx, uint32_t block_num ) {
+      if( _max_backoff_blocks == 0 ) return;
+      auto& r = _by_trx[trx->signed_id];
+      r.retry_block = block_num + backoff( ++r.failures );
+      auto& p = _by_payer[trx->packed_trx->get_transaction().first_authorizer()];
+      if( ++p.failures >= payer_failure_threshold )
+         p.retry_block = block_num + backoff( p.failures - payer_failure_threshold + 1 );
+   }
+
+   void applied( const transaction_metadata_ptr& trx ) {
+      if( _by_trx.empty() && _by_payer.empty() ) return;
+      _by_trx.erase( trx->signed_id );
+      _by_payer.erase( trx->packed_trx->get_transaction().first_authorizer() );
+   }
+
+   void erase( const transaction_id_type& signed_id ) { _by_trx.erase( signed_id ); }
+
+   /// forgets transactions no longer unapplied and payers whose backoff is over
+   void prune( const unapplied_transactions_type& unapplied, uint32_t block_num ) {
+      if( _by_trx.size() > unapplied.size() + 1024 ) {
+         for( auto itr = _by_trx.begin(); itr != _by_trx.end(); ) {
+            if( unapplied.count( itr->first ) == 0 ) itr = _by_trx.erase( itr );
+            else ++itr;
+         }
+      }
+      if( _by_payer.size() > 1024 ) {
+         for( auto itr = _by_payer.begin(); itr != _by_payer.end(); ) {
+            if( itr->second.retry_block + _max_backoff_blocks <= block_num ) itr = _by_payer.erase( itr );
+            else ++itr;
+         }
+      }
+   }
+
+private:
+   struct record {
+      uint32_t failures = 0;
+      uint32_t retry_block = 0;
+   };
+
+   uint32_t backoff( uint32_t failures )const {
+      return failures > 31 ? _max_backoff_blocks : std::min<uint32_t>( 1u << (failures - 1), _max_backoff_blocks );
+   }
+
+   uint32_t                                          _max_backoff_blocks = 64;
+   std::map<transaction_id_type, record, sha256_less> _by_trx;
+   std::map<account_name, record>                    _by_payer;
+};
+
+/**
+ * The due scheduled transactions in the order of the by_delay index, so a block does not walk the index past
+ * blacklisted transactions again. Refreshing appends what became due by scanning the index from the head block
+ * time of the previous refresh: a transaction created since then is due no earlier than that. Transactions
+ * gone from the state are dropped when reached, a switch of forks or an expired blacklist entry rebuilds the
+ * queue from the start of the index. Like unapplied_retry_policy, a transaction failing subjectively is not
+ * retried for 2^(failures-1) blocks, up to max_backoff_blocks.
+ */
+class scheduled_transaction_queue {
+public:
+   using iterator = std::list<transaction_id_type>::iterator;
+
+   void set_max_backoff_blocks( uint32_t blocks ) { _max_backoff_blocks = blocks; }
+
+   void reset() { _valid = false; }
+
+   template<typename Blacklist>
+   void refresh( const controller& chain, const fc::time_point& pending_block_time, const Blacklist& blacklist_by_id ) {
+      if( _valid ) {
+         try {
+            _valid = chain.get_block_id_for_num( _head_num ) == _head_id;
+         } catch( const fc::exception& ) {
+            _valid = false;
+         }
+      }
+      const auto& sch_idx = chain.db().get_index<generated_transaction_multi_index,by_delay>();
+      auto itr = sch_idx.begin();
+      if( _valid ) {
+         itr = sch_idx.lower_bound( boost::make_tuple( _head_time ) );
+      } else {
+         _queue.clear();
+         _queued.clear();
+      }
+      for( ; itr != sch_idx.end() && itr->delay_until <= pending_block_time; ++itr ) {
+         if( blacklist_by_id.find( itr->trx_id ) != blacklist_by_id.end() ) continue;
+         if( _queued.insert( itr->trx_id ).second )
+            _queue.push_back( itr->trx_id );
+      }
+      _valid = true;
+      _head_num = chain.head_block_num();
+      _head_id = chain.head_block_id();
+      _head_time = chain.head_block_time();
+   }
+
+   iterator begin() { return _queue.begin(); }
+   iterator end() { return _queue.end(); }
+   size_t size()const { return _queue.size(); }
+
+   iterator erase( iterator itr ) {
+      _queued.erase( *itr );
+      _backoff.erase( *itr );
+      return _queue.erase( itr );
+   }
+
+   bool backed_off( const transaction_id_type& id, uint32_t block_num )const {
+      auto itr = _backoff.find( id );
+      return itr != _backoff.end() && itr->second.second > block_num;
+   }
+
+   void failed( const transaction_id_type& id, uint32_t block_num ) {
+      if( _max_backoff_blocks == 0 ) return;
+      auto& b = _backoff[id];
+      ++b.first;
+      b.second = block_num + (b.first > 31 ? _max_backoff_blocks : std::min<uint32_t>( 1u << (b.first - 1), _max_backoff_blocks ));
+   }
+
+private:
+   bool                                              _valid = false;
+   uint32_t                                          _head_num = 0;
+   block_id_type                                     _head_id;
+   fc::time_point                                    _head_time;
+   std::list<transaction_id_type>                    _queue;
+   std::set<transaction_id_type>                     _queued;
+   std::map<transaction_id_type, std::pair<uint32_t, uint32_t>> _backoff; ///< failures, block retried in
+   uint32_t                                          _max_backoff_blocks = 64;
+};
+
+/**
+ * Incoming transactions waiting to be applied, bounded to max_size.
+ *
+ * The fifo order serves them in arrival order. The fair order keeps the transactions of every payer (first
+ * authorizer) in arrival order, and serves payers by self-clocked fair queueing: a transaction is tagged with
+ * the virtual time its payer would finish it, using its CPU cost expected from subjective_cpu_history, and the
+ * lowest tag goes first. A payer sending many or expensive transactions delays only its
+ * own, cheap transactions of other payers fill the block first.
+ *
+ * When full the newest transaction of the payer with the most estimated CPU waiting is evicted, which is the
+ * pushed one when its payer would be that one.
+ */
+class pending_transaction_queue {
+public:
+   enum class order_type {
+      fifo,
+      fair
+   };
+
+   using entry = std::tuple<transaction_metadata_ptr, bool, producer_plugin::next_function<transaction_trace_ptr>>;
+
+   explicit pending_transaction_queue( const subjective_cpu_history& history )
+   :_history( history )
+   {}
+
+   order_type order = order_type::fair;
+   size_t     max_size = 0; ///< 0 for unbounded
+
+   size_t size()const { return _size; }
+   bool empty()const { return _size == 0; }
+
+   /// @return the entry evicted to make room, possibly the pushed one
+   optional<entry> push( entry e ) {
+      const account_name payer = payer_of( std::get<0>( e ) );
+      const double cost = _history.expected( std::get<0>( e ) ).cpu_us;
+      optional<entry> evicted;
+      if( max_size && _size >= max_size ) {
+         auto heaviest = _by_cost.rbegin();
+         auto pq = _payers.find( payer );
+         const double payer_cost = (pq == _payers.end() ? 0 : pq->second.queued_cost) + cost;
+         if( heaviest == _by_cost.rend() || payer_cost >= heaviest->first )
+            return e;
+         evicted = evict_newest( heaviest->second );
+      }
+
+      auto& q = _payers[payer];
+      if( q.trxs.empty() )
+         q.finish = std::max( q.finish, _virtual_time );
+      else
+         _ready.erase( {ready_key( q ), payer} );
+      _by_cost.erase( {q.queued_cost, payer} );
+      q.trxs.push_back( {_next_seq++, cost, std::move( e )} );
+      q.queued_cost += cost;
+      _by_cost.insert( {q.queued_cost, payer} );
+      _ready.insert( {ready_key( q ), payer} );
+      ++_size;
+      return evicted;
+   }
+
+   template<typename F>
+   void for_each( F&& f )const {
+      for( const auto& p : _payers ) {
+         for( const auto& q : p.second.trxs )
+            f( q.e );
+      }
+   }
+
+   /// removes and returns the next transaction to apply, must not be empty
+   entry pop() {
+      auto next = _ready.begin();
+      const account_name payer = next->second;
+      auto& q = _payers[payer];
+      _ready.erase( next );
+      _by_cost.erase( {q.queued_cost, payer} );
+
+      auto& front = q.trxs.front();
+      if( order == order_type::fair ) {
+         q.finish += front.cost;
+         _virtual_time = q.finish;
+      }
+      q.queued_cost -= front.cost;
+      entry e = std::move( front.e );
+      q.trxs.pop_front();
+      --_size;
+
+      if( q.trxs.empty() ) {
+         _payers.erase( payer );
+      } else {
+         _by_cost.insert( {q.queued_cost, payer} );
+         _ready.insert( {ready_key( q ), payer} );
+      }
+      return e;
+   }
+
+private:
+   struct queued {
+      uint64_t seq;
+      double   cost;
+      entry    e;
+   };
+
+   struct payer_queue {
+      deque<queued> trxs;
+      double        finish = 0;      ///< virtual time the payer's last served transaction finished
+      double        queued_cost = 0; ///< estimated CPU of trxs
+   };
+
+   static account_name payer_of( const transaction_metadata_ptr& trx ) {
+      return trx->packed_trx->get_transaction().first_authorizer();
+   }
+
+   double ready_key( const payer_queue& q )const {
+      return order == order_type::fair ? q.finish + q.trxs.front().cost : q.trxs.front().seq;
+   }
+
+   entry evict_newest( account_name payer ) {
+      auto& q = _payers[payer];
+      _ready.erase( {ready_key( q ), payer} );
+      _by_cost.erase( {q.queued_cost, payer} );
+      q.queued_cost -= q.trxs.back().cost;
+      entry e = std::move( q.trxs.back().e );
+      q.trxs.pop_back();
+      --_size;
+      if( q.trxs.empty() ) {
+         _payers.erase( payer );
+      } else {
+         _by_cost.insert( {q.queued_cost, payer} );
+         _ready.insert( {ready_key( q ), payer} );
+      }
+      return e;
+   }
+
+   std::map<account_name, payer_queue>         _payers;
+   std::set<std::pair<double, account_name>>   _ready;   ///< payers with waiting transactions by ready_key
+   std::set<std::pair<double, account_name>>   _by_cost; ///< payers with waiting transactions by queued_cost
+   const subjective_cpu_history&               _history;
+   double                                      _virtual_time = 0;
+   uint64_t                                    _next_seq = 0;
+   size_t                                      _size = 0;
+};
 #define CATCH_AND_CALL(NEXT)\
    catch ( const fc::exception& err ) {\
       NEXT(err.dynamic_copy_exception());\
@@ -190,10 +996,26 @@ enum class pending_block_mode {
       NEXT(e.dynamic_copy_exception());\
    }
 
+/// what producer_plugin reports through metrics_plugin
+struct producer_metrics {
+   fc::metrics::registry&   r = fc::metrics::registry::instance();
+   fc::metrics::counter&    blocks_produced = r.add_counter( "roxe_producer_blocks_produced_total", "Blocks produced by this node" );
+   fc::metrics::counter&    blocks_received = r.add_counter( "roxe_producer_blocks_received_total", "Blocks received and pushed to the chain" );
+   fc::metrics::counter&    blocks_rejected = r.add_counter( "roxe_producer_blocks_rejected_total", "Received blocks that failed to apply" );
+   fc::metrics::histogram&  block_apply = r.add_histogram( "roxe_producer_block_apply_seconds",
+                                                           "Time to push a received block, including applying it",
+                                                           fc::metrics::exponential_bounds( 0.001, 2, 12 ) );
+   fc::metrics::gauge&      incoming_queue = r.add_gauge( "roxe_producer_incoming_queue_transactions",
+                                                          "Incoming transactions waiting to be applied" );
+   fc::metrics::counter&    incoming_dropped = r.add_counter( "roxe_producer_incoming_dropped_total",
+                                                              "Incoming transactions evicted from a full queue" );
+};
+
 class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin_impl> {
    public:
       producer_plugin_impl(boost::asio::io_service& io)
       :_timer(io)
+      ,_background_snapshot_timer(io)
       ,_transaction_ack_channel(app().get_channel<compat::channels::transaction_ack>())
       {
       }
@@ -202,6 +1024,20 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       void schedule_production_loop();
       void produce_block();
       bool maybe_produce_block();
+      void commit_produced_block();
+
+      /// a block signature requested from a remote provider, the block waits finalized but unsigned meanwhile
+      struct block_signing {
+         uint64_t                            seq = 0;
+         std::future<chain::signature_type>  signature;
+         fc::time_point                      started;
+         fc::time_point                      deadline;
+      };
+
+      void start_block_signing( const std::function<chain::signature_type(chain::digest_type)>& provider, const digest_type& digest );
+      void on_block_signed( uint64_t seq );
+      /// @return true if a block signature was in flight; waits for it until its deadline, then commits or drops the block
+      bool finish_block_signing();
       bool remove_expired_persisted_trxs( const fc::time_point& deadline );
       bool remove_expired_blacklisted_trxs( const fc::time_point& deadline );
       bool process_unapplied_trxs( const fc::time_point& deadline );
@@ -229,6 +1065,12 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       int32_t                                                   _max_scheduled_transaction_time_per_block_ms;
       fc::time_point                                            _irreversible_block_time;
       fc::microseconds                                          _kroxed_provider_timeout_us;
+      std::set<chain::public_key_type>                          _remote_signature_keys; ///< signed by KROXED providers
+      bool                                                      _async_block_signing = true;
+      fc::microseconds                                          _block_signing_timeout_us;
+      optional<block_signing>                                   _block_signing;
+      uint64_t                                                  _block_signing_seq = 0;
+      std::unique_ptr<boost::asio::deadline_timer>              _block_signing_timer;
 
       std::vector<chain::digest_type>                           _protocol_features_to_activate;
       bool                                                      _protocol_features_signaled = false; // to mark whether it has been signaled in start_block
@@ -243,13 +1085,24 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       incoming::methods::block_sync::method_type::handle        _incoming_block_sync_provider;
       incoming::methods::transaction_async::method_type::handle _incoming_transaction_async_provider;
+      incoming::methods::transactions_async::method_type::handle _incoming_transactions_async_provider;
 
       transaction_id_with_expiry_index                         _blacklisted_transactions;
       pending_snapshot_index                                   _pending_snapshot_index;
+      std::vector<background_snapshot>                         _background_snapshots;
+      boost::asio::deadline_timer                              _background_snapshot_timer;
+      bool                                                     _background_snapshots_enabled = true;
+
+      /// @return false if the snapshot is written the usual way, blocking, as the state is not private to this process
+      bool start_background_snapshot( const block_id_type& head_id, const bfs::path& temp_path, const bfs::path& pending_path,
+                                      const bfs::path& final_path, bool irreversible, background_snapshot::next_t next );
+      void poll_background_snapshots();
+      void finish_background_snapshot( background_snapshot& bs, int status );
 
       fc::optional<scoped_connection>                          _accepted_block_connection;
       fc::optional<scoped_connection>                          _accepted_block_header_connection;
       fc::optional<scoped_connection>                          _irreversible_block_connection;
+      fc::optional<scoped_connection>                          _applied_transaction_connection;
 
       /*
        * HACK ALERT
@@ -266,9 +1119,33 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       // keep a expected ratio between defer txn and incoming txn
       double _incoming_defer_ratio = 1.0; // 1:1
 
+      // while speculating this many blocks ahead of a slot of ours the unapplied transactions are retried as if
+      // producing, so the ones failing are dropped and the ones applying are retried first once the slot starts
+      uint32_t _pre_slot_speculation_blocks = config::producer_repetitions;
+      bool _pre_slot_speculation = false;
+      std::set<transaction_id_type> _prevalidated_trxs; ///< signed ids applied in the last pre-slot speculative block
+
+      // with speculative rebase the unapplied transactions that would apply as before are not executed in speculative
+      // blocks, they are carried over: still unapplied, and missing from the pending state until it needs them
+      bool _speculative_rebase = false;
+      vector<transaction_metadata_ptr> _carried_trxs; ///< carried over into the pending block, in the order they were met
+      bool apply_carried_trxs( const fc::time_point& deadline );
+
+      bool near_own_slot( const fc::time_point& block_time ) const;
+
       // path to write the snapshots to
       bfs::path _snapshots_dir;
 
+      // block lifecycle spans, see fc/tracing.hpp
+      bfs::path _block_trace_dir;
+      bool      _block_tracing = false;                          ///< recording all the time, exported on request
+      std::pair<uint32_t, uint32_t> _block_trace_range{0, 0};    ///< recording only these blocks, {0, 0} when none
+      uint64_t  _block_trace_range_start_ns = 0;                 ///< when the first block of the range began
+
+      void begin_block_trace( uint32_t block_num );
+      void end_block_trace( uint32_t block_num );
+      void write_block_trace( std::vector<fc::tracing::span> spans, bfs::path file );
+
       void consider_new_watermark( account_name producer, uint32_t block_num ) {
          auto itr = _producer_watermarks.find( producer );
          if( itr != _producer_watermarks.end() ) {
@@ -287,6 +1164,9 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       }
 
       void on_block( const block_state_ptr& bsp ) {
+         if( _resource_leaderboard_enabled )
+            _resource_leaderboard.on_block( bsp );
+         end_block_trace( bsp->block_num );
       }
 
       void on_block_header( const block_state_ptr& bsp ) {
@@ -366,10 +1246,19 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          auto existing = chain.fetch_block_by_id( id );
          if( existing ) { return; }
 
+         if( chain.is_standby() ) {
+            fc_dlog(_log, "standby ignores incoming block ${id}, it follows the state deltas of its primary", ("id", id));
+            return;
+         }
+
+         begin_block_trace( block->block_num() );
+         fc::tracing::scoped_span span( "on_incoming_block", block->block_num() );
+
          // start processing of block
          auto bsf = chain.create_block_state_future( block );
 
-         // abort the pending block
+         // a block of ours being signed is committed first, then abort the pending block
+         finish_block_signing();
          chain.abort_block();
 
          // exceptions throw out, make sure we restart our loop
@@ -379,8 +1268,10 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
          // push the new block
          bool except = false;
+         const auto push_start = fc::time_point::now();
          try {
             chain.push_block( bsf );
+            _metrics.block_apply.observe( (fc::time_point::now() - push_start).count() / 1e6 );
          } catch ( const guard_exception& e ) {
             chain_plugin::handle_guard_exception(e);
             return;
@@ -394,9 +1285,11 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
 
          if( except ) {
+            _metrics.blocks_rejected.inc();
             app().get_channel<channels::rejected_block>().publish( priority::medium, block );
             return;
          }
+         _metrics.blocks_received.inc();
 
          const auto& hbs = chain.head_block_state();
          if( hbs->header.timestamp.next().to_time_point() >= fc::time_point::now() ) {
@@ -415,36 +1308,142 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                     ("confs", hbs->block->confirmed)("latency", (fc::time_point::now() - hbs->block->timestamp).count()/1000 ) );
             }
          }
+         if( block->block_num() % 1000 == 0 ) {
+            const auto stats = transaction::get_recovery_cache_stats();
+            const auto lookups = stats.hits + stats.misses;
+            ilog("Signature recovery cache [size: ${s}/${c}, hits: ${h}, misses: ${m}, hit rate: ${r}%]",
+                 ("s", stats.size)("c", stats.capacity)("h", stats.hits)("m", stats.misses)
+                 ("r", lookups ? stats.hits * 100 / lookups : 0) );
+         }
       }
 
-      std::deque<std::tuple<transaction_metadata_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
+      subjective_cpu_history    _cpu_history;
+      unapplied_retry_policy    _unapplied_retry;
+      scheduled_transaction_queue _scheduled_trxs;
+      pending_transaction_queue _pending_incoming_transactions{_cpu_history};
+      pending_transaction_log   _pending_transaction_log;
+      block_timing_log          _block_timings;
+      producer_metrics          _metrics;
+      bool                      _persist_pending_transactions = true;
+
+      /// @return the unapplied, persisted and queued transactions, each once
+      vector<pending_transaction_log::stored_transaction> collect_pending_transactions() {
+         chain::controller& chain = chain_plug->chain();
+         vector<pending_transaction_log::stored_transaction> result;
+         std::set<transaction_id_type> ids;
+         auto& persisted_by_id = _persistent_transactions.get<by_id>();
+         for( const auto& t : chain.get_unapplied_transactions() ) {
+            if( ids.insert( t.second->id ).second )
+               result.push_back( {persisted_by_id.count( t.second->id ) > 0, t.second->packed_trx} );
+         }
+         _pending_incoming_transactions.for_each( [&]( const pending_transaction_queue::entry& e ) {
+            const auto& trx = std::get<0>( e );
+            if( ids.insert( trx->id ).second )
+               result.push_back( {std::get<1>( e ), trx->packed_trx} );
+         } );
+         return result;
+      }
+      uint32_t                  _cpu_history_reject_samples = 3; ///< 0 disables rejecting by history
+      resource_leaderboard      _resource_leaderboard;
+      bool                      _resource_leaderboard_enabled = true;
+      uint64_t                  _cpu_history_rejected = 0;
+      uint64_t                  _cpu_history_deferred = 0;
+
+      void queue_incoming_transaction(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+         auto evicted = _pending_incoming_transactions.push( std::make_tuple( trx, persist_until_expired, next ) );
+         _metrics.incoming_queue.set( _pending_incoming_transactions.size() );
+         if( evicted ) {
+            _metrics.incoming_dropped.inc();
+            const auto& etrx = std::get<0>( *evicted );
+            fc::exception_ptr except = std::make_shared<pending_transactions_full_exception>(
+                  FC_LOG_MESSAGE( error, "too many pending transactions, dropped ${id}", ("id", etrx->id) ) );
+            std::get<2>( *evicted )( except );
+            _transaction_ack_channel.publish( priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>( except, etrx ) );
+         }
+      }
+
+      /// answers transactions already known or expired before their keys are recovered, journals the others
+      /// @return whether trx is to be processed
+      bool accept_incoming_transaction(const transaction_metadata_ptr& trx, bool persist_until_expired, const next_function<transaction_trace_ptr>& next) {
+         chain::controller& chain = chain_plug->chain();
+
+         fc::exception_ptr except;
+         if( fc::time_point( trx->packed_trx->expiration() ) < chain.head_block_time() ) {
+            except = std::make_shared<expired_tx_exception>( FC_LOG_MESSAGE( error, "expired transaction ${id}", ("id", trx->id) ) );
+         } else if( chain.is_known_unexpired_transaction( trx->id ) ) {
+            except = std::make_shared<tx_duplicate>( FC_LOG_MESSAGE( error, "duplicate transaction ${id}", ("id", trx->id) ) );
+         }
+         if( except ) {
+            next( except );
+            _transaction_ack_channel.publish( priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>( except, trx ) );
+            return false;
+         }
+         if( _pending_transaction_log.journal_enabled &&
+             !_pending_transaction_log.append( {persist_until_expired, trx->packed_trx} ) ) {
+            _pending_transaction_log.write( chain.get_chain_id(), collect_pending_transactions() );
+         }
+         return true;
+      }
 
       void on_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+         if( !accept_incoming_transaction( trx, persist_until_expired, next ) )
+            return;
          chain::controller& chain = chain_plug->chain();
          const auto& cfg = chain.get_global_properties().configuration;
-         signing_keys_future_type future = transaction_metadata::start_recover_keys( trx, _thread_pool->get_executor(),
-               chain.get_chain_id(), fc::microseconds( cfg.max_transaction_cpu_usage ) );
-         boost::asio::post( _thread_pool->get_executor(), [self = this, future, trx, persist_until_expired, next]() {
-            if( future.valid() )
-               future.wait();
+         transaction_metadata::start_recover_keys( trx, _thread_pool->get_executor(),
+               chain.get_chain_id(), fc::microseconds( cfg.max_transaction_cpu_usage ),
+               [self = this, trx, persist_until_expired, next]() {
             app().post(priority::low, [self, trx, persist_until_expired, next]() {
                self->process_incoming_transaction_async( trx, persist_until_expired, next );
             });
          });
       }
 
+      /// recovers the keys of all trxs in parallel and processes them together once all are recovered
+      void on_incoming_transactions_async(const vector<transaction_metadata_ptr>& trxs, bool persist_until_expired,
+                                          const vector<next_function<transaction_trace_ptr>>& nexts) {
+         ROXE_ASSERT( trxs.size() == nexts.size(), plugin_exception, "every transaction needs its own callback" );
+         chain::controller& chain = chain_plug->chain();
+         const auto& cfg = chain.get_global_properties().configuration;
+         auto accepted = std::make_shared<vector<std::pair<transaction_metadata_ptr, next_function<transaction_trace_ptr>>>>();
+         accepted->reserve( trxs.size() );
+         for( size_t i = 0; i < trxs.size(); ++i ) {
+            if( accept_incoming_transaction( trxs[i], persist_until_expired, nexts[i] ) )
+               accepted->emplace_back( trxs[i], nexts[i] );
+         }
+         if( accepted->empty() )
+            return;
+         // the last recovery to complete posts the processing of all of them; one extra count is held while starting
+         auto pending = std::make_shared<std::atomic<size_t>>( accepted->size() + 1 );
+         auto on_ready = [self = this, accepted, persist_until_expired, pending]() {
+            if( --*pending != 0 )
+               return;
+            app().post(priority::low, [self, accepted, persist_until_expired]() {
+               for( const auto& t : *accepted )
+                  self->process_incoming_transaction_async( t.first, persist_until_expired, t.second );
+            });
+         };
+         for( const auto& t : *accepted ) {
+            transaction_metadata::start_recover_keys( t.first, _thread_pool->get_executor(),
+                  chain.get_chain_id(), fc::microseconds( cfg.max_transaction_cpu_usage ), on_ready );
+         }
+         on_ready();
+      }
+
       void process_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
          chain::controller& chain = chain_plug->chain();
-         if (!chain.is_building_block()) {
-            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+         if (!chain.is_building_block() || _block_signing) {
+            queue_incoming_transaction(trx, persist_until_expired, next);
             return;
          }
 
          auto block_time = chain.pending_block_time();
+         block_timing_log::scope timing( _block_timings, block_timing_log::incoming );
 
          auto send_response = [this, &trx, &chain, &next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& response) {
             next(response);
             if (response.contains<fc::exception_ptr>()) {
+               _block_timings.failed();
                _transaction_ack_channel.publish(priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>(response.get<fc::exception_ptr>(), trx));
                if (_pending_block_mode == pending_block_mode::producing) {
                   fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} is REJECTING tx: ${txid} : ${why} ",
@@ -458,6 +1457,9 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                           ("why",response.get<fc::exception_ptr>()->what()));
                }
             } else {
+               _block_timings.applied();
+               if( _pre_slot_speculation )
+                  _prevalidated_trxs.insert( trx->signed_id );
                _transaction_ack_channel.publish(priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>(nullptr, trx));
                if (_pending_block_mode == pending_block_mode::producing) {
                   fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} is ACCEPTING tx: ${txid}",
@@ -485,6 +1487,24 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          auto deadline = fc::time_point::now() + fc::milliseconds(_max_transaction_time_ms);
          bool deadline_is_subjective = false;
          const auto block_deadline = calculate_block_deadline(block_time);
+
+         // transactions known to run into the deadline are not run again, those not fitting the rest of the block
+         // being produced wait for the next one
+         const auto expected = _cpu_history.expected( trx );
+         if( _cpu_history_reject_samples && _max_transaction_time_ms >= 0 && expected.samples >= _cpu_history_reject_samples &&
+             expected.cpu_us >= _max_transaction_time_ms * 1000 ) {
+            ++_cpu_history_rejected;
+            send_response(std::static_pointer_cast<fc::exception>(std::make_shared<expected_cpu_exceeded_exception>(
+                  FC_LOG_MESSAGE(error, "transaction ${id} expected to take ${e}us", ("id", id)("e", expected.cpu_us)) )));
+            return;
+         }
+         if( _pending_block_mode == pending_block_mode::producing && expected.samples >= 1 &&
+             fc::time_point::now() + fc::microseconds( static_cast<int64_t>( expected.cpu_us ) ) > block_deadline ) {
+            ++_cpu_history_deferred;
+            _block_timings.deferred();
+            queue_incoming_transaction(trx, persist_until_expired, next);
+            return;
+         }
          if (_max_transaction_time_ms < 0 || (_pending_block_mode == pending_block_mode::producing && block_deadline < deadline) ) {
             deadline_is_subjective = true;
             deadline = block_deadline;
@@ -492,9 +1512,16 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
          try {
             auto trace = chain.push_transaction(trx, deadline);
+            if( trace->except && !_carried_trxs.empty() && !failure_is_subjective(*trace->except, deadline_is_subjective) &&
+                apply_carried_trxs( deadline ) ) {
+               // it may depend on changes of the carried over transactions, which the pending state lacked
+               trace = chain.push_transaction(trx, deadline);
+            }
+            _cpu_history.record(trx, trace);
             if (trace->except) {
                if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                  _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+                  _block_timings.deferred();
+                  queue_incoming_transaction(trx, persist_until_expired, next);
                   if (_pending_block_mode == pending_block_mode::producing) {
                      fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} COULD NOT FIT, tx: ${txid} RETRYING ",
                              ("block_num", chain.head_block_num() + 1)
@@ -613,6 +1640,14 @@ void producer_plugin::set_program_options(
           "   KROXED:<data>    \tis the URL where kroxed is available and the approptiate wallet(s) are unlocked")
          ("kroxed-provider-timeout", boost::program_options::value<int32_t>()->default_value(5),
           "Limits the maximum time (in milliseconds) that is allowed for sending blocks to a kroxed provider for signing")
+         ("async-block-signing", bpo::value<bool>()->default_value(true),
+          "sign blocks with KROXED providers on the producer thread pool, so the main thread goes on with other work until the signature returns")
+         ("block-signing-timeout-ms", bpo::value<uint32_t>()->default_value(config::block_interval_ms),
+          "time allowed from finalizing a block to having its signature with async-block-signing, the block is dropped after that")
+         ("pre-slot-speculation-blocks", bpo::value<uint32_t>()->default_value(config::producer_repetitions),
+          "number of blocks ahead of a slot of a local producer in which speculative blocks retry all unapplied transactions, so production starts with validated transactions; 0 to disable")
+         ("speculative-rebase", bpo::bool_switch()->default_value(false),
+          "in speculative blocks, execute again only the unapplied transactions whose tables were written since they last executed, carrying the others over without their changes until an incoming transaction fails or a block is produced; requires record-table-access-sets")
          ("greylist-account", boost::program_options::value<vector<string>>()->composing()->multitoken(),
           "account that can not access to extended CPU/NET virtual resources")
          ("greylist-limit", boost::program_options::value<uint32_t>()->default_value(1000),
@@ -627,10 +1662,40 @@ void producer_plugin::set_program_options(
           "Time in microseconds allowed for a transaction that starts with insufficient CPU quota to complete and cover its CPU usage.")
          ("incoming-defer-ratio", bpo::value<double>()->default_value(1.0),
           "ratio between incoming transations and deferred transactions when both are exhausted")
+         ("incoming-transaction-order", bpo::value<string>()->default_value("fair"),
+          "order pending incoming transactions are applied in:\n"
+          "   fifo \tin arrival order\n"
+          "   fair \tpayers take turns, weighted by the CPU their previous transactions took, cheaper transactions first")
+         ("cpu-history-reject-samples", bpo::value<uint32_t>()->default_value(3),
+          "incoming transactions are rejected without running them when their payer's recent transactions to the same contract took max-transaction-time on average, over at least this many of them; 0 disables")
+         ("unapplied-retry-max-backoff-blocks", bpo::value<uint32_t>()->default_value(64),
+          "most blocks an unapplied or scheduled transaction, or all of a payer's unapplied ones, is not retried for after repeatedly failing to fit into blocks; 0 retries every block")
+         ("resource-leaderboard", bpo::value<bool>()->default_value(true),
+          "keep the billed CPU, NET and RAM of accepted blocks per receiver and action and per payer, decaying over a minute, an hour and a day, for get_resource_leaderboard")
+         ("resource-leaderboard-detailed-traces", bpo::bool_switch()->default_value(false),
+          "time the actions and record the RAM deltas of blocks being validated too, so the leaderboard splits CPU and NET by action time and counts RAM of all blocks, not only produced ones")
+         ("block-timing-history-size", bpo::value<uint32_t>()->default_value(120),
+          "number of the most recently produced blocks whose timing breakdown is kept for get_block_timings")
+         ("block-tracing", bpo::bool_switch()->default_value(false),
+          "record spans of each block's lifecycle (receive, decode, validate, apply, commit, broadcast) on every thread, exported with export_block_trace")
+         ("block-tracing-blocks", bpo::value<string>(),
+          "record spans only for the blocks first-last, then write them to block-tracing-dir, e.g. 1000-1100")
+         ("block-tracing-ring-size", bpo::value<uint32_t>()->default_value(32768),
+          "number of spans each thread keeps, the oldest are overwritten first")
+         ("block-tracing-dir", bpo::value<bfs::path>()->default_value("traces"),
+          "the location of the directory block traces are written to (absolute path or relative to application data dir)")
+         ("persist-pending-transactions", bpo::value<bool>()->default_value(true),
+          "save unapplied and pending incoming transactions on shutdown and apply them again after restart")
+         ("pending-transactions-journal", bpo::value<bool>()->default_value(false),
+          "also write incoming transactions to disk as they arrive, so they survive a crash; requires persist-pending-transactions")
+         ("incoming-transaction-queue-size", bpo::value<uint32_t>()->default_value(100000),
+          "maximum number of pending incoming transactions, the newest ones of the payer with the most CPU waiting are dropped beyond it; 0 for unlimited")
          ("producer-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in producer thread pool")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("background-snapshots", bpo::value<bool>()->default_value(true),
+          "write full snapshots in a forked process from the state as of the request, so production goes on meanwhile; requires database-map-mode = heap")
          ;
    config_file_options.add(producer_options);
 }
@@ -743,6 +1808,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
                my->_signature_providers[pubkey] = make_key_signature_provider(private_key_type(spec_data));
             } else if (spec_type_str == "KROXED") {
                my->_signature_providers[pubkey] = make_kroxed_signature_provider(my, spec_data, pubkey);
+               my->_remote_signature_keys.insert(pubkey);
             }
 
          } catch (...) {
@@ -752,6 +1818,9 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    }
 
    my->_kroxed_provider_timeout_us = fc::milliseconds(options.at("kroxed-provider-timeout").as<int32_t>());
+   my->_async_block_signing = options.at("async-block-signing").as<bool>();
+   my->_block_signing_timeout_us = fc::milliseconds(options.at("block-signing-timeout-ms").as<uint32_t>());
+   my->_block_signing_timer = std::make_unique<boost::asio::deadline_timer>( app().get_io_service() );
 
    my->_produce_time_offset_us = options.at("produce-time-offset-us").as<int32_t>();
 
@@ -768,12 +1837,61 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    my->_max_irreversible_block_age_us = fc::seconds(options.at("max-irreversible-block-age").as<int32_t>());
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
+   my->_pre_slot_speculation_blocks = options.at("pre-slot-speculation-blocks").as<uint32_t>();
+
+   const auto& trx_order = options.at( "incoming-transaction-order" ).as<string>();
+   if( trx_order == "fifo" ) {
+      my->_pending_incoming_transactions.order = pending_transaction_queue::order_type::fifo;
+   } else {
+      ROXE_ASSERT( trx_order == "fair", plugin_config_exception,
+                   "incoming-transaction-order must be fifo or fair, not ${o}", ("o", trx_order) );
+      my->_pending_incoming_transactions.order = pending_transaction_queue::order_type::fair;
+   }
+   my->_pending_incoming_transactions.max_size = options.at( "incoming-transaction-queue-size" ).as<uint32_t>();
+   my->_cpu_history_reject_samples = options.at( "cpu-history-reject-samples" ).as<uint32_t>();
+   my->_unapplied_retry.set_max_backoff_blocks( options.at( "unapplied-retry-max-backoff-blocks" ).as<uint32_t>() );
+   my->_scheduled_trxs.set_max_backoff_blocks( options.at( "unapplied-retry-max-backoff-blocks" ).as<uint32_t>() );
+   my->_persist_pending_transactions = options.at( "persist-pending-transactions" ).as<bool>();
+   my->_speculative_rebase = options.at( "speculative-rebase" ).as<bool>();
+   ROXE_ASSERT( !my->_speculative_rebase || my->chain_plug->chain().record_table_access_sets(), plugin_config_exception,
+                "speculative-rebase requires record-table-access-sets" );
+   my->_block_timings.capacity = options.at( "block-timing-history-size" ).as<uint32_t>();
+   my->_resource_leaderboard_enabled = options.at( "resource-leaderboard" ).as<bool>();
+   if( my->_resource_leaderboard_enabled && options.at( "resource-leaderboard-detailed-traces" ).as<bool>() )
+      my->chain_plug->chain().require_detailed_traces();
+
+   fc::tracing::set_ring_capacity( options.at( "block-tracing-ring-size" ).as<uint32_t>() );
+   my->_block_trace_dir = options.at( "block-tracing-dir" ).as<bfs::path>();
+   if( my->_block_trace_dir.is_relative() )
+      my->_block_trace_dir = app().data_dir() / my->_block_trace_dir;
+   if( options.count( "block-tracing-blocks" ) ) {
+      const auto range = options.at( "block-tracing-blocks" ).as<string>();
+      const auto dash = range.find( '-' );
+      set_block_tracing_params params;
+      try {
+         params.first_block = std::stoul( range.substr( 0, dash ) );
+         params.last_block = dash == string::npos ? *params.first_block : std::stoul( range.substr( dash + 1 ) );
+      } catch( const std::exception& ) {
+         ROXE_THROW( plugin_config_exception, "block-tracing-blocks ${r} is not first-last", ("r", range) );
+      }
+      set_block_tracing( params );
+   }
+   if( options.at( "block-tracing" ).as<bool>() ) {
+      set_block_tracing_params params;
+      params.enabled = true;
+      set_block_tracing( params );
+   }
+   my->_pending_transaction_log.file = app().data_dir() / "pending-transactions.log";
+   my->_pending_transaction_log.journal_enabled =
+         my->_persist_pending_transactions && options.at( "pending-transactions-journal" ).as<bool>();
 
    auto thread_pool_size = options.at( "producer-threads" ).as<uint16_t>();
    ROXE_ASSERT( thread_pool_size > 0, plugin_config_exception,
                "producer-threads ${num} must be greater than 0", ("num", thread_pool_size));
    my->_thread_pool.emplace( "prod", thread_pool_size );
 
+   my->_background_snapshots_enabled = options.at( "background-snapshots" ).as<bool>();
+
    if( options.count( "snapshots-dir" )) {
       auto sd = options.at( "snapshots-dir" ).as<bfs::path>();
       if( sd.is_relative()) {
@@ -809,6 +1927,11 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
       return my->on_incoming_transaction_async(trx, persist_until_expired, next );
    });
 
+   my->_incoming_transactions_async_provider = app().get_method<incoming::methods::transactions_async>().register_provider(
+         [this](const vector<transaction_metadata_ptr>& trxs, bool persist_until_expired, const vector<next_function<transaction_trace_ptr>>& nexts) -> void {
+      return my->on_incoming_transactions_async(trxs, persist_until_expired, nexts );
+   });
+
    if (options.count("greylist-account")) {
       std::vector<std::string> greylist = options["greylist-account"].as<std::vector<std::string>>();
       greylist_params param;
@@ -843,6 +1966,35 @@ void producer_plugin::plugin_startup()
    my->_accepted_block_connection.emplace(chain.accepted_block.connect( [this]( const auto& bsp ){ my->on_block( bsp ); } ));
    my->_accepted_block_header_connection.emplace(chain.accepted_block_header.connect( [this]( const auto& bsp ){ my->on_block_header( bsp ); } ));
    my->_irreversible_block_connection.emplace(chain.irreversible_block.connect( [this]( const auto& bsp ){ my->on_irreversible_block( bsp->block ); } ));
+   if( my->_resource_leaderboard_enabled ) {
+      my->_applied_transaction_connection.emplace(chain.applied_transaction.connect(
+            [this]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
+               my->_resource_leaderboard.on_applied_transaction( std::get<0>( t ), std::get<1>( t ) );
+            } ));
+   }
+
+   if( my->_persist_pending_transactions ) {
+      // signature recovery of the restored transactions starts on the thread pool as for any incoming transaction
+      auto stored = my->_pending_transaction_log.load( chain.get_chain_id() );
+      const auto head_time = chain.head_block_time();
+      vector<pending_transaction_log::stored_transaction> restored;
+      for( auto& st : stored ) {
+         if( fc::time_point( st.trx->expiration() ) < head_time )
+            continue;
+         restored.push_back( st );
+      }
+      if( !stored.empty() )
+         ilog( "restoring ${n} of ${t} pending transactions", ("n", restored.size())("t", stored.size()) );
+      const bool journal = my->_pending_transaction_log.journal_enabled;
+      if( journal )
+         my->_pending_transaction_log.write( chain.get_chain_id(), restored );
+      my->_pending_transaction_log.journal_enabled = false; // already written, do not append them again
+      for( const auto& st : restored ) {
+         my->on_incoming_transaction_async( std::make_shared<transaction_metadata>( st.trx ), st.persist_until_expired,
+                                            []( const auto& ) {} );
+      }
+      my->_pending_transaction_log.journal_enabled = journal;
+   }
 
    const auto lib_num = chain.last_irreversible_block_num();
    const auto lib = chain.fetch_block_by_number(lib_num);
@@ -880,6 +2032,28 @@ void producer_plugin::plugin_shutdown() {
       edump((e.to_detail_string()));
    }
 
+   if( my->_persist_pending_transactions && my->chain_plug ) {
+      try {
+         chain::controller& chain = my->chain_plug->chain();
+         my->finish_block_signing();
+         chain.abort_block(); // the transactions of the pending block become unapplied
+         auto trxs = my->collect_pending_transactions();
+         my->_pending_transaction_log.journal_enabled = false;
+         my->_pending_transaction_log.write( chain.get_chain_id(), trxs );
+         ilog( "saved ${n} pending transactions", ("n", trxs.size()) );
+      } LOG_AND_DROP()
+   }
+
+   // background snapshots are left pending, as those still waiting for their block to become irreversible
+   my->_background_snapshot_timer.cancel();
+   for( auto& bs : my->_background_snapshots ) {
+      int status = 0;
+      if( waitpid( bs.pid, &status, 0 ) != bs.pid )
+         status = -1;
+      my->finish_background_snapshot( bs, status );
+   }
+   my->_background_snapshots.clear();
+
    if( my->_thread_pool ) {
       my->_thread_pool->stop();
    }
@@ -912,6 +2086,13 @@ bool producer_plugin::paused() const {
    return my->_pause_production;
 }
 
+void producer_plugin::promote_standby() {
+   chain::controller& chain = my->chain_plug->chain();
+   chain.promote_standby();
+   chain.abort_block();
+   my->schedule_production_loop();
+}
+
 void producer_plugin::update_runtime_options(const runtime_options& options) {
    chain::controller& chain = my->chain_plug->chain();
    bool check_speculating = false;
@@ -1029,6 +2210,10 @@ producer_plugin::integrity_hash_information producer_plugin::get_integrity_hash(
    return {chain.head_block_id(), chain.calculate_integrity_hash()};
 }
 
+const bfs::path& producer_plugin::get_snapshots_dir() const {
+   return my->_snapshots_dir;
+}
+
 void producer_plugin::create_snapshot(producer_plugin::next_function<producer_plugin::snapshot_information> next) {
    chain::controller& chain = my->chain_plug->chain();
 
@@ -1048,27 +2233,33 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
          my->schedule_production_loop();
       });
 
-      if (chain.is_building_block()) {
+      if (my->finish_block_signing() || chain.is_building_block()) {
          // abort the pending block
          chain.abort_block();
       } else {
          reschedule.cancel();
       }
 
-      bfs::create_directory( p.parent_path() );
-
-      // create the snapshot
-      auto snap_out = std::ofstream(p.generic_string(), (std::ios::out | std::ios::binary));
-      auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
-      chain.write_snapshot(writer);
-      writer->finalize();
-      snap_out.flush();
-      snap_out.close();
+      write_snapshot_file( chain, p );
    };
 
+   // a snapshot of this block already being written in the background answers this request as well
+   for( auto& bs : my->_background_snapshots ) {
+      if( bs.block_id == head_id ) {
+         bs.next = [prev = bs.next, next](const fc::static_variant<fc::exception_ptr, producer_plugin::snapshot_information>& res){
+            prev(res);
+            next(res);
+         };
+         return;
+      }
+   }
+
    // If in irreversible mode, create snapshot and return path to snapshot immediately.
    if( chain.get_read_mode() == db_read_mode::IRREVERSIBLE ) {
       try {
+         if( my->start_background_snapshot( head_id, temp_path, {}, snapshot_path, true, next ) )
+            return;
+
          write_snapshot( temp_path );
 
          boost::system::error_code ec;
@@ -1101,6 +2292,9 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
       const auto& pending_path = pending_snapshot::get_pending_path(head_id, my->_snapshots_dir);
 
       try {
+         if( my->start_background_snapshot( head_id, temp_path, pending_path, snapshot_path, false, next ) )
+            return;
+
          write_snapshot( temp_path ); // create a new pending snapshot
 
          boost::system::error_code ec;
@@ -1116,6 +2310,154 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
    }
 }
 
+bool producer_plugin_impl::start_background_snapshot( const block_id_type& head_id, const bfs::path& temp_path,
+                                                     const bfs::path& pending_path, const bfs::path& final_path,
+                                                     bool irreversible, background_snapshot::next_t next ) {
+   chain::controller& chain = chain_plug->chain();
+   if( !_background_snapshots_enabled || !chain.db().is_process_private() )
+      return false;
+
+   auto reschedule = fc::make_scoped_exit([this](){
+      schedule_production_loop();
+   });
+   if (finish_block_signing() || chain.is_building_block()) {
+      chain.abort_block();
+   } else {
+      reschedule.cancel();
+   }
+
+   bfs::create_directory( temp_path.parent_path() );
+   pid_t pid = fork();
+   ROXE_ASSERT( pid >= 0, snapshot_finalization_exception, "Unable to fork snapshot writer: ${e}", ("e", strerror(errno)) );
+   if( pid == 0 ) {
+      // the child only writes the file; no logging or destructors as the locks of the other threads are gone
+      int rc = 1;
+      try {
+         write_snapshot_file( chain, temp_path );
+         rc = 0;
+      } catch( ... ) {}
+      _exit( rc );
+   }
+
+   chain.start_differential_snapshot_base();
+   _background_snapshots.push_back( {pid, head_id, temp_path, pending_path, final_path, irreversible, std::move(next)} );
+   ilog( "writing snapshot of block ${n} in background process ${pid}", ("n", block_header::num_from_id(head_id))("pid", pid) );
+   if( _background_snapshots.size() == 1 )
+      poll_background_snapshots();
+   return true;
+}
+
+void producer_plugin_impl::poll_background_snapshots() {
+   for( size_t i = 0; i < _background_snapshots.size(); ) {
+      auto& bs = _background_snapshots[i];
+      int status = 0;
+      auto r = waitpid( bs.pid, &status, WNOHANG );
+      if( r == 0 || (r < 0 && errno == EINTR) ) {
+         ++i;
+         continue;
+      }
+      auto done = std::move( bs );
+      _background_snapshots.erase( _background_snapshots.begin() + i );
+      finish_background_snapshot( done, r == done.pid ? status : -1 );
+   }
+   if( _background_snapshots.empty() )
+      return;
+
+   _background_snapshot_timer.expires_from_now( boost::posix_time::milliseconds( 100 ) );
+   _background_snapshot_timer.async_wait( app().get_priority_queue().wrap( priority::low,
+         [weak_this = weak_from_this()]( const boost::system::error_code& ec ) {
+            auto self = weak_this.lock();
+            if( self && ec != boost::asio::error::operation_aborted )
+               self->poll_background_snapshots();
+         } ) );
+}
+
+void producer_plugin_impl::finish_background_snapshot( background_snapshot& bs, int status ) {
+   auto next = bs.next;
+   try {
+      const auto block_num = block_header::num_from_id( bs.block_id );
+      if( status < 0 || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+         boost::system::error_code ec;
+         bfs::remove( bs.temp_path, ec );
+         ROXE_THROW( snapshot_finalization_exception, "Background snapshot writer of block number ${bn} failed with status ${s}",
+                     ("bn", block_num)("s", status) );
+      }
+
+      boost::system::error_code ec;
+      bfs::rename( bs.temp_path, bs.irreversible ? bs.final_path : bs.pending_path, ec );
+      ROXE_ASSERT( !ec, snapshot_finalization_exception,
+                   "Unable to finalize valid snapshot of block number ${bn}: [code: ${ec}] ${message}",
+                   ("bn", block_num)("ec", ec.value())("message", ec.message()) );
+      ilog( "background snapshot of block ${n} written", ("n", block_num) );
+
+      if( bs.irreversible ) {
+         next( producer_plugin::snapshot_information{bs.block_id, bs.final_path.generic_string()} );
+         return;
+      }
+
+      // promoted on irreversibility as any pending snapshot, which may already have happened while writing
+      auto& pending_by_id = _pending_snapshot_index.get<by_id>();
+      auto itr = pending_by_id.emplace( bs.block_id, next, bs.pending_path.generic_string(), bs.final_path.generic_string() ).first;
+      const chain::controller& chain = chain_plug->chain();
+      if( block_num <= chain.last_irreversible_block_num() ) {
+         auto n = itr->next;
+         try {
+            n( itr->finalize( chain ) );
+         } CATCH_AND_CALL( n );
+         pending_by_id.erase( itr );
+      }
+   } CATCH_AND_CALL( next );
+}
+
+void producer_plugin::create_differential_snapshot(producer_plugin::next_function<producer_plugin::snapshot_information> next) {
+   chain::controller& chain = my->chain_plug->chain();
+
+   auto head_id = chain.head_block_id();
+   const auto& snapshot_path = pending_snapshot::get_differential_path(head_id, my->_snapshots_dir);
+   const auto& temp_path     = pending_snapshot::get_temp_path(head_id, my->_snapshots_dir);
+
+   if( fc::is_regular_file(snapshot_path) ) {
+      auto ex = snapshot_exists_exception( FC_LOG_MESSAGE( error, "snapshot named ${name} already exists", ("name", snapshot_path.generic_string()) ) );
+      next(ex.dynamic_copy_exception());
+      return;
+   }
+
+   // the change journal restarts at the head once the differential snapshot is written, so unlike full snapshots
+   // it is written right away instead of waiting for the head to become irreversible
+   try {
+      auto reschedule = fc::make_scoped_exit([this](){
+         my->schedule_production_loop();
+      });
+
+      if (my->finish_block_signing() || chain.is_building_block()) {
+         chain.abort_block();
+      } else {
+         reschedule.cancel();
+      }
+
+      bfs::create_directory( temp_path.parent_path() );
+
+      {
+         auto snap_out = std::ofstream(temp_path.generic_string(), (std::ios::out | std::ios::binary));
+         auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
+         chain.write_differential_snapshot(writer);
+         writer->finalize();
+         snap_out.flush();
+         snap_out.close();
+      }
+
+      boost::system::error_code ec;
+      bfs::rename(temp_path, snapshot_path, ec);
+      ROXE_ASSERT(!ec, snapshot_finalization_exception,
+            "Unable to finalize differential snapshot of block number ${bn}: [code: ${ec}] ${message}",
+            ("bn", chain.head_block_num())
+            ("ec", ec.value())
+            ("message", ec.message()));
+
+      next( producer_plugin::snapshot_information{head_id, snapshot_path.generic_string()} );
+   } CATCH_AND_CALL (next);
+}
+
 producer_plugin::scheduled_protocol_feature_activations
 producer_plugin::get_scheduled_protocol_feature_activations()const {
    return {my->_protocol_features_to_activate};
@@ -1221,10 +2563,139 @@ producer_plugin::get_account_ram_corrections( const get_account_ram_corrections_
    return result;
 }
 
+producer_plugin::get_wasm_profile_result
+producer_plugin::get_wasm_profile( const get_wasm_profile_params& params ) {
+   get_wasm_profile_result result;
+   auto& profiler = my->chain_plug->chain().get_wasm_interface().get_profiler();
+   result.enabled = profiler.enabled();
+   result.rows = profiler.get_stats();
+   if( result.rows.size() > params.limit )
+      result.rows.resize( params.limit );
+   if( params.reset )
+      profiler.clear();
+   return result;
+}
+
+producer_plugin::get_wasm_samples_result
+producer_plugin::get_wasm_samples( const get_wasm_samples_params& params ) {
+   get_wasm_samples_result result;
+   auto& profiler = my->chain_plug->chain().get_wasm_interface().get_profiler();
+   result.sample_interval_us = profiler.sampling_interval_us();
+   auto rows = profiler.get_samples();
+   if( rows.size() > params.limit )
+      rows.resize( params.limit );
+   if( params.folded ) {
+      for( const auto& r : rows ) {
+         for( const auto& s : r.stacks ) {
+            result.folded += s.first;
+            result.folded += ' ';
+            result.folded += std::to_string( s.second );
+            result.folded += '\n';
+         }
+      }
+   } else {
+      result.rows = std::move( rows );
+   }
+   if( params.reset )
+      profiler.clear_samples();
+   return result;
+}
+
+producer_plugin::get_cpu_history_result
+producer_plugin::get_cpu_history( const get_cpu_history_params& params )const {
+   get_cpu_history_result result;
+   result.average_cpu_us = my->_cpu_history.average_cpu_us();
+   result.pending_transactions = my->_pending_incoming_transactions.size();
+   result.rejected = my->_cpu_history_rejected;
+   result.deferred = my->_cpu_history_deferred;
+   result.rows = my->_cpu_history.top( params.limit );
+   return result;
+}
+
+producer_plugin::get_block_timings_result
+producer_plugin::get_block_timings( const get_block_timings_params& params )const {
+   return my->_block_timings.get( params.limit );
+}
+
+producer_plugin::get_resource_leaderboard_result
+producer_plugin::get_resource_leaderboard( const get_resource_leaderboard_params& params )const {
+   ROXE_ASSERT( my->_resource_leaderboard_enabled, chain::plugin_exception, "resource-leaderboard is disabled" );
+   get_resource_leaderboard_result result;
+   result.head_block_time = my->chain_plug->chain().head_block_time();
+   result.rows = my->_resource_leaderboard.top( params, result.head_block_time );
+   return result;
+}
+
+void producer_plugin::set_block_tracing( const set_block_tracing_params& params ) {
+   if( params.first_block ) {
+      const uint32_t last = params.last_block ? *params.last_block : *params.first_block;
+      ROXE_ASSERT( *params.first_block > 0 && last >= *params.first_block, plugin_config_exception,
+                   "block tracing range ${f}-${l} is empty", ("f", *params.first_block)("l", last) );
+      my->_block_trace_range = { *params.first_block, last };
+      my->_block_trace_range_start_ns = 0;
+   }
+   if( params.enabled ) {
+      if( *params.enabled && !my->_block_tracing )
+         fc::tracing::clear();
+      my->_block_tracing = *params.enabled;
+   }
+   fc::tracing::set_enabled( my->_block_tracing || my->_block_trace_range_start_ns );
+}
+
+producer_plugin::block_trace_information
+producer_plugin::export_block_trace( const export_block_trace_params& params ) {
+   const uint64_t now = fc::tracing::now_ns();
+   const uint64_t window = uint64_t(params.seconds) * 1000000000;
+   auto spans = fc::tracing::collect( window && window < now ? now - window : 0, now );
+   block_trace_information result;
+   result.spans = spans.size();
+   auto file = my->_block_trace_dir / ("block-trace-" + std::to_string( my->chain_plug->chain().head_block_num() ) + "-" +
+                                       std::to_string( fc::time_point::now().sec_since_epoch() ) + ".json");
+   result.file_name = file.generic_string();
+   my->write_block_trace( std::move( spans ), std::move( file ) );
+   return result;
+}
+
+void producer_plugin_impl::begin_block_trace( uint32_t block_num ) {
+   if( _block_trace_range_start_ns || block_num < _block_trace_range.first || block_num > _block_trace_range.second )
+      return;
+   if( !_block_tracing )
+      fc::tracing::clear();
+   _block_trace_range_start_ns = fc::tracing::now_ns();
+   fc::tracing::set_enabled( true );
+}
+
+void producer_plugin_impl::end_block_trace( uint32_t block_num ) {
+   if( !_block_trace_range_start_ns || block_num < _block_trace_range.second )
+      return;
+   auto spans = fc::tracing::collect( _block_trace_range_start_ns );
+   auto file = _block_trace_dir / ("block-trace-" + std::to_string( _block_trace_range.first ) + "-" +
+                                   std::to_string( _block_trace_range.second ) + ".json");
+   _block_trace_range = { 0, 0 };
+   _block_trace_range_start_ns = 0;
+   fc::tracing::set_enabled( _block_tracing );
+   // serializing a few hundred thousand spans takes long enough to delay the next block
+   boost::asio::post( _thread_pool->get_executor(), [this, spans{std::move( spans )}, file{std::move( file )}]() mutable {
+      write_block_trace( std::move( spans ), std::move( file ) );
+   });
+}
+
+void producer_plugin_impl::write_block_trace( std::vector<fc::tracing::span> spans, bfs::path file ) {
+   try {
+      if( !fc::exists( _block_trace_dir ) )
+         fc::create_directories( _block_trace_dir );
+      std::ofstream out( file.generic_string() );
+      out << fc::tracing::to_chrome_json( spans );
+      out.close();
+      ROXE_ASSERT( !out.fail(), chain::plugin_exception, "unable to write ${f}", ("f", file.generic_string()) );
+      ilog( "wrote ${n} block lifecycle spans to ${f}", ("n", spans.size())("f", file.generic_string()) );
+   } LOG_AND_DROP()
+}
+
 optional<fc::time_point> producer_plugin_impl::calculate_next_block_time(const account_name& producer_name, const block_timestamp_type& current_block_time) const {
    chain::controller& chain = chain_plug->chain();
    const auto& hbs = chain.head_block_state();
-   const auto& active_schedule = hbs->active_schedule.producers;
+   const auto& active_schedule = hbs->active_schedule->producers;
 
    // determine if this producer is in the active schedule and if so, where
    auto itr = std::find_if(active_schedule.begin(), active_schedule.end(), [&](const auto& asp){ return asp.producer_name == producer_name; });
@@ -1291,6 +2762,18 @@ fc::time_point producer_plugin_impl::calculate_pending_block_time() const {
    return block_time;
 }
 
+bool producer_plugin_impl::near_own_slot( const fc::time_point& block_time ) const {
+   if( _pre_slot_speculation_blocks == 0 )
+      return false;
+   const auto window = fc::microseconds( int64_t(_pre_slot_speculation_blocks) * config::block_interval_us );
+   for( const auto& p : _producers ) {
+      auto next_block_time = calculate_next_block_time( p, block_timestamp_type( block_time ) );
+      if( next_block_time && *next_block_time - block_time <= window )
+         return true;
+   }
+   return false;
+}
+
 fc::time_point producer_plugin_impl::calculate_block_deadline( const fc::time_point& block_time ) const {
    bool last_block = ((block_timestamp_type(block_time).slot % config::producer_repetitions) == config::producer_repetitions - 1);
    return block_time + fc::microseconds(last_block ? _last_block_time_offset_us : _produce_time_offset_us);
@@ -1306,7 +2789,7 @@ enum class tx_category {
 producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
    chain::controller& chain = chain_plug->chain();
 
-   if( chain.get_read_mode() == chain::db_read_mode::READ_ONLY )
+   if( chain.get_read_mode() == chain::db_read_mode::READ_ONLY || chain.is_standby() )
       return start_block_result::waiting;
 
    fc_dlog(_log, "Starting block at ${time}", ("time", fc::time_point::now()));
@@ -1319,6 +2802,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
    const fc::time_point block_time = calculate_pending_block_time();
 
    _pending_block_mode = pending_block_mode::producing;
+   _block_timings.abort();
 
    // Not our turn
    const auto& scheduled_producer = hbs->get_scheduled_producer(block_time);
@@ -1359,6 +2843,9 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
          return start_block_result::waiting;
    }
 
+   _pre_slot_speculation = _pending_block_mode == pending_block_mode::speculating && _production_enabled && !_pause_production
+                           && near_own_slot( block_time );
+
    try {
       uint16_t blocks_to_confirm = 0;
 
@@ -1427,13 +2914,23 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
       if (_pending_block_mode == pending_block_mode::producing && pending_block_signing_key != scheduled_producer.block_signing_key) {
          elog("Block Signing Key is not expected value, reverting to speculative mode! [expected: \"${expected}\", actual: \"${actual\"", ("expected", scheduled_producer.block_signing_key)("actual", pending_block_signing_key));
          _pending_block_mode = pending_block_mode::speculating;
+         _pre_slot_speculation = false;
+      }
+
+      if( _pending_block_mode == pending_block_mode::producing ) {
+         _block_timings.begin( hbs->block_num + 1, block_time, scheduled_producer.producer_name, now );
+         begin_block_trace( hbs->block_num + 1 );
+         _block_timings.add( block_timing_log::start_block, fc::time_point::now() - now );
       }
 
       try {
-         if( !remove_expired_persisted_trxs( preprocess_deadline ) )
-            return start_block_result::exhausted;
-         if( !remove_expired_blacklisted_trxs( preprocess_deadline ) )
-            return start_block_result::exhausted;
+         {
+            block_timing_log::scope timing( _block_timings, block_timing_log::expire );
+            if( !remove_expired_persisted_trxs( preprocess_deadline ) )
+               return start_block_result::exhausted;
+            if( !remove_expired_blacklisted_trxs( preprocess_deadline ) )
+               return start_block_result::exhausted;
+         }
 
          // limit execution of pending incoming to once per block
          size_t pending_incoming_process_limit = _pending_incoming_transactions.size();
@@ -1536,6 +3033,8 @@ bool producer_plugin_impl::remove_expired_blacklisted_trxs( const fc::time_point
          blacklist_by_expiry.erase(blacklist_by_expiry.begin());
          num_expired++;
       }
+      if( num_expired )
+         _scheduled_trxs.reset(); // the transactions no longer blacklisted are due again
 
       fc_dlog( _log, "Processed ${n} blacklisted transactions, Expired ${expired}",
                ("n", orig_count)("expired", num_expired) );
@@ -1549,6 +3048,8 @@ bool producer_plugin_impl::process_unapplied_trxs( const fc::time_point& deadlin
    auto& persisted_by_id = _persistent_transactions.get<by_id>();
 
    bool exhausted = false;
+   block_timing_log::scope timing( _block_timings, block_timing_log::unapplied );
+   _carried_trxs.clear();
    // Processing unapplied transactions...
    //
    if (_producers.empty() && persisted_by_id.empty()) {
@@ -1561,9 +3062,13 @@ bool producer_plugin_impl::process_unapplied_trxs( const fc::time_point& deadlin
       if( !unapplied_trxs.empty() ) {
          const time_point pending_block_time = chain.pending_block_time();
          auto unapplied_trxs_size = unapplied_trxs.size();
+         const uint32_t pending_block_num = chain.head_block_num() + 1;
          int num_applied = 0;
          int num_failed = 0;
          int num_processed = 0;
+         int num_backed_off = 0;
+         int num_carried = 0;
+         _unapplied_retry.prune( unapplied_trxs, pending_block_num );
          auto calculate_transaction_category = [&](const transaction_metadata_ptr& trx) {
             if (trx->packed_trx->expiration() < pending_block_time) {
                return tx_category::EXPIRED;
@@ -1574,16 +3079,37 @@ bool producer_plugin_impl::process_unapplied_trxs( const fc::time_point& deadlin
             }
          };
 
-         auto itr = unapplied_trxs.begin();
-         while( itr != unapplied_trxs.end() ) {
-            auto itr_next = itr; // save off next since itr may be invalidated by loop
-            ++itr_next;
+         // chain.push_transaction can modify unapplied_trxs, so work from a copy; in fair order the transactions
+         // expected to be cheapest are retried first
+         vector<transaction_metadata_ptr> trxs;
+         trxs.reserve( unapplied_trxs_size );
+         for( const auto& t : unapplied_trxs )
+            trxs.push_back( t.second );
+         if( _pending_incoming_transactions.order == pending_transaction_queue::order_type::fair ) {
+            vector<std::pair<double, transaction_metadata_ptr>> costs;
+            costs.reserve( trxs.size() );
+            for( auto& t : trxs )
+               costs.emplace_back( _cpu_history.expected( t ).cpu_us, std::move( t ) );
+            std::stable_sort( costs.begin(), costs.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+            for( size_t i = 0; i < costs.size(); ++i )
+               trxs[i] = std::move( costs[i].second );
+         }
+         // transactions that applied in the speculative blocks ahead of this slot go first, they are expected to
+         // apply again and fill the block before the ones not validated recently
+         if( _pending_block_mode == pending_block_mode::producing && !_prevalidated_trxs.empty() ) {
+            std::stable_partition( trxs.begin(), trxs.end(), [&]( const transaction_metadata_ptr& t ) {
+               return _prevalidated_trxs.count( t->signed_id ) > 0;
+            } );
+         }
+         _prevalidated_trxs.clear();
+         const bool retry_unpersisted = _pending_block_mode == pending_block_mode::producing || _pre_slot_speculation;
+         const bool carry_over = _speculative_rebase && _pending_block_mode == pending_block_mode::speculating;
 
+         for( const auto& trx : trxs ) {
             if( deadline <= fc::time_point::now() ) {
                exhausted = true;
                break;
             }
-            const transaction_metadata_ptr trx = itr->second;
             auto category = calculate_transaction_category(trx);
             if (category == tx_category::EXPIRED ||
                 (category == tx_category::UNEXPIRED_UNPERSISTED && _producers.empty()))
@@ -1592,48 +3118,117 @@ bool producer_plugin_impl::process_unapplied_trxs( const fc::time_point& deadlin
                   fc_dlog(_trx_trace_log, "[TRX_TRACE] Node with producers configured is dropping an EXPIRED transaction that was PREVIOUSLY ACCEPTED : ${txid}",
                           ("txid", trx->id));
                }
-               itr = unapplied_trxs.erase( itr ); // unapplied_trxs map has not been modified, so simply erase and continue
+               _unapplied_retry.erase( trx->signed_id );
+               unapplied_trxs.erase( trx->signed_id );
                continue;
             } else if (category == tx_category::PERSISTED ||
-                       (category == tx_category::UNEXPIRED_UNPERSISTED && _pending_block_mode == pending_block_mode::producing))
+                       (category == tx_category::UNEXPIRED_UNPERSISTED && retry_unpersisted))
             {
+               if( !_unapplied_retry.eligible( trx, pending_block_num ) ) {
+                  ++num_backed_off;
+                  continue;
+               }
+
+               if( carry_over && !chain.table_access_stale( *trx ) ) {
+                  ++num_carried;
+                  _carried_trxs.push_back( trx );
+                  if( _pre_slot_speculation )
+                     _prevalidated_trxs.insert( trx->signed_id );
+                  continue;
+               }
+
+               // a transaction expected to take longer than what is left of the block waits for the next one,
+               // cheaper ones after it may still fit
+               const auto now = fc::time_point::now();
+               const auto expected = _cpu_history.expected( trx );
+               if( retry_unpersisted && expected.samples >= 1 &&
+                   now + fc::microseconds( static_cast<int64_t>( expected.cpu_us ) ) > deadline ) {
+                  ++num_backed_off;
+                  continue;
+               }
                ++num_processed;
 
                try {
-                  auto trx_deadline = fc::time_point::now() + fc::milliseconds( _max_transaction_time_ms );
+                  auto trx_deadline = now + fc::milliseconds( _max_transaction_time_ms );
                   bool deadline_is_subjective = false;
-                  if (_max_transaction_time_ms < 0 || (_pending_block_mode == pending_block_mode::producing && deadline < trx_deadline)) {
+                  if (_max_transaction_time_ms < 0 || (retry_unpersisted && deadline < trx_deadline)) {
                      deadline_is_subjective = true;
                      trx_deadline = deadline;
                   }
+                  // until it failed, a transaction with a known cost is cut off well past it instead of being
+                  // allowed the rest of the block; running into that is no reason to drop it
+                  if( retry_unpersisted && expected.samples >= 1 && _unapplied_retry.failures( trx ) == 0 ) {
+                     const auto expected_deadline = now + fc::microseconds( std::max<int64_t>(
+                           4 * static_cast<int64_t>( expected.cpu_us ), config::block_interval_us / 50 ) );
+                     if( expected_deadline < trx_deadline ) {
+                        deadline_is_subjective = true;
+                        trx_deadline = expected_deadline;
+                     }
+                  }
 
                   auto trace = chain.push_transaction(trx, trx_deadline);
+                  _cpu_history.record(trx, trace);
                   if (trace->except) {
                      if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                        exhausted = true;
-                        break;
+                        _block_timings.deferred();
+                        _unapplied_retry.failed( trx, pending_block_num );
+                        if( deadline <= fc::time_point::now() ) {
+                           exhausted = true;
+                           break;
+                        }
                      } else {
                         // this failed our configured maximum transaction time, we don't want to replay it
-                        // chain.plus_transactions can modify unapplied_trxs, so erase by id
+                        _unapplied_retry.erase( trx->signed_id );
                         unapplied_trxs.erase( trx->signed_id );
                         ++num_failed;
+                        _block_timings.failed();
                      }
                   } else {
                      ++num_applied;
+                     _block_timings.applied();
+                     _unapplied_retry.applied( trx );
+                     if( _pre_slot_speculation )
+                        _prevalidated_trxs.insert( trx->signed_id );
                   }
                } LOG_AND_DROP();
             }
-
-            itr = itr_next;
          }
 
-         fc_dlog( _log, "Processed ${m} of ${n} previously applied transactions, Applied ${applied}, Failed/Dropped ${failed}",
-                  ("m", num_processed)("n", unapplied_trxs_size)("applied", num_applied)("failed", num_failed) );
+         fc_dlog( _log, "Processed ${m} of ${n} previously applied transactions, Applied ${applied}, Failed/Dropped ${failed}, Backed off ${backed_off}, Carried over ${carried}",
+                  ("m", num_processed)("n", unapplied_trxs_size)("applied", num_applied)("failed", num_failed)("backed_off", num_backed_off)
+                  ("carried", num_carried) );
       }
    }
    return !exhausted;
 }
 
+/// executes the transactions carried over into the pending block, @return whether any of them applied
+bool producer_plugin_impl::apply_carried_trxs( const fc::time_point& deadline )
+{
+   chain::controller& chain = chain_plug->chain();
+   auto carried = std::move( _carried_trxs );
+   _carried_trxs.clear();
+   bool applied = false;
+   for( const auto& trx : carried ) {
+      if( deadline <= fc::time_point::now() )
+         break;
+      // applied since, or dropped as unapplied_trxs would have dropped it
+      if( chain.get_unapplied_transactions().count( trx->signed_id ) == 0 )
+         continue;
+      try {
+         auto trace = chain.push_transaction( trx, deadline );
+         _cpu_history.record( trx, trace );
+         if( !trace->except ) {
+            applied = true;
+         } else if( !failure_is_subjective( *trace->except, true ) ) {
+            _unapplied_retry.erase( trx->signed_id );
+            chain.get_unapplied_transactions().erase( trx->signed_id );
+         }
+      } LOG_AND_DROP();
+   }
+   return applied;
+}
+
 bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_point& deadline, size_t& pending_incoming_process_limit )
 {
    chain::controller& chain = chain_plug->chain();
@@ -1646,13 +3241,20 @@ bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
    int num_processed = 0;
    bool exhausted = false;
    double incoming_trx_weight = 0.0;
-
-   const auto& sch_idx = chain.db().get_index<generated_transaction_multi_index,by_delay>();
-   const auto scheduled_trxs_size = sch_idx.size();
-   auto sch_itr = sch_idx.begin();
-   while( sch_itr != sch_idx.end() ) {
-      if( sch_itr->delay_until > pending_block_time) break;    // not scheduled yet
-      if( sch_itr->published >= pending_block_time ) {
+   block_timing_log::scope timing( _block_timings, block_timing_log::scheduled );
+
+   const uint32_t pending_block_num = chain.head_block_num() + 1;
+   _scheduled_trxs.refresh( chain, pending_block_time, blacklist_by_id );
+   const auto scheduled_trxs_size = _scheduled_trxs.size();
+   auto sch_itr = _scheduled_trxs.begin();
+   while( sch_itr != _scheduled_trxs.end() ) {
+      const transaction_id_type trx_id = *sch_itr;
+      const auto* gto = chain.db().find<generated_transaction_object,by_trx_id>( trx_id );
+      if( !gto || blacklist_by_id.find( trx_id ) != blacklist_by_id.end() ) {
+         sch_itr = _scheduled_trxs.erase( sch_itr ); // executed, expired or blacklisted since queued
+         continue;
+      }
+      if( gto->published >= pending_block_time || _scheduled_trxs.backed_off( trx_id, pending_block_num ) ) {
          ++sch_itr;
          continue; // do not allow schedule and execute in same block
       }
@@ -1661,17 +3263,6 @@ bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
          break;
       }
 
-      const transaction_id_type trx_id = sch_itr->trx_id; // make copy since reference could be invalidated
-      if (blacklist_by_id.find(trx_id) != blacklist_by_id.end()) {
-         ++sch_itr;
-         continue;
-      }
-
-      auto sch_itr_next = sch_itr; // save off next since sch_itr may be invalidated by loop
-      ++sch_itr_next;
-      const auto next_delay_until = sch_itr_next != sch_idx.end() ? sch_itr_next->delay_until : sch_itr->delay_until;
-      const auto next_id = sch_itr_next != sch_idx.end() ? sch_itr_next->id : sch_itr->id;
-
       num_processed++;
 
       // configurable ratio of incoming txns vs deferred txns
@@ -1681,8 +3272,7 @@ bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
             break;
          }
 
-         auto e = _pending_incoming_transactions.front();
-         _pending_incoming_transactions.pop_front();
+         auto e = _pending_incoming_transactions.pop();
          --pending_incoming_process_limit;
          incoming_trx_weight -= 1.0;
          process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
@@ -1693,6 +3283,7 @@ bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
          break;
       }
 
+      bool keep = true;
       try {
          auto trx_deadline = fc::time_point::now() + fc::milliseconds(_max_transaction_time_ms);
          bool deadline_is_subjective = false;
@@ -1704,24 +3295,32 @@ bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
          auto trace = chain.push_scheduled_transaction(trx_id, trx_deadline);
          if (trace->except) {
             if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-               exhausted = true;
-               break;
+               _block_timings.deferred();
+               _scheduled_trxs.failed( trx_id, pending_block_num );
+               if( deadline <= fc::time_point::now() ) {
+                  exhausted = true;
+                  break;
+               }
             } else {
+               _block_timings.failed();
                auto expiration = fc::time_point::now() + fc::seconds(chain.get_global_properties().configuration.deferred_trx_expiration_window);
                // this failed our configured maximum transaction time, we don't want to replay it add it to a blacklist
                _blacklisted_transactions.insert(transaction_id_with_expiry{trx_id, expiration});
                num_failed++;
+               keep = false;
             }
          } else {
             num_applied++;
+            _block_timings.applied();
+            keep = false;
          }
       } LOG_AND_DROP();
 
       incoming_trx_weight += _incoming_defer_ratio;
       if (!pending_incoming_process_limit) incoming_trx_weight = 0.0;
 
-      if( sch_itr_next == sch_idx.end() ) break;
-      sch_itr = sch_idx.lower_bound( boost::make_tuple( next_delay_until, next_id ) );
+      if( keep ) ++sch_itr;
+      else sch_itr = _scheduled_trxs.erase( sch_itr );
    }
 
    if( scheduled_trxs_size > 0 ) {
@@ -1741,17 +3340,19 @@ bool producer_plugin_impl::process_incoming_trxs( const fc::time_point& deadline
             exhausted = true;
             break;
          }
-         auto e = _pending_incoming_transactions.front();
-         _pending_incoming_transactions.pop_front();
+         auto e = _pending_incoming_transactions.pop();
          --pending_incoming_process_limit;
          process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
       }
+      _metrics.incoming_queue.set( _pending_incoming_transactions.size() );
    }
    return !exhausted;
 }
 
 void producer_plugin_impl::schedule_production_loop() {
    chain::controller& chain = chain_plug->chain();
+   if( _block_signing ) // rescheduled once the block is signed
+      return;
    _timer.cancel();
    std::weak_ptr<producer_plugin_impl> weak_this = shared_from_this();
 
@@ -1865,6 +3466,8 @@ bool producer_plugin_impl::maybe_produce_block() {
 
    try {
       produce_block();
+      if( _block_signing )
+         reschedule.cancel(); // rescheduled once the block is signed
       return true;
    } LOG_AND_DROP();
 
@@ -1882,7 +3485,7 @@ static auto make_debug_time_logger() {
 }
 
 static auto maybe_make_debug_time_logger() -> fc::optional<decltype(make_debug_time_logger())> {
-   if (_log.is_enabled( fc::log_level::debug ) ){
+   if( FC_LOG_ENABLED( _log, debug ) ) {
       return make_debug_time_logger();
    } else {
       return {};
@@ -1894,6 +3497,7 @@ void producer_plugin_impl::produce_block() {
    ROXE_ASSERT(_pending_block_mode == pending_block_mode::producing, producer_exception, "called produce_block while not actually producing");
    chain::controller& chain = chain_plug->chain();
    const auto& hbs = chain.head_block_state();
+   fc::tracing::scoped_span span( "produce_block", hbs->block_num + 1 );
    ROXE_ASSERT(chain.is_building_block(), missing_pending_block_state, "pending_block_state does not exist but it should, another plugin may have corrupted it");
    auto signature_provider_itr = _signature_providers.find( chain.pending_block_signing_key() );
 
@@ -1905,12 +3509,36 @@ void producer_plugin_impl::produce_block() {
    }
 
    //idump( (fc::time_point::now() - chain.pending_block_time()) );
+   auto finalize_start = fc::time_point::now();
+   if( _async_block_signing && _remote_signature_keys.count( signature_provider_itr->first ) ) {
+      auto digest = chain.finalize_unsigned_block();
+      _block_timings.add( block_timing_log::finalize, fc::time_point::now() - finalize_start );
+      start_block_signing( signature_provider_itr->second, digest );
+      return;
+   }
+
+   fc::microseconds sign_time;
    chain.finalize_block( [&]( const digest_type& d ) {
       auto debug_logger = maybe_make_debug_time_logger();
-      return signature_provider_itr->second(d);
+      auto sign_start = fc::time_point::now();
+      auto sig = signature_provider_itr->second(d);
+      sign_time += fc::time_point::now() - sign_start;
+      return sig;
    } );
+   auto commit_start = fc::time_point::now();
+   _block_timings.add( block_timing_log::finalize, commit_start - finalize_start - sign_time );
+   _block_timings.add( block_timing_log::sign, sign_time );
 
+   commit_produced_block();
+}
+
+void producer_plugin_impl::commit_produced_block() {
+   chain::controller& chain = chain_plug->chain();
+   auto commit_start = fc::time_point::now();
    chain.commit_block();
+   _block_timings.add( block_timing_log::commit, fc::time_point::now() - commit_start );
+   _block_timings.end();
+   _metrics.blocks_produced.inc();
 
    block_state_ptr new_bs = chain.head_block_state();
 
@@ -1921,4 +3549,61 @@ void producer_plugin_impl::produce_block() {
 
 }
 
+void producer_plugin_impl::start_block_signing( const signature_provider_type& provider, const digest_type& digest ) {
+   block_signing bs;
+   bs.seq = ++_block_signing_seq;
+   bs.started = fc::time_point::now();
+   bs.deadline = bs.started + _block_signing_timeout_us;
+   bs.signature = async_thread_pool( _thread_pool->get_executor(),
+         [provider, digest, seq = bs.seq, weak_this = weak_from_this()]() {
+            auto on_exit = fc::make_scoped_exit( [&]() {
+               app().post( priority::high, [seq, weak_this]() {
+                  if( auto self = weak_this.lock() )
+                     self->on_block_signed( seq );
+               } );
+            } );
+            return provider( digest );
+         } );
+   _block_signing = std::move( bs );
+
+   _block_signing_timer->expires_from_now( boost::posix_time::microseconds( _block_signing_timeout_us.count() ) );
+   _block_signing_timer->async_wait( app().get_priority_queue().wrap( priority::high,
+         [seq = _block_signing->seq, weak_this = weak_from_this()]( const boost::system::error_code& ec ) {
+            auto self = weak_this.lock();
+            if( self && ec != boost::asio::error::operation_aborted )
+               self->on_block_signed( seq );
+         } ) );
+}
+
+void producer_plugin_impl::on_block_signed( uint64_t seq ) {
+   if( !_block_signing || _block_signing->seq != seq )
+      return; // already finished
+   finish_block_signing();
+   schedule_production_loop();
+}
+
+bool producer_plugin_impl::finish_block_signing() {
+   if( !_block_signing )
+      return false;
+   auto bs = std::move( *_block_signing );
+   _block_signing.reset();
+   _block_signing_timer->cancel();
+
+   chain::controller& chain = chain_plug->chain();
+   try {
+      const auto remaining = std::max<int64_t>( 0, (bs.deadline - fc::time_point::now()).count() );
+      ROXE_ASSERT( bs.signature.wait_for( std::chrono::microseconds( remaining ) ) == std::future_status::ready,
+                   producer_exception, "block ${n} was not signed within ${t}ms",
+                   ("n", chain.head_block_num() + 1)("t", _block_signing_timeout_us.count() / 1000) );
+      chain.complete_block( bs.signature.get() );
+      _block_timings.add( block_timing_log::sign, fc::time_point::now() - bs.started );
+      commit_produced_block();
+      return true;
+   } LOG_AND_DROP();
+
+   fc_dlog(_log, "Aborting block due to signing error");
+   chain.abort_block();
+   return true;
+}
+
 } // namespace roxe
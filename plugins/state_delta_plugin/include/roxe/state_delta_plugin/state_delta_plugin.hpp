@@ -0,0 +1,37 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <appbase/application.hpp>
+#include <roxe/chain_plugin/chain_plugin.hpp>
+
+namespace roxe {
+
+using namespace appbase;
+typedef std::shared_ptr<class state_delta_plugin_impl> state_delta_ptr;
+
+/**
+ *  On a primary, appends the state delta of every accepted block (see chain/state_delta.hpp) along with the block
+ *  to state-deltas.log in state-delta-log-dir. A standby (chain_plugin's state-delta-standby) tails that file, e.g.
+ *  on shared storage, and applies the entries in order until it is promoted.
+ *
+ *  An entry of the log is its size as a little endian uint32_t followed by the packed chain::state_delta_entry.
+ */
+class state_delta_plugin : public plugin<state_delta_plugin> {
+public:
+   APPBASE_PLUGIN_REQUIRES((chain_plugin))
+
+   state_delta_plugin();
+   virtual ~state_delta_plugin();
+
+   virtual void set_program_options(options_description& cli, options_description& cfg) override;
+   void plugin_initialize(const variables_map& options);
+   void plugin_startup();
+   void plugin_shutdown();
+
+private:
+   state_delta_ptr my;
+};
+
+} // namespace roxe
@@ -0,0 +1,209 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/state_delta_plugin/state_delta_plugin.hpp>
+#include <roxe/chain/state_delta.hpp>
+
+#include <boost/signals2/connection.hpp>
+
+#include <fstream>
+
+namespace roxe {
+   using namespace chain;
+   using boost::signals2::scoped_connection;
+
+   static appbase::abstract_plugin& _state_delta_plugin = app().register_plugin<state_delta_plugin>();
+
+   class state_delta_plugin_impl {
+      public:
+         static constexpr const char* log_file_name = "state-deltas.log";
+         /// entries applied before the main thread gets to other work, a standby catching up polls again right away
+         static constexpr uint32_t max_entries_per_poll = 500;
+
+         chain_plugin*                   chain_plug = nullptr;
+         fc::optional<scoped_connection> accepted_block_connection;
+
+         // primary
+         bfs::path                       log_file;
+         std::ofstream                   out;
+
+         // standby
+         bfs::path                       source_file;
+         uint64_t                        read_pos = 0;
+         std::chrono::milliseconds       poll_interval{100};
+         std::unique_ptr<boost::asio::steady_timer> poll_timer;
+
+         std::vector<char>               buffer;
+
+         /// @return the end of the last complete entry of the log at path
+         static uint64_t complete_end( const bfs::path& path ) {
+            std::ifstream in( path.generic_string(), std::ios::binary );
+            const uint64_t file_size = bfs::file_size( path );
+            uint64_t end = 0;
+            uint32_t size = 0;
+            while( end + sizeof(size) <= file_size && in.seekg( end ).read( reinterpret_cast<char*>(&size), sizeof(size) ) &&
+                   end + sizeof(size) + size <= file_size ) {
+               end += sizeof(size) + size;
+            }
+            return end;
+         }
+
+         void open_log() {
+            if( bfs::exists( log_file ) ) {
+               // a crash can leave an entry half written, the entries appended from now on have to follow a complete one
+               const uint64_t end = complete_end( log_file );
+               if( end != bfs::file_size( log_file ) ) {
+                  wlog( "cutting off the incomplete entry at the end of ${f}", ("f", log_file.generic_string()) );
+                  bfs::resize_file( log_file, end );
+               }
+            }
+            out.open( log_file.generic_string(), std::ios::binary | std::ios::app );
+            ROXE_ASSERT( out.good(), plugin_config_exception, "unable to open ${f}", ("f", log_file.generic_string()) );
+         }
+
+         void on_accepted_block( const block_state_ptr& bsp ) {
+            auto delta = chain_plug->chain().get_state_delta( bsp );
+            if( !delta )
+               return;
+            const state_delta_entry entry{ bsp->block, std::move( *delta ) };
+            buffer.resize( fc::raw::pack_size( entry ) );
+            fc::datastream<char*> ds( buffer.data(), buffer.size() );
+            fc::raw::pack( ds, entry );
+
+            const uint32_t size = buffer.size();
+            out.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+            out.write( buffer.data(), buffer.size() );
+            out.flush();
+            if( !out.good() )
+               elog( "failed to append the state delta of block ${n} to ${f}", ("n", bsp->block_num)("f", log_file.generic_string()) );
+         }
+
+         /// @return whether there are more entries to read
+         bool read_entries() {
+            controller& chain = chain_plug->chain();
+            std::ifstream in( source_file.generic_string(), std::ios::binary );
+            if( !in )
+               return false; // the primary has not written anything yet
+            in.seekg( 0, std::ios::end );
+            if( uint64_t(in.tellg()) < read_pos ) {
+               // entries already applied are skipped, so a log started over is read from its start
+               wlog( "${f} is shorter than what was read from it, reading it from the start", ("f", source_file.generic_string()) );
+               read_pos = 0;
+            }
+            in.seekg( read_pos );
+
+            for( uint32_t i = 0; i < max_entries_per_poll; ++i ) {
+               uint32_t size = 0;
+               if( !in.read( reinterpret_cast<char*>(&size), sizeof(size) ) )
+                  return false;
+               buffer.resize( size );
+               if( !in.read( buffer.data(), size ) )
+                  return false; // the primary is still writing it
+
+               state_delta_entry entry;
+               fc::datastream<const char*> ds( buffer.data(), buffer.size() );
+               fc::raw::unpack( ds, entry );
+               chain.push_state_delta( entry.block, entry.delta );
+               read_pos += sizeof(size) + size;
+               if( !chain.is_standby() )
+                  return false;
+            }
+            return true;
+         }
+
+         void schedule_poll( std::chrono::milliseconds delay ) {
+            poll_timer->expires_from_now( delay );
+            poll_timer->async_wait( app().get_priority_queue().wrap( priority::medium, [this]( const boost::system::error_code& ec ) {
+               if( ec ) return;
+               if( !chain_plug->chain().is_standby() ) {
+                  ilog( "standby promoted, stopped following ${f}", ("f", source_file.generic_string()) );
+                  return;
+               }
+               bool more = false;
+               try {
+                  more = read_entries();
+               } catch( const fc::exception& e ) {
+                  // applying the entries after a failed one would not link up, the standby stays at its head
+                  elog( "standby stopped following ${f} at block ${n}: ${e}",
+                        ("f", source_file.generic_string())("n", chain_plug->chain().head_block_num())("e", e.to_detail_string()) );
+                  return;
+               }
+               schedule_poll( more ? std::chrono::milliseconds( 0 ) : poll_interval );
+            } ) );
+         }
+   };
+
+   state_delta_plugin::state_delta_plugin()
+   :my(std::make_shared<state_delta_plugin_impl>()) {
+   }
+
+   state_delta_plugin::~state_delta_plugin() {
+   }
+
+   void state_delta_plugin::set_program_options(options_description& cli, options_description& cfg) {
+      cfg.add_options()
+            ("state-delta-log-dir", bpo::value<bfs::path>(),
+             "Append the state delta of every accepted block to state-deltas.log in this directory (absolute path or relative to "
+             "application data dir), for standbys to follow. Blocks of an irreversible replay have no delta.")
+            ("state-delta-standby-of", bpo::value<bfs::path>(),
+             "The state-delta-log-dir of the primary which this node, run with state-delta-standby, follows. The standby has to start "
+             "from the state of the primary at a block the log continues from, e.g. from the same snapshot.")
+            ("state-delta-poll-ms", bpo::value<uint32_t>()->default_value(100),
+             "How often a standby reads the new entries of the log of its primary.")
+            ;
+   }
+
+   void state_delta_plugin::plugin_initialize(const variables_map& options) {
+      try {
+         my->chain_plug = app().find_plugin<chain_plugin>();
+         ROXE_ASSERT( my->chain_plug, chain::missing_chain_plugin_exception, "" );
+         auto& chain = my->chain_plug->chain();
+
+         if( options.count( "state-delta-log-dir" ) ) {
+            auto dir = options.at( "state-delta-log-dir" ).as<bfs::path>();
+            if( dir.is_relative() )
+               dir = app().data_dir() / dir;
+            if( !fc::is_directory( dir ) )
+               fc::create_directories( dir );
+            my->log_file = dir / state_delta_plugin_impl::log_file_name;
+            my->open_log();
+            my->accepted_block_connection.emplace(
+                  chain.accepted_block.connect( [&]( const block_state_ptr& bsp ) {
+                     my->on_accepted_block( bsp );
+                  } ));
+         }
+
+         if( options.count( "state-delta-standby-of" ) ) {
+            ROXE_ASSERT( chain.is_standby(), plugin_config_exception, "state-delta-standby-of requires state-delta-standby" );
+            auto dir = options.at( "state-delta-standby-of" ).as<bfs::path>();
+            if( dir.is_relative() )
+               dir = app().data_dir() / dir;
+            my->source_file = dir / state_delta_plugin_impl::log_file_name;
+            ROXE_ASSERT( my->source_file != my->log_file, plugin_config_exception,
+                         "a standby can not follow the state delta log it writes" );
+            my->poll_interval = std::chrono::milliseconds( std::max<uint32_t>( options.at( "state-delta-poll-ms" ).as<uint32_t>(), 1 ) );
+         } else {
+            ROXE_ASSERT( !chain.is_standby(), plugin_config_exception, "state-delta-standby requires state-delta-standby-of" );
+         }
+      } FC_LOG_AND_RETHROW()
+   }
+
+   void state_delta_plugin::plugin_startup() {
+      if( !my->source_file.empty() ) {
+         ilog( "standby following ${f} from block ${n}",
+               ("f", my->source_file.generic_string())("n", my->chain_plug->chain().head_block_num()) );
+         my->poll_timer = std::make_unique<boost::asio::steady_timer>( app().get_io_service() );
+         my->schedule_poll( std::chrono::milliseconds( 0 ) );
+      }
+   }
+
+   void state_delta_plugin::plugin_shutdown() {
+      if( my->poll_timer )
+         my->poll_timer->cancel();
+      my->accepted_block_connection.reset();
+      if( my->out.is_open() )
+         my->out.close();
+   }
+
+} // namespace roxe
@@ -5,8 +5,10 @@
 #pragma once
 
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <fstream>
 #include <stdint.h>
+#include <sys/mman.h>
 
 #include <roxe/chain/block_header.hpp>
 #include <roxe/chain/exceptions.hpp>
@@ -29,13 +31,25 @@ namespace roxe {
  * each entry:
  *    state_history_log_header
  *    payload
+ *
+ * reads go through a memory mapping of the index, and of the log when enabled, which is remapped when the files
+ * grew and dropped when they are truncated
+ *
+ * the payload of a version 0 entry is the uint32 size of the zlib compressed data followed by that data, the payload
+ * of a version 1 entry starts with the state_history_codec of the data, so a log may hold entries of both versions
  */
 
 inline uint64_t       ship_magic(uint32_t version) { return N(ship) | version; }
 inline bool           is_ship(uint64_t magic) { return (magic & 0xffff'ffff'0000'0000) == N(ship); }
 inline uint32_t       get_ship_version(uint64_t magic) { return magic; }
-inline bool           is_ship_supported_version(uint64_t magic) { return get_ship_version(magic) == 0; }
+inline bool           is_ship_supported_version(uint64_t magic) { return get_ship_version(magic) <= 1; }
 static const uint32_t ship_current_version = 0;
+static const uint32_t ship_codec_version   = 1; ///< entries whose payload names its codec
+
+enum class state_history_codec : uint8_t {
+   none = 0,
+   zlib = 1,
+};
 
 struct state_history_log_header {
    uint64_t             magic        = ship_magic(ship_current_version);
@@ -56,6 +70,10 @@ class state_history_log {
    uint32_t             _begin_block = 0;
    uint32_t             _end_block   = 0;
    chain::block_id_type last_block_id;
+   bool                 map_log      = false;
+
+   boost::iostreams::mapped_file_source index_map;
+   boost::iostreams::mapped_file_source log_map;
 
  public:
    state_history_log(const char* const name, std::string log_filename, std::string index_filename)
@@ -69,6 +87,13 @@ class state_history_log {
    uint32_t begin_block() const { return _begin_block; }
    uint32_t end_block() const { return _end_block; }
 
+   /// also reads the log through a memory mapping instead of seeking in it
+   void set_map_log(bool m) {
+      map_log = m;
+      if (!m && log_map.is_open())
+         log_map.close();
+   }
+
    void read_header(state_history_log_header& header, bool assert_version = true) {
       char bytes[state_history_log_header_serial_size];
       log.read(bytes, sizeof(bytes));
@@ -119,6 +144,9 @@ class state_history_log {
 
       index.seekg(0, std::ios_base::end);
       index.write((char*)&pos, sizeof(pos));
+      // the mappings only see what was flushed
+      log.flush();
+      index.flush();
       if (_begin_block == _end_block)
          _begin_block = block_num;
       _end_block    = block_num + 1;
@@ -136,11 +164,72 @@ class state_history_log {
 
    chain::block_id_type get_block_id(uint32_t block_num) {
       state_history_log_header header;
+      const char*              payload = nullptr;
+      if (mapped_entry(block_num, header, payload))
+         return header.block_id;
       get_entry(block_num, header);
       return header.block_id;
    }
 
+   /// copies the header and the payload of the entry of block_num
+   void read_entry(uint32_t block_num, state_history_log_header& header, chain::bytes& payload) {
+      const char* data = nullptr;
+      if (mapped_entry(block_num, header, data)) {
+         payload.assign(data, data + header.payload_size);
+         return;
+      }
+      auto& stream = get_entry(block_num, header);
+      payload.resize(header.payload_size);
+      if (!payload.empty())
+         stream.read(payload.data(), payload.size());
+   }
+
+   /// asks the kernel to read the entries of blocks [first, last) of a mapped log ahead
+   void will_need(uint32_t first, uint32_t last) {
+      if (!map_log || first < _begin_block || first >= last || last > _end_block)
+         return;
+      uint64_t begin = get_pos(first);
+      uint64_t end   = last == _end_block ? boost::filesystem::file_size(log_filename) : get_pos(last);
+      if (!map_file(log_map, log_filename, end))
+         return;
+      const uint64_t page = sysconf(_SC_PAGESIZE);
+      begin -= begin % page;
+      madvise(const_cast<char*>(log_map.data()) + begin, end - begin, MADV_WILLNEED);
+   }
+
  private:
+   /// maps filename if m does not cover its first size bytes yet
+   /// @return false if the file is smaller than size
+   static bool map_file(boost::iostreams::mapped_file_source& m, const std::string& filename, uint64_t size) {
+      if (m.is_open() && m.size() >= size)
+         return true;
+      if (m.is_open())
+         m.close();
+      const uint64_t file_size = boost::filesystem::file_size(filename);
+      if (!file_size || file_size < size)
+         return false;
+      m.open(filename, file_size);
+      return m.is_open();
+   }
+
+   bool mapped_entry(uint32_t block_num, state_history_log_header& header, const char*& payload) {
+      if (!map_log)
+         return false;
+      ROXE_ASSERT(block_num >= _begin_block && block_num < _end_block, chain::plugin_exception,
+                 "read non-existing block in ${name}.log", ("name", name));
+      const uint64_t pos = get_pos(block_num);
+      if (!map_file(log_map, log_filename, pos + state_history_log_header_serial_size))
+         return false;
+      fc::datastream<const char*> ds(log_map.data() + pos, state_history_log_header_serial_size);
+      fc::raw::unpack(ds, header);
+      ROXE_ASSERT(is_ship(header.magic) && is_ship_supported_version(header.magic), chain::plugin_exception,
+                 "corrupt ${name}.log (0)", ("name", name));
+      if (!map_file(log_map, log_filename, pos + state_history_log_header_serial_size + header.payload_size))
+         return false;
+      payload = log_map.data() + pos + state_history_log_header_serial_size;
+      return true;
+   }
+
    bool get_last_block(uint64_t size) {
       state_history_log_header header;
       uint64_t                 suffix;
@@ -261,8 +350,13 @@ class state_history_log {
    }
 
    uint64_t get_pos(uint32_t block_num) {
-      uint64_t pos;
-      index.seekg((block_num - _begin_block) * sizeof(pos));
+      uint64_t       pos;
+      const uint64_t offset = uint64_t(block_num - _begin_block) * sizeof(pos);
+      if (map_file(index_map, index_filename, offset + sizeof(pos))) {
+         memcpy(&pos, index_map.data() + offset, sizeof(pos));
+         return pos;
+      }
+      index.seekg(offset);
       index.read((char*)&pos, sizeof(pos));
       return pos;
    }
@@ -271,6 +365,12 @@ class state_history_log {
       log.flush();
       index.flush();
       uint64_t num_removed = 0;
+      uint64_t pos         = block_num <= _begin_block ? 0 : get_pos(block_num);
+      // pages past the new end of the files must not be read through the mappings
+      if (log_map.is_open())
+         log_map.close();
+      if (index_map.is_open())
+         index_map.close();
       if (block_num <= _begin_block) {
          num_removed = _end_block - _begin_block;
          log.seekg(0);
@@ -279,8 +379,7 @@ class state_history_log {
          boost::filesystem::resize_file(index_filename, 0);
          _begin_block = _end_block = 0;
       } else {
-         num_removed  = _end_block - block_num;
-         uint64_t pos = get_pos(block_num);
+         num_removed = _end_block - block_num;
          log.seekg(0);
          index.seekg(0);
          boost::filesystem::resize_file(log_filename, pos);
@@ -102,6 +102,18 @@ struct get_blocks_request_v0 {
    bool                        fetch_deltas           = false;
 };
 
+/// get_blocks_request_v0 sending only what the filters select; an empty filter selects everything
+struct get_blocks_request_v1 : get_blocks_request_v0 {
+   std::vector<chain::name> filter_contracts = {}; ///< contract rows of, and transactions with an action of, these
+   std::vector<chain::name> filter_tables    = {}; ///< contract rows of these tables
+   std::vector<chain::name> filter_actions   = {}; ///< transactions with an action of these names
+   std::vector<std::string> filter_deltas    = {}; ///< table deltas of these names, e.g. contract_row or account
+
+   bool is_filtered() const {
+      return !filter_contracts.empty() || !filter_tables.empty() || !filter_actions.empty() || !filter_deltas.empty();
+   }
+};
+
 struct get_blocks_ack_request_v0 {
    uint32_t num_messages = 0;
 };
@@ -116,7 +128,8 @@ struct get_blocks_result_v0 {
    fc::optional<bytes>          deltas;
 };
 
-using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0>;
+using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0,
+                                         get_blocks_request_v1>;
 using state_result  = fc::static_variant<get_status_result_v0, get_blocks_result_v0>;
 
 class state_history_plugin : public plugin<state_history_plugin> {
@@ -144,5 +157,6 @@ FC_REFLECT(roxe::block_position, (block_num)(block_id));
 FC_REFLECT_EMPTY(roxe::get_status_request_v0);
 FC_REFLECT(roxe::get_status_result_v0, (head)(last_irreversible)(trace_begin_block)(trace_end_block)(chain_state_begin_block)(chain_state_end_block));
 FC_REFLECT(roxe::get_blocks_request_v0, (start_block_num)(end_block_num)(max_messages_in_flight)(have_positions)(irreversible_only)(fetch_block)(fetch_traces)(fetch_deltas));
+FC_REFLECT_DERIVED(roxe::get_blocks_request_v1, (roxe::get_blocks_request_v0), (filter_contracts)(filter_tables)(filter_actions)(filter_deltas));
 FC_REFLECT(roxe::get_blocks_ack_request_v0, (num_messages));
 // clang-format on
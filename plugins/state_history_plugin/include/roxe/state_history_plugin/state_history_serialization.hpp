@@ -395,9 +395,10 @@ datastream<ST>& operator<<(datastream<ST>& ds, const history_serial_wrapper<roxe
       auto&       index  = obj.db.get_index<roxe::chain::permission_index>();
       const auto* parent = index.find(obj.obj.parent);
       if (!parent) {
-         auto& undo = index.stack().back();
-         auto  it   = undo.removed_values.find(obj.obj.parent);
-         ROXE_ASSERT(it != undo.removed_values.end(), roxe::chain::plugin_exception,
+         auto* undo = index.head_undo_state();
+         ROXE_ASSERT(undo, roxe::chain::plugin_exception, "can not find parent of permission_object");
+         auto  it   = undo->removed_values.find(obj.obj.parent);
+         ROXE_ASSERT(it != undo->removed_values.end(), roxe::chain::plugin_exception,
                     "can not find parent of permission_object");
          parent = &it->second;
       }
@@ -4,8 +4,11 @@
  */
 
 #include <roxe/chain/config.hpp>
+#include <roxe/chain/thread_utils.hpp>
 #include <roxe/state_history_plugin/state_history_log.hpp>
 #include <roxe/state_history_plugin/state_history_serialization.hpp>
+#include <fc/log/logger_config.hpp>
+#include <fc/metrics.hpp>
 
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/ip/host_name.hpp>
@@ -18,6 +21,12 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/signals2/connection.hpp>
 
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+
 using tcp    = boost::asio::ip::tcp;
 namespace ws = boost::beast::websocket;
 
@@ -43,10 +52,10 @@ auto catch_and_log(F f) {
 }
 
 namespace bio = boost::iostreams;
-static bytes zlib_compress_bytes(bytes in) {
+static bytes zlib_compress_bytes(bytes in, int level = bio::zlib::default_compression) {
    bytes                  out;
    bio::filtering_ostream comp;
-   comp.push(bio::zlib_compressor(bio::zlib::default_compression));
+   comp.push(bio::zlib_compressor(level));
    comp.push(bio::back_inserter(out));
    bio::write(comp, in.data(), in.size());
    bio::close(comp);
@@ -63,6 +72,142 @@ static bytes zlib_decompress(const bytes& in) {
    return out;
 }
 
+/**
+ * Blocks and decompressed log entries recently sent, shared by all sessions so that a block many clients follow is
+ * read and decompressed once. The entries of a block number are dropped when another block takes its place after a
+ * fork; the least recently used are evicted once max_bytes are held, 0 disables the cache. Thread safe.
+ */
+class shared_entry_cache {
+ public:
+   enum entry_kind : uint8_t { block_entry, traces_entry, deltas_entry };
+   using value_ptr = std::shared_ptr<const bytes>;
+
+   size_t max_bytes = 0;
+
+   value_ptr get(entry_kind kind, uint32_t block_num) {
+      std::lock_guard<std::mutex> g(mtx);
+      auto it = entries.find({block_num, kind});
+      if (it == entries.end())
+         return {};
+      lru.splice(lru.begin(), lru, it->second.lru_position);
+      return it->second.value;
+   }
+
+   void put(entry_kind kind, uint32_t block_num, value_ptr value) {
+      if (!max_bytes || value->size() > max_bytes)
+         return;
+      std::lock_guard<std::mutex> g(mtx);
+      const key k{block_num, kind};
+      if (entries.count(k))
+         return;
+      used_bytes += value->size();
+      lru.push_front(k);
+      entries.emplace(k, entry{std::move(value), lru.begin()});
+      while (used_bytes > max_bytes)
+         erase(entries.find(lru.back()));
+   }
+
+   /// drops the entries of block_num and all later blocks
+   void erase_from(uint32_t block_num) {
+      std::lock_guard<std::mutex> g(mtx);
+      for (auto it = entries.lower_bound({block_num, block_entry}); it != entries.end();)
+         erase(it++);
+   }
+
+ private:
+   using key = std::pair<uint32_t, entry_kind>;
+   struct entry {
+      value_ptr                  value;
+      std::list<key>::iterator   lru_position;
+   };
+
+   void erase(std::map<key, entry>::iterator it) {
+      used_bytes -= it->second.value->size();
+      lru.erase(it->second.lru_position);
+      entries.erase(it);
+   }
+
+   std::mutex           mtx;
+   std::map<key, entry> entries;
+   std::list<key>       lru; ///< most recently used first
+   size_t               used_bytes = 0;
+};
+
+template <typename T>
+static bool filter_allows(const std::vector<T>& filter, const T& value) {
+   return filter.empty() || std::find(filter.begin(), filter.end(), value) != filter.end();
+}
+
+/// @return the table deltas of deltas selected by the filters of req
+static bytes filter_deltas(const bytes& deltas, const get_blocks_request_v1& req) {
+   fc::datastream<const char*> in(deltas.data(), deltas.size());
+   fc::unsigned_int            num_deltas;
+   fc::raw::unpack(in, num_deltas);
+   std::vector<table_delta> result;
+   for (uint32_t i = 0; i < num_deltas.value; ++i) {
+      table_delta delta;
+      fc::raw::unpack(in, delta.struct_version);
+      fc::raw::unpack(in, delta.name);
+      std::vector<std::pair<bool, bytes>> rows;
+      fc::raw::unpack(in, rows);
+      if (!filter_allows(req.filter_deltas, delta.name))
+         continue;
+      if (delta.name.compare(0, 9, "contract_") == 0 && (!req.filter_contracts.empty() || !req.filter_tables.empty())) {
+         // the rows of all contract tables start with their code, scope and table
+         rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                   [&](const std::pair<bool, bytes>& row) {
+                                      fc::datastream<const char*> ds(row.second.data(), row.second.size());
+                                      fc::unsigned_int            version;
+                                      uint64_t                    code, scope, table;
+                                      fc::raw::unpack(ds, version);
+                                      fc::raw::unpack(ds, code);
+                                      fc::raw::unpack(ds, scope);
+                                      fc::raw::unpack(ds, table);
+                                      return !filter_allows(req.filter_contracts, name(code)) ||
+                                             !filter_allows(req.filter_tables, name(table));
+                                   }),
+                    rows.end());
+      }
+      if (rows.empty())
+         continue;
+      delta.rows.obj = std::move(rows);
+      result.push_back(std::move(delta));
+   }
+   return fc::raw::pack(result);
+}
+
+/// @return the transaction traces of traces with an action selected by the filters of req, copied as they are
+static bytes filter_traces(const bytes& traces, const get_blocks_request_v1& req, const abi_serializer& history_abi) {
+   if (req.filter_contracts.empty() && req.filter_actions.empty())
+      return traces;
+   fc::datastream<const char*> in(traces.data(), traces.size());
+   fc::unsigned_int            num_traces;
+   fc::raw::unpack(in, num_traces);
+   std::vector<std::pair<const char*, const char*>> selected;
+   for (uint32_t i = 0; i < num_traces.value; ++i) {
+      const char* begin = in.pos();
+      auto        trace = history_abi.binary_to_variant("transaction_trace", in, fc::microseconds::maximum());
+      for (const auto& at : trace[1]["action_traces"].get_array()) {
+         const auto& act = at[1]["act"];
+         if ((filter_allows(req.filter_contracts, act["account"].as<name>()) ||
+              filter_allows(req.filter_contracts, at[1]["receiver"].as<name>())) &&
+             filter_allows(req.filter_actions, act["name"].as<name>())) {
+            selected.emplace_back(begin, in.pos());
+            break;
+         }
+      }
+   }
+   size_t size = fc::raw::pack_size(fc::unsigned_int(selected.size()));
+   for (const auto& t : selected)
+      size += t.second - t.first;
+   bytes                 result(size);
+   fc::datastream<char*> out(result.data(), result.size());
+   fc::raw::pack(out, fc::unsigned_int(selected.size()));
+   for (const auto& t : selected)
+      out.write(t.first, t.second - t.first);
+   return result;
+}
+
 template <typename T>
 bool include_delta(const T& old, const T& curr) {
    return true;
@@ -115,11 +260,23 @@ bool include_delta(const roxe::chain::protocol_state_object& old, const roxe::ch
    return old.activated_protocol_features != curr.activated_protocol_features;
 }
 
+/// what state_history_plugin reports through metrics_plugin
+struct state_history_metrics {
+   fc::metrics::registry& r = fc::metrics::registry::instance();
+   fc::metrics::gauge&    sessions = r.add_gauge("roxe_state_history_sessions", "Connected state history clients");
+   fc::metrics::counter&  sent_messages = r.add_counter("roxe_state_history_sent_messages_total", "Messages sent to state history clients");
+   fc::metrics::counter&  sent_bytes = r.add_counter("roxe_state_history_sent_bytes_total", "Bytes sent to state history clients");
+   fc::metrics::counter&  blocks_written = r.add_counter("roxe_state_history_blocks_written_total", "Blocks written to the state history logs");
+   fc::metrics::gauge&    write_queue = r.add_gauge("roxe_state_history_write_queue_blocks", "Blocks waiting for the writer thread");
+};
+
 struct state_history_plugin_impl : std::enable_shared_from_this<state_history_plugin_impl> {
    chain_plugin*                                              chain_plug = nullptr;
    fc::optional<state_history_log>                            trace_log;
    fc::optional<state_history_log>                            chain_state_log;
    bool                                                       trace_debug_mode = false;
+   state_history_codec                                        codec = state_history_codec::zlib;
+   int                                                        compression_level = bio::zlib::default_compression;
    bool                                                       stopping = false;
    fc::optional<scoped_connection>                            applied_transaction_connection;
    fc::optional<scoped_connection>                            accepted_block_connection;
@@ -128,36 +285,130 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    std::unique_ptr<tcp::acceptor>                             acceptor;
    std::map<transaction_id_type, augmented_transaction_trace> cached_traces;
    fc::optional<augmented_transaction_trace>                  onblock_trace;
+   state_history_metrics                                      metrics;
+
+   /// what is stored for a block, captured on the main thread; packing the whole and compressing it is left
+   /// to the writer thread
+   struct pending_entry {
+      uint32_t                                                block_num = 0;
+      block_id_type                                           block_id;
+      block_id_type                                           previous;
+      fc::optional<std::vector<augmented_transaction_trace>> traces;
+      fc::optional<std::vector<table_delta>>                 deltas;
+   };
+
+   std::mutex                                                 log_mtx; ///< guards both logs, written by the writer thread
+   shared_entry_cache                                         entry_cache;
+   fc::optional<abi_serializer>                               history_abi; ///< to find the actions in traces
+   fc::optional<named_thread_pool>                            read_thread_pool;
+   uint32_t                                                   prefetch_blocks = 0;
+   uint16_t                                                   initial_state_threads = 4;
+
+   const abi_serializer& get_history_abi() {
+      if (!history_abi)
+         history_abi.emplace(fc::json::from_string(state_history_plugin_abi).as<abi_def>(), fc::microseconds::maximum());
+      return *history_abi;
+   }
+   std::mutex                                                 write_queue_mtx;
+   std::condition_variable                                    write_queue_cv;
+   std::deque<pending_entry>                                  write_queue;
+   uint32_t                                                   max_write_queue_size = 0; ///< 0 writes on the main thread
+   bool                                                       writer_stopping = false;
+   std::thread                                                writer;
+   uint32_t                                                   unwritten_blocks = 0; ///< queued, main thread only
+   uint32_t                                                   last_written_block = 0;
+   bool                                                       chain_state_captured = false; ///< the log is no longer empty
+
+   /// @return the uncompressed entry of block_num in log, null if there is none
+   shared_entry_cache::value_ptr load_log_entry(state_history_log& log, uint32_t block_num) {
+      const auto kind = &log == &*trace_log ? shared_entry_cache::traces_entry : shared_entry_cache::deltas_entry;
+      if (auto cached = entry_cache.get(kind, block_num))
+         return cached;
+      state_history_log_header header;
+      bytes                    payload;
+      {
+         std::lock_guard<std::mutex> g(log_mtx);
+         if (block_num < log.begin_block() || block_num >= log.end_block())
+            return {};
+         log.read_entry(block_num, header, payload);
+      }
+
+      fc::datastream<const char*> ds(payload.data(), payload.size());
+      auto                        entry_codec = state_history_codec::zlib;
+      if (get_ship_version(header.magic) >= ship_codec_version)
+         fc::raw::unpack(ds, entry_codec);
+      uint32_t s;
+      fc::raw::unpack(ds, s);
+      ROXE_ASSERT(s <= ds.remaining(), plugin_exception, "corrupt entry of block ${b}", ("b", block_num));
+      bytes data(ds.pos(), ds.pos() + s);
+      shared_entry_cache::value_ptr result;
+      switch (entry_codec) {
+         case state_history_codec::none: result = std::make_shared<const bytes>(std::move(data)); break;
+         case state_history_codec::zlib: result = std::make_shared<const bytes>(zlib_decompress(data)); break;
+         default:
+            ROXE_ASSERT(false, plugin_exception, "unknown codec ${c} of block ${b}",
+                        ("c", (uint32_t)entry_codec)("b", block_num));
+      }
+
+      // the writer may have replaced the entry after a fork while it was decompressed
+      std::lock_guard<std::mutex> g(log_mtx);
+      if (block_num >= log.begin_block() && block_num < log.end_block() && log.get_block_id(block_num) == header.block_id)
+         entry_cache.put(kind, block_num, result);
+      return result;
+   }
 
    void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result) {
-      if (block_num < log.begin_block() || block_num >= log.end_block())
+      if (auto entry = load_log_entry(log, block_num))
+         result = *entry;
+   }
+
+   /// reads ahead and decompresses the entries of [first, last) on the read threads, into the entry cache
+   void prefetch_log_entries(uint32_t first, uint32_t last, bool traces, bool deltas) {
+      if (!read_thread_pool || !entry_cache.max_bytes)
          return;
-      state_history_log_header header;
-      auto&                    stream = log.get_entry(block_num, header);
-      uint32_t                 s;
-      stream.read((char*)&s, sizeof(s));
-      bytes compressed(s);
-      if (s)
-         stream.read(compressed.data(), s);
-      result = zlib_decompress(compressed);
+      {
+         std::lock_guard<std::mutex> g(log_mtx);
+         if (traces && trace_log)
+            trace_log->will_need(first, std::min(last, trace_log->end_block()));
+         if (deltas && chain_state_log)
+            chain_state_log->will_need(first, std::min(last, chain_state_log->end_block()));
+      }
+      for (uint32_t block_num = first; block_num < last; ++block_num) {
+         boost::asio::post(read_thread_pool->get_executor(), [self = shared_from_this(), block_num, traces, deltas]() {
+            catch_and_log([&] {
+               if (traces && self->trace_log)
+                  self->load_log_entry(*self->trace_log, block_num);
+               if (deltas && self->chain_state_log)
+                  self->load_log_entry(*self->chain_state_log, block_num);
+            });
+         });
+      }
    }
 
    void get_block(uint32_t block_num, fc::optional<bytes>& result) {
-      chain::signed_block_ptr p;
+      if (auto cached = entry_cache.get(shared_entry_cache::block_entry, block_num)) {
+         result = *cached;
+         return;
+      }
+      bytes packed;
       try {
-         p = chain_plug->chain().fetch_block_by_number(block_num);
+         packed = chain_plug->chain().fetch_serialized_block_by_number(block_num);
       } catch (...) {
          return;
       }
-      if (p)
-         result = fc::raw::pack(*p);
+      if (!packed.empty()) {
+         entry_cache.put(shared_entry_cache::block_entry, block_num, std::make_shared<const bytes>(packed));
+         result = std::move(packed);
+      }
    }
 
    fc::optional<chain::block_id_type> get_block_id(uint32_t block_num) {
+      std::unique_lock<std::mutex> g(log_mtx);
       if (trace_log && block_num >= trace_log->begin_block() && block_num < trace_log->end_block())
          return trace_log->get_block_id(block_num);
       if (chain_state_log && block_num >= chain_state_log->begin_block() && block_num < chain_state_log->end_block())
          return chain_state_log->get_block_id(block_num);
+      g.unlock();
       try {
          auto block = chain_plug->chain().fetch_block_by_number(block_num);
          if (block)
@@ -173,7 +424,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       bool                                       sending  = false;
       bool                                       sent_abi = false;
       std::vector<std::vector<char>>             send_queue;
-      fc::optional<get_blocks_request_v0>        current_request;
+      fc::optional<get_blocks_request_v1>        current_request;
+      uint32_t                                   prefetched_until = 0; ///< blocks before it were prefetched
       bool                                       need_to_send_update = false;
 
       session(std::shared_ptr<state_history_plugin_impl> plugin)
@@ -233,6 +485,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
              boost::asio::buffer(send_queue[0]),
              [self = shared_from_this()](boost::system::error_code ec, size_t) {
                 self->callback(ec, "async_write", [self] {
+                   self->plugin->metrics.sent_messages.inc();
+                   self->plugin->metrics.sent_bytes.inc(self->send_queue[0].size());
                    self->send_queue.erase(self->send_queue.begin());
                    self->sending = false;
                    self->send();
@@ -246,6 +500,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          get_status_result_v0 result;
          result.head              = {chain.head_block_num(), chain.head_block_id()};
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
+         std::lock_guard<std::mutex> g(plugin->log_mtx);
          if (plugin->trace_log) {
             result.trace_begin_block = plugin->trace_log->begin_block();
             result.trace_end_block   = plugin->trace_log->end_block();
@@ -258,6 +513,12 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
 
       void operator()(get_blocks_request_v0& req) {
+         get_blocks_request_v1 v1;
+         static_cast<get_blocks_request_v0&>(v1) = req;
+         (*this)(v1);
+      }
+
+      void operator()(get_blocks_request_v1& req) {
          for (auto& cp : req.have_positions) {
             if (req.start_block_num <= cp.block_num)
                continue;
@@ -266,7 +527,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                req.start_block_num = std::min(req.start_block_num, cp.block_num);
          }
          req.have_positions.clear();
-         current_request = req;
+         current_request  = req;
+         prefetched_until = 0;
          send_update(true);
       }
 
@@ -289,6 +551,9 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
          uint32_t current =
              current_request->irreversible_only ? result.last_irreversible.block_num : result.head.block_num;
+         // blocks still queued for the writer thread are sent once they are stored
+         if (plugin->unwritten_blocks)
+            current = std::min(current, plugin->last_written_block);
          if (current_request->start_block_num <= current &&
              current_request->start_block_num < current_request->end_block_num) {
             auto block_id = plugin->get_block_id(current_request->start_block_num);
@@ -299,10 +564,17 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                   result.prev_block = block_position{current_request->start_block_num - 1, *prev_block_id};
                if (current_request->fetch_block)
                   plugin->get_block(current_request->start_block_num, result.block);
+               prefetch();
                if (current_request->fetch_traces && plugin->trace_log)
                   plugin->get_log_entry(*plugin->trace_log, current_request->start_block_num, result.traces);
                if (current_request->fetch_deltas && plugin->chain_state_log)
                   plugin->get_log_entry(*plugin->chain_state_log, current_request->start_block_num, result.deltas);
+               if (current_request->is_filtered()) {
+                  if (result.traces)
+                     result.traces = filter_traces(*result.traces, *current_request, plugin->get_history_abi());
+                  if (result.deltas)
+                     result.deltas = filter_deltas(*result.deltas, *current_request);
+               }
             }
             ++current_request->start_block_num;
          }
@@ -312,6 +584,21 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                                current_request->start_block_num < current_request->end_block_num;
       }
 
+      /// keeps the entries of the next blocks of a backfill decompressed ahead of sending them
+      void prefetch() {
+         if (!plugin->prefetch_blocks || (!current_request->fetch_traces && !current_request->fetch_deltas))
+            return;
+         const uint32_t next = current_request->start_block_num + 1;
+         if (prefetched_until > next + plugin->prefetch_blocks / 2)
+            return;
+         const uint32_t first = std::max(next, prefetched_until);
+         const uint32_t last  = std::min<uint64_t>(uint64_t(next) + plugin->prefetch_blocks, current_request->end_block_num);
+         if (first >= last)
+            return;
+         plugin->prefetch_log_entries(first, last, current_request->fetch_traces, current_request->fetch_deltas);
+         prefetched_until = last;
+      }
+
       template <typename F>
       void catch_and_close(F f) {
          try {
@@ -351,6 +638,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       void close() {
          socket_stream->next_layer().close();
          plugin->sessions.erase(this);
+         plugin->metrics.sessions.set(plugin->sessions.size());
       }
    };
    std::map<session*, std::shared_ptr<session>> sessions;
@@ -392,6 +680,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          catch_and_log([&] {
             auto s            = std::make_shared<session>(self);
             sessions[s.get()] = s;
+            metrics.sessions.set(sessions.size());
             s->start(std::move(*socket));
          });
          catch_and_log([&] { do_accept(); });
@@ -422,22 +711,115 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    void on_accepted_block(const block_state_ptr& block_state) {
-      store_traces(block_state);
-      store_chain_state(block_state);
+      entry_cache.erase_from(block_state->block_num);
+      if (!trace_log && !chain_state_log)
+         return on_block_written(block_state->block_num);
+
+      pending_entry entry;
+      entry.block_num = block_state->block_num;
+      entry.block_id  = block_state->block->id();
+      entry.previous  = block_state->block->previous;
+      capture_traces(block_state, entry);
+      capture_chain_state(block_state, entry);
+      if (!writer.joinable()) {
+         store_entry(entry);
+         return on_block_written(entry.block_num);
+      }
+
+      ++unwritten_blocks;
+      std::unique_lock<std::mutex> g(write_queue_mtx);
+      write_queue_cv.wait(g, [&] { return write_queue.size() < max_write_queue_size; });
+      write_queue.push_back(std::move(entry));
+      metrics.write_queue.set(write_queue.size());
+      write_queue_cv.notify_all();
+   }
+
+   void on_block_written(uint32_t block_num) {
+      last_written_block = block_num;
+      metrics.blocks_written.inc();
       for (auto& s : sessions) {
          auto& p = s.second;
          if (p) {
-            if (p->current_request && block_state->block_num < p->current_request->start_block_num)
-               p->current_request->start_block_num = block_state->block_num;
+            if (p->current_request && block_num < p->current_request->start_block_num)
+               p->current_request->start_block_num = block_num;
             p->send_update(true);
          }
       }
    }
 
-   void store_traces(const block_state_ptr& block_state) {
+   /// writes the queued entries in order, the main thread only waits when the queue is full
+   void run_writer() {
+      fc::set_os_thread_name("ship-writer");
+      while (true) {
+         pending_entry entry;
+         {
+            std::unique_lock<std::mutex> g(write_queue_mtx);
+            write_queue_cv.wait(g, [&] { return writer_stopping || !write_queue.empty(); });
+            if (write_queue.empty())
+               return;
+            entry = std::move(write_queue.front());
+            write_queue.pop_front();
+            metrics.write_queue.set(write_queue.size());
+            write_queue_cv.notify_all();
+         }
+         catch_and_log([&] { store_entry(entry); });
+         app().post(priority::medium, [self = shared_from_this(), block_num = entry.block_num]() {
+            if (self->stopping)
+               return;
+            --self->unwritten_blocks;
+            self->on_block_written(block_num);
+         });
+      }
+   }
+
+   void stop_writer() {
+      if (!writer.joinable())
+         return;
+      {
+         std::lock_guard<std::mutex> g(write_queue_mtx);
+         writer_stopping = true;
+      }
+      write_queue_cv.notify_all();
+      writer.join();
+   }
+
+   template <typename T>
+   void store_log_entry(state_history_log& log, const char* what, const pending_entry& entry, const T& payload) {
+      auto bin = fc::raw::pack(payload);
+      if (codec == state_history_codec::zlib)
+         bin = zlib_compress_bytes(std::move(bin), compression_level);
+      ROXE_ASSERT(bin.size() == (uint32_t)bin.size(), plugin_exception, "${what} is too big", ("what", what));
+      // zlib entries keep the version readers without codec support understand
+      const bool with_codec = codec != state_history_codec::zlib;
+      state_history_log_header header{.magic        = ship_magic(with_codec ? ship_codec_version : ship_current_version),
+                                      .block_id     = entry.block_id,
+                                      .payload_size = (with_codec ? sizeof(codec) : 0) + sizeof(uint32_t) + bin.size()};
+      std::lock_guard<std::mutex> g(log_mtx);
+      log.write_entry(header, entry.previous, [&](auto& stream) {
+         if (with_codec)
+            stream.write((char*)&codec, sizeof(codec));
+         uint32_t s = (uint32_t)bin.size();
+         stream.write((char*)&s, sizeof(s));
+         if (!bin.empty())
+            stream.write(bin.data(), bin.size());
+      });
+      // a session may have read what this entry replaces after the block was accepted
+      entry_cache.erase_from(entry.block_num);
+   }
+
+   void store_entry(const pending_entry& entry) {
+      if (entry.traces) {
+         auto& db = chain_plug->chain().db();
+         store_log_entry(*trace_log, "traces", entry, make_history_context_wrapper(db, trace_debug_mode, *entry.traces));
+      }
+      if (entry.deltas)
+         store_log_entry(*chain_state_log, "deltas", entry, *entry.deltas);
+   }
+
+   void capture_traces(const block_state_ptr& block_state, pending_entry& entry) {
       if (!trace_log)
          return;
-      std::vector<augmented_transaction_trace> traces;
+      auto& traces = *(entry.traces = std::vector<augmented_transaction_trace>());
       if (onblock_trace)
          traces.push_back(*onblock_trace);
       for (auto& r : block_state->block->transactions) {
@@ -453,36 +835,30 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
       cached_traces.clear();
       onblock_trace.reset();
-
-      auto& db         = chain_plug->chain().db();
-      auto  traces_bin = zlib_compress_bytes(fc::raw::pack(make_history_context_wrapper(db, trace_debug_mode, traces)));
-      ROXE_ASSERT(traces_bin.size() == (uint32_t)traces_bin.size(), plugin_exception, "traces is too big");
-
-      state_history_log_header header{.magic        = ship_magic(ship_current_version),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + traces_bin.size()};
-      trace_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)traces_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!traces_bin.empty())
-            stream.write(traces_bin.data(), traces_bin.size());
-      });
    }
 
-   void store_chain_state(const block_state_ptr& block_state) {
+   /// the rows are packed here since they are only valid until the next block
+   void capture_chain_state(const block_state_ptr& block_state, pending_entry& entry) {
       if (!chain_state_log)
          return;
-      bool fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      bool fresh = false;
+      if (!chain_state_captured) {
+         std::lock_guard<std::mutex> g(log_mtx);
+         fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      }
+      chain_state_captured = true;
       if (fresh)
          ilog("Placing initial state in block ${n}", ("n", block_state->block->block_num()));
 
-      std::vector<table_delta> deltas;
-      auto&                    db = chain_plug->chain().db();
+      auto& deltas = *(entry.deltas = std::vector<table_delta>());
+      auto& db     = chain_plug->chain().db();
 
       const auto&                                table_id_index = db.get_index<table_id_multi_index>();
       std::map<uint64_t, const table_id_object*> removed_table_id;
-      for (auto& rem : table_id_index.stack().back().removed_values)
-         removed_table_id[rem.first._id] = &rem.second;
+      if (auto* undo = table_id_index.head_undo_state()) {
+         for (auto& rem : undo->removed_values)
+            removed_table_id[rem.first._id] = &rem.second;
+      }
 
       auto get_table_id = [&](uint64_t tid) -> const table_id_object& {
          auto obj = table_id_index.find(tid);
@@ -499,6 +875,15 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          return fc::raw::pack(make_history_context_wrapper(db, get_table_id(row.t_id._id), row));
       };
 
+      // the initial state is packed in chunks of consecutive rows on a pool, which is stopped before the
+      // lambdas it uses go away; nothing changes the state meanwhile
+      using packed_rows = std::vector<std::pair<bool, bytes>>;
+      constexpr size_t                                       initial_state_chunk = 4096;
+      fc::optional<named_thread_pool>                        initial_state_pool;
+      std::vector<std::pair<size_t, std::future<packed_rows>>> initial_state_chunks;
+      if (fresh && initial_state_threads)
+         initial_state_pool.emplace("ship-init", initial_state_threads);
+
       auto process_table = [&](auto* name, auto& index, auto& pack_row) {
          if (fresh) {
             if (index.indices().empty())
@@ -506,13 +891,37 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
             deltas.push_back({});
             auto& delta = deltas.back();
             delta.name  = name;
-            for (auto& row : index.indices())
-               delta.rows.obj.emplace_back(true, pack_row(row));
+            if (!initial_state_pool) {
+               for (auto& row : index.indices())
+                  delta.rows.obj.emplace_back(true, pack_row(row));
+               return;
+            }
+            const auto& rows = index.indices();
+            auto        begin = rows.begin();
+            while (begin != rows.end()) {
+               auto   end = begin;
+               size_t n   = 0;
+               while (end != rows.end() && n < initial_state_chunk) {
+                  ++end;
+                  ++n;
+               }
+               initial_state_chunks.emplace_back(
+                   deltas.size() - 1, async_thread_pool(initial_state_pool->get_executor(), [&pack_row, begin, end, n]() {
+                      packed_rows result;
+                      result.reserve(n);
+                      for (auto it = begin; it != end; ++it)
+                         result.emplace_back(true, pack_row(*it));
+                      return result;
+                   }));
+               begin = end;
+            }
          } else {
-            if (index.stack().empty())
+            auto* head_undo = index.head_undo_state();
+            if (!head_undo)
                return;
-            auto& undo = index.stack().back();
-            if (undo.old_values.empty() && undo.new_ids.empty() && undo.removed_values.empty())
+            auto& undo     = *head_undo;
+            auto  new_rows = index.indices().lower_bound(undo.old_next_id);
+            if (undo.old_values.empty() && new_rows == index.indices().end() && undo.removed_values.empty())
                return;
             deltas.push_back({});
             auto& delta = deltas.back();
@@ -524,10 +933,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
             }
             for (auto& old : undo.removed_values)
                delta.rows.obj.emplace_back(false, pack_row(old.second));
-            for (auto id : undo.new_ids) {
-               auto& row = index.get(id);
-               delta.rows.obj.emplace_back(true, pack_row(row));
-            }
+            for (; new_rows != index.indices().end(); ++new_rows)
+               delta.rows.obj.emplace_back(true, pack_row(*new_rows));
          }
       };
 
@@ -555,18 +962,12 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       process_table("resource_limits_state", db.get_index<resource_limits::resource_limits_state_index>(), pack_row);
       process_table("resource_limits_config", db.get_index<resource_limits::resource_limits_config_index>(), pack_row);
 
-      auto deltas_bin = zlib_compress_bytes(fc::raw::pack(deltas));
-      ROXE_ASSERT(deltas_bin.size() == (uint32_t)deltas_bin.size(), plugin_exception, "deltas is too big");
-      state_history_log_header header{.magic        = ship_magic(ship_current_version),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + deltas_bin.size()};
-      chain_state_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)deltas_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!deltas_bin.empty())
-            stream.write(deltas_bin.data(), deltas_bin.size());
-      });
-   } // store_chain_state
+      for (auto& chunk : initial_state_chunks) {
+         auto  rows  = chunk.second.get();
+         auto& dest  = deltas[chunk.first].rows.obj;
+         dest.insert(dest.end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+      }
+   } // capture_chain_state
 };   // state_history_plugin_impl
 
 state_history_plugin::state_history_plugin()
@@ -586,6 +987,27 @@ void state_history_plugin::set_program_options(options_description& cli, options
            "your internal network.");
    options("trace-history-debug-mode", bpo::bool_switch()->default_value(false),
            "enable debug mode for trace history");
+   options("state-history-compression", bpo::value<string>()->default_value("zlib"),
+           "how new state history entries are compressed: zlib or none. Entries already in the logs are read "
+           "whichever way they were written.");
+   options("state-history-compression-level", bpo::value<int>()->default_value(bio::zlib::default_compression),
+           "zlib compression level of new state history entries, from 1 (fastest) to 9 (smallest), -1 for zlib's "
+           "default");
+   options("state-history-cache-mb", bpo::value<uint32_t>()->default_value(32),
+           "the size of the blocks, traces and deltas recently sent to clients kept for other clients requesting "
+           "them, in MiB. 0 disables the cache.");
+   options("state-history-initial-state-threads", bpo::value<uint16_t>()->default_value(4),
+           "the number of threads packing the initial state placed in a fresh chain state log, 0 to pack it on the main thread");
+   options("state-history-read-threads", bpo::value<uint16_t>()->default_value(2),
+           "the number of threads reading and decompressing the entries clients catching up are sent next, into "
+           "the state history cache. 0 reads them when they are sent.");
+   options("state-history-prefetch-blocks", bpo::value<uint32_t>()->default_value(64),
+           "how many blocks ahead of a client catching up are read and decompressed");
+   options("state-history-mmap-log", bpo::bool_switch()->default_value(false),
+           "read the state history logs through a memory mapping, the indexes are always read that way");
+   options("state-history-write-queue-size", bpo::value<uint32_t>()->default_value(16),
+           "the number of blocks which may wait for the thread compressing and writing the state history, the "
+           "main thread stalls when it is full. 0 writes the state history on the main thread.");
 }
 
 void state_history_plugin::plugin_initialize(const variables_map& options) {
@@ -600,6 +1022,7 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
           chain.applied_transaction.connect([&](std::tuple<const transaction_trace_ptr&, const signed_transaction&> t) {
              my->on_applied_transaction(std::get<0>(t), std::get<1>(t));
           }));
+      chain.require_detailed_traces();
       my->accepted_block_connection.emplace(
           chain.accepted_block.connect([&](const block_state_ptr& p) { my->on_accepted_block(p); }));
 
@@ -625,7 +1048,26 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
 
       if (options.at("trace-history-debug-mode").as<bool>()) {
          my->trace_debug_mode = true;
+         chain.require_console_output();
       }
+      my->max_write_queue_size = options.at("state-history-write-queue-size").as<uint32_t>();
+      my->entry_cache.max_bytes = uint64_t(options.at("state-history-cache-mb").as<uint32_t>()) * 1024 * 1024;
+      my->prefetch_blocks       = options.at("state-history-prefetch-blocks").as<uint32_t>();
+      my->initial_state_threads = options.at("state-history-initial-state-threads").as<uint16_t>();
+      if (auto read_threads = options.at("state-history-read-threads").as<uint16_t>())
+         my->read_thread_pool.emplace("ship", read_threads);
+      else
+         my->prefetch_blocks = 0;
+
+      const auto compression = options.at("state-history-compression").as<string>();
+      if (compression == "none")
+         my->codec = state_history_codec::none;
+      else
+         ROXE_ASSERT(compression == "zlib", plugin_config_exception, "unknown state-history-compression ${c}",
+                     ("c", compression));
+      my->compression_level = options.at("state-history-compression-level").as<int>();
+      ROXE_ASSERT(my->compression_level >= -1 && my->compression_level <= 9, plugin_config_exception,
+                  "state-history-compression-level must be from -1 to 9");
 
       if (options.at("trace-history").as<bool>())
          my->trace_log.emplace("trace_history", (state_history_dir / "trace_history.log").string(),
@@ -633,6 +1075,14 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       if (options.at("chain-state-history").as<bool>())
          my->chain_state_log.emplace("chain_state_history", (state_history_dir / "chain_state_history.log").string(),
                                      (state_history_dir / "chain_state_history.index").string());
+      if (options.at("state-history-mmap-log").as<bool>()) {
+         if (my->trace_log)
+            my->trace_log->set_map_log(true);
+         if (my->chain_state_log)
+            my->chain_state_log->set_map_log(true);
+      }
+      if (my->max_write_queue_size && (my->trace_log || my->chain_state_log))
+         my->writer = std::thread([this] { my->run_writer(); });
    }
    FC_LOG_AND_RETHROW()
 } // state_history_plugin::plugin_initialize
@@ -642,6 +1092,9 @@ void state_history_plugin::plugin_startup() { my->listen(); }
 void state_history_plugin::plugin_shutdown() {
    my->applied_transaction_connection.reset();
    my->accepted_block_connection.reset();
+   my->stop_writer();
+   if (my->read_thread_pool)
+      my->read_thread_pool->stop();
    while (!my->sessions.empty())
       my->sessions.begin()->second->close();
    my->stopping = true;
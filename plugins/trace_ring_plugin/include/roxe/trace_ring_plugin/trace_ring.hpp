@@ -0,0 +1,77 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <roxe/chain/block_timestamp.hpp>
+#include <roxe/chain/types.hpp>
+
+#include <atomic>
+
+namespace roxe {
+
+/* Layout of the trace ring file, which local consumers map read only.
+ *
+ * +--------+---------------------------------------------------+
+ * | Header | Data = records of capacity bytes, used as a ring  |
+ * +--------+---------------------------------------------------+
+ *
+ * Positions are byte counts since the ring was created, the record at position p starts at data offset
+ * p % capacity. Records are 8 byte aligned and never wrap around the end of the data, the space left before
+ * the end is filled with a padding record, or skipped if it is too small for a record header.
+ *
+ * The producer has records [tail_pos, write_pos). Before overwriting the oldest records it advances tail_pos,
+ * after writing a record it advances write_pos, both with release semantics. A consumer at position p:
+ *  1. loads write_pos (acquire); p == write_pos means there is nothing new,
+ *  2. resyncs to tail_pos if p < tail_pos, the records in between were lost,
+ *  3. reads the record at p in place,
+ *  4. issues an acquire fence and reloads tail_pos; the record was overwritten while being read if p < tail_pos,
+ *  5. advances p by trace_ring_record_header::total_size().
+ */
+struct trace_ring_header {
+   static constexpr uint64_t magic_number = 0x31474e4952435254ull; // "TRCRING1"
+   static constexpr uint32_t current_version = 1;
+   static constexpr uint32_t data_offset = 4096;   // the data starts after the page of the header
+
+   uint64_t              magic = magic_number;
+   uint32_t              version = current_version;
+   uint32_t              header_size = data_offset;
+   uint64_t              capacity = 0;              ///< size of the data in bytes, a multiple of 8
+   std::atomic<uint64_t> tail_pos{0};
+   std::atomic<uint64_t> write_pos{0};
+   std::atomic<uint64_t> next_sequence{0};         ///< sequence of the next record written
+};
+
+enum class trace_ring_record_kind : uint32_t {
+   padding            = 0, ///< fills the data up to its end
+   block              = 1, ///< trace_ring_block of an accepted block, followed by the traces of its transactions
+   transaction_trace  = 2, ///< packed chain::transaction_trace
+   irreversible_block = 3  ///< trace_ring_block of a block which became irreversible
+};
+
+struct trace_ring_record_header {
+   uint64_t               sequence = 0;
+   uint32_t               size = 0;                ///< size of the payload following the header
+   trace_ring_record_kind kind = trace_ring_record_kind::padding;
+
+   uint64_t total_size()const { return (sizeof(trace_ring_record_header) + size + 7) & ~uint64_t(7); }
+};
+
+/// payload of block and irreversible_block records, fc::raw packed
+struct trace_ring_block {
+   uint32_t                    block_num = 0;
+   chain::block_id_type        id;
+   chain::block_id_type        previous;
+   chain::block_timestamp_type timestamp;
+   chain::account_name         producer;
+   uint32_t                    last_irreversible_block_num = 0;
+   uint32_t                    transaction_count = 0; ///< number of transaction_trace records following a block record
+};
+
+static_assert( sizeof(trace_ring_header) <= trace_ring_header::data_offset, "trace ring header too large" );
+static_assert( sizeof(trace_ring_record_header) == 16, "trace ring records are 8 byte aligned" );
+static_assert( std::atomic<uint64_t>::is_always_lock_free, "trace ring positions are shared between processes" );
+
+} // namespace roxe
+
+FC_REFLECT( roxe::trace_ring_block, (block_num)(id)(previous)(timestamp)(producer)(last_irreversible_block_num)(transaction_count) )
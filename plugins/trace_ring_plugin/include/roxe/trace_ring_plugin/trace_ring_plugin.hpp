@@ -0,0 +1,35 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#pragma once
+#include <appbase/application.hpp>
+#include <roxe/chain_plugin/chain_plugin.hpp>
+#include <roxe/trace_ring_plugin/trace_ring.hpp>
+
+namespace roxe {
+
+using namespace appbase;
+typedef std::shared_ptr<class trace_ring_plugin_impl> trace_ring_ptr;
+
+/**
+ *  Writes the packed transaction traces of every accepted block, preceded by a block record, into a file backed
+ *  ring buffer (see trace_ring.hpp), from which local consumers read in place at their own pace.
+ */
+class trace_ring_plugin : public plugin<trace_ring_plugin> {
+public:
+   APPBASE_PLUGIN_REQUIRES((chain_plugin))
+
+   trace_ring_plugin();
+   virtual ~trace_ring_plugin();
+
+   virtual void set_program_options(options_description& cli, options_description& cfg) override;
+   void plugin_initialize(const variables_map& options);
+   void plugin_startup();
+   void plugin_shutdown();
+
+private:
+   trace_ring_ptr my;
+};
+
+} // namespace roxe
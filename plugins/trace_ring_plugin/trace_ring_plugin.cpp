@@ -0,0 +1,253 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE
+ */
+#include <roxe/trace_ring_plugin/trace_ring_plugin.hpp>
+#include <roxe/chain/async_subscriber.hpp>
+#include <roxe/chain/config.hpp>
+#include <roxe/chain/trace.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/signals2/connection.hpp>
+
+#include <fstream>
+
+namespace roxe {
+   using namespace chain;
+   using boost::signals2::scoped_connection;
+   namespace bip = boost::interprocess;
+
+   static appbase::abstract_plugin& _trace_ring_plugin = app().register_plugin<trace_ring_plugin>();
+
+   class trace_ring_plugin_impl {
+      public:
+         fc::optional<scoped_connection> applied_transaction_connection;
+         fc::optional<scoped_connection> accepted_block_connection;
+         fc::optional<scoped_connection> irreversible_block_connection;
+         /// runs the handlers below off the main thread, they use only what the signals carry; null if synchronous
+         std::unique_ptr<async_subscriber> subscriber;
+
+         bfs::path          ring_file;
+         uint64_t           capacity = 0;
+         bip::mapped_region region;
+         trace_ring_header* header = nullptr;
+         char*              data = nullptr;
+         std::vector<char>  buffer;
+
+         std::map<transaction_id_type, transaction_trace_ptr> cached_traces;
+         transaction_trace_ptr                                onblock_trace;
+
+         void open() {
+            const uint64_t file_size = trace_ring_header::data_offset + capacity;
+            bool init = !bfs::exists( ring_file ) || bfs::file_size( ring_file ) != file_size;
+            if( init ) {
+               std::ofstream ofs( ring_file.generic_string(), std::ofstream::trunc );
+               ofs.close();
+               bfs::resize_file( ring_file, file_size );
+            }
+            region = bip::mapped_region( bip::file_mapping( ring_file.generic_string().c_str(), bip::read_write ), bip::read_write );
+            header = reinterpret_cast<trace_ring_header*>( region.get_address() );
+            data = reinterpret_cast<char*>( region.get_address() ) + trace_ring_header::data_offset;
+
+            if( !init && ( header->magic != trace_ring_header::magic_number ||
+                           header->version != trace_ring_header::current_version || header->capacity != capacity ) )
+               init = true;
+            if( init ) {
+               new (header) trace_ring_header;
+               header->capacity = capacity;
+               ilog( "created trace ring ${f} of ${c} bytes", ("f", ring_file.generic_string())("c", capacity) );
+            } else {
+               ilog( "continuing trace ring ${f} at sequence ${s}",
+                     ("f", ring_file.generic_string())("s", header->next_sequence.load()) );
+            }
+         }
+
+         void close() {
+            if( header )
+               region.flush();
+            header = nullptr;
+            data = nullptr;
+            region = bip::mapped_region();
+         }
+
+         /// moves the tail past the records which get overwritten when writing up to end
+         void make_room( uint64_t end ) {
+            uint64_t tail = header->tail_pos.load( std::memory_order_relaxed );
+            if( end - tail <= capacity )
+               return;
+            while( end - tail > capacity ) {
+               const uint64_t offset = tail % capacity;
+               if( capacity - offset < sizeof(trace_ring_record_header) ) {
+                  tail += capacity - offset;
+                  continue;
+               }
+               tail += reinterpret_cast<const trace_ring_record_header*>( data + offset )->total_size();
+            }
+            header->tail_pos.store( tail, std::memory_order_release );
+         }
+
+         void append( trace_ring_record_kind kind, const char* payload, uint32_t size ) {
+            trace_ring_record_header rh;
+            rh.size = size;
+            rh.kind = kind;
+            const uint64_t total = rh.total_size();
+            if( total > capacity ) {
+               wlog( "trace ring record of ${s} bytes does not fit in the ring of ${c} bytes", ("s", size)("c", capacity) );
+               return;
+            }
+
+            uint64_t pos = header->write_pos.load( std::memory_order_relaxed );
+            const uint64_t left = capacity - pos % capacity;
+            if( left < total ) {
+               make_room( pos + left );
+               if( left >= sizeof(trace_ring_record_header) ) {
+                  trace_ring_record_header padding;
+                  padding.sequence = header->next_sequence++;
+                  padding.size = left - sizeof(trace_ring_record_header);
+                  memcpy( data + pos % capacity, &padding, sizeof(padding) );
+               }
+               pos += left;
+               header->write_pos.store( pos, std::memory_order_release );
+            }
+
+            make_room( pos + total );
+            rh.sequence = header->next_sequence++;
+            char* dest = data + pos % capacity;
+            memcpy( dest, &rh, sizeof(rh) );
+            memcpy( dest + sizeof(rh), payload, size );
+            header->write_pos.store( pos + total, std::memory_order_release );
+         }
+
+         template<typename T>
+         void write( trace_ring_record_kind kind, const T& obj ) {
+            buffer.resize( fc::raw::pack_size( obj ) );
+            fc::datastream<char*> ds( buffer.data(), buffer.size() );
+            fc::raw::pack( ds, obj );
+            append( kind, buffer.data(), buffer.size() );
+         }
+
+         static trace_ring_block make_block( const block_state_ptr& bsp, uint32_t transaction_count ) {
+            trace_ring_block b;
+            b.block_num = bsp->block_num;
+            b.id = bsp->id;
+            b.previous = bsp->header.previous;
+            b.timestamp = bsp->header.timestamp;
+            b.producer = bsp->header.producer;
+            b.last_irreversible_block_num = bsp->dpos_irreversible_blocknum;
+            b.transaction_count = transaction_count;
+            return b;
+         }
+
+         void on_applied_transaction( const transaction_trace_ptr& trace ) {
+            if( !trace->receipt )
+               return;
+            const auto* act = trace->action_traces.empty() ? nullptr : &trace->action_traces.front().act;
+            if( act && act->account == chain::config::system_account_name && act->name == N(onblock) )
+               onblock_trace = trace;
+            else if( trace->failed_dtrx_trace )
+               cached_traces[trace->failed_dtrx_trace->id] = trace;
+            else
+               cached_traces[trace->id] = trace;
+         }
+
+         void on_accepted_block( const block_state_ptr& bsp ) {
+            std::vector<transaction_trace_ptr> traces;
+            traces.reserve( bsp->block->transactions.size() + 1 );
+            if( onblock_trace )
+               traces.push_back( onblock_trace );
+            for( const auto& r : bsp->block->transactions ) {
+               const auto& id = r.trx.contains<transaction_id_type>() ? r.trx.get<transaction_id_type>()
+                                                                      : r.trx.get<packed_transaction>().id();
+               auto itr = cached_traces.find( id );
+               if( itr != cached_traces.end() )
+                  traces.push_back( itr->second );
+            }
+            cached_traces.clear();
+            onblock_trace.reset();
+
+            write( trace_ring_record_kind::block, make_block( bsp, traces.size() ) );
+            for( const auto& t : traces )
+               write( trace_ring_record_kind::transaction_trace, *t );
+         }
+
+         void on_irreversible_block( const block_state_ptr& bsp ) {
+            write( trace_ring_record_kind::irreversible_block, make_block( bsp, 0 ) );
+         }
+   };
+
+   trace_ring_plugin::trace_ring_plugin()
+   :my(std::make_shared<trace_ring_plugin_impl>()) {
+   }
+
+   trace_ring_plugin::~trace_ring_plugin() {
+   }
+
+   void trace_ring_plugin::set_program_options(options_description& cli, options_description& cfg) {
+      cfg.add_options()
+            ("trace-ring-file", bpo::value<bfs::path>()->default_value("trace-ring.bin"),
+             "the location of the trace ring file (absolute path or relative to application data dir)")
+            ("trace-ring-size-mb", bpo::value<uint32_t>()->default_value(256),
+             "Size (in MiB) of the trace ring, the oldest records are overwritten when it is full")
+            ("trace-ring-queue-size", bpo::value<uint32_t>()->default_value(1024),
+             "Traces and blocks queued for the thread writing the trace ring, block application waits when it is full; "
+             "0 writes them on the main thread")
+            ;
+   }
+
+   void trace_ring_plugin::plugin_initialize(const variables_map& options) {
+      try {
+         auto* chain_plug = app().find_plugin<chain_plugin>();
+         ROXE_ASSERT( chain_plug, chain::missing_chain_plugin_exception, "" );
+         auto& chain = chain_plug->chain();
+
+         my->ring_file = options.at( "trace-ring-file" ).as<bfs::path>();
+         if( my->ring_file.is_relative() )
+            my->ring_file = app().data_dir() / my->ring_file;
+         if( my->ring_file.has_parent_path() && !fc::is_directory( my->ring_file.parent_path() ) )
+            fc::create_directories( my->ring_file.parent_path() );
+         const auto size_mb = options.at( "trace-ring-size-mb" ).as<uint32_t>();
+         ROXE_ASSERT( size_mb > 0, chain::plugin_config_exception, "trace-ring-size-mb > 0 required" );
+         my->capacity = uint64_t(size_mb) * 1024 * 1024;
+         my->open();
+
+         chain.require_detailed_traces();
+         const auto queue_size = options.at( "trace-ring-queue-size" ).as<uint32_t>();
+         if( queue_size > 0 ) {
+            my->subscriber = std::make_unique<async_subscriber>( "trace-ring", queue_size );
+            my->applied_transaction_connection.emplace( my->subscriber->connect( chain.applied_transaction,
+                  [my = my.get()]( const transaction_trace_ptr& trace ) { my->on_applied_transaction( trace ); } ) );
+            my->accepted_block_connection.emplace( my->subscriber->connect( chain.accepted_block,
+                  [my = my.get()]( const block_state_ptr& bsp ) { my->on_accepted_block( bsp ); } ) );
+            my->irreversible_block_connection.emplace( my->subscriber->connect( chain.irreversible_block,
+                  [my = my.get()]( const block_state_ptr& bsp ) { my->on_irreversible_block( bsp ); } ) );
+         } else {
+            my->applied_transaction_connection.emplace(
+                  chain.applied_transaction.connect( [&]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
+                     my->on_applied_transaction( std::get<0>(t) );
+                  } ));
+            my->accepted_block_connection.emplace(
+                  chain.accepted_block.connect( [&]( const block_state_ptr& bsp ) {
+                     my->on_accepted_block( bsp );
+                  } ));
+            my->irreversible_block_connection.emplace(
+                  chain.irreversible_block.connect( [&]( const block_state_ptr& bsp ) {
+                     my->on_irreversible_block( bsp );
+                  } ));
+         }
+      } FC_LOG_AND_RETHROW()
+   }
+
+   void trace_ring_plugin::plugin_startup() {
+   }
+
+   void trace_ring_plugin::plugin_shutdown() {
+      my->applied_transaction_connection.reset();
+      my->accepted_block_connection.reset();
+      my->irreversible_block_connection.reset();
+      if( my->subscriber )
+         my->subscriber->stop();
+      my->close();
+   }
+
+} // namespace roxe
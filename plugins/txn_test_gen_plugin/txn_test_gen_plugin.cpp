@@ -15,6 +15,10 @@
 #include <boost/asio/high_resolution_timer.hpp>
 #include <boost/algorithm/clamp.hpp>
 
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
 #include <Inline/BasicTypes.h>
 #include <IR/Module.h>
 #include <IR/Validate.h>
@@ -31,10 +35,52 @@ namespace roxe { namespace detail {
   struct txn_test_gen_status {
      string status;
   };
+
+  struct txn_test_gen_account {
+     chain::name  account;
+     string       key;
+  };
+
+  /// One action of a load: `data` is the action's JSON, in which the strings ${actor} and ${peer} are replaced by
+  /// the pool account sending the transaction and the next one in the pool
+  struct txn_test_gen_workload {
+     chain::name                   contract;
+     chain::name                   action;
+     fc::variant                   data;
+     vector<txn_test_gen_account>  accounts;
+     uint32_t                      weight = 1;
+  };
+
+  struct txn_test_gen_load {
+     vector<txn_test_gen_workload> workloads;
+     uint32_t                      rate = 0;      ///< transactions per second
+     uint32_t                      duration = 0;  ///< seconds, 0 runs until stop_generation
+  };
+
+  struct txn_test_gen_latency {
+     uint64_t count  = 0;
+     int64_t  p50_us = 0;
+     int64_t  p90_us = 0;
+     int64_t  p99_us = 0;
+     int64_t  max_us = 0;
+  };
+
+  struct txn_test_gen_report {
+     uint64_t              submitted = 0;
+     uint64_t              failed    = 0;
+     uint64_t              expired   = 0;
+     txn_test_gen_latency  inclusion;
+     txn_test_gen_latency  irreversible;
+  };
 }}
 
 FC_REFLECT(roxe::detail::txn_test_gen_empty, );
 FC_REFLECT(roxe::detail::txn_test_gen_status, (status));
+FC_REFLECT(roxe::detail::txn_test_gen_account, (account)(key));
+FC_REFLECT(roxe::detail::txn_test_gen_workload, (contract)(action)(data)(accounts)(weight));
+FC_REFLECT(roxe::detail::txn_test_gen_load, (workloads)(rate)(duration));
+FC_REFLECT(roxe::detail::txn_test_gen_latency, (count)(p50_us)(p90_us)(p99_us)(max_us));
+FC_REFLECT(roxe::detail::txn_test_gen_report, (submitted)(failed)(expired)(inclusion)(irreversible));
 
 namespace roxe {
 
@@ -42,6 +88,7 @@ static appbase::abstract_plugin& _txn_test_gen_plugin = app().register_plugin<tx
 
 using namespace roxe::chain;
 using io_work_t = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+using boost::signals2::scoped_connection;
 
 #define CALL(api_name, api_handle, call_name, INVOKE, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
@@ -60,6 +107,14 @@ using io_work_t = boost::asio::executor_work_guard<boost::asio::io_context::exec
      auto status = api_handle->call_name(vs.at(0).as<in_param0>(), vs.at(1).as<in_param1>(), vs.at(2).as<in_param2>()); \
      roxe::detail::txn_test_gen_status result = { status };
 
+#define INVOKE_V_R(api_handle, call_name, in_param0) \
+     const auto& vs = fc::json::json::from_string(body).as<fc::variants>(); \
+     auto status = api_handle->call_name(vs.at(0).as<in_param0>()); \
+     roxe::detail::txn_test_gen_status result = { status };
+
+#define INVOKE_R_V(api_handle, call_name) \
+     auto result = api_handle->call_name();
+
 #define INVOKE_V_R_R(api_handle, call_name, in_param0, in_param1) \
      const auto& vs = fc::json::json::from_string(body).as<fc::variants>(); \
      api_handle->call_name(vs.at(0).as<in_param0>(), vs.at(1).as<in_param1>()); \
@@ -95,11 +150,121 @@ using io_work_t = boost::asio::executor_work_guard<boost::asio::io_context::exec
    const auto& vs = fc::json::json::from_string(body).as<fc::variants>(); \
    api_handle->call_name(vs.at(0).as<in_param0>(), vs.at(1).as<in_param1>(), result_handler);
 
+/**
+ * Latency of generated transactions from submission to inclusion in a block and to irreversibility. Submissions
+ * come from the generation threads, blocks from the main thread.
+ */
+class latency_tracker {
+public:
+   void reset() {
+      std::lock_guard<std::mutex> g( mtx );
+      pending.clear();
+      in_blocks.clear();
+      inclusion_us.clear();
+      irreversible_us.clear();
+      submitted = failed = expired = 0;
+   }
+
+   void submit( const std::vector<signed_transaction>& trxs ) {
+      const auto now = fc::time_point::now();
+      std::lock_guard<std::mutex> g( mtx );
+      for( const auto& trx : trxs )
+         pending.emplace( trx.id(), now );
+      submitted += trxs.size();
+   }
+
+   void fail( const transaction_id_type& id ) {
+      std::lock_guard<std::mutex> g( mtx );
+      if( pending.erase( id ) )
+         ++failed;
+   }
+
+   void on_accepted_block( const block_state_ptr& bsp ) {
+      const auto now = fc::time_point::now();
+      std::lock_guard<std::mutex> g( mtx );
+      if( pending.empty() )
+         return;
+      for( const auto& receipt : bsp->block->transactions ) {
+         const transaction_id_type& id = receipt.trx.contains<transaction_id_type>() ? receipt.trx.get<transaction_id_type>()
+                                                                                     : receipt.trx.get<packed_transaction>().id();
+         auto itr = pending.find( id );
+         if( itr == pending.end() )
+            continue;
+         inclusion_us.push_back( (now - itr->second).count() );
+         in_blocks[bsp->block_num].push_back( itr->second );
+         pending.erase( itr );
+      }
+   }
+
+   void on_irreversible_block( const block_state_ptr& bsp, const fc::microseconds& expiration ) {
+      const auto now = fc::time_point::now();
+      std::lock_guard<std::mutex> g( mtx );
+      auto end = in_blocks.upper_bound( bsp->block_num );
+      for( auto itr = in_blocks.begin(); itr != end; ++itr ) {
+         for( const auto& t : itr->second )
+            irreversible_us.push_back( (now - t).count() );
+      }
+      in_blocks.erase( in_blocks.begin(), end );
+
+      // anything not in a block by now has expired
+      for( auto itr = pending.begin(); itr != pending.end(); ) {
+         if( now - itr->second > expiration ) {
+            itr = pending.erase( itr );
+            ++expired;
+         } else {
+            ++itr;
+         }
+      }
+   }
+
+   roxe::detail::txn_test_gen_report report() {
+      std::lock_guard<std::mutex> g( mtx );
+      roxe::detail::txn_test_gen_report r;
+      r.submitted    = submitted;
+      r.failed       = failed;
+      r.expired      = expired;
+      r.inclusion    = percentiles( inclusion_us );
+      r.irreversible = percentiles( irreversible_us );
+      return r;
+   }
+
+private:
+   static roxe::detail::txn_test_gen_latency percentiles( std::vector<int64_t>& samples ) {
+      roxe::detail::txn_test_gen_latency l;
+      l.count = samples.size();
+      if( samples.empty() )
+         return l;
+      std::sort( samples.begin(), samples.end() );
+      auto at = [&]( double p ) { return samples[size_t( p * (samples.size() - 1) )]; };
+      l.p50_us = at( 0.50 );
+      l.p90_us = at( 0.90 );
+      l.p99_us = at( 0.99 );
+      l.max_us = samples.back();
+      return l;
+   }
+
+   std::mutex                                                mtx;
+   std::unordered_map<transaction_id_type, fc::time_point>   pending;    ///< submitted, not yet in a block
+   std::map<uint32_t, std::vector<fc::time_point>>           in_blocks;  ///< submission times by block number
+   std::vector<int64_t>                                      inclusion_us;
+   std::vector<int64_t>                                      irreversible_us;
+   uint64_t                                                  submitted = 0;
+   uint64_t                                                  failed    = 0;
+   uint64_t                                                  expired   = 0;
+};
+
 struct txn_test_gen_plugin_impl {
 
+   static constexpr uint32_t trx_expiration_sec = 30;
+   static constexpr uint32_t load_tick_ms       = 10;
+
    uint64_t _total_us = 0;
    uint64_t _txcount = 0;
 
+   latency_tracker                                      latency;
+   fc::optional<scoped_connection>                      accepted_block_connection;
+   fc::optional<scoped_connection>                      irreversible_block_connection;
+
    std::shared_ptr<boost::asio::io_context>             gen_ioc;
    optional<io_work_t>                                  gen_ioc_work;
    uint16_t                                             thread_pool_size;
@@ -115,6 +280,7 @@ struct txn_test_gen_plugin_impl {
       for (size_t i = 0; i < trxs->size(); ++i) {
          cp.accept_transaction( packed_transaction(trxs->at(i)), [=](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result){
             if (result.contains<fc::exception_ptr>()) {
+               latency.fail(trxs->at(i).id());
                next(result.get<fc::exception_ptr>());
             } else {
                if (result.contains<transaction_trace_ptr>() && result.get<transaction_trace_ptr>()->receipt) {
@@ -127,6 +293,8 @@ struct txn_test_gen_plugin_impl {
    }
 
    void push_transactions( std::vector<signed_transaction>&& trxs, const std::function<void(fc::exception_ptr)>& next ) {
+      if (running)
+         latency.submit(trxs);
       auto trxs_copy = std::make_shared<std::decay_t<decltype(trxs)>>(std::move(trxs));
       app().post(priority::low, [this, trxs_copy, next]() {
          push_next_transaction(trxs_copy, next);
@@ -305,22 +473,202 @@ struct txn_test_gen_plugin_impl {
       batch = batch_size/2;
       nonce_prefix = 0;
 
+      start_threads();
+
+      ilog("Started transaction test plugin; generating ${p} transactions every ${m} ms by ${t} load generation threads",
+         ("p", batch_size) ("m", period) ("t", thread_pool_size));
+
+      boost::asio::post( *gen_ioc, [this]() {
+         arm_timer(boost::asio::high_resolution_timer::clock_type::now());
+      });
+      return "success";
+   }
+
+   void start_threads() {
+      latency.reset();
       gen_ioc = std::make_shared<boost::asio::io_context>();
       gen_ioc_work.emplace( boost::asio::make_work_guard(*gen_ioc) );
       thread_pool.emplace( thread_pool_size );
       for( uint16_t i = 0; i < thread_pool_size; i++ )
          boost::asio::post( *thread_pool, [ioc = gen_ioc]() { ioc->run(); } );
       timer = std::make_shared<boost::asio::high_resolution_timer>(*gen_ioc);
+   }
 
-      ilog("Started transaction test plugin; generating ${p} transactions every ${m} ms by ${t} load generation threads",
-         ("p", batch_size) ("m", period) ("t", thread_pool_size));
+   /// Replaces ${actor} and ${peer} in every string of an action template
+   static fc::variant fill_template( const fc::variant& v, const fc::variant_object& args ) {
+      if( v.is_string() )
+         return fc::variant( fc::format_string( v.get_string(), args ) );
+      if( v.is_object() ) {
+         fc::mutable_variant_object mvo;
+         for( const auto& entry : v.get_object() )
+            mvo( entry.key(), fill_template( entry.value(), args ) );
+         return fc::variant( std::move(mvo) );
+      }
+      if( v.is_array() ) {
+         fc::variants vs;
+         vs.reserve( v.size() );
+         for( const auto& e : v.get_array() )
+            vs.emplace_back( fill_template( e, args ) );
+         return fc::variant( std::move(vs) );
+      }
+      return v;
+   }
+
+   string start_load(const roxe::detail::txn_test_gen_load& load) {
+      ilog("Starting transaction load");
+      if(running)
+         return "start_generation already running";
+      if(load.rate < 1 || load.rate > 100000)
+         return "rate must be between 1 and 100000";
+      if(load.workloads.empty())
+         return "at least one workload is required";
+
+      auto ro_api = app().get_plugin<chain_plugin>().get_read_only_api();
+      auto abi_serializer_max_time = app().get_plugin<chain_plugin>().get_abi_serializer_max_time();
+
+      // encode every action once per pool account, generation then only picks, nonces and signs
+      std::vector<std::vector<load_action>> actions;
+      std::vector<uint32_t> mix;
+      for( const auto& w : load.workloads ) {
+         if( w.weight == 0 )
+            continue;
+         auto abi = ro_api.get_abi( chain_apis::read_only::get_abi_params{w.contract} ).abi;
+         if( !abi )
+            return "no abi for contract " + w.contract.to_string();
+         abi_serializer abis( *abi, abi_serializer_max_time );
+         const string action_type = abis.get_action_type( w.action );
+         if( action_type.empty() )
+            return "unknown action " + w.contract.to_string() + "::" + w.action.to_string();
+
+         // without a pool, the accounts made by create_test_accounts are used
+         std::vector<std::pair<name, fc::crypto::private_key>> accounts;
+         for( const auto& a : w.accounts )
+            accounts.emplace_back( a.account, fc::crypto::private_key( a.key ) );
+         if( accounts.empty() ) {
+            accounts.emplace_back( newaccountA, fc::crypto::private_key::regenerate(fc::sha256(std::string(64, 'a'))) );
+            accounts.emplace_back( newaccountB, fc::crypto::private_key::regenerate(fc::sha256(std::string(64, 'b'))) );
+         }
+
+         std::vector<load_action> prepared;
+         prepared.reserve( accounts.size() );
+         for( size_t i = 0; i < accounts.size(); ++i ) {
+            const name& actor = accounts[i].first;
+            const name& peer  = accounts[(i + 1) % accounts.size()].first;
+            const auto data = fill_template( w.data, fc::mutable_variant_object()("actor", actor.to_string())("peer", peer.to_string()) );
+
+            load_action la{ action{}, accounts[i].second };
+            la.act.account = w.contract;
+            la.act.name = w.action;
+            la.act.authorization = vector<permission_level>{{actor, config::active_name}};
+            la.act.data = abis.variant_to_binary( action_type, data, abi_serializer_max_time );
+            prepared.push_back( std::move(la) );
+         }
+
+         mix.insert( mix.end(), w.weight, uint32_t(actions.size()) );
+         actions.push_back( std::move(prepared) );
+      }
+      if( mix.empty() )
+         return "at least one workload must have a weight";
+
+      running = true;
+      load_actions = std::move(actions);
+      load_mix = std::move(mix);
+      load_rate = load.rate;
+      load_duration = fc::seconds( load.duration );
+      load_sent = 0;
+      load_nonce = static_cast<uint64_t>(fc::time_point::now().sec_since_epoch()) << 32;
+      load_start = fc::time_point::now();
+
+      start_threads();
+
+      ilog("Started transaction load; ${r} transactions per second from ${w} workloads by ${t} load generation threads",
+         ("r", load.rate) ("w", load_actions.size()) ("t", thread_pool_size));
 
       boost::asio::post( *gen_ioc, [this]() {
-         arm_timer(boost::asio::high_resolution_timer::clock_type::now());
+         arm_load_timer();
       });
       return "success";
    }
 
+   /// Open loop: every tick sends whatever the rate says is due since the start, whether or not earlier
+   /// transactions have made it into a block
+   void arm_load_timer() {
+      timer->expires_from_now(std::chrono::milliseconds(load_tick_ms));
+      timer->async_wait([this](const boost::system::error_code& ec) {
+         if(!running || ec)
+            return;
+         const auto elapsed = fc::time_point::now() - load_start;
+         if( load_duration.count() > 0 && elapsed >= load_duration ) {
+            app().post(priority::low, [this]() {
+               if(running)
+                  stop_generation();
+            });
+            return;
+         }
+         const uint64_t due = uint64_t(load_rate) * elapsed.count() / 1000000;
+         if( due > load_sent ) {
+            const uint64_t first = load_sent;
+            const uint64_t count = due - load_sent;
+            load_sent = due;
+            boost::asio::post( *gen_ioc, [this, first, count]() {
+               send_load(first, count);
+            });
+         }
+         arm_load_timer();
+      });
+   }
+
+   void send_load(uint64_t first, uint64_t count) {
+      std::vector<signed_transaction> trxs;
+      trxs.reserve(count);
+
+      try {
+         controller& cc = app().get_plugin<chain_plugin>().chain();
+         auto chainid = app().get_plugin<chain_plugin>().get_chain_id();
+         block_id_type reference_block_id = get_reference_block_id();
+
+         for( uint64_t seq = first; seq < first + count; ++seq ) {
+            const auto& workload = load_actions[load_mix[seq % load_mix.size()]];
+            const auto& la = workload[(seq / load_mix.size()) % workload.size()];
+
+            signed_transaction trx;
+            trx.actions.push_back(la.act);
+            trx.context_free_actions.emplace_back(action({}, config::null_account_name, "nonce", fc::raw::pack( std::to_string(load_nonce + seq) )));
+            trx.set_reference_block(reference_block_id);
+            trx.expiration = cc.head_block_time() + fc::seconds(trx_expiration_sec);
+            trx.sign(la.key, chainid);
+            trxs.emplace_back(std::move(trx));
+         }
+      } catch ( const fc::exception& e ) {
+         elog("creating load transactions failed: ${e}", ("e", e.to_detail_string()));
+         return;
+      }
+
+      // failures are counted in the report, the load keeps going
+      push_transactions(std::move(trxs), [](const fc::exception_ptr& e) {
+         if (e)
+            dlog("load transaction failed: ${e}", ("e", e->to_string()));
+      });
+   }
+
+   roxe::detail::txn_test_gen_report get_report() {
+      return latency.report();
+   }
+
+   block_id_type get_reference_block_id() {
+      controller& cc = app().get_plugin<chain_plugin>().chain();
+      uint32_t reference_block_num = cc.last_irreversible_block_num();
+      if (txn_reference_block_lag >= 0) {
+         reference_block_num = cc.head_block_num();
+         if (reference_block_num <= (uint32_t)txn_reference_block_lag) {
+            reference_block_num = 0;
+         } else {
+            reference_block_num -= (uint32_t)txn_reference_block_lag;
+         }
+      }
+      return cc.get_block_id_for_num(reference_block_num);
+   }
+
    void arm_timer(boost::asio::high_resolution_timer::time_point s) {
       timer->expires_at(s + std::chrono::milliseconds(timer_timeout));
       boost::asio::post( *gen_ioc, [this]() {
@@ -352,17 +700,7 @@ struct txn_test_gen_plugin_impl {
 
          static uint64_t nonce = static_cast<uint64_t>(fc::time_point::now().sec_since_epoch()) << 32;
 
-         uint32_t reference_block_num = cc.last_irreversible_block_num();
-         if (txn_reference_block_lag >= 0) {
-            reference_block_num = cc.head_block_num();
-            if (reference_block_num <= (uint32_t)txn_reference_block_lag) {
-               reference_block_num = 0;
-            } else {
-               reference_block_num -= (uint32_t)txn_reference_block_lag;
-            }
-         }
-
-         block_id_type reference_block_id = cc.get_block_id_for_num(reference_block_num);
+         block_id_type reference_block_id = get_reference_block_id();
 
          for(unsigned int i = 0; i < batch; ++i) {
          {
@@ -370,7 +708,7 @@ struct txn_test_gen_plugin_impl {
          trx.actions.push_back(act_a_to_b);
          trx.context_free_actions.emplace_back(action({}, config::null_account_name, "nonce", fc::raw::pack( std::to_string(nonce_prefix)+std::to_string(nonce++) )));
          trx.set_reference_block(reference_block_id);
-         trx.expiration = cc.head_block_time() + fc::seconds(30);
+         trx.expiration = cc.head_block_time() + fc::seconds(trx_expiration_sec);
          trx.max_net_usage_words = 100;
          trx.sign(a_priv_key, chainid);
          trxs.emplace_back(std::move(trx));
@@ -381,7 +719,7 @@ struct txn_test_gen_plugin_impl {
          trx.actions.push_back(act_b_to_a);
          trx.context_free_actions.emplace_back(action({}, config::null_account_name, "nonce", fc::raw::pack( std::to_string(nonce_prefix)+std::to_string(nonce++) )));
          trx.set_reference_block(reference_block_id);
-         trx.expiration = cc.head_block_time() + fc::seconds(30);
+         trx.expiration = cc.head_block_time() + fc::seconds(trx_expiration_sec);
          trx.max_net_usage_words = 100;
          trx.sign(b_priv_key, chainid);
          trxs.emplace_back(std::move(trx));
@@ -414,6 +752,11 @@ struct txn_test_gen_plugin_impl {
          ilog("${d} transactions executed, ${t}us / transaction", ("d", _txcount)("t", _total_us / (double)_txcount));
          _txcount = _total_us = 0;
       }
+
+      const auto r = latency.report();
+      ilog("${s} transactions submitted, ${f} failed, ${x} expired; inclusion p50 ${i50}us p99 ${i99}us; irreversible p50 ${r50}us p99 ${r99}us",
+           ("s", r.submitted)("f", r.failed)("x", r.expired)("i50", r.inclusion.p50_us)("i99", r.inclusion.p99_us)
+           ("r50", r.irreversible.p50_us)("r99", r.irreversible.p99_us));
    }
 
    bool running{false};
@@ -425,6 +768,19 @@ struct txn_test_gen_plugin_impl {
    action act_a_to_b;
    action act_b_to_a;
 
+   struct load_action {
+      action                  act;
+      fc::crypto::private_key key;
+   };
+
+   std::vector<std::vector<load_action>> load_actions;  ///< per workload, one per pool account
+   std::vector<uint32_t>                 load_mix;      ///< workload index per weight slot
+   uint32_t                              load_rate = 0;
+   fc::microseconds                      load_duration;
+   uint64_t                              load_sent = 0;
+   uint64_t                              load_nonce = 0;
+   fc::time_point                        load_start;
+
    int32_t txn_reference_block_lag;
 };
 
@@ -454,10 +810,20 @@ void txn_test_gen_plugin::plugin_initialize(const variables_map& options) {
 }
 
 void txn_test_gen_plugin::plugin_startup() {
+   controller& cc = app().get_plugin<chain_plugin>().chain();
+   my->accepted_block_connection.emplace( cc.accepted_block.connect( [this]( const chain::block_state_ptr& bsp ) {
+      my->latency.on_accepted_block( bsp );
+   } ) );
+   my->irreversible_block_connection.emplace( cc.irreversible_block.connect( [this]( const chain::block_state_ptr& bsp ) {
+      my->latency.on_irreversible_block( bsp, fc::seconds( 2 * txn_test_gen_plugin_impl::trx_expiration_sec ) );
+   } ) );
+
    app().get_plugin<http_plugin>().add_api({
       CALL_ASYNC(txn_test_gen, my, create_test_accounts, INVOKE_ASYNC_R_R(my, create_test_accounts, std::string, std::string), 200),
       CALL(txn_test_gen, my, stop_generation, INVOKE_V_V(my, stop_generation), 200),
-      CALL(txn_test_gen, my, start_generation, INVOKE_V_R_R_R(my, start_generation, std::string, uint64_t, uint64_t), 200)
+      CALL(txn_test_gen, my, start_generation, INVOKE_V_R_R_R(my, start_generation, std::string, uint64_t, uint64_t), 200),
+      CALL(txn_test_gen, my, start_load, INVOKE_V_R(my, start_load, roxe::detail::txn_test_gen_load), 200),
+      CALL(txn_test_gen, my, get_report, INVOKE_R_V(my, get_report), 200)
    });
 }
 
@@ -467,6 +833,8 @@ void txn_test_gen_plugin::plugin_shutdown() {
    }
    catch(fc::exception& e) {
    }
+   my->accepted_block_connection.reset();
+   my->irreversible_block_connection.reset();
 }
 
 }
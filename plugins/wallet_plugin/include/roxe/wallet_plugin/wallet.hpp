@@ -183,6 +183,10 @@ class soft_wallet final : public wallet_api
       */
       fc::optional<signature_type> try_sign_digest( const digest_type digest, const public_key_type public_key ) override;
 
+      /* Signs the digests across all cores when there are enough of them to be worth it
+      */
+      fc::optional<std::vector<signature_type>> try_sign_digests( const std::vector<digest_type>& digests, const public_key_type public_key ) override;
+
       std::shared_ptr<detail::soft_wallet_impl> my;
       void encrypt_keys();
 };
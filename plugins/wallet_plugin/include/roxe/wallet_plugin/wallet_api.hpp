@@ -102,6 +102,21 @@ class wallet_api
       /** Returns a signature given the digest and public_key, if this wallet can sign via that public key
        */
       virtual fc::optional<signature_type> try_sign_digest( const digest_type digest, const public_key_type public_key ) = 0;
+
+      /** Returns one signature per digest, in order, if this wallet can sign via that public key. Wallets that
+       *  can do better than signing the digests one at a time override this
+       */
+      virtual fc::optional<std::vector<signature_type>> try_sign_digests( const std::vector<digest_type>& digests, const public_key_type public_key ) {
+         std::vector<signature_type> sigs;
+         sigs.reserve(digests.size());
+         for( const auto& digest : digests ) {
+            fc::optional<signature_type> sig = try_sign_digest(digest, public_key);
+            if( !sig )
+               return fc::optional<std::vector<signature_type>>{};
+            sigs.push_back(*sig);
+         }
+         return sigs;
+      }
 };
 
 }}
@@ -54,6 +54,17 @@ public:
    chain::signed_transaction sign_transaction(const chain::signed_transaction& txn, const flat_set<public_key_type>& keys,
                                              const chain::chain_id_type& id);
 
+   /// Sign many transactions with the same keys in one call, see sign_transaction. Every key signs all the
+   /// digests at once, see sign_digests.
+   /// @param txns the transactions to sign.
+   /// @param keys the public keys of the corresponding private keys to sign every transaction with
+   /// @param id the chain_id to sign transactions with.
+   /// @return txns signed, in the same order
+   /// @throws fc::exception if corresponding private keys not found in unlocked wallets
+   std::vector<chain::signed_transaction> sign_transactions(const std::vector<chain::signed_transaction>& txns,
+                                                            const flat_set<public_key_type>& keys,
+                                                            const chain::chain_id_type& id);
+
 
    /// Sign digest with the private keys specified via their public keys.
    /// @param digest the digest to sign.
@@ -62,6 +73,14 @@ public:
    /// @throws fc::exception if corresponding private keys not found in unlocked wallets
    chain::signature_type sign_digest(const chain::digest_type& digest, const public_key_type& key);
 
+   /// Sign many digests with the private key specified via its public key. Soft wallets spread the work
+   /// across all cores, and YubiHSM wallets pipeline the requests to the device.
+   /// @param digests the digests to sign.
+   /// @param key the public key of the corresponding private key to sign the digests with
+   /// @return one signature per digest, in order
+   /// @throws fc::exception if corresponding private key not found in unlocked wallets
+   std::vector<chain::signature_type> sign_digests(const std::vector<chain::digest_type>& digests, const public_key_type& key);
+
    /// Create a new wallet.
    /// A new wallet is created in file dir/{name}.wallet see set_dir.
    /// The new wallet is unlocked after creation.
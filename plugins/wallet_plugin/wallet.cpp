@@ -12,6 +12,7 @@
 #include <sstream>
 #include <string>
 #include <list>
+#include <thread>
 
 #include <fc/container/deque.hpp>
 #include <fc/crypto/elliptic.hpp>
@@ -135,6 +136,47 @@ public:
       return it->second.sign(digest);
    }
 
+   fc::optional<std::vector<signature_type>> try_sign_digests( const std::vector<digest_type>& digests, const public_key_type public_key ) {
+      auto it = _keys.find(public_key);
+      if( it == _keys.end() )
+         return fc::optional<std::vector<signature_type>>{};
+
+      // the workers only read the key in place, so no copy of it outlives the call; below this many
+      // digests per core starting threads costs more than it saves
+      const private_key_type& key = it->second;
+      const size_t min_digests_per_thread = 16;
+      const size_t threads = std::min<size_t>( std::max(1u, std::thread::hardware_concurrency()),
+                                               digests.size() / min_digests_per_thread );
+      std::vector<signature_type> sigs(digests.size());
+      auto sign_range = [&]( size_t first, size_t last ) {
+         for( size_t i = first; i < last; ++i )
+            sigs[i] = key.sign(digests[i]);
+      };
+      if( threads <= 1 ) {
+         sign_range(0, digests.size());
+         return sigs;
+      }
+
+      std::vector<std::thread> workers;
+      std::vector<std::exception_ptr> errors(threads);
+      const size_t per_thread = (digests.size() + threads - 1) / threads;
+      for( size_t t = 0; t < threads; ++t ) {
+         workers.emplace_back( [&, t]() {
+            try {
+               sign_range( t * per_thread, std::min(digests.size(), (t + 1) * per_thread) );
+            } catch( ... ) {
+               errors[t] = std::current_exception();
+            }
+         });
+      }
+      for( auto& w : workers )
+         w.join();
+      for( const auto& e : errors )
+         if( e )
+            std::rethrow_exception(e);
+      return sigs;
+   }
+
    private_key_type get_private_key(const public_key_type& id)const
    {
       auto has_key = try_get_private_key( id );
@@ -405,6 +447,10 @@ fc::optional<signature_type> soft_wallet::try_sign_digest( const digest_type dig
    return my->try_sign_digest(digest, public_key);
 }
 
+fc::optional<std::vector<signature_type>> soft_wallet::try_sign_digests( const std::vector<digest_type>& digests, const public_key_type public_key ) {
+   return my->try_sign_digests(digests, public_key);
+}
+
 pair<public_key_type,private_key_type> soft_wallet::get_private_key_from_password( string account, string role, string password )const {
    auto seed = account + role + password;
    ROXE_ASSERT( seed.size(), wallet_exception, "seed should not be empty" );
@@ -232,12 +232,13 @@ chain::signed_transaction
 wallet_manager::sign_transaction(const chain::signed_transaction& txn, const flat_set<public_key_type>& keys, const chain::chain_id_type& id) {
    check_timeout();
    chain::signed_transaction stxn(txn);
+   const auto digest = stxn.sig_digest(id, stxn.context_free_data);
 
    for (const auto& pk : keys) {
       bool found = false;
       for (const auto& i : wallets) {
          if (!i.second->is_locked()) {
-            fc::optional<signature_type> sig = i.second->try_sign_digest(stxn.sig_digest(id, stxn.context_free_data), pk);
+            fc::optional<signature_type> sig = i.second->try_sign_digest(digest, pk);
             if (sig) {
                stxn.signatures.push_back(*sig);
                found = true;
@@ -253,6 +254,39 @@ wallet_manager::sign_transaction(const chain::signed_transaction& txn, const fla
    return stxn;
 }
 
+std::vector<chain::signed_transaction>
+wallet_manager::sign_transactions(const std::vector<chain::signed_transaction>& txns, const flat_set<public_key_type>& keys, const chain::chain_id_type& id) {
+   check_timeout();
+   std::vector<chain::signed_transaction> signed_txns(txns);
+   std::vector<chain::digest_type> digests;
+   digests.reserve(signed_txns.size());
+   for (const auto& stxn : signed_txns)
+      digests.push_back(stxn.sig_digest(id, stxn.context_free_data));
+
+   for (const auto& pk : keys) {
+      const auto sigs = sign_digests(digests, pk);
+      for (size_t i = 0; i < signed_txns.size(); ++i)
+         signed_txns[i].signatures.push_back(sigs[i]);
+   }
+
+   return signed_txns;
+}
+
+std::vector<chain::signature_type>
+wallet_manager::sign_digests(const std::vector<chain::digest_type>& digests, const public_key_type& key) {
+   check_timeout();
+
+   for (const auto& i : wallets) {
+      if (!i.second->is_locked()) {
+         fc::optional<std::vector<signature_type>> sigs = i.second->try_sign_digests(digests, key);
+         if (sigs)
+            return std::move(*sigs);
+      }
+   }
+
+   ROXE_THROW(chain::wallet_missing_pub_key_exception, "Public key not found in unlocked wallets ${k}", ("k", key));
+}
+
 chain::signature_type
 wallet_manager::sign_digest(const chain::digest_type& digest, const public_key_type& key) {
    check_timeout();
@@ -17,6 +17,8 @@
 
 #include <dlfcn.h>
 
+#include <future>
+
 namespace roxe { namespace wallet {
 
 using namespace fc::crypto::r1;
@@ -144,24 +146,54 @@ struct yubihsm_wallet_impl {
       if(it == _keys.end())
          return fc::optional<signature_type>{};
 
+      return der_to_signature(it->first, sign_der(it->second, d), d);
+   }
+
+   /// While the device computes a signature, the previous one (whose public key recovery is the costly part
+   /// of the conversion) is converted on another thread
+   fc::optional<std::vector<signature_type>> try_sign_digests(const std::vector<digest_type>& digests, const public_key_type public_key) {
+      auto it = _keys.find(public_key);
+      if(it == _keys.end())
+         return fc::optional<std::vector<signature_type>>{};
+
+      std::vector<signature_type> sigs(digests.size());
+      std::future<void> converting;
+      for(size_t i = 0; i < digests.size(); ++i) {
+         std::vector<uint8_t> der_sig = sign_der(it->second, digests[i]);
+         if(converting.valid())
+            converting.get();
+         converting = std::async(std::launch::async, [this, &sigs, &digests, i, der_sig{std::move(der_sig)}, &pub = it->first]() {
+            sigs[i] = der_to_signature(pub, der_sig, digests[i]);
+         });
+      }
+      if(converting.valid())
+         converting.get();
+      return sigs;
+   }
+
+   std::vector<uint8_t> sign_der(uint16_t key_id, const digest_type& d) {
       size_t der_sig_sz = 128;
-      uint8_t der_sig[der_sig_sz];
+      std::vector<uint8_t> der_sig(der_sig_sz);
       yh_rc rc;
-      if((rc = yh_util_sign_ecdsa(session, it->second, (uint8_t*)d.data(), d.data_size(), der_sig, &der_sig_sz))) {
+      if((rc = yh_util_sign_ecdsa(session, key_id, (uint8_t*)d.data(), d.data_size(), der_sig.data(), &der_sig_sz))) {
          lock();
          FC_THROW_EXCEPTION(chain::wallet_exception, "yh_util_sign_ecdsa failed: ${m}", ("m", yh_strerror(rc)));
       }
+      der_sig.resize(der_sig_sz);
+      return der_sig;
+   }
 
+   signature_type der_to_signature(const public_key_type& pub, const std::vector<uint8_t>& der_sig, const digest_type& d) {
       ///XXX a lot of this below is similar to SE wallet; commonize it in non-junky way
       fc::ecdsa_sig sig = ECDSA_SIG_new();
       BIGNUM *r = BN_new(), *s = BN_new();
-      BN_bin2bn(der_sig+4, der_sig[3], r);
-      BN_bin2bn(der_sig+6+der_sig[3], der_sig[4+der_sig[3]+1], s);
+      BN_bin2bn(der_sig.data()+4, der_sig[3], r);
+      BN_bin2bn(der_sig.data()+6+der_sig[3], der_sig[4+der_sig[3]+1], s);
       ECDSA_SIG_set0(sig, r, s);
 
       char pub_key_shim_data[64];
       fc::datastream<char *> eds(pub_key_shim_data, sizeof(pub_key_shim_data));
-      fc::raw::pack(eds, it->first);
+      fc::raw::pack(eds, pub);
       public_key_data* kd = (public_key_data*)(pub_key_shim_data+1);
 
       compact_signature compact_sig;
@@ -269,4 +301,8 @@ fc::optional<signature_type> yubihsm_wallet::try_sign_digest(const digest_type d
    return my->try_sign_digest(digest, public_key);
 }
 
+fc::optional<std::vector<signature_type>> yubihsm_wallet::try_sign_digests(const std::vector<digest_type>& digests, const public_key_type public_key) {
+   return my->try_sign_digests(digests, public_key);
+}
+
 }}
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <istream>
+#include <map>
 #include <ostream>
 #include <string>
 #include <regex>
@@ -30,9 +31,29 @@ using namespace roxe::chain;
 namespace roxe { namespace client { namespace http {
 
    namespace detail {
+      /// An open connection to one server; only one of the sockets is set, depending on the url scheme
+      struct http_connection {
+         std::unique_ptr<boost::asio::local::stream_protocol::socket>        unix_socket;
+         std::unique_ptr<tcp::socket>                                        tcp_socket;
+         std::unique_ptr<boost::asio::ssl::context>                          ssl_context;
+         std::unique_ptr<boost::asio::ssl::stream<tcp::socket>>              ssl_socket;
+
+         ~http_connection() {
+            //try and do a clean shutdown; but swallow if this fails (other side could have already gave TCP the ax)
+            if( ssl_socket ) {
+               try {ssl_socket->shutdown();} catch(...) {}
+            }
+         }
+      };
+
       class http_context_impl {
          public:
             boost::asio::io_service ios;
+
+            bool keep_alive = false;
+            /// connections kept open between calls while keep_alive is set, keyed by scheme, server and port
+            std::map<string, std::unique_ptr<http_connection>> connections;
+            std::map<string, resolved_url>                      resolved;
       };
 
       void http_context_deleter::operator()(http_context_impl* p) const {
@@ -44,6 +65,14 @@ namespace roxe { namespace client { namespace http {
       return http_context(new detail::http_context_impl, detail::http_context_deleter());
    }
 
+   void set_keep_alive( const http_context& context, bool keep_alive ) {
+      context->keep_alive = keep_alive;
+      if( !keep_alive ) {
+         context->connections.clear();
+         context->resolved.clear();
+      }
+   }
+
    void do_connect(tcp::socket& sock, const resolved_url& url) {
       // Get a list of endpoints corresponding to the server name.
       vector<tcp::endpoint> endpoints;
@@ -54,16 +83,54 @@ namespace roxe { namespace client { namespace http {
       boost::asio::connect(sock, endpoints);
    }
 
+   /// A connection kept from an earlier call turned out to be closed before anything of the response was read
+   struct dropped_connection {};
+
    template<class T>
-   std::string do_txrx(T& socket, boost::asio::streambuf& request_buff, unsigned int& status_code) {
-      // Send the request.
-      boost::asio::write(socket, request_buff);
+   std::string read_chunked_body(T& socket, boost::asio::streambuf& response) {
+      std::istream response_stream(&response);
+      std::string body;
+      for(;;) {
+         boost::asio::read_until(socket, response, "\r\n");
+         std::string size_line;
+         std::getline(response_stream, size_line);
+         const size_t chunk_size = std::stoul(size_line, nullptr, 16);
+         // the chunk is followed by a CRLF, and the last (empty) one by the trailers and a blank line
+         if( chunk_size == 0 ) {
+            boost::asio::read_until(socket, response, "\r\n");
+            std::string trailer;
+            while( std::getline(response_stream, trailer) && trailer != "\r" )
+               boost::asio::read_until(socket, response, "\r\n");
+            return body;
+         }
+         if( response.size() < chunk_size + 2 )
+            boost::asio::read(socket, response, boost::asio::transfer_exactly(chunk_size + 2 - response.size()));
+         const size_t offset = body.size();
+         body.resize(offset + chunk_size + 2);
+         response_stream.read(&body[offset], chunk_size + 2);
+         body.resize(offset + chunk_size);
+      }
+   }
 
+   /**
+    * Sends the request and reads the response. `keep_open` is set when the server allows the connection to be used
+    * for another request. With `reused` set, a connection the server already closed throws dropped_connection.
+    */
+   template<class T>
+   std::string do_txrx(T& socket, const std::string& request, unsigned int& status_code, bool reused, bool& keep_open) {
       // Read the response status line. The response streambuf will automatically
       // grow to accommodate the entire line. The growth may be limited by passing
       // a maximum size to the streambuf constructor.
       boost::asio::streambuf response;
-      boost::asio::read_until(socket, response, "\r\n");
+      try {
+         // Send the request.
+         boost::asio::write(socket, boost::asio::buffer(request));
+         boost::asio::read_until(socket, response, "\r\n");
+      } catch( const boost::system::system_error& ) {
+         if( reused && response.size() == 0 )
+            throw dropped_connection();
+         throw;
+      }
 
       // Check that response is OK.
       std::istream response_stream(&response);
@@ -83,20 +150,31 @@ namespace roxe { namespace client { namespace http {
       // Process the response headers.
       std::string header;
       int response_content_length = -1;
+      bool chunked = false;
+      keep_open = http_version.substr(5) != "1.0";
       std::regex clregex(R"xx(^content-length:\s+(\d+))xx", std::regex_constants::icase);
+      std::regex connregex(R"xx(^connection:\s+(\S+))xx", std::regex_constants::icase);
+      std::regex teregex(R"xx(^transfer-encoding:\s+chunked)xx", std::regex_constants::icase);
       while (std::getline(response_stream, header) && header != "\r") {
          std::smatch match;
          if(std::regex_search(header, match, clregex))
             response_content_length = std::stoi(match[1]);
+         else if(std::regex_search(header, match, connregex))
+            keep_open = boost::iequals(match.str(1), "keep-alive");
+         else if(std::regex_search(header, teregex))
+            chunked = true;
       }
 
       // Attempt to read the response body using the length indicated by the
       // Content-length header. If the header was not present just read all available bytes.
-      if( response_content_length != -1 ) {
+      if( chunked ) {
+         return read_chunked_body(socket, response);
+      } else if( response_content_length != -1 ) {
          response_content_length -= response.size();
          if( response_content_length > 0 )
             boost::asio::read(socket, response, boost::asio::transfer_exactly(response_content_length));
       } else {
+         keep_open = false;
          boost::system::error_code ec;
          boost::asio::read(socket, response, boost::asio::transfer_all(), ec);
          ROXE_ASSERT(!ec || ec == boost::asio::ssl::error::stream_truncated, http_exception, "Unable to read http response: ${err}", ("err",ec.message()));
@@ -141,6 +219,15 @@ namespace roxe { namespace client { namespace http {
       if(url.scheme == "unix")
          return resolved_url(url);
 
+      if( context->keep_alive ) {
+         auto itr = context->resolved.find(url.server + ":" + url.port);
+         if( itr != context->resolved.end() ) {
+            resolved_url res = itr->second;
+            static_cast<parsed_url&>(res) = url;
+            return res;
+         }
+      }
+
       tcp::resolver resolver(context->ios);
       boost::system::error_code ec;
       auto result = resolver.resolve(tcp::v4(), url.server, url.port, ec);
@@ -168,7 +255,10 @@ namespace roxe { namespace client { namespace http {
          }
       }
 
-      return resolved_url(url, std::move(resolved_addresses), *resolved_port, is_loopback);
+      resolved_url res(url, std::move(resolved_addresses), *resolved_port, is_loopback);
+      if( context->keep_alive )
+         context->resolved.emplace(url.server + ":" + url.port, res);
+      return res;
    }
 
    string format_host_header(const resolved_url& url) {
@@ -183,6 +273,36 @@ namespace roxe { namespace client { namespace http {
       }
    }
 
+   detail::http_connection& open_connection( const connection_param& cp, const string& connection_key ) {
+      const auto& url = cp.url;
+      auto conn = std::make_unique<detail::http_connection>();
+      if(url.scheme == "unix") {
+         conn->unix_socket = std::make_unique<boost::asio::local::stream_protocol::socket>(cp.context->ios);
+         conn->unix_socket->connect(boost::asio::local::stream_protocol::endpoint(url.server));
+      }
+      else if(url.scheme == "http") {
+         conn->tcp_socket = std::make_unique<tcp::socket>(cp.context->ios);
+         do_connect(*conn->tcp_socket, url);
+      }
+      else { //https
+         conn->ssl_context = std::make_unique<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23_client);
+         fc::add_platform_root_cas_to_context(*conn->ssl_context);
+
+         conn->ssl_socket = std::make_unique<boost::asio::ssl::stream<tcp::socket>>(cp.context->ios, *conn->ssl_context);
+         auto& socket = *conn->ssl_socket;
+         SSL_set_tlsext_host_name(socket.native_handle(), url.server.c_str());
+         if(cp.verify_cert) {
+            socket.set_verify_mode(boost::asio::ssl::verify_peer);
+            socket.set_verify_callback(boost::asio::ssl::rfc2818_verification(url.server));
+         }
+         do_connect(socket.next_layer(), url);
+         socket.handshake(boost::asio::ssl::stream_base::client);
+      }
+      auto& res = *conn;
+      cp.context->connections[connection_key] = std::move(conn);
+      return res;
+   }
+
    fc::variant do_http_call( const connection_param& cp,
                              const fc::variant& postdata,
                              bool print_request,
@@ -194,14 +314,14 @@ namespace roxe { namespace client { namespace http {
 
    const auto& url = cp.url;
 
-   boost::asio::streambuf request;
-   std::ostream request_stream(&request);
+   auto& ctx = *cp.context;
+   std::ostringstream request_stream;
    auto host_header_value = format_host_header(url);
-   request_stream << "POST " << url.path << " HTTP/1.0\r\n";
+   request_stream << "POST " << url.path << (ctx.keep_alive ? " HTTP/1.1\r\n" : " HTTP/1.0\r\n");
    request_stream << "Host: " << host_header_value << "\r\n";
    request_stream << "content-length: " << postjson.size() << "\r\n";
    request_stream << "Accept: */*\r\n";
-   request_stream << "Connection: close\r\n";
+   request_stream << (ctx.keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
    // append more customized headers
    std::vector<string>::iterator itr;
    for (itr = cp.headers.begin(); itr != cp.headers.end(); itr++) {
@@ -209,45 +329,43 @@ namespace roxe { namespace client { namespace http {
    }
    request_stream << "\r\n";
    request_stream << postjson;
+   const std::string request = request_stream.str();
 
    if ( print_request ) {
-      string s(request.size(), '\0');
-      buffer_copy(boost::asio::buffer(s), request.data());
       std::cerr << "REQUEST:" << std::endl
                 << "---------------------" << std::endl
-                << s << std::endl
+                << request << std::endl
                 << "---------------------" << std::endl;
    }
 
    unsigned int status_code;
    std::string re;
 
+   const string connection_key = url.scheme + "://" + url.server + ":" + url.port;
    try {
-      if(url.scheme == "unix") {
-         boost::asio::local::stream_protocol::socket unix_socket(cp.context->ios);
-         unix_socket.connect(boost::asio::local::stream_protocol::endpoint(url.server));
-         re = do_txrx(unix_socket, request, status_code);
-      }
-      else if(url.scheme == "http") {
-         tcp::socket socket(cp.context->ios);
-         do_connect(socket, url);
-         re = do_txrx(socket, request, status_code);
-      }
-      else { //https
-         boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23_client);
-         fc::add_platform_root_cas_to_context(ssl_context);
-
-         boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket(cp.context->ios, ssl_context);
-         SSL_set_tlsext_host_name(socket.native_handle(), url.server.c_str());
-         if(cp.verify_cert) {
-            socket.set_verify_mode(boost::asio::ssl::verify_peer);
-            socket.set_verify_callback(boost::asio::ssl::rfc2818_verification(url.server));
+      for(;;) {
+         auto existing = ctx.connections.find(connection_key);
+         const bool reused = existing != ctx.connections.end();
+         auto& conn = reused ? *existing->second : open_connection(cp, connection_key);
+         bool keep_open = false;
+         try {
+            if(conn.unix_socket)
+               re = do_txrx(*conn.unix_socket, request, status_code, reused, keep_open);
+            else if(conn.tcp_socket)
+               re = do_txrx(*conn.tcp_socket, request, status_code, reused, keep_open);
+            else
+               re = do_txrx(*conn.ssl_socket, request, status_code, reused, keep_open);
+         } catch( const dropped_connection& ) {
+            // the server closed the connection kept from an earlier call before reading this request; reconnect
+            ctx.connections.erase(connection_key);
+            continue;
+         } catch( ... ) {
+            ctx.connections.erase(connection_key);
+            throw;
          }
-         do_connect(socket.next_layer(), url);
-         socket.handshake(boost::asio::ssl::stream_base::client);
-         re = do_txrx(socket, request, status_code);
-         //try and do a clean shutdown; but swallow if this fails (other side could have already gave TCP the ax)
-         try {socket.shutdown();} catch(...) {}
+         if( !ctx.keep_alive || !keep_open )
+            ctx.connections.erase(connection_key);
+         break;
       }
    } catch ( invalid_http_request& e ) {
       e.append_log( FC_LOG_MESSAGE( info, "Please verify this url is valid: ${url}", ("url", url.scheme + "://" + url.server + ":" + url.port + url.path) ) );
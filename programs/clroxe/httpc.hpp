@@ -20,6 +20,10 @@ namespace roxe { namespace client { namespace http {
 
    http_context create_http_context();
 
+   /// With keep_alive set, calls through `context` reuse the connection to a server (and its resolved address)
+   /// for as long as the server keeps it open; turning it off closes the kept connections
+   void set_keep_alive( const http_context& context, bool keep_alive );
+
    struct parsed_url {
       string scheme;
       string server;
@@ -130,6 +134,7 @@ namespace roxe { namespace client { namespace http {
    const string wallet_remove_key = wallet_func_base + "/remove_key";
    const string wallet_create_key = wallet_func_base + "/create_key";
    const string wallet_sign_trx = wallet_func_base + "/sign_transaction";
+   const string wallet_sign_trxs = wallet_func_base + "/sign_transactions";
    const string kroxed_stop = "/v1/" + string(client::config::key_store_executable_name) + "/stop";
 
    FC_DECLARE_EXCEPTION( connection_exception, 1100000, "Connection Exception" );
@@ -305,30 +305,34 @@ void sign_transaction(signed_transaction& trx, fc::variant& required_keys, const
    trx = signed_trx.as<signed_transaction>();
 }
 
-fc::variant push_transaction( signed_transaction& trx, packed_transaction::compression_type compression = packed_transaction::none ) {
-   auto info = get_info();
+void set_transaction_headers( signed_transaction& trx, const roxe::chain_apis::read_only::get_info_results& info ) {
+   trx.expiration = info.head_block_time + tx_expiration;
 
-   if (trx.signatures.size() == 0) { // #5445 can't change txn content if already signed
-      trx.expiration = info.head_block_time + tx_expiration;
+   // Set tapos, default to last irreversible block if it's not specified by the user
+   block_id_type ref_block_id = info.last_irreversible_block_id;
+   try {
+      fc::variant ref_block;
+      if (!tx_ref_block_num_or_id.empty()) {
+         ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id));
+         ref_block_id = ref_block["id"].as<block_id_type>();
+      }
+   } ROXE_RETHROW_EXCEPTIONS(invalid_ref_block_exception, "Invalid reference block num or id: ${block_num_or_id}", ("block_num_or_id", tx_ref_block_num_or_id));
+   trx.set_reference_block(ref_block_id);
 
-      // Set tapos, default to last irreversible block if it's not specified by the user
-      block_id_type ref_block_id = info.last_irreversible_block_id;
-      try {
-         fc::variant ref_block;
-         if (!tx_ref_block_num_or_id.empty()) {
-            ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id));
-            ref_block_id = ref_block["id"].as<block_id_type>();
-         }
-      } ROXE_RETHROW_EXCEPTIONS(invalid_ref_block_exception, "Invalid reference block num or id: ${block_num_or_id}", ("block_num_or_id", tx_ref_block_num_or_id));
-      trx.set_reference_block(ref_block_id);
+   if (tx_force_unique) {
+      trx.context_free_actions.emplace_back( generate_nonce_action() );
+   }
 
-      if (tx_force_unique) {
-         trx.context_free_actions.emplace_back( generate_nonce_action() );
-      }
+   trx.max_cpu_usage_ms = tx_max_cpu_usage;
+   trx.max_net_usage_words = (tx_max_net_usage + 7)/8;
+   trx.delay_sec = delaysec;
+}
 
-      trx.max_cpu_usage_ms = tx_max_cpu_usage;
-      trx.max_net_usage_words = (tx_max_net_usage + 7)/8;
-      trx.delay_sec = delaysec;
+fc::variant push_transaction( signed_transaction& trx, packed_transaction::compression_type compression = packed_transaction::none ) {
+   auto info = get_info();
+
+   if (trx.signatures.size() == 0) { // #5445 can't change txn content if already signed
+      set_transaction_headers(trx, info);
    }
 
    if (!tx_skip_sign) {
@@ -347,6 +351,97 @@ fc::variant push_transaction( signed_transaction& trx, packed_transaction::compr
    }
 }
 
+/**
+ * Pushes many transactions over connections kept alive between calls, `batch_size` per push_transactions call.
+ * The chain info and reference block, and the wallet's public keys, are fetched once (the chain info again once
+ * half the expiration has passed); required keys once per distinct set of authorizations; and every batch is
+ * signed with one sign_transactions call per distinct set of required keys.
+ */
+fc::variants push_transactions( vector<signed_transaction>& trxs, size_t batch_size, packed_transaction::compression_type compression = packed_transaction::none ) {
+   roxe::client::http::set_keep_alive(context, true);
+
+   auto info = get_info();
+   auto info_time = fc::time_point::now();
+   fc::variant public_keys;
+   if (!tx_skip_sign)
+      public_keys = call(wallet_url, wallet_public_keys);
+   map<string, fc::variant> required_keys_by_auth;
+   bool bulk_signing = true;
+
+   fc::variants results;
+   for (size_t first = 0; first < trxs.size(); first += batch_size) {
+      const size_t last = std::min(first + batch_size, trxs.size());
+      if (fc::time_point::now() - info_time > fc::microseconds(tx_expiration.count() / 2)) {
+         info = get_info();
+         info_time = fc::time_point::now();
+      }
+
+      // transactions are grouped by the keys that have to sign them
+      map<string, vector<size_t>> by_keys;
+      for (size_t i = first; i < last; ++i) {
+         auto& trx = trxs[i];
+         if (!trx.signatures.empty())
+            continue;
+         set_transaction_headers(trx, info);
+         if (tx_skip_sign)
+            continue;
+
+         vector<permission_level> auths;
+         for (const auto& act : trx.actions)
+            auths.insert(auths.end(), act.authorization.begin(), act.authorization.end());
+         std::sort(auths.begin(), auths.end());
+         auths.erase(std::unique(auths.begin(), auths.end()), auths.end());
+         const auto auth_key = fc::json::to_string(fc::mutable_variant_object("auths", auths)("delay_sec", trx.delay_sec));
+         auto itr = required_keys_by_auth.find(auth_key);
+         if (itr == required_keys_by_auth.end()) {
+            auto get_arg = fc::mutable_variant_object
+                    ("transaction", (transaction)trx)
+                    ("available_keys", public_keys);
+            itr = required_keys_by_auth.emplace(auth_key, call(get_required_keys, get_arg)["required_keys"]).first;
+         }
+         by_keys[fc::json::to_string(itr->second)].push_back(i);
+      }
+
+      for (const auto& group : by_keys) {
+         fc::variant keys = fc::json::from_string(group.first);
+         if (bulk_signing) {
+            try {
+               vector<signed_transaction> unsigned_trxs;
+               for (auto i : group.second)
+                  unsigned_trxs.push_back(trxs[i]);
+               fc::variants sign_args = {fc::variant(unsigned_trxs), keys, fc::variant(info.chain_id)};
+               auto signed_trxs = call(wallet_url, wallet_sign_trxs, sign_args).as<vector<signed_transaction>>();
+               for (size_t n = 0; n < group.second.size(); ++n)
+                  trxs[group.second[n]] = std::move(signed_trxs.at(n));
+               continue;
+            } catch (const chain::missing_wallet_api_plugin_exception&) {
+               // a key store without sign_transactions; sign one at a time from here on
+               bulk_signing = false;
+            }
+         }
+         for (auto i : group.second)
+            sign_transaction(trxs[i], keys, info.chain_id);
+      }
+
+      if (!tx_dont_broadcast) {
+         vector<packed_transaction> packed;
+         packed.reserve(last - first);
+         for (size_t i = first; i < last; ++i)
+            packed.emplace_back(trxs[i], compression);
+         auto batch_results = call(push_txns_func, packed).get_array();
+         results.insert(results.end(), batch_results.begin(), batch_results.end());
+      } else {
+         for (size_t i = first; i < last; ++i) {
+            if (!tx_return_packed)
+               results.emplace_back(trxs[i]);
+            else
+               results.emplace_back(packed_transaction(trxs[i], compression));
+         }
+      }
+   }
+   return results;
+}
+
 fc::variant push_actions(std::vector<chain::action>&& actions, packed_transaction::compression_type compression = packed_transaction::none ) {
    signed_transaction trx;
    trx.actions = std::forward<decltype(actions)>(actions);
@@ -3394,6 +3489,34 @@ int main( int argc, char** argv ) {
    });
 
 
+   // push batch
+   string batchJson;
+   size_t batch_size = 100;
+   auto batchSubcommand = push->add_subcommand("batch", localized("Push many JSON transactions from a file, reusing connections and signing in bulk"));
+   batchSubcommand->add_option("transactions", batchJson, localized("The JSON string or filename defining the array of the transactions to push"))->required();
+   batchSubcommand->add_option("--batch-size", batch_size, localized("The number of transactions pushed per request"), true);
+   add_standard_transaction_options(batchSubcommand);
+   batchSubcommand->set_callback([&] {
+      ROXE_ASSERT( batch_size > 0, transaction_type_exception, "--batch-size must be positive" );
+      fc::variant trxs_var;
+      try {
+         trxs_var = json_from_file_or_string(batchJson);
+      } ROXE_RETHROW_EXCEPTIONS(transaction_type_exception, "Fail to parse transaction JSON '${data}'", ("data",batchJson))
+      vector<signed_transaction> trxs;
+      for (const auto& trx_var : trxs_var.get_array()) {
+         try {
+            trxs.push_back(trx_var.as<signed_transaction>());
+         } catch( fc::exception& ) {
+            // unable to convert so try via abi
+            signed_transaction trx;
+            abi_serializer::from_variant( trx_var, trx, abi_serializer_resolver, abi_serializer_max_time );
+            trxs.push_back(std::move(trx));
+         }
+      }
+      std::cout << fc::json::to_pretty_string(push_transactions(trxs, batch_size)) << std::endl;
+   });
+
+
    // multisig subcommand
    auto msig = app.add_subcommand("multisig", localized("Multisig contract commands"), false);
    msig->require_subcommand();
@@ -3,9 +3,13 @@
  *  @copyright defined in roxe/LICENSE.txt
  */
 #include <roxe/chain/abi_serializer.hpp>
+#include <roxe/chain/block_header_state.hpp>
 #include <roxe/chain/block_log.hpp>
+#include <roxe/chain/compressed_block_log.hpp>
 #include <roxe/chain/config.hpp>
-#include <roxe/chain/reversible_block_object.hpp>
+#include <roxe/chain/merkle.hpp>
+#include <roxe/chain/reversible_block_log.hpp>
+#include <roxe/chain/thread_utils.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/filesystem.hpp>
@@ -16,63 +20,191 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <deque>
+#include <sstream>
+
 using namespace roxe::chain;
 namespace bfs = boost::filesystem;
 namespace bpo = boost::program_options;
 using bpo::options_description;
 using bpo::variables_map;
 
+/// aggregates reported by --stats, computed without converting blocks to variants
+struct block_stats {
+   uint64_t                          blocks = 0;
+   uint64_t                          transactions = 0;
+   uint64_t                          deferred_transactions = 0; ///< receipts which only reference a transaction id
+   uint64_t                          actions = 0;
+   uint64_t                          context_free_actions = 0;
+   uint64_t                          total_block_bytes = 0;
+   uint64_t                          max_block_bytes = 0;
+   uint32_t                          max_block_num = 0;
+   std::map<account_name, uint64_t>  actions_per_contract;
+
+   void add( const signed_block& b, uint64_t packed_size ) {
+      ++blocks;
+      total_block_bytes += packed_size;
+      if( packed_size > max_block_bytes ) {
+         max_block_bytes = packed_size;
+         max_block_num = b.block_num();
+      }
+      for( const auto& receipt : b.transactions ) {
+         ++transactions;
+         if( !receipt.trx.contains<packed_transaction>() ) {
+            ++deferred_transactions;
+            continue;
+         }
+         const auto& trx = receipt.trx.get<packed_transaction>().get_transaction();
+         context_free_actions += trx.context_free_actions.size();
+         actions += trx.actions.size();
+         for( const auto& a : trx.actions )
+            ++actions_per_contract[a.account];
+      }
+   }
+
+   void merge( const block_stats& other ) {
+      blocks += other.blocks;
+      transactions += other.transactions;
+      deferred_transactions += other.deferred_transactions;
+      actions += other.actions;
+      context_free_actions += other.context_free_actions;
+      total_block_bytes += other.total_block_bytes;
+      if( other.max_block_bytes > max_block_bytes ) {
+         max_block_bytes = other.max_block_bytes;
+         max_block_num = other.max_block_num;
+      }
+      for( const auto& c : other.actions_per_contract )
+         actions_per_contract[c.first] += c.second;
+   }
+
+   fc::variant to_variant()const {
+      vector<std::pair<account_name, uint64_t>> contracts( actions_per_contract.begin(), actions_per_contract.end() );
+      std::sort( contracts.begin(), contracts.end(), []( const auto& a, const auto& b ) { return a.second > b.second; } );
+      fc::variants per_contract;
+      per_contract.reserve( contracts.size() );
+      for( const auto& c : contracts )
+         per_contract.emplace_back( fc::mutable_variant_object()( "contract", c.first )( "actions", c.second ) );
+
+      return fc::mutable_variant_object()
+            ( "blocks", blocks )
+            ( "transactions", transactions )
+            ( "deferred_transactions", deferred_transactions )
+            ( "actions", actions )
+            ( "context_free_actions", context_free_actions )
+            ( "total_block_bytes", total_block_bytes )
+            ( "average_block_bytes", blocks ? total_block_bytes / blocks : 0 )
+            ( "max_block_bytes", max_block_bytes )
+            ( "max_block_num", max_block_num )
+            ( "actions_per_contract", std::move( per_contract ) );
+   }
+};
+
+/// a batch of consecutive blocks checked on a worker thread by --verify
+struct verified_batch {
+   uint32_t                     first_num = 0;
+   block_id_type                first_previous;
+   block_id_type                last_id;
+   vector<signed_block_header>  headers;     ///< of the blocks checked, for the block header states advanced in order
+   uint32_t                     bad_block = 0; ///< the first block found bad, 0 if none
+   std::string                  error;
+};
+
+/// the producer signatures of a batch, checked on a worker thread against the keys of their block header states
+struct signature_batch {
+   vector<uint32_t>             nums;
+   vector<digest_type>          digests;
+   vector<signature_type>       signatures;
+   vector<public_key_type>      keys;
+};
+
+struct bad_block {
+   uint32_t     num = 0;
+   std::string  error;
+};
+
 struct blocklog {
    blocklog()
    {}
 
+   /// blocks handed to a worker thread at once
+   static const uint32_t batch_size = 256;
+
    void read_log();
+   void print_block( std::ostream& out, const signed_block& b )const;
+   void compress_log();
+   bool verify_log();
    void set_program_options(options_description& cli);
    void initialize(const variables_map& options);
 
    bfs::path                        blocks_dir;
    bfs::path                        output_file;
+   bfs::path                        compress_dir;
+   uint32_t                         blocks_per_chunk;
    uint32_t                         first_block;
    uint32_t                         last_block;
    bool                             no_pretty_print;
    bool                             as_json_array;
+   bool                             binary_output;
+   bool                             stats_only;
+   bool                             verify;
+   uint16_t                         threads;
 };
 
+void blocklog::print_block( std::ostream& out, const signed_block& b )const {
+   const fc::microseconds deadline = fc::seconds(10);
+   fc::variant pretty_output;
+   abi_serializer::to_variant(b,
+                              pretty_output,
+                              []( account_name n ) { return optional<abi_serializer>(); },
+                              deadline);
+   const auto block_id = b.id();
+   const uint32_t ref_block_prefix = block_id._hash[1];
+   const auto enhanced_object = fc::mutable_variant_object
+              ("block_num",b.block_num())
+              ("id", block_id)
+              ("ref_block_prefix", ref_block_prefix)
+              (pretty_output.get_object());
+   fc::variant v(std::move(enhanced_object));
+    if (no_pretty_print)
+       fc::json::to_stream(out, v, fc::json::stringify_large_ints_and_doubles);
+    else
+       out << fc::json::to_pretty_string(v) << "\n";
+}
+
 void blocklog::read_log() {
-   block_log block_logger(blocks_dir);
-   const auto end = block_logger.read_head();
+   optional<block_log> block_logger;
+   optional<compressed_block_log> compressed_logger;
+   std::function<signed_block_ptr(uint32_t)> read_block_by_num;
+   signed_block_ptr end;
+   if( !bfs::exists( blocks_dir / "blocks.log" ) && compressed_block_log::exists( blocks_dir ) ) {
+      ilog( "reading compressed block log" );
+      compressed_logger.emplace( blocks_dir );
+      end = compressed_logger->read_head();
+      read_block_by_num = [&]( uint32_t n ) { return compressed_logger->read_block_by_num( n ); };
+   } else {
+      block_logger.emplace( blocks_dir );
+      end = block_logger->read_head();
+      read_block_by_num = [&]( uint32_t n ) { return block_logger->read_block_by_num( n ); };
+   }
    ROXE_ASSERT( end, block_log_exception, "No blocks found in block log" );
    ROXE_ASSERT( end->block_num() > 1, block_log_exception, "Only one block found in block log" );
 
    ilog( "existing block log contains block num 1 through block num ${n}", ("n",end->block_num()) );
 
-   optional<chainbase::database> reversible_blocks;
-   try {
-      reversible_blocks.emplace(blocks_dir / config::reversible_blocks_dir_name, chainbase::database::read_only, config::default_reversible_cache_size);
-      reversible_blocks->add_index<reversible_block_index>();
-      const auto& idx = reversible_blocks->get_index<reversible_block_index,by_num>();
-      auto first = idx.lower_bound(end->block_num());
-      auto last = idx.rbegin();
-      if (first != idx.end() && last != idx.rend())
-         ilog( "existing reversible block num ${first} through block num ${last} ", ("first",first->get_block()->block_num())("last",last->get_block()->block_num()) );
-      else {
-         elog( "no blocks available in reversible block database: only block_log blocks are available" );
-         reversible_blocks.reset();
-      }
-   } catch( const std::runtime_error& e ) {
-      if( std::string(e.what()).find("database dirty flag set") != std::string::npos ) {
-         elog( "database dirty flag set (likely due to unclean shutdown): only block_log blocks are available" );
-      } else if( std::string(e.what()) == "database metadata dirty flag set" ) {
-         elog( "database metadata dirty flag set (likely due to unclean shutdown): only block_log blocks are available" );
-      } else {
-         throw;
-      }
+   optional<reversible_block_log> reversible_blocks;
+   reversible_blocks.emplace( blocks_dir / config::reversible_blocks_dir_name, true );
+   if( !reversible_blocks->empty() && reversible_blocks->last_block_num() > end->block_num() ) {
+      ilog( "existing reversible block num ${first} through block num ${last} ",
+            ("first", std::max(reversible_blocks->first_block_num(), end->block_num() + 1))("last", reversible_blocks->last_block_num()) );
+   } else {
+      elog( "no blocks available in reversible block log: only block_log blocks are available" );
+      reversible_blocks.reset();
    }
 
    std::ofstream output_blocks;
    std::ostream* out;
    if (!output_file.empty()) {
-      output_blocks.open(output_file.generic_string().c_str());
+      output_blocks.open(output_file.generic_string().c_str(), binary_output ? (std::ios::out | std::ios::binary) : std::ios::out);
       if (output_blocks.fail()) {
          std::ostringstream ss;
          ss << "Unable to open file '" << output_file.string() << "'";
@@ -83,53 +215,345 @@ void blocklog::read_log() {
    else
       out = &std::cout;
 
-   if (as_json_array)
-      *out << "[";
-   uint32_t block_num = (first_block < 1) ? 1 : first_block;
-   signed_block_ptr next;
-   fc::variant pretty_output;
-   const fc::microseconds deadline = fc::seconds(10);
-   auto print_block = [&](signed_block_ptr& next) {
-      abi_serializer::to_variant(*next,
-                                 pretty_output,
-                                 []( account_name n ) { return optional<abi_serializer>(); },
-                                 deadline);
-      const auto block_id = next->id();
-      const uint32_t ref_block_prefix = block_id._hash[1];
-      const auto enhanced_object = fc::mutable_variant_object
-                 ("block_num",next->block_num())
-                 ("id", block_id)
-                 ("ref_block_prefix", ref_block_prefix)
-                 (pretty_output.get_object());
-      fc::variant v(std::move(enhanced_object));
-       if (no_pretty_print)
-          fc::json::to_stream(*out, v, fc::json::stringify_large_ints_and_doubles);
-       else
-          *out << fc::json::to_pretty_string(v) << "\n";
+   // blocks are read in order on this thread, decoded in batches on the worker threads and written in order
+   auto read_packed_block = [&]( uint32_t n ) -> vector<char> {
+      if( block_logger && n <= end->block_num() )
+         return block_logger->read_serialized_block_by_num( n );
+      signed_block_ptr b;
+      if( n <= end->block_num() )
+         b = read_block_by_num( n );
+      else if( reversible_blocks )
+         b = reversible_blocks->read_block_by_num( n );
+      return b ? fc::raw::pack( *b ) : vector<char>();
    };
+
+   using batch_t = vector<vector<char>>;
+   auto unpack = []( const vector<char>& packed ) {
+      signed_block b;
+      fc::datastream<const char*> ds( packed.data(), packed.size() );
+      fc::raw::unpack( ds, b );
+      return b;
+   };
+   auto format_batch = [this, &unpack]( const batch_t& batch ) {
+      std::ostringstream ss;
+      for( size_t i = 0; i < batch.size(); ++i ) {
+         if( as_json_array && i > 0 )
+            ss << ",";
+         print_block( ss, unpack( batch[i] ) );
+      }
+      return ss.str();
+   };
+   auto batch_stats = [&unpack]( const batch_t& batch ) {
+      block_stats stats;
+      for( const auto& packed : batch )
+         stats.add( unpack( packed ), packed.size() );
+      return stats;
+   };
+
+   block_stats stats;
    bool contains_obj = false;
-   while((block_num <= last_block) && (next = block_logger.read_block_by_num( block_num ))) {
-      if (as_json_array && contains_obj)
+   auto write_batch = [&]( const std::string& text ) {
+      if( text.empty() ) return;
+      if( as_json_array && contains_obj )
          *out << ",";
-      print_block(next);
-      ++block_num;
+      *out << text;
       contains_obj = true;
-   }
-   if (reversible_blocks) {
-      const reversible_block_object* obj = nullptr;
-      while( (block_num <= last_block) && (obj = reversible_blocks->find<reversible_block_object,by_num>(block_num)) ) {
-         if (as_json_array && contains_obj)
-            *out << ",";
-         auto next = obj->get_block();
-         print_block(next);
+   };
+
+   optional<named_thread_pool> pool;
+   if( threads > 1 && !binary_output )
+      pool.emplace( "blklog", threads );
+   std::deque<std::future<std::string>> formatted;
+   std::deque<std::future<block_stats>> counted;
+   const size_t max_in_flight = threads * 2;
+
+   if (as_json_array && !stats_only && !binary_output)
+      *out << "[";
+   uint32_t block_num = (first_block < 1) ? 1 : first_block;
+   bool more = true;
+   while( more && block_num <= last_block ) {
+      batch_t batch;
+      batch.reserve( batch_size );
+      while( batch.size() < batch_size && block_num <= last_block ) {
+         auto packed = read_packed_block( block_num );
+         if( packed.empty() ) {
+            more = false;
+            break;
+         }
+         batch.emplace_back( std::move( packed ) );
          ++block_num;
-         contains_obj = true;
+      }
+      if( batch.empty() ) break;
+
+      if( binary_output ) {
+         for( const auto& packed : batch )
+            out->write( packed.data(), packed.size() );
+      } else if( !pool ) {
+         if( stats_only )
+            stats.merge( batch_stats( batch ) );
+         else
+            write_batch( format_batch( batch ) );
+      } else if( stats_only ) {
+         counted.emplace_back( async_thread_pool( pool->get_executor(), [&batch_stats, batch{std::move( batch )}]() { return batch_stats( batch ); } ) );
+         if( counted.size() >= max_in_flight ) {
+            stats.merge( counted.front().get() );
+            counted.pop_front();
+         }
+      } else {
+         formatted.emplace_back( async_thread_pool( pool->get_executor(), [&format_batch, batch{std::move( batch )}]() { return format_batch( batch ); } ) );
+         if( formatted.size() >= max_in_flight ) {
+            write_batch( formatted.front().get() );
+            formatted.pop_front();
+         }
       }
    }
-   if (as_json_array)
+   for( ; !counted.empty(); counted.pop_front() )
+      stats.merge( counted.front().get() );
+   for( ; !formatted.empty(); formatted.pop_front() )
+      write_batch( formatted.front().get() );
+
+   if( stats_only ) {
+      if( no_pretty_print )
+         fc::json::to_stream( *out, stats.to_variant(), fc::json::stringify_large_ints_and_doubles );
+      else
+         *out << fc::json::to_pretty_string( stats.to_variant() ) << "\n";
+   } else if (as_json_array && !binary_output)
       *out << "]";
 }
 
+void blocklog::compress_log() {
+   block_log source( blocks_dir );
+   const auto head = source.read_head();
+   ROXE_ASSERT( head, block_log_exception, "No blocks found in block log" );
+   const uint32_t first = source.first_block_num();
+   ilog( "compressing block num ${first} through block num ${n} into ${dir}",
+         ("first", first)("n", head->block_num())("dir", compress_dir.generic_string()) );
+
+   const auto start = fc::time_point::now();
+   {
+      compressed_block_log target( compress_dir, blocks_per_chunk );
+      target.reset( block_log::extract_genesis_state( blocks_dir ), first );
+      for( uint32_t n = first; n <= head->block_num(); ++n ) {
+         target.append( source.read_block_by_num( n ) );
+         if( n % 100000 == 0 )
+            ilog( "compressed block ${n}", ("n", n) );
+      }
+   }
+   const auto compress_time = fc::time_point::now() - start;
+
+   // read everything back, which verifies the result and measures sequential read throughput of both formats
+   compressed_block_log target( compress_dir );
+   ROXE_ASSERT( target.head_block_num() == head->block_num(), block_log_exception,
+                "Compressed block log ends at ${c} instead of ${n}", ("c", target.head_block_num())("n", head->block_num()) );
+
+   auto read_start = fc::time_point::now();
+   for( uint32_t n = first; n <= head->block_num(); ++n )
+      source.read_block_by_num( n );
+   const auto source_read_time = fc::time_point::now() - read_start;
+
+   read_start = fc::time_point::now();
+   for( uint32_t n = first; n <= head->block_num(); ++n ) {
+      const auto b = target.read_block_by_num( n );
+      ROXE_ASSERT( b && b->block_num() == n, block_log_exception, "Block ${n} could not be read back", ("n", n) );
+   }
+   const auto target_read_time = fc::time_point::now() - read_start;
+
+   const uint64_t source_bytes = bfs::file_size( blocks_dir / "blocks.log" ) + bfs::file_size( blocks_dir / "blocks.index" );
+   const uint64_t target_bytes = bfs::file_size( compress_dir / "blocks.zlog" ) + bfs::file_size( compress_dir / "blocks.zindex" );
+   const uint64_t blocks = head->block_num() - first + 1;
+   auto per_sec = [blocks]( const fc::microseconds& t ) { return t.count() ? blocks * 1000000 / t.count() : blocks; };
+   ilog( "compressed ${blocks} blocks in ${chunks} chunks in ${t} ms: ${src} bytes -> ${dst} bytes (${pct}%)",
+         ("blocks", blocks)("chunks", target.chunk_count())("t", compress_time.count() / 1000)
+         ("src", source_bytes)("dst", target_bytes)("pct", source_bytes ? target_bytes * 100 / source_bytes : 0) );
+   ilog( "sequential reads: block log ${s} blocks/s, compressed block log ${c} blocks/s",
+         ("s", per_sec( source_read_time ))("c", per_sec( target_read_time )) );
+}
+
+/**
+ * Checks every block of the log: that the index locates it exactly, that it links to the block before, its transaction
+ * merkle root and, for a log starting at genesis, its producer signature against the key the producer schedule
+ * expects. Batches of blocks are decoded and checked on the worker threads, the block header states are advanced in
+ * block order on this thread and the signatures recovered on the worker threads again.
+ *
+ * @return false if a bad block was found, which is reported
+ */
+bool blocklog::verify_log() {
+   block_log log( blocks_dir );
+   const auto head = log.read_head();
+   ROXE_ASSERT( head, block_log_exception, "No blocks found in block log" );
+   const uint32_t first = std::max( first_block, log.first_block_num() );
+   const uint32_t last = std::min( last_block, head->block_num() );
+   ROXE_ASSERT( first <= last, fc::invalid_arg_exception, "No blocks of the log in ${f} through ${l}", ("f", first_block)("l", last_block) );
+
+   // the header states, and so the producer signatures, can only be followed from genesis
+   optional<block_header_state> bhs;
+   if( first == 1 ) {
+      const auto genesis = block_log::extract_genesis_state( blocks_dir );
+      producer_schedule_type initial_schedule{ 0, {{config::system_account_name, genesis.initial_key}} };
+      bhs.emplace();
+      bhs->active_schedule                = initial_schedule;
+      bhs->pending_schedule.schedule      = initial_schedule;
+      bhs->pending_schedule.schedule_hash = fc::sha256::hash(initial_schedule);
+      bhs->header.timestamp               = genesis.initial_timestamp;
+      bhs->header.action_mroot            = genesis.compute_chain_id();
+      bhs->id                             = bhs->header.id();
+      bhs->block_num                      = bhs->header.block_num();
+      bhs->activated_protocol_features    = std::make_shared<protocol_feature_activation_set>();
+   } else {
+      wlog( "the log does not start at genesis, producer signatures are not verified" );
+   }
+   ilog( "verifying block num ${first} through block num ${last} with ${t} threads", ("first", first)("last", last)("t", threads) );
+
+   auto check_batch = []( uint32_t first_num, const vector<vector<char>>& batch ) {
+      verified_batch r;
+      r.first_num = first_num;
+      r.headers.reserve( batch.size() );
+      uint32_t n = first_num;
+      try {
+         for( const auto& packed : batch ) {
+            signed_block b;
+            fc::datastream<const char*> ds( packed.data(), packed.size() );
+            fc::raw::unpack( ds, b );
+            ROXE_ASSERT( ds.remaining() == 0, block_log_exception, "blocks.index does not match blocks.log, ${r} bytes after the block",
+                         ("r", ds.remaining()) );
+            ROXE_ASSERT( b.block_num() == n, block_log_exception, "blocks.index locates block ${b}", ("b", b.block_num()) );
+            ROXE_ASSERT( n == first_num || b.previous == r.last_id, block_log_exception, "previous ${p} is not the id ${i} of the block before",
+                         ("p", b.previous)("i", r.last_id) );
+            vector<digest_type> trx_digests;
+            trx_digests.reserve( b.transactions.size() );
+            for( const auto& receipt : b.transactions )
+               trx_digests.emplace_back( receipt.digest() );
+            ROXE_ASSERT( merkle( std::move( trx_digests ) ) == b.transaction_mroot, block_log_exception, "transaction merkle root does not match" );
+            if( n == first_num )
+               r.first_previous = b.previous;
+            r.last_id = b.id();
+            r.headers.emplace_back( static_cast<const signed_block_header&>( b ) );
+            ++n;
+         }
+      } catch( const fc::exception& e ) {
+         r.bad_block = n;
+         r.error = e.to_string();
+      }
+      return r;
+   };
+   auto check_signatures = []( const signature_batch& batch ) {
+      bad_block bad;
+      for( size_t i = 0; i < batch.nums.size(); ++i ) {
+         try {
+            public_key_type signee( batch.signatures[i], batch.digests[i], true );
+            if( signee == batch.keys[i] )
+               continue;
+            bad.error = "block not signed by the expected key " + std::string( batch.keys[i] ) + " but by " + std::string( signee );
+         } catch( const fc::exception& e ) {
+            bad.error = e.to_string();
+         }
+         bad.num = batch.nums[i];
+         break;
+      }
+      return bad;
+   };
+
+   named_thread_pool pool( "blklog", threads );
+   std::deque<std::future<verified_batch>> checked;
+   std::deque<std::future<bad_block>> signed_checked;
+   const size_t max_in_flight = threads * 2;
+   bad_block bad;
+   auto found = [&bad]( uint32_t num, const std::string& error ) {
+      if( !bad.num || num < bad.num )
+         bad = bad_block{ num, error };
+   };
+
+   // in block order: stitches the batches together and advances the header states
+   optional<block_id_type> last_id;
+   auto take_batch = [&]( verified_batch r ) {
+      if( bad.num && r.first_num > bad.num ) return;
+      if( last_id && r.first_previous != *last_id && !r.headers.empty() ) {
+         found( r.first_num, "previous " + r.first_previous.str() + " is not the id " + last_id->str() + " of the block before" );
+         return;
+      }
+      if( bhs ) {
+         signature_batch sigs;
+         uint32_t n = r.first_num;
+         for( const auto& h : r.headers ) {
+            try {
+               if( n == 1 ) {
+                  ROXE_ASSERT( h.id() == bhs->id, block_log_exception, "block 1 is not the genesis block of the genesis state in the log" );
+               } else {
+                  bhs = bhs->next( h, []( block_timestamp_type, const flat_set<digest_type>&, const vector<digest_type>& ) {}, true );
+                  sigs.nums.push_back( n );
+                  sigs.digests.push_back( bhs->sig_digest() );
+                  sigs.signatures.push_back( h.producer_signature );
+                  sigs.keys.push_back( bhs->block_signing_key );
+               }
+            } catch( const fc::exception& e ) {
+               found( n, e.to_string() );
+               bhs.reset();
+               break;
+            }
+            ++n;
+         }
+         if( !sigs.nums.empty() )
+            signed_checked.emplace_back( async_thread_pool( pool.get_executor(), [&check_signatures, sigs{std::move( sigs )}]() {
+               return check_signatures( sigs );
+            } ) );
+      }
+      if( r.bad_block ) {
+         found( r.bad_block, r.error );
+         return;
+      }
+      if( !r.headers.empty() )
+         last_id = r.last_id;
+   };
+   auto take_signatures = [&]( bad_block b ) {
+      if( b.num ) found( b.num, b.error );
+   };
+
+   uint32_t block_num = first;
+   uint64_t next_report = uint64_t( first ) + 1000000;
+   while( block_num <= last && !bad.num ) {
+      const uint32_t batch_first = block_num;
+      vector<vector<char>> batch;
+      batch.reserve( batch_size );
+      try {
+         while( batch.size() < batch_size && block_num <= last ) {
+            auto packed = log.read_serialized_block_by_num( block_num );
+            ROXE_ASSERT( !packed.empty(), block_log_exception, "block is missing from blocks.index" );
+            batch.emplace_back( std::move( packed ) );
+            ++block_num;
+         }
+      } catch( const fc::exception& e ) {
+         found( block_num, e.to_string() );
+      }
+      checked.emplace_back( async_thread_pool( pool.get_executor(), [&check_batch, batch_first, batch{std::move( batch )}]() {
+         return check_batch( batch_first, batch );
+      } ) );
+      while( checked.size() >= max_in_flight ) {
+         take_batch( checked.front().get() );
+         checked.pop_front();
+      }
+      while( signed_checked.size() >= max_in_flight ) {
+         take_signatures( signed_checked.front().get() );
+         signed_checked.pop_front();
+      }
+      if( block_num >= next_report ) {
+         ilog( "read block ${n}", ("n", block_num - 1) );
+         next_report += 1000000;
+      }
+   }
+   for( ; !checked.empty(); checked.pop_front() )
+      take_batch( checked.front().get() );
+   for( ; !signed_checked.empty(); signed_checked.pop_front() )
+      take_signatures( signed_checked.front().get() );
+
+   if( bad.num ) {
+      elog( "first bad block ${n}: ${e}", ("n", bad.num)("e", bad.error) );
+      return false;
+   }
+   ilog( "verified block num ${first} through block num ${last}${s}", ("first", first)("last", last)
+         ("s", first == 1 ? " including producer signatures" : "") );
+   return true;
+}
+
 void blocklog::set_program_options(options_description& cli)
 {
    cli.add_options()
@@ -145,6 +569,19 @@ void blocklog::set_program_options(options_description& cli)
           "Do not pretty print the output.  Useful if piping to jq to improve performance.")
          ("as-json-array", bpo::bool_switch(&as_json_array)->default_value(false),
           "Print out json blocks wrapped in json array (otherwise the output is free-standing json objects).")
+         ("compress-to", bpo::value<bfs::path>(),
+          "convert the block log into a compressed block log written to this directory, then report sizes and read throughput of both, instead of printing blocks")
+         ("blocks-per-chunk", bpo::value<uint32_t>(&blocks_per_chunk)->default_value(compressed_block_log::default_blocks_per_chunk),
+          "the number of blocks compressed together by --compress-to")
+         ("binary", bpo::bool_switch(&binary_output)->default_value(false),
+          "write the selected blocks in the portable binary format (packed blocks back to back) instead of JSON")
+         ("stats", bpo::bool_switch(&stats_only)->default_value(false),
+          "only report transaction, action and block size statistics of the selected blocks, without converting them to JSON")
+         ("verify", bpo::bool_switch(&verify)->default_value(false),
+          "check the log instead of printing blocks: index consistency, links to previous blocks, transaction merkle roots and, for a log starting at "
+          "genesis, producer signatures; reports the first bad block. Uses --threads worker threads.")
+         ("threads", bpo::value<uint16_t>(&threads)->default_value(1),
+          "the number of threads decoding blocks; the output is written in block order")
          ("help", "Print this help message and exit.")
          ;
 
@@ -165,6 +602,18 @@ void blocklog::initialize(const variables_map& options) {
          else
             output_file = bld;
       }
+
+      if (options.count( "compress-to" )) {
+         bld = options.at( "compress-to" ).as<bfs::path>();
+         if( bld.is_relative())
+            compress_dir = bfs::current_path() / bld;
+         else
+            compress_dir = bld;
+      }
+      ROXE_ASSERT( !(binary_output && stats_only), fc::invalid_arg_exception, "--binary and --stats cannot be combined" );
+      ROXE_ASSERT( threads > 0, fc::invalid_arg_exception, "--threads must be at least 1" );
+      ROXE_ASSERT( !(verify && (binary_output || stats_only || !compress_dir.empty())), fc::invalid_arg_exception,
+                   "--verify cannot be combined with --binary, --stats or --compress-to" );
    } FC_LOG_AND_RETHROW()
 
 }
@@ -185,7 +634,13 @@ int main(int argc, char** argv)
         return 0;
       }
       blog.initialize(vmap);
-      blog.read_log();
+      if (blog.verify) {
+         if (!blog.verify_log())
+            return -1;
+      } else if (blog.compress_dir.empty())
+         blog.read_log();
+      else
+         blog.compress_log();
    } catch( const fc::exception& e ) {
       elog( "${e}", ("e", e.to_detail_string()));
       return -1;
@@ -8,9 +8,15 @@
 #include <math.h>
 #include <sstream>
 #include <regex>
+#include <thread>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/program_options.hpp>
 #pragma GCC diagnostic push
@@ -29,6 +35,7 @@
 #include <fc/optional.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/reflect/variant.hpp>
+#include <fc/variant_object.hpp>
 #include <fc/log/logger_config.hpp>
 #include <ifaddrs.h>
 #include <sys/types.h>
@@ -52,6 +59,7 @@ using namespace roxe::launcher::config;
 
 const string block_dir = "blocks";
 const string shared_mem_dir = "state";
+const string bios_private_key = "5KiNH96ufjdDuYsnY9HUNNJHGcX9cJRctyFQovv9Hwsnzodu7YU";
 
 struct local_identity {
   vector <fc::ip::address> addrs;
@@ -249,6 +257,7 @@ public:
   roxed_def*       instance;
   string          gelf_endpoint;
   bool            dont_start = false;
+  string          tier;
 };
 
 void
@@ -328,6 +337,18 @@ struct last_run_def {
   vector <node_rt_info> running_nodes;
 };
 
+struct netem_profile {
+  uint32_t delay_ms = 0;
+  uint32_t jitter_ms = 0;
+  double   loss_pct = 0;
+};
+
+struct perf_usage {
+  bool     valid = false;
+  double   cpu_sec = 0;
+  uint64_t rss_kb = 0;
+};
+
 enum launch_modes {
   LM_NONE,
   LM_LOCAL,
@@ -433,6 +454,15 @@ struct launcher_def {
    fc::optional<uint32_t> max_block_cpu_usage;
    fc::optional<uint32_t> max_transaction_cpu_usage;
    roxe::chain::genesis_state genesis_from_file;
+   bool perf_test = false;
+   size_t perf_relays;
+   uint32_t perf_duration;
+   uint32_t perf_tps;
+   string perf_workload;
+   string perf_netem_dev;
+   string perf_tc;
+   bfs::path perf_report;
+   map<string, netem_profile> perf_netem;
 
    void assign_name (roxed_def &node, bool is_bios);
 
@@ -478,6 +508,9 @@ struct launcher_def {
    void roll (const string& host_names);
    void start_all (string &gts, launch_modes mode);
    void ignite ();
+   void set_netem (bool enable);
+   perf_usage sample_usage (const host_def &host, const roxed_def &node);
+   void run_perf_test ();
 };
 
 void
@@ -511,6 +544,15 @@ launcher_def::set_options (bpo::options_description &cfg) {
     ("script",bpo::value<string>(&start_script)->default_value("bios_boot.sh"),"the generated startup script name")
     ("max-block-cpu-usage",bpo::value<uint32_t>(),"Provide the \"max-block-cpu-usage\" value to use in the genesis.json file")
     ("max-transaction-cpu-usage",bpo::value<uint32_t>(),"Provide the \"max-transaction-cpu-usage\" value to use in the genesis.json file")
+    ("perf-test",bpo::bool_switch(&perf_test)->default_value(false),"After launching (and booting) the network, drive load through the txn_test_gen_plugin of the api tier and write a performance report")
+    ("perf-relays",bpo::value<size_t>(&perf_relays)->default_value(0),"number of non-producer nodes forming the relay tier; the remaining non-producer nodes form the api tier")
+    ("perf-duration",bpo::value<uint32_t>(&perf_duration)->default_value(60),"seconds of load in the performance test")
+    ("perf-tps",bpo::value<uint32_t>(&perf_tps)->default_value(100),"transactions per second generated by each api node")
+    ("perf-workload",bpo::value<string>(&perf_workload),"a json file holding a txn_test_gen start_load request; if not set the api nodes run start_generation")
+    ("perf-netem",bpo::value<vector<string>>()->composing(),"network profile of a tier as \"tier=delay_ms[,jitter_ms[,loss_pct]]\", tier being bios, producer, relay or api. Applied per host, so shaped tiers need their own hosts")
+    ("perf-netem-dev",bpo::value<string>(&perf_netem_dev)->default_value("lo"),"network device the netem profiles are attached to")
+    ("perf-tc",bpo::value<string>(&perf_tc)->default_value("sudo -n tc"),"command used to invoke tc when applying netem profiles")
+    ("perf-report",bpo::value<bfs::path>(&perf_report)->default_value("perf_report.json"),"file the performance report is written to")
         ;
 }
 
@@ -572,6 +614,35 @@ launcher_def::initialize (const variables_map &vmap) {
      max_transaction_cpu_usage = vmap["max-transaction-cpu-usage"].as<uint32_t>();
   }
 
+  if (vmap.count("perf-netem")) {
+    for (const string &spec : vmap["perf-netem"].as<vector<string>>()) {
+      vector<string> parts;
+      const auto eq = spec.find('=');
+      const string tier = spec.substr(0, eq);
+      if (eq != string::npos) {
+        const string values = spec.substr(eq + 1);
+        boost::split(parts, values, boost::is_any_of(","));
+      }
+      if (parts.empty() || parts.size() > 3 ||
+          (tier != "bios" && tier != "producer" && tier != "relay" && tier != "api")) {
+        cerr << "ERROR: \"--perf-netem\" expects tier=delay_ms[,jitter_ms[,loss_pct]], got \"" << spec << "\"" << endl;
+        exit (-1);
+      }
+      netem_profile profile;
+      try {
+        profile.delay_ms = boost::lexical_cast<uint32_t>(parts[0]);
+        if (parts.size() > 1)
+          profile.jitter_ms = boost::lexical_cast<uint32_t>(parts[1]);
+        if (parts.size() > 2)
+          profile.loss_pct = boost::lexical_cast<double>(parts[2]);
+      } catch (const boost::bad_lexical_cast &) {
+        cerr << "ERROR: invalid number in \"--perf-netem\" value \"" << spec << "\"" << endl;
+        exit (-1);
+      }
+      perf_netem[tier] = profile;
+    }
+  }
+
   genesis = vmap["genesis"].as<string>();
   if (vmap.count("host-map")) {
      host_map_file = vmap["host-map"].as<string>();
@@ -631,6 +702,11 @@ launcher_def::initialize (const variables_map &vmap) {
     exit (-1);
   }
 
+  if (perf_test && perf_relays + prod_nodes + unstarted_nodes >= total_nodes) {
+    cerr << "ERROR: \"--perf-test\" needs at least one api node, that is \"--nodes\" greater than \"--pnodes\", \"--perf-relays\" and \"--unstarted-nodes\" combined." << endl;
+    exit (-1);
+  }
+
   if (vmap.count("specific-num")) {
     const auto specific_nums = vmap["specific-num"].as<vector<uint>>();
     const auto specific_args = vmap["specific-" + string(node_executable_name)].as<vector<string>>();
@@ -886,9 +962,10 @@ launcher_def::bind_nodes () {
          bool is_bios = inst.name == "bios";
          tn_node_def node;
          node.name = inst.name;
+         node.tier = "bios";
          node.instance = &inst;
          auto kp = is_bios ?
-            private_key_type(string("5KiNH96ufjdDuYsnY9HUNNJHGcX9cJRctyFQovv9Hwsnzodu7YU")) :
+            private_key_type(bios_private_key) :
             private_key_type::generate();
          auto pubkey = kp.get_public_key();
          node.keys.emplace_back (move(kp));
@@ -917,6 +994,7 @@ launcher_def::bind_nodes () {
               }
            }
            node.dont_start = i >= to_not_start_node;
+           node.tier = i < non_bios ? "producer" : i < non_bios + perf_relays ? "relay" : "api";
         }
         node.gelf_endpoint = gelf_endpoint;
         network.nodes[node.name] = move(node);
@@ -1149,6 +1227,15 @@ launcher_def::write_config_file (tn_node_def &node) {
   cfg << "plugin = roxe::net_plugin\n";
   cfg << "plugin = roxe::chain_api_plugin\n"
       << "plugin = roxe::history_api_plugin\n";
+  if (perf_test && node.tier == "api") {
+    // every load generator needs its own test accounts; node names map onto name-safe letters
+    string prefix = "txn.";
+    for (char c : instance.get_node_num()) {
+      prefix += static_cast<char>('a' + (c - '0'));
+    }
+    cfg << "plugin = roxe::txn_test_gen_plugin\n"
+        << "txn-test-gen-account-prefix = " << prefix << ".\n";
+  }
   cfg.close();
 }
 
@@ -1844,6 +1931,417 @@ launcher_def::ignite() {
 
  }
 
+//------------------------------------------------------------
+// performance test mode
+
+namespace {
+
+/// posts `body` to a node's http api and returns the parsed json reply
+fc::variant perf_http_post (const string &host, uint16_t port, const string &path,
+                            const string &body = string()) {
+  boost::asio::io_context ioc;
+  tcp::resolver resolver (ioc);
+  tcp::socket sock (ioc);
+  boost::asio::connect (sock, resolver.resolve (host, std::to_string (port)));
+
+  string request = "POST " + path + " HTTP/1.0\r\n"
+                   "Host: " + host + ":" + std::to_string (port) + "\r\n"
+                   "Content-Type: application/json\r\n"
+                   "Content-Length: " + std::to_string (body.size()) + "\r\n\r\n" + body;
+  boost::asio::write (sock, boost::asio::buffer (request));
+
+  boost::asio::streambuf response;
+  boost::system::error_code ec;
+  boost::asio::read (sock, response, boost::asio::transfer_all(), ec);
+  if (ec && ec != boost::asio::error::eof) {
+    throw boost::system::system_error (ec);
+  }
+  string text ((std::istreambuf_iterator<char>(&response)), std::istreambuf_iterator<char>());
+  const auto header_end = text.find ("\r\n\r\n");
+  const auto status_pos = text.find (' ');
+  if (header_end == string::npos || status_pos == string::npos || text.compare (status_pos + 1, 1, "2") != 0) {
+    throw std::runtime_error (host + ":" + std::to_string (port) + path + " failed: " + text.substr (0, 512));
+  }
+  const string content = text.substr (header_end + 4);
+  return content.empty() ? fc::variant() : fc::json::from_string (content);
+}
+
+/// average, median, 95th percentile and maximum of a set of samples
+fc::mutable_variant_object perf_stats (vector<int64_t> samples) {
+  fc::mutable_variant_object stats;
+  stats ("samples", samples.size());
+  if (samples.empty()) {
+    return stats;
+  }
+  std::sort (samples.begin(), samples.end());
+  int64_t total = 0;
+  for (auto v : samples) {
+    total += v;
+  }
+  stats ("avg", double(total) / samples.size())
+        ("p50", samples[samples.size() / 2])
+        ("p95", samples[std::min (samples.size() - 1, samples.size() * 95 / 100)])
+        ("max", samples.back());
+  return stats;
+}
+
+int64_t perf_now_ms () {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+void
+launcher_def::set_netem (bool enable) {
+  if (perf_netem.empty()) {
+    return;
+  }
+  for (auto &host : bindings) {
+    // netem shapes a device, so every instance on a host shares the profile of the first shaped tier found
+    const netem_profile *profile = nullptr;
+    string profile_tier;
+    for (auto &inst : host.instances) {
+      auto p = perf_netem.find (inst.node->tier);
+      if (p == perf_netem.end()) {
+        continue;
+      }
+      if (profile == nullptr) {
+        profile = &p->second;
+        profile_tier = p->first;
+      }
+      else if (enable && p->first != profile_tier) {
+        cerr << "WARNING: " << inst.name << " (" << p->first << ") shares host " << host.host_name
+             << " with a " << profile_tier << " node, applying the " << profile_tier << " profile" << endl;
+      }
+    }
+    if (profile == nullptr) {
+      continue;
+    }
+    string cmd = perf_tc + " qdisc ";
+    if (enable) {
+      ostringstream args;
+      args << "replace dev " << perf_netem_dev << " root netem delay " << profile->delay_ms << "ms";
+      if (profile->jitter_ms) {
+        args << " " << profile->jitter_ms << "ms";
+      }
+      if (profile->loss_pct > 0) {
+        args << " loss " << profile->loss_pct << "%";
+      }
+      cmd += args.str();
+    }
+    else {
+      cmd += "del dev " + perf_netem_dev + " root";
+    }
+    cerr << (enable ? "applying" : "removing") << " netem profile on " << host.host_name << ": " << cmd << endl;
+    do_command (host, host.host_name, {}, cmd);
+  }
+}
+
+perf_usage
+launcher_def::sample_usage (const host_def &host, const roxed_def &node) {
+  perf_usage usage;
+  const string pidf = (bfs::path(node.data_dir_name) / (string(node_executable_name) + ".pid")).string();
+  const string cmd = "ps -o rss=,times= -p $(cat " + pidf + ")";
+  try {
+    bp::ipstream out;
+    bp::child c;
+    if (host.is_local()) {
+      c = bp::child ("/bin/sh", "-c", cmd, bp::std_out > out);
+    }
+    else {
+      string ssh_cmd_line;
+      format_ssh ("cd " + host.roxe_home + "; " + cmd, host.host_name, ssh_cmd_line);
+      c = bp::child (ssh_cmd_line, bp::std_out > out);
+    }
+    string line;
+    if (std::getline (out, line)) {
+      istringstream fields (line);
+      fields >> usage.rss_kb >> usage.cpu_sec;
+      usage.valid = !fields.fail();
+    }
+    c.wait();
+  } catch (const std::exception &ex) {
+    cerr << "unable to sample resource usage of " << node.name << ": " << ex.what() << endl;
+  }
+  return usage;
+}
+
+void
+launcher_def::run_perf_test () {
+  struct perf_node {
+    const host_def          *host;
+    const roxed_def         *instance;
+    string                   tier;
+    uint32_t                 head = 0;
+    uint32_t                 lib = 0;
+    uint32_t                 poll_failures = 0;
+    map<uint32_t, int64_t>   first_seen;   // block number -> ms since the load started
+    perf_usage               usage_start;
+    perf_usage               usage_end;
+    fc::variant              load_report;
+
+    fc::variant call (const string &path, const string &body = string()) const {
+      return perf_http_post (host->host_name, instance->http_port, path, body);
+    }
+  };
+
+  vector<perf_node> nodes;
+  for (auto &host : bindings) {
+    for (auto &inst : host.instances) {
+      if (!inst.node->dont_start) {
+        nodes.push_back ({&host, &inst, inst.node->tier});
+      }
+    }
+  }
+  if (!boot) {
+    cerr << "WARNING: \"--perf-test\" without \"--boot\" leaves block production to the bios node" << endl;
+  }
+
+  cerr << "perf test: waiting for " << nodes.size() << " nodes to serve get_info" << endl;
+  for (auto &n : nodes) {
+    for (int attempt = 0; ; ++attempt) {
+      try {
+        n.head = n.call ("/v1/chain/get_info")["head_block_num"].as<uint32_t>();
+        break;
+      } catch (const std::exception &) {
+        if (attempt == 60) {
+          cerr << "ERROR: " << n.instance->name << " did not answer get_info, giving up on the perf test" << endl;
+          return;
+        }
+        sleep (1);
+      }
+    }
+  }
+
+  set_netem (true);
+
+  vector<perf_node*> generators;
+  for (auto &n : nodes) {
+    if (n.tier == "api") {
+      generators.push_back (&n);
+    }
+  }
+  for (auto n : generators) {
+    try {
+      n->call ("/v1/txn_test_gen/create_test_accounts",
+               fc::json::to_string (fc::variants{fc::variant("roxe"), fc::variant(bios_private_key)}));
+    } catch (const std::exception &ex) {
+      cerr << "create_test_accounts on " << n->instance->name << " failed: " << ex.what() << endl;
+    }
+  }
+  sleep (2);
+
+  string start_path, start_body;
+  if (!perf_workload.empty()) {
+    auto load = fc::json::from_file (perf_workload).get_object();
+    fc::mutable_variant_object request (load);
+    if (!load.contains ("rate")) {
+      request ("rate", perf_tps);
+    }
+    if (!load.contains ("duration")) {
+      request ("duration", perf_duration);
+    }
+    start_path = "/v1/txn_test_gen/start_load";
+    start_body = fc::json::to_string (fc::variant(request));
+  }
+  else {
+    // start_generation pushes batch_size transactions every period ms, batch_size being even and at most 250
+    uint64_t period = 20;
+    uint64_t batch = (uint64_t(perf_tps) * period / 1000) & ~uint64_t(1);
+    if (batch < 2) {
+      batch = 2;
+      period = std::min<uint64_t>(2500, 2000 / std::max<uint32_t>(perf_tps, 1));
+    }
+    batch = std::min<uint64_t>(batch, 250);
+    start_path = "/v1/txn_test_gen/start_generation";
+    start_body = fc::json::to_string (fc::variants{fc::variant("perf"), fc::variant(period), fc::variant(batch)});
+  }
+
+  for (auto &n : nodes) {
+    n.usage_start = sample_usage (*n.host, *n.instance);
+  }
+  const auto start_block = std::max_element (nodes.begin(), nodes.end(),
+                                             [](const perf_node &a, const perf_node &b) { return a.head < b.head; })->head;
+  for (auto n : generators) {
+    try {
+      n->call (start_path, start_body);
+    } catch (const std::exception &ex) {
+      cerr << "starting load on " << n->instance->name << " failed: " << ex.what() << endl;
+    }
+  }
+  cerr << "perf test: load running for " << perf_duration << " seconds" << endl;
+
+  // poll every node for its head block; the first time a node reports a block is its arrival there, so the
+  // propagation latency resolution is one polling round
+  const int64_t poll_ms = 100;
+  const int64_t drain_ms = 3000;
+  const int64_t start_ms = perf_now_ms();
+  const int64_t load_end_ms = start_ms + int64_t(perf_duration) * 1000;
+  bool load_stopped = false;
+  while (perf_now_ms() < load_end_ms + drain_ms) {
+    const int64_t round_start = perf_now_ms();
+    if (!load_stopped && round_start >= load_end_ms) {
+      for (auto n : generators) {
+        try {
+          n->call ("/v1/txn_test_gen/stop_generation");
+        } catch (const std::exception &) {
+          // start_load stops by itself once its duration passed
+        }
+      }
+      load_stopped = true;
+    }
+    for (auto &n : nodes) {
+      try {
+        auto info = n.call ("/v1/chain/get_info");
+        const auto head = info["head_block_num"].as<uint32_t>();
+        const int64_t now = perf_now_ms() - start_ms;
+        for (auto b = std::max (n.head, start_block) + 1; b <= head; ++b) {
+          n.first_seen.emplace (b, now);
+        }
+        n.head = std::max (n.head, head);
+        n.lib = info["last_irreversible_block_num"].as<uint32_t>();
+      } catch (const std::exception &) {
+        ++n.poll_failures;
+      }
+    }
+    const int64_t spent = perf_now_ms() - round_start;
+    if (spent < poll_ms) {
+      std::this_thread::sleep_for (std::chrono::milliseconds (poll_ms - spent));
+    }
+  }
+  const double elapsed_sec = (perf_now_ms() - start_ms) / 1000.0;
+
+  for (auto &n : nodes) {
+    n.usage_end = sample_usage (*n.host, *n.instance);
+  }
+  for (auto n : generators) {
+    try {
+      n->load_report = n->call ("/v1/txn_test_gen/get_report");
+    } catch (const std::exception &ex) {
+      cerr << "get_report on " << n->instance->name << " failed: " << ex.what() << endl;
+    }
+  }
+  set_netem (false);
+
+  // the chain itself, read from the first producer node (the bios node when there is none)
+  const perf_node *source = &nodes.front();
+  for (auto &n : nodes) {
+    if (n.tier == "producer") {
+      source = &n;
+      break;
+    }
+  }
+  uint64_t transactions = 0;
+  uint32_t missed_slots = 0;
+  map<string, uint32_t> produced;
+  fc::time_point first_time, last_time;
+  for (uint32_t b = start_block + 1; b <= source->head; ++b) {
+    try {
+      auto block = source->call ("/v1/chain/get_block", fc::json::to_string (fc::mutable_variant_object ("block_num_or_id", b)));
+      const auto t = fc::time_point::from_iso_string (block["timestamp"].as_string());
+      transactions += block["transactions"].get_array().size();
+      ++produced[block["producer"].as_string()];
+      if (last_time != fc::time_point()) {
+        missed_slots += (t - last_time).count() / 500000 - 1;
+      }
+      else {
+        first_time = t;
+      }
+      last_time = t;
+    } catch (const std::exception &ex) {
+      cerr << "get_block " << b << " failed: " << ex.what() << endl;
+    }
+  }
+  const double chain_sec = (last_time - first_time).count() / 1000000.0;
+  const double tps = chain_sec > 0 ? transactions / chain_sec : 0;
+
+  // propagation latency of a block at a node is measured from the first node seen with it
+  map<uint32_t, int64_t> origin;
+  for (auto &n : nodes) {
+    for (auto &seen : n.first_seen) {
+      auto o = origin.emplace (seen.first, seen.second);
+      if (!o.second) {
+        o.first->second = std::min (o.first->second, seen.second);
+      }
+    }
+  }
+
+  fc::mutable_variant_object tiers;
+  fc::variants node_reports;
+  for (const string tier : {"bios", "producer", "relay", "api"}) {
+    vector<int64_t> latency;
+    vector<string> names;
+    double cpu_pct = 0;
+    uint64_t rss_kb = 0;
+    uint32_t sampled = 0;
+    for (auto &n : nodes) {
+      if (n.tier != tier) {
+        continue;
+      }
+      names.push_back (n.instance->name);
+      for (auto &seen : n.first_seen) {
+        latency.push_back (seen.second - origin[seen.first]);
+      }
+      fc::mutable_variant_object report;
+      report ("name", n.instance->name)
+             ("tier", n.tier)
+             ("host", n.host->host_name)
+             ("head_block_num", n.head)
+             ("last_irreversible_block_num", n.lib)
+             ("poll_failures", n.poll_failures);
+      if (n.usage_start.valid && n.usage_end.valid) {
+        const double pct = 100 * (n.usage_end.cpu_sec - n.usage_start.cpu_sec) / elapsed_sec;
+        report ("cpu_pct", pct)("rss_kb", n.usage_end.rss_kb);
+        cpu_pct += pct;
+        rss_kb += n.usage_end.rss_kb;
+        ++sampled;
+      }
+      if (!n.load_report.is_null()) {
+        report ("txn_test_gen", n.load_report);
+      }
+      node_reports.emplace_back (std::move (report));
+    }
+    if (names.empty()) {
+      continue;
+    }
+    fc::mutable_variant_object summary;
+    summary ("nodes", names)
+            ("propagation_ms", perf_stats (latency));
+    if (sampled) {
+      summary ("avg_cpu_pct", cpu_pct / sampled)("avg_rss_kb", rss_kb / sampled);
+    }
+    auto netem = perf_netem.find (tier);
+    if (netem != perf_netem.end()) {
+      summary ("netem", fc::mutable_variant_object ("delay_ms", netem->second.delay_ms)
+                                                   ("jitter_ms", netem->second.jitter_ms)
+                                                   ("loss_pct", netem->second.loss_pct));
+    }
+    tiers (tier, std::move (summary));
+  }
+
+  fc::mutable_variant_object report;
+  report ("duration_sec", elapsed_sec)
+         ("poll_interval_ms", poll_ms)
+         ("blocks", fc::mutable_variant_object ("source", source->instance->name)
+                                               ("first", start_block + 1)
+                                               ("last", source->head)
+                                               ("missed_slots", missed_slots)
+                                               ("produced", produced))
+         ("throughput", fc::mutable_variant_object ("transactions", transactions)
+                                                   ("chain_seconds", chain_sec)
+                                                   ("tps", tps))
+         ("tiers", std::move (tiers))
+         ("nodes", std::move (node_reports));
+
+  bfs::ofstream out (perf_report);
+  out << fc::json::to_pretty_string (fc::variant (report)) << endl;
+  out.close();
+
+  cout << "perf test: " << transactions << " transactions in blocks " << start_block + 1 << " to " << source->head
+       << ", " << tps << " tps, " << missed_slots << " missed slots; report written to " << perf_report << endl;
+}
+
 void
 launcher_def::start_all (string &gts, launch_modes mode) {
   switch (mode) {
@@ -2060,6 +2558,9 @@ int main (int argc, char *argv[]) {
       top.generate();
       top.start_all(gts, mode);
       top.ignite();
+      if (top.perf_test && (mode == LM_ALL || mode == LM_LOCAL || mode == LM_REMOTE)) {
+        top.run_perf_test();
+      }
     }
   } catch (bpo::unknown_option &ex) {
     cerr << ex.what() << endl;
@@ -2093,7 +2594,7 @@ FC_REFLECT( roxed_def,
             (http_port)(file_size)(has_db)(name)(host)
             (p2p_endpoint) )
 
-// @ignore instance, gelf_endpoint
+// @ignore instance, gelf_endpoint, tier
 FC_REFLECT( tn_node_def, (name)(keys)(peers)(producers)(dont_start) )
 
 FC_REFLECT( testnet_def, (name)(ssh_helper)(nodes) )
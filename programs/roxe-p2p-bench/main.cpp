@@ -0,0 +1,741 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE.txt
+ */
+#include <roxe/chain/exceptions.hpp>
+#include <roxe/net_plugin/protocol.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/variant.hpp>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+using namespace roxe;
+using boost::asio::ip::tcp;
+namespace bfs = boost::filesystem;
+namespace bpo = boost::program_options;
+using bpo::options_description;
+using bpo::variables_map;
+
+// must match net_plugin
+constexpr uint16_t net_version_base       = 0x04b5;
+constexpr uint16_t latest_net_version     = 4;
+constexpr size_t   message_header_size    = 4;
+constexpr size_t   max_message_size       = 2 * 4 * 1024 * 1024;
+
+/// what the peers of one phase received; wire bytes are as framed on the socket, decoded bytes after inflating
+struct traffic_stats {
+   uint64_t  messages = 0;
+   uint64_t  wire_bytes = 0;
+   uint64_t  decoded_bytes = 0;
+   uint64_t  compressed_messages = 0;
+   uint64_t  blocks = 0;
+   uint64_t  compact_blocks = 0;
+   uint64_t  transactions = 0;
+   uint64_t  transaction_batches = 0;
+
+   void add( const traffic_stats& o ) {
+      messages += o.messages;  wire_bytes += o.wire_bytes;  decoded_bytes += o.decoded_bytes;
+      compressed_messages += o.compressed_messages;  blocks += o.blocks;  compact_blocks += o.compact_blocks;
+      transactions += o.transactions;  transaction_batches += o.transaction_batches;
+   }
+};
+
+/// every peer fetching the same range of irreversible blocks from the node at once
+struct sync_results {
+   uint32_t       peers = 0;
+   uint32_t       blocks_per_peer = 0;
+   double         seconds = 0;
+   double         blocks_per_sec = 0;           ///< all peers together
+   double         slowest_peer_blocks_per_sec = 0;
+   double         messages_per_sec = 0;
+   double         wire_mib_per_sec = 0;
+   traffic_stats  traffic;
+};
+
+/// peers in sync with the node, receiving what it relays
+struct live_results {
+   uint32_t       peers = 0;
+   double         seconds = 0;
+   uint32_t       blocks = 0;                   ///< blocks seen by at least one peer
+   uint32_t       blocks_at_all_peers = 0;
+   double         fanout_avg_ms = 0;            ///< first to last peer receiving a block, of blocks_at_all_peers
+   double         fanout_p95_ms = 0;
+   double         fanout_max_ms = 0;
+   double         first_arrival_avg_ms = 0;     ///< block timestamp to the first peer receiving it
+   double         messages_per_sec = 0;
+   double         wire_mib_per_sec = 0;
+   int64_t        rss_per_connection_kib = -1;  ///< growth of the node's resident memory per connection, -1 unknown
+   traffic_stats  traffic;
+};
+
+struct p2p_results {
+   uint16_t       protocol_version = 0;
+   uint32_t       peer_kbps = 0;
+   sync_results   sync;
+   live_results   live;
+};
+
+FC_REFLECT( traffic_stats, (messages)(wire_bytes)(decoded_bytes)(compressed_messages)(blocks)(compact_blocks)
+                           (transactions)(transaction_batches) )
+FC_REFLECT( sync_results, (peers)(blocks_per_peer)(seconds)(blocks_per_sec)(slowest_peer_blocks_per_sec)
+                          (messages_per_sec)(wire_mib_per_sec)(traffic) )
+FC_REFLECT( live_results, (peers)(seconds)(blocks)(blocks_at_all_peers)(fanout_avg_ms)(fanout_p95_ms)(fanout_max_ms)
+                          (first_arrival_avg_ms)(messages_per_sec)(wire_mib_per_sec)(rss_per_connection_kib)(traffic) )
+FC_REFLECT( p2p_results, (protocol_version)(peer_kbps)(sync)(live) )
+
+namespace {
+
+   /// posts to the node's http api and returns the parsed json reply
+   fc::variant http_post( const string& host, const string& port, const string& path ) {
+      boost::asio::io_context ioc;
+      tcp::resolver resolver( ioc );
+      tcp::socket sock( ioc );
+      boost::asio::connect( sock, resolver.resolve( host, port ) );
+      const string request = "POST " + path + " HTTP/1.0\r\nHost: " + host + ":" + port + "\r\n"
+                             "Content-Type: application/json\r\nContent-Length: 0\r\n\r\n";
+      boost::asio::write( sock, boost::asio::buffer( request ) );
+      boost::asio::streambuf response;
+      boost::system::error_code ec;
+      boost::asio::read( sock, response, boost::asio::transfer_all(), ec );
+      string text( (std::istreambuf_iterator<char>( &response )), std::istreambuf_iterator<char>() );
+      const auto body = text.find( "\r\n\r\n" );
+      const auto status = text.find( ' ' );
+      ROXE_ASSERT( body != string::npos && status < body && text.compare( status + 1, 3, "200" ) == 0,
+                   fc::invalid_arg_exception, "${p} on ${h}:${port} failed: ${t}",
+                   ("p", path)("h", host)("port", port)("t", text.substr( 0, 512 )) );
+      return fc::json::from_string( text.substr( body + 4 ) );
+   }
+
+   std::pair<string, string> split_endpoint( const string& endpoint ) {
+      const auto colon = endpoint.rfind( ':' );
+      ROXE_ASSERT( colon != string::npos, fc::invalid_arg_exception, "expected host:port, got ${e}", ("e", endpoint) );
+      return { endpoint.substr( 0, colon ), endpoint.substr( colon + 1 ) };
+   }
+
+   vector<char> decompress( const vector<char>& data ) {
+      namespace bio = boost::iostreams;
+      bio::filtering_istream in;
+      in.push( bio::zlib_decompressor() );
+      in.push( bio::array_source( data.data(), data.size() ) );
+      vector<char> result;
+      char buf[64*1024];
+      while( in ) {
+         in.read( buf, sizeof( buf ) );
+         result.insert( result.end(), buf, buf + in.gcount() );
+         ROXE_ASSERT( result.size() <= max_message_size, fc::invalid_arg_exception, "compressed message too large" );
+      }
+      return result;
+   }
+
+   /// resident memory of a local process in KiB, -1 when it cannot be read
+   int64_t resident_kib( int pid ) {
+      std::ifstream status( "/proc/" + std::to_string( pid ) + "/status" );
+      string line;
+      while( std::getline( status, line ) ) {
+         if( line.compare( 0, 6, "VmRSS:" ) == 0 )
+            return std::stoll( line.substr( 6 ) );
+      }
+      return -1;
+   }
+
+   int64_t steady_us() {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch() ).count();
+   }
+
+}
+
+class bench_peer;
+using bench_peer_ptr = std::shared_ptr<bench_peer>;
+
+struct p2p_bench {
+   void set_program_options( options_description& cli );
+   void initialize( const variables_map& options );
+   sync_results run_sync();
+   live_results run_live();
+   bool check_baseline( const p2p_results& r )const;
+
+   /// connects `count` peers, runs the io threads until `done` says so or `timeout` passes, then closes them
+   vector<bench_peer_ptr> run_peers( uint32_t count, bool syncing, const fc::microseconds& timeout,
+                                     const std::function<bool(const vector<bench_peer_ptr>&)>& done,
+                                     const std::function<void()>& connected );
+
+   void record_block( uint32_t peer, const signed_block_header& header );
+
+   string                   p2p_host;
+   string                   p2p_port;
+   string                   http_host;
+   string                   http_port;
+   uint32_t                 peers;
+   uint32_t                 sync_blocks;
+   uint32_t                 sync_chunk;
+   uint32_t                 duration_sec;
+   uint16_t                 protocol_version;
+   uint32_t                 peer_kbps;
+   uint16_t                 threads;
+   int                      node_pid = 0;
+   bool                     skip_sync = false;
+   bool                     skip_live = false;
+   optional<bfs::path>      output_file;
+   optional<bfs::path>      baseline_file;
+   uint32_t                 max_regression_pct;
+
+   fc::variant              info;
+   boost::asio::io_context  ioc;
+
+   struct block_arrivals {
+      fc::time_point          timestamp;
+      int64_t                 first_us = 0;
+      int64_t                 last_us = 0;
+      int64_t                 first_wall_us = 0;
+      uint32_t                count = 0;
+   };
+   std::mutex                         blocks_mtx;
+   std::map<uint32_t, block_arrivals> blocks;
+};
+
+/**
+ * One connection to the node under test speaking the net protocol itself: a syncing peer claims an empty chain and
+ * fetches blocks with sync_request_message, a live peer claims the node's head and records the blocks relayed to it.
+ */
+class bench_peer : public std::enable_shared_from_this<bench_peer> {
+public:
+   bench_peer( p2p_bench& b, uint32_t id, bool syncing )
+   : id( id ), syncing( syncing ), bench( b ), strand( b.ioc ), socket( b.ioc ), throttle( b.ioc ) {}
+
+   void start( const tcp::resolver::results_type& endpoints ) {
+      boost::asio::async_connect( socket, endpoints, strand.wrap(
+         [self = shared_from_this()]( const boost::system::error_code& ec, const tcp::endpoint& ) {
+            if( ec ) {
+               self->fail( "connect: " + ec.message() );
+               return;
+            }
+            self->socket.set_option( tcp::no_delay( true ) );
+            self->connected_us = steady_us();
+            self->send_handshake();
+            self->read_header();
+         } ) );
+   }
+
+   void close() {
+      boost::asio::post( strand, [self = shared_from_this()]() {
+         boost::system::error_code ec;
+         self->throttle.cancel( ec );
+         self->socket.close( ec );
+      } );
+   }
+
+   const uint32_t      id;
+   const bool          syncing;
+   std::atomic<bool>   handshake_received{false};
+   std::atomic<bool>   sync_done{false};
+   std::atomic<bool>   failed{false};
+   int64_t             connected_us = 0;
+   int64_t             sync_start_us = 0;
+   int64_t             sync_end_us = 0;
+   traffic_stats       traffic;   ///< read once the io threads stopped
+
+private:
+   void fail( const string& what ) {
+      if( !failed.exchange( true ) )
+         elog( "peer ${id}: ${w}", ("id", id)("w", what) );
+      boost::system::error_code ec;
+      socket.close( ec );
+   }
+
+   void send( const net_message& msg ) {
+      const uint32_t payload_size = fc::raw::pack_size( msg );
+      auto buffer = std::make_shared<vector<char>>( message_header_size + payload_size );
+      fc::datastream<char*> ds( buffer->data(), buffer->size() );
+      ds.write( reinterpret_cast<const char*>( &payload_size ), message_header_size );
+      fc::raw::pack( ds, msg );
+      write_queue.push_back( buffer );
+      if( write_queue.size() == 1 )
+         write_next();
+   }
+
+   void write_next() {
+      boost::asio::async_write( socket, boost::asio::buffer( *write_queue.front() ), strand.wrap(
+         [self = shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+            if( ec ) {
+               self->fail( "write: " + ec.message() );
+               return;
+            }
+            self->write_queue.pop_front();
+            if( !self->write_queue.empty() )
+               self->write_next();
+         } ) );
+   }
+
+   void send_handshake() {
+      handshake_message hello;
+      hello.network_version = net_version_base + bench.protocol_version;
+      hello.chain_id = bench.info["chain_id"].as<chain_id_type>();
+      hello.node_id = fc::sha256::hash( fc::raw::pack( std::make_pair( id, fc::time_point::now() ) ) );
+      hello.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch() ).count();
+      hello.p2p_address = "roxe-p2p-bench:" + std::to_string( id );
+      hello.os = "linux";
+      hello.agent = "\"roxe-p2p-bench\"";
+      hello.generation = 1;
+      if( !syncing ) {
+         // claiming the node's own head makes it treat the peer as caught up and relay to it
+         hello.head_num = bench.info["head_block_num"].as<uint32_t>();
+         hello.head_id = bench.info["head_block_id"].as<block_id_type>();
+         hello.last_irreversible_block_num = bench.info["last_irreversible_block_num"].as<uint32_t>();
+         hello.last_irreversible_block_id = bench.info["last_irreversible_block_id"].as<block_id_type>();
+      }
+      send( net_message( hello ) );
+   }
+
+   void request_sync_chunk() {
+      const uint32_t end = std::min( next_sync_block + bench.sync_chunk - 1, bench.sync_blocks );
+      sync_chunk_end = end;
+      send( net_message( sync_request_message{ next_sync_block, end } ) );
+   }
+
+   void read_header() {
+      boost::asio::async_read( socket, boost::asio::buffer( header ), strand.wrap(
+         [self = shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+            if( ec ) {
+               if( ec != boost::asio::error::operation_aborted )
+                  self->fail( "read: " + ec.message() );
+               return;
+            }
+            uint32_t size = 0;
+            memcpy( &size, self->header.data(), message_header_size );
+            if( size == 0 || size > max_message_size ) {
+               self->fail( "invalid message size " + std::to_string( size ) );
+               return;
+            }
+            self->body.resize( size );
+            self->read_body();
+         } ) );
+   }
+
+   void read_body() {
+      boost::asio::async_read( socket, boost::asio::buffer( body ), strand.wrap(
+         [self = shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+            if( ec ) {
+               if( ec != boost::asio::error::operation_aborted )
+                  self->fail( "read: " + ec.message() );
+               return;
+            }
+            const size_t wire = self->body.size() + message_header_size;
+            ++self->traffic.messages;
+            self->traffic.wire_bytes += wire;
+            try {
+               self->handle( self->body.data(), self->body.size() );
+            } catch( const fc::exception& e ) {
+               self->fail( e.to_string() );
+               return;
+            }
+            self->read_bytes += wire;
+            self->throttled_read();
+         } ) );
+   }
+
+   /// with a peer_kbps link the next read waits until the bytes read so far fit the rate
+   void throttled_read() {
+      if( bench.peer_kbps == 0 ) {
+         read_header();
+         return;
+      }
+      const int64_t due_us = connected_us + int64_t( read_bytes * 8 * 1000 / bench.peer_kbps );
+      if( due_us <= steady_us() ) {
+         read_header();
+         return;
+      }
+      throttle.expires_after( std::chrono::microseconds( due_us - steady_us() ) );
+      throttle.async_wait( strand.wrap( [self = shared_from_this()]( const boost::system::error_code& ec ) {
+         if( !ec )
+            self->read_header();
+      } ) );
+   }
+
+   void handle( const char* data, size_t size ) {
+      fc::datastream<const char*> ds( data, size );
+      fc::unsigned_int which;
+      fc::raw::unpack( ds, which );
+      traffic.decoded_bytes += size;
+      switch( which.value ) {
+         case net_message::tag<handshake_message>::value:
+            if( !handshake_received.exchange( true ) && syncing && bench.sync_blocks > 0 ) {
+               sync_start_us = steady_us();
+               request_sync_chunk();
+            }
+            break;
+         case net_message::tag<go_away_message>::value: {
+            go_away_message msg;
+            fc::raw::unpack( ds, msg );
+            fail( string( "go away: " ) + reason_str( msg.reason ) );
+            break;
+         }
+         case net_message::tag<signed_block>::value:
+         case net_message::tag<compact_block_message>::value: {
+            // both start with the block header, which is all the bench needs
+            signed_block_header h;
+            fc::raw::unpack( ds, h );
+            if( which.value == net_message::tag<signed_block>::value )
+               ++traffic.blocks;
+            else
+               ++traffic.compact_blocks;
+            on_block( h );
+            break;
+         }
+         case net_message::tag<packed_transaction>::value:
+            ++traffic.transactions;
+            break;
+         case net_message::tag<transaction_batch_message>::value: {
+            fc::unsigned_int count;
+            fc::raw::unpack( ds, count );
+            ++traffic.transaction_batches;
+            traffic.transactions += count.value;
+            break;
+         }
+         case net_message::tag<compressed_message>::value: {
+            compressed_message msg;
+            fc::raw::unpack( ds, msg );
+            ++traffic.compressed_messages;
+            traffic.decoded_bytes -= size;
+            const auto inflated = decompress( msg.data );
+            handle( inflated.data(), inflated.size() );
+            break;
+         }
+         default:
+            break;
+      }
+   }
+
+   void on_block( const signed_block_header& h ) {
+      if( !syncing ) {
+         bench.record_block( id, h );
+         return;
+      }
+      if( sync_done || h.block_num() != sync_chunk_end )
+         return;
+      if( sync_chunk_end >= bench.sync_blocks ) {
+         sync_end_us = steady_us();
+         sync_done = true;
+         return;
+      }
+      next_sync_block = sync_chunk_end + 1;
+      request_sync_chunk();
+   }
+
+   p2p_bench&                                   bench;
+   boost::asio::io_context::strand              strand;
+   tcp::socket                                  socket;
+   boost::asio::steady_timer                    throttle;
+   std::array<char, message_header_size>        header;
+   vector<char>                                 body;
+   std::deque<std::shared_ptr<vector<char>>>    write_queue;
+   uint64_t                                     read_bytes = 0;
+   uint32_t                                     next_sync_block = 1;
+   uint32_t                                     sync_chunk_end = 0;
+};
+
+void p2p_bench::record_block( uint32_t peer, const signed_block_header& header ) {
+   const int64_t now = steady_us();
+   std::lock_guard<std::mutex> g( blocks_mtx );
+   auto& b = blocks[header.block_num()];
+   if( b.count++ == 0 ) {
+      b.timestamp = header.timestamp.to_time_point();
+      b.first_us = now;
+      b.first_wall_us = fc::time_point::now().time_since_epoch().count();
+   }
+   b.last_us = now;
+}
+
+vector<bench_peer_ptr> p2p_bench::run_peers( uint32_t count, bool syncing, const fc::microseconds& timeout,
+                                             const std::function<bool(const vector<bench_peer_ptr>&)>& done,
+                                             const std::function<void()>& connected ) {
+   ioc.restart();
+   auto work = boost::asio::make_work_guard( ioc );
+   tcp::resolver resolver( ioc );
+   const auto endpoints = resolver.resolve( p2p_host, p2p_port );
+
+   vector<bench_peer_ptr> result;
+   for( uint32_t i = 0; i < count; ++i ) {
+      result.push_back( std::make_shared<bench_peer>( *this, i, syncing ) );
+      result.back()->start( endpoints );
+   }
+   vector<std::thread> pool;
+   for( uint16_t i = 0; i < threads; ++i )
+      pool.emplace_back( [this]() { ioc.run(); } );
+
+   auto all_handshaken = [&]() {
+      for( const auto& p : result )
+         if( !p->handshake_received && !p->failed )
+            return false;
+      return true;
+   };
+   const auto deadline = fc::time_point::now() + timeout;
+   bool reported_connected = false;
+   while( fc::time_point::now() < deadline ) {
+      if( !reported_connected && all_handshaken() ) {
+         reported_connected = true;
+         if( connected )
+            connected();
+      }
+      if( reported_connected && done( result ) )
+         break;
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+   }
+   for( const auto& p : result )
+      p->close();
+   work.reset();
+   for( auto& t : pool )
+      t.join();
+
+   uint32_t failures = 0;
+   for( const auto& p : result )
+      failures += p->failed;
+   ROXE_ASSERT( failures < count, fc::invalid_arg_exception, "no peer could stay connected to ${h}:${p}",
+                ("h", p2p_host)("p", p2p_port) );
+   if( failures )
+      wlog( "${f} of ${n} peers failed", ("f", failures)("n", count) );
+   return result;
+}
+
+sync_results p2p_bench::run_sync() {
+   sync_results r;
+   const auto lib = info["last_irreversible_block_num"].as<uint32_t>();
+   sync_blocks = std::min( sync_blocks, lib );
+   if( sync_blocks == 0 ) {
+      wlog( "the node has no irreversible blocks to sync" );
+      return r;
+   }
+   ilog( "${n} peers syncing blocks 1 to ${b}", ("n", peers)("b", sync_blocks) );
+   const auto syncers = run_peers( peers, true, fc::seconds( 3600 ), []( const vector<bench_peer_ptr>& active ) {
+      for( const auto& p : active )
+         if( !p->sync_done && !p->failed )
+            return false;
+      return true;
+   }, {} );
+
+   int64_t first = std::numeric_limits<int64_t>::max(), last = 0;
+   double slowest = std::numeric_limits<double>::max();
+   for( const auto& p : syncers ) {
+      if( !p->sync_done )
+         continue;
+      ++r.peers;
+      r.traffic.add( p->traffic );
+      first = std::min( first, p->sync_start_us );
+      last = std::max( last, p->sync_end_us );
+      slowest = std::min( slowest, sync_blocks * 1e6 / std::max<int64_t>( 1, p->sync_end_us - p->sync_start_us ) );
+   }
+   if( r.peers == 0 )
+      return r;
+   r.blocks_per_peer = sync_blocks;
+   r.seconds = std::max<int64_t>( 1, last - first ) / 1e6;
+   r.blocks_per_sec = double( r.peers ) * sync_blocks / r.seconds;
+   r.slowest_peer_blocks_per_sec = slowest;
+   r.messages_per_sec = r.traffic.messages / r.seconds;
+   r.wire_mib_per_sec = r.traffic.wire_bytes / r.seconds / (1024 * 1024);
+   return r;
+}
+
+live_results p2p_bench::run_live() {
+   live_results r;
+   blocks.clear();
+   const int64_t rss_before = node_pid ? resident_kib( node_pid ) : -1;
+   int64_t rss_connected = -1;
+   int64_t start_us = 0;
+   ilog( "${n} peers following the node for ${s} seconds", ("n", peers)("s", duration_sec) );
+
+   // the clock starts once every peer is connected; arrivals before that are left out below
+   const auto followers = run_peers( peers, false, fc::seconds( duration_sec + 60 ), [&]( const vector<bench_peer_ptr>& ) {
+      return steady_us() - start_us >= int64_t( duration_sec ) * 1000000;
+   }, [&]() {
+      start_us = steady_us();
+      if( node_pid )
+         rss_connected = resident_kib( node_pid );
+   } );
+   const int64_t end_us = steady_us();
+
+   for( const auto& p : followers ) {
+      if( p->failed )
+         continue;
+      ++r.peers;
+      r.traffic.add( p->traffic );
+   }
+   r.seconds = start_us ? (end_us - start_us) / 1e6 : 0;
+   if( r.seconds > 0 ) {
+      r.messages_per_sec = r.traffic.messages / r.seconds;
+      r.wire_mib_per_sec = r.traffic.wire_bytes / r.seconds / (1024 * 1024);
+   }
+   if( rss_before >= 0 && rss_connected >= 0 && r.peers )
+      r.rss_per_connection_kib = (rss_connected - rss_before) / int64_t( r.peers );
+
+   vector<int64_t> fanout;
+   double first_arrival = 0;
+   for( const auto& b : blocks ) {
+      if( b.second.first_us < start_us )
+         continue;
+      ++r.blocks;
+      first_arrival += (b.second.first_wall_us - b.second.timestamp.time_since_epoch().count()) / 1000.0;
+      if( b.second.count >= r.peers )
+         fanout.push_back( b.second.last_us - b.second.first_us );
+   }
+   if( r.blocks )
+      r.first_arrival_avg_ms = first_arrival / r.blocks;
+   r.blocks_at_all_peers = fanout.size();
+   if( !fanout.empty() ) {
+      std::sort( fanout.begin(), fanout.end() );
+      r.fanout_avg_ms = std::accumulate( fanout.begin(), fanout.end(), 0.0 ) / fanout.size() / 1000;
+      r.fanout_p95_ms = fanout[std::min( fanout.size() - 1, fanout.size() * 95 / 100 )] / 1000.0;
+      r.fanout_max_ms = fanout.back() / 1000.0;
+   }
+   return r;
+}
+
+bool p2p_bench::check_baseline( const p2p_results& r )const {
+   if( !baseline_file )
+      return true;
+   const auto baseline = fc::json::from_file( *baseline_file ).as<p2p_results>();
+   bool ok = true;
+   if( r.sync.blocks_per_sec > 0 && baseline.sync.blocks_per_sec > 0 ) {
+      const double floor = baseline.sync.blocks_per_sec * (100 - max_regression_pct) / 100;
+      if( r.sync.blocks_per_sec < floor ) {
+         elog( "sync ${r} blocks/s is more than ${p}% below the baseline of ${b} blocks/s",
+               ("r", r.sync.blocks_per_sec)("p", max_regression_pct)("b", baseline.sync.blocks_per_sec) );
+         ok = false;
+      }
+   }
+   if( r.live.blocks_at_all_peers > 0 && baseline.live.blocks_at_all_peers > 0 ) {
+      const double ceiling = baseline.live.fanout_p95_ms * (100 + max_regression_pct) / 100;
+      if( r.live.fanout_p95_ms > ceiling ) {
+         elog( "p95 block fan-out of ${r} ms is more than ${p}% above the baseline of ${b} ms",
+               ("r", r.live.fanout_p95_ms)("p", max_regression_pct)("b", baseline.live.fanout_p95_ms) );
+         ok = false;
+      }
+   }
+   return ok;
+}
+
+void p2p_bench::set_program_options( options_description& cli ) {
+   cli.add_options()
+         ("p2p-address", bpo::value<string>()->default_value("127.0.0.1:9876"),
+          "the p2p-listen-endpoint of the node under test")
+         ("http-address", bpo::value<string>()->default_value("127.0.0.1:8888"),
+          "the http-server-address of the node under test, used for get_info")
+         ("peers", bpo::value<uint32_t>(&peers)->default_value(16),
+          "the number of peers connected at once")
+         ("sync-blocks", bpo::value<uint32_t>(&sync_blocks)->default_value(1000),
+          "the number of blocks, from block 1, every syncing peer fetches; limited by the node's last irreversible block")
+         ("sync-chunk", bpo::value<uint32_t>(&sync_chunk)->default_value(100),
+          "blocks asked for with each sync_request_message, like sync-fetch-span")
+         ("duration", bpo::value<uint32_t>(&duration_sec)->default_value(30),
+          "seconds the live peers follow the node")
+         ("protocol-version", bpo::value<uint16_t>(&protocol_version)->default_value(latest_net_version),
+          "the net protocol version the peers claim: 2 and up receive compact blocks, 3 and up compressed messages and 4 transaction batches")
+         ("peer-kbps", bpo::value<uint32_t>(&peer_kbps)->default_value(0),
+          "limit every peer's link to this many kbit/s by holding back its reads, 0 for no limit")
+         ("node-pid", bpo::value<int>(&node_pid),
+          "pid of a local node under test, to report its memory per connection")
+         ("threads", bpo::value<uint16_t>(&threads)->default_value(2),
+          "threads running the peers")
+         ("skip-sync", bpo::bool_switch(&skip_sync)->default_value(false), "skip the sync phase")
+         ("skip-live", bpo::bool_switch(&skip_live)->default_value(false), "skip the live phase")
+         ("output-file,o", bpo::value<bfs::path>(),
+          "write the results as JSON to this file, which can serve as a later --baseline, instead of stdout")
+         ("baseline", bpo::value<bfs::path>(),
+          "the results of an earlier run; exit with an error when sync blocks/s dropped or the p95 block fan-out grew more than --max-regression-pct")
+         ("max-regression-pct", bpo::value<uint32_t>(&max_regression_pct)->default_value(10),
+          "the change against --baseline that fails the run")
+         ("help", "Print this help message and exit.")
+         ;
+}
+
+void p2p_bench::initialize( const variables_map& options ) {
+   try {
+      std::tie( p2p_host, p2p_port ) = split_endpoint( options.at( "p2p-address" ).as<string>() );
+      std::tie( http_host, http_port ) = split_endpoint( options.at( "http-address" ).as<string>() );
+      if( options.count( "output-file" ) )
+         output_file = options.at( "output-file" ).as<bfs::path>();
+      if( options.count( "baseline" ) )
+         baseline_file = options.at( "baseline" ).as<bfs::path>();
+
+      ROXE_ASSERT( peers > 0, fc::invalid_arg_exception, "--peers must be at least 1" );
+      ROXE_ASSERT( sync_chunk > 0, fc::invalid_arg_exception, "--sync-chunk must be at least 1" );
+      ROXE_ASSERT( threads > 0, fc::invalid_arg_exception, "--threads must be at least 1" );
+      ROXE_ASSERT( protocol_version <= latest_net_version, fc::invalid_arg_exception,
+                   "--protocol-version must be at most ${v}", ("v", latest_net_version) );
+      ROXE_ASSERT( max_regression_pct < 100, fc::invalid_arg_exception, "--max-regression-pct must be below 100" );
+
+      info = http_post( http_host, http_port, "/v1/chain/get_info" );
+   } FC_LOG_AND_RETHROW()
+}
+
+
+int main(int argc, char** argv)
+{
+   options_description cli ("roxe-p2p-bench command line options");
+   try {
+      p2p_bench bench;
+      bench.set_program_options(cli);
+      variables_map vmap;
+      bpo::store(bpo::parse_command_line(argc, argv, cli), vmap);
+      bpo::notify(vmap);
+      if (vmap.count("help") > 0) {
+        cli.print(std::cerr);
+        return 0;
+      }
+      bench.initialize(vmap);
+
+      p2p_results results;
+      results.protocol_version = bench.protocol_version;
+      results.peer_kbps = bench.peer_kbps;
+      if( !bench.skip_sync )
+         results.sync = bench.run_sync();
+      if( !bench.skip_live ) {
+         bench.info = http_post( bench.http_host, bench.http_port, "/v1/chain/get_info" );
+         results.live = bench.run_live();
+      }
+
+      if( bench.output_file )
+         fc::json::save_to_file( results, fc::path( *bench.output_file ), true );
+      else
+         std::cout << fc::json::to_pretty_string( results ) << "\n";
+
+      if( !bench.check_baseline( results ) )
+         return 1;
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()));
+      return -1;
+   } catch( const boost::exception& e ) {
+      elog("${e}", ("e",boost::diagnostic_information(e)));
+      return -1;
+   } catch( const std::exception& e ) {
+      elog("${e}", ("e",e.what()));
+      return -1;
+   } catch( ... ) {
+      elog("unknown exception");
+      return -1;
+   }
+
+   return 0;
+}
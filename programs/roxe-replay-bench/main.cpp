@@ -0,0 +1,298 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE.txt
+ */
+#include <roxe/chain/block_log.hpp>
+#include <roxe/chain/controller.hpp>
+#include <roxe/chain/genesis_state.hpp>
+#include <roxe/chain/protocol_feature_manager.hpp>
+#include <roxe/chain/snapshot.hpp>
+#include <roxe/chain/wasm_interface.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/variant.hpp>
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <fstream>
+
+using namespace roxe::chain;
+namespace bfs = boost::filesystem;
+namespace bpo = boost::program_options;
+using bpo::options_description;
+using bpo::variables_map;
+
+/// every builtin protocol feature, so that any activation found in the replayed blocks is recognized
+static protocol_feature_set make_protocol_feature_set() {
+   protocol_feature_set pfs;
+   map< builtin_protocol_feature_t, optional<digest_type> > visited_builtins;
+
+   std::function<digest_type(builtin_protocol_feature_t)> add_builtins =
+   [&pfs, &visited_builtins, &add_builtins]( builtin_protocol_feature_t codename ) -> digest_type {
+      auto res = visited_builtins.emplace( codename, optional<digest_type>() );
+      if( !res.second ) {
+         ROXE_ASSERT( res.first->second, protocol_feature_exception,
+                     "invariant failure: cycle found in builtin protocol feature dependencies" );
+         return *res.first->second;
+      }
+
+      auto f = protocol_feature_set::make_default_builtin_protocol_feature( codename,
+      [&add_builtins]( builtin_protocol_feature_t d ) {
+         return add_builtins( d );
+      } );
+
+      const auto& pf = pfs.add_feature( f );
+      res.first->second = pf.feature_digest;
+      return pf.feature_digest;
+   };
+
+   for( const auto& p : builtin_protocol_feature_codenames ) {
+      add_builtins( p.first );
+   }
+   return pfs;
+}
+
+/// throughput and the split of the time spent in push_block, reported by a run and read back as a baseline
+struct replay_results {
+   uint32_t  first_block = 0;
+   uint32_t  last_block = 0;
+   uint64_t  blocks = 0;
+   uint64_t  transactions = 0;
+   uint64_t  total_us = 0;     ///< create_block_state_future and push_block, reading the block log excluded
+   uint64_t  apply_us = 0;
+   uint64_t  auth_us = 0;
+   uint64_t  wasm_us = 0;
+   uint64_t  chainbase_us = 0;
+   uint64_t  finalize_us = 0;
+   uint64_t  other_us = 0;     ///< total less auth, wasm, chainbase and finalize: native actions, block state, fork db
+   double    blocks_per_sec = 0;
+   double    transactions_per_sec = 0;
+};
+
+FC_REFLECT( replay_results, (first_block)(last_block)(blocks)(transactions)(total_us)(apply_us)(auth_us)(wasm_us)
+                            (chainbase_us)(finalize_us)(other_us)(blocks_per_sec)(transactions_per_sec) )
+
+struct replay_bench {
+   void set_program_options(options_description& cli);
+   void initialize(const variables_map& options);
+   replay_results run();
+   bool check_baseline( const replay_results& r )const;
+
+   bfs::path                        blocks_dir;
+   bfs::path                        data_dir;
+   optional<bfs::path>              snapshot_path;
+   optional<bfs::path>              output_file;
+   optional<bfs::path>              baseline_file;
+   uint32_t                         first_block;
+   uint32_t                         last_block;
+   uint64_t                         state_size_mb;
+   uint16_t                         threads;
+   bool                             skip_signatures;
+   bool                             keep_data_dir;
+   uint32_t                         max_regression_pct;
+   wasm_interface::vm_type          wasm_runtime = config::default_wasm_runtime;
+};
+
+replay_results replay_bench::run() {
+   block_log source( blocks_dir );
+   const auto source_head = source.read_head();
+   ROXE_ASSERT( source_head, block_log_exception, "No blocks found in block log" );
+
+   bfs::remove_all( data_dir );
+
+   controller::config cfg;
+   cfg.blocks_dir       = data_dir / config::default_blocks_dir_name;
+   cfg.state_dir        = data_dir / config::default_state_dir_name;
+   cfg.state_size       = state_size_mb * 1024 * 1024;
+   cfg.thread_pool_size = threads;
+   cfg.wasm_runtime     = wasm_runtime;
+   cfg.profile_wasm     = true;
+   cfg.profile_apply    = true;
+   if( skip_signatures )
+      cfg.block_validation_mode = validation_mode::LIGHT;
+
+   optional<std::ifstream> snapshot_file;
+   snapshot_reader_ptr snapshot;
+   if( snapshot_path ) {
+      snapshot_file.emplace( snapshot_path->generic_string(), std::ios::in | std::ios::binary );
+      snapshot = std::make_shared<istream_snapshot_reader>( *snapshot_file );
+      snapshot->validate();
+      snapshot->read_section<genesis_state>( [&cfg]( auto& section ) {
+         section.read_row( cfg.genesis );
+      } );
+   } else {
+      cfg.genesis = block_log::extract_genesis_state( blocks_dir );
+   }
+
+   controller chain( cfg, make_protocol_feature_set() );
+   chain.add_indices();
+   chain.startup( []() { return false; }, snapshot );
+   snapshot.reset();
+   snapshot_file.reset();
+
+   replay_results r;
+   r.first_block = std::max( first_block, chain.head_block_num() + 1 );
+   r.last_block  = std::min( last_block, source_head->block_num() );
+   ROXE_ASSERT( r.first_block == chain.head_block_num() + 1, block_log_exception,
+                "Replay must start right after the head block ${h} of the starting state", ("h", chain.head_block_num()) );
+   ROXE_ASSERT( r.first_block <= r.last_block, block_log_exception,
+                "No blocks to replay after block ${h}", ("h", chain.head_block_num()) );
+   ilog( "replaying block num ${first} through block num ${last}", ("first", r.first_block)("last", r.last_block) );
+
+   // time spent before the first replayed block, e.g. applying the genesis block, is not reported
+   chain.clear_apply_timing();
+   chain.get_wasm_interface().get_profiler().clear();
+
+   fc::microseconds total;
+   for( uint32_t n = r.first_block; n <= r.last_block; ++n ) {
+      auto b = source.read_block_by_num( n );
+      ROXE_ASSERT( b, block_log_exception, "Block ${n} is missing from the block log", ("n", n) );
+      r.transactions += b->transactions.size();
+
+      const auto start = fc::time_point::now();
+      auto bsf = chain.create_block_state_future( b );
+      chain.push_block( bsf );
+      total += fc::time_point::now() - start;
+
+      if( n % 10000 == 0 )
+         ilog( "replayed block ${n}", ("n", n) );
+   }
+   r.blocks = r.last_block - r.first_block + 1;
+
+   const auto& t = chain.get_apply_timing();
+   for( const auto& s : chain.get_wasm_interface().get_profiler().get_stats() )
+      r.wasm_us += s.total_us;
+   r.total_us     = total.count();
+   r.apply_us     = t.apply.count();
+   r.auth_us      = t.auth.count();
+   r.chainbase_us = t.chainbase.count();
+   r.finalize_us  = t.finalize.count();
+   const uint64_t accounted = r.auth_us + r.wasm_us + r.chainbase_us + r.finalize_us;
+   r.other_us     = r.total_us > accounted ? r.total_us - accounted : 0;
+   if( r.total_us ) {
+      r.blocks_per_sec       = r.blocks * 1000000.0 / r.total_us;
+      r.transactions_per_sec = r.transactions * 1000000.0 / r.total_us;
+   }
+   return r;
+}
+
+bool replay_bench::check_baseline( const replay_results& r )const {
+   if( !baseline_file )
+      return true;
+   const auto baseline = fc::json::from_file( *baseline_file ).as<replay_results>();
+   const double floor = baseline.blocks_per_sec * (100 - max_regression_pct) / 100;
+   if( r.blocks_per_sec < floor ) {
+      elog( "${r} blocks/s is more than ${p}% below the baseline of ${b} blocks/s",
+            ("r", r.blocks_per_sec)("p", max_regression_pct)("b", baseline.blocks_per_sec) );
+      return false;
+   }
+   ilog( "${r} blocks/s against a baseline of ${b} blocks/s", ("r", r.blocks_per_sec)("b", baseline.blocks_per_sec) );
+   return true;
+}
+
+void replay_bench::set_program_options(options_description& cli)
+{
+   cli.add_options()
+         ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
+          "the location of the blocks directory holding the blocks.log to replay (absolute path or relative to the current directory)")
+         ("snapshot", bpo::value<bfs::path>(),
+          "start from this snapshot instead of the genesis state of the block log")
+         ("data-dir", bpo::value<bfs::path>()->default_value("replay-bench-data"),
+          "the directory holding the state and blocks built by the replay; it is emptied before the run")
+         ("keep-data-dir", bpo::bool_switch(&keep_data_dir)->default_value(false),
+          "do not remove the data directory after the run")
+         ("first", bpo::value<uint32_t>(&first_block)->default_value(1),
+          "the first block number to replay, which must follow the head block of the starting state")
+         ("last", bpo::value<uint32_t>(&last_block)->default_value(std::numeric_limits<uint32_t>::max()),
+          "the last block number (inclusive) to replay")
+         ("state-size-mb", bpo::value<uint64_t>(&state_size_mb)->default_value(config::default_state_size / (1024 * 1024)),
+          "maximum size of the chain state in MiB")
+         ("threads", bpo::value<uint16_t>(&threads)->default_value(config::default_controller_thread_pool_size),
+          "the number of threads of the controller, which recover transaction keys and validate block headers")
+         ("skip-signatures", bpo::bool_switch(&skip_signatures)->default_value(false),
+          "replay in light validation mode, skipping key recovery and authorization checks")
+         ("wasm-runtime", bpo::value<wasm_interface::vm_type>()->value_name("wavm/wabt"),
+          "override the default WebAssembly runtime")
+         ("output-file,o", bpo::value<bfs::path>(),
+          "write the results as JSON to this file, which can serve as a later --baseline, instead of stdout")
+         ("baseline", bpo::value<bfs::path>(),
+          "the results of an earlier run; exit with an error when blocks/s dropped more than --max-regression-pct below it")
+         ("max-regression-pct", bpo::value<uint32_t>(&max_regression_pct)->default_value(10),
+          "the drop in blocks/s against --baseline that fails the run")
+         ("help", "Print this help message and exit.")
+         ;
+}
+
+void replay_bench::initialize(const variables_map& options) {
+   try {
+      auto absolute = []( const bfs::path& p ) { return p.is_relative() ? bfs::current_path() / p : p; };
+      blocks_dir = absolute( options.at( "blocks-dir" ).as<bfs::path>() );
+      data_dir   = absolute( options.at( "data-dir" ).as<bfs::path>() );
+      if( options.count( "snapshot" ) )
+         snapshot_path = absolute( options.at( "snapshot" ).as<bfs::path>() );
+      if( options.count( "output-file" ) )
+         output_file = absolute( options.at( "output-file" ).as<bfs::path>() );
+      if( options.count( "baseline" ) )
+         baseline_file = absolute( options.at( "baseline" ).as<bfs::path>() );
+      if( options.count( "wasm-runtime" ) )
+         wasm_runtime = options.at( "wasm-runtime" ).as<wasm_interface::vm_type>();
+
+      ROXE_ASSERT( bfs::exists( blocks_dir / "blocks.log" ), fc::invalid_arg_exception,
+                   "no blocks.log in ${d}", ("d", blocks_dir.generic_string()) );
+      ROXE_ASSERT( !snapshot_path || bfs::exists( *snapshot_path ), fc::invalid_arg_exception,
+                   "snapshot ${s} does not exist", ("s", snapshot_path->generic_string()) );
+      const auto blocks_rel = blocks_dir.lexically_relative( data_dir );
+      ROXE_ASSERT( blocks_rel.empty() || *blocks_rel.begin() == "..", fc::invalid_arg_exception,
+                   "--data-dir is emptied by the run and must not hold the replayed block log" );
+      ROXE_ASSERT( threads > 0, fc::invalid_arg_exception, "--threads must be at least 1" );
+      ROXE_ASSERT( max_regression_pct < 100, fc::invalid_arg_exception, "--max-regression-pct must be below 100" );
+   } FC_LOG_AND_RETHROW()
+}
+
+
+int main(int argc, char** argv)
+{
+   options_description cli ("roxe-replay-bench command line options");
+   try {
+      replay_bench bench;
+      bench.set_program_options(cli);
+      variables_map vmap;
+      bpo::store(bpo::parse_command_line(argc, argv, cli), vmap);
+      bpo::notify(vmap);
+      if (vmap.count("help") > 0) {
+        cli.print(std::cerr);
+        return 0;
+      }
+      bench.initialize(vmap);
+
+      const auto results = bench.run();
+      if( !bench.keep_data_dir )
+         bfs::remove_all( bench.data_dir );
+
+      if( bench.output_file )
+         fc::json::save_to_file( results, fc::path( *bench.output_file ), true );
+      else
+         std::cout << fc::json::to_pretty_string( results ) << "\n";
+
+      if( !bench.check_baseline( results ) )
+         return 1;
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()));
+      return -1;
+   } catch( const boost::exception& e ) {
+      elog("${e}", ("e",boost::diagnostic_information(e)));
+      return -1;
+   } catch( const std::exception& e ) {
+      elog("${e}", ("e",e.what()));
+      return -1;
+   } catch( ... ) {
+      elog("unknown exception");
+      return -1;
+   }
+
+   return 0;
+}
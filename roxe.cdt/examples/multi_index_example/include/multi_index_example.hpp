@@ -11,6 +11,7 @@ CONTRACT multi_index_example : public contract {
       ACTION print( name user );
       ACTION bysec( name secid );
       ACTION mod( name user, uint32_t n );
+      ACTION bench( uint32_t rows, uint32_t rounds );
 
       TABLE test_table {
          name test_primary;
@@ -26,5 +27,6 @@ CONTRACT multi_index_example : public contract {
       using print_action = action_wrapper<"print"_n, &multi_index_example::print>;
       using bysec_action = action_wrapper<"bysec"_n, &multi_index_example::bysec>;
       using mod_action = action_wrapper<"mod"_n, &multi_index_example::mod>;
+      using bench_action = action_wrapper<"bench"_n, &multi_index_example::bench>;
       test_tables testtab;
 };
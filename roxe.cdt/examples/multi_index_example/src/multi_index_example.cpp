@@ -32,3 +32,26 @@ ACTION multi_index_example::mod( name user, uint32_t n ) {
       row.datum = n;
    });
 }
+
+// Touches `rows` rows `rounds` times each the way an order book does (find, then modify), so the action's CPU
+// usage shows how lookups into the rows already loaded scale with their number.
+ACTION multi_index_example::bench( uint32_t rows, uint32_t rounds ) {
+   for ( uint32_t i = 0; i < rows; ++i ) {
+      if ( testtab.find(i) == testtab.end() ) {
+         testtab.emplace( _self, [&]( auto& u ) {
+            u.test_primary = name{i};
+            u.secondary = "bench"_n;
+            u.datum = 0;
+         });
+      }
+   }
+
+   for ( uint32_t r = 0; r < rounds; ++r ) {
+      for ( uint32_t i = 0; i < rows; ++i ) {
+         auto itr = testtab.require_find( i, "bench row missing" );
+         testtab.modify( itr, same_payer, [&]( auto& row ) {
+            row.datum += 1;
+         });
+      }
+   }
+}
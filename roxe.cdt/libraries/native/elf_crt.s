@@ -1,11 +1,13 @@
 .global _start
 .global ___putc
 .global _mmap
+.global ___rdtsc
 .global setjmp
 .global longjmp
 .type _start,@function
 .type ___putc,@function
 .type _mmap,@function
+.type ___rdtsc,@function
 .type setjmp,@function
 .type longjmp,@function
 
@@ -43,6 +45,12 @@ _mmap:
    syscall
    ret 
 
+___rdtsc:
+   rdtsc
+   shl $32, %rdx
+   or %rdx, %rax
+   ret
+
 setjmp:
 	mov %rbx, 0(%rdi)
 	mov %rbp, 8(%rdi)
@@ -64,6 +64,10 @@ extern "C" {
    int32_t db_idx64_end(capi_name code, uint64_t scope, capi_name table) {
       return intrinsics::get().call<intrinsics::db_idx64_end>(code, scope, table);
    }
+   int32_t db_idx64_range(capi_name code, uint64_t scope, capi_name table, capi_name primary_table, const uint64_t* secondary, uint64_t primary,
+                           uint32_t max_rows, void* data, uint32_t len) {
+      return intrinsics::get().call<intrinsics::db_idx64_range>(code, scope, table, primary_table, secondary, primary, max_rows, data, len);
+   }
    int32_t db_idx64_next(int32_t iterator, uint64_t* primary) {
       return intrinsics::get().call<intrinsics::db_idx64_next>(iterator, primary);
    }
@@ -94,6 +98,10 @@ extern "C" {
    int32_t db_idx128_end(capi_name code, uint64_t scope, capi_name table) {
       return intrinsics::get().call<intrinsics::db_idx128_end>(code, scope, table);
    }
+   int32_t db_idx128_range(capi_name code, uint64_t scope, capi_name table, capi_name primary_table, const uint128_t* secondary, uint64_t primary,
+                           uint32_t max_rows, void* data, uint32_t len) {
+      return intrinsics::get().call<intrinsics::db_idx128_range>(code, scope, table, primary_table, secondary, primary, max_rows, data, len);
+   }
    int32_t db_idx128_next(int32_t iterator, uint64_t* primary) {
       return intrinsics::get().call<intrinsics::db_idx128_next>(iterator, primary);
    }
@@ -1,6 +1,7 @@
 .global start
 .global ____putc
 .global __mmap
+.global ____rdtsc
 .global _setjmp
 .global _longjmp
 
@@ -38,6 +39,12 @@ __mmap:
    syscall
    ret 
 
+____rdtsc:
+   rdtsc
+   shl $32, %rdx
+   or %rdx, %rax
+   ret
+
 _setjmp:
 	mov %rbx, 0(%rdi)
 	mov %rbp, 8(%rdi)
@@ -0,0 +1,133 @@
+#pragma once
+#include "tester.hpp"
+
+#include <string_view>
+
+/**
+ * Native benchmark harness for contracts.
+ *
+ * Build the contract with `add_native_executable` together with a source file that lists the recorded actions,
+ * then hand them to `run_bench`. Each action is dispatched through the contract's `apply` with the
+ * `action_data_size`, `read_action_data` and `current_receiver` intrinsics answering from the recording; any
+ * other intrinsic the contract needs (database, authorization, ...) must be installed with
+ * `intrinsics::set_intrinsic` beforehand. Time is measured with the time stamp counter, both for the whole
+ * action and per intrinsic, so the report is directly comparable between two builds of the same contract.
+ *
+ * Memory allocated by the contract is not reclaimed between runs, so keep `runs` modest for actions that
+ * allocate heavily.
+ */
+namespace roxe { namespace native {
+
+   struct recorded_action {
+      name              receiver;
+      name              code;
+      name              action;
+      std::vector<char> data;
+   };
+
+   /// Decodes the hex form of action data, as printed by `clroxe` or found in block logs
+   inline std::vector<char> from_hex(std::string_view hex) {
+      auto nibble = [](char c) -> uint8_t {
+         if (c >= '0' && c <= '9') return c - '0';
+         if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+         if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+         roxe::check(false, "invalid hex character in recorded action data");
+         return 0;
+      };
+      roxe::check(hex.size() % 2 == 0, "odd length hex in recorded action data");
+      std::vector<char> out(hex.size() / 2);
+      for (size_t i = 0; i < out.size(); i++)
+         out[i] = char(nibble(hex[2*i]) << 4 | nibble(hex[2*i+1]));
+      return out;
+   }
+
+   struct bench_result {
+      name                 receiver;
+      name                 code;
+      name                 action;
+      uint32_t             runs     = 0;
+      uint32_t             failures = 0;
+      uint64_t             ticks    = 0;
+      intrinsics::profile  prof;
+   };
+
+   namespace _bench_detail {
+      /// Runs `apply` once, returning false if the contract aborted; kept out of line from the timing loop
+      /// so nothing live in the caller is clobbered by the longjmp
+      inline bool __attribute__((noinline)) dispatch(const recorded_action& act) {
+         __set_env_test();
+         if (setjmp(*___env_ptr) != 0) {
+            __reset_env();
+            std_err.clear();
+            return false;
+         }
+         apply(act.receiver.value, act.code.value, act.action.value);
+         __reset_env();
+         return true;
+      }
+   }
+
+   inline bench_result run_bench(const recorded_action& act, uint32_t runs) {
+      bench_result res{act.receiver, act.code, act.action};
+
+      auto prev_size     = intrinsics::get_intrinsic<intrinsics::action_data_size>();
+      auto prev_read     = intrinsics::get_intrinsic<intrinsics::read_action_data>();
+      auto prev_receiver = intrinsics::get_intrinsic<intrinsics::current_receiver>();
+      intrinsics::set_intrinsic<intrinsics::action_data_size>([&]() {
+            return uint32_t(act.data.size());
+         });
+      intrinsics::set_intrinsic<intrinsics::read_action_data>([&](void* msg, uint32_t len) {
+            const uint32_t sz = std::min(len, uint32_t(act.data.size()));
+            memcpy(msg, act.data.data(), sz);
+            return sz;
+         });
+      intrinsics::set_intrinsic<intrinsics::current_receiver>([&]() {
+            return act.receiver.value;
+         });
+
+      const bool disable_out = ___disable_output;
+      silence_output(true);
+      intrinsics::set_profile(&res.prof);
+      for (uint32_t i = 0; i < runs; i++) {
+         const uint64_t start = ___rdtsc();
+         const bool ok = _bench_detail::dispatch(act);
+         res.ticks += ___rdtsc() - start;
+         res.runs++;
+         res.failures += !ok;
+      }
+      intrinsics::set_profile(nullptr);
+      intrinsics::set_intrinsic<intrinsics::action_data_size>(prev_size);
+      intrinsics::set_intrinsic<intrinsics::read_action_data>(prev_read);
+      intrinsics::set_intrinsic<intrinsics::current_receiver>(prev_receiver);
+      std_out.clear();
+      silence_output(disable_out);
+      return res;
+   }
+
+   inline std::vector<bench_result> run_bench(const std::vector<recorded_action>& acts, uint32_t runs) {
+      std::vector<bench_result> results;
+      results.reserve(acts.size());
+      for (const auto& act : acts)
+         results.push_back(run_bench(act, runs));
+      return results;
+   }
+
+   /// Prints ticks per action, and for every intrinsic the action used, calls and ticks per action
+   inline void print_bench(const std::vector<bench_result>& results) {
+      const bool disable_out = ___disable_output;
+      silence_output(false);
+      for (const auto& r : results) {
+         const uint64_t runs = r.runs ? r.runs : 1;
+         roxe::print(r.receiver, " ", r.code, "::", r.action, " runs ", r.runs, " failures ", r.failures,
+                     " ticks/action ", r.ticks / runs, "\n");
+         for (uint32_t i = 0; i < intrinsics::INTRINSICS_SIZE; i++) {
+            if (r.prof.calls[i] == 0)
+               continue;
+            roxe::print("   ", intrinsics::names[i], " calls/action ", r.prof.calls[i] / runs,
+                        " ticks/action ", r.prof.ticks[i] / runs, "\n");
+         }
+      }
+      silence_output(disable_out);
+   }
+
+}} //ns roxe::native
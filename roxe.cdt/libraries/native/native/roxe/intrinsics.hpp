@@ -3,6 +3,8 @@
 
 #pragma once
 
+extern "C" uint64_t ___rdtsc();
+
 namespace roxe { namespace native {
    
    class intrinsics {
@@ -23,9 +25,37 @@ namespace roxe { namespace native {
             std::function<void()>{[](){}}
          };
 
+         static constexpr const char* names[] = {
+            INTRINSICS(GET_NAME)
+         };
+
+         /**
+          * Per-intrinsic call counts and time stamp counter ticks, filled in by call() while installed with
+          * set_profile(). Calls that abort through roxe_assert are not recorded.
+          */
+         struct profile {
+            uint64_t calls[INTRINSICS_SIZE] = {};
+            uint64_t ticks[INTRINSICS_SIZE] = {};
+
+            void clear() { *this = profile{}; }
+         };
+
+         static void set_profile(profile* p) { intrinsics::get().prof = p; }
+         static profile* get_profile() { return intrinsics::get().prof; }
+
          template <intrinsic_name IN, typename... Args>
          auto call(Args... args) -> decltype(std::get<IN>(intrinsics::get().funcs)(args...)) {
-            return std::get<IN>(intrinsics::get().funcs)(args...); 
+            if (!prof)
+               return std::get<IN>(intrinsics::get().funcs)(args...);
+            struct timer {
+               profile* p;
+               uint64_t start = ___rdtsc();
+               ~timer() {
+                  p->calls[IN]++;
+                  p->ticks[IN] += ___rdtsc() - start;
+               }
+            } t{prof};
+            return std::get<IN>(intrinsics::get().funcs)(args...);
          }
 
          template <intrinsic_name IN, typename F>
@@ -39,6 +69,9 @@ namespace roxe { namespace native {
                -> typename std::remove_reference<decltype(std::get<IN>(intrinsics::get().funcs))>::type {
             return std::get<IN>(intrinsics::get().funcs);
          }
+
+      private:
+         profile* prof = nullptr;
    };
 
 }} //ns roxe::native
@@ -56,6 +56,7 @@ intrinsic_macro(db_idx64_find_secondary) \
 intrinsic_macro(db_idx64_lowerbound) \
 intrinsic_macro(db_idx64_upperbound) \
 intrinsic_macro(db_idx64_end) \
+intrinsic_macro(db_idx64_range) \
 intrinsic_macro(db_idx64_next) \
 intrinsic_macro(db_idx64_previous) \
 intrinsic_macro(db_idx128_store) \
@@ -66,6 +67,7 @@ intrinsic_macro(db_idx128_find_secondary) \
 intrinsic_macro(db_idx128_lowerbound) \
 intrinsic_macro(db_idx128_upperbound) \
 intrinsic_macro(db_idx128_end) \
+intrinsic_macro(db_idx128_range) \
 intrinsic_macro(db_idx128_next) \
 intrinsic_macro(db_idx128_previous) \
 intrinsic_macro(db_idx256_store) \
@@ -158,6 +160,9 @@ intrinsic_macro(get_context_free_data)
 #define CREATE_ENUM(name) \
    name,
 
+#define GET_NAME(name) \
+   #name,
+
 #define GENERATE_TYPE_MAPPING(name) \
    struct __ ## name ## _types { \
       using deduced_full_ts = decltype(roxe::native::get_args_full(::name)); \
@@ -0,0 +1,158 @@
+#include <memory>
+#include <cstring>
+#include "core/roxe/check.hpp"
+
+#ifdef ROXE_NATIVE
+   extern "C" {
+      size_t _current_memory();
+      size_t _grow_memory(size_t);
+   }
+#define CURRENT_MEMORY _current_memory()
+#define GROW_MEMORY(X) _grow_memory(X)
+#else
+#define CURRENT_MEMORY __builtin_wasm_current_memory()
+#define GROW_MEMORY(X) __builtin_wasm_grow_memory(X)
+#endif
+
+namespace roxe {
+   /**
+    * Size-class allocator: requests up to 2 KiB are rounded to one of 15 bins (16 bytes, then two classes per
+    * power of two) and served from that bin's free list, falling back to bumping the top of the heap. Larger
+    * blocks are bumped as well and recycled first-fit. Each block carries an 8 byte header holding its capacity,
+    * so free and realloc need no searching. Memory is never returned to the VM; it is reset with every action.
+    */
+   struct bmalloc {
+      static constexpr uint32_t wasm_page_size = 64*1024;
+      static constexpr uint32_t header_size    = 8;
+      static constexpr uint32_t max_small      = 2048;
+      static constexpr uint32_t bin_count      = 15;
+
+      struct free_block {
+         free_block* next;
+      };
+
+      static inline size_t align(size_t ptr, uint8_t align_amt) {
+         return (ptr + align_amt-1) & ~size_t(align_amt-1);
+      }
+
+      static inline uint32_t bin_of(uint32_t sz) {
+         if (sz <= 16)
+            return 0;
+         const uint32_t p    = 31 - __builtin_clz(sz - 1); // 2^p < sz <= 2^(p+1)
+         const uint32_t half = (1u << p) | (1u << (p - 1));
+         return 2 * (p - 4) + (sz <= half ? 1 : 2);
+      }
+
+      static inline uint32_t bin_size(uint32_t bin) {
+         if (bin == 0)
+            return 16;
+         const uint32_t p = (bin - 1) / 2 + 4;
+         return (bin & 1) ? (1u << p) | (1u << (p - 1)) : (1u << (p + 1));
+      }
+
+      static inline uint32_t& capacity(void* ptr) {
+         return *reinterpret_cast<uint32_t*>(static_cast<char*>(ptr) - header_size);
+      }
+
+      bmalloc() {
+         volatile uintptr_t heap_base = 0; // linker places this at address 0
+         top   = align(*(size_t*)heap_base, 8);
+         limit = size_t(CURRENT_MEMORY) * wasm_page_size;
+      }
+
+      char* bump(uint32_t cap) {
+         const size_t needed = size_t(header_size) + cap;
+         if (limit - top < needed) {
+            const size_t pages = (top + needed - limit + wasm_page_size - 1) / wasm_page_size;
+            roxe::check(GROW_MEMORY(pages) != -1, "failed to allocate pages");
+            limit += pages * wasm_page_size;
+         }
+         char* ret = reinterpret_cast<char*>(top) + header_size;
+         top += needed;
+         capacity(ret) = cap;
+         return ret;
+      }
+
+      void* allocate(size_t sz) {
+         if (sz == 0)
+            return nullptr;
+         roxe::check(sz <= UINT32_MAX - header_size - 8, "failed to allocate pages");
+
+         if (sz <= max_small) {
+            const uint32_t bin = bin_of(uint32_t(sz));
+            if (free_block* b = bins[bin]) {
+               bins[bin] = b->next;
+               return b;
+            }
+            return bump(bin_size(bin));
+         }
+
+         const uint32_t cap = uint32_t(align(sz, 8));
+         for (free_block** link = &large; *link; link = &(*link)->next) {
+            free_block* b = *link;
+            if (capacity(b) >= cap) {
+               *link = b->next;
+               return b;
+            }
+         }
+         return bump(cap);
+      }
+
+      void deallocate(void* ptr) {
+         if (!ptr)
+            return;
+         const uint32_t cap = capacity(ptr);
+         free_block* b = static_cast<free_block*>(ptr);
+         free_block*& head = cap <= max_small ? bins[bin_of(cap)] : large;
+         b->next = head;
+         head = b;
+      }
+
+      void* reallocate(void* ptr, size_t sz) {
+         if (!ptr)
+            return allocate(sz);
+         if (sz == 0) {
+            deallocate(ptr);
+            return nullptr;
+         }
+         const uint32_t cap = capacity(ptr);
+         if (sz <= cap)
+            return ptr;
+         void* ret = allocate(sz);
+         memcpy(ret, ptr, cap);
+         deallocate(ptr);
+         return ret;
+      }
+
+      size_t      top;
+      size_t      limit;
+      free_block* bins[bin_count];
+      free_block* large;
+   };
+   bmalloc _bmalloc;
+} // ns roxe
+
+extern "C" {
+
+void* malloc(size_t size) {
+   return roxe::_bmalloc.allocate(size);
+}
+
+void* calloc(size_t count, size_t size) {
+   if (size && count > SIZE_MAX / size)
+      return nullptr;
+   if (void* ptr = roxe::_bmalloc.allocate(count*size)) {
+      memset(ptr, 0, count*size);
+      return ptr;
+   }
+   return nullptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+   return roxe::_bmalloc.reallocate(ptr, size);
+}
+
+void free(void* ptr) {
+   roxe::_bmalloc.deallocate(ptr);
+}
+}
@@ -369,6 +369,29 @@ int32_t db_idx64_upperbound(capi_name code, uint64_t scope, capi_name table, uin
 __attribute__((roxe_wasm_import))
 int32_t db_idx64_end(capi_name code, uint64_t scope, capi_name table);
 
+/**
+  *
+  *  Copy a range of a secondary 64-bit integer index table, together with the table rows it refers to, in a single call
+  *  Rows are copied in index order starting at the first one whose (secondary, primary) key pair is >= the given pair, each laid out as
+  *  the secondary key, the primary key (`uint64_t`) and the row size (`uint32_t`) followed by the row itself
+  *  Requires the BATCHED_INDEX_READS protocol feature
+  *
+  *  @brief Copy a range of a secondary 64-bit integer index table together with the rows it refers to
+  *  @param code - The name of the owner of the table
+  *  @param scope - The scope where the table resides
+  *  @param table - The secondary index table name
+  *  @param primary_table - The name of the table holding the rows
+  *  @param secondary - Pointer to the secondary key at which to start
+  *  @param primary - The primary key at which to start among rows with a secondary key equal to `*secondary`
+  *  @param max_rows - The maximum number of rows to copy
+  *  @param data - Pointer to the buffer receiving the rows
+  *  @param len - Size of the buffer
+  *  @return the number of rows copied, zero past the end of the index, or minus the space needed if not even the first row fits
+  */
+__attribute__((roxe_wasm_import))
+int32_t db_idx64_range(capi_name code, uint64_t scope, capi_name table, capi_name primary_table, const uint64_t* secondary, uint64_t primary,
+                        uint32_t max_rows, void* data, uint32_t len);
+
 
 
 /**
@@ -522,6 +545,29 @@ int32_t db_idx128_upperbound(capi_name code, uint64_t scope, capi_name table, ui
 __attribute__((roxe_wasm_import))
 int32_t db_idx128_end(capi_name code, uint64_t scope, capi_name table);
 
+/**
+  *
+  *  Copy a range of a secondary 128-bit integer index table, together with the table rows it refers to, in a single call
+  *  Rows are copied in index order starting at the first one whose (secondary, primary) key pair is >= the given pair, each laid out as
+  *  the secondary key, the primary key (`uint64_t`) and the row size (`uint32_t`) followed by the row itself
+  *  Requires the BATCHED_INDEX_READS protocol feature
+  *
+  *  @brief Copy a range of a secondary 128-bit integer index table together with the rows it refers to
+  *  @param code - The name of the owner of the table
+  *  @param scope - The scope where the table resides
+  *  @param table - The secondary index table name
+  *  @param primary_table - The name of the table holding the rows
+  *  @param secondary - Pointer to the secondary key at which to start
+  *  @param primary - The primary key at which to start among rows with a secondary key equal to `*secondary`
+  *  @param max_rows - The maximum number of rows to copy
+  *  @param data - Pointer to the buffer receiving the rows
+  *  @param len - Size of the buffer
+  *  @return the number of rows copied, zero past the end of the index, or minus the space needed if not even the first row fits
+  */
+__attribute__((roxe_wasm_import))
+int32_t db_idx128_range(capi_name code, uint64_t scope, capi_name table, capi_name primary_table, const uint128_t* secondary, uint64_t primary,
+                        uint32_t max_rows, void* data, uint32_t len);
+
 /**
   *
   *  Store an association of a 256-bit secondary key to a primary key in a secondary 256-bit index table
@@ -384,6 +384,13 @@ namespace roxe {
       ROXELIB_SERIALIZE( asset, (amount)(symbol) )
    };
 
+   /// @cond IMPLEMENTATIONS
+
+   template<>
+   struct is_fixed_layout<asset> : std::true_type {};
+
+   /// @endcond
+
   /**
    *  Extended asset which stores the information of the owner of the asset
    *
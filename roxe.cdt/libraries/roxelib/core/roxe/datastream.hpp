@@ -13,6 +13,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <variant>
 
@@ -494,12 +495,47 @@ DataStream& operator << ( DataStream& ds, const std::string& v ) {
  */
 template<typename DataStream>
 DataStream& operator >> ( DataStream& ds, std::string& v ) {
-   std::vector<char> tmp;
-   ds >> tmp;
-   if( tmp.size() )
-      v = std::string(tmp.data(),tmp.data()+tmp.size());
-   else
-      v = std::string();
+   unsigned_int s;
+   ds >> s;
+   v.resize( s.value );
+   if( s.value )
+      ds.read( v.data(), s.value );
+   return ds;
+}
+
+/**
+ *  Serialize a string_view into a stream, in the same format as a string; Char is deduced so that
+ *  string literals keep resolving to the std::string overload
+ *
+ *  @param ds - The stream to write
+ *  @param v - The value to serialize
+ *  @tparam DataStream - Type of datastream
+ *  @tparam Char - Character type of the view
+ *  @return DataStream& - Reference to the datastream
+ */
+template<typename DataStream, typename Char>
+DataStream& operator << ( DataStream& ds, const std::basic_string_view<Char>& v ) {
+   ds << unsigned_int( v.size() );
+   if (v.size())
+      ds.write(v.data(), v.size());
+   return ds;
+}
+
+/**
+ *  Deserialize a string without copying it: the view refers to the stream's buffer, so it is only valid
+ *  as long as that buffer is. Action arguments declared as std::string_view point into the action data
+ *  read by the dispatcher, which outlives the action.
+ *
+ *  @param ds - The stream to read
+ *  @param v - The destination for deserialized value
+ *  @return datastream<const char*>& - Reference to the datastream
+ */
+inline datastream<const char*>& operator >> ( datastream<const char*>& ds, std::string_view& v ) {
+   unsigned_int s;
+   ds >> s;
+   roxe::check( ds.remaining() >= s.value, "read" );
+   v = std::string_view( ds.pos(), s.value );
+   ds.skip( s.value );
    return ds;
 }
 
@@ -539,6 +575,20 @@ DataStream& operator >> ( DataStream& ds, std::array<T,N>& v ) {
    return ds;
 }
 
+/**
+ *  Marks a class whose packed form is exactly its in-memory representation, so an aggregate made only of such
+ *  members (and arithmetic or enum members) is packed and unpacked with a single bounds check and memcpy.
+ *  Specialize it for classes with their own serialization that keep this property, e.g. `name` or `asset`.
+ *
+ *  @ingroup datastream
+ *  @tparam T - The type to be marked
+ */
+template<typename T>
+struct is_fixed_layout : std::false_type {};
+
+template<typename T, std::size_t N>
+struct is_fixed_layout<std::array<T,N>> : is_fixed_layout<T> {};
+
 namespace _datastream_detail {
    /**
     * Check if type T is a pointer
@@ -568,6 +618,53 @@ namespace _datastream_detail {
       return std::is_arithmetic<T>::value ||
              std::is_enum<T>::value;
    }
+
+   /**
+    * Check if type T is packed as its in-memory representation; bool is excluded as it is normalized on unpack
+    *
+    * @brief Check if type T is packed as its in-memory representation
+    * @tparam T - The type to be checked
+    * @return true if T can be packed and unpacked with memcpy
+    * @return false otherwise
+    */
+   template<typename T>
+   constexpr bool has_fixed_layout() {
+      if constexpr( std::is_same<T, bool>::value )
+         return false;
+      else if constexpr( is_primitive<T>() )
+         return true;
+      else if constexpr( std::is_array<T>::value )
+         return false;
+      else {
+         static_assert( !is_fixed_layout<T>::value || std::is_trivially_copyable<T>::value,
+                        "types marked is_fixed_layout must be trivially copyable" );
+         return is_fixed_layout<T>::value;
+      }
+   }
+
+   template<typename T, std::size_t... I>
+   constexpr bool fields_have_fixed_layout( std::index_sequence<I...> ) {
+      return ( has_fixed_layout<boost::pfr::tuple_element_t<I, T>>() && ... ) &&
+             ( sizeof(boost::pfr::tuple_element_t<I, T>) + ... + 0 ) == sizeof(T);
+   }
+
+   /**
+    * Check if the reflected class T is packed as its in-memory representation: every field has a fixed layout
+    * and there is no padding between them. Nested classes only count when marked with `is_fixed_layout`, as
+    * they may have their own serialization.
+    *
+    * @brief Check if the reflected class T is packed as its in-memory representation
+    * @tparam T - The type to be checked
+    * @return true if T can be packed and unpacked with memcpy
+    * @return false otherwise
+    */
+   template<typename T>
+   constexpr bool is_fixed_layout_aggregate() {
+      if constexpr( std::is_aggregate<T>::value && std::is_trivially_copyable<T>::value )
+         return fields_have_fixed_layout<T>( std::make_index_sequence<boost::pfr::tuple_size_v<T>>() );
+      else
+         return false;
+   }
 }
 
 /**
@@ -875,9 +972,13 @@ DataStream& operator>>( DataStream& ds, std::tuple<Args...>& t ) {
  */
 template<typename DataStream, typename T, std::enable_if_t<std::is_class<T>::value>* = nullptr>
 DataStream& operator<<( DataStream& ds, const T& v ) {
-   boost::pfr::for_each_field(v, [&](const auto& field) {
-      ds << field;
-   });
+   if constexpr( _datastream_detail::is_fixed_layout_aggregate<T>() ) {
+      ds.write( (const char*)&v, sizeof(T) );
+   } else {
+      boost::pfr::for_each_field(v, [&](const auto& field) {
+         ds << field;
+      });
+   }
    return ds;
 }
 
@@ -893,9 +994,13 @@ DataStream& operator<<( DataStream& ds, const T& v ) {
  */
 template<typename DataStream, typename T, std::enable_if_t<std::is_class<T>::value>* = nullptr>
 DataStream& operator>>( DataStream& ds, T& v ) {
-   boost::pfr::for_each_field(v, [&](auto& field) {
-      ds >> field;
-   });
+   if constexpr( _datastream_detail::is_fixed_layout_aggregate<T>() ) {
+      ds.read( (char*)&v, sizeof(T) );
+   } else {
+      boost::pfr::for_each_field(v, [&](auto& field) {
+         ds >> field;
+      });
+   }
    return ds;
 }
 
@@ -6,6 +6,7 @@
 
 #include "check.hpp"
 #include "serialize.hpp"
+#include "datastream.hpp"
 
 #include <string>
 #include <string_view>
@@ -271,6 +272,13 @@ namespace roxe {
       ROXELIB_SERIALIZE( name, (value) )
    };
 
+   /// @cond IMPLEMENTATIONS
+
+   template<>
+   struct is_fixed_layout<name> : std::true_type {};
+
+   /// @endcond
+
    namespace detail {
       template <char... Str>
       struct to_const_char_arr {
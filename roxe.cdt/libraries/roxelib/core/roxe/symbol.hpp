@@ -235,6 +235,13 @@ namespace roxe {
      return ds;
    }
 
+   /// @cond IMPLEMENTATIONS
+
+   template<>
+   struct is_fixed_layout<symbol_code> : std::true_type {};
+
+   /// @endcond
+
    /**
     *  Stores information about a symbol, the symbol can be 7 characters long.
     *
@@ -373,6 +380,13 @@ namespace roxe {
      return ds;
    }
 
+   /// @cond IMPLEMENTATIONS
+
+   template<>
+   struct is_fixed_layout<symbol> : std::true_type {};
+
+   /// @endcond
+
    /**
     *  Extended asset which stores the information of the owner of the symbol
     *
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <string>
 #include "serialize.hpp"
+#include "datastream.hpp"
 
 namespace roxe {
   /**
@@ -207,4 +208,13 @@ namespace roxe {
     */
    typedef block_timestamp block_timestamp_type;
 
+   /// @cond IMPLEMENTATIONS
+
+   template<> struct is_fixed_layout<microseconds>    : std::true_type {};
+   template<> struct is_fixed_layout<time_point>      : std::true_type {};
+   template<> struct is_fixed_layout<time_point_sec>  : std::true_type {};
+   template<> struct is_fixed_layout<block_timestamp> : std::true_type {};
+
+   /// @endcond
+
 } // namespace roxe
@@ -20,6 +20,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <variant>
 
@@ -752,12 +753,47 @@ DataStream& operator << ( DataStream& ds, const std::string& v ) {
  */
 template<typename DataStream>
 DataStream& operator >> ( DataStream& ds, std::string& v ) {
-   std::vector<char> tmp;
-   ds >> tmp;
-   if( tmp.size() )
-      v = std::string(tmp.data(),tmp.data()+tmp.size());
-   else
-      v = std::string();
+   unsigned_int s;
+   ds >> s;
+   v.resize( s.value );
+   if( s.value )
+      ds.read( v.data(), s.value );
+   return ds;
+}
+
+/**
+ *  Serialize a string_view into a stream, in the same format as a string; Char is deduced so that
+ *  string literals keep resolving to the std::string overload
+ *
+ *  @param ds - The stream to write
+ *  @param v - The value to serialize
+ *  @tparam DataStream - Type of datastream
+ *  @tparam Char - Character type of the view
+ *  @return DataStream& - Reference to the datastream
+ */
+template<typename DataStream, typename Char>
+DataStream& operator << ( DataStream& ds, const std::basic_string_view<Char>& v ) {
+   ds << unsigned_int( v.size() );
+   if (v.size())
+      ds.write(v.data(), v.size());
+   return ds;
+}
+
+/**
+ *  Deserialize a string without copying it: the view refers to the stream's buffer, so it is only valid
+ *  as long as that buffer is. Action arguments declared as std::string_view point into the action data
+ *  read by the dispatcher, which outlives the action.
+ *
+ *  @param ds - The stream to read
+ *  @param v - The destination for deserialized value
+ *  @return datastream<const char*>& - Reference to the datastream
+ */
+inline datastream<const char*>& operator >> ( datastream<const char*>& ds, std::string_view& v ) {
+   unsigned_int s;
+   ds >> s;
+   roxe::check( ds.remaining() >= s.value, "read" );
+   v = std::string_view( ds.pos(), s.value );
+   ds.skip( s.value );
    return ds;
 }
 
@@ -52,7 +52,7 @@ namespace roxe {
     *
     * @tparam T - The contract class that has the correponding action handler, this contract should be derived from roxe::contract
     * @tparam Q - The namespace of the action handler function
-    * @tparam Args - The arguments that the action handler accepts, i.e. members of the action
+    * @tparam Args - The arguments that the action handler accepts, i.e. members of the action. Arguments declared as std::string_view refer to the action data directly instead of copying it
     * @param obj - The contract object that has the correponding action handler
     * @param func - The action handler
     * @return true
@@ -75,8 +75,9 @@ namespace roxe {
 
       T inst(self, code, ds);
 
-      auto f2 = [&]( auto... a ){
-         ((&inst)->*func)( a... );
+      // the unpacked arguments are not used again, hand them over instead of copying each one
+      auto f2 = [&]( auto&... a ){
+         ((&inst)->*func)( std::move(a)... );
       };
 
       boost::mp11::tuple_apply( f2, args );
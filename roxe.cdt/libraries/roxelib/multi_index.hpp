@@ -151,6 +151,85 @@ namespace _multi_index_detail {
       static constexpr roxe::fixed_bytes<32> true_lowest() { return roxe::fixed_bytes<32>(); }
    };
 
+
+   /**
+    * Open-addressing map from a 64-bit key to a position in multi_index's row cache, letting cached rows be found
+    * by primary key or primary iterator without scanning every row loaded so far. Linear probing with
+    * backward-shift deletion keeps it free of tombstones; it doubles once half full.
+    */
+   class row_index {
+   public:
+      int32_t find( uint64_t key )const {
+         if( _slots.empty() ) return -1;
+         for( size_t i = bucket( key );; i = (i + 1) & mask() ) {
+            const auto& s = _slots[i];
+            if( s.pos < 0 ) return -1;
+            if( s.key == key ) return s.pos;
+         }
+      }
+
+      void set( uint64_t key, int32_t pos ) {
+         if( (_size + 1) * 2 > _slots.size() ) grow();
+         for( size_t i = bucket( key );; i = (i + 1) & mask() ) {
+            auto& s = _slots[i];
+            if( s.pos < 0 ) {
+               s = slot{ key, pos };
+               ++_size;
+               return;
+            }
+            if( s.key == key ) {
+               s.pos = pos;
+               return;
+            }
+         }
+      }
+
+      void erase( uint64_t key ) {
+         if( _slots.empty() ) return;
+         size_t i = bucket( key );
+         for( ;; i = (i + 1) & mask() ) {
+            if( _slots[i].pos < 0 ) return;
+            if( _slots[i].key == key ) break;
+         }
+         // pull back any later entry of the probe run whose home bucket does not lie between the hole and itself
+         for( size_t j = (i + 1) & mask(); _slots[j].pos >= 0; j = (j + 1) & mask() ) {
+            if( ((j - bucket( _slots[j].key )) & mask()) >= ((j - i) & mask()) ) {
+               _slots[i] = _slots[j];
+               i = j;
+            }
+         }
+         _slots[i].pos = -1;
+         --_size;
+      }
+
+   private:
+      struct slot {
+         uint64_t key = 0;
+         int32_t  pos = -1;
+      };
+
+      size_t mask()const { return _slots.size() - 1; }
+
+      size_t bucket( uint64_t key )const {
+         return static_cast<size_t>( (key * 0x9E3779B97F4A7C15ULL) >> _shift );
+      }
+
+      void grow() {
+         std::vector<slot> old( _slots.empty() ? 16 : _slots.size() * 2 );
+         old.swap( _slots );
+         _shift = 64;
+         for( size_t n = _slots.size(); n > 1; n >>= 1 ) --_shift;
+         _size = 0;
+         for( const auto& s : old ) {
+            if( s.pos >= 0 ) set( s.key, s.pos );
+         }
+      }
+
+      std::vector<slot> _slots;
+      size_t            _size  = 0;
+      uint32_t          _shift = 64;
+   };
+
 }
 
 /**
@@ -298,7 +377,49 @@ class multi_index
          int32_t               _primary_itr;
       };
 
-      mutable std::vector<item_ptr> _items_vector;
+      mutable std::vector<item_ptr>               _items_vector;
+      mutable _multi_index_detail::row_index      _items_by_primary_key;
+      mutable _multi_index_detail::row_index      _items_by_primary_itr;
+
+      const item* find_cached_item_by_primary_key( uint64_t pk )const {
+         auto pos = _items_by_primary_key.find( pk );
+         return pos < 0 ? nullptr : _items_vector[pos]._item.get();
+      }
+
+      const item* find_cached_item_by_primary_itr( int32_t itr )const {
+         auto pos = _items_by_primary_itr.find( static_cast<uint32_t>(itr) );
+         return pos < 0 ? nullptr : _items_vector[pos]._item.get();
+      }
+
+      const item& cache_item( std::unique_ptr<item>&& itm )const {
+         const item* ptr = itm.get();
+         auto pk   = itm->primary_key();
+         auto pitr = itm->__primary_itr;
+         auto pos  = static_cast<int32_t>( _items_vector.size() );
+
+         _items_vector.emplace_back( std::move(itm), pk, pitr );
+         _items_by_primary_key.set( pk, pos );
+         _items_by_primary_itr.set( static_cast<uint32_t>(pitr), pos );
+         return *ptr;
+      }
+
+      /// drops the row from the cache, handing back ownership so it outlives the caller's use of it
+      std::unique_ptr<item> uncache_item( uint64_t pk )const {
+         auto pos = _items_by_primary_key.find( pk );
+         if( pos < 0 ) return nullptr;
+
+         std::unique_ptr<item> removed = std::move( _items_vector[pos]._item );
+         _items_by_primary_key.erase( pk );
+         _items_by_primary_itr.erase( static_cast<uint32_t>(_items_vector[pos]._primary_itr) );
+
+         if( static_cast<size_t>(pos) + 1 != _items_vector.size() ) {
+            _items_vector[pos] = std::move( _items_vector.back() );
+            _items_by_primary_key.set( _items_vector[pos]._primary_key, pos );
+            _items_by_primary_itr.set( static_cast<uint32_t>(_items_vector[pos]._primary_itr), pos );
+         }
+         _items_vector.pop_back();
+         return removed;
+      }
 
       template<name::raw IndexName, typename Extractor, uint64_t Number, bool IsConst>
       struct index {
@@ -583,11 +704,8 @@ class multi_index
       const item& load_object_by_primary_iterator( int32_t itr )const {
          using namespace _multi_index_detail;
 
-         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(), [&](const item_ptr& ptr) {
-            return ptr._primary_itr == itr;
-         });
-         if( itr2 != _items_vector.rend() )
-            return *itr2->_item;
+         if( auto cached = find_cached_item_by_primary_itr( itr ) )
+            return *cached;
 
          auto size = db_get_i64( itr, nullptr, 0 );
          roxe::check( size >= 0, "error reading iterator" );
@@ -611,17 +729,13 @@ class multi_index
             });
          });
 
-         const item* ptr = itm.get();
-         auto pk   = itm->primary_key();
-         auto pitr = itm->__primary_itr;
-
-         _items_vector.emplace_back( std::move(itm), pk, pitr );
+         const item& cached = cache_item( std::move(itm) );
 
          if ( max_stack_buffer_size < size_t(size) ) {
             free(buffer);
          }
 
-         return *ptr;
+         return cached;
       } /// load_object_by_primary_iterator
 
    public:
@@ -1362,13 +1476,7 @@ class multi_index
             });
          });
 
-         const item* ptr = itm.get();
-         auto pk   = itm->primary_key();
-         auto pitr = itm->__primary_itr;
-
-         _items_vector.emplace_back( std::move(itm), pk, pitr );
-
-         return {this, ptr};
+         return {this, &cache_item( std::move(itm) )};
       }
 
       /**
@@ -1566,11 +1674,8 @@ class multi_index
        *  @endcode
        */
       const_iterator find( uint64_t primary )const {
-         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(), [&](const item_ptr& ptr) {
-            return ptr._item->primary_key() == primary;
-         });
-         if( itr2 != _items_vector.rend() )
-            return iterator_to(*(itr2->_item));
+         if( auto cached = find_cached_item_by_primary_key( primary ) )
+            return iterator_to(*cached);
 
          auto itr = db_find_i64( _code.value, _scope, static_cast<uint64_t>(TableName), primary );
          if( itr < 0 ) return end();
@@ -1588,11 +1693,8 @@ class multi_index
        */
 
       const_iterator require_find( uint64_t primary, const char* error_msg = "unable to find key" )const {
-         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(), [&](const item_ptr& ptr) {
-               return ptr._item->primary_key() == primary;
-            });
-         if( itr2 != _items_vector.rend() )
-            return iterator_to(*(itr2->_item));
+         if( auto cached = find_cached_item_by_primary_key( primary ) )
+            return iterator_to(*cached);
 
          auto itr = db_find_i64( _code.value, _scope, static_cast<uint64_t>(TableName), primary );
          roxe::check( itr >= 0,  error_msg );
@@ -1686,13 +1788,8 @@ class multi_index
          roxe::check( _code.value == current_receiver(), "cannot erase objects in table of another contract" ); // Quick fix for mutating db using multi_index that shouldn't allow mutation. Real fix can come in RC2.
 
          auto pk = objitem.primary_key();
-         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(), [&](const item_ptr& ptr) {
-            return ptr._item->primary_key() == pk;
-         });
-
-         roxe::check( itr2 != _items_vector.rend(), "attempt to remove object that was not in multi_index" );
-
-         _items_vector.erase(--(itr2.base()));
+         auto removed = uncache_item( pk );
+         roxe::check( removed != nullptr, "attempt to remove object that was not in multi_index" );
 
          db_remove_i64( objitem.__primary_itr );
 
@@ -0,0 +1,73 @@
+/**
+ *  @file
+ *  @copyright defined in roxe.cdt/LICENSE.txt
+ */
+
+#include <string>
+#include <vector>
+
+#include <roxe/roxe.hpp>
+#include <roxe/bench.hpp>
+
+using std::vector;
+
+using roxe::name;
+using roxe::native::from_hex;
+using roxe::native::intrinsics;
+using roxe::native::recorded_action;
+using roxe::native::run_bench;
+
+// A stand-in contract: sums the action data, and rejects the `fail` action
+extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action) {
+   roxe::check(current_receiver() == receiver, "wrong receiver");
+   roxe::check(action != "fail"_n.value, "requested failure");
+   vector<char> data(action_data_size());
+   read_action_data(data.data(), data.size());
+   uint32_t sum = 0;
+   for (char c : data)
+      sum += uint8_t(c);
+   roxe::print(sum);
+}
+
+// Definitions in `roxe.cdt/libraries/native/native/roxe/bench.hpp`
+ROXE_TEST_BEGIN(from_hex_test)
+   CHECK_EQUAL( from_hex("").size(), 0 )
+   CHECK_EQUAL( (from_hex("00ff10Ab") == vector<char>{0x00, char(0xff), 0x10, char(0xab)}), true )
+
+   CHECK_ASSERT( "odd length hex in recorded action data", ([]() {from_hex("abc");}) )
+   CHECK_ASSERT( "invalid hex character in recorded action data", ([]() {from_hex("0g");}) )
+ROXE_TEST_END
+
+ROXE_TEST_BEGIN(run_bench_test)
+   recorded_action sum{"alice"_n, "alice"_n, "sum"_n, from_hex("010203")};
+   recorded_action fail{"alice"_n, "alice"_n, "fail"_n, {}};
+
+   auto results = run_bench(vector<recorded_action>{sum, fail}, 10);
+   CHECK_EQUAL( results.size(), 2 )
+
+   CHECK_EQUAL( results[0].action, "sum"_n )
+   CHECK_EQUAL( results[0].runs, 10 )
+   CHECK_EQUAL( results[0].failures, 0 )
+   CHECK_EQUAL( results[0].prof.calls[intrinsics::action_data_size], 10 )
+   CHECK_EQUAL( results[0].prof.calls[intrinsics::read_action_data], 10 )
+   CHECK_EQUAL( results[0].prof.calls[intrinsics::printui], 10 )
+
+   CHECK_EQUAL( results[1].failures, 10 )
+   CHECK_EQUAL( results[1].prof.calls[intrinsics::read_action_data], 0 )
+
+   // profiling and the recorded action data are only in place while benchmarking
+   CHECK_EQUAL( intrinsics::get_profile(), nullptr )
+   CHECK_ASSERT( "unsupported intrinsic", ([]() {action_data_size();}) )
+ROXE_TEST_END
+
+int main(int argc, char* argv[]) {
+   bool verbose = false;
+   if( argc >= 2 && std::strcmp( argv[1], "-v" ) == 0 ) {
+      verbose = true;
+   }
+   silence_output(!verbose);
+
+   ROXE_TEST(from_hex_test);
+   ROXE_TEST(run_bench_test);
+   return has_failed();
+}
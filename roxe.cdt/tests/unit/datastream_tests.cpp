@@ -8,9 +8,11 @@
 #include <list>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <roxe/tester.hpp>
+#include <roxe/asset.hpp>
 #include <roxe/binary_extension.hpp>
 #include <roxe/crypto.hpp>
 #include <roxe/datastream.hpp>
@@ -37,6 +39,8 @@ using roxe::datastream;
 using roxe::fixed_bytes;
 using roxe::ignore;
 using roxe::ignore_wrapper;
+using roxe::asset;
+using roxe::name;
 using roxe::pack;
 using roxe::pack_size;
 using roxe::public_key;
@@ -54,6 +58,23 @@ struct be_test {
    ROXELIB_SERIALIZE( be_test, (val) )
 };
 
+// Table-like rows for the fixed layout tests: the first is packed with a memcpy, the others field by field
+struct fixed_row {
+   name     owner;
+   asset    balance;
+   uint64_t id;
+};
+
+struct padded_row {
+   uint32_t a;
+   uint64_t b;
+};
+
+struct bool_row {
+   uint8_t  a;
+   bool     b;
+};
+
 // Definitions in `roxe.cdt/libraries/roxe/datastream.hpp`
 ROXE_TEST_BEGIN(datastream_test)
    static constexpr uint16_t buffer_size{256};
@@ -383,6 +404,21 @@ ROXE_TEST_BEGIN(datastream_stream_test)
    ds >> str;
    CHECK_EQUAL( cstr, str )
 
+   // ----------------
+   // std::string_view
+   ds.seekp(0);
+   fill(begin(datastream_buffer), end(datastream_buffer), 0);
+   static const std::string_view csv {"abcdefghi"};
+   std::string_view sv{};
+   ds << csv;
+   ds.seekp(0);
+   ds >> sv;
+   CHECK_EQUAL( csv, sv )
+   CHECK_EQUAL( true, sv.data() > datastream_buffer && sv.data() < datastream_buffer + buffer_size )
+   ds.seekp(0);
+   ds >> str;
+   CHECK_EQUAL( string{csv}, str )
+
    // ----------
    // std::tuple
    ds.seekp(0);
@@ -592,6 +628,37 @@ ROXE_TEST_BEGIN(misc_datastream_test)
    }
 ROXE_TEST_END
 
+// Definitions in `roxe.cdt/libraries/roxe/datastream.hpp`
+ROXE_TEST_BEGIN(fixed_layout_test)
+   static_assert( roxe::_datastream_detail::is_fixed_layout_aggregate<fixed_row>() );
+   static_assert( !roxe::_datastream_detail::is_fixed_layout_aggregate<padded_row>() );
+   static_assert( !roxe::_datastream_detail::is_fixed_layout_aggregate<bool_row>() );
+   static_assert( !roxe::_datastream_detail::is_fixed_layout_aggregate<be_test>() );
+
+   // the memcpy path produces the same bytes as packing each field
+   const fixed_row fr{"alice"_n, asset{42, symbol{"SYS", 4}}, 7};
+   const vector<char> packed = pack(fr);
+   CHECK_EQUAL( packed.size(), 8u + 16u + 8u )
+   CHECK_EQUAL( packed == pack(std::make_tuple(fr.owner, fr.balance, fr.id)), true )
+
+   const fixed_row fr2 = unpack<fixed_row>(packed);
+   CHECK_EQUAL( fr2.owner, fr.owner )
+   CHECK_EQUAL( fr2.balance, fr.balance )
+   CHECK_EQUAL( fr2.id, fr.id )
+
+   // one bounds check covers the whole row
+   CHECK_ASSERT( "read", ([]() { unpack<fixed_row>(vector<char>(31)); }) )
+
+   const padded_row pr{1, 2};
+   CHECK_EQUAL( pack_size(pr), 12u )
+   const padded_row pr2 = unpack<padded_row>(pack(pr));
+   CHECK_EQUAL( pr2.a, 1u )
+   CHECK_EQUAL( pr2.b, 2u )
+
+   const bool_row br = unpack<bool_row>(vector<char>{3, 2});
+   CHECK_EQUAL( br.b, true )
+ROXE_TEST_END
+
 int main(int argc, char* argv[]) {
    bool verbose = false;
    if( argc >= 2 && std::strcmp( argv[1], "-v" ) == 0 ) {
@@ -603,5 +670,6 @@ int main(int argc, char* argv[]) {
    ROXE_TEST(datastream_specialization_test);
    ROXE_TEST(datastream_stream_test);
    ROXE_TEST(misc_datastream_test);
+   ROXE_TEST(fixed_layout_test);
    return has_failed();
 }
@@ -266,8 +266,9 @@ namespace roxe { namespace cdt {
                   i++;
                }
                ss << decl->getParent()->getQualifiedNameAsString() << "{roxe::name{r},roxe::name{c},ds}." << decl->getNameAsString() << "(";
+               // arguments are moved into the action; those declared std::string_view already point into buff
                for (int i=0; i < decl->parameters().size(); i++) {
-                  ss << "arg" << i;
+                  ss << "std::move(arg" << i << ")";
                   if (i < decl->parameters().size()-1)
                      ss << ", ";
                }
@@ -398,6 +398,8 @@ struct generation_utils {
          {"double", "float64"},
          {"long double", "float128"},
 
+         {"string_view", "string"},
+
          {"unsigned_int", "varuint32"},
          {"signed_int",   "varint32"},
 
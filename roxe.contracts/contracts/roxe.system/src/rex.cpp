@@ -546,6 +546,13 @@ namespace roxesystem {
          return { delete_loan, delta_stake };
       };
 
+      /// the queues are checked through their index keys so idle queues cost no row reads
+      const time_point now = current_time_point();
+      auto is_loan_due = [&]( const auto& idx ) {
+         uint64_t expiration = 0;
+         return idx.first_key( expiration ) && expiration <= uint64_t( now.time_since_epoch().count() );
+      };
+
       /// transfer from roxe.names to roxe.rex
       if ( pool->namebid_proceeds.amount > 0 ) {
          channel_to_rex( names_account, pool->namebid_proceeds );
@@ -558,10 +565,8 @@ namespace roxesystem {
       {
          rex_cpu_loan_table cpu_loans( get_self(), get_self().value );
          auto cpu_idx = cpu_loans.get_index<"byexpr"_n>();
-         for ( uint16_t i = 0; i < max; ++i ) {
+         for ( uint16_t i = 0; i < max && is_loan_due( cpu_idx ); ++i ) {
             auto itr = cpu_idx.begin();
-            if ( itr == cpu_idx.end() || itr->expiration > current_time_point() ) break;
-
             auto result = process_expired_loan( cpu_idx, itr );
             if ( result.second != 0 )
                update_resource_limits( itr->from, itr->receiver, 0, result.second );
@@ -575,10 +580,8 @@ namespace roxesystem {
       {
          rex_net_loan_table net_loans( get_self(), get_self().value );
          auto net_idx = net_loans.get_index<"byexpr"_n>();
-         for ( uint16_t i = 0; i < max; ++i ) {
+         for ( uint16_t i = 0; i < max && is_loan_due( net_idx ); ++i ) {
             auto itr = net_idx.begin();
-            if ( itr == net_idx.end() || itr->expiration > current_time_point() ) break;
-
             auto result = process_expired_loan( net_idx, itr );
             if ( result.second != 0 )
                update_resource_limits( itr->from, itr->receiver, result.second, 0 );
@@ -588,9 +591,10 @@ namespace roxesystem {
          }
       }
 
-      /// process sellrex orders
-      if ( _rexorders.begin() != _rexorders.end() ) {
-         auto idx  = _rexorders.get_index<"bytime"_n>();
+      /// process sellrex orders, closed ones sort last
+      auto idx = _rexorders.get_index<"bytime"_n>();
+      uint64_t first_order_time = 0;
+      if ( idx.first_key( first_order_time ) && first_order_time != std::numeric_limits<uint64_t>::max() ) {
          auto oitr = idx.begin();
          for ( uint16_t i = 0; i < max; ++i ) {
             if ( oitr == idx.end() || !oitr->is_open ) break;
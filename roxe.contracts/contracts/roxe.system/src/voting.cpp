@@ -110,6 +110,36 @@ namespace roxesystem {
       return double(staked) * std::pow( 2, weight );
    }
 
+   /**
+    * Per-producer vote changes, ordered by producer name, for a voter moving `old_weight` off `old_producers` and
+    * `new_weight` onto `new_producers` (either may be null). Both lists are sorted, so a single merge replaces
+    * building a map; the deltas are computed with the same floating point operations in the same order as
+    * accumulating into one, producer by producer.
+    */
+   static std::vector< std::pair<name, std::pair<double, bool /*new*/>> >
+   merge_vote_deltas( const std::vector<name>* old_producers, double old_weight,
+                      const std::vector<name>* new_producers, double new_weight ) {
+      static const std::vector<name> none;
+      const auto& olds = old_producers ? *old_producers : none;
+      const auto& news = new_producers ? *new_producers : none;
+
+      std::vector< std::pair<name, std::pair<double, bool>> > deltas;
+      deltas.reserve( olds.size() + news.size() );
+      auto o = olds.begin();
+      auto n = news.begin();
+      while( o != olds.end() || n != news.end() ) {
+         if( n == news.end() || (o != olds.end() && *o < *n) ) {
+            deltas.emplace_back( *o++, std::make_pair( 0.0 - old_weight, false ) );
+         } else if( o == olds.end() || *n < *o ) {
+            deltas.emplace_back( *n++, std::make_pair( 0.0 + new_weight, true ) );
+         } else {
+            deltas.emplace_back( *n, std::make_pair( (0.0 - old_weight) + new_weight, true ) );
+            ++o; ++n;
+         }
+      }
+      return deltas;
+   }
+
    double system_contract::update_total_votepay_share( const time_point& ct,
                                                        double additional_shares_delta,
                                                        double shares_rate_delta )
@@ -204,7 +234,7 @@ namespace roxesystem {
          new_vote_weight += voter->proxied_vote_weight;
       }
 
-      std::map<name, std::pair<double, bool /*new*/> > producer_deltas;
+      const std::vector<name>* old_producers = nullptr;
       if ( voter->last_vote_weight > 0 ) {
          if( voter->proxy ) {
             auto old_proxy = _voters.find( voter->proxy.value );
@@ -214,11 +244,7 @@ namespace roxesystem {
                });
             propagate_weight_change( *old_proxy );
          } else {
-            for( const auto& p : voter->producers ) {
-               auto& d = producer_deltas[p];
-               d.first -= voter->last_vote_weight;
-               d.second = false;
-            }
+            old_producers = &voter->producers;
          }
       }
 
@@ -232,16 +258,11 @@ namespace roxesystem {
                });
             propagate_weight_change( *new_proxy );
          }
-      } else {
-         if( new_vote_weight >= 0 ) {
-            for( const auto& p : producers ) {
-               auto& d = producer_deltas[p];
-               d.first += new_vote_weight;
-               d.second = true;
-            }
-         }
       }
 
+      const auto producer_deltas = merge_vote_deltas( old_producers, voter->last_vote_weight,
+                                                      !proxy && new_vote_weight >= 0 ? &producers : nullptr, new_vote_weight );
+
       const auto ct = current_time_point();
       double delta_change_rate         = 0.0;
       double total_inactive_vpay_share = 0.0;
@@ -252,14 +273,16 @@ namespace roxesystem {
                check( false, ( "producer " + pitr->owner.to_string() + " is not currently registered" ).data() );
             }
             double init_total_votes = pitr->total_votes;
-            _producers.modify( pitr, same_payer, [&]( auto& p ) {
-               p.total_votes += pd.second.first;
-               if ( p.total_votes < 0 ) { // floating point arithmetics can give small negative numbers
-                  p.total_votes = 0;
-               }
-               _gstate.total_producer_vote_weight += pd.second.first;
-               //check( p.total_votes >= 0, "something bad happened" );
-            });
+            if( pd.second.first != 0 ) { // a vote refreshed with unchanged weight leaves the row and the total as they are
+               _producers.modify( pitr, same_payer, [&]( auto& p ) {
+                  p.total_votes += pd.second.first;
+                  if ( p.total_votes < 0 ) { // floating point arithmetics can give small negative numbers
+                     p.total_votes = 0;
+                  }
+                  _gstate.total_producer_vote_weight += pd.second.first;
+                  //check( p.total_votes >= 0, "something bad happened" );
+               });
+            }
             auto prod2 = _producers2.find( pd.first.value );
             if( prod2 != _producers2.end() ) {
                const auto last_claim_plus_3days = pitr->last_claim_time + microseconds(3 * useconds_per_day);
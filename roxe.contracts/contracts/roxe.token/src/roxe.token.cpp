@@ -95,15 +95,21 @@ void token::transfer( const name&    from,
     check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
     check( memo.size() <= 256, "memo has more than 256 bytes" );
 
-    asset fee = asset(st.fee, st.supply.symbol);
+    // the fee is part of the stats row read above; charge it together with the quantity so the sender's
+    // balance row is read and written once
+    const asset fee( st.fee, st.supply.symbol );
+    const name saving_account{"roxe.saving"_n};
 
     auto payer = has_auth(to) ? to : from;
 
-    sub_balance(from, quantity);
-    sub_balance(from, fee);
-    add_balance(to, quantity, payer);
-    roxe::name saving_account{"roxe.saving"_n};
-    add_balance(saving_account, fee, payer); //FIXME to roxe.system:to_savings
+    sub_balance( from, quantity + fee );
+    if( to == saving_account ) {
+       add_balance( to, quantity + fee, payer );
+    } else {
+       add_balance( to, quantity, payer );
+       if( fee.amount > 0 )
+          add_balance( saving_account, fee, payer ); //FIXME to roxe.system:to_savings
+    }
 }
 
 void token::sub_balance( const name& owner, const asset& value ) {
@@ -168,11 +174,12 @@ void token::setfee(const name &owner, const symbol &symbol, const int64_t fee) {
     auto it = acnts.find(symbol.code().raw());
     check(it != acnts.end(), "Balance row already deleted or never existed. Action won't have any effect.");
     check(fee >= default_tx_fee, "Cannot set fee below default value(1).");
-    stats statstable(get_self(), symbol.raw());
+    stats statstable(get_self(), symbol.code().raw());
 
     auto existing = statstable.find(symbol.code().raw());
     check(existing != statstable.end(), "token with symbol does not exist, create token before setfee");
     const auto &st = *existing;
+    check(st.supply.symbol == symbol, "symbol precision mismatch");
     statstable.modify(st, same_payer, [&](auto &s) {
         s.fee = fee;
     });
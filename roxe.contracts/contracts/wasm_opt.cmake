@@ -0,0 +1,23 @@
+# Optimizes WASM in place with wasm-opt and reports the size change.
+# Invoked as: cmake -DWASM_OPT=<wasm-opt> -DWASM_OPT_FLAGS=<flags> -DWASM=<file.wasm> -P wasm_opt.cmake
+
+separate_arguments(flags UNIX_COMMAND "${WASM_OPT_FLAGS}")
+
+file(READ ${WASM} before HEX)
+string(LENGTH "${before}" before_size)
+math(EXPR before_size "${before_size} / 2")
+
+execute_process(COMMAND ${WASM_OPT} ${flags} ${WASM} -o ${WASM}.opt
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+   file(REMOVE ${WASM}.opt)
+   message(FATAL_ERROR "wasm-opt failed on ${WASM}")
+endif()
+file(RENAME ${WASM}.opt ${WASM})
+
+file(READ ${WASM} after HEX)
+string(LENGTH "${after}" after_size)
+math(EXPR after_size "${after_size} / 2")
+
+get_filename_component(name ${WASM} NAME)
+message(STATUS "wasm-opt ${name}: ${before_size} -> ${after_size} bytes")
@@ -1153,6 +1153,18 @@ class Node(object):
         payload="[ \"%s\", %d, %d ]" % (salt, period, batchSize)
         return self.processCurlCmd("txn_test_gen", "start_generation", payload, silentErrors=silentErrors, exitOnError=exitOnError, exitMsg=exitMsg, returnType=returnType)
 
+    def txnGenStartLoad(self, load, silentErrors=True, exitOnError=False, exitMsg=None, returnType=ReturnType.json):
+        assert(isinstance(load, dict))
+        assert(isinstance(returnType, ReturnType))
+
+        payload="[ %s ]" % (json.dumps(load))
+        return self.processCurlCmd("txn_test_gen", "start_load", payload, silentErrors=silentErrors, exitOnError=exitOnError, exitMsg=exitMsg, returnType=returnType)
+
+    def txnGenGetReport(self, silentErrors=True, exitOnError=False, exitMsg=None, returnType=ReturnType.json):
+        assert(isinstance(returnType, ReturnType))
+
+        return self.processCurlCmd("txn_test_gen", "get_report", "{}", silentErrors=silentErrors, exitOnError=exitOnError, exitMsg=exitMsg, returnType=returnType)
+
     def waitForTransBlockIfNeeded(self, trans, waitForTransBlock, exitOnError=False):
         if not waitForTransBlock:
             return trans
@@ -1353,7 +1365,7 @@ class Node(object):
     # TBD: make nodeId an internal property
     # pylint: disable=too-many-locals
     # If nodroxePath is equal to None, it will use the existing nodroxe path
-    def relaunch(self, nodeId, chainArg=None, newChain=False, timeout=Utils.systemWaitTimeout, addOrSwapFlags=None, cachePopen=False, nodroxePath=None):
+    def relaunch(self, nodeId, chainArg=None, newChain=False, timeout=Utils.systemWaitTimeout, addOrSwapFlags=None, cachePopen=False, nodroxePath=None, waitSleepTime=1):
 
         assert(self.pid is None)
         assert(self.killed)
@@ -1403,7 +1415,7 @@ class Node(object):
                 pass
             return False
 
-        isAlive=Utils.waitForBool(isNodeAlive, timeout, sleepTime=1)
+        isAlive=Utils.waitForBool(isNodeAlive, timeout, sleepTime=waitSleepTime)
         if isAlive:
             Utils.Print("Node relaunch was successfull.")
         else:
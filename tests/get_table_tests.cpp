@@ -136,6 +136,16 @@ BOOST_FIXTURE_TEST_CASE( get_scope_test, TESTER ) try {
    BOOST_REQUIRE_EQUAL(0u, result.rows.size());
    BOOST_REQUIRE_EQUAL("", result.more);
 
+   // count only, the limit does not apply
+   param.table = N(accounts);
+   param.lower_bound = param.upper_bound = "";
+   param.count_only = true;
+   result = plugin.read_only::get_table_by_scope(param);
+   BOOST_REQUIRE_EQUAL(0u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(true, result.count.valid());
+   BOOST_REQUIRE_EQUAL(4u, *result.count);
+   BOOST_REQUIRE_EQUAL("", result.more);
+
 } FC_LOG_AND_RETHROW() /// get_scope_test
 
 BOOST_FIXTURE_TEST_CASE( get_table_test, TESTER ) try {
@@ -315,6 +325,58 @@ BOOST_FIXTURE_TEST_CASE( get_table_test, TESTER ) try {
       BOOST_REQUIRE_EQUAL("7777.0000 CCC", result.rows[0]["balance"].as_string());
    }
 
+   // get table: continue from next_key
+   p.lower_bound = "";
+   p.upper_bound = "";
+   p.limit = 1;
+   p.reverse = false;
+   result = plugin.read_only::get_table_rows(p);
+   BOOST_REQUIRE_EQUAL(true, result.more);
+   BOOST_REQUIRE_EQUAL(true, result.next_key.valid());
+   p.lower_bound = *result.next_key;
+   result = plugin.read_only::get_table_rows(p);
+   BOOST_REQUIRE_EQUAL(1u, result.rows.size());
+   if (result.rows.size() >= 1) {
+      BOOST_REQUIRE_EQUAL("8888.0000 BBB", result.rows[0]["balance"].as_string());
+   }
+
+   // get table: raw rows are not decoded
+   p.lower_bound = "";
+   p.limit = 10;
+   p.json = false;
+   result = plugin.read_only::get_table_rows(p);
+   BOOST_REQUIRE_EQUAL(4u, result.rows.size());
+   if (result.rows.size() >= 4) {
+      auto data = result.rows[0].as<vector<char>>();
+      BOOST_REQUIRE_EQUAL(16u, data.size()); // asset balance
+      BOOST_REQUIRE_EQUAL(99990000, *reinterpret_cast<const int64_t*>(data.data()));
+   }
+
+   // get table: keys only
+   p.keys_only = true;
+   result = plugin.read_only::get_table_rows(p);
+   BOOST_REQUIRE_EQUAL(4u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(false, result.more);
+   BOOST_REQUIRE_EQUAL(false, result.count.valid());
+   if (result.rows.size() >= 4) {
+      BOOST_REQUIRE_EQUAL(symbol(4, "AAA").to_symbol_code().value, result.rows[0].as_uint64());
+      BOOST_REQUIRE_EQUAL(symbol(4, "ROC").to_symbol_code().value, result.rows[3].as_uint64());
+   }
+   p.keys_only = false;
+
+   // get table: count only, the limit does not apply
+   p.count_only = true;
+   p.limit = 1;
+   p.lower_bound = "BBB";
+   result = plugin.read_only::get_table_rows(p);
+   BOOST_REQUIRE_EQUAL(0u, result.rows.size());
+   BOOST_REQUIRE_EQUAL(false, result.more);
+   BOOST_REQUIRE_EQUAL(true, result.count.valid());
+   BOOST_REQUIRE_EQUAL(3u, *result.count);
+
+   p.keys_only = true;
+   BOOST_REQUIRE_THROW(plugin.read_only::get_table_rows(p), contract_table_query_exception);
+
 } FC_LOG_AND_RETHROW()
 
 BOOST_FIXTURE_TEST_CASE( get_table_by_seckey_test, TESTER ) try {
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+
+from testUtils import Utils
+from Cluster import Cluster
+from WalletMgr import WalletMgr
+from Node import BlockType
+from TestHelper import AppArgs
+from TestHelper import TestHelper
+
+import http.client
+import json
+import multiprocessing
+import os
+import random
+import shutil
+import signal
+import time
+
+###############################################################
+# http_api_load_bench
+#  Boots a node from a snapshot and measures how http_plugin holds up under a mix of read requests.
+#  Without <--snapshot> the reference state is built first: a producing node and a txn_test_gen_plugin node create
+#  <--blocks> blocks of transfers, a third node snapshots them and is restarted from that snapshot, following the
+#  producer so there are blocks for get_block. With <--snapshot> the bench node is isolated and booted from the canned
+#  snapshot instead, and since nothing is known about that chain <--query-mix> must describe the requests.
+#
+#  A query mix is a json list of { "name", "path", "body", "weight" } entries, e.g. a production query log reduced to
+#  its shapes. The default mix covers get_info, get_table_rows with limits of 1, 10 and 100, get_account and get_block.
+#
+#  For every level of <--concurrency> the mix is fired for <--duration> seconds from that many kept-alive connections,
+#  each in its own process so the client does not serialize on the interpreter lock. Per request name the latency
+#  percentiles, throughput and errors are reported, along with the node's cpu use and main thread occupancy (cpu time
+#  of the thread running the chain, out of the wall time). Results are written as json to <--results-file>; given a
+#  <--baseline> of an earlier run, any throughput that fell or p99 latency that grew by more than
+#  <--max-regression-pct> fails the test.
+###############################################################
+
+Print=Utils.Print
+errorExit=Utils.errorExit
+
+appArgs=AppArgs()
+extraArgs = appArgs.add(flag="--blocks", type=int, help="How many blocks of load make up the reference state", default=300)
+extraArgs = appArgs.add(flag="--snapshot", type=str, help="Canned snapshot to boot the bench node from", default=None)
+extraArgs = appArgs.add(flag="--query-mix", type=str, help="Json file with the weighted requests to send", default=None)
+extraArgs = appArgs.add(flag="--concurrency", type=str, help="Comma separated numbers of concurrent connections", default="1,8,32")
+extraArgs = appArgs.add(flag="--duration", type=int, help="Seconds each concurrency level runs", default=30)
+extraArgs = appArgs.add(flag="--http-threads", type=int, help="http-threads of the bench node", default=2)
+extraArgs = appArgs.add(flag="--results-file", type=str, help="File the json results are written to", default="http_api_bench.json")
+extraArgs = appArgs.add(flag="--baseline", type=str, help="Results of an earlier run to compare against", default=None)
+extraArgs = appArgs.add(flag="--max-regression-pct", type=float, help="Allowed loss of throughput or growth of p99 latency against the baseline", default=25.0)
+args = TestHelper.parse_args({"--dump-error-details","--keep-logs","-v","--leave-running","--clean-run"}, applicationSpecificArgs=appArgs)
+Utils.Debug=args.v
+cluster=Cluster(walletd=True)
+dumpErrorDetails=args.dump_error_details
+keepLogs=args.keep_logs
+dontKill=args.leave_running
+killAll=args.clean_run
+referenceBlocks=args.blocks if args.blocks > 0 else 1
+duration=args.duration if args.duration > 0 else 1
+concurrencyLevels=[int(c) for c in args.concurrency.split(",") if int(c) > 0]
+
+walletMgr=WalletMgr(True)
+testSuccessful=False
+killRoxeInstances=not dontKill
+killWallet=not dontKill
+
+producerNodeNum=0
+txnGenNodeNum=1
+benchNodeNum=2
+accountPrefix="txntestacct"
+startupTimeout=1800
+clockTicks=os.sysconf("SC_CLK_TCK")
+
+def cpuSeconds(statFile):
+    """utime + stime of a /proc stat file, in seconds"""
+    with open(statFile, "r") as f:
+        # the command name may hold spaces, the fields after it are fixed
+        fields=f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / clockTicks
+
+def fire(worker):
+    """sends requests from one connection until the deadline, returns the latencies and errors of every name"""
+    host, port, mix, deadline, seed=worker
+    rnd=random.Random(seed)
+    weights=[q["weight"] for q in mix]
+    latencies={ q["name"]: [] for q in mix }
+    errors={ q["name"]: 0 for q in mix }
+    conn=http.client.HTTPConnection(host, port, timeout=30)
+    while time.time() < deadline:
+        q=rnd.choices(mix, weights=weights)[0]
+        body=q["body"] if isinstance(q["body"], str) else json.dumps(q["body"])
+        start=time.perf_counter()
+        try:
+            conn.request("POST", q["path"], body, {"Content-Type": "application/json"})
+            response=conn.getresponse()
+            response.read()
+            if response.status == 200:
+                latencies[q["name"]].append(time.perf_counter()-start)
+            else:
+                errors[q["name"]]+=1
+        except (http.client.HTTPException, OSError):
+            errors[q["name"]]+=1
+            conn.close()
+            conn=http.client.HTTPConnection(host, port, timeout=30)
+    conn.close()
+    return latencies, errors
+
+def percentile(ordered, pct):
+    return ordered[min(len(ordered)-1, int(len(ordered) * pct / 100.0))]
+
+try:
+    TestHelper.printSystemInfo("BEGIN")
+    cluster.setWalletMgr(walletMgr)
+
+    if args.snapshot is not None and args.query_mix is None:
+        errorExit("--snapshot needs a --query-mix describing requests that make sense for its chain")
+
+    cluster.killall(allInstances=killAll)
+    cluster.cleanup()
+    specificExtraNodroxeArgs={
+        txnGenNodeNum:"--plugin roxe::txn_test_gen_plugin --txn-test-gen-account-prefix %s" % (accountPrefix),
+        benchNodeNum:"--plugin roxe::producer_api_plugin --http-threads %d" % (args.http_threads)}
+    Print("Stand up cluster")
+    if cluster.launch(prodCount=1, onlyBios=False, pnodes=1, totalNodes=3, totalProducers=1,
+                      useBiosBootFile=False, specificExtraNodroxeArgs=specificExtraNodroxeArgs, loadSystemContract=False) is False:
+        errorExit("Failed to stand up roxe cluster.")
+
+    producerNode=cluster.getNode(producerNodeNum)
+    txnGenNode=cluster.getNode(txnGenNodeNum)
+    benchNode=cluster.getNode(benchNodeNum)
+    dataDir=Utils.getNodeDataDir(benchNodeNum)
+
+    def waitForBlock(node, blockNum, blockType=BlockType.head, timeout=None):
+        if not node.waitForBlock(blockNum, timeout=timeout, blockType=blockType, reportInterval=20):
+            info=node.getInfo()
+            errorExit("Failed to get to %s block number %d. Last had head block number %d and lib %d" %
+                      (blockType, blockNum, info["head_block_num"], info["last_irreversible_block_num"]))
+
+    def bootFromSnapshot(snapshotFile):
+        benchNode.kill(signal.SIGTERM)
+        shutil.rmtree(os.path.join(dataDir, "state"), ignore_errors=True)
+        shutil.rmtree(os.path.join(dataDir, "blocks"), ignore_errors=True)
+        if not benchNode.relaunch(benchNodeNum, chainArg="--snapshot %s" % (snapshotFile), timeout=startupTimeout, cachePopen=True):
+            errorExit("Failed to boot the bench node from %s" % (snapshotFile))
+
+    if args.snapshot is None:
+        Print("Build the reference state from %d blocks of generated transactions" % (referenceBlocks))
+        txnGenNode.txnGenCreateTestAccounts(cluster.roxeAccount.name, cluster.roxeAccount.activePrivateKey, exitOnError=True)
+        txnGenNode.txnGenStart("bench", 1000, 200, exitOnError=True)
+        loadEnd=producerNode.getBlockNum(BlockType.head)+referenceBlocks
+        waitForBlock(producerNode, loadEnd, timeout=referenceBlocks)
+        txnGenNode.processCurlCmd("txn_test_gen", "stop_generation", "{}")
+        waitForBlock(benchNode, loadEnd, blockType=BlockType.lib, timeout=referenceBlocks)
+
+        Print("Snapshot the reference state and boot the bench node from it")
+        snapshot=benchNode.processCurlCmd("producer", "create_snapshot", "{}", silentErrors=False, exitOnError=True)
+        snapshotFile=os.path.join(os.path.dirname(dataDir), os.path.basename(snapshot["snapshot_name"]))
+        shutil.copyfile(snapshot["snapshot_name"], snapshotFile)
+        # a block id starts with its block number
+        snapshotHead=int(snapshot["head_block_id"][:8], 16)
+        bootFromSnapshot(snapshotFile)
+        # the node keeps following the producer, so blocks past the snapshot can be fetched
+        firstBlock=snapshotHead+1
+        waitForBlock(benchNode, firstBlock+100, timeout=120)
+    else:
+        Print("Isolate the bench node and boot it from %s" % (args.snapshot))
+        producerNode.kill(signal.SIGTERM)
+        txnGenNode.kill(signal.SIGTERM)
+        cluster.biosNode.kill(signal.SIGTERM)
+        bootFromSnapshot(os.path.abspath(args.snapshot))
+
+    if args.query_mix is not None:
+        with open(args.query_mix, "r") as f:
+            mix=json.load(f)
+        for q in mix:
+            if not all(k in q for k in ["name", "path", "body", "weight"]):
+                errorExit("Every entry of %s needs a name, path, body and weight: %s" % (args.query_mix, q))
+    else:
+        head=benchNode.getBlockNum(BlockType.head)
+        tokenContract=accountPrefix + "t"
+        holders=[accountPrefix + s for s in ["a", "b", "t"]]
+        mix=[{ "name": "get_info", "path": "/v1/chain/get_info", "body": "{}", "weight": 30 },
+             { "name": "get_account", "path": "/v1/chain/get_account", "body": { "account_name": holders[0] }, "weight": 15 },
+             { "name": "get_block", "path": "/v1/chain/get_block", "body": { "block_num_or_id": str(head) }, "weight": 5 },
+             { "name": "get_block", "path": "/v1/chain/get_block", "body": { "block_num_or_id": str(firstBlock) }, "weight": 5 }]
+        for limit, weight in [(1, 20), (10, 15), (100, 10)]:
+            for holder in holders:
+                mix.append({ "name": "get_table_rows_limit_%d" % (limit), "path": "/v1/chain/get_table_rows", "weight": weight / len(holders),
+                             "body": { "code": tokenContract, "scope": holder, "table": "accounts", "json": True, "limit": limit } })
+
+    info=benchNode.getInfo(exitOnError=True)
+    results={ "version": info["server_version_string"], "head_block_num": info["head_block_num"],
+              "http_threads": args.http_threads, "duration_sec": duration, "mix": mix, "levels": {} }
+
+    for concurrency in concurrencyLevels:
+        Print("Send the query mix over %d connections for %d sec" % (concurrency, duration))
+        procStat="/proc/%d/stat" % (benchNode.pid)
+        mainStat="/proc/%d/task/%d/stat" % (benchNode.pid, benchNode.pid)
+        workers=[(benchNode.host, benchNode.port, mix, time.time()+duration, seed) for seed in range(concurrency)]
+        with multiprocessing.Pool(concurrency) as pool:
+            procCpu=cpuSeconds(procStat)
+            mainCpu=cpuSeconds(mainStat)
+            start=time.perf_counter()
+            outcomes=pool.map(fire, workers)
+            elapsed=time.perf_counter()-start
+            procCpu=cpuSeconds(procStat)-procCpu
+            mainCpu=cpuSeconds(mainStat)-mainCpu
+
+        level={ "elapsed_sec": elapsed, "node_cpu_pct": 100.0 * procCpu / elapsed, "main_thread_occupancy_pct": 100.0 * mainCpu / elapsed,
+                "endpoints": {} }
+        total=0
+        for name in sorted(set(q["name"] for q in mix)):
+            latencies=sorted(l for lat, _ in outcomes for l in lat.get(name, []))
+            errors=sum(err.get(name, 0) for _, err in outcomes)
+            total+=len(latencies)
+            stats={ "requests": len(latencies), "errors": errors, "requests_per_sec": len(latencies) / elapsed }
+            if latencies:
+                stats.update({ "avg_ms": 1000.0 * sum(latencies) / len(latencies), "max_ms": 1000.0 * latencies[-1] })
+                stats.update({ "p%d_ms" % (p): 1000.0 * percentile(latencies, p) for p in [50, 90, 99] })
+            level["endpoints"][name]=stats
+            Print("%4d conns %-28s %8.1f req/s  p50 %8.3f ms  p99 %8.3f ms  %d errors" %
+                  (concurrency, name, stats["requests_per_sec"], stats.get("p50_ms", 0), stats.get("p99_ms", 0), errors))
+        level["requests_per_sec"]=total / elapsed
+        Print("%4d conns total %.1f req/s, node cpu %.1f%%, main thread occupancy %.1f%%" %
+              (concurrency, level["requests_per_sec"], level["node_cpu_pct"], level["main_thread_occupancy_pct"]))
+        results["levels"][str(concurrency)]=level
+
+    with open(args.results_file, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    Print("Results written to %s" % (args.results_file))
+
+    if args.baseline is not None:
+        with open(args.baseline, "r") as f:
+            baseline=json.load(f)
+        regressions=[]
+        for concurrency, level in sorted(results["levels"].items()):
+            baseLevel=baseline.get("levels", {}).get(concurrency)
+            if baseLevel is None:
+                continue
+            for name, stats in sorted(level["endpoints"].items()):
+                baseStats=baseLevel["endpoints"].get(name)
+                if baseStats is None or baseStats["requests_per_sec"] <= 0 or "p99_ms" not in stats or "p99_ms" not in baseStats:
+                    continue
+                throughput=100.0 * (stats["requests_per_sec"] - baseStats["requests_per_sec"]) / baseStats["requests_per_sec"]
+                p99=100.0 * (stats["p99_ms"] - baseStats["p99_ms"]) / baseStats["p99_ms"]
+                Print("%4s conns %-28s throughput %+.1f%%, p99 %+.1f%%" % (concurrency, name, throughput, p99))
+                if -throughput > args.max_regression_pct or p99 > args.max_regression_pct:
+                    regressions.append("%s at %s connections" % (name, concurrency))
+        if regressions:
+            errorExit("Slower than %s (%s) by more than %.1f%%: %s" % (args.baseline, baseline.get("version"), args.max_regression_pct,
+                                                                     ", ".join(regressions)))
+
+    testSuccessful=True
+
+finally:
+    TestHelper.shutdown(cluster, walletMgr, testSuccessful=testSuccessful, killRoxeInstances=killRoxeInstances, killWallet=killWallet, keepLogs=keepLogs, cleanRun=killAll, dumpErrorDetails=dumpErrorDetails)
+
+exit(0)
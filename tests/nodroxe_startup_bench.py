@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+
+from testUtils import Utils
+from Cluster import Cluster
+from WalletMgr import WalletMgr
+from Node import BlockType
+from Node import Node
+from TestHelper import AppArgs
+from TestHelper import TestHelper
+
+import json
+import os
+import shutil
+import signal
+import time
+
+###############################################################
+# nodroxe_startup_bench
+#  Measures how long a node takes to get back on its feet from a reference state. A producing node and a
+#  txn_test_gen_plugin node build up <--blocks> blocks worth of state, which a third node follows. That node is
+#  then isolated and timed through:
+#  1) creating a snapshot
+#  2) cold starts on its existing state with each --database-map-mode (mapped, heap, locked)
+#  3) --replay-blockchain and --hard-replay-blockchain of its block log
+#  4) starting from the snapshot with no state and no block log
+#  Startup times are measured until the node answers get_info at its previous head, so the resolution is
+#  about the 0.1 second polling interval. Results are written as json to <--results-file>; given a
+#  <--baseline> of an earlier run, any time that grew by more than <--max-regression-pct> fails the test.
+###############################################################
+
+Print=Utils.Print
+errorExit=Utils.errorExit
+
+appArgs=AppArgs()
+extraArgs = appArgs.add(flag="--blocks", type=int, help="How many blocks of load make up the reference state", default=600)
+extraArgs = appArgs.add(flag="--runs", type=int, help="How many times each startup is timed, the fastest run is reported", default=1)
+extraArgs = appArgs.add(flag="--results-file", type=str, help="File the json results are written to", default="startup_bench.json")
+extraArgs = appArgs.add(flag="--baseline", type=str, help="Results of an earlier run to compare against", default=None)
+extraArgs = appArgs.add(flag="--max-regression-pct", type=float, help="Allowed growth of any time against the baseline", default=25.0)
+args = TestHelper.parse_args({"--dump-error-details","--keep-logs","-v","--leave-running","--clean-run"}, applicationSpecificArgs=appArgs)
+Utils.Debug=args.v
+cluster=Cluster(walletd=True)
+dumpErrorDetails=args.dump_error_details
+keepLogs=args.keep_logs
+dontKill=args.leave_running
+killAll=args.clean_run
+referenceBlocks=args.blocks if args.blocks > 0 else 1
+runs=args.runs if args.runs > 0 else 1
+
+walletMgr=WalletMgr(True)
+testSuccessful=False
+killRoxeInstances=not dontKill
+killWallet=not dontKill
+
+producerNodeNum=0
+txnGenNodeNum=1
+benchNodeNum=2
+startupTimeout=1800
+pollInterval=0.1
+
+try:
+    TestHelper.printSystemInfo("BEGIN")
+    cluster.setWalletMgr(walletMgr)
+
+    cluster.killall(allInstances=killAll)
+    cluster.cleanup()
+    specificExtraNodroxeArgs={
+        txnGenNodeNum:"--plugin roxe::txn_test_gen_plugin --txn-test-gen-account-prefix txntestacct",
+        benchNodeNum:"--plugin roxe::producer_api_plugin"}
+    Print("Stand up cluster")
+    if cluster.launch(prodCount=1, onlyBios=False, pnodes=1, totalNodes=3, totalProducers=1,
+                      useBiosBootFile=False, specificExtraNodroxeArgs=specificExtraNodroxeArgs, loadSystemContract=False) is False:
+        errorExit("Failed to stand up roxe cluster.")
+
+    producerNode=cluster.getNode(producerNodeNum)
+    txnGenNode=cluster.getNode(txnGenNodeNum)
+    benchNode=cluster.getNode(benchNodeNum)
+
+    def waitForBlock(node, blockNum, blockType=BlockType.head, timeout=None):
+        if not node.waitForBlock(blockNum, timeout=timeout, blockType=blockType, reportInterval=20):
+            info=node.getInfo()
+            errorExit("Failed to get to %s block number %d. Last had head block number %d and lib %d" %
+                      (blockType, blockNum, info["head_block_num"], info["last_irreversible_block_num"]))
+
+    Print("Build the reference state from %d blocks of generated transactions" % (referenceBlocks))
+    txnGenNode.txnGenCreateTestAccounts(cluster.roxeAccount.name, cluster.roxeAccount.activePrivateKey, exitOnError=True)
+    txnGenNode.txnGenStart("bench", 1000, 200, exitOnError=True)
+    loadEnd=producerNode.getBlockNum(BlockType.head)+referenceBlocks
+    waitForBlock(producerNode, loadEnd, timeout=referenceBlocks)
+    txnGenNode.processCurlCmd("txn_test_gen", "stop_generation", "{}")
+    waitForBlock(benchNode, loadEnd, blockType=BlockType.lib, timeout=referenceBlocks)
+
+    Print("Isolate the bench node")
+    producerNode.kill(signal.SIGTERM)
+    txnGenNode.kill(signal.SIGTERM)
+    cluster.biosNode.kill(signal.SIGTERM)
+
+    info=benchNode.getInfo(exitOnError=True)
+    version=info["server_version_string"]
+    dataDir=Utils.getNodeDataDir(benchNodeNum)
+    results={ "version": version, "blocks": referenceBlocks }
+
+    Print("Create a snapshot")
+    start=time.perf_counter()
+    snapshot=benchNode.processCurlCmd("producer", "create_snapshot", "{}", silentErrors=False, exitOnError=True)
+    results["snapshot_write_sec"]=time.perf_counter()-start
+    snapshotFile=snapshot["snapshot_name"]
+    results["snapshot_bytes"]=os.path.getsize(snapshotFile)
+
+    target=benchNode.getBlockNum(BlockType.head)
+    lib=benchNode.getBlockNum(BlockType.lib)
+    benchNode.kill(signal.SIGTERM)
+    results["head_block_num"]=target
+    results["state_bytes"]=os.path.getsize(os.path.join(dataDir, "state", "shared_memory.bin"))
+    blocksBackup=os.path.join(os.path.dirname(dataDir), os.path.basename(dataDir) + "-bench-blocks")
+    shutil.rmtree(blocksBackup, ignore_errors=True)
+    shutil.copytree(os.path.join(dataDir, "blocks"), blocksBackup)
+    snapshotCopy=os.path.join(os.path.dirname(dataDir), os.path.basename(snapshotFile))
+    shutil.copyfile(snapshotFile, snapshotCopy)
+
+    # relaunch accumulates its chain arguments into the node's command, so every start begins from this one
+    baseCmd=benchNode.cmd
+
+    def timedStart(name, chainArg="", addOrSwapFlags=None, headBlockNum=target, prepare=None, required=True):
+        """fastest of <runs> starts of the bench node, in seconds until it serves its head again"""
+        best=None
+        for run in range(0, runs):
+            if prepare is not None:
+                prepare()
+            benchNode.cmd=baseCmd
+            start=time.perf_counter()
+            started=benchNode.relaunch(benchNodeNum, chainArg=chainArg, addOrSwapFlags=addOrSwapFlags, timeout=startupTimeout,
+                                       cachePopen=True, waitSleepTime=pollInterval)
+            if started:
+                reached=Utils.waitForBool(lambda: benchNode.getBlockNum(BlockType.head) >= headBlockNum, timeout=startupTimeout,
+                                          sleepTime=pollInterval)
+                elapsed=time.perf_counter()-start
+                benchNode.kill(signal.SIGTERM)
+                started=reached
+            if not started:
+                if required:
+                    errorExit("%s did not get back to block %d" % (name, headBlockNum))
+                Print("%s failed, it is left out of the results" % (name))
+                return None
+            Print("%s took %.3f sec" % (name, elapsed))
+            best=elapsed if best is None else min(best, elapsed)
+        return best
+
+    def restoreBlocks():
+        shutil.rmtree(os.path.join(dataDir, "blocks"), ignore_errors=True)
+        shutil.copytree(blocksBackup, os.path.join(dataDir, "blocks"))
+
+    def removeStateAndBlocks():
+        shutil.rmtree(os.path.join(dataDir, "state"), ignore_errors=True)
+        shutil.rmtree(os.path.join(dataDir, "blocks"), ignore_errors=True)
+
+    coldStart={}
+    for mode in ["mapped", "heap", "locked"]:
+        # locked mode needs a RLIMIT_MEMLOCK large enough for the whole database, which a test host may not grant
+        coldStart[mode]=timedStart("cold start (%s)" % (mode), addOrSwapFlags={"--database-map-mode": mode}, required=mode != "locked")
+    results["cold_start_sec"]=coldStart
+
+    # a hard replay only recovers the block log, so replays are timed up to the last irreversible block
+    for name, flag in [("replay", "--replay-blockchain"), ("hard_replay", "--hard-replay-blockchain")]:
+        elapsed=timedStart(name, chainArg=flag, headBlockNum=lib, prepare=restoreBlocks)
+        results[name + "_sec"]=elapsed
+        results[name + "_blocks_per_sec"]=lib / elapsed
+
+    results["snapshot_load_sec"]=timedStart("snapshot load", chainArg="--snapshot %s" % (snapshotCopy), prepare=removeStateAndBlocks)
+
+    with open(args.results_file, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    Print("Results written to %s:\n%s" % (args.results_file, json.dumps(results, indent=2, sort_keys=True)))
+
+    if args.baseline is not None:
+        with open(args.baseline, "r") as f:
+            baseline=json.load(f)
+        def times(r):
+            flat={ k: v for k, v in r.items() if k.endswith("_sec") and v is not None }
+            flat.update({ "cold_start_sec." + k: v for k, v in r.get("cold_start_sec", {}).items() if v is not None })
+            return flat
+        regressions=[]
+        baseTimes=times(baseline)
+        for key, value in sorted(times(results).items()):
+            if key not in baseTimes or not isinstance(value, float) or baseTimes[key] <= 0:
+                continue
+            change=100.0 * (value - baseTimes[key]) / baseTimes[key]
+            Print("%-28s %10.3f sec against %10.3f sec (%+.1f%%)" % (key, value, baseTimes[key], change))
+            if change > args.max_regression_pct:
+                regressions.append(key)
+        if regressions:
+            errorExit("Slower than %s (%s) by more than %.1f%%: %s" % (args.baseline, baseline.get("version"), args.max_regression_pct,
+                                                                     ", ".join(regressions)))
+
+    shutil.rmtree(blocksBackup, ignore_errors=True)
+    testSuccessful=True
+
+finally:
+    TestHelper.shutdown(cluster, walletMgr, testSuccessful=testSuccessful, killRoxeInstances=killRoxeInstances, killWallet=killWallet, keepLogs=keepLogs, cleanRun=killAll, dumpErrorDetails=dumpErrorDetails)
+
+exit(0)
@@ -179,6 +179,28 @@ BOOST_AUTO_TEST_CASE(wallet_manager_test)
    BOOST_CHECK(find(pks.cbegin(), pks.cend(), pkey1.get_public_key()) != pks.cend());
    BOOST_CHECK(find(pks.cbegin(), pks.cend(), pkey2.get_public_key()) != pks.cend());
 
+   std::vector<chain::signed_transaction> trxs(2);
+   trxs[1].delay_sec = 1;
+   trxs = wm.sign_transactions(trxs, pubkeys, chain_id);
+   BOOST_REQUIRE_EQUAL(2u, trxs.size());
+   BOOST_CHECK_EQUAL(1u, trxs[1].delay_sec.value);
+   for (const auto& t : trxs) {
+      pks.clear();
+      t.get_signature_keys(chain_id, fc::time_point::maximum(), pks);
+      BOOST_CHECK_EQUAL(2u, pks.size());
+   }
+   BOOST_CHECK(trxs[0].signatures != trxs[1].signatures);
+
+   // enough digests to be signed on several threads
+   std::vector<chain::digest_type> digests;
+   for (uint32_t i = 0; i < 200; ++i)
+      digests.push_back(chain::digest_type::hash(i));
+   const auto sigs = wm.sign_digests(digests, pkey1.get_public_key());
+   BOOST_REQUIRE_EQUAL(digests.size(), sigs.size());
+   for (size_t i = 0; i < digests.size(); ++i)
+      BOOST_CHECK_EQUAL(string(public_key_type(sigs[i], digests[i])), string(pkey1.get_public_key()));
+   BOOST_CHECK_THROW(wm.sign_digests(digests, private_key_type::generate().get_public_key()), chain::wallet_missing_pub_key_exception);
+
    BOOST_CHECK_EQUAL(3u, wm.get_public_keys().size());
    wm.set_timeout(chrono::seconds(0));
    BOOST_CHECK_THROW(wm.get_public_keys(), wallet_locked_exception);
@@ -17,11 +17,13 @@
 
 #include <roxe/chain/contract_types.hpp>
 #include <roxe/chain/abi_serializer.hpp>
+#include <roxe/chain/abi_serializer_cache.hpp>
 #include <roxe/chain/roxe_contract.hpp>
 #include <roxe/testing/tester.hpp>
 
 #include <boost/test/framework.hpp>
 
+#include <contracts.hpp>
 #include <deep_nested.abi.hpp>
 #include <large_nested.abi.hpp>
 
@@ -2720,4 +2722,150 @@ BOOST_AUTO_TEST_CASE(abi_deserialize_detailed_error_messages)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(abi_serializer_cache_follows_setabi)
+{
+   try {
+      const char* abi_v1 = R"=====(
+      {
+         "version": "roxe::abi/1.1",
+         "structs": [ {"name": "act1", "base": "", "fields": [ {"name": "a", "type": "uint8"} ]} ],
+         "actions": [ {"name": "act1", "type": "act1", "ricardian_contract": ""} ]
+      }
+      )=====";
+      const char* abi_v2 = R"=====(
+      {
+         "version": "roxe::abi/1.1",
+         "structs": [ {"name": "act2", "base": "", "fields": [ {"name": "b", "type": "uint16"} ]} ],
+         "actions": [ {"name": "act2", "type": "act2", "ricardian_contract": ""} ]
+      }
+      )=====";
+
+      tester chain;
+      chain.create_accounts( {N(abicache), N(abicache2)} );
+      chain.produce_block();
+
+      abi_serializer_cache cache( 1 );
+      BOOST_CHECK( !cache.get( chain.control->db(), N(abicache), max_serialization_time ) );
+      BOOST_CHECK( !cache.get( chain.control->db(), N(nosuchacct), max_serialization_time ) );
+
+      chain.set_abi( N(abicache), abi_v1 );
+      chain.produce_block();
+      auto v1 = cache.get( chain.control->db(), N(abicache), max_serialization_time );
+      BOOST_REQUIRE( v1 );
+      BOOST_CHECK_EQUAL( v1->serializer.get_action_type( N(act1) ), "act1" );
+      BOOST_CHECK( v1 == cache.get( chain.control->db(), N(abicache), max_serialization_time ) );
+      BOOST_CHECK_EQUAL( cache.size(), 1u );
+
+      // the abi_sequence bump of setabi makes the cached entry stale
+      chain.set_abi( N(abicache), abi_v2 );
+      chain.set_abi( N(abicache2), abi_v1 );
+      chain.produce_block();
+      auto v2 = cache.get( chain.control->db(), N(abicache), max_serialization_time );
+      BOOST_REQUIRE( v2 );
+      BOOST_CHECK( v2 != v1 );
+      BOOST_CHECK_EQUAL( v2->serializer.get_action_type( N(act1) ), "" );
+      BOOST_CHECK_EQUAL( v2->serializer.get_action_type( N(act2) ), "act2" );
+
+      // full cache evicts the least recently used account
+      BOOST_REQUIRE( cache.get( chain.control->db(), N(abicache2), max_serialization_time ) );
+      BOOST_CHECK_EQUAL( cache.size(), 1u );
+      BOOST_CHECK( cache.get( chain.control->db(), N(abicache), max_serialization_time ) != v2 );
+
+      cache.invalidate( N(abicache) );
+      BOOST_CHECK_EQUAL( cache.size(), 0u );
+      BOOST_CHECK( cache.get_serializer( chain.control->db(), N(abicache), max_serialization_time ).valid() );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(decode_plans_match_interpreter)
+{
+   try {
+      struct sample {
+         const char* type;
+         const char* json;
+      };
+      auto check = [&]( const vector<char>& abi_json, const vector<sample>& samples ) {
+         abi_def abi = fc::json::from_string( string( abi_json.data(), abi_json.size() ) ).as<abi_def>();
+         abi_serializer interpreted( abi, max_serialization_time );
+         abi_serializer compiled( abi, max_serialization_time );
+         compiled.compile_decode_plans();
+         BOOST_CHECK_GT( compiled.decode_plan_count(), 0u );
+
+         for( const auto& smp : samples ) {
+            const bytes data = interpreted.variant_to_binary( smp.type, fc::json::from_string( smp.json ), max_serialization_time );
+            BOOST_CHECK_EQUAL( fc::json::to_string( compiled.binary_to_variant( smp.type, data, max_serialization_time ) ),
+                               fc::json::to_string( interpreted.binary_to_variant( smp.type, data, max_serialization_time ) ) );
+
+            // a truncated row is decoded again by the interpreter for its error
+            bytes truncated( data.begin(), data.end() - 1 );
+            BOOST_CHECK_THROW( compiled.binary_to_variant( smp.type, truncated, max_serialization_time ), fc::exception );
+
+            const int iterations = 10000;
+            auto time = [&]( const abi_serializer& abis ) {
+               const auto start = fc::time_point::now();
+               for( int i = 0; i < iterations; ++i )
+                  abis.binary_to_variant( smp.type, data, max_serialization_time );
+               return (fc::time_point::now() - start).count();
+            };
+            const auto interpreted_us = time( interpreted );
+            const auto compiled_us = time( compiled );
+            BOOST_TEST_MESSAGE( smp.type << ": " << iterations << " decodes, interpreted " << interpreted_us
+                                << " us, compiled " << compiled_us << " us" );
+         }
+      };
+
+      check( contracts::roxe_token_abi(), {
+         {"transfer", R"({"from":"alice","to":"bob","quantity":"1.0000 SYS","memo":"decode plan"})"},
+         {"account", R"({"balance":"100.0000 SYS"})"}
+      } );
+      check( contracts::roxe_system_abi(), {
+         {"delegatebw", R"({"from":"alice","receiver":"bob","stake_net_quantity":"1.0000 SYS","stake_cpu_quantity":"2.0000 SYS","transfer":false})"},
+         {"producer_info", R"({"owner":"alice","total_votes":"1.5","producer_key":"ROXE7MVh6bachyhuHm1rTN5n3mwSpQh1VFELNUcGKVdG3GxXYELUDt","is_active":true,"url":"https://example.com","unpaid_blocks":7,"last_claim_time":"2020-01-01T00:00:00.000","location":1})"}
+      } );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(binary_to_json_matches_variant_text)
+{
+   try {
+      const auto abi_json = contracts::roxe_token_abi();
+      abi_def abi = fc::json::from_string( string( abi_json.data(), abi_json.size() ) ).as<abi_def>();
+      abi_serializer abis( abi, max_serialization_time );
+      abis.compile_decode_plans();
+
+      const bytes row = abis.variant_to_binary( "account", fc::json::from_string( R"({"balance":"100.0000 SYS"})" ), max_serialization_time );
+      const bytes action = abis.variant_to_binary( "transfer",
+            fc::json::from_string( R"({"from":"alice","to":"bob","quantity":"1.0000 SYS","memo":"quote \" and\nnewline"})" ), max_serialization_time );
+
+      string json;
+      fc::json_writer writer( json );
+      writer.begin_object();
+      writer.key( "rows" );
+      writer.begin_array();
+      abis.binary_to_json( "account", row, writer, max_serialization_time );
+      writer.begin_object();
+      writer.key( "data" );
+      abis.binary_to_json( "transfer", action, writer, max_serialization_time );
+      writer.key( "payer" );
+      writer.value( fc::variant( name("alice") ) );
+      writer.end_object();
+
+      // a failed row leaves nothing behind
+      const auto before = json;
+      bytes truncated( row.begin(), row.end() - 1 );
+      BOOST_CHECK_THROW( abis.binary_to_json( "account", truncated, writer, max_serialization_time ), fc::exception );
+      BOOST_CHECK_EQUAL( json, before );
+
+      writer.end_array();
+      writer.key( "more" );
+      writer.value( false );
+      writer.end_object();
+
+      fc::variants rows;
+      rows.emplace_back( abis.binary_to_variant( "account", row, max_serialization_time ) );
+      rows.emplace_back( fc::mutable_variant_object( "data", abis.binary_to_variant( "transfer", action, max_serialization_time ) )( "payer", name("alice") ) );
+      BOOST_CHECK_EQUAL( json, fc::json::to_string( fc::mutable_variant_object( "rows", std::move(rows) )( "more", false ) ) );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
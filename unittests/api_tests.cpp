@@ -308,6 +308,35 @@ struct MySink : public bio::sink
 };
 uint32_t last_fnc_err = 0;
 
+BOOST_AUTO_TEST_CASE(validation_trace_details_tests) { try {
+   validating_tester chain;
+   chain.produce_blocks(2);
+
+   auto newaccount_trace = [&]( account_name a ) {
+      fc::optional<action_trace> result;
+      auto c = chain.validating_node->applied_transaction.connect( [&]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> x ) {
+         for( const auto& at : std::get<0>(x)->action_traces )
+            if( at.act.name == N(newaccount) ) result = at;
+      } );
+      auto trace = chain.create_account( a );
+      BOOST_REQUIRE( !trace->action_traces.front().account_ram_deltas.empty() );
+      chain.produce_block();
+      c.disconnect();
+      BOOST_REQUIRE( result );
+      BOOST_REQUIRE( result->receipt );
+      return *result;
+   };
+
+   // nothing on the validating node asked for more than the receipts
+   auto light = newaccount_trace( N(alice) );
+   BOOST_CHECK( light.account_ram_deltas.empty() );
+   BOOST_CHECK_EQUAL( light.elapsed.count(), 0 );
+
+   chain.validating_node->require_detailed_traces();
+   auto detailed = newaccount_trace( N(bob) );
+   BOOST_CHECK( !detailed.account_ram_deltas.empty() );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_FIXTURE_TEST_CASE(action_receipt_tests, TESTER) { try {
    produce_blocks(2);
    create_account( N(test) );
@@ -1916,6 +1945,29 @@ BOOST_FIXTURE_TEST_CASE(print_tests, TESTER) { try {
    BOOST_REQUIRE_EQUAL( validate(), true );
 } FC_LOG_AND_RETHROW() }
 
+/*************************************************************************************
+ * console output limit test case
+ *************************************************************************************/
+BOOST_AUTO_TEST_CASE(console_output_limit_tests) { try {
+   auto cfg = validating_tester::default_config();
+   cfg.max_console_output_bytes = 4;
+   validating_tester chain( cfg );
+   chain.create_account( N(testapi) );
+   chain.produce_blocks( 1 );
+   chain.set_code( N(testapi), contracts::test_api_wasm() );
+   chain.produce_blocks( 1 );
+
+   // prints "abcefg", the transaction keeps the first 4 bytes
+   auto trace = CALL_TEST_FUNCTION( chain, "test_print", "test_prints", {} );
+   BOOST_CHECK_EQUAL( trace->action_traces.front().console, "abce\n<console output truncated>" );
+
+   // every transaction starts with the full allowance
+   trace = CALL_TEST_FUNCTION( chain, "test_print", "test_prints_l", {} );
+   BOOST_CHECK_EQUAL( trace->action_traces.front().console, "abat\n<console output truncated>" );
+
+   BOOST_REQUIRE_EQUAL( chain.validate(), true );
+} FC_LOG_AND_RETHROW() }
+
 /*************************************************************************************
  * types_tests test case
  *************************************************************************************/
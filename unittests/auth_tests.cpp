@@ -267,6 +267,83 @@ BOOST_AUTO_TEST_CASE(link_auths) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE(link_auth_undo) { try {
+   TESTER chain;
+
+   chain.create_account("alice");
+
+   const auto spending_priv_key = chain.get_private_key("alice", "spending");
+   chain.set_authority("alice", "spending", spending_priv_key.get_public_key(), "active");
+   chain.produce_block();
+
+   const auto& authorization = chain.control->get_authorization_manager();
+   BOOST_CHECK_EQUAL( *authorization.lookup_minimum_permission(N(alice), N(roxe), N(reqauth)), config::active_name );
+   BOOST_CHECK_EQUAL( authorization.get_permission({N(alice), N(spending)}).name, name("spending") );
+
+   {
+      auto session = const_cast<chainbase::database&>( chain.control->db() ).start_undo_session(true);
+      chain.link_authority("alice", "roxe", "spending",  "reqauth");
+      BOOST_CHECK_EQUAL( *authorization.lookup_minimum_permission(N(alice), N(roxe), N(reqauth)), name("spending") );
+      chain.set_authority("alice", "spending", chain.get_public_key("alice", "other"), "active");
+      session.undo();
+   }
+
+   // the link and the permission are back to what the database holds after the undo
+   BOOST_CHECK_EQUAL( *authorization.lookup_minimum_permission(N(alice), N(roxe), N(reqauth)), config::active_name );
+   BOOST_CHECK( authorization.get_permission({N(alice), N(spending)}).auth.to_authority() == authority(spending_priv_key.get_public_key()) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(remove_permission_undo) { try {
+   TESTER chain;
+
+   chain.create_account("alice");
+   chain.set_authority("alice", "spending", chain.get_public_key("alice", "spending"), "active");
+   chain.produce_block();
+
+   const auto& authorization = chain.control->get_authorization_manager();
+   const permission_level spending{N(alice), N(spending)};
+   BOOST_CHECK_EQUAL( authorization.get_permission(spending).name, name("spending") );
+
+   // deleteauth removes the permission, then the invalid updateauth fails the transaction without resolving any
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, deleteauth(N(alice), N(spending)) );
+   trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}},
+                             updateauth{N(alice), N(other), config::active_name, authority()} );
+   chain.set_transaction_headers(trx);
+   trx.sign( chain.get_private_key("alice", "active"), chain.control->get_chain_id() );
+   BOOST_CHECK_THROW( chain.push_transaction(trx), action_validate_exception );
+
+   // the permission resolved is the one the undo restored, not the removed object
+   BOOST_CHECK_EQUAL( &authorization.get_permission(spending), authorization.find_permission(spending) );
+   BOOST_CHECK( authorization.get_permission(spending).auth.to_authority() == authority(chain.get_public_key("alice", "spending")) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(account_creation_undo) { try {
+   TESTER chain;
+   chain.produce_block();
+
+   {
+      auto session = const_cast<chainbase::database&>( chain.control->db() ).start_undo_session(true);
+      chain.create_account("bob");
+      // bob authorizes an action, which caches his account_metadata_object for dispatch
+      chain.set_authority("bob", "spending", chain.get_public_key("bob", "spending"), "active");
+      BOOST_CHECK_EQUAL( chain.control->get_receiver_dispatch( N(bob) ).account->auth_sequence, 1u );
+      session.undo();
+   }
+   BOOST_CHECK( (chain.control->db().find<account_metadata_object,by_name>( N(bob) )) == nullptr );
+   BOOST_CHECK_THROW( chain.control->get_receiver_dispatch( N(bob) ), std::out_of_range );
+
+   chain.create_account("bob");
+   chain.set_authority("bob", "spending", chain.get_public_key("bob", "spending"), "active");
+   const auto& bob = chain.control->db().get<account_metadata_object,by_name>( N(bob) );
+   BOOST_CHECK( chain.control->get_receiver_dispatch( N(bob) ).account == &bob );
+   BOOST_CHECK_EQUAL( bob.auth_sequence, 1u );
+   chain.produce_block();
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(link_then_update_auth) { try {
    TESTER chain;
 
@@ -414,6 +491,8 @@ try {
    };
 
    create_acc(acc2);
+   // usage rows are written when the block is finalized
+   chain.produce_block();
 
    const auto &usage = db.get<resource_usage_object,by_owner>(acc1);
 
@@ -423,7 +502,6 @@ try {
    BOOST_TEST(usage.net_usage.average() > 0U);
    BOOST_REQUIRE_EQUAL(usage.cpu_usage.average(), usage2.cpu_usage.average());
    BOOST_REQUIRE_EQUAL(usage.net_usage.average(), usage2.net_usage.average());
-   chain.produce_block();
 
 } FC_LOG_AND_RETHROW() }
 
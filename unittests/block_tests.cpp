@@ -191,4 +191,28 @@ BOOST_AUTO_TEST_CASE(broadcasted_block_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(unsigned_block_completed_later)
+{
+   tester main;
+   main.produce_block();
+   main.create_account(N(newacc));
+
+   BOOST_REQUIRE( main.control->is_building_block() );
+   const auto producer = main.control->pending_block_producer();
+   const auto head_num = main.control->head_block_num();
+   const auto digest = main.control->finalize_unsigned_block();
+
+   BOOST_CHECK_THROW( main.control->complete_block( main.get_private_key( N(newacc), "active" ).sign( digest ) ), wrong_signing_key );
+   auto bsp = main.control->complete_block( main.get_private_key( producer, "active" ).sign( digest ) );
+   main.control->commit_block();
+
+   BOOST_REQUIRE_EQUAL( main.control->head_block_num(), head_num + 1 );
+   BOOST_CHECK_EQUAL( main.control->head_block_id(), bsp->id );
+   BOOST_CHECK_NO_THROW( bsp->verify_signee( bsp->signee() ) );
+   BOOST_CHECK( bsp->block->producer_signature == bsp->header.producer_signature );
+
+   main.produce_block();
+   BOOST_REQUIRE_EQUAL( main.control->head_block_num(), head_num + 2 );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -646,4 +646,132 @@ static const char large_maligned_host_ptr[] = R"=====(
    ))
  )
 )
-)=====";
\ No newline at end of file
+)=====";
+static const char batched_index_reads_wast[] = R"=====(
+(module
+ (import "env" "roxe_assert" (func $roxe_assert (param i32 i32)))
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_idx64_store" (func $db_idx64_store (param i64 i64 i64 i64 i32) (result i32)))
+ (import "env" "db_idx64_range" (func $db_idx64_range (param i64 i64 i64 i64 i32 i64 i32 i32 i32) (result i32)))
+ (memory $0 1)
+ (data (i32.const 0) "abcd")
+ (data (i32.const 256) "wrong row count\00")
+ (data (i32.const 288) "wrong row contents\00")
+ (export "memory" (memory $0))
+ (export "apply" (func $apply))
+ ;; stores row `id` holding "abcd" in table 1, indexed by `secondary` in table 2
+ (func $put (param $self i64) (param $id i64) (param $secondary i64)
+  (drop (call $db_store_i64 (get_local $self) (i64.const 1) (get_local $self) (get_local $id) (i32.const 0) (i32.const 4)))
+  (i64.store (i32.const 16) (get_local $secondary))
+  (drop (call $db_idx64_store (get_local $self) (i64.const 2) (get_local $self) (get_local $id) (i32.const 16)))
+ )
+ ;; reads from (secondary, 0) into the buffer at 64
+ (func $range (param $self i64) (param $secondary i64) (param $max_rows i32) (param $size i32) (result i32)
+  (i64.store (i32.const 16) (get_local $secondary))
+  (call $db_idx64_range (get_local $self) (get_local $self) (i64.const 2) (i64.const 1)
+                        (i32.const 16) (i64.const 0) (get_local $max_rows) (i32.const 64) (get_local $size))
+ )
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64)
+  (call $put (get_local $0) (i64.const 1) (i64.const 30))
+  (call $put (get_local $0) (i64.const 2) (i64.const 20))
+  (call $put (get_local $0) (i64.const 3) (i64.const 10))
+
+  ;; rows are 8 + 8 + 4 + 4 bytes and come back in secondary key order
+  (call $roxe_assert (i32.eq (call $range (get_local $0) (i64.const 0) (i32.const 2) (i32.const 128)) (i32.const 2)) (i32.const 256))
+  (call $roxe_assert (i64.eq (i64.load offset=64 (i32.const 0)) (i64.const 10)) (i32.const 288))
+  (call $roxe_assert (i64.eq (i64.load offset=72 (i32.const 0)) (i64.const 3)) (i32.const 288))
+  (call $roxe_assert (i32.eq (i32.load offset=80 (i32.const 0)) (i32.const 4)) (i32.const 288))
+  (call $roxe_assert (i32.eq (i32.load offset=84 (i32.const 0)) (i32.load (i32.const 0))) (i32.const 288))
+  (call $roxe_assert (i64.eq (i64.load offset=88 (i32.const 0)) (i64.const 20)) (i32.const 288))
+  (call $roxe_assert (i64.eq (i64.load offset=96 (i32.const 0)) (i64.const 2)) (i32.const 288))
+
+  ;; stops at the end of the index, and at the last row that fits
+  (call $roxe_assert (i32.eq (call $range (get_local $0) (i64.const 15) (i32.const 10) (i32.const 128)) (i32.const 2)) (i32.const 256))
+  (call $roxe_assert (i64.eq (i64.load offset=72 (i32.const 0)) (i64.const 2)) (i32.const 288))
+  (call $roxe_assert (i32.eq (call $range (get_local $0) (i64.const 0) (i32.const 10) (i32.const 60)) (i32.const 2)) (i32.const 256))
+
+  ;; reports the size of the first row when it does not fit
+  (call $roxe_assert (i32.eq (call $range (get_local $0) (i64.const 0) (i32.const 10) (i32.const 10)) (i32.const -24)) (i32.const 256))
+  (call $roxe_assert (i32.eq (call $range (get_local $0) (i64.const 31) (i32.const 10) (i32.const 128)) (i32.const 0)) (i32.const 256))
+ )
+)
+)=====";
+
+// does nothing, so an action on it costs only the fixed dispatch overhead of the vm;
+// `${NONCE}` is replaced to give every copy its own code hash and so its own compilation
+static const char bench_noop_wast[] = R"=====(
+(module
+ (memory $0 1)
+ (data (i32.const 0) "${NONCE}")
+ (export "memory" (memory $0))
+ (export "apply" (func $apply))
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64))
+)
+)=====";
+
+// action data is {kernel:u32, iterations:u32, nonce:u64}; each kernel runs its body `iterations` times:
+// 0 empty loop, 1 db_find_i64, 2 sha256 of 64 bytes, 3 prints_l of 8 bytes, 4 integer mixing,
+// 5 64 KiB memory sum, 6 stores the row read by kernel 1, 7 grows memory by 256 pages touching each one
+static const char bench_kernels_wast[] = R"=====(
+(module
+ (import "env" "read_action_data" (func $read_action_data (param i32 i32) (result i32)))
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_find_i64" (func $db_find_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "sha256" (func $sha256 (param i32 i32 i32)))
+ (import "env" "prints_l" (func $prints_l (param i32 i32)))
+ (memory $0 1)
+ (data (i32.const 64) "benchmark")
+ (export "memory" (memory $0))
+ (export "apply" (func $apply))
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64)
+  (local $kernel i32) (local $n i32) (local $i i32) (local $p i32) (local $x i64)
+  (drop (call $read_action_data (i32.const 0) (i32.const 16)))
+  (set_local $kernel (i32.load (i32.const 0)))
+  (set_local $n (i32.load offset=4 (i32.const 0)))
+  (set_local $x (i64.load offset=8 (i32.const 0)))
+  (if (i32.eq (get_local $kernel) (i32.const 6)) (then
+   (drop (call $db_store_i64 (get_local $0) (i64.const 1) (get_local $0) (i64.const 1) (i32.const 64) (i32.const 9)))
+   (return)
+  ))
+  (if (i32.eq (get_local $kernel) (i32.const 7)) (then
+   (set_local $p (i32.mul (grow_memory (i32.const 256)) (i32.const 65536)))
+   (block $done (loop $top
+    (br_if $done (i32.ge_u (get_local $i) (i32.const 256)))
+    (i32.store (i32.add (get_local $p) (i32.mul (get_local $i) (i32.const 65536))) (get_local $i))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br $top)
+   ))
+   (return)
+  ))
+  (block $done (loop $top
+   (br_if $done (i32.ge_u (get_local $i) (get_local $n)))
+   (if (i32.eq (get_local $kernel) (i32.const 1)) (then
+    (drop (call $db_find_i64 (get_local $0) (get_local $0) (i64.const 1) (i64.const 1)))
+   ))
+   (if (i32.eq (get_local $kernel) (i32.const 2)) (then
+    (call $sha256 (i32.const 64) (i32.const 64) (i32.const 128))
+   ))
+   (if (i32.eq (get_local $kernel) (i32.const 3)) (then
+    (call $prints_l (i32.const 64) (i32.const 8))
+   ))
+   (if (i32.eq (get_local $kernel) (i32.const 4)) (then
+    (set_local $x (i64.xor (get_local $x) (i64.shl (get_local $x) (i64.const 13))))
+    (set_local $x (i64.xor (get_local $x) (i64.shr_u (get_local $x) (i64.const 7))))
+    (set_local $x (i64.add (i64.mul (get_local $x) (i64.const 2862933555777941757)) (i64.const 3037000493)))
+   ))
+   (if (i32.eq (get_local $kernel) (i32.const 5)) (then
+    (set_local $p (i32.const 0))
+    (block $sum_done (loop $sum_top
+     (br_if $sum_done (i32.ge_u (get_local $p) (i32.const 65536)))
+     (set_local $x (i64.add (get_local $x) (i64.load (get_local $p))))
+     (set_local $p (i32.add (get_local $p) (i32.const 8)))
+     (br $sum_top)
+    ))
+   ))
+   (set_local $i (i32.add (get_local $i) (i32.const 1)))
+   (br $top)
+  ))
+  (i64.store (i32.const 256) (get_local $x))
+ )
+)
+)=====";
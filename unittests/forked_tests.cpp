@@ -502,6 +502,8 @@ BOOST_AUTO_TEST_CASE( irreversible_mode ) try {
    BOOST_CHECK_EQUAL( irreversible.control->fork_db_pending_head_block_num(), hbn3 );
    BOOST_CHECK_EQUAL( irreversible.control->head_block_num(), lib3 );
    BOOST_CHECK_EQUAL( does_account_exist( irreversible, N(alice) ), true );
+   // blocks are applied without undo sessions, the revision still follows the head
+   BOOST_CHECK_EQUAL( irreversible.control->db().revision(), int64_t(lib3) );
 
    {
       auto bs = irreversible.control->fetch_block_state_by_id( fork_first_block_id );
@@ -2,20 +2,42 @@
  *  @file
  *  @copyright defined in roxe/LICENSE
  */
+#include <roxe/chain/apply_context.hpp>
 #include <roxe/chain/asset.hpp>
+#include <roxe/chain/async_subscriber.hpp>
 #include <roxe/chain/authority.hpp>
 #include <roxe/chain/authority_checker.hpp>
+#include <roxe/chain/billing_clock.hpp>
+#include <roxe/chain/block_log.hpp>
 #include <roxe/chain/chain_config.hpp>
+#include <roxe/chain/compressed_block_log.hpp>
+#include <roxe/chain/genesis_intrinsics.hpp>
+#include <roxe/chain/incremental_merkle.hpp>
+#include <roxe/chain/key_account_index.hpp>
+#include <roxe/chain/protocol_state_object.hpp>
+#include <roxe/chain/startup_profile.hpp>
+#include <roxe/chain/reversible_block_log.hpp>
 #include <roxe/chain/types.hpp>
 #include <roxe/chain/thread_utils.hpp>
+#include <roxe/chain/table_access_set.hpp>
+#include <roxe/chain/prepared_wasm_cache.hpp>
+#include <roxe/chain/wasm_profiler.hpp>
+#include <roxe/chain/whitelisted_intrinsics.hpp>
 #include <roxe/testing/tester.hpp>
 
+#include <contracts.hpp>
+
+#include <fc/bitutil.hpp>
 #include <fc/io/json.hpp>
 #include <fc/log/logger_config.hpp>
+#include <fc/metrics.hpp>
+#include <fc/tracing.hpp>
 #include <appbase/execution_priority_queue.hpp>
 
 #include <boost/test/unit_test.hpp>
 
+#include <thread>
+
 #ifdef NON_VALIDATING_TEST
 #define TESTER tester
 #else
@@ -277,6 +299,31 @@ BOOST_AUTO_TEST_CASE(asset_from_string_overflow)
    });
 }
 
+BOOST_AUTO_TEST_CASE(name_and_asset_string_conversions)
+{
+   BOOST_CHECK_EQUAL( name(N(roxe.token)).to_string(), "roxe.token" );
+   BOOST_CHECK_EQUAL( name(N(abcdehijklmnj)).to_string(), "abcdehijklmnj" );
+   BOOST_CHECK_EQUAL( name(N(.a.b)).to_string(), ".a.b" );
+   BOOST_CHECK_EQUAL( name().to_string(), "" );
+   BOOST_CHECK_EQUAL( name(~0ull).to_string(), "zzzzzzzzzzzzj" );
+   BOOST_CHECK_EQUAL( name("roxe.token").value, N(roxe.token) );
+   BOOST_CHECK_THROW( name("roxe."), name_type_exception );
+   BOOST_CHECK_THROW( name("Roxe"), name_type_exception );
+   BOOST_CHECK_THROW( name("abcdehijklmnz"), name_type_exception );
+   BOOST_CHECK_THROW( name("abcdehijklmnop"), name_type_exception );
+
+   BOOST_CHECK_EQUAL( symbol(SY(4,CUR)).to_string(), "4,CUR" );
+   BOOST_CHECK_EQUAL( symbol::from_string(" 18,ABCDEFG ").to_string(), "18,ABCDEFG" );
+   BOOST_CHECK_EQUAL( symbol(SY(4,CUR)).precision(), 10000u );
+
+   BOOST_CHECK_EQUAL( asset::from_string("0.0001 CUR").to_string(), "0.0001 CUR" );
+   BOOST_CHECK_EQUAL( asset::from_string(" -12.3400  CUR ").to_string(), "-12.3400 CUR" );
+   BOOST_CHECK_EQUAL( asset::from_string("4611686018427387903 CUR").to_string(), "4611686018427387903 CUR" );
+   BOOST_CHECK_EQUAL( asset::from_string("-4.611686018427387903 CUR").to_string(), "-4.611686018427387903 CUR" );
+   BOOST_CHECK_EQUAL( asset(5, symbol(SY(0,CUR))).to_string(), "5 CUR" );
+   BOOST_CHECK_THROW( asset::from_string("1.0000 cur"), symbol_type_exception );
+}
+
 struct permission_visitor {
    std::vector<permission_level> permissions;
    std::vector<size_t> size_stack;
@@ -365,6 +412,13 @@ BOOST_AUTO_TEST_CASE(authority_checker)
    BOOST_TEST(make_auth_checker(GetNullAuthority, 2, {a}).satisfied(A));
    BOOST_TEST(make_auth_checker(GetNullAuthority, 2, {b}).satisfied(A));
    BOOST_TEST(!make_auth_checker(GetNullAuthority, 2, {c}).satisfied(A));
+   {
+      // keys are counted in declared order only until the threshold is reached
+      auto checker = make_auth_checker(GetNullAuthority, 2, {a, b});
+      BOOST_TEST(checker.satisfied(A));
+      BOOST_TEST(checker.used_keys().size() == 1u);
+      BOOST_TEST(checker.used_keys().count(a) == 1u);
+   }
 
    A = authority(1, {key_weight{a, 2}, key_weight{b, 1}});
    BOOST_TEST(make_auth_checker(GetNullAuthority, 2, {a}).satisfied(A));
@@ -746,6 +800,21 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    BOOST_CHECK_EQUAL(1u, keys.size());
    BOOST_CHECK_EQUAL(public_key, *keys.begin());
 
+   // the cached id and signing digest are those of the unpacked transaction however it was encoded
+   const auto digest = trx.sig_digest( test.control->get_chain_id(), trx.context_free_data );
+   bytes padded = raw;
+   padded.push_back( 0 );
+   packed_transaction pkt6( std::move( padded ), vector<signature_type>( trx.signatures ), bytes(), packed_transaction::none );
+   for( const packed_transaction* p : { &pkt, &pkt2, &pkt4, &pkt5, &pkt6 } ) {
+      BOOST_CHECK_EQUAL( trx.id(), p->id() );
+      BOOST_CHECK_EQUAL( digest, p->sig_digest( test.control->get_chain_id() ) );
+      BOOST_CHECK_EQUAL( digest, p->sig_digest( test.control->get_chain_id() ) );
+   }
+   keys.clear();
+   pkt6.get_signature_keys(test.control->get_chain_id(), fc::time_point::maximum(), keys);
+   BOOST_CHECK_EQUAL(1u, keys.size());
+   BOOST_CHECK_EQUAL(public_key, *keys.begin());
+
 } FC_LOG_AND_RETHROW() }
 
 
@@ -866,8 +935,45 @@ BOOST_AUTO_TEST_CASE(transaction_metadata_test) { try {
       BOOST_CHECK_EQUAL(1u, keys5.second.size());
       BOOST_CHECK_EQUAL(public_key, *keys5.second.begin());
 
+      // multiple signatures are recovered concurrently
+      signed_transaction multisig_trx = trx;
+      flat_set<public_key_type> multisig_keys = { public_key };
+      for( const char* role : { "owner", "other", "another" } ) {
+         auto k = test.get_private_key( config::system_account_name, role );
+         multisig_trx.sign( k, test.control->get_chain_id() );
+         multisig_keys.insert( k.get_public_key() );
+      }
+      transaction_metadata_ptr mtrx6 = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( multisig_trx, packed_transaction::none) );
+      transaction_metadata::start_recover_keys( mtrx6, thread_pool.get_executor(), test.control->get_chain_id(), fc::microseconds::maximum() );
+      auto keys6 = mtrx6->recover_keys( test.control->get_chain_id() );
+      BOOST_CHECK( keys6.second == multisig_keys );
+
+      // duplicate keys are still rejected
+      signed_transaction dup_trx = trx;
+      dup_trx.sign( test.get_private_key( config::system_account_name, "owner" ), test.control->get_chain_id() );
+      dup_trx.signatures.push_back( dup_trx.signatures.front() );
+      transaction_metadata_ptr mtrx7 = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( dup_trx, packed_transaction::none) );
+      transaction_metadata::start_recover_keys( mtrx7, thread_pool.get_executor(), test.control->get_chain_id(), fc::microseconds::maximum() );
+      BOOST_CHECK_THROW( mtrx7->recover_keys( test.control->get_chain_id() ), tx_duplicate_sig );
+
       thread_pool.stop();
 
+      // a multisig recovery completes on a single thread and reports it through on_ready, nothing on the pool waits
+      named_thread_pool single_thread( "misc1", 1 );
+      transaction_metadata_ptr mtrx8 = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( multisig_trx, packed_transaction::none) );
+      std::promise<void> ready;
+      transaction_metadata::start_recover_keys( mtrx8, single_thread.get_executor(), test.control->get_chain_id(), fc::microseconds::maximum(),
+                                                [&ready]() { ready.set_value(); } );
+      BOOST_REQUIRE( ready.get_future().wait_for( std::chrono::seconds( 10 ) ) == std::future_status::ready );
+      BOOST_CHECK( mtrx8->recover_keys( test.control->get_chain_id() ).second == multisig_keys );
+
+      // on_ready runs right away once the recovery completed
+      bool called = false;
+      transaction_metadata::start_recover_keys( mtrx8, single_thread.get_executor(), test.control->get_chain_id(), fc::microseconds::maximum(),
+                                                [&called]() { called = true; } );
+      BOOST_CHECK( called );
+      single_thread.stop();
+
 } FC_LOG_AND_RETHROW() }
 
 BOOST_AUTO_TEST_CASE(reflector_init_test) {
@@ -1120,6 +1226,723 @@ BOOST_AUTO_TEST_CASE(stable_priority_queue_test) {
   } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(priority_queue_stats_test) { try {
+   appbase::execution_priority_queue pri_queue;
+   pri_queue.add( appbase::priority::low, [](){} ); // queued before stats are enabled, not counted
+   pri_queue.enable_stats( true );
+   auto slow = [](){ std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) ); };
+   pri_queue.add( appbase::priority::high, slow );
+   pri_queue.add( appbase::priority::high, slow );
+   pri_queue.add( appbase::priority::low, [](){} );
+
+   auto stats = pri_queue.get_stats();
+   BOOST_CHECK_EQUAL( stats.levels[appbase::priority::high].queued, 2u );
+   BOOST_CHECK_EQUAL( stats.levels[appbase::priority::low].queued, 1u );
+
+   pri_queue.execute_all();
+   stats = pri_queue.get_stats();
+   const auto& high = stats.levels[appbase::priority::high];
+   BOOST_CHECK_EQUAL( high.queued, 0u );
+   BOOST_CHECK_EQUAL( high.run_us.count, 2u );
+   BOOST_CHECK_GE( high.run_us.sum_us, 4000u );
+   BOOST_CHECK_EQUAL( stats.levels[appbase::priority::low].run_us.count, 1u );
+   BOOST_REQUIRE_EQUAL( stats.sites.size(), 2u );
+   BOOST_CHECK_EQUAL( stats.sites[0].executed, 2u ); // the slow lambda, ordered first by run time
+   BOOST_CHECK_GE( stats.sites[0].max_run_us, 2000u );
+   BOOST_CHECK_EQUAL( pri_queue.get_stats( 1 ).sites.size(), 1u );
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE(prepared_wasm_cache_test) { try {
+   fc::temp_directory tempdir;
+   const auto code_hash = fc::sha256::hash( "code" );
+
+   prepared_wasm_cache::entry e;
+   e.code_hash = code_hash;
+   e.code = { 0x00, 0x61, 0x73, 0x6d };
+   e.initial_memory = { 1, 2, 3 };
+
+   {
+      prepared_wasm_cache cache( tempdir.path() / "prepared_wasm" );
+      BOOST_REQUIRE( cache.enabled() );
+      prepared_wasm_cache::entry r;
+      BOOST_CHECK( !cache.get( code_hash, 0, 0, r ) );
+      cache.set( e );
+   }
+
+   // a new instance lazily finds the persisted entry
+   prepared_wasm_cache cache( tempdir.path() / "prepared_wasm" );
+   prepared_wasm_cache::entry r;
+   BOOST_REQUIRE( cache.get( code_hash, 0, 0, r ) );
+   BOOST_CHECK( r.code == e.code );
+   BOOST_CHECK( r.initial_memory == e.initial_memory );
+   BOOST_CHECK( !cache.get( code_hash, 0, 1, r ) );
+
+   cache.erase( code_hash, 0, 0 );
+   BOOST_CHECK( !cache.get( code_hash, 0, 0, r ) );
+
+   // a disabled cache never stores anything
+   prepared_wasm_cache disabled{ fc::path() };
+   BOOST_CHECK( !disabled.enabled() );
+   disabled.set( e );
+   BOOST_CHECK( !disabled.get( code_hash, 0, 0, r ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(compressed_block_log_test) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+
+   vector<signed_block_ptr> blocks;
+   block_id_type previous;
+   for( uint32_t i = 0; i < 10; ++i ) {
+      auto b = std::make_shared<signed_block>();
+      b->previous = previous;
+      b->timestamp = block_timestamp_type( i );
+      previous = b->id();
+      blocks.push_back( b );
+   }
+
+   {
+      compressed_block_log log( dir, 4 );
+      log.reset( genesis_state(), 1 );
+      BOOST_CHECK_EQUAL( log.head_block_num(), 0u );
+      for( const auto& b : blocks ) log.append( b );
+      BOOST_CHECK_EQUAL( log.chunk_count(), 2u ); // blocks 9 and 10 are still buffered
+      BOOST_CHECK( log.read_block_by_num( 10 )->id() == blocks[9]->id() );
+      BOOST_CHECK_THROW( log.append( blocks[0] ), block_log_append_fail );
+   }
+
+   // the partial chunk was flushed on close and the index is rebuilt when missing
+   fc::remove( dir / "blocks.zindex" );
+   compressed_block_log log( dir );
+   BOOST_CHECK_EQUAL( log.chunk_count(), 3u );
+   BOOST_CHECK_EQUAL( log.first_block_num(), 1u );
+   BOOST_CHECK_EQUAL( log.head_block_num(), 10u );
+   for( uint32_t n = 10; n > 0; --n )
+      BOOST_CHECK( log.read_block_by_num( n )->id() == blocks[n - 1]->id() );
+   BOOST_CHECK( !log.read_block_by_num( 11 ) );
+   BOOST_CHECK( !log.read_block_by_num( 0 ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(block_log_stride_test) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+   const auto archive = tempdir.path() / "archive";
+
+   vector<signed_block_ptr> blocks;
+   block_id_type previous;
+   for( uint32_t i = 0; i < 10; ++i ) {
+      auto b = std::make_shared<signed_block>();
+      b->previous = previous;
+      b->timestamp = block_timestamp_type( i );
+      previous = b->id();
+      blocks.push_back( b );
+   }
+
+   {
+      block_log log( dir, 4, 1, archive );
+      log.reset( genesis_state(), blocks[0] );
+      for( size_t i = 1; i < blocks.size(); ++i ) log.append( blocks[i] );
+
+      // blocks 1-4 were archived, 5-8 are retained and 9-10 are in blocks.log
+      BOOST_CHECK_EQUAL( log.first_block_num(), 9u );
+      BOOST_CHECK( fc::exists( archive / "blocks-1-4.log" ) );
+      BOOST_CHECK( fc::exists( dir / "blocks-5-8.log" ) );
+      BOOST_CHECK( !log.read_block_by_num( 3 ) );
+      BOOST_CHECK( log.read_block_by_num( 6 )->id() == blocks[5]->id() );
+      BOOST_CHECK( log.read_block_by_num( 10 )->id() == blocks[9]->id() );
+   }
+
+   // retained files are found again on open
+   block_log log( dir );
+   BOOST_CHECK( log.read_block_by_num( 8 )->id() == blocks[7]->id() );
+   BOOST_CHECK( log.read_head()->id() == blocks[9]->id() );
+
+   // packed blocks are returned as written, from retained files and from blocks.log including its head
+   for( uint32_t n : { 5u, 8u, 9u, 10u } ) {
+      BOOST_CHECK( log.read_serialized_block_by_num( n ) == fc::raw::pack( *blocks[n - 1] ) );
+   }
+   BOOST_CHECK( log.read_serialized_block_by_num( 11 ).empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(block_log_async_writes_test) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+
+   vector<signed_block_ptr> blocks;
+   block_id_type previous;
+   for( uint32_t i = 0; i < 10; ++i ) {
+      auto b = std::make_shared<signed_block>();
+      b->previous = previous;
+      b->timestamp = block_timestamp_type( i );
+      previous = b->id();
+      blocks.push_back( b );
+   }
+
+   {
+      block_log log( dir, 4, 0, fc::path(), true );
+      log.reset( genesis_state(), blocks[0] );
+      for( size_t i = 1; i < blocks.size(); ++i ) {
+         log.append( blocks[i] );
+         // queued blocks are read once written
+         BOOST_CHECK( log.read_block_by_num( i + 1 )->id() == blocks[i]->id() );
+      }
+      BOOST_CHECK_EQUAL( log.first_block_num(), 9u );
+      BOOST_CHECK( log.read_block_by_num( 2 )->id() == blocks[1]->id() );
+      BOOST_CHECK_THROW( log.append( blocks[3] ), block_log_append_fail );
+   }
+
+   // the queue was written on close, in order
+   block_log log( dir );
+   BOOST_CHECK( log.read_head()->id() == blocks[9]->id() );
+   for( uint32_t n = 1; n <= 10; ++n )
+      BOOST_CHECK( log.read_serialized_block_by_num( n ) == fc::raw::pack( *blocks[n - 1] ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(state_delta_standby_test) { try {
+   tester main( setup_policy::none );
+   vector<state_delta_entry> entries;
+   main.control->accepted_block.connect( [&]( const block_state_ptr& bsp ) {
+      if( auto delta = main.control->get_state_delta( bsp ) )
+         entries.push_back( state_delta_entry{ bsp->block, std::move( *delta ) } );
+   } );
+   main.execute_setup_policy( setup_policy::full );
+   main.create_account( N(alice) );
+   main.produce_blocks( 2 );
+   BOOST_REQUIRE( !entries.empty() );
+
+   auto cfg = validating_tester::default_config();
+   cfg.state_delta_standby = true;
+   tester standby( cfg );
+   BOOST_REQUIRE( standby.control->is_standby() );
+
+   // the round trip through the log format
+   for( const auto& e : entries ) {
+      const auto entry = fc::raw::unpack<state_delta_entry>( fc::raw::pack( e ) );
+      BOOST_REQUIRE( standby.control->push_state_delta( entry.block, entry.delta ) );
+   }
+   BOOST_CHECK( !standby.control->push_state_delta( entries.back().block, entries.back().delta ) );
+   BOOST_REQUIRE( standby.control->head_block_id() == main.control->head_block_id() );
+   main.control->abort_block();
+   BOOST_CHECK( standby.control->calculate_integrity_hash() == main.control->calculate_integrity_hash() );
+   BOOST_REQUIRE( standby.control->get_account( N(alice) ).name == N(alice) );
+
+   // blocks are refused until the standby is promoted, then validated in full
+   auto b = main.produce_block();
+   BOOST_CHECK_THROW( standby.push_block( b ), block_validate_exception );
+   standby.control->promote_standby();
+   standby.push_block( b );
+   BOOST_CHECK( standby.control->head_block_id() == b->id() );
+   BOOST_CHECK_THROW( standby.control->push_state_delta( entries.back().block, entries.back().delta ), block_validate_exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(block_state_releases_trx_metas) { try {
+   validating_tester chain;
+   chain.create_account( N(alice) );
+   chain.produce_block();
+
+   // both the producing and the validating node drop the metadata once the block is applied
+   BOOST_CHECK( chain.control->head_block_state()->trxs.empty() );
+   BOOST_CHECK( chain.validating_node->head_block_state()->trxs.empty() );
+   BOOST_CHECK_GT( chain.control->get_released_trx_metas().trxs, 0u );
+   BOOST_CHECK_GT( chain.control->get_released_trx_metas().bytes, 0u );
+   BOOST_CHECK_GT( chain.validating_node->get_released_trx_metas().trxs, 0u );
+
+   // the recovered keys are kept for applying the block again after a fork switch
+   const auto& bs = *chain.validating_node->head_block_state();
+   BOOST_REQUIRE_EQUAL( bs.recovered_keys.size(), bs.block->transactions.size() );
+   for( const auto& keys : bs.recovered_keys )
+      BOOST_CHECK( keys.valid() && !std::get<2>( keys.get() ).empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(reversible_block_log_test) { try {
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "reversible";
+
+   auto make_block = []( uint32_t num, const block_id_type& previous, uint32_t slot ) {
+      auto b = std::make_shared<signed_block>();
+      b->previous = previous;
+      b->timestamp = block_timestamp_type( slot );
+      BOOST_REQUIRE_EQUAL( b->block_num(), num );
+      return b;
+   };
+
+   block_id_type previous;
+   previous._hash[0] = fc::endian_reverse_u32( 9 ); // the first block is block 10
+   vector<signed_block_ptr> blocks;
+   for( uint32_t i = 0; i < 5; ++i ) {
+      blocks.push_back( make_block( 10 + i, previous, i ) );
+      previous = blocks.back()->id();
+   }
+
+   {
+      reversible_block_log log( dir );
+      BOOST_CHECK( log.empty() );
+      for( const auto& b : blocks ) log.append( b );
+      BOOST_CHECK_EQUAL( log.first_block_num(), 10u );
+      BOOST_CHECK_EQUAL( log.last_block_num(), 14u );
+
+      // a fork switch replaces blocks 13 and 14
+      auto fork = make_block( 13, blocks[2]->id(), 100 );
+      log.append( fork );
+      BOOST_CHECK_EQUAL( log.last_block_num(), 13u );
+      BOOST_CHECK( *log.block_id_for_num( 13 ) == fork->id() );
+      BOOST_CHECK( !log.block_id_for_num( 14 ) );
+
+      log.remove_up_to( 11 );
+      BOOST_CHECK_EQUAL( log.first_block_num(), 12u );
+      BOOST_CHECK( !log.read_block_by_num( 11 ) );
+      BOOST_CHECK( log.read_block_by_num( 12 )->id() == blocks[2]->id() );
+   }
+
+   // a partially written record is cut off on open, blocks dropped from the front only in memory are read again
+   {
+      std::ofstream out( (dir / reversible_block_log::filename).generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+      const uint32_t size = 1000;
+      out.write( (const char*)&size, sizeof(size) );
+      out.write( "torn", 4 );
+   }
+   reversible_block_log log( dir );
+   BOOST_CHECK_EQUAL( log.first_block_num(), 10u );
+   BOOST_CHECK_EQUAL( log.last_block_num(), 13u );
+   log.append( make_block( 14, *log.block_id_for_num( 13 ), 101 ) );
+   BOOST_CHECK_EQUAL( log.read_block_by_num( 14 )->block_num(), 14u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(execution_waves_test) { try {
+   const name code = N(roxe.token), alice = N(alice), bob = N(bob), accounts = N(accounts);
+
+   vector<table_access_set> sets(5);
+   sets[0].record_write( code, alice, accounts );
+   sets[1].record_write( code, bob, accounts );   // disjoint from 0
+   sets[2].record_read( code, alice, accounts );  // reads what 0 wrote
+   sets[3].record_read( code, alice, accounts );  // concurrent readers do not conflict
+   sets[4].record_write( code, alice, accounts ); // must follow both readers
+
+   BOOST_CHECK( !sets[0].conflicts_with( sets[1] ) );
+   BOOST_CHECK( sets[0].conflicts_with( sets[2] ) );
+   BOOST_CHECK( !sets[2].conflicts_with( sets[3] ) );
+
+   const auto waves = compute_execution_waves( sets );
+   BOOST_REQUIRE_EQUAL( waves.size(), 5 );
+   BOOST_CHECK_EQUAL( waves[0], 0 );
+   BOOST_CHECK_EQUAL( waves[1], 0 );
+   BOOST_CHECK_EQUAL( waves[2], 1 );
+   BOOST_CHECK_EQUAL( waves[3], 1 );
+   BOOST_CHECK_EQUAL( waves[4], 2 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(table_access_stale_test) { try {
+   auto cfg = validating_tester::default_config();
+   cfg.record_table_access_sets = true;
+   tester chain( cfg );
+   const name token = N(roxe.token);
+   chain.create_accounts( { token, N(alice), N(bob), N(carol), N(dave) } );
+   chain.set_code( token, contracts::roxe_token_wasm() );
+   chain.set_abi( token, contracts::roxe_token_abi().data() );
+   chain.push_action( token, N(create), token, fc::mutable_variant_object()
+                      ("issuer", token)("maximum_supply", "1000.0000 TKN") );
+   chain.push_action( token, N(issue), token, fc::mutable_variant_object()
+                      ("to", token)("quantity", "1000.0000 TKN")("memo", "") );
+   for( name n : { N(alice), N(bob), N(carol) } ) {
+      chain.push_action( token, N(transfer), token, fc::mutable_variant_object()
+                         ("from", token)("to", n)("quantity", "100.0000 TKN")("memo", "") );
+   }
+   chain.produce_block();
+
+   auto transfer = [&]( name from, name to ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( chain.get_action( token, N(transfer), { {from, config::active_name} }, fc::mutable_variant_object()
+                                                  ("from", from)("to", to)("quantity", "1.0000 TKN")("memo", "") ) );
+      chain.set_transaction_headers( trx );
+      trx.sign( chain.get_private_key( from, "active" ), chain.control->get_chain_id() );
+      auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( trx ) );
+      transaction_metadata::start_recover_keys( mtrx, chain.control->get_thread_pool(), chain.control->get_chain_id(),
+                                                fc::microseconds::maximum() );
+      auto trace = chain.control->push_transaction( mtrx, fc::time_point::maximum() );
+      BOOST_REQUIRE( !trace->except );
+      return mtrx;
+   };
+
+   auto alice_to_bob = transfer( N(alice), N(bob) );
+   BOOST_REQUIRE( alice_to_bob->table_access );
+   BOOST_CHECK( alice_to_bob->table_access->writes.count( std::make_tuple( token, N(bob), N(accounts) ) ) );
+   BOOST_CHECK( !chain.control->table_access_stale( *alice_to_bob ) );
+
+   // both only read the stats of the token
+   auto carol_to_dave = transfer( N(carol), N(dave) );
+   BOOST_CHECK( !chain.control->table_access_stale( *alice_to_bob ) );
+
+   transfer( N(bob), N(carol) );
+   BOOST_CHECK( chain.control->table_access_stale( *alice_to_bob ) );
+   BOOST_CHECK( chain.control->table_access_stale( *carol_to_dave ) );
+   chain.produce_block();
+   BOOST_CHECK( chain.control->table_access_stale( *alice_to_bob ) );
+
+   // native actions may change the authorities any transaction depends on
+   auto dave_to_alice = transfer( N(dave), N(alice) );
+   BOOST_CHECK( !chain.control->table_access_stale( *dave_to_alice ) );
+   chain.create_account( N(erin) );
+   BOOST_CHECK( chain.control->table_access_stale( *dave_to_alice ) );
+
+   // not recorded for transactions which never executed
+   signed_transaction trx;
+   chain.set_transaction_headers( trx );
+   BOOST_CHECK( chain.control->table_access_stale( transaction_metadata( trx ) ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(thread_affinity_pins_pool_threads) { try {
+   BOOST_CHECK( !thread_affinity::pin_current_thread( "pinned" ) );
+   thread_affinity::set( "pinned", { 0 } );
+   BOOST_CHECK( thread_affinity::describe().find( "pinned: cpus 0 (" ) != string::npos );
+#ifdef __linux__
+   named_thread_pool pool( "pinned", 2 );
+   auto cpu = async_thread_pool( pool.get_executor(), []() { return sched_getcpu(); } );
+   BOOST_CHECK_EQUAL( cpu.get(), 0 );
+#endif
+   thread_affinity::set( "pinned", {} );
+   BOOST_CHECK( thread_affinity::describe().find( "pinned" ) == string::npos );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(merkle_roots) { try {
+   named_thread_pool pool( "merkle", 3 );
+   const vector<size_t> counts = { 1, 2, 3, 5, 64, 1001, parallel_merkle_threshold * 2 + 7, parallel_merkle_threshold * 9 };
+   for( size_t n : counts ) {
+      vector<digest_type> ids;
+      incremental_merkle im;
+      for( size_t i = 0; i < n; ++i ) {
+         ids.emplace_back( digest_type::hash( i ) );
+         im.append( ids.back() );
+      }
+      const auto root = merkle( ids );
+      BOOST_CHECK_EQUAL( root, merkle( ids, pool.get_executor(), 3 ) );
+      if( n < 64 ) {
+         // the serial reduction this replaced
+         auto level = ids;
+         while( level.size() > 1 ) {
+            if( level.size() % 2 )
+               level.push_back( level.back() );
+            for( size_t i = 0; i < level.size() / 2; ++i )
+               level[i] = digest_type::hash( make_canonical_pair( level[2 * i], level[2 * i + 1] ) );
+            level.resize( level.size() / 2 );
+         }
+         BOOST_CHECK_EQUAL( root, level.front() );
+      }
+      BOOST_CHECK_EQUAL( root, im.get_root() );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(bulk_copy_packing) { try {
+   static_assert( fc::raw::is_bulk_copyable<digest_type>::value, "" );
+   static_assert( fc::raw::is_bulk_copyable<permission_level>::value, "" );
+   static_assert( !fc::raw::is_bulk_copyable<bool>::value, "" );
+   static_assert( !fc::raw::is_bulk_copyable<action>::value, "" );
+
+   vector<permission_level> auths;
+   vector<digest_type> ids;
+   for( uint64_t i = 0; i < 100; ++i ) {
+      auths.push_back( permission_level{ name(i * 31), config::active_name } );
+      ids.push_back( digest_type::hash( i ) );
+   }
+
+   // element by element, as packed before the bulk copy
+   fc::datastream<size_t> auths_size;
+   fc::raw::pack( auths_size, unsigned_int(auths.size()) );
+   vector<char> expected( auths_size.tellp() + auths.size() * 16 );
+   fc::datastream<char*> ds( expected.data(), expected.size() );
+   fc::raw::pack( ds, unsigned_int(auths.size()) );
+   for( const auto& a : auths ) {
+      fc::raw::pack( ds, a.actor.value );
+      fc::raw::pack( ds, a.permission.value );
+   }
+   BOOST_CHECK( fc::raw::pack( auths ) == expected );
+   BOOST_CHECK( fc::raw::unpack<vector<permission_level>>( expected ) == auths );
+
+   const auto packed_ids = fc::raw::pack( ids );
+   BOOST_REQUIRE_EQUAL( packed_ids.size(), 1 + ids.size() * sizeof(digest_type) );
+   for( size_t i = 0; i < ids.size(); ++i )
+      BOOST_CHECK( memcmp( packed_ids.data() + 1 + i * sizeof(digest_type), ids[i].data(), sizeof(digest_type) ) == 0 );
+   BOOST_CHECK( fc::raw::unpack<vector<digest_type>>( packed_ids ) == ids );
+
+   BOOST_CHECK( fc::raw::unpack<vector<digest_type>>( fc::raw::pack( vector<digest_type>() ) ).empty() );
+   // a truncated vector still fails to unpack
+   auto truncated = packed_ids;
+   truncated.pop_back();
+   BOOST_CHECK_THROW( fc::raw::unpack<vector<digest_type>>( truncated ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(billing_clock_test) { try {
+   auto last = billing_clock::now();
+   for( int i = 0; i < 100000; ++i ) {
+      const auto now = billing_clock::now();
+      BOOST_REQUIRE( now >= last );
+      last = now;
+   }
+
+   // deadlines are taken from the system clock, allow for being descheduled between the two reads
+   for( int i = 0; i < 10; ++i ) {
+      const auto before = fc::time_point::now();
+      const auto now = billing_clock::now();
+      const auto after = fc::time_point::now();
+      BOOST_CHECK( now >= before - fc::milliseconds(1) );
+      BOOST_CHECK( now <= after + fc::milliseconds(1) );
+      std::this_thread::sleep_for( std::chrono::milliseconds(2) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(genesis_intrinsic_lookup) { try {
+   for( uint32_t i = 0; i < genesis_intrinsics.size(); ++i ) {
+      BOOST_CHECK_EQUAL( find_genesis_intrinsic( genesis_intrinsics[i] ), int32_t(i) );
+   }
+   BOOST_CHECK_EQUAL( find_genesis_intrinsic( "" ), -1 );
+   BOOST_CHECK_EQUAL( find_genesis_intrinsic( "get_sender" ), -1 );
+   BOOST_CHECK_EQUAL( find_genesis_intrinsic( "memse" ), -1 );
+   BOOST_CHECK_EQUAL( find_genesis_intrinsic( "memsetx" ), -1 );
+
+   // the precomputed key must agree with hashing the name against the chain's whitelist
+   tester chain;
+   const auto& whitelist = chain.control->db().get<protocol_state_object>().whitelisted_intrinsics;
+   for( uint32_t i = 0; i < genesis_intrinsics.size(); ++i ) {
+      const std::string name = genesis_intrinsics[i];
+      BOOST_CHECK( is_intrinsic_whitelisted( whitelist, name ) );
+      BOOST_CHECK( is_intrinsic_whitelisted( whitelist, genesis_intrinsic_whitelist_hash( i ), name ) );
+   }
+   BOOST_CHECK( !is_intrinsic_whitelisted( whitelist, genesis_intrinsic_whitelist_hash( 0 ), "memse" ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(metrics_registry_render) { try {
+   auto& r = fc::metrics::registry::instance();
+   auto& c = r.add_counter( "misc_test_requests_total", "Requests", {{"api", "chain"}} );
+   BOOST_CHECK_EQUAL( &c, &r.add_counter( "misc_test_requests_total", "Requests", {{"api", "chain"}} ) );
+   c.inc( 3 );
+   r.add_counter( "misc_test_requests_total", "Requests", {{"api", "a\"b"}} ).inc();
+   r.add_gauge( "misc_test_depth", "Depth" ).set( -2 );
+   auto& h = r.add_histogram( "misc_test_seconds", "Latency", fc::metrics::exponential_bounds( 0.001, 10, 2 ) );
+   h.observe( 0.0005 );
+   h.observe( 0.001 );
+   h.observe( 0.5 );
+   BOOST_CHECK_THROW( r.add_gauge( "misc_test_requests_total", "Requests" ), fc::exception );
+
+   const auto text = r.render();
+   for( const char* line : { "# TYPE misc_test_requests_total counter\n",
+                             "misc_test_requests_total{api=\"chain\"} 3\n",
+                             "misc_test_requests_total{api=\"a\\\"b\"} 1\n",
+                             "# TYPE misc_test_depth gauge\nmisc_test_depth -2\n",
+                             "misc_test_seconds_bucket{le=\"0.001\"} 2\n",
+                             "misc_test_seconds_bucket{le=\"0.01\"} 2\n",
+                             "misc_test_seconds_bucket{le=\"+Inf\"} 3\n",
+                             "misc_test_seconds_sum 0.5015\n",
+                             "misc_test_seconds_count 3\n" } ) {
+      BOOST_CHECK_MESSAGE( text.find( line ) != std::string::npos, "missing " << line );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(thread_pool_metrics_test) { try {
+   fc::metrics::counter* handlers = nullptr;
+   {
+      named_thread_pool pool( "misc_m", 2 );
+      auto* m = thread_pool_metrics::of( pool.get_executor() );
+      BOOST_REQUIRE( m );
+      handlers = &m->handlers;
+      BOOST_CHECK_EQUAL( m->threads.value(), 2 );
+      std::vector<std::future<int>> results;
+      for( int i = 0; i < 10; ++i )
+         results.emplace_back( async_thread_pool( pool.get_executor(), [i]() { return i; } ) );
+      for( int i = 0; i < 10; ++i )
+         BOOST_CHECK_EQUAL( results[i].get(), i );
+      BOOST_CHECK_EQUAL( m->queued.value(), 0 );
+      BOOST_CHECK_EQUAL( m->wait.cumulative_counts().back(), 10u );
+   }
+   BOOST_CHECK_GE( handlers->value(), 10u ); // counted after each handler returns, all have once the pool stopped
+   boost::asio::io_context other;
+   BOOST_CHECK( !thread_pool_metrics::of( other ) );
+   BOOST_CHECK( fc::metrics::registry::instance().render().find( "roxe_thread_pool_threads{pool=\"misc_m\"} 0\n" ) != std::string::npos );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(wasm_profiler_samples) { try {
+   wasm_profiler profiler;
+   const auto code_hash = fc::sha256::hash( std::string( "code" ) );
+
+   wasm_profiler::take_sample( 1, "" ); // outside an apply, dropped
+   {
+      wasm_profiler::scoped_sampling sampling( &profiler, N(alice), N(transfer), code_hash );
+      wasm_profiler::take_sample( 3, "" );
+      wasm_profiler::take_sample( 5, "apply;inner x" );
+      wasm_profiler::take_sample( 5, "apply;inner x" );
+      wasm_profiler::take_sample( -1, "" );
+   }
+   {
+      wasm_profiler::scoped_sampling sampling( nullptr, N(bob), N(transfer), code_hash );
+      wasm_profiler::take_sample( 3, "" );
+   }
+
+   auto rows = profiler.get_samples();
+   BOOST_REQUIRE_EQUAL( rows.size(), 1u );
+   BOOST_CHECK_EQUAL( rows[0].receiver, N(alice) );
+   BOOST_CHECK_EQUAL( rows[0].code_hash, code_hash );
+   BOOST_CHECK_EQUAL( rows[0].samples, 4u );
+   BOOST_REQUIRE_EQUAL( rows[0].stacks.size(), 3u );
+   BOOST_CHECK_EQUAL( rows[0].stacks[0].first, "alice;transfer;apply_inner_x" );
+   BOOST_CHECK_EQUAL( rows[0].stacks[0].second, 2u );
+
+   profiler.enable_sampling( 500 );
+   BOOST_CHECK( profiler.sampling() );
+   for( int i = 0; i < 1000 && !wasm_profiler::sample_due(); ++i )
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+   BOOST_CHECK( wasm_profiler::sample_due() );
+   profiler.enable_sampling( 0 );
+   wasm_profiler::take_sample( 3, "" );
+   BOOST_CHECK( !wasm_profiler::sample_due() );
+
+   profiler.clear_samples();
+   BOOST_CHECK( profiler.get_samples().empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(startup_profile_phases) { try {
+   auto& profile = startup_profile::instance();
+   {
+      auto outer = profile.phase( "misc_test_outer" );
+      {
+         auto inner = profile.phase( "misc_test_inner" );
+         inner.add( "blocks", 3 );
+      }
+   }
+   std::vector<startup_phase> phases;
+   for( auto& p : profile.phases() )
+      if( p.name.find( "misc_test_" ) == 0 ) phases.push_back( p );
+   BOOST_REQUIRE_EQUAL( phases.size(), 2u );
+   BOOST_CHECK_EQUAL( phases[0].name, "misc_test_outer" ); // recorded last, ordered first
+   BOOST_CHECK_EQUAL( phases[1].name, "misc_test_inner" );
+   BOOST_CHECK( phases[1].start + phases[1].duration <= phases[0].start + phases[0].duration );
+   BOOST_REQUIRE_EQUAL( phases[1].counters.size(), 1u );
+   BOOST_CHECK_EQUAL( phases[1].counters[0].second, 3u );
+   BOOST_CHECK( profile.process_start() <= phases[0].start );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(tracing_collect_and_export) { try {
+   fc::tracing::clear();
+   { fc::tracing::scoped_span s( "misc_test_disabled", 1 ); }
+   BOOST_CHECK( fc::tracing::collect().empty() );
+
+   fc::tracing::set_enabled( true );
+   const auto start = fc::tracing::now_ns();
+   {
+      fc::tracing::scoped_span outer( "misc_test_outer" );
+      outer.set_arg( 7 );
+      { fc::tracing::scoped_span inner( "misc_test_inner", 7 ); }
+   }
+   std::thread( [] { fc::tracing::scoped_span s( "misc_test_other_thread", 8 ); } ).join();
+   fc::tracing::set_enabled( false );
+
+   auto spans = fc::tracing::collect( start );
+   BOOST_REQUIRE_EQUAL( spans.size(), 3u );
+   BOOST_CHECK_EQUAL( spans[0].name, "misc_test_outer" );
+   BOOST_CHECK_EQUAL( spans[1].name, "misc_test_inner" );
+   BOOST_CHECK_EQUAL( spans[2].name, "misc_test_other_thread" );
+   BOOST_CHECK( spans[0].start_ns <= spans[1].start_ns && spans[1].end_ns <= spans[0].end_ns );
+   BOOST_CHECK_EQUAL( spans[0].tid, spans[1].tid );
+   BOOST_CHECK_NE( spans[0].tid, spans[2].tid );
+
+   const auto json = fc::tracing::to_chrome_json( spans );
+   BOOST_CHECK( json.find( "\"name\":\"misc_test_inner\",\"ph\":\"X\"" ) != std::string::npos );
+   BOOST_CHECK( json.find( "\"args\":{\"block_num\":8}" ) != std::string::npos );
+   BOOST_CHECK_NO_THROW( fc::json::from_string( json ) );
+
+   fc::tracing::clear();
+   BOOST_CHECK( fc::tracing::collect( start ).empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(key_account_index_test) { try {
+   TESTER t;
+   t.create_accounts( { N(alice), N(bob) } );
+   t.produce_block();
+
+   key_account_index index;
+   index.build( t.control->db() );
+   const auto alice_key = t.get_public_key( N(alice), "active" );
+   BOOST_CHECK( index.lookup( t.control->db(), alice_key ) == vector<account_name>{ N(alice) } );
+
+   // bob adds alice's key, alice replaces it; the entry left behind is filtered out
+   const auto new_key = t.get_public_key( N(alice), "new" );
+   t.set_authority( N(bob), N(shared), authority( alice_key ), config::active_name );
+   t.set_authority( N(alice), config::active_name, authority( new_key ) );
+   index.update( t.control->db(), N(bob) );
+   index.update( t.control->db(), N(alice) );
+   BOOST_CHECK( index.lookup( t.control->db(), alice_key ) == vector<account_name>{ N(bob) } );
+   BOOST_CHECK( index.lookup( t.control->db(), new_key ) == vector<account_name>{ N(alice) } );
+
+   fc::temp_directory tempdir;
+   const auto file = tempdir.path() / "key-accounts.bin";
+   index.save( file, t.control->db(), t.control->head_block_id() );
+   key_account_index loaded;
+   BOOST_CHECK( !loaded.load( file, block_id_type() ) );
+   BOOST_REQUIRE( loaded.load( file, t.control->head_block_id() ) );
+   BOOST_CHECK_EQUAL( loaded.size(), index.size() - 1 );
+   BOOST_CHECK( loaded.lookup( t.control->db(), new_key ) == vector<account_name>{ N(alice) } );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(async_subscriber_test) { try {
+   boost::signals2::signal<void(const std::shared_ptr<int>&)> s;
+   std::vector<int> received;
+   std::thread::id handler_thread;
+   async_subscriber sub( "misc-test", 2 ); // emitting waits for the handler most of the time
+   auto c = sub.connect( s, [&]( const std::shared_ptr<int>& p ) {
+      handler_thread = std::this_thread::get_id();
+      received.push_back( *p );
+   } );
+   for( int i = 0; i < 100; ++i )
+      s( std::make_shared<int>( i ) );
+   c.disconnect();
+   sub.stop();
+
+   BOOST_REQUIRE_EQUAL( received.size(), 100u );
+   for( int i = 0; i < 100; ++i )
+      BOOST_CHECK_EQUAL( received[i], i );
+   BOOST_CHECK( handler_thread != std::this_thread::get_id() );
+   BOOST_CHECK_EQUAL( sub.queued(), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(object_iterator_map_test) { try {
+   std::vector<std::array<char,64>> objs( 3000 );
+   object_iterator_map<std::array<char,64>> m;
+   const auto initial_capacity = m.capacity();
+
+   for( int round = 0; round < 3; ++round ) {
+      for( int i = 0; i < 20; ++i )
+         BOOST_CHECK_EQUAL( m.find( &objs[i] ), -1 ); // cleared by the previous round
+      for( int i = 0; i < 20; ++i )
+         m.set( &objs[i], i + round );
+      for( int i = 0; i < 20; ++i )
+         BOOST_CHECK_EQUAL( m.find( &objs[i] ), i + round );
+
+      // an erased object gets a new iterator, the objects probed past it are still found
+      m.erase( &objs[3] );
+      BOOST_CHECK_EQUAL( m.find( &objs[3] ), -1 );
+      m.set( &objs[3], 100 );
+      BOOST_CHECK_EQUAL( m.find( &objs[3] ), 100 );
+      for( int i = 4; i < 20; ++i )
+         BOOST_CHECK_EQUAL( m.find( &objs[i] ), i + round );
+      m.clear();
+      BOOST_CHECK_EQUAL( m.capacity(), initial_capacity );
+   }
+
+   // growing keeps the objects and their iterators, except the erased ones
+   for( int i = 0; i < 1000; ++i )
+      m.set( &objs[i], i );
+   m.erase( &objs[500] );
+   m.set( &objs[999], 9999 );
+   BOOST_CHECK_GE( m.capacity(), 2000u );
+   for( int i = 0; i < 999; ++i )
+      BOOST_CHECK_EQUAL( m.find( &objs[i] ), i == 500 ? -1 : i );
+   BOOST_CHECK_EQUAL( m.find( &objs[999] ), 9999 );
+
+   // a large array is not kept for the next action
+   for( int i = 0; i < 3000; ++i )
+      m.set( &objs[i], i );
+   m.clear();
+   BOOST_CHECK_EQUAL( m.capacity(), initial_capacity );
+   BOOST_CHECK_EQUAL( m.find( &objs[0] ), -1 );
+} FC_LOG_AND_RETHROW() }
 
 BOOST_AUTO_TEST_SUITE_END()
 
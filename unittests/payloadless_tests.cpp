@@ -9,6 +9,7 @@
 
 #include <roxe/testing/tester.hpp>
 #include <roxe/chain/abi_serializer.hpp>
+#include <roxe/chain/apply_context.hpp>
 
 #include <Runtime/Runtime.h>
 
@@ -81,4 +82,36 @@ BOOST_FIXTURE_TEST_CASE( test_abi_serializer, payloadless_tester ) {
    BOOST_CHECK_EQUAL(msg == "Im a payloadless action", true);
 }
 
+
+BOOST_FIXTURE_TEST_CASE( test_native_doit, payloadless_tester ) try {
+   create_accounts( {N(payloadless), N(other)} );
+   set_code( N(payloadless), contracts::payloadless_wasm() );
+   set_abi( N(payloadless), contracts::payloadless_abi().data() );
+   set_code( N(other), contracts::payloadless_wasm() );
+   set_abi( N(other), contracts::payloadless_abi().data() );
+   produce_block();
+
+   const auto code_hash = control->db().get<account_metadata_object,by_name>( N(payloadless) ).code_hash;
+   uint32_t native_calls = 0;
+   control->register_native_contract_action( N(payloadless), code_hash, N(payloadless), N(doit), [&]( apply_context& context ) {
+      ++native_calls;
+      context.console_append( "Im a payloadless action" );
+   } );
+   control->register_native_contract_action( N(other), fc::sha256::hash( "other code" ), N(other), N(doit), [&]( apply_context& ) {
+      ++native_calls;
+   } );
+
+   auto trace = push_action( N(payloadless), N(doit), N(payloadless), mutable_variant_object() );
+   BOOST_CHECK_EQUAL( native_calls, 1u );
+   BOOST_CHECK_EQUAL( trace->action_traces.front().console, "Im a payloadless action" );
+
+   // the hash registered for other is not the hash of its code, so its wasm runs
+   trace = push_action( N(other), N(doit), N(other), mutable_variant_object() );
+   BOOST_CHECK_EQUAL( native_calls, 1u );
+   BOOST_CHECK_EQUAL( trace->action_traces.front().console, "Im a payloadless action" );
+
+   // nodes still running the wasm reach the same state
+   produce_block();
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -41,7 +41,7 @@ BOOST_AUTO_TEST_SUITE(producer_schedule_tests)
    // However, it won't be applied until the effective block num is deemed irreversible
    uint64_t calc_block_num_of_next_round_first_block(const controller& control){
       auto res = control.head_block_num() + 1;
-      const auto blocks_per_round = control.head_block_state()->active_schedule.producers.size() * config::producer_repetitions;
+      const auto blocks_per_round = control.head_block_state()->active_schedule->producers.size() * config::producer_repetitions;
       while((res % blocks_per_round) != 0) {
          res++;
       }
@@ -54,7 +54,7 @@ BOOST_AUTO_TEST_SUITE(producer_schedule_tests)
       const auto& confirm_schedule_correctness = [&](const vector<producer_key>& new_prod_schd, const uint64_t eff_new_prod_schd_block_num)  {
          const uint32_t check_duration = 1000; // number of blocks
          for (uint32_t i = 0; i < check_duration; ++i) {
-            const auto current_schedule = control->head_block_state()->active_schedule.producers;
+            const auto current_schedule = control->head_block_state()->active_schedule->producers;
             const auto& current_absolute_slot = control->get_global_properties().proposed_schedule_block_num;
             // Determine expected producer
             const auto& expected_producer = get_expected_producer(current_schedule, *current_absolute_slot + 1);
@@ -502,4 +502,31 @@ BOOST_AUTO_TEST_CASE( producer_watermark_test ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_AUTO_TEST_CASE( schedules_shared_between_block_states ) try {
+   tester c;
+   c.create_accounts( {N(alice), N(bob)} );
+   c.set_producers( {N(alice), N(bob)} );
+   for( int i = 0; i < 1000 && c.control->head_block_state()->active_schedule->version < 1; ++i )
+      c.produce_block();
+   BOOST_REQUIRE_EQUAL( c.control->head_block_state()->active_schedule->version, 1u );
+   c.produce_blocks( 3 );
+
+   const auto head = c.control->head_block_state();
+   const auto prev = c.control->fetch_block_state_by_id( head->header.previous );
+   BOOST_REQUIRE( prev );
+   BOOST_CHECK_EQUAL( &*head->active_schedule, &*prev->active_schedule );
+
+   // packed and converted to a variant as the schedule it holds
+   const producer_schedule_type& active = head->active_schedule;
+   BOOST_CHECK( fc::raw::pack( head->active_schedule ) == fc::raw::pack( active ) );
+   const auto packed = fc::raw::pack( static_cast<const block_header_state&>( *head ) );
+   const auto unpacked = fc::raw::unpack<block_header_state>( packed );
+   BOOST_CHECK( unpacked.active_schedule == head->active_schedule );
+   BOOST_CHECK( unpacked.pending_schedule.schedule == head->pending_schedule.schedule );
+   BOOST_CHECK( fc::raw::pack( unpacked ) == packed );
+   block_header_state from_variant;
+   fc::from_variant( fc::variant( static_cast<const block_header_state&>( *head ) ), from_variant );
+   BOOST_CHECK( from_variant.active_schedule == head->active_schedule );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
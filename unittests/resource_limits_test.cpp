@@ -241,6 +241,49 @@ BOOST_AUTO_TEST_SUITE(resource_limits_test)
 
    } FC_LOG_AND_RETHROW();
 
+   BOOST_FIXTURE_TEST_CASE(pending_usage_follows_undo, resource_limits_fixture) try {
+      const account_name account(1);
+      initialize_account(account);
+      set_account_limits(account, -1, -1, -1 );
+      process_account_limit_updates();
+
+      auto used_cpu = [&]() { return get_account_cpu_limit_ex(account).first.used; };
+      auto used_net = [&]() { return get_account_net_limit_ex(account).first.used; };
+
+      add_transaction_usage({account}, 100, 10, 0);
+      const auto cpu = used_cpu();
+      const auto net = used_net();
+      BOOST_REQUIRE_GT(cpu, 0);
+      BOOST_REQUIRE_GT(net, 0);
+
+      {
+         auto s = start_session();
+         add_transaction_usage({account}, 100, 10, 0);
+         BOOST_REQUIRE_GT(used_cpu(), cpu);
+         s.undo();
+      }
+      BOOST_REQUIRE_EQUAL(used_cpu(), cpu);
+      BOOST_REQUIRE_EQUAL(used_net(), net);
+
+      {
+         auto outer = start_session();
+         {
+            auto inner = start_session();
+            add_transaction_usage({account}, 100, 10, 0);
+            inner.squash();
+         }
+         const auto squashed_cpu = used_cpu();
+         BOOST_REQUIRE_GT(squashed_cpu, cpu);
+
+         // writing the rows at the end of the block must not change what is reported, nor what undo restores
+         process_block_usage(1);
+         BOOST_REQUIRE_EQUAL(used_cpu(), squashed_cpu);
+         outer.undo();
+      }
+      BOOST_REQUIRE_EQUAL(used_cpu(), cpu);
+      BOOST_REQUIRE_EQUAL(used_net(), net);
+   } FC_LOG_AND_RETHROW();
+
    BOOST_FIXTURE_TEST_CASE(enforce_account_ram_limit, resource_limits_fixture) try {
       const uint64_t limit = 1000;
       const uint64_t increment = 77;
@@ -28,7 +28,7 @@ public:
    roxe_token_tester() {
       produce_blocks( 2 );
 
-      create_accounts( { N(alice), N(bob), N(carol), N(roxe.token) } );
+      create_accounts( { N(alice), N(bob), N(carol), N(roxe.token), N(roxe.saving) } );
       produce_blocks( 2 );
 
       set_code( N(roxe.token), contracts::roxe_token_wasm() );
@@ -269,4 +269,63 @@ BOOST_FIXTURE_TEST_CASE( transfer_tests, roxe_token_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( transfer_fee_tests, roxe_token_tester ) try {
+
+   create( N(alice), asset::from_string("1000 CERO") );
+   issue( N(alice), N(alice), asset::from_string("1000 CERO"), "hola" );
+   produce_blocks(1);
+
+   auto balance = [this]( account_name acc ) {
+      auto row = get_account( acc, "0,CERO" );
+      return row.is_null() ? string() : row["balance"].as_string();
+   };
+
+   // a new token charges the default fee of one unit, on top of the quantity
+   BOOST_REQUIRE_EQUAL( get_stats("0,CERO")["fee"].as_int64(), 1 );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(alice), N(bob), asset::from_string("10 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( balance( N(alice) ), "989 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(bob) ), "10 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(roxe.saving) ), "1 CERO" );
+
+   // quantity and fee are debited together, so the whole balance is not enough to send all of it
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "overdrawn balance" ),
+      transfer( N(alice), N(bob), asset::from_string("989 CERO"), "hola" )
+   );
+   BOOST_REQUIRE_EQUAL( balance( N(alice) ), "989 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(bob) ), "10 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(roxe.saving) ), "1 CERO" );
+
+   // setfee finds the stats row under the symbol code scope, where create put it
+   BOOST_REQUIRE_EQUAL( success(), push_action( N(alice), N(setfee), mvo()
+      ( "owner", "alice" )
+      ( "symbol", "0,CERO" )
+      ( "fee", 5 )
+   ) );
+   BOOST_REQUIRE_EQUAL( get_stats("0,CERO")["fee"].as_int64(), 5 );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "symbol precision mismatch" ), push_action( N(alice), N(setfee), mvo()
+      ( "owner", "alice" )
+      ( "symbol", "1,CERO" )
+      ( "fee", 5 )
+   ) );
+
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(alice), N(bob), asset::from_string("100 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( balance( N(alice) ), "884 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(bob) ), "110 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(roxe.saving) ), "6 CERO" );
+
+   // a transfer to the saving account gets the quantity and the fee in its one row
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(alice), N(roxe.saving), asset::from_string("4 CERO"), "hola" ) );
+   BOOST_REQUIRE_EQUAL( balance( N(alice) ), "875 CERO" );
+   BOOST_REQUIRE_EQUAL( balance( N(roxe.saving) ), "15 CERO" );
+
+   // a fee of zero, for which transfer skips the saving account, can not be set
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "Cannot set fee below default value(1)." ), push_action( N(alice), N(setfee), mvo()
+      ( "owner", "alice" )
+      ( "symbol", "0,CERO" )
+      ( "fee", 0 )
+   ) );
+   BOOST_REQUIRE_EQUAL( get_stats("0,CERO")["fee"].as_int64(), 5 );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
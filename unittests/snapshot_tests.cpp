@@ -18,7 +18,8 @@ using namespace chain;
 
 class snapshotted_tester : public base_tester {
 public:
-   snapshotted_tester(controller::config config, const snapshot_reader_ptr& snapshot, int ordinal) {
+   snapshotted_tester(controller::config config, const snapshot_reader_ptr& snapshot, int ordinal,
+                      const vector<snapshot_reader_ptr>& differential_snapshots = vector<snapshot_reader_ptr>()) {
       FC_ASSERT(config.blocks_dir.filename().generic_string() != "."
          && config.state_dir.filename().generic_string() != ".", "invalid path names in controller::config");
 
@@ -28,7 +29,7 @@ public:
       copied_config.state_dir =
               config.state_dir.parent_path() / std::to_string(ordinal).append(config.state_dir.filename().generic_string());
 
-      init(copied_config, snapshot);
+      init(copied_config, snapshot, differential_snapshots);
    }
 
    snapshotted_tester(controller::config config, const snapshot_reader_ptr& snapshot, int ordinal, int copy_block_log_from_ordinal) {
@@ -252,4 +253,58 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_replay_over_snapshot, SNAPSHOT_SUITE, snapsho
    BOOST_REQUIRE_EQUAL(expected_post_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_differential_snapshot, SNAPSHOT_SUITE, snapshot_suites)
+{
+   tester chain;
+   auto cfg = chain.get_config();
+   cfg.differential_snapshots = true;
+   chain.close();
+   chain.init(cfg);
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto base_writer = SNAPSHOT_SUITE::get_writer();
+   chain.control->write_snapshot(base_writer);
+   auto base = SNAPSHOT_SUITE::finalize(base_writer);
+   BOOST_REQUIRE( chain.control->differential_snapshot_base() == chain.control->head_block_id() );
+
+   for (int itr = 0; itr < 6; itr++) {
+      chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+         ( "value", 1 )
+      );
+      chain.produce_block();
+   }
+
+   chain.control->abort_block();
+   auto first_diff_writer = SNAPSHOT_SUITE::get_writer();
+   chain.control->write_differential_snapshot(first_diff_writer);
+   auto first_diff = SNAPSHOT_SUITE::finalize(first_diff_writer);
+
+   chain.create_account(N(snapshot1));
+   chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+      ( "value", 1 )
+   );
+   chain.produce_blocks(2);
+
+   chain.control->abort_block();
+   auto expected_integrity_hash = chain.control->calculate_integrity_hash();
+   auto second_diff_writer = SNAPSHOT_SUITE::get_writer();
+   chain.control->write_differential_snapshot(second_diff_writer);
+   auto second_diff = SNAPSHOT_SUITE::finalize(second_diff_writer);
+
+   snapshotted_tester snap_chain(chain.get_config(), SNAPSHOT_SUITE::get_reader(base), 1,
+                                 { SNAPSHOT_SUITE::get_reader(first_diff), SNAPSHOT_SUITE::get_reader(second_diff) });
+   BOOST_REQUIRE_EQUAL(expected_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
+
+   // a differential snapshot cannot be applied to a base it was not created from
+   BOOST_REQUIRE_THROW( snapshotted_tester(chain.get_config(), SNAPSHOT_SUITE::get_reader(base), 2,
+                                           { SNAPSHOT_SUITE::get_reader(second_diff) }),
+                        snapshot_validation_exception );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
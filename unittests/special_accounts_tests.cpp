@@ -48,7 +48,7 @@ BOOST_FIXTURE_TEST_CASE(accounts_exists, tester)
       auto producers = chain1_db.find<account_object, by_name>(config::producers_account_name);
       BOOST_CHECK(producers != nullptr);
 
-      const auto& active_producers = control->head_block_state()->active_schedule;
+      const producer_schedule_type& active_producers = control->head_block_state()->active_schedule;
 
       const auto& producers_active_authority = chain1_db.get<permission_object, by_owner>(boost::make_tuple(config::producers_account_name, config::active_name));
       auto expected_threshold = (active_producers.producers.size() * 2)/3 + 1;
@@ -79,4 +79,75 @@ BOOST_FIXTURE_TEST_CASE(accounts_exists, tester)
 
 } FC_LOG_AND_RETHROW() }
 
+// the producers account follows the active schedule, also when it changes after the authorities were last checked
+BOOST_FIXTURE_TEST_CASE(producers_authority_follows_schedule, tester)
+{ try {
+      auto check_authorities = [&]( const vector<account_name>& expected ) {
+         const auto& db = control->db();
+         const auto n = expected.size();
+         auto check = [&]( permission_name perm, size_t threshold ) {
+            const auto& po = db.get<permission_object, by_owner>( boost::make_tuple( config::producers_account_name, perm ) );
+            BOOST_CHECK_EQUAL( po.auth.threshold, threshold );
+            BOOST_REQUIRE_EQUAL( po.auth.accounts.size(), n );
+            for( size_t i = 0; i < n; ++i )
+               BOOST_CHECK_EQUAL( po.auth.accounts[i].permission.actor, expected[i] );
+         };
+         check( config::active_name, n * 2 / 3 + 1 );
+         check( config::majority_producers_permission_name, n / 2 + 1 );
+         check( config::minority_producers_permission_name, n / 3 + 1 );
+      };
+      auto produce_until_version = [&]( uint32_t version ) {
+         for( int i = 0; i < 1000 && control->head_block_state()->active_schedule->version < version; ++i )
+            produce_block();
+         BOOST_REQUIRE_EQUAL( control->head_block_state()->active_schedule->version, version );
+      };
+
+      create_accounts( { N(alice), N(bob), N(carol) } );
+      produce_block();
+      const auto initial_version = control->head_block_state()->active_schedule->version;
+
+      set_producers( { N(alice), N(bob), N(carol) } );
+      produce_until_version( initial_version + 1 );
+      check_authorities( { N(alice), N(bob), N(carol) } );
+      produce_blocks( 12 );
+      check_authorities( { N(alice), N(bob), N(carol) } );
+
+      set_producers( { N(bob) } );
+      produce_until_version( initial_version + 2 );
+      check_authorities( { N(bob) } );
+} FC_LOG_AND_RETHROW() }
+
+// a change made by updateauth within a block is reverted by the next one, also when the schedule did not change
+BOOST_FIXTURE_TEST_CASE(producers_authority_restored_after_updateauth, tester)
+{ try {
+      create_accounts( { N(alice), N(bob), N(carol) } );
+      produce_block();
+      const auto initial_version = control->head_block_state()->active_schedule->version;
+
+      set_producers( { N(alice), N(bob), N(carol) } );
+      for( int i = 0; i < 1000 && control->head_block_state()->active_schedule->version == initial_version; ++i )
+         produce_block();
+      produce_blocks( 12 );
+
+      const auto& db = control->db();
+      auto get_active = [&]() -> const permission_object& {
+         return db.get<permission_object, by_owner>( boost::make_tuple( config::producers_account_name, config::active_name ) );
+      };
+      const authority schedule_authority = get_active().auth;
+      BOOST_REQUIRE_EQUAL( schedule_authority.threshold, 3u );
+      BOOST_REQUIRE_EQUAL( schedule_authority.accounts.size(), 3u );
+
+      // the producers account itself replaces its active authority with one only alice satisfies
+      const authority alice_only( 1, {}, { { { N(alice), config::active_name }, 1 } } );
+      set_authority( config::producers_account_name, config::active_name, alice_only, config::owner_name,
+                     { { config::producers_account_name, config::active_name } },
+                     { get_private_key( N(alice), "active" ), get_private_key( N(bob), "active" ), get_private_key( N(carol), "active" ) } );
+      BOOST_CHECK( authority(get_active().auth) == alice_only );
+
+      produce_block();
+      BOOST_CHECK( authority(get_active().auth) == schedule_authority );
+      produce_block();
+      BOOST_CHECK( authority(get_active().auth) == schedule_authority );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,233 @@
+/**
+ *  @file
+ *  @copyright defined in roxe/LICENSE.txt
+ */
+#include <roxe/chain/exceptions.hpp>
+#include <roxe/testing/tester.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string/replace.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include "test_wasts.hpp"
+
+#include <contracts.hpp>
+
+#ifdef NON_VALIDATING_TEST
+#define TESTER tester
+#else
+#define TESTER validating_tester
+#endif
+
+using namespace roxe;
+using namespace roxe::chain;
+using namespace roxe::testing;
+
+/*
+ * Microbenchmarks of the wasm runtimes. Like every suite here this one runs once with `--wavm` and once with
+ * `--wabt`, and each figure is reported through BOOST_TEST_MESSAGE tagged with the runtime that produced it,
+ * so run with `--log_level=message` and compare the two logs. Times are the `elapsed` of the action trace,
+ * which covers instantiation, the apply call and the memory reset, but not transaction overhead.
+ */
+
+struct bench_args {
+   uint32_t kernel     = 0;
+   uint32_t iterations = 0;
+   uint64_t nonce      = 0;
+};
+FC_REFLECT(bench_args, (kernel)(iterations)(nonce))
+
+namespace {
+
+   enum bench_kernel : uint32_t {
+      empty_loop   = 0,
+      db_find      = 1,
+      sha256_64    = 2,
+      prints_8     = 3,
+      int_mix      = 4,
+      memory_sum   = 5,
+      store_row    = 6,
+      grow_memory  = 7
+   };
+
+   const char* vm_name( const base_tester& t ) {
+      return t.get_config().wasm_runtime == wasm_interface::vm_type::wavm ? "wavm" : "wabt";
+   }
+
+   /// Pushes one action with raw `data` in its own transaction and returns the elapsed time of the action
+   int64_t run_action( base_tester& t, account_name code, action_name act_name, bytes data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{code, config::active_name}}, code, act_name, std::move(data) );
+      t.set_transaction_headers( trx );
+      trx.sign( t.get_private_key( code, "active" ), t.control->get_chain_id() );
+      auto trace = t.push_transaction( trx );
+      BOOST_REQUIRE( trace->receipt );
+      BOOST_REQUIRE_EQUAL( trace->action_traces.size(), 1u );
+      return trace->action_traces[0].elapsed.count();
+   }
+
+   int64_t run_kernel( base_tester& t, account_name code, bench_kernel kernel, uint32_t iterations ) {
+      static uint64_t nonce = 0;
+      return run_action( t, code, N(run), fc::raw::pack( bench_args{kernel, iterations, ++nonce} ) );
+   }
+
+   /// Average elapsed time of `runs` executions of `kernel`, producing blocks so none runs out of cpu
+   double average_kernel( base_tester& t, account_name code, bench_kernel kernel, uint32_t iterations, uint32_t runs ) {
+      int64_t total = 0;
+      for( uint32_t i = 0; i < runs; ++i ) {
+         total += run_kernel( t, code, kernel, iterations );
+         if( i % 20 == 19 )
+            t.produce_block();
+      }
+      t.produce_block();
+      return double(total) / runs;
+   }
+
+   string unique_noop_wast( uint64_t nonce ) {
+      string wast = bench_noop_wast;
+      boost::replace_all( wast, "${NONCE}", std::to_string( nonce ) );
+      return wast;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(wasm_bench_tests)
+
+/// First action after set_code pays for instantiation (and for wavm, compilation); the second hits the cache
+BOOST_FIXTURE_TEST_CASE( instantiation, TESTER ) try {
+   struct sample {
+      const char*   name;
+      account_name  account;
+      action_name   act;
+      bytes         data;
+   };
+   vector<sample> samples = {
+      { "synthetic noop", N(noopsynth), N(run), {} },
+      { "noop", N(nooptest), N(anyaction), fc::raw::pack( name(N(nooptest)) ) },
+      { "roxe.token", N(roxe.token), N(issue), {} }
+   };
+   create_accounts( { N(noopsynth), N(nooptest), N(roxe.token) } );
+   set_code( N(noopsynth), unique_noop_wast( 1 ).c_str() );
+   set_code( N(nooptest), contracts::noop_wasm() );
+   set_code( N(roxe.token), contracts::roxe_token_wasm() );
+   set_abi( N(roxe.token), contracts::roxe_token_abi().data() );
+   produce_block();
+
+   for( auto& smp : samples ) {
+      // the nonce trails the data so both pushes are distinct; roxe.token rejects the action, but only after
+      // instantiating the contract, so its failing push is timed instead
+      auto time_one = [&]( uint64_t nonce ) -> int64_t {
+         bytes data = smp.data;
+         auto packed = fc::raw::pack( nonce );
+         data.insert( data.end(), packed.begin(), packed.end() );
+         const auto start = fc::time_point::now();
+         try {
+            return run_action( *this, smp.account, smp.act, data );
+         } catch( const fc::exception& ) {
+            return (fc::time_point::now() - start).count();
+         }
+      };
+      const auto first  = time_one( 1 );
+      const auto second = time_one( 2 );
+      BOOST_TEST_MESSAGE( vm_name( *this ) << " instantiation " << smp.name << ": first action " << first
+                          << " us, second action " << second << " us" );
+      produce_block();
+   }
+
+   // compile time grows with the code, so also compare the cold start of codes with distinct hashes
+   int64_t cold = 0;
+   const uint32_t codes = 5;
+   for( uint32_t i = 0; i < codes; ++i ) {
+      account_name acct( N(noopcold) + i );
+      create_account( acct );
+      set_code( acct, unique_noop_wast( 100 + i ).c_str() );
+      produce_block();
+      cold += run_action( *this, acct, N(run), {} );
+   }
+   BOOST_TEST_MESSAGE( vm_name( *this ) << " instantiation: " << codes << " fresh codes, average first action "
+                       << cold / codes << " us" );
+} FC_LOG_AND_RETHROW()
+
+/// Fixed cost of dispatching an action that does no work
+BOOST_FIXTURE_TEST_CASE( action_overhead, TESTER ) try {
+   create_accounts( { N(noopsynth) } );
+   set_code( N(noopsynth), unique_noop_wast( 2 ).c_str() );
+   produce_block();
+   run_action( *this, N(noopsynth), N(run), fc::raw::pack( uint64_t(0) ) );
+
+   const uint32_t runs = 200;
+   int64_t total = 0;
+   for( uint32_t i = 1; i <= runs; ++i ) {
+      total += run_action( *this, N(noopsynth), N(run), fc::raw::pack( uint64_t(i) ) );
+      if( i % 20 == 0 )
+         produce_block();
+   }
+   BOOST_TEST_MESSAGE( vm_name( *this ) << " action overhead: " << runs << " empty actions, average "
+                       << double(total) / runs << " us" );
+} FC_LOG_AND_RETHROW()
+
+/// Linear memory is restored to its initial state between actions; a contract that grew it pays for that
+BOOST_FIXTURE_TEST_CASE( memory_reset, TESTER ) try {
+   create_accounts( { N(kernels) } );
+   set_code( N(kernels), bench_kernels_wast );
+   produce_block();
+   run_kernel( *this, N(kernels), empty_loop, 0 );
+
+   const uint32_t runs = 40;
+   int64_t after_empty = 0, after_grow = 0, grow = 0;
+   for( uint32_t i = 0; i < runs; ++i ) {
+      run_kernel( *this, N(kernels), empty_loop, 0 );
+      after_empty += run_kernel( *this, N(kernels), empty_loop, 0 );
+      grow += run_kernel( *this, N(kernels), grow_memory, 0 );
+      after_grow += run_kernel( *this, N(kernels), empty_loop, 0 );
+      if( i % 5 == 4 )
+         produce_block();
+   }
+   BOOST_TEST_MESSAGE( vm_name( *this ) << " memory reset: growing by 16 MiB takes " << double(grow) / runs
+                       << " us, the following empty action " << double(after_grow) / runs
+                       << " us against " << double(after_empty) / runs << " us" );
+} FC_LOG_AND_RETHROW()
+
+/// Latency of a single intrinsic call, net of the loop that makes it
+BOOST_FIXTURE_TEST_CASE( intrinsic_latency, TESTER ) try {
+   create_accounts( { N(kernels) } );
+   set_code( N(kernels), bench_kernels_wast );
+   produce_block();
+   run_kernel( *this, N(kernels), store_row, 0 );
+   produce_block();
+
+   const uint32_t iterations = 1000;
+   const uint32_t runs = 20;
+   const double base = average_kernel( *this, N(kernels), empty_loop, iterations, runs );
+   BOOST_TEST_MESSAGE( vm_name( *this ) << " intrinsic latency: empty loop of " << iterations << " takes "
+                       << base << " us" );
+   for( auto kernel : { std::make_pair( db_find, "db_find_i64" ),
+                        std::make_pair( sha256_64, "sha256 of 64 bytes" ),
+                        std::make_pair( prints_8, "prints_l of 8 bytes" ) } ) {
+      const double us = average_kernel( *this, N(kernels), kernel.first, iterations, runs );
+      BOOST_TEST_MESSAGE( vm_name( *this ) << " intrinsic latency " << kernel.second << ": "
+                          << (us - base) * 1000 / iterations << " ns per call" );
+   }
+} FC_LOG_AND_RETHROW()
+
+/// Pure wasm compute, where the runtimes differ the most
+BOOST_FIXTURE_TEST_CASE( compute_kernels, TESTER ) try {
+   create_accounts( { N(kernels) } );
+   set_code( N(kernels), bench_kernels_wast );
+   produce_block();
+   run_kernel( *this, N(kernels), empty_loop, 0 );
+
+   const uint32_t runs = 10;
+   const uint32_t mix_iterations = 10000;
+   const double mix = average_kernel( *this, N(kernels), int_mix, mix_iterations, runs );
+   BOOST_TEST_MESSAGE( vm_name( *this ) << " compute integer mixing: " << mix_iterations << " rounds take "
+                       << mix << " us" );
+
+   const uint32_t sum_iterations = 4;
+   const double sum = average_kernel( *this, N(kernels), memory_sum, sum_iterations, runs );
+   BOOST_TEST_MESSAGE( vm_name( *this ) << " compute memory sum: " << sum_iterations << " passes over 64 KiB take "
+                       << sum << " us" );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,10 +3,12 @@
  *  @copyright defined in roxe/LICENSE.txt
  */
 #include <array>
+#include <random>
 #include <utility>
 
 #include <roxe/chain/abi_serializer.hpp>
 #include <roxe/chain/exceptions.hpp>
+#include <roxe/chain/native_float.hpp>
 #include <roxe/chain/resource_limits.hpp>
 #include <roxe/chain/wasm_roxe_constraints.hpp>
 #include <roxe/chain/wast_to_wasm.hpp>
@@ -157,6 +159,46 @@ BOOST_FIXTURE_TEST_CASE( prove_mem_reset, TESTER ) try {
 
 } FC_LOG_AND_RETHROW() /// prove_mem_reset
 
+/**
+ * Prove modules dropped to stay within the instantiation cache size are instantiated again when used
+ */
+BOOST_AUTO_TEST_CASE( instantiation_cache_size_limit ) try {
+   auto run = []( tester& chain ) {
+      chain.create_accounts( {N(asserter), N(noop)} );
+      chain.produce_block();
+      chain.set_code( N(asserter), contracts::asserter_wasm() );
+      chain.set_abi( N(asserter), contracts::asserter_abi().data() );
+      chain.set_code( N(noop), contracts::noop_wasm() );
+      chain.set_abi( N(noop), contracts::noop_abi().data() );
+      chain.produce_block();
+
+      for( int i = 0; i < 3; ++i ) {
+         chain.push_action( N(asserter), N(provereset), N(asserter), mutable_variant_object() );
+         chain.push_action( N(noop), N(anyaction), N(noop), mutable_variant_object()
+                            ("from", "noop")("type", "some type")("data", "some data") );
+         chain.produce_block();
+      }
+      return chain.control->get_wasm_interface().get_instantiation_cache_stats();
+   };
+
+   auto cfg = validating_tester::default_config();
+   cfg.wasm_instantiation_cache_size = 1;
+   tester small( cfg );
+   auto stats = run( small );
+   // only the module last used stays, every other use instantiates again
+   BOOST_CHECK_EQUAL( stats.instantiated, 1u );
+   BOOST_CHECK_GE( stats.misses, 6u );
+   BOOST_CHECK_GE( stats.evictions, 5u );
+   BOOST_CHECK_GT( stats.bytes, 0u );
+
+   tester large( validating_tester::default_config() );
+   stats = run( large );
+   BOOST_CHECK_EQUAL( stats.instantiated, 2u );
+   BOOST_CHECK_EQUAL( stats.misses, 2u );
+   BOOST_CHECK_GE( stats.hits, 4u );
+   BOOST_CHECK_EQUAL( stats.evictions, 0u );
+} FC_LOG_AND_RETHROW()
+
 /**
  * Prove the modifications to global variables are wiped between runs
  */
@@ -210,6 +252,79 @@ BOOST_FIXTURE_TEST_CASE( abi_from_variant, TESTER ) try {
 
 } FC_LOG_AND_RETHROW() /// prove_mem_reset
 
+// the native fast path of the float intrinsics against softfloat, bit for bit
+BOOST_AUTO_TEST_CASE( native_float_matches_softfloat ) try {
+   auto bits32 = []( float f ) { uint32_t u; memcpy( &u, &f, sizeof(u) ); return u; };
+   auto bits64 = []( double d ) { uint64_t u; memcpy( &u, &d, sizeof(u) ); return u; };
+   auto float32 = []( uint32_t u ) { float f; memcpy( &f, &u, sizeof(f) ); return f; };
+   auto float64 = []( uint64_t u ) { double d; memcpy( &d, &u, sizeof(d) ); return d; };
+
+   uint64_t mismatches = 0;
+   auto check32 = [&]( uint32_t ua, uint32_t ub ) {
+      const float a = float32( ua ), b = float32( ub );
+      const auto sa = to_softfloat32( a ), sb = to_softfloat32( b );
+      mismatches += bits32( native_float::f32_add( a, b ) ) != f32_add( sa, sb ).v;
+      mismatches += bits32( native_float::f32_sub( a, b ) ) != f32_sub( sa, sb ).v;
+      mismatches += bits32( native_float::f32_mul( a, b ) ) != f32_mul( sa, sb ).v;
+      mismatches += bits32( native_float::f32_div( a, b ) ) != f32_div( sa, sb ).v;
+      mismatches += bits32( native_float::f32_sqrt( a ) ) != f32_sqrt( sa ).v;
+   };
+   auto check64 = [&]( uint64_t ua, uint64_t ub ) {
+      const double a = float64( ua ), b = float64( ub );
+      const auto sa = to_softfloat64( a ), sb = to_softfloat64( b );
+      mismatches += bits64( native_float::f64_add( a, b ) ) != f64_add( sa, sb ).v;
+      mismatches += bits64( native_float::f64_sub( a, b ) ) != f64_sub( sa, sb ).v;
+      mismatches += bits64( native_float::f64_mul( a, b ) ) != f64_mul( sa, sb ).v;
+      mismatches += bits64( native_float::f64_div( a, b ) ) != f64_div( sa, sb ).v;
+      mismatches += bits64( native_float::f64_sqrt( a ) ) != f64_sqrt( sa ).v;
+   };
+
+   // zeros, denormals, extremes, infinities, quiet and signaling NaNs of both signs
+   const std::vector<uint32_t> special32 = { 0, 0x80000000, 1, 0x80000001, 0x007FFFFF, 0x00800000, 0x7F7FFFFF, 0xFF7FFFFF,
+                                             0x7F800000, 0xFF800000, 0x7FC00000, 0xFFC00000, 0x7F800001, 0xFFA00000,
+                                             0x3F800000, 0xBF800000 };
+   const std::vector<uint64_t> special64 = { 0, 0x8000000000000000, 1, 0x8000000000000001, 0x000FFFFFFFFFFFFF,
+                                             0x0010000000000000, 0x7FEFFFFFFFFFFFFF, 0xFFEFFFFFFFFFFFFF,
+                                             0x7FF0000000000000, 0xFFF0000000000000, 0x7FF8000000000000,
+                                             0xFFF8000000000000, 0x7FF0000000000001, 0xFFF4000000000000,
+                                             0x3FF0000000000000, 0xBFF0000000000000 };
+   auto run = [&]() {
+      for( auto a : special32 )
+         for( auto b : special32 )
+            check32( a, b );
+      for( auto a : special64 )
+         for( auto b : special64 )
+            check64( a, b );
+
+      std::mt19937_64 rng( 7 );
+      for( int i = 0; i < 200000; ++i ) {
+         check32( rng(), rng() );
+         check64( rng(), rng() );
+         // operands close to each other cancel, small ones produce denormals
+         const uint32_t a32 = rng();
+         check32( a32, a32 ^ (rng() & 0xFF) );
+         const uint64_t a64 = rng();
+         check64( a64, a64 ^ (rng() & 0xFFFF) );
+         check32( rng() & 0x80FFFFFF, rng() & 0x80FFFFFF );
+         check64( rng() & 0x800FFFFFFFFFFFFF, rng() );
+      }
+   };
+   run();
+   BOOST_CHECK_EQUAL( mismatches, 0u );
+
+#if ROXE_NATIVE_FLOAT
+   // a thread running in another rounding mode or flushing denormals falls back to softfloat
+   const auto mxcsr = _mm_getcsr();
+   for( unsigned int mode : { 0x2000u, 0x6000u, 0x8040u } ) {
+      _mm_setcsr( (mxcsr & ~native_float::mxcsr_mode_mask) | mode );
+      BOOST_CHECK( !native_float::enabled() );
+      run();
+      _mm_setcsr( mxcsr );
+      BOOST_CHECK_EQUAL( mismatches, 0u );
+   }
+#endif
+} FC_LOG_AND_RETHROW()
+
 // test softfloat 32 bit operations
 BOOST_FIXTURE_TEST_CASE( f32_tests, TESTER ) try {
    produce_blocks(2);